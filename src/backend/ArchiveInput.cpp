@@ -0,0 +1,201 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file ArchiveInput.cpp
+ * @error -1700
+ *
+ * How libarchive reads a package off the disk. See ArchiveInput.h.
+ */
+
+#include "ArchiveInput.h"
+
+/**
+ * Tells the kernel a file will be read from front to back, so it reads further ahead than usual
+ * This is only a hint, so failures are ignored
+ *
+ * @param [in] int fd
+ */
+void adviseSequential(int fd) {/*{{{*/
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+}/*}}}*/
+
+/**
+ * The read callback libarchive calls for more data
+ */
+static la_ssize_t readCallback(struct archive* a, void* clientData, const void** buf) {/*{{{*/
+    la_ssize_t r = ((ArchiveInput*)clientData)->read(buf);
+    if(r < 0) {
+        archive_set_error(a, errno, "Could not read the package");
+    }
+
+    return r;
+}/*}}}*/
+
+/**
+ * The skip callback libarchive calls to jump over data it doesn't need
+ */
+static la_int64_t skipCallback(struct archive*, void* clientData, la_int64_t request) {/*{{{*/
+    return ((ArchiveInput*)clientData)->skip(request);
+}/*}}}*/
+
+/**
+ * The close callback libarchive calls once it's done with the package. It owns the input by then
+ */
+static int closeCallback(struct archive*, void* clientData) {/*{{{*/
+    delete (ArchiveInput*)clientData;
+    return ARCHIVE_OK;
+}/*}}}*/
+
+/**
+ * Opens a package in libarchive, mapped into memory or read through a large buffer
+ *
+ * @param [in] struct archive* a A new archive, with its formats and filters set up, but not opened
+ * @param [in] std::string archivePath
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int What archive_read_open1 returned, or ARCHIVE_FATAL, with the error set on a, if the package could not be opened
+ */
+int openArchiveInput(struct archive* a, std::string archivePath, unsigned int verbosity) {/*{{{*/
+    ArchiveInput* input = new ArchiveInput(archivePath, verbosity);
+    if(input->open() != 0) {
+        archive_set_error(a, errno, "Could not open %s", archivePath.c_str());
+        delete input;
+        return ARCHIVE_FATAL;
+    }
+
+    archive_read_set_callback_data(a, input);
+    archive_read_set_read_callback(a, readCallback);
+    archive_read_set_close_callback(a, closeCallback);
+
+    if(input->isSeekable()) {
+        archive_read_set_skip_callback(a, skipCallback);
+    }
+
+    // From here on, libarchive calls closeCallback, even if it fails to open
+    return archive_read_open1(a);
+}/*}}}*/
+
+/**
+ * @param [in] std::string path
+ * @param [in] unsigned int verbosity
+ */
+ArchiveInput::ArchiveInput(std::string path, unsigned int verbosity) {/*{{{*/
+    this->path = path;
+    this->verbosity = verbosity;
+}/*}}}*/
+
+ArchiveInput::~ArchiveInput() {/*{{{*/
+    if(map != NULL) {
+        munmap((void*)map, mapSize);
+    }
+
+    if(fd >= 0) {
+        close(fd);
+    }
+}/*}}}*/
+
+/**
+ * Opens the package, and picks how it's read
+ *
+ * @returns int 0 on success, or ARCHIVE_INPUT_OPEN_ERROR with errno set
+ */
+int ArchiveInput::open() {/*{{{*/
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        return ARCHIVE_INPUT_OPEN_ERROR;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        return ARCHIVE_INPUT_OPEN_ERROR;
+    }
+
+    adviseSequential(fd);
+
+    if(S_ISREG(st.st_mode) && st.st_size > 0 && st.st_size <= ARCHIVE_MMAP_MAX) {
+        void* m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(m != MAP_FAILED) {
+            madvise(m, st.st_size, MADV_SEQUENTIAL);
+
+            map = m;
+            mapSize = st.st_size;
+            close(fd);
+            fd = -1;
+
+            if(verbosity >= 4) {
+                printf("Reading %s through a %lu byte memory map\n",path.c_str(),(unsigned long)mapSize);
+            }
+
+            return 0;
+        }
+    }
+
+    // Read whole filesystem blocks at a time, as many as fit in the minimum buffer size
+    size_t blockSize = (st.st_blksize > 0) ? st.st_blksize : 4096;
+    size_t bufferSize = ((ARCHIVE_READ_BUFFER_MIN + blockSize - 1) / blockSize) * blockSize;
+    if(bufferSize > ARCHIVE_READ_BUFFER_MAX) {
+        bufferSize = ARCHIVE_READ_BUFFER_MAX;
+    }
+
+    buffer.resize(bufferSize);
+    seekable = S_ISREG(st.st_mode);
+
+    if(verbosity >= 4) {
+        printf("Reading %s in %lu byte blocks\n",path.c_str(),(unsigned long)bufferSize);
+    }
+
+    return 0;
+}/*}}}*/
+
+/**
+ * Hands libarchive its next piece of the package
+ * A mapped package is handed over whole, on the first call
+ *
+ * @param [out] const void** buf
+ *
+ * @returns la_ssize_t The number of bytes at buf, 0 at the end of the package, or -1 with errno set
+ */
+la_ssize_t ArchiveInput::read(const void** buf) {/*{{{*/
+    if(map != NULL) {
+        if(mapHandedOut) {
+            return 0;
+        }
+
+        mapHandedOut = true;
+        *buf = map;
+        return mapSize;
+    }
+
+    while(true) {
+        ssize_t r = ::read(fd, buffer.data(), buffer.size());
+        if(r < 0 && errno == EINTR) {
+            continue;
+        }
+
+        *buf = buffer.data();
+        return r;
+    }
+}/*}}}*/
+
+/**
+ * Moves past data libarchive doesn't need, without reading it
+ *
+ * @param [in] la_int64_t request
+ *
+ * @returns la_int64_t The number of bytes skipped, which is 0 if libarchive should read past them instead
+ */
+la_int64_t ArchiveInput::skip(la_int64_t request) {/*{{{*/
+    if(lseek(fd, request, SEEK_CUR) < 0) {
+        return 0;
+    }
+
+    return request;
+}/*}}}*/
+
+/**
+ * @returns bool Whether libarchive may skip over data with lseek
+ */
+bool ArchiveInput::isSeekable() {/*{{{*/
+    return seekable;
+}/*}}}*/
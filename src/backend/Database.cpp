@@ -0,0 +1,721 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Database.cpp
+ * @error -1000
+ *
+ * The installed package database. See Database.h for the layout.
+ */
+
+#include "Database.h"
+
+/**
+ * Opens the database inside installedPkgsPath
+ * Any legacy per-package files next to it are read as well, so packages followed by older versions of pkg-mgr are never lost
+ *
+ * @param [in] std::string installedPkgsPath
+ * @param [in] unsigned int verbosity
+ */
+PkgDatabase::PkgDatabase(std::string installedPkgsPath, unsigned int verbosity) {/*{{{*/
+    dirPath = installedPkgsPath;
+    this->verbosity = verbosity;
+
+    mapDatabase();
+    loadLegacy();
+}/*}}}*/
+
+PkgDatabase::~PkgDatabase() {/*{{{*/
+    unmapDatabase();
+}/*}}}*/
+
+/**
+ * Maps the database file and validates its header
+ * A file which is there but can't be read is looked at as empty, and mapError is set so update never writes over it
+ *
+ * @returns bool wasMapped
+ */
+bool PkgDatabase::mapDatabase() {/*{{{*/
+    std::string path = dirPath + "/" + DB_FILENAME;
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        if(errno != ENOENT) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Could not open the installed package database %s. %s\n",path.c_str(),strerror(errno));
+            }
+
+            mapError = DB_IO_ERROR;
+        }
+
+        return false;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not stat the installed package database %s. %s\n",path.c_str(),strerror(errno));
+        }
+
+        close(fd);
+        mapError = DB_IO_ERROR;
+        return true;
+    }
+
+    if(st.st_size < DB_V1_HEADER_SIZE) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: The installed package database %s is truncated. Treating it as empty.\n",path.c_str());
+        }
+
+        close(fd);
+        mapError = DB_CORRUPT;
+        return true;
+    }
+
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(map == MAP_FAILED) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not map the installed package database %s. %s\n",path.c_str(),strerror(errno));
+        }
+
+        mapError = DB_IO_ERROR;
+        return true;
+    }
+
+    data = (const char*)map;
+    dataSize = st.st_size;
+
+    uint64_t version = getLE(data + DB_MAGIC_SIZE, 4);
+    uint64_t recordCount = getLE(data + DB_MAGIC_SIZE + 4, 4);
+    uint64_t strings = getLE(data + DB_MAGIC_SIZE + 8, 8);
+    uint64_t blobs = getLE(data + DB_MAGIC_SIZE + 16, 8);
+
+    // The first version had no generation, which counts as generation 0
+    uint64_t headerSize = (version == DB_V1_VERSION) ? DB_V1_HEADER_SIZE : DB_HEADER_SIZE;
+
+    if(memcmp(data, DB_MAGIC, DB_MAGIC_SIZE) != 0 || (version != DB_VERSION && version != DB_V1_VERSION) || dataSize < headerSize || strings != headerSize + recordCount * DB_RECORD_SIZE || blobs < strings || blobs > dataSize) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: The installed package database %s is corrupt. Treating it as empty.\n",path.c_str());
+        }
+
+        mapError = DB_CORRUPT;
+        return true;
+    }
+
+    count = recordCount;
+    generation = (version == DB_VERSION) ? getLE(data + DB_V1_HEADER_SIZE, 8) : 0;
+    tableOffset = headerSize;
+    stringsOffset = strings;
+    blobsOffset = blobs;
+
+    // Lookups jump around the record table, so don't bother reading ahead
+    madvise(map, dataSize, MADV_RANDOM);
+
+    return true;
+}/*}}}*/
+
+void PkgDatabase::unmapDatabase() {/*{{{*/
+    if(data != NULL) {
+        munmap((void*)data, dataSize);
+    }
+
+    data = NULL;
+    dataSize = 0;
+    count = 0;
+    generation = 0;
+    tableOffset = DB_HEADER_SIZE;
+    stringsOffset = 0;
+    blobsOffset = 0;
+    mapError = 0;
+}/*}}}*/
+
+/**
+ * Reads the one-file-per-package layout used before the database existed
+ * Each file is named after the package, its modification time is the time it was followed, and it holds either the package's manifest or nothing at all. Any other file is skipped
+ * The database itself and its helper files start with a dot, so once everything has been imported, this is a scan of a directory holding nothing else
+ */
+void PkgDatabase::loadLegacy() {/*{{{*/
+    legacyRecords.clear();
+
+    std::error_code e;
+    std::filesystem::directory_iterator di(dirPath, e);
+    if(e) {
+        return;
+    }
+
+    for(auto& p : di) {
+        std::string name = p.path().filename().string();
+        if(name.empty() || name[0] == '.' || !p.is_regular_file(e)) {
+            continue;
+        }
+
+        // Anything else in here isn't ours, and is left alone. Importing a file removes it
+        std::vector<manifestEntry_s> entries;
+        int res = readManifest(p.path().string(), entries, 0);
+        if(res != 0 && res != MANIFEST_LEGACY) {
+            if(verbosity >= 3) {
+                fprintf(stderr,"Warning: %s is neither a manifest nor an empty file, so it isn't read as an installed package\n",p.path().c_str());
+            }
+
+            continue;
+        }
+
+        dbRecord_s rec;
+        rec.name = name;
+
+        struct stat st;
+        if(stat(p.path().c_str(), &st) == 0) {
+            rec.installTime = st.st_mtime;
+        }
+
+        if(res == 0) {
+            rec.manifest = serializeManifest(entries);
+        }
+
+        legacyRecords[name] = rec;
+    }
+}/*}}}*/
+
+/**
+ * Reads the record at index out of the mapped database
+ *
+ * @param [in] uint32_t index
+ * @param [out] dbRecord_s& rec
+ * @param [in] bool withManifest
+ *
+ * @returns bool wasRecordValid
+ */
+bool PkgDatabase::recordAt(uint32_t index, dbRecord_s& rec, bool withManifest) {/*{{{*/
+    const char* r = data + tableOffset + (size_t)index * DB_RECORD_SIZE;
+
+    uint64_t nameOffset = getLE(r, 4);
+    uint64_t nameLen = getLE(r + 4, 2);
+    uint64_t versionLen = getLE(r + 6, 2);
+    uint64_t versionOffset = getLE(r + 8, 4);
+    uint64_t manifestOffset = getLE(r + 24, 8);
+    uint64_t manifestSize = getLE(r + 32, 8);
+    uint64_t stringsSize = blobsOffset - stringsOffset;
+    uint64_t blobsSize = dataSize - blobsOffset;
+
+    if(nameOffset + nameLen > stringsSize || versionOffset + versionLen > stringsSize || manifestOffset > blobsSize || manifestSize > blobsSize - manifestOffset) {
+        return false;
+    }
+
+    rec.name.assign(data + stringsOffset + nameOffset, nameLen);
+    rec.version.assign(data + stringsOffset + versionOffset, versionLen);
+    rec.installTime = (int64_t)getLE(r + 16, 8);
+
+    if(withManifest) {
+        rec.manifest.assign(data + blobsOffset + manifestOffset, manifestSize);
+    }
+
+    return true;
+}/*}}}*/
+
+/**
+ * Binary searches the record table for a package
+ *
+ * @param [in] const std::string& name
+ *
+ * @returns int64_t index, or -1 if the package isn't in the database
+ */
+int64_t PkgDatabase::find(const std::string& name) {/*{{{*/
+    int64_t low = 0;
+    int64_t high = (int64_t)count - 1;
+
+    while(low <= high) {
+        int64_t mid = low + (high - low) / 2;
+        const char* r = data + tableOffset + (size_t)mid * DB_RECORD_SIZE;
+        uint64_t nameOffset = getLE(r, 4);
+        uint64_t nameLen = getLE(r + 4, 2);
+
+        if(nameOffset + nameLen > blobsOffset - stringsOffset) {
+            return -1;
+        }
+
+        int cmp = name.compare(0, std::string::npos, data + stringsOffset + nameOffset, nameLen);
+        if(cmp == 0) {
+            return mid;
+        }
+
+        else if(cmp < 0) {
+            high = mid - 1;
+        }
+
+        else {
+            low = mid + 1;
+        }
+    }
+
+    return -1;
+}/*}}}*/
+
+/**
+ * @param [in] const std::string& name
+ *
+ * @returns bool isPkgInstalled
+ */
+bool PkgDatabase::contains(const std::string& name) {/*{{{*/
+    return find(name) >= 0 || legacyRecords.count(name) != 0;
+}/*}}}*/
+
+/**
+ * Looks up everything the database knows about a package
+ *
+ * @param [in] const std::string& name
+ * @param [out] dbRecord_s& rec
+ *
+ * @returns bool wasFound
+ */
+bool PkgDatabase::lookup(const std::string& name, dbRecord_s& rec) {/*{{{*/
+    int64_t index = find(name);
+    if(index >= 0) {
+        return recordAt(index, rec, true);
+    }
+
+    auto it = legacyRecords.find(name);
+    if(it == legacyRecords.end()) {
+        return false;
+    }
+
+    rec = it->second;
+    return true;
+}/*}}}*/
+
+/**
+ * Looks up the version of an installed package, without reading its manifest
+ *
+ * @param [in] const std::string& name
+ *
+ * @returns std::string version, empty if the package isn't followed or was followed without metadata
+ */
+std::string PkgDatabase::getVersion(const std::string& name) {/*{{{*/
+    int64_t index = find(name);
+    dbRecord_s rec;
+
+    if(index >= 0 && recordAt(index, rec, false)) {
+        return rec.version;
+    }
+
+    auto it = legacyRecords.find(name);
+    return (it == legacyRecords.end()) ? "" : it->second.version;
+}/*}}}*/
+
+/**
+ * Parses the manifest of an installed package
+ *
+ * @param [in] const std::string& name
+ * @param [out] std::vector<manifestEntry_s>& entries
+ *
+ * @returns int 0 on success, DB_NOT_FOUND, MANIFEST_LEGACY if no manifest was recorded, or MANIFEST_CORRUPT
+ */
+int PkgDatabase::getManifest(const std::string& name, std::vector<manifestEntry_s>& entries) {/*{{{*/
+    int64_t index = find(name);
+    if(index < 0) {
+        auto it = legacyRecords.find(name);
+        if(it == legacyRecords.end()) {
+            return DB_NOT_FOUND;
+        }
+
+        return parseManifest(it->second.manifest.data(), it->second.manifest.size(), entries);
+    }
+
+    // Parse straight out of the map, without copying the manifest first
+    const char* r = data + tableOffset + (size_t)index * DB_RECORD_SIZE;
+    uint64_t manifestOffset = getLE(r + 24, 8);
+    uint64_t manifestSize = getLE(r + 32, 8);
+
+    if(manifestOffset > dataSize - blobsOffset || manifestSize > dataSize - blobsOffset - manifestOffset) {
+        return MANIFEST_CORRUPT;
+    }
+
+    return parseManifest(data + blobsOffset + manifestOffset, manifestSize, entries);
+}/*}}}*/
+
+/**
+ * @returns std::vector<std::string> names, sorted
+ */
+std::vector<std::string> PkgDatabase::listNames() {/*{{{*/
+    std::vector<std::string> names;
+    names.reserve(count);
+
+    for(uint32_t index = 0; index < count; index++) {
+        dbRecord_s rec;
+        if(recordAt(index, rec, false)) {
+            names.push_back(rec.name);
+        }
+    }
+
+    // Both lists are sorted, so there's no need to sort them again
+    if(!legacyRecords.empty()) {
+        std::vector<std::string> merged;
+        auto it = legacyRecords.begin();
+
+        for(const std::string& name : names) {
+            while(it != legacyRecords.end() && it->first < name) {
+                merged.push_back(it->first);
+                it++;
+            }
+
+            if(it != legacyRecords.end() && it->first == name) {
+                it++;
+            }
+
+            merged.push_back(name);
+        }
+
+        for(; it != legacyRecords.end(); it++) {
+            merged.push_back(it->first);
+        }
+
+        names.swap(merged);
+    }
+
+    return names;
+}/*}}}*/
+
+/**
+ * @returns uint64_t How many times the database was updated. 0 if it was never written, or written before generations existed
+ */
+uint64_t PkgDatabase::getGeneration() {/*{{{*/
+    return generation;
+}/*}}}*/
+
+/**
+ * Copies every record, manifests included, out of the database
+ *
+ * @returns std::map<std::string, dbRecord_s> records
+ */
+std::map<std::string, dbRecord_s> PkgDatabase::loadAll() {/*{{{*/
+    std::map<std::string, dbRecord_s> records;
+    for(uint32_t index = 0; index < count; index++) {
+        dbRecord_s rec;
+        if(recordAt(index, rec, true)) {
+            records[rec.name] = rec;
+        }
+    }
+
+    // The database wins if a package is in both
+    records.insert(legacyRecords.begin(), legacyRecords.end());
+
+    return records;
+}/*}}}*/
+
+/**
+ * Writes a complete database holding records, and renames it over the old one
+ * The caller must hold the database lock
+ *
+ * @param [in] const std::map<std::string, dbRecord_s>& records
+ * @param [in] uint64_t newGeneration
+ *
+ * @returns int 0 on success, or DB_IO_ERROR
+ */
+int PkgDatabase::commit(const std::map<std::string, dbRecord_s>& records, uint64_t newGeneration) {/*{{{*/
+    std::string table;
+    std::string strings;
+    std::string blobs;
+    uint32_t written = 0;
+
+    // Maps iterate in sorted order, which is exactly what find expects
+    for(auto& it : records) {
+        const dbRecord_s& rec = it.second;
+        if(rec.name.size() > UINT16_MAX || rec.version.size() > UINT16_MAX) {
+            continue;
+        }
+
+        putLE(table, strings.size(), 4);
+        putLE(table, rec.name.size(), 2);
+        putLE(table, rec.version.size(), 2);
+        strings.append(rec.name);
+        putLE(table, strings.size(), 4);
+        strings.append(rec.version);
+        putLE(table, 0, 4);
+        putLE(table, (uint64_t)rec.installTime, 8);
+        putLE(table, blobs.size(), 8);
+        putLE(table, rec.manifest.size(), 8);
+        putLE(table, 0, 8);
+        blobs.append(rec.manifest);
+        written++;
+    }
+
+    std::string buf;
+    buf.append(DB_MAGIC, DB_MAGIC_SIZE);
+    putLE(buf, DB_VERSION, 4);
+    putLE(buf, written, 4);
+    putLE(buf, DB_HEADER_SIZE + table.size(), 8);
+    putLE(buf, DB_HEADER_SIZE + table.size() + strings.size(), 8);
+    putLE(buf, newGeneration, 8);
+    buf.append(table);
+    buf.append(strings);
+    buf.append(blobs);
+
+    std::string tmpPath = dirPath + "/" + DB_TMP_FILENAME;
+    std::string path = dirPath + "/" + DB_FILENAME;
+
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd < 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not create %s. %s\n",tmpPath.c_str(),strerror(errno));
+        }
+
+        return DB_IO_ERROR;
+    }
+
+    size_t done = 0;
+    while(done < buf.size()) {
+        ssize_t w = write(fd, buf.data() + done, buf.size() - done);
+        if(w < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if(w < 0) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Could not write %s. %s\n",tmpPath.c_str(),strerror(errno));
+            }
+
+            close(fd);
+            unlink(tmpPath.c_str());
+            return DB_IO_ERROR;
+        }
+
+        done += w;
+    }
+
+    // The rename must never be seen before the data it points at
+    if(fsync(fd) != 0 || close(fd) != 0 || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not update the installed package database %s. %s\n",path.c_str(),strerror(errno));
+        }
+
+        unlink(tmpPath.c_str());
+        return DB_IO_ERROR;
+    }
+
+    int dirFd = open(dirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(dirFd >= 0) {
+        fsync(dirFd);
+        close(dirFd);
+    }
+
+    if(verbosity >= 4) {
+        printf("Wrote %u records (%lu bytes) to the installed package database %s\n",written,buf.size(),path.c_str());
+    }
+
+    return 0;
+}/*}}}*/
+
+/**
+ * Replaces or removes a single record
+ *
+ * Takes the database lock, rereads the database in case another process changed it since we opened it, applies the change and commits it.
+ * Any legacy files are included in the new database, and are removed once it is in place.
+ * A database file which couldn't be read is left as it is, and nothing is changed.
+ *
+ * @param [in] const std::string& name
+ * @param [in] const dbRecord_s* rec The new record, or NULL to remove the package
+ *
+ * @returns int 0 on success, DB_CORRUPT or DB_IO_ERROR if the database couldn't be read, or another negative error code
+ */
+int PkgDatabase::update(const std::string& name, const dbRecord_s* rec) {/*{{{*/
+    std::string lockPath = dirPath + "/" + DB_LOCK_FILENAME;
+    int lockFd = open(lockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if(lockFd < 0 || flock(lockFd, LOCK_EX) != 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not lock the installed package database in %s. %s\n",dirPath.c_str(),strerror(errno));
+        }
+
+        if(lockFd >= 0) {
+            close(lockFd);
+        }
+
+        return DB_IO_ERROR;
+    }
+
+    unmapDatabase();
+    mapDatabase();
+    loadLegacy();
+
+    // Committing now would replace whatever is left in the file with just this change
+    if(mapError != 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Refusing to update the installed package database %s/%s, since it couldn't be read. Move it aside to start a new one\n",dirPath.c_str(),DB_FILENAME);
+        }
+
+        flock(lockFd, LOCK_UN);
+        close(lockFd);
+        return mapError;
+    }
+
+    // An owner index which has fallen behind (say, from a crash between the two renames) gets rebuilt instead of patched
+    bool ownersCurrent = ownersAreCurrent();
+
+    std::map<std::string, dbRecord_s> records = loadAll();
+    if(rec != NULL) {
+        records[name] = *rec;
+    }
+
+    else {
+        records.erase(name);
+    }
+
+    uint64_t newGeneration = generation + 1;
+    int res = commit(records, newGeneration);
+
+    if(res == 0) {
+        if(verbosity >= 2 && !legacyRecords.empty()) {
+            printf("Imported %lu packages into the installed package database\n",legacyRecords.size());
+        }
+
+        for(auto& it : legacyRecords) {
+            unlink((dirPath + "/" + it.first).c_str());
+        }
+
+        std::set<std::string> removed = { name };
+        std::map<std::string, std::vector<std::string>> added;
+
+        if(rec != NULL && !rec->manifest.empty()) {
+            added[name] = manifestPaths(rec->manifest);
+        }
+
+        for(auto& it : legacyRecords) {
+            if(it.first != name) {
+                removed.insert(it.first);
+                if(!it.second.manifest.empty()) {
+                    added[it.first] = manifestPaths(it.second.manifest);
+                }
+            }
+        }
+
+        if(!ownersCurrent || updateOwnerIndex(dirPath, removed, added, newGeneration, verbosity) != 0) {
+            rebuildOwners(records, newGeneration);
+        }
+    }
+
+    unmapDatabase();
+    mapDatabase();
+    loadLegacy();
+
+    flock(lockFd, LOCK_UN);
+    close(lockFd);
+
+    return res;
+}/*}}}*/
+
+/**
+ * Adds a package to the database, replacing any record it already has
+ *
+ * @param [in] const dbRecord_s& rec
+ *
+ * @returns int 0 on success, or a negative error code
+ */
+int PkgDatabase::put(const dbRecord_s& rec) {/*{{{*/
+    return update(rec.name, &rec);
+}/*}}}*/
+
+/**
+ * Removes a package from the database
+ *
+ * @param [in] const std::string& name
+ *
+ * @returns int 0 on success, or a negative error code
+ */
+int PkgDatabase::remove(const std::string& name) {/*{{{*/
+    return update(name, NULL);
+}/*}}}*/
+
+/**
+ * Counts the packages which have a manifest, which is the number of packages an up to date owner index knows about
+ *
+ * @returns uint32_t count
+ */
+uint32_t PkgDatabase::countManifests() {/*{{{*/
+    uint32_t manifests = 0;
+
+    for(uint32_t index = 0; index < count; index++) {
+        const char* r = data + tableOffset + (size_t)index * DB_RECORD_SIZE;
+        if(getLE(r + 32, 8) != 0) {
+            manifests++;
+        }
+    }
+
+    for(auto& it : legacyRecords) {
+        if(!it.second.manifest.empty() && find(it.first) < 0) {
+            manifests++;
+        }
+    }
+
+    return manifests;
+}/*}}}*/
+
+/**
+ * Rebuilds the owner index from every manifest in records
+ * The caller must hold the database lock
+ *
+ * @param [in] const std::map<std::string, dbRecord_s>& records
+ * @param [in] uint64_t ownersGeneration The generation of the database records were committed as
+ *
+ * @returns int 0 on success, or a negative error code
+ */
+int PkgDatabase::rebuildOwners(const std::map<std::string, dbRecord_s>& records, uint64_t ownersGeneration) {/*{{{*/
+    std::map<std::string, std::vector<std::string>> pkgPaths;
+
+    for(auto& it : records) {
+        if(!it.second.manifest.empty()) {
+            pkgPaths[it.first] = manifestPaths(it.second.manifest);
+        }
+    }
+
+    if(verbosity >= 3) {
+        printf("Rebuilding the owner index from %lu manifests\n",pkgPaths.size());
+    }
+
+    return writeOwnerIndex(dirPath, pkgPaths, ownersGeneration, verbosity);
+}/*}}}*/
+
+/**
+ * Whether or not the owner index matches the database
+ * An index written for another generation missed an update, even one which left the number of packages alone, such as a package being replaced. Legacy manifests don't bump the generation, so they're still counted
+ *
+ * @returns bool isCurrent
+ */
+bool PkgDatabase::ownersAreCurrent() {/*{{{*/
+    OwnerIndex owners(dirPath, 0);
+    return owners.isValid() && owners.getGeneration() == generation && owners.getPkgCount() == countManifests();
+}/*}}}*/
+
+/**
+ * Rebuilds the owner index if it is missing or out of date
+ * Databases written before the owner index existed get theirs the first time someone asks who owns a file
+ *
+ * @returns int 0 on success, or a negative error code
+ */
+int PkgDatabase::refreshOwners() {/*{{{*/
+    std::string lockPath = dirPath + "/" + DB_LOCK_FILENAME;
+    int lockFd = open(lockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if(lockFd < 0 || flock(lockFd, LOCK_EX) != 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not lock the installed package database in %s. %s\n",dirPath.c_str(),strerror(errno));
+        }
+
+        if(lockFd >= 0) {
+            close(lockFd);
+        }
+
+        return DB_IO_ERROR;
+    }
+
+    unmapDatabase();
+    mapDatabase();
+    loadLegacy();
+
+    int res = 0;
+    if(!ownersAreCurrent()) {
+        res = rebuildOwners(loadAll(), generation);
+    }
+
+    flock(lockFd, LOCK_UN);
+    close(lockFd);
+
+    return res;
+}/*}}}*/
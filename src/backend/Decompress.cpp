@@ -0,0 +1,413 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Decompress.cpp
+ * @error -1600
+ *
+ * Multi-threaded decompression of zstd and xz packages. See Decompress.h.
+ * Everything here sits in front of libarchive as its data source, so libarchive still reads the tar format itself. Packages this can't speed up are left to libarchive's own filters.
+ */
+
+#include "Decompress.h"
+
+/**
+ * Works out how a package is compressed from its first few bytes
+ *
+ * @param [in] int fd
+ *
+ * @returns int One of the COMPRESSION_* values. Anything unrecognized is COMPRESSION_NONE
+ */
+int detectCompression(int fd) {/*{{{*/
+    unsigned char magic[6];
+    if(pread(fd, magic, sizeof(magic), 0) != sizeof(magic)) {
+        return COMPRESSION_NONE;
+    }
+
+    if(magic[0] == 0x1f && magic[1] == 0x8b) {
+        return COMPRESSION_GZIP;
+    }
+
+    if(memcmp(magic, "\xfd" "7zXZ\0", 6) == 0) {
+        return COMPRESSION_XZ;
+    }
+
+    // A regular zstd frame, or a skippable one, which may come first
+    if((magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) || ((magic[0] & 0xf0) == 0x50 && magic[1] == 0x2a && magic[2] == 0x4d && magic[3] == 0x18)) {
+        return COMPRESSION_ZSTD;
+    }
+
+    return COMPRESSION_NONE;
+}/*}}}*/
+
+/**
+ * @returns unsigned int The number of threads to decompress a package with
+ */
+unsigned int decompressThreads() {/*{{{*/
+    long n = DECOMPRESS_THREADS;
+    if(n <= 0) {
+        n = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+
+    if(n < 1) {
+        n = 1;
+    }
+
+    if(n > DECOMPRESS_MAX_THREADS) {
+        n = DECOMPRESS_MAX_THREADS;
+    }
+
+    return (unsigned int)n;
+}/*}}}*/
+
+/**
+ * The read callback libarchive calls for more data
+ */
+static la_ssize_t readCallback(struct archive* a, void* clientData, const void** buf) {/*{{{*/
+    ParallelDecoder* decoder = (ParallelDecoder*)clientData;
+
+    la_ssize_t r = decoder->read(buf);
+    if(r < 0) {
+        archive_set_error(a, EIO, "%s", decoder->getError().c_str());
+    }
+
+    return r;
+}/*}}}*/
+
+/**
+ * The close callback libarchive calls once it's done with the package. It owns the decoder by then
+ */
+static int closeCallback(struct archive*, void* clientData) {/*{{{*/
+    delete (ParallelDecoder*)clientData;
+    return ARCHIVE_OK;
+}/*}}}*/
+
+/**
+ * Opens a package in libarchive through a ParallelDecoder, if it's compressed in a way that can use more than one thread
+ *
+ * @param [in] struct archive* a A new archive, with its formats and filters set up, but not opened
+ * @param [in] std::string archivePath
+ * @param [out] int& res What archive_read_open returned, if the package was opened
+ * @param [in] unsigned int verbosity
+ *
+ * @returns bool wasTheArchiveOpened. If false, a is untouched, and should be opened as usual
+ */
+bool openParallelDecompression(struct archive* a, std::string archivePath, int& res, unsigned int verbosity) {/*{{{*/
+    unsigned int threads = decompressThreads();
+    if(threads < 2) {
+        return false;
+    }
+
+    int fd = open(archivePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        return false;
+    }
+
+    int type = detectCompression(fd);
+    close(fd);
+
+    if(type != COMPRESSION_ZSTD && type != COMPRESSION_XZ) {
+        return false;
+    }
+
+    ParallelDecoder* decoder = new ParallelDecoder(archivePath, type, threads, verbosity);
+    if(!decoder->open()) {
+        delete decoder;
+        return false;
+    }
+
+    // From here on, libarchive calls closeCallback, even if it fails to open
+    res = archive_read_open(a, decoder, NULL, readCallback, closeCallback);
+    return true;
+}/*}}}*/
+
+/**
+ * @param [in] std::string path
+ * @param [in] int type COMPRESSION_ZSTD or COMPRESSION_XZ
+ * @param [in] unsigned int threads
+ * @param [in] unsigned int verbosity
+ */
+ParallelDecoder::ParallelDecoder(std::string path, int type, unsigned int threads, unsigned int verbosity) {/*{{{*/
+    this->path = path;
+    this->type = type;
+    this->threads = (threads < 1) ? 1 : threads;
+    this->verbosity = verbosity;
+}/*}}}*/
+
+ParallelDecoder::~ParallelDecoder() {/*{{{*/
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+
+    windowMoved.notify_all();
+
+    for(std::thread& t : workers) {
+        t.join();
+    }
+
+#ifdef WITH_LZMA_MT
+    if(xzStarted) {
+        lzma_end(&xz);
+    }
+#endif /* WITH_LZMA_MT */
+
+    if(map != NULL) {
+        munmap((void*)map, mapSize);
+    }
+}/*}}}*/
+
+/**
+ * @returns const std::string& What went wrong, once read has failed
+ */
+const std::string& ParallelDecoder::getError() {/*{{{*/
+    return error;
+}/*}}}*/
+
+/**
+ * Maps the package and gets ready to decode it
+ *
+ * @returns bool canThisPackageBeDecodedInParallel
+ */
+bool ParallelDecoder::open() {/*{{{*/
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    void* m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(m == MAP_FAILED) {
+        return false;
+    }
+
+    map = (const unsigned char*)m;
+    mapSize = st.st_size;
+
+    if(type == COMPRESSION_ZSTD) {
+        return openZstd();
+    }
+
+    return openXz();
+}/*}}}*/
+
+/**
+ * Splits a zstd package into its frames, and starts a thread per frame, up to the thread limit
+ *
+ * @returns bool wereThereEnoughFramesToSplitUp
+ */
+bool ParallelDecoder::openZstd() {/*{{{*/
+#ifdef WITH_ZSTD
+    size_t offset = 0;
+    while(offset < mapSize) {
+        size_t length = ZSTD_findFrameCompressedSize(map + offset, mapSize - offset);
+        if(ZSTD_isError(length)) {
+            return false;
+        }
+
+        // Each frame is decoded in one go, so its size has to be known up front, and reasonable
+        unsigned long long contentSize = ZSTD_getFrameContentSize(map + offset, length);
+        if(contentSize == ZSTD_CONTENTSIZE_UNKNOWN || contentSize == ZSTD_CONTENTSIZE_ERROR || contentSize > ZSTD_MAX_PARALLEL_FRAME) {
+            if(verbosity >= 4) {
+                printf("The zstd frames of %s don't all record a size below %d bytes. Leaving it to libarchive.\n",path.c_str(),ZSTD_MAX_PARALLEL_FRAME);
+            }
+
+            return false;
+        }
+
+        frame_s frame;
+        frame.offset = offset;
+        frame.length = length;
+        frame.contentSize = contentSize;
+        frames.push_back(std::move(frame));
+
+        offset += length;
+    }
+
+    if(frames.size() < 2) {
+        if(verbosity >= 4) {
+            printf("%s is a single zstd frame, which can only be decompressed by one thread\n",path.c_str());
+        }
+
+        return false;
+    }
+
+    unsigned int n = (frames.size() < threads) ? frames.size() : threads;
+    for(unsigned int index = 0; index < n; index++) {
+        workers.emplace_back(&ParallelDecoder::zstdWorker, this);
+    }
+
+    if(verbosity >= 3) {
+        printf("Decompressing the %lu zstd frames of %s on %u threads\n",frames.size(),path.c_str(),n);
+    }
+
+    return true;
+#else
+    return false;
+#endif /* WITH_ZSTD */
+}/*}}}*/
+
+/**
+ * Starts liblzma's threaded decoder over the whole package
+ *
+ * @returns bool wasTheDecoderStarted
+ */
+bool ParallelDecoder::openXz() {/*{{{*/
+#ifdef WITH_LZMA_MT
+    lzma_mt mt;
+    memset(&mt, 0, sizeof(mt));
+    mt.flags = LZMA_CONCATENATED;
+    mt.threads = threads;
+
+    // Past this, liblzma decodes on a single thread rather than use more memory. It never refuses to decode
+    uint64_t physmem = lzma_physmem();
+    mt.memlimit_threading = (physmem != 0) ? physmem / 4 : UINT64_MAX;
+    mt.memlimit_stop = UINT64_MAX;
+
+    if(lzma_stream_decoder_mt(&xz, &mt) != LZMA_OK) {
+        return false;
+    }
+
+    xzStarted = true;
+    xz.next_in = map;
+    xz.avail_in = mapSize;
+    xzOut.resize(XZ_OUTPUT_BUFFER_SIZE);
+
+    if(verbosity >= 3) {
+        printf("Decompressing %s with up to %u threads\n",path.c_str(),threads);
+    }
+
+    return true;
+#else
+    return false;
+#endif /* WITH_LZMA_MT */
+}/*}}}*/
+
+/**
+ * The loop each zstd decoding thread runs. Frames are claimed in order, but no further ahead of the reader than one per thread
+ */
+void ParallelDecoder::zstdWorker() {/*{{{*/
+#ifdef WITH_ZSTD
+    ZSTD_DCtx* dctx = ZSTD_createDCtx();
+    std::unique_lock<std::mutex> guard(lock);
+
+    while(true) {
+        windowMoved.wait(guard, [this] { return stopping || nextToDecode >= frames.size() || nextToDecode < nextToRead + threads; });
+        if(stopping || nextToDecode >= frames.size()) {
+            break;
+        }
+
+        // frames is never resized once the workers are running, so this stays valid
+        frame_s& frame = frames[nextToDecode++];
+        guard.unlock();
+
+        std::vector<char> data(frame.contentSize);
+        bool decoded = (dctx != NULL);
+
+        if(decoded) {
+            size_t r = ZSTD_decompressDCtx(dctx, data.data(), data.size(), map + frame.offset, frame.length);
+            decoded = !ZSTD_isError(r) && r == frame.contentSize;
+        }
+
+        guard.lock();
+        frame.data.swap(data);
+        frame.failed = !decoded;
+        frame.ready = true;
+        frameReady.notify_all();
+    }
+
+    guard.unlock();
+    ZSTD_freeDCtx(dctx);
+#endif /* WITH_ZSTD */
+}/*}}}*/
+
+/**
+ * Hands libarchive the next block of decompressed data. It stays valid until the next call
+ *
+ * @param [out] const void** buf
+ *
+ * @returns la_ssize_t The size of the block, 0 at the end of the package, or ARCHIVE_FATAL
+ */
+la_ssize_t ParallelDecoder::read(const void** buf) {/*{{{*/
+    if(type == COMPRESSION_ZSTD) {
+        return readZstd(buf);
+    }
+
+    return readXz(buf);
+}/*}}}*/
+
+/**
+ * Waits for the next zstd frame in order, and hands it over whole
+ */
+la_ssize_t ParallelDecoder::readZstd(const void** buf) {/*{{{*/
+    std::unique_lock<std::mutex> guard(lock);
+
+    while(true) {
+        // libarchive is done with the frame we handed it last time
+        if(nextToRead > 0) {
+            std::vector<char>().swap(frames[nextToRead - 1].data);
+        }
+
+        if(nextToRead >= frames.size()) {
+            return 0;
+        }
+
+        frame_s& frame = frames[nextToRead];
+        frameReady.wait(guard, [&frame] { return frame.ready; });
+
+        if(frame.failed) {
+            error = "Could not decompress zstd frame " + std::to_string(nextToRead) + " of " + path;
+            return ARCHIVE_FATAL;
+        }
+
+        nextToRead++;
+        windowMoved.notify_all();
+
+        // Skippable frames decode to nothing, and handing back 0 would end the archive
+        if(!frame.data.empty()) {
+            *buf = frame.data.data();
+            return frame.data.size();
+        }
+    }
+}/*}}}*/
+
+/**
+ * Fills the output buffer from liblzma's threaded decoder
+ */
+la_ssize_t ParallelDecoder::readXz(const void** buf) {/*{{{*/
+#ifdef WITH_LZMA_MT
+    if(xzDone) {
+        return 0;
+    }
+
+    xz.next_out = xzOut.data();
+    xz.avail_out = xzOut.size();
+
+    // The whole package was given as input up front, so we can ask for the end right away
+    while(xz.avail_out > 0) {
+        lzma_ret ret = lzma_code(&xz, LZMA_FINISH);
+        if(ret == LZMA_STREAM_END) {
+            xzDone = true;
+            break;
+        }
+
+        if(ret != LZMA_OK) {
+            error = "Could not decompress " + path + " (liblzma error " + std::to_string((int)ret) + ")";
+            return ARCHIVE_FATAL;
+        }
+    }
+
+    *buf = xzOut.data();
+    return xzOut.size() - xz.avail_out;
+#else
+    error = "xz support was not compiled in";
+    return ARCHIVE_FATAL;
+#endif /* WITH_LZMA_MT */
+}/*}}}*/
@@ -0,0 +1,223 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file DirCache.cpp
+ * @error -1400
+ *
+ * The cache of open directories used by the extraction engine. See DirCache.h.
+ */
+
+#include "DirCache.h"
+
+/**
+ * Turns a member path into the form the cache uses: Relative to the root, with no empty or "." components, and no trailing slash
+ * ".." is left alone. Callers must have already rejected it with isSafeMemberPath
+ *
+ * @param [in] const std::string& path
+ *
+ * @returns std::string canonicalPath, empty for the root itself
+ */
+std::string canonicalMemberPath(const std::string& path) {/*{{{*/
+    std::string out;
+    size_t start = 0;
+
+    while(start < path.size()) {
+        size_t end = path.find('/', start);
+        if(end == std::string::npos) {
+            end = path.size();
+        }
+
+        size_t len = end - start;
+        if(len != 0 && !(len == 1 && path[start] == '.')) {
+            if(!out.empty()) {
+                out.push_back('/');
+            }
+
+            out.append(path, start, len);
+        }
+
+        start = end + 1;
+    }
+
+    return out;
+}/*}}}*/
+
+/**
+ * Opens the system root, which every other directory is found from
+ *
+ * @param [in] std::string root
+ * @param [in] unsigned int verbosity
+ * @param [in] size_t capacity The most directories to keep open, besides the root
+ */
+DirFdCache::DirFdCache(std::string root, unsigned int verbosity, size_t capacity) {/*{{{*/
+    this->verbosity = verbosity;
+    this->capacity = (capacity < 2) ? 2 : capacity;
+
+    rootFd = open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(rootFd < 0 && verbosity != 0) {
+        fprintf(stderr,"Error: Could not open the system root %s. %s\n",root.c_str(),strerror(errno));
+    }
+}/*}}}*/
+
+DirFdCache::~DirFdCache() {/*{{{*/
+    for(auto& it : dirs) {
+        close(it.second.fd);
+    }
+
+    if(rootFd >= 0) {
+        close(rootFd);
+    }
+}/*}}}*/
+
+/**
+ * @returns bool wasTheRootOpened
+ */
+bool DirFdCache::isOpen() {/*{{{*/
+    return rootFd >= 0;
+}/*}}}*/
+
+/**
+ * @returns int rootFd
+ */
+int DirFdCache::getRootFd() {/*{{{*/
+    return rootFd;
+}/*}}}*/
+
+/**
+ * @returns unsigned long The number of lookups answered by an already open directory
+ */
+unsigned long DirFdCache::getHits() {/*{{{*/
+    return hits;
+}/*}}}*/
+
+/**
+ * @returns unsigned long The number of lookups which had to open a directory
+ */
+unsigned long DirFdCache::getMisses() {/*{{{*/
+    return misses;
+}/*}}}*/
+
+/**
+ * Opens an existing directory with a single lookup from the root
+ *
+ * @param [in] const std::string& dir A canonical path
+ *
+ * @returns int fd, or -1 with errno set
+ */
+int DirFdCache::openFromRoot(const std::string& dir) {/*{{{*/
+#ifdef HAVE_LINUX_OPENAT2_H
+    if(useOpenat2) {
+        struct open_how how;
+        memset(&how, 0, sizeof(how));
+        how.flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+        how.resolve = RESOLVE_IN_ROOT | RESOLVE_NO_MAGICLINKS;
+
+        int fd = syscall(SYS_openat2, rootFd, dir.c_str(), &how, sizeof(how));
+        if(fd >= 0 || errno != ENOSYS) {
+            return fd;
+        }
+
+        // Older kernels. Don't bother asking again
+        useOpenat2 = false;
+
+        if(verbosity >= 4) {
+            printf("openat2 is not supported by this kernel. Falling back to openat\n");
+        }
+    }
+#endif /* HAVE_LINUX_OPENAT2_H */
+
+    return openat(rootFd, dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}/*}}}*/
+
+/**
+ * Adds an open directory to the cache, closing the least recently used one if the cache is full
+ *
+ * @param [in] const std::string& dir
+ * @param [in] int fd
+ */
+void DirFdCache::insert(const std::string& dir, int fd) {/*{{{*/
+    if(dirs.size() >= capacity) {
+        auto victim = dirs.find(lru.back());
+        close(victim->second.fd);
+        dirs.erase(victim);
+        lru.pop_back();
+    }
+
+    lru.push_front(dir);
+    dirs[dir] = dirEntry_s{ fd, lru.begin() };
+}/*}}}*/
+
+/**
+ * Finds the fd of a directory below the root, opening it, and if asked to, creating it and its missing parents
+ *
+ * The fd belongs to the cache. It stays valid until the next call which may open another directory, so callers needing two at once must dup the first.
+ *
+ * @param [in] const std::string& dir A canonical path, as returned by canonicalMemberPath. The empty path is the root
+ * @param [in] bool create
+ *
+ * @returns int fd, or -1 with errno set
+ */
+int DirFdCache::dirFd(const std::string& dir, bool create) {/*{{{*/
+    if(dir.empty()) {
+        return rootFd;
+    }
+
+    auto it = dirs.find(dir);
+    if(it != dirs.end()) {
+        hits++;
+        lru.splice(lru.begin(), lru, it->second.lruPos);
+        return it->second.fd;
+    }
+
+    misses++;
+
+    int fd = openFromRoot(dir);
+    if(fd < 0 && errno == ENOENT && create) {
+        size_t slash = dir.rfind('/');
+        std::string parent = (slash == std::string::npos) ? std::string() : dir.substr(0, slash);
+        std::string leaf = (slash == std::string::npos) ? dir : dir.substr(slash + 1);
+
+        int parentDirFd = dirFd(parent, true);
+        if(parentDirFd < 0) {
+            return -1;
+        }
+
+        // libarchive and create_directories leave the mode to the umask, so we do too
+        if(mkdirat(parentDirFd, leaf.c_str(), 0777) == 0) {
+            fd = openat(parentDirFd, leaf.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW);
+        }
+
+        // Someone else made it in the meantime
+        else if(errno == EEXIST) {
+            fd = openFromRoot(dir);
+        }
+    }
+
+    if(fd < 0) {
+        return -1;
+    }
+
+    insert(dir, fd);
+    return fd;
+}/*}}}*/
+
+/**
+ * Finds the fd of the directory containing path, along with the name of path within it
+ *
+ * @param [in] const std::string& path A canonical, non-empty path
+ * @param [out] std::string& leaf
+ * @param [in] bool create Whether or not to create missing parent directories
+ *
+ * @returns int fd, or -1 with errno set. See dirFd for how long it stays valid
+ */
+int DirFdCache::parentFd(const std::string& path, std::string& leaf, bool create) {/*{{{*/
+    size_t slash = path.rfind('/');
+    if(slash == std::string::npos) {
+        leaf = path;
+        return rootFd;
+    }
+
+    leaf = path.substr(slash + 1);
+    return dirFd(path.substr(0, slash), create);
+}/*}}}*/
@@ -0,0 +1,336 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Durability.cpp
+ * @error -2200
+ *
+ * Controls when installed files reach the disk. See the durability option, and WritebackTracker in Durability.h.
+ * sync_file_range only starts writeback of a file's data, and never waits on it or touches its metadata, so it's only ever used to get the disk going early. Whatever we promise is kept by the fsync or syncfs that follows.
+ */
+
+#include "Durability.h"
+
+/**
+ * @returns double The seconds between start and now
+ */
+static double secondsSince(const struct timespec& start) {/*{{{*/
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}/*}}}*/
+
+/**
+ * Opens the root the files are extracted into
+ *
+ * @param [in] std::string root
+ * @param [in] unsigned int mode One of DURABILITY_PACKAGE or DURABILITY_FILE
+ * @param [in] unsigned int verbosity
+ */
+WritebackTracker::WritebackTracker(std::string root, unsigned int mode, unsigned int verbosity) {/*{{{*/
+    this->mode = mode;
+    this->verbosity = verbosity;
+
+    rootFd = open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(rootFd < 0 && verbosity != 0) {
+        fprintf(stderr,"Error: Could not open the system root %s. %s\n",root.c_str(),strerror(errno));
+    }
+}/*}}}*/
+
+/**
+ * Closes anything finish() wasn't called for, without waiting on it
+ */
+WritebackTracker::~WritebackTracker() {/*{{{*/
+    for(auto& p : pending) {
+        close(p.first);
+    }
+
+    if(rootFd >= 0) {
+        close(rootFd);
+    }
+}/*}}}*/
+
+/**
+ * @returns bool wasTheRootOpened
+ */
+bool WritebackTracker::isOpen() {/*{{{*/
+    return rootFd >= 0;
+}/*}}}*/
+
+/**
+ * Remembers the directory an entry was created in, and each one above it, since creating a directory adds an entry to its parent too
+ * Must be called with the lock held
+ *
+ * @param [in] const std::string& rel A canonical path
+ */
+void WritebackTracker::addParents(const std::string& rel) {/*{{{*/
+    std::string dir = rel;
+
+    while(true) {
+        size_t slash = dir.rfind('/');
+        dir = (slash == std::string::npos) ? "" : dir.substr(0, slash);
+
+        // Its parents were added along with it
+        if(!dirs.insert(dir).second || dir.empty()) {
+            return;
+        }
+    }
+}/*}}}*/
+
+/**
+ * Waits for a file to reach the disk, then closes it
+ * Must be called without the lock held
+ *
+ * @param [in] int fd
+ * @param [in] const std::string& rel
+ */
+void WritebackTracker::syncFile(int fd, const std::string& rel) {/*{{{*/
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int res = fsync(fd);
+    int err = errno;
+    close(fd);
+
+    double elapsed = secondsSince(start);
+
+    std::lock_guard<std::mutex> guard(lock);
+    seconds += elapsed;
+
+    if(res != 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not write %s to the disk. %s\n",rel.c_str(),strerror(err));
+        }
+
+        if(error == 0) {
+            error = DURABILITY_SYNC_ERROR;
+        }
+
+        return;
+    }
+
+    filesSynced++;
+}/*}}}*/
+
+/**
+ * Takes over a file which was just written in full, and starts writing its data back
+ * The file is closed by the time finish() returns, or right away, depending on the mode
+ *
+ * @param [in] int fd
+ * @param [in] const std::string& rel Its canonical path under the root
+ */
+void WritebackTracker::fileWritten(int fd, const std::string& rel) {/*{{{*/
+    // Only a hint. A filesystem without it just writes the data back later
+    sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+
+    if(mode != DURABILITY_FILE) {
+        close(fd);
+        return;
+    }
+
+    std::pair<int, std::string> oldest(-1, "");
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        addParents(rel);
+        pending.push_back(std::pair<int, std::string>(fd, rel));
+
+        if(pending.size() > DURABILITY_FILE_WINDOW) {
+            oldest = std::move(pending.front());
+            pending.pop_front();
+        }
+    }
+
+    // The oldest file had the longest to be written back, so this rarely waits long
+    if(oldest.first >= 0) {
+        syncFile(oldest.first, oldest.second);
+    }
+}/*}}}*/
+
+/**
+ * Notes an entry which isn't handed over as a file: A directory, a link, or anything libarchive restored itself
+ * Only its directory entry needs to be made durable
+ *
+ * @param [in] const std::string& rel Its canonical path under the root
+ */
+void WritebackTracker::entryCreated(const std::string& rel) {/*{{{*/
+    if(mode != DURABILITY_FILE) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    addParents(rel);
+}/*}}}*/
+
+/**
+ * Notes an entry libarchive restored by itself, and so never handed over
+ * A regular file is reopened to be handed over. Its data is still in the page cache, so this costs a lookup
+ *
+ * @param [in] const std::string& path Its full path
+ * @param [in] const std::string& rel Its canonical path under the root
+ * @param [in] bool isFile
+ */
+void WritebackTracker::pathRestored(const std::string& path, const std::string& rel, bool isFile) {/*{{{*/
+    int fd = isFile ? open(path.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC) : -1;
+    if(fd >= 0) {
+        fileWritten(fd, rel);
+        return;
+    }
+
+    // Whatever can't be reopened is left to the directory syncs
+    entryCreated(rel);
+}/*}}}*/
+
+/**
+ * Waits until everything handed over has reached the disk
+ * Every writer must be done by the time this is called
+ *
+ * @returns int 0 on success, or a negative error code
+ */
+int WritebackTracker::finish() {/*{{{*/
+    if(rootFd < 0) {
+        return DURABILITY_ROOT_ERROR;
+    }
+
+    if(mode == DURABILITY_FILE) {
+        while(!pending.empty()) {
+            std::pair<int, std::string> p = std::move(pending.front());
+            pending.pop_front();
+            syncFile(p.first, p.second);
+        }
+
+        // Deepest first, so a directory is only synced once the entries below it are
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        for(auto it = dirs.rbegin(); it != dirs.rend() && error == 0; it++) {
+            int fd = it->empty() ? dup(rootFd) : openat(rootFd, it->c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if(fd < 0 || fsync(fd) != 0) {
+                if(verbosity != 0) {
+                    fprintf(stderr,"Error: Could not write the directory %s to the disk. %s\n",it->empty() ? "/" : it->c_str(),strerror(errno));
+                }
+
+                error = DURABILITY_SYNC_ERROR;
+            }
+
+            if(fd >= 0) {
+                close(fd);
+            }
+        }
+
+        seconds += secondsSince(start);
+        dirs.clear();
+    }
+
+    else {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        if(syncfs(rootFd) != 0) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Could not write the package to the disk. %s\n",strerror(errno));
+            }
+
+            error = DURABILITY_SYNC_ERROR;
+        }
+
+        seconds += secondsSince(start);
+    }
+
+    return error;
+}/*}}}*/
+
+/**
+ * @returns unsigned long The number of files fsync'd one at a time. Always 0 in package mode
+ */
+unsigned long WritebackTracker::getFilesSynced() {/*{{{*/
+    std::lock_guard<std::mutex> guard(lock);
+    return filesSynced;
+}/*}}}*/
+
+/**
+ * @returns double The seconds spent waiting for the disk, summed over every thread which waited
+ */
+double WritebackTracker::getSeconds() {/*{{{*/
+    std::lock_guard<std::mutex> guard(lock);
+    return seconds;
+}/*}}}*/
+
+/**
+ * Closes a file which was just written in full, or hands it to durability if there is one
+ *
+ * @param [in] WritebackTracker* durability May be NULL
+ * @param [in] int fd
+ * @param [in] const std::string& rel Its canonical path under the root
+ */
+void closeWritten(WritebackTracker* durability, int fd, const std::string& rel) {/*{{{*/
+    if(durability == NULL) {
+        close(fd);
+        return;
+    }
+
+    durability->fileWritten(fd, rel);
+}/*}}}*/
+
+/**
+ * Writes everything on the filesystem holding path to the disk
+ * This is the whole of the transaction mode, and the barrier after a staged package was moved into place
+ *
+ * @param [in] std::string path
+ * @param [in] unsigned int verbosity
+ * @param [out] double* seconds If not NULL, how long it took
+ *
+ * @returns int 0 on success, or a negative error code
+ */
+int syncRoot(std::string path, unsigned int verbosity, double* seconds) {/*{{{*/
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(fd < 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not open %s. %s\n",path.c_str(),strerror(errno));
+        }
+
+        return DURABILITY_ROOT_ERROR;
+    }
+
+    int res = syncfs(fd);
+    int err = errno;
+    close(fd);
+
+    if(seconds != NULL) {
+        *seconds = secondsSince(start);
+    }
+
+    if(res != 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not write %s to the disk. %s\n",path.c_str(),strerror(err));
+        }
+
+        return DURABILITY_SYNC_ERROR;
+    }
+
+    return 0;
+}/*}}}*/
+
+/**
+ * @param [in] unsigned int durability One of the DURABILITY_* modes
+ *
+ * @returns std::string The name the durability option takes for it
+ */
+std::string durabilityName(unsigned int durability) {/*{{{*/
+    switch(durability) {
+        case DURABILITY_NONE:
+            return "none";
+        case DURABILITY_TRANSACTION:
+            return "transaction";
+        case DURABILITY_PACKAGE:
+            return "package";
+        case DURABILITY_FILE:
+            return "file";
+    }
+
+    return "unknown";
+}/*}}}*/
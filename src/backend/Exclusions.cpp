@@ -0,0 +1,559 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Exclusions.cpp
+ * @error -1800
+ *
+ * Compiling excludedFiles patterns, and matching archive paths against them. See Exclusions.h.
+ */
+
+#include "Exclusions.h"
+
+// A state of the NFA the glob patterns are built into, before it's turned into a DFA
+struct nfaState_s {
+    std::vector<std::pair<std::bitset<256>, uint32_t>> edges;
+    std::vector<uint32_t> epsilon;
+    bool accept = false;
+};
+
+/**
+ * Strips the leading ./ and / from a path, along with any trailing /
+ *
+ * @param [in/out] const char*& path
+ * @param [in/out] size_t& length
+ */
+static void trimPath(const char*& path, size_t& length) {/*{{{*/
+    while(length > 0) {
+        if(path[0] == '/') {
+            path++;
+            length--;
+        }
+
+        else if(length >= 2 && path[0] == '.' && path[1] == '/') {
+            path += 2;
+            length -= 2;
+        }
+
+        else {
+            break;
+        }
+    }
+
+    while(length > 0 && path[length - 1] == '/') {
+        length--;
+    }
+
+    // "." on its own is the root
+    if(length == 1 && path[0] == '.') {
+        length = 0;
+    }
+}/*}}}*/
+
+/**
+ * Splits a pattern into its path components, dropping empty and . components and merging runs of **
+ *
+ * @param [in] const std::string& pattern
+ *
+ * @returns std::vector<std::string> components
+ */
+static std::vector<std::string> splitPattern(const std::string& pattern) {/*{{{*/
+    std::vector<std::string> components;
+    size_t start = 0;
+
+    while(start <= pattern.size()) {
+        size_t end = pattern.find('/', start);
+        if(end == std::string::npos) {
+            end = pattern.size();
+        }
+
+        std::string c = pattern.substr(start, end - start);
+        if(!c.empty() && c != "." && !(c == "**" && !components.empty() && components.back() == "**")) {
+            components.push_back(c);
+        }
+
+        start = end + 1;
+    }
+
+    return components;
+}/*}}}*/
+
+/**
+ * @param [in] const std::string& component
+ *
+ * @returns bool Whether the component holds anything but literal characters
+ */
+static bool hasWildcard(const std::string& component) {/*{{{*/
+    return component.find_first_of("*?[\\") != std::string::npos;
+}/*}}}*/
+
+/**
+ * @param [in/out] std::vector<nfaState_s>& nfa
+ *
+ * @returns uint32_t The index of a new state
+ */
+static uint32_t newState(std::vector<nfaState_s>& nfa) {/*{{{*/
+    nfa.emplace_back();
+    return nfa.size() - 1;
+}/*}}}*/
+
+/**
+ * Adds an accepting state which takes any byte, over and over, reached from cur on the bytes in first
+ *
+ * @param [in/out] std::vector<nfaState_s>& nfa
+ * @param [in] uint32_t cur
+ * @param [in] const std::bitset<256>& first
+ */
+static void addAnythingAfter(std::vector<nfaState_s>& nfa, uint32_t cur, const std::bitset<256>& first) {/*{{{*/
+    std::bitset<256> any;
+    any.set();
+
+    uint32_t rest = newState(nfa);
+    nfa[rest].accept = true;
+    nfa[rest].edges.push_back(std::make_pair(any, rest));
+    nfa[cur].edges.push_back(std::make_pair(first, rest));
+}/*}}}*/
+
+/**
+ * Adds the states matching a single path component, other than **, starting from cur
+ * [...] which is never closed is taken literally, as fnmatch does
+ *
+ * @param [in/out] std::vector<nfaState_s>& nfa
+ * @param [in] uint32_t cur
+ * @param [in] const std::string& component
+ *
+ * @returns uint32_t The state reached once the component has been matched
+ */
+static uint32_t addComponent(std::vector<nfaState_s>& nfa, uint32_t cur, const std::string& component) {/*{{{*/
+    std::bitset<256> nonSlash;
+    nonSlash.set();
+    nonSlash.reset('/');
+
+    size_t n = component.size();
+    for(size_t i = 0; i < n; i++) {
+        unsigned char c = component[i];
+        std::bitset<256> set;
+
+        if(c == '*') {
+            uint32_t loop = newState(nfa);
+            nfa[cur].epsilon.push_back(loop);
+            nfa[loop].edges.push_back(std::make_pair(nonSlash, loop));
+            cur = loop;
+            continue;
+        }
+
+        if(c == '?') {
+            set = nonSlash;
+        }
+
+        else if(c == '[') {
+            size_t j = i + 1;
+            bool negate = (j < n && (component[j] == '!' || component[j] == '^'));
+            if(negate) {
+                j++;
+            }
+
+            std::bitset<256> members;
+            bool first = true;
+            while(j < n && (component[j] != ']' || first)) {
+                unsigned char lo = component[j];
+                if(j + 2 < n && component[j + 1] == '-' && component[j + 2] != ']') {
+                    for(unsigned int x = lo; x <= (unsigned char)component[j + 2]; x++) {
+                        members.set(x);
+                    }
+
+                    j += 3;
+                }
+
+                else {
+                    members.set(lo);
+                    j++;
+                }
+
+                first = false;
+            }
+
+            if(j < n) {
+                if(negate) {
+                    members.flip();
+                }
+
+                members.reset('/');
+                set = members;
+                i = j;
+            }
+
+            else {
+                set.set('[');
+            }
+        }
+
+        else if(c == '\\' && i + 1 < n) {
+            set.set((unsigned char)component[++i]);
+        }
+
+        else {
+            set.set(c);
+        }
+
+        uint32_t next = newState(nfa);
+        nfa[cur].edges.push_back(std::make_pair(set, next));
+        cur = next;
+    }
+
+    return cur;
+}/*}}}*/
+
+/**
+ * Adds a glob pattern to the NFA, reachable from its start state
+ *
+ * @param [in/out] std::vector<nfaState_s>& nfa
+ * @param [in] const std::vector<std::string>& components
+ */
+static void addGlob(std::vector<nfaState_s>& nfa, const std::vector<std::string>& components) {/*{{{*/
+    std::bitset<256> slash;
+    slash.set('/');
+
+    std::bitset<256> nonSlash;
+    nonSlash.set();
+    nonSlash.reset('/');
+
+    uint32_t cur = newState(nfa);
+    nfa[0].epsilon.push_back(cur);
+
+    bool needSlash = false;
+    for(size_t index = 0; index < components.size(); index++) {
+        if(needSlash) {
+            uint32_t next = newState(nfa);
+            nfa[cur].edges.push_back(std::make_pair(slash, next));
+            cur = next;
+        }
+
+        if(components[index] != "**") {
+            cur = addComponent(nfa, cur, components[index]);
+            needSlash = true;
+            continue;
+        }
+
+        // A trailing ** is anything below the components before it
+        if(index + 1 == components.size()) {
+            std::bitset<256> any;
+            any.set();
+            addAnythingAfter(nfa, cur, any);
+            return;
+        }
+
+        // Anywhere else, it's any number of whole components, each followed by a /
+        uint32_t inComponent = newState(nfa);
+        nfa[cur].edges.push_back(std::make_pair(nonSlash, inComponent));
+        nfa[inComponent].edges.push_back(std::make_pair(nonSlash, inComponent));
+        nfa[inComponent].edges.push_back(std::make_pair(slash, cur));
+        needSlash = false;
+    }
+
+    // Whatever matches is excluded along with everything below it
+    nfa[cur].accept = true;
+    addAnythingAfter(nfa, cur, slash);
+}/*}}}*/
+
+/**
+ * Expands a set of NFA states to everything reachable from them without consuming a byte
+ *
+ * @param [in] const std::vector<nfaState_s>& nfa
+ * @param [in/out] std::vector<uint32_t>& states Sorted on return
+ */
+static void epsilonClosure(const std::vector<nfaState_s>& nfa, std::vector<uint32_t>& states) {/*{{{*/
+    std::set<uint32_t> seen(states.begin(), states.end());
+    std::vector<uint32_t> stack(states.begin(), states.end());
+
+    while(!stack.empty()) {
+        uint32_t s = stack.back();
+        stack.pop_back();
+
+        for(uint32_t next : nfa[s].epsilon) {
+            if(seen.insert(next).second) {
+                stack.push_back(next);
+            }
+        }
+    }
+
+    states.assign(seen.begin(), seen.end());
+}/*}}}*/
+
+/**
+ * Compiles a set of patterns
+ * Invalid patterns are reported, and leave the matcher invalid. See isValid
+ *
+ * @param [in] const std::set<std::string>& patterns
+ * @param [in] unsigned int verbosity
+ */
+ExclusionMatcher::ExclusionMatcher(const std::set<std::string>& patterns, unsigned int verbosity) {/*{{{*/
+    trie.emplace_back();
+
+    std::vector<std::string> globs;
+    for(const std::string& pattern : patterns) {
+        std::vector<std::string> components = splitPattern(pattern);
+        if(components.empty()) {
+            continue;
+        }
+
+        bool literal = true;
+        for(size_t index = 0; index < components.size() && literal; index++) {
+            literal = !hasWildcard(components[index]) || (components[index] == "**" && index + 1 == components.size() && index > 0);
+        }
+
+        if(!literal) {
+            globs.push_back(pattern);
+            continue;
+        }
+
+        bool belowOnly = (components.back() == "**");
+        if(belowOnly) {
+            components.pop_back();
+        }
+
+        std::string prefix;
+        for(const std::string& c : components) {
+            prefix += (prefix.empty() ? "" : "/") + c;
+        }
+
+        addPrefix(prefix, belowOnly);
+    }
+
+    if(!globs.empty()) {
+        valid = compileGlobs(globs, verbosity);
+    }
+}/*}}}*/
+
+/**
+ * Adds a pattern without wildcards to the trie
+ *
+ * @param [in] const std::string& prefix
+ * @param [in] bool belowOnly If true, only the paths below prefix match, not prefix itself
+ */
+void ExclusionMatcher::addPrefix(const std::string& prefix, bool belowOnly) {/*{{{*/
+    uint32_t node = 0;
+
+    for(char c : prefix) {
+        uint32_t next = 0;
+        for(const auto& child : trie[node].children) {
+            if(child.first == c) {
+                next = child.second;
+                break;
+            }
+        }
+
+        if(next == 0) {
+            trie.emplace_back();
+            next = trie.size() - 1;
+            trie[node].children.push_back(std::make_pair(c, next));
+        }
+
+        node = next;
+    }
+
+    if(belowOnly) {
+        trie[node].below = true;
+    }
+
+    else {
+        trie[node].exact = true;
+    }
+}/*}}}*/
+
+/**
+ * Builds an NFA from the glob patterns, and turns it into a DFA over classes of bytes which no pattern tells apart
+ *
+ * @param [in] const std::vector<std::string>& globs
+ * @param [in] unsigned int verbosity
+ *
+ * @returns bool success. False if the DFA would need more than EXCLUSION_MAX_DFA_STATES states
+ */
+bool ExclusionMatcher::compileGlobs(const std::vector<std::string>& globs, unsigned int verbosity) {/*{{{*/
+    std::vector<nfaState_s> nfa(1);
+    for(const std::string& glob : globs) {
+        addGlob(nfa, splitPattern(glob));
+    }
+
+    // Bytes which every edge treats the same way share a class, which keeps the transition table small
+    std::set<std::string> edgeSets;
+    for(const nfaState_s& s : nfa) {
+        for(const auto& e : s.edges) {
+            edgeSets.insert(e.first.to_string());
+        }
+    }
+
+    std::map<std::string, uint32_t> signatures;
+    std::vector<unsigned char> representative;
+    for(unsigned int b = 0; b < 256; b++) {
+        std::string signature;
+        for(const std::string& set : edgeSets) {
+            // to_string puts bit 0 last
+            signature += set[255 - b];
+        }
+
+        auto it = signatures.find(signature);
+        if(it == signatures.end()) {
+            it = signatures.insert(std::make_pair(signature, (uint32_t)representative.size())).first;
+            representative.push_back(b);
+        }
+
+        byteClass[b] = it->second;
+    }
+
+    classCount = representative.size();
+
+    // The subset construction. The empty set is the dead state
+    std::map<std::vector<uint32_t>, uint32_t> dfaStates;
+    std::vector<std::vector<uint32_t>> pending;
+
+    std::vector<uint32_t> dead;
+    std::vector<uint32_t> start(1, 0);
+    epsilonClosure(nfa, start);
+
+    for(std::vector<uint32_t>* s : { &dead, &start }) {
+        dfaStates[*s] = pending.size();
+        pending.push_back(*s);
+    }
+
+    transitions.clear();
+    accepting.clear();
+
+    for(size_t index = 0; index < pending.size(); index++) {
+        std::vector<uint32_t> current = pending[index];
+
+        bool accept = false;
+        for(uint32_t s : current) {
+            accept = accept || nfa[s].accept;
+        }
+
+        accepting.push_back(accept);
+
+        for(uint32_t k = 0; k < classCount; k++) {
+            std::vector<uint32_t> next;
+            for(uint32_t s : current) {
+                for(const auto& e : nfa[s].edges) {
+                    if(e.first.test(representative[k])) {
+                        next.push_back(e.second);
+                    }
+                }
+            }
+
+            epsilonClosure(nfa, next);
+
+            auto it = dfaStates.find(next);
+            if(it == dfaStates.end()) {
+                if(pending.size() >= EXCLUSION_MAX_DFA_STATES) {
+                    if(verbosity != 0) {
+                        fprintf(stderr,"Error: The excluded file patterns are too complex to compile. Try using fewer wildcards.\n");
+                    }
+
+                    return false;
+                }
+
+                it = dfaStates.insert(std::make_pair(next, (uint32_t)pending.size())).first;
+                pending.push_back(next);
+            }
+
+            transitions.push_back(it->second);
+        }
+    }
+
+    hasGlobs = true;
+
+    if(verbosity >= 4) {
+        printf("Compiled %lu excluded file patterns into %lu states over %u byte classes\n",globs.size(),pending.size(),classCount);
+    }
+
+    return true;
+}/*}}}*/
+
+/**
+ * @returns bool Whether every pattern compiled. An invalid matcher matches nothing
+ */
+bool ExclusionMatcher::isValid() const {/*{{{*/
+    return valid;
+}/*}}}*/
+
+/**
+ * Checks whether a path from an archive, or a manifest, is excluded
+ *
+ * @param [in] const char* path Relative to the system root, as stored in the archive
+ * @param [in] size_t length
+ *
+ * @returns bool isExcluded
+ */
+bool ExclusionMatcher::matches(const char* path, size_t length) const {/*{{{*/
+    trimPath(path, length);
+    if(length == 0) {
+        return false;
+    }
+
+    return matchesTrie(path, length) || (hasGlobs && valid && matchesDfa(path, length));
+}/*}}}*/
+
+/**
+ * @param [in] const char* path
+ *
+ * @returns bool isExcluded
+ */
+bool ExclusionMatcher::matches(const char* path) const {/*{{{*/
+    return path != NULL && matches(path, strlen(path));
+}/*}}}*/
+
+/**
+ * @param [in] const std::string& path
+ *
+ * @returns bool isExcluded
+ */
+bool ExclusionMatcher::matches(const std::string& path) const {/*{{{*/
+    return matches(path.data(), path.size());
+}/*}}}*/
+
+/**
+ * @param [in] const char* path Already trimmed
+ * @param [in] size_t length
+ *
+ * @returns bool Whether a pattern without wildcards matches the path, or one of its parents
+ */
+bool ExclusionMatcher::matchesTrie(const char* path, size_t length) const {/*{{{*/
+    uint32_t node = 0;
+
+    for(size_t i = 0; i < length; i++) {
+        if(path[i] == '/' && i > 0 && (trie[node].exact || trie[node].below)) {
+            return true;
+        }
+
+        uint32_t next = 0;
+        for(const auto& child : trie[node].children) {
+            if(child.first == path[i]) {
+                next = child.second;
+                break;
+            }
+        }
+
+        if(next == 0) {
+            return false;
+        }
+
+        node = next;
+    }
+
+    return trie[node].exact;
+}/*}}}*/
+
+/**
+ * @param [in] const char* path Already trimmed
+ * @param [in] size_t length
+ *
+ * @returns bool Whether a glob pattern matches the path, or one of its parents
+ */
+bool ExclusionMatcher::matchesDfa(const char* path, size_t length) const {/*{{{*/
+    uint32_t state = 1;
+
+    for(size_t i = 0; i < length && state != 0; i++) {
+        state = transitions[state * classCount + byteClass[(unsigned char)path[i]]];
+    }
+
+    return accepting[state] != 0;
+}/*}}}*/
@@ -0,0 +1,841 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Extract.cpp
+ * @error -700
+ *
+ * The extraction engines.
+ * The zero-copy engine handles uncompressed tarballs. Because the data of each member sits contiguously inside the archive, we can hand the kernel a (file, offset, length) triple and let it move the bytes, instead of pulling them through libarchive's buffers and writing them back out.
+ * Anything the engine doesn't handle is reported back to the caller, which passes it to libarchive.
+ * The libarchive engine decodes everything else on a single thread, and hands the decoded files to a WriterPool.
+ */
+
+#include "Extract.h"
+
+/**
+ * Copies len bytes starting at srcOffset in srcFd to the current position of dstFd
+ *
+ * Tries copy_file_range first, which can avoid the copy entirely on filesystems supporting reflinks, and stays in the kernel otherwise.
+ * If the filesystems can't do that (EXDEV, EOPNOTSUPP on older kernels), we fall back to sendfile, and then to a plain pread/write loop.
+ *
+ * @param [in] int srcFd
+ * @param [in] off_t srcOffset
+ * @param [in] int dstFd
+ * @param [in] off_t len
+ *
+ * @returns ssize_t bytesCopied, or -1 with errno set
+ */
+ssize_t copyFileData(int srcFd, off_t srcOffset, int dstFd, off_t len) {/*{{{*/
+    off_t inOffset = srcOffset;
+    off_t copied = 0;
+    bool useCopyRange = true;
+    bool useSendfile = true;
+    char* buf = NULL;
+
+    while(copied < len) {
+        size_t chunk = ((len - copied) > ZERO_COPY_CHUNK) ? ZERO_COPY_CHUNK : (len - copied);
+        ssize_t r = -1;
+
+        if(useCopyRange) {
+            r = copy_file_range(srcFd, &inOffset, dstFd, NULL, chunk, 0);
+            if(r < 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+                useCopyRange = false;
+                continue;
+            }
+        }
+
+        else if(useSendfile) {
+            r = sendfile(dstFd, srcFd, &inOffset, chunk);
+            if(r < 0 && (errno == EINVAL || errno == ENOSYS)) {
+                useSendfile = false;
+                continue;
+            }
+        }
+
+        else {
+            if(buf == NULL) {
+                buf = (char*)malloc(COPY_BUFFER_SIZE);
+                if(buf == NULL) {
+                    return -1;
+                }
+            }
+
+            size_t toRead = (chunk > COPY_BUFFER_SIZE) ? COPY_BUFFER_SIZE : chunk;
+            r = pread(srcFd, buf, toRead, inOffset);
+
+            if(r > 0) {
+                ssize_t written = 0;
+                while(written < r) {
+                    ssize_t w = write(dstFd, buf + written, r - written);
+                    if(w < 0) {
+                        if(errno == EINTR) {
+                            continue;
+                        }
+
+                        free(buf);
+                        return -1;
+                    }
+
+                    written += w;
+                }
+
+                inOffset += r;
+            }
+        }
+
+        if(r < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+
+            free(buf);
+            return -1;
+        }
+
+        // The archive ended early. readTarMembers guards against this, but don't spin if it happens
+        if(r == 0) {
+            break;
+        }
+
+        copied += r;
+    }
+
+    free(buf);
+    return copied;
+}/*}}}*/
+
+/**
+ * Makes sure a member path can't escape the system root
+ * This is the same rule as libarchive's ARCHIVE_EXTRACT_SECURE_NODOTDOT; Absolute paths are fine, since they're prefixed with the root anyway
+ *
+ * @param [in] const std::string& path
+ *
+ * @returns bool isSafe
+ */
+bool isSafeMemberPath(const std::string& path) {/*{{{*/
+    if(path.empty()) {
+        return false;
+    }
+
+    size_t start = 0;
+    while(start <= path.size()) {
+        size_t end = path.find('/', start);
+        if(end == std::string::npos) {
+            end = path.size();
+        }
+
+        if(path.compare(start, end - start, "..") == 0 && end - start == 2) {
+            return false;
+        }
+
+        start = end + 1;
+    }
+
+    return true;
+}/*}}}*/
+
+/**
+ * Removes whatever is at leaf within dirFd, so the new member can be created in its place
+ * Matches libarchive's behavior of replacing files instead of writing through them, which keeps running binaries and hardlinked files safe
+ *
+ * @param [in] int dirFd
+ * @param [in] const std::string& leaf
+ *
+ * @returns bool pathIsClear
+ */
+bool clearPath(int dirFd, const std::string& leaf) {/*{{{*/
+    if(unlinkat(dirFd, leaf.c_str(), 0) == 0 || errno == ENOENT) {
+        return true;
+    }
+
+    return false;
+}/*}}}*/
+
+/**
+ * Creates a new, empty regular file at leaf within dirFd, replacing whatever was there
+ *
+ * @param [in] int dirFd
+ * @param [in] const std::string& leaf
+ *
+ * @returns int fd, open for writing, or -1 with errno set
+ */
+int createMemberFile(int dirFd, const std::string& leaf) {/*{{{*/
+    if(!clearPath(dirFd, leaf)) {
+        return -1;
+    }
+
+    return openat(dirFd, leaf.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC | O_NOFOLLOW, 0600);
+}/*}}}*/
+
+
+/**
+ * Creates a directory at leaf within dirFd, unless there already is one
+ *
+ * @param [in] int dirFd
+ * @param [in] const std::string& leaf
+ *
+ * @returns bool isThereADirectory, with errno set if not
+ */
+bool createDirectory(int dirFd, const std::string& leaf) {/*{{{*/
+    struct stat st;
+    if(mkdirat(dirFd, leaf.c_str(), 0777) == 0) {
+        return true;
+    }
+
+    return errno == EEXIST && fstatat(dirFd, leaf.c_str(), &st, 0) == 0 && S_ISDIR(st.st_mode);
+}/*}}}*/
+
+/**
+ * Creates a hard link at rel to another member of the archive, which must already have been extracted
+ *
+ * @param [in] DirFdCache& dirs
+ * @param [in] const std::string& rel The canonical path of the link
+ * @param [in] const std::string& linkTarget The archive path of the member it links to
+ * @param [in] const std::string& dest The full path of the link, for messages
+ * @param [in] const std::string& root
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 on success, or a negative error code
+ */
+int createHardLink(DirFdCache& dirs, const std::string& rel, const std::string& linkTarget, const std::string& dest, const std::string& root, unsigned int verbosity) {/*{{{*/
+    std::string target = root + "/" + linkTarget;
+    std::string targetRel = canonicalMemberPath(linkTarget);
+    std::string targetLeaf;
+    std::string leaf;
+    int targetDirFd = -1;
+
+    // Looking up our own parent again may close the target's parent, so hold on to a copy of it
+    if(isSafeMemberPath(linkTarget) && !targetRel.empty()) {
+        targetDirFd = dirs.parentFd(targetRel, targetLeaf, false);
+        targetDirFd = (targetDirFd >= 0) ? fcntl(targetDirFd, F_DUPFD_CLOEXEC, 0) : -1;
+    }
+
+    int dirFd = dirs.parentFd(rel, leaf, true);
+
+    if(targetDirFd < 0 || dirFd < 0 || !clearPath(dirFd, leaf) || linkat(targetDirFd, targetLeaf.c_str(), dirFd, leaf.c_str(), 0) != 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not create the hard link %s to %s. %s\n",dest.c_str(),target.c_str(),strerror(errno));
+        }
+
+        if(targetDirFd >= 0) {
+            close(targetDirFd);
+        }
+
+        return -703;
+    }
+
+    close(targetDirFd);
+    return 0;
+}/*}}}*/
+
+/**
+ * Applies the permissions of the extracted directories
+ * Deepest first, so we don't lock ourselves out of anything
+ *
+ * @param [in] DirFdCache& dirs
+ * @param [in] const std::vector<std::pair<std::string, mode_t>>& dirModes Canonical paths, in the order they were extracted
+ */
+void applyDirModes(DirFdCache& dirs, const std::vector<std::pair<std::string, mode_t>>& dirModes) {/*{{{*/
+    for(auto it = dirModes.rbegin(); it != dirModes.rend(); it++) {
+        if(it->first.empty()) {
+            fchmod(dirs.getRootFd(), it->second);
+            continue;
+        }
+
+        std::string leaf;
+        int dirFd = dirs.parentFd(it->first, leaf, false);
+        if(dirFd >= 0) {
+            fchmodat(dirFd, leaf.c_str(), it->second, 0);
+        }
+    }
+}/*}}}*/
+
+/**
+ * Applies the permissions of the directories extracted into a root
+ * For when the engine left them to us. See extractTarZeroCopy
+ *
+ * @param [in] std::string root
+ * @param [in] const std::vector<std::pair<std::string, mode_t>>& dirModes
+ * @param [in] unsigned int verbosity
+ */
+void applyDirModes(std::string root, const std::vector<std::pair<std::string, mode_t>>& dirModes, unsigned int verbosity) {/*{{{*/
+    if(dirModes.empty()) {
+        return;
+    }
+
+    DirFdCache dirs(root, verbosity);
+    if(dirs.isOpen()) {
+        applyDirModes(dirs, dirModes);
+    }
+}/*}}}*/
+
+/**
+ * Extracts the members of an uncompressed tarball into root, copying file data with copy_file_range/sendfile straight from the archive
+ *
+ * Every member is created relative to an open fd of its parent directory, taken from a DirFdCache, so the kernel doesn't walk the full path for each one.
+ * Members the engine can't restore on its own (devices, FIFOs, xattrs, ACLs, sparse files) are not touched. Instead, their archive paths are added to fallbackPaths, so the caller can have libarchive extract just those. So are the hard links to them, which can't be made before their targets exist.
+ * Directory permissions are applied last, so a read-only directory doesn't block the extraction of its own contents. Given deferredDirModes, they're left to the caller, who applies them once libarchive is done with the fallback members. See applyDirModes.
+ *
+ * Given a WriterPool, regular files are copied by its writers, while this thread goes on with the next members. Every writer has finished with tarFd by the time this returns.
+ *
+ * @param [in] int tarFd
+ * @param [in] const std::vector<tarMember_s>& members
+ * @param [in] std::string root
+ * @param [in] const ExclusionMatcher& exclusions
+ * @param [out] std::set<std::string>& fallbackPaths
+ * @param [in] unsigned int verbosity
+ * @param [in] WriterPool* pool If NULL, files are copied by this thread
+ * @param [in] WritebackTracker* durability If not NULL, every entry is reported to it. The pool's writers must report to the same one
+ * @param [out] std::vector<std::pair<std::string, mode_t>>* deferredDirModes If not NULL, the directory permissions are added to it rather than applied
+ *
+ * @returns int 0 on success, or a negative error code
+ */
+int extractTarZeroCopy(int tarFd, const std::vector<tarMember_s>& members, std::string root, const ExclusionMatcher& exclusions, std::set<std::string>& fallbackPaths, unsigned int verbosity, WriterPool* pool, WritebackTracker* durability, std::vector<std::pair<std::string, mode_t>>* deferredDirModes) {/*{{{*/
+    std::vector<std::pair<std::string, mode_t>> dirModes;
+
+    // The canonical paths of the members left for libarchive
+    std::set<std::string> fallbackRels;
+    unsigned long long bytesCopied = 0;
+    unsigned long filesCopied = 0;
+    int err = 0;
+
+    DirFdCache dirs(root, verbosity);
+    if(!dirs.isOpen()) {
+        return -706;
+    }
+
+    for(const tarMember_s& m : members) {
+        // A writer may have failed in the meantime
+        if(pool != NULL && (err = pool->getError()) != 0) {
+            break;
+        }
+
+        // Check our exception list. An excluded member's data is never read
+        if(exclusions.matches(m.path) || (m.type == TAR_TYPE_HARDLINK && exclusions.matches(m.linkTarget))) {
+            continue;
+        }
+
+        std::string dest = root + "/" + m.path;
+
+        if(!isSafeMemberPath(m.path)) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: The archive member %s would be extracted outside of the system root. Refusing to continue.\n",m.path.c_str());
+            }
+
+            err = -701;
+            break;
+        }
+
+        if(m.needsFallback || (m.type == TAR_TYPE_HARDLINK && fallbackRels.count(canonicalMemberPath(m.linkTarget)) != 0)) {
+            fallbackPaths.insert(m.path);
+            fallbackRels.insert(canonicalMemberPath(m.path));
+            continue;
+        }
+
+        while(dest.size() > 1 && dest.back() == '/') {
+            dest.pop_back();
+        }
+
+        // An entry for the root itself, such as "./", only carries its permissions
+        std::string rel = canonicalMemberPath(m.path);
+        if(rel.empty()) {
+            if(m.type == TAR_TYPE_DIRECTORY) {
+                dirModes.push_back(std::pair<std::string, mode_t>(rel, m.mode));
+            }
+
+            continue;
+        }
+
+        // A later member at the same path must replace the earlier one, not race it
+        if(pool != NULL) {
+            pool->waitForPath(rel);
+        }
+
+        // libarchive creates missing parents, so we do too
+        std::string leaf;
+        int dirFd = dirs.parentFd(rel, leaf, true);
+        if(dirFd < 0) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Could not create the parent directories of %s. %s\n",dest.c_str(),strerror(errno));
+            }
+
+            err = -702;
+            break;
+        }
+
+        if(m.type == TAR_TYPE_DIRECTORY) {
+            if(!createDirectory(dirFd, leaf)) {
+                if(verbosity != 0) {
+                    fprintf(stderr,"Error: Could not create the directory %s. %s\n",dest.c_str(),strerror(errno));
+                }
+
+                err = -702;
+                break;
+            }
+
+            dirModes.push_back(std::pair<std::string, mode_t>(rel, m.mode));
+        }
+
+        else if(m.type == TAR_TYPE_SYMLINK) {
+            if(!clearPath(dirFd, leaf) || symlinkat(m.linkTarget.c_str(), dirFd, leaf.c_str()) != 0) {
+                if(verbosity != 0) {
+                    fprintf(stderr,"Error: Could not create the symbolic link %s. %s\n",dest.c_str(),strerror(errno));
+                }
+
+                err = -703;
+                break;
+            }
+        }
+
+        else if(m.type == TAR_TYPE_HARDLINK) {
+            if(pool != NULL) {
+                pool->waitForPath(canonicalMemberPath(m.linkTarget));
+            }
+
+            if((err = createHardLink(dirs, rel, m.linkTarget, dest, root, verbosity)) != 0) {
+                break;
+            }
+        }
+
+        else if(pool != NULL) {
+            writeJob_s job;
+            job.dirFd = fcntl(dirFd, F_DUPFD_CLOEXEC, 0);
+            if(job.dirFd < 0) {
+                if(verbosity != 0) {
+                    fprintf(stderr,"Error: Could not create the file %s. %s\n",dest.c_str(),strerror(errno));
+                }
+
+                err = -704;
+                break;
+            }
+
+            job.leaf = leaf;
+            job.rel = rel;
+            job.dest = dest;
+            job.mode = m.mode;
+            job.size = m.size;
+            job.srcFd = tarFd;
+            job.srcOffset = m.dataOffset;
+
+            // The writer reports it once it's done
+            pool->submit(job);
+            continue;
+        }
+
+        else {
+            int fd = createMemberFile(dirFd, leaf);
+            if(fd < 0) {
+                if(verbosity != 0) {
+                    fprintf(stderr,"Error: Could not create the file %s. %s\n",dest.c_str(),strerror(errno));
+                }
+
+                err = -704;
+                break;
+            }
+
+            ssize_t copied = copyFileData(tarFd, m.dataOffset, fd, m.size);
+            if(copied != m.size) {
+                if(verbosity != 0) {
+                    fprintf(stderr,"Error: Could not copy the contents of %s out of the archive. %s\n",dest.c_str(),strerror(errno));
+                }
+
+                close(fd);
+                err = -705;
+                break;
+            }
+
+            // ARCHIVE_EXTRACT_PERM restores the full mode, ignoring the umask
+            fchmod(fd, m.mode);
+            closeWritten(durability, fd, rel);
+
+            bytesCopied += copied;
+            filesCopied++;
+        }
+
+        if(durability != NULL) {
+            durability->entryCreated(rel);
+        }
+
+        if(verbosity >= 4) {
+            printf("Extracted %s\n",dest.c_str());
+        }
+    }
+
+    // The writers read from tarFd, which the caller closes as soon as we return
+    if(pool != NULL) {
+        int poolErr = pool->drain();
+        if(err == 0) {
+            err = poolErr;
+        }
+
+        filesCopied += pool->getFilesWritten();
+        bytesCopied += pool->getBytesWritten();
+    }
+
+    if(err != 0) {
+        return err;
+    }
+
+    if(deferredDirModes != NULL) {
+        deferredDirModes->insert(deferredDirModes->end(), dirModes.begin(), dirModes.end());
+    }
+
+    else {
+        applyDirModes(dirs, dirModes);
+    }
+
+    if(verbosity >= 3) {
+        printf("Copied %lu files (%llu bytes) straight from the archive; %lu members left for libarchive\n",filesCopied,bytesCopied,fallbackPaths.size());
+    }
+
+    if(verbosity >= 4) {
+        printf("Directory cache: %lu hits, %lu misses\n",dirs.getHits(),dirs.getMisses());
+    }
+
+    return 0;
+}/*}}}*/
+
+/**
+ * Reads the data of a regular file out of the archive, and hands it to the writers
+ *
+ * Files too big to buffer without starving the pool are written by this thread instead, one buffer at a time.
+ *
+ * @param [in] struct archive* a Positioned right after the file's header
+ * @param [in] struct archive_entry* ae
+ * @param [in] WriterPool& pool
+ * @param [in] int dirFd The directory the file goes in. It is not taken over
+ * @param [in] writeJob_s& job With everything but the data and dirFd filled in
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 on success, or a negative error code
+ */
+static int decodeFile(struct archive* a, struct archive_entry* ae, WriterPool& pool, int dirFd, writeJob_s& job, unsigned int verbosity) {/*{{{*/
+    // Holding more than half of the buffers for a single file could leave the writers with none to give back
+    off_t bufferLimit = (off_t)WRITER_BUFFER_SIZE * (pool.getMaxBuffers() / 2);
+    bool buffered = archive_entry_size_is_set(ae) && archive_entry_size(ae) <= bufferLimit;
+
+    int fd = -1;
+    if(!buffered && (fd = createMemberFile(dirFd, job.leaf)) < 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not create the file %s. %s\n",job.dest.c_str(),strerror(errno));
+        }
+
+        return -704;
+    }
+
+    char* buf = NULL;
+    size_t used = 0;
+    la_ssize_t r = 0;
+    bool written = true;
+
+    while(written) {
+        if(buf == NULL || used == WRITER_BUFFER_SIZE) {
+            if(buf != NULL) {
+                job.chunks.push_back(std::pair<char*, size_t>(buf, used));
+            }
+
+            buf = pool.acquireBuffer();
+            used = 0;
+
+            if(buf == NULL) {
+                errno = ENOMEM;
+                written = false;
+                break;
+            }
+        }
+
+        r = archive_read_data(a, buf + used, WRITER_BUFFER_SIZE - used);
+        if(r <= 0) {
+            break;
+        }
+
+        job.size += r;
+
+        if(buffered) {
+            used += r;
+        }
+
+        else {
+            written = writeBuffer(fd, buf, r);
+        }
+    }
+
+    if(buf != NULL) {
+        if(used > 0) {
+            job.chunks.push_back(std::pair<char*, size_t>(buf, used));
+        }
+
+        else {
+            pool.releaseBuffer(buf);
+        }
+    }
+
+    if(!buffered) {
+        if(written && r == 0 && restoreXattrs(fd, job.xattrs) != 0) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Could not restore the extended attributes of %s. %s\n",job.dest.c_str(),strerror(errno));
+            }
+
+            close(fd);
+            return WRITER_XATTR_ERROR;
+        }
+
+        if(written && r == 0) {
+            fchmod(fd, job.mode);
+            closeWritten(pool.getDurability(), fd, job.rel);
+
+            if(verbosity >= 4) {
+                printf("Extracted %s\n",job.dest.c_str());
+            }
+        }
+
+        else {
+            close(fd);
+        }
+    }
+
+    if(written && r == 0 && buffered) {
+        job.dirFd = fcntl(dirFd, F_DUPFD_CLOEXEC, 0);
+        written = (job.dirFd >= 0);
+    }
+
+    if(!written || r < 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not extract the contents of %s. %s\n",job.dest.c_str(),(r < 0) ? archive_error_string(a) : strerror(errno));
+        }
+
+        for(auto& chunk : job.chunks) {
+            pool.releaseBuffer(chunk.first);
+        }
+
+        return -705;
+    }
+
+    if(buffered) {
+        pool.submit(job);
+    }
+
+    return 0;
+}/*}}}*/
+
+/**
+ * Extracts an archive libarchive has opened into root, with a single thread decoding it and the writers of a WriterPool creating the files
+ *
+ * The decoding thread creates directories, symbolic links and hard links itself, in archive order, so a directory always exists before anything is queued inside of it.
+ * Members needing more than their data, permissions and extended attributes restored (devices, FIFOs, ACLs, sparse files) are extracted by libarchive, from this thread, just as extractWithLibarchive would.
+ * If the pool has a WritebackTracker, every entry is reported to it, including the ones libarchive restored.
+ *
+ * @param [in] struct archive* a
+ * @param [in] std::string root
+ * @param [in] const ExclusionMatcher& exclusions
+ * @param [in] WriterPool& pool
+ * @param [in] unsigned int verbosity
+ * @param [in] entryHook_t hook If not NULL, shown every header first. See entryHook_t
+ * @param [in] void* hookContext Handed to the hook
+ *
+ * @returns int ARCHIVE_EOF on success, ENTRY_STOPPED if the hook stopped the extraction, or an error code
+ */
+int extractArchiveWithWriters(struct archive* a, std::string root, const ExclusionMatcher& exclusions, WriterPool& pool, unsigned int verbosity, entryHook_t hook, void* hookContext) {/*{{{*/
+    WritebackTracker* durability = pool.getDurability();
+    std::vector<std::pair<std::string, mode_t>> dirModes;
+    unsigned long restored = 0;
+    struct archive_entry* ae;
+    int res = ARCHIVE_OK;
+    int err = 0;
+
+    DirFdCache dirs(root, verbosity);
+    if(!dirs.isOpen()) {
+        return -706;
+    }
+
+    while(err == 0 && (res = archive_read_next_header(a, &ae)) == ARCHIVE_OK) {
+        // A writer may have failed in the meantime
+        if((err = pool.getError()) != 0) {
+            break;
+        }
+
+        if(hook != NULL) {
+            int r = hook(a, ae, hookContext);
+            if(r < 0) {
+                err = r;
+                break;
+            }
+
+            if(r == ENTRY_SKIP) {
+                continue;
+            }
+        }
+
+        // Check our exception list. libarchive skips over the data of anything we don't read
+        const char* aePath = archive_entry_pathname(ae);
+        if(exclusions.matches(aePath) || exclusions.matches(archive_entry_hardlink(ae))) {
+            continue;
+        }
+
+        std::string path = (aePath != NULL) ? aePath : "";
+        std::string dest = root + "/" + path;
+
+        if(!isSafeMemberPath(path)) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: The archive member %s would be extracted outside of the system root. Refusing to continue.\n",path.c_str());
+            }
+
+            err = -701;
+            break;
+        }
+
+        while(dest.size() > 1 && dest.back() == '/') {
+            dest.pop_back();
+        }
+
+        std::string rel = canonicalMemberPath(path);
+        const char* hardlink = archive_entry_hardlink(ae);
+        mode_t type = archive_entry_filetype(ae);
+
+        // A later member at the same path must replace the earlier one, not race it
+        if(!rel.empty()) {
+            pool.waitForPath(rel);
+        }
+
+        bool special = archive_entry_acl_types(ae) != 0 || archive_entry_sparse_count(ae) != 0;
+        if(hardlink == NULL && type != AE_IFREG && (archive_entry_xattr_count(ae) != 0 || (type != AE_IFDIR && type != AE_IFLNK))) {
+            special = true;
+        }
+
+        if(hardlink == NULL && special) {
+            archive_entry_set_pathname(ae, dest.c_str());
+
+            int r = archive_read_extract(a, ae, LIBARCHIVE_EXTRACT_FLAGS);
+            if(r != ARCHIVE_OK) {
+                if(verbosity != 0) {
+                    fprintf(stderr,"Error: Could not extract %s. %s\n",dest.c_str(),archive_error_string(a));
+                }
+
+                err = r;
+                break;
+            }
+
+            if(durability != NULL && !rel.empty()) {
+                durability->pathRestored(dest, rel, type == AE_IFREG);
+            }
+
+            restored++;
+            continue;
+        }
+
+        // An entry for the root itself, such as "./", only carries its permissions
+        if(rel.empty()) {
+            if(type == AE_IFDIR && hardlink == NULL) {
+                dirModes.push_back(std::pair<std::string, mode_t>(rel, archive_entry_perm(ae)));
+            }
+
+            continue;
+        }
+
+        // libarchive creates missing parents, so we do too
+        std::string leaf;
+        int dirFd = dirs.parentFd(rel, leaf, true);
+        if(dirFd < 0) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Could not create the parent directories of %s. %s\n",dest.c_str(),strerror(errno));
+            }
+
+            err = -702;
+            break;
+        }
+
+        if(hardlink != NULL) {
+            pool.waitForPath(canonicalMemberPath(hardlink));
+
+            if((err = createHardLink(dirs, rel, hardlink, dest, root, verbosity)) != 0) {
+                break;
+            }
+        }
+
+        else if(type == AE_IFDIR) {
+            if(!createDirectory(dirFd, leaf)) {
+                if(verbosity != 0) {
+                    fprintf(stderr,"Error: Could not create the directory %s. %s\n",dest.c_str(),strerror(errno));
+                }
+
+                err = -702;
+                break;
+            }
+
+            dirModes.push_back(std::pair<std::string, mode_t>(rel, archive_entry_perm(ae)));
+        }
+
+        else if(type == AE_IFLNK) {
+            const char* target = archive_entry_symlink(ae);
+            if(target == NULL || !clearPath(dirFd, leaf) || symlinkat(target, dirFd, leaf.c_str()) != 0) {
+                if(verbosity != 0) {
+                    fprintf(stderr,"Error: Could not create the symbolic link %s. %s\n",dest.c_str(),strerror(errno));
+                }
+
+                err = -703;
+                break;
+            }
+        }
+
+        else {
+            writeJob_s job;
+            job.leaf = leaf;
+            job.rel = rel;
+            job.dest = dest;
+            job.mode = archive_entry_perm(ae);
+
+            const char* name;
+            const void* value;
+            size_t size;
+            archive_entry_xattr_reset(ae);
+            while(archive_entry_xattr_next(ae, &name, &value, &size) == ARCHIVE_OK) {
+                job.xattrs.push_back(std::pair<std::string, std::string>(name, std::string((const char*)value, size)));
+            }
+
+            // Reported by whoever writes it
+            if((err = decodeFile(a, ae, pool, dirFd, job, verbosity)) != 0) {
+                break;
+            }
+
+            continue;
+        }
+
+        if(durability != NULL) {
+            durability->entryCreated(rel);
+        }
+
+        if(verbosity >= 4) {
+            printf("Extracted %s\n",dest.c_str());
+        }
+    }
+
+    int poolErr = pool.drain();
+    if(err == 0) {
+        err = poolErr;
+    }
+
+    if(err == 0 && res != ARCHIVE_EOF) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not read the next header. %s\n",archive_error_string(a));
+        }
+
+        err = res;
+    }
+
+    if(err != 0) {
+        return err;
+    }
+
+    applyDirModes(dirs, dirModes);
+
+    if(verbosity >= 3) {
+        printf("Wrote %lu files (%llu bytes) from the writer threads; %lu members restored by libarchive\n",pool.getFilesWritten(),pool.getBytesWritten(),restored);
+    }
+
+    if(verbosity >= 4) {
+        printf("Directory cache: %lu hits, %lu misses\n",dirs.getHits(),dirs.getMisses());
+    }
+
+    return ARCHIVE_EOF;
+}/*}}}*/
@@ -0,0 +1,381 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file FanOut.cpp
+ * @error -2500
+ *
+ * Extracts one archive into several roots, reading and decoding it only once.
+ * Uncompressed tarballs have their headers walked once, and every root copies its files straight out of the same archive, from a thread of its own. The data is read from the page cache by all but the first.
+ * Anything else is decoded by a single thread, which hands each member, and each block of its data, to a writer thread per root. See FanoutWriter.
+ */
+
+#include "FanOut.h"
+
+/**
+ * @param [in] size_t limit The most bytes which may be held at once
+ */
+FanoutBudget::FanoutBudget(size_t limit) {/*{{{*/
+    this->limit = limit;
+}/*}}}*/
+
+/**
+ * Waits until bytes more can be held
+ * A block larger than the whole budget is let through once nothing else is held, so it can't wait forever
+ *
+ * @param [in] size_t bytes
+ */
+void FanoutBudget::acquire(size_t bytes) {/*{{{*/
+    std::unique_lock<std::mutex> guard(lock);
+    space.wait(guard, [&]{ return used == 0 || used + bytes <= limit; });
+    used += bytes;
+}/*}}}*/
+
+/**
+ * @param [in] size_t bytes
+ */
+void FanoutBudget::release(size_t bytes) {/*{{{*/
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        used -= bytes;
+    }
+
+    space.notify_all();
+}/*}}}*/
+
+/**
+ * Starts the writer of a root
+ *
+ * @param [in] std::string root
+ * @param [in] unsigned int verbosity
+ * @param [in] WritebackTracker* durability If not NULL, every entry restored is reported to it
+ */
+FanoutWriter::FanoutWriter(std::string root, unsigned int verbosity, WritebackTracker* durability) {/*{{{*/
+    this->root = root;
+    this->verbosity = verbosity;
+    this->durability = durability;
+
+    disk = archive_write_disk_new();
+    if(disk == NULL || archive_write_disk_set_options(disk, LIBARCHIVE_EXTRACT_FLAGS) != ARCHIVE_OK || archive_write_disk_set_standard_lookup(disk) != ARCHIVE_OK) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not set up the extraction into %s\n",root.c_str());
+        }
+
+        error = FANOUT_ROOT_ERROR;
+    }
+
+    thread = std::thread(&FanoutWriter::work, this);
+}/*}}}*/
+
+FanoutWriter::~FanoutWriter() {/*{{{*/
+    finish();
+
+    if(disk != NULL) {
+        archive_write_free(disk);
+    }
+}/*}}}*/
+
+/**
+ * Queues the next step for this root. Blocks while the root is too far behind
+ * Once the root failed, the step is dropped
+ *
+ * @param [in] const fanoutOp_s& op
+ */
+void FanoutWriter::submit(const fanoutOp_s& op) {/*{{{*/
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        queueSpace.wait(guard, [&]{ return error != 0 || queue.size() < FANOUT_OPS_PER_ROOT; });
+
+        if(error != 0) {
+            return;
+        }
+
+        queue.push_back(op);
+    }
+
+    workReady.notify_one();
+}/*}}}*/
+
+/**
+ * Applies the queued steps, in order, until told to stop
+ */
+void FanoutWriter::work() {/*{{{*/
+    while(true) {
+        fanoutOp_s op;
+
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            workReady.wait(guard, [&]{ return stopping || !queue.empty(); });
+
+            if(queue.empty()) {
+                return;
+            }
+
+            op = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        queueSpace.notify_one();
+
+        bool failed;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            failed = (error != 0);
+        }
+
+        int err = failed ? 0 : apply(op);
+
+        // Release the data before anything else, so the decoder isn't held up by a root which is done with it
+        op.data.reset();
+        op.entry.reset();
+
+        if(err != 0) {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                error = err;
+
+                // Nothing queued matters to a failed root
+                queue.clear();
+            }
+
+            queueSpace.notify_all();
+        }
+    }
+}/*}}}*/
+
+/**
+ * Restores a single step into the root
+ *
+ * @param [in] fanoutOp_s& op
+ *
+ * @returns int 0 on success, or a negative error code
+ */
+int FanoutWriter::apply(fanoutOp_s& op) {/*{{{*/
+    int r = ARCHIVE_OK;
+
+    if(op.kind == FANOUT_OP_HEADER) {
+        struct archive_entry* e = archive_entry_clone(op.entry.get());
+        if(e == NULL) {
+            return FANOUT_WRITE_ERROR;
+        }
+
+        currentRel = canonicalMemberPath(archive_entry_pathname(e));
+        currentIsFile = archive_entry_hardlink(e) == NULL && archive_entry_filetype(e) == AE_IFREG;
+        current = root + "/" + archive_entry_pathname(e);
+        archive_entry_set_pathname(e, current.c_str());
+
+        if(archive_entry_hardlink(e) != NULL) {
+            archive_entry_set_hardlink(e, (root + "/" + archive_entry_hardlink(e)).c_str());
+        }
+
+        r = archive_write_header(disk, e);
+        archive_entry_free(e);
+
+        if(r >= ARCHIVE_WARN && verbosity >= 4) {
+            printf("Extracted %s\n",current.c_str());
+        }
+    }
+
+    else if(op.kind == FANOUT_OP_DATA) {
+        r = archive_write_data_block(disk, op.data->data(), op.data->size(), op.offset);
+    }
+
+    else {
+        r = archive_write_finish_entry(disk);
+    }
+
+    if(r < ARCHIVE_WARN) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not extract %s. %s\n",current.c_str(),archive_error_string(disk));
+        }
+
+        return FANOUT_WRITE_ERROR;
+    }
+
+    // The file was written in full, so its writeback can start
+    if(op.kind == FANOUT_OP_FINISH && durability != NULL && !currentRel.empty()) {
+        durability->pathRestored(current, currentRel, currentIsFile);
+    }
+
+    return 0;
+}/*}}}*/
+
+/**
+ * Waits for every queued step, then applies the permissions libarchive held back until the end
+ * May be called more than once
+ *
+ * @returns int 0 if everything reached this root, or a negative error code
+ */
+int FanoutWriter::finish() {/*{{{*/
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+
+    workReady.notify_all();
+
+    if(thread.joinable()) {
+        thread.join();
+
+        if(error == 0 && disk != NULL && archive_write_close(disk) != ARCHIVE_OK) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Could not finish the extraction into %s. %s\n",root.c_str(),archive_error_string(disk));
+            }
+
+            error = FANOUT_WRITE_ERROR;
+        }
+    }
+
+    return error;
+}/*}}}*/
+
+/**
+ * Extracts an uncompressed tarball into every root at once, each from a thread of its own
+ * The headers were already walked, so each root only copies file data out of the archive. See extractTarZeroCopy
+ *
+ * @param [in] int tarFd
+ * @param [in] const std::vector<tarMember_s>& members
+ * @param [in] const std::vector<std::string>& roots
+ * @param [in] const ExclusionMatcher& exclusions
+ * @param [out] std::vector<std::set<std::string>>& fallbackPaths The members each root left for libarchive
+ * @param [out] std::vector<std::vector<std::pair<std::string, mode_t>>>& dirModes The directory permissions of each root, applied once its fallback members are in. See applyDirModes
+ * @param [out] std::vector<int>& results 0 for each root which was extracted into, or a negative error code
+ * @param [in] unsigned int verbosity
+ * @param [in] const std::vector<WritebackTracker*>* durability If not NULL, the tracker of each root, which may be NULL itself
+ *
+ * @returns int The number of roots which failed
+ */
+int extractTarFanout(int tarFd, const std::vector<tarMember_s>& members, const std::vector<std::string>& roots, const ExclusionMatcher& exclusions, std::vector<std::set<std::string>>& fallbackPaths, std::vector<std::vector<std::pair<std::string, mode_t>>>& dirModes, std::vector<int>& results, unsigned int verbosity, const std::vector<WritebackTracker*>* durability) {/*{{{*/
+    results.assign(roots.size(), 0);
+    fallbackPaths.assign(roots.size(), std::set<std::string>());
+    dirModes.assign(roots.size(), std::vector<std::pair<std::string, mode_t>>());
+
+    std::vector<std::thread> threads;
+    for(size_t index = 0; index < roots.size(); index++) {
+        threads.push_back(std::thread([&, index]() {
+            WritebackTracker* tracker = (durability != NULL) ? (*durability)[index] : NULL;
+            results[index] = extractTarZeroCopy(tarFd, members, roots[index], exclusions, fallbackPaths[index], verbosity, NULL, tracker, &dirModes[index]);
+        }));
+    }
+
+    int failures = 0;
+    for(size_t index = 0; index < threads.size(); index++) {
+        threads[index].join();
+        failures += (results[index] != 0) ? 1 : 0;
+    }
+
+    return failures;
+}/*}}}*/
+
+/**
+ * Decodes an archive libarchive has opened once, and extracts every member into each of the roots
+ *
+ * Each root has a writer thread of its own. Every header, and every block of data, is decoded a single time and queued for all of them, so the decoding cost doesn't grow with the number of roots.
+ * A root which fails is dropped from then on; The others are still extracted into. The slowest root holds up the decoder once FANOUT_BUFFER_BUDGET bytes are waiting on it.
+ *
+ * @param [in] struct archive* a
+ * @param [in] const std::vector<std::string>& roots
+ * @param [in] const ExclusionMatcher& exclusions
+ * @param [out] std::vector<int>& results 0 for each root which was extracted into, or a negative error code
+ * @param [in] unsigned int verbosity
+ * @param [in] const std::vector<WritebackTracker*>* durability If not NULL, the tracker of each root, which may be NULL itself
+ *
+ * @returns int 0 if the archive was read to its end, or an error code, in which case every root failed
+ */
+int extractArchiveFanout(struct archive* a, const std::vector<std::string>& roots, const ExclusionMatcher& exclusions, std::vector<int>& results, unsigned int verbosity, const std::vector<WritebackTracker*>* durability) {/*{{{*/
+    FanoutBudget budget(FANOUT_BUFFER_BUDGET);
+    std::vector<FanoutWriter*> writers;
+    for(size_t index = 0; index < roots.size(); index++) {
+        writers.push_back(new FanoutWriter(roots[index], verbosity, (durability != NULL) ? (*durability)[index] : NULL));
+    }
+
+    struct archive_entry* ae;
+    unsigned long long decoded = 0;
+    int res = ARCHIVE_OK;
+    int err = 0;
+
+    while(err == 0 && (res = archive_read_next_header(a, &ae)) == ARCHIVE_OK) {
+        // Check our exception list. libarchive skips over the data of anything we don't read
+        const char* aePath = archive_entry_pathname(ae);
+        if(exclusions.matches(aePath) || exclusions.matches(archive_entry_hardlink(ae))) {
+            continue;
+        }
+
+        std::string path = (aePath != NULL) ? aePath : "";
+        if(!isSafeMemberPath(path)) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: The archive member %s would be extracted outside of the system root. Refusing to continue.\n",path.c_str());
+            }
+
+            err = -701;
+            break;
+        }
+
+        fanoutOp_s header;
+        header.kind = FANOUT_OP_HEADER;
+        header.entry = std::shared_ptr<struct archive_entry>(archive_entry_clone(ae), archive_entry_free);
+        for(FanoutWriter* w : writers) {
+            w->submit(header);
+        }
+
+        const void* buf;
+        size_t size;
+        la_int64_t offset;
+        int r;
+
+        while((r = archive_read_data_block(a, &buf, &size, &offset)) == ARCHIVE_OK) {
+            budget.acquire(size);
+
+            fanoutOp_s data;
+            data.kind = FANOUT_OP_DATA;
+            data.offset = offset;
+            data.data = std::shared_ptr<std::string>(new std::string((const char*)buf, size), [&budget](std::string* s) {
+                budget.release(s->size());
+                delete s;
+            });
+
+            for(FanoutWriter* w : writers) {
+                w->submit(data);
+            }
+
+            decoded += size;
+        }
+
+        if(r != ARCHIVE_EOF) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Could not extract the contents of %s. %s\n",path.c_str(),archive_error_string(a));
+            }
+
+            err = r;
+            break;
+        }
+
+        fanoutOp_s finish;
+        finish.kind = FANOUT_OP_FINISH;
+        for(FanoutWriter* w : writers) {
+            w->submit(finish);
+        }
+    }
+
+    if(err == 0 && res != ARCHIVE_EOF) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not read the next header. %s\n",archive_error_string(a));
+        }
+
+        err = res;
+    }
+
+    // The writers hold on to blocks counted against the budget, so they have to be gone before it is
+    results.assign(roots.size(), 0);
+    for(size_t index = 0; index < writers.size(); index++) {
+        int writerErr = writers[index]->finish();
+        results[index] = (err != 0) ? err : writerErr;
+        delete writers[index];
+    }
+
+    if(err == 0 && verbosity >= 3) {
+        printf("Decoded %llu bytes once for %lu roots\n",decoded,roots.size());
+    }
+
+    return err;
+}/*}}}*/
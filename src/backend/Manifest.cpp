@@ -0,0 +1,258 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Manifest.cpp
+ * @error -900
+ *
+ * Reads and writes the manifests of installed packages.
+ * A manifest records every path a package installed, so that uninstalling, or asking which package owns a file, never has to go back to the tarball.
+ * Manifests are stored in the installed package database. A manifest in a file of its own is only read when importing the legacy one-file-per-package layout.
+ *
+ * The format is a 16 byte header (the magic, the format version and the number of records), followed by one record per path, sorted by path.
+ * Each record is a 16 byte fixed part (type, hash length, path length, mode, size), followed by the path and the hash. All integers are little-endian.
+ */
+
+#include "Manifest.h"
+
+/**
+ * Appends an integer to buf, least significant byte first
+ *
+ * @param [in] std::string& buf
+ * @param [in] uint64_t val
+ * @param [in] size_t bytes
+ */
+void putLE(std::string& buf, uint64_t val, size_t bytes) {/*{{{*/
+    for(size_t index = 0; index < bytes; index++) {
+        buf.push_back((char)((val >> (8 * index)) & 0xff));
+    }
+}/*}}}*/
+
+/**
+ * Reads a little-endian integer of the given width from buf
+ *
+ * @param [in] const char* buf
+ * @param [in] size_t bytes
+ *
+ * @returns uint64_t val
+ */
+uint64_t getLE(const char* buf, size_t bytes) {/*{{{*/
+    uint64_t val = 0;
+    for(size_t index = 0; index < bytes; index++) {
+        val |= (uint64_t)(unsigned char)buf[index] << (8 * index);
+    }
+
+    return val;
+}/*}}}*/
+
+/**
+ * Appends an unsigned LEB128 integer to buf
+ *
+ * @param [in] std::string& buf
+ * @param [in] uint64_t val
+ */
+void putVarint(std::string& buf, uint64_t val) {/*{{{*/
+    while(val >= 0x80) {
+        buf.push_back((char)((val & 0x7f) | 0x80));
+        val >>= 7;
+    }
+
+    buf.push_back((char)val);
+}/*}}}*/
+
+/**
+ * Reads an unsigned LEB128 integer, advancing p past it
+ *
+ * @param [in/out] const char*& p
+ * @param [in] const char* end
+ * @param [out] uint64_t& val
+ *
+ * @returns bool wasValid
+ */
+bool getVarint(const char*& p, const char* end, uint64_t& val) {/*{{{*/
+    val = 0;
+    for(unsigned int shift = 0; p < end && shift < 64; shift += 7) {
+        unsigned char c = *p++;
+        val |= (uint64_t)(c & 0x7f) << shift;
+
+        if((c & 0x80) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}/*}}}*/
+
+/**
+ * Builds the manifest entries for the members of a package
+ *
+ * @param [in] const std::vector<tarMember_s>& members
+ *
+ * @returns std::vector<manifestEntry_s> entries
+ */
+std::vector<manifestEntry_s> manifestFromMembers(const std::vector<tarMember_s>& members) {/*{{{*/
+    std::vector<manifestEntry_s> entries;
+    entries.reserve(members.size());
+
+    for(const tarMember_s& m : members) {
+        manifestEntry_s e;
+        e.path = m.path;
+        e.type = m.type;
+        e.mode = m.mode;
+        e.size = m.size;
+        e.hash = m.hash;
+        entries.push_back(e);
+    }
+
+    return entries;
+}/*}}}*/
+
+/**
+ * Turns a list of entries into the on-disk manifest format
+ * The entries are sorted by path, and duplicate paths are dropped, keeping the last one, as that is the one which ends up on disk
+ *
+ * @param [in] std::vector<manifestEntry_s> entries
+ *
+ * @returns std::string manifest
+ */
+std::string serializeManifest(std::vector<manifestEntry_s> entries) {/*{{{*/
+    std::stable_sort(entries.begin(), entries.end(), [](const manifestEntry_s& a, const manifestEntry_s& b) { return a.path < b.path; });
+
+    std::vector<const manifestEntry_s*> unique;
+    for(size_t index = 0; index < entries.size(); index++) {
+        if(index + 1 < entries.size() && entries[index + 1].path == entries[index].path) {
+            continue;
+        }
+
+        // Nothing on a Linux filesystem comes close to these limits, but the format can't store anything longer
+        if(entries[index].path.size() > UINT16_MAX || entries[index].hash.size() > UINT8_MAX) {
+            continue;
+        }
+
+        unique.push_back(&entries[index]);
+    }
+
+    std::string buf;
+    buf.append(MANIFEST_MAGIC, MANIFEST_MAGIC_SIZE);
+    putLE(buf, MANIFEST_VERSION, 4);
+    putLE(buf, unique.size(), 4);
+
+    for(const manifestEntry_s* e : unique) {
+        buf.push_back(e->type);
+        putLE(buf, e->hash.size(), 1);
+        putLE(buf, e->path.size(), 2);
+        putLE(buf, e->mode, 4);
+        putLE(buf, e->size, 8);
+        buf.append(e->path);
+        buf.append(e->hash);
+    }
+
+    return buf;
+}/*}}}*/
+
+/**
+ * Parses a manifest held in memory
+ *
+ * @param [in] const char* buf
+ * @param [in] size_t len
+ * @param [out] std::vector<manifestEntry_s>& entries
+ *
+ * @returns int 0 on success, MANIFEST_LEGACY if buf is empty, or MANIFEST_CORRUPT
+ */
+int parseManifest(const char* buf, size_t len, std::vector<manifestEntry_s>& entries) {/*{{{*/
+    // Before manifests existed, a package was followed by creating an empty file
+    if(len == 0) {
+        return MANIFEST_LEGACY;
+    }
+
+    if(len < MANIFEST_MAGIC_SIZE + 8 || memcmp(buf, MANIFEST_MAGIC, MANIFEST_MAGIC_SIZE) != 0 || getLE(buf + MANIFEST_MAGIC_SIZE, 4) != MANIFEST_VERSION) {
+        return MANIFEST_CORRUPT;
+    }
+
+    uint64_t count = getLE(buf + MANIFEST_MAGIC_SIZE + 4, 4);
+    size_t offset = MANIFEST_MAGIC_SIZE + 8;
+
+    entries.clear();
+    entries.reserve(count);
+
+    for(uint64_t index = 0; index < count; index++) {
+        if(len - offset < MANIFEST_RECORD_SIZE) {
+            return MANIFEST_CORRUPT;
+        }
+
+        const char* rec = buf + offset;
+        size_t hashLen = getLE(rec + 1, 1);
+        size_t pathLen = getLE(rec + 2, 2);
+
+        if(len - offset - MANIFEST_RECORD_SIZE < pathLen + hashLen) {
+            return MANIFEST_CORRUPT;
+        }
+
+        manifestEntry_s e;
+        e.type = rec[0];
+        e.mode = getLE(rec + 4, 4);
+        e.size = getLE(rec + 8, 8);
+        e.path.assign(rec + MANIFEST_RECORD_SIZE, pathLen);
+        e.hash.assign(rec + MANIFEST_RECORD_SIZE + pathLen, hashLen);
+        entries.push_back(e);
+
+        offset += MANIFEST_RECORD_SIZE + pathLen + hashLen;
+    }
+
+    return 0;
+}/*}}}*/
+
+/**
+ * Reads the manifest at path with a single read
+ * This is only used to import the legacy one-file-per-package layout
+ *
+ * @param [in] std::string path
+ * @param [out] std::vector<manifestEntry_s>& entries
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 on success, MANIFEST_LEGACY if the package was followed before manifests existed, MANIFEST_CORRUPT, or MANIFEST_IO_ERROR
+ */
+int readManifest(std::string path, std::vector<manifestEntry_s>& entries, unsigned int verbosity) {/*{{{*/
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        return MANIFEST_IO_ERROR;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        close(fd);
+        return MANIFEST_IO_ERROR;
+    }
+
+    std::string buf(st.st_size, '\0');
+    size_t got = 0;
+    while(got < buf.size()) {
+        ssize_t r = read(fd, &buf[got], buf.size() - got);
+        if(r < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if(r <= 0) {
+            break;
+        }
+
+        got += r;
+    }
+
+    close(fd);
+
+    if(got != buf.size()) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not read the manifest %s. %s\n",path.c_str(),strerror(errno));
+        }
+
+        return MANIFEST_IO_ERROR;
+    }
+
+    int res = parseManifest(buf.data(), buf.size(), entries);
+    if(res == MANIFEST_CORRUPT && verbosity != 0) {
+        fprintf(stderr,"Error: The manifest %s is corrupt\n",path.c_str());
+    }
+
+    return res;
+}/*}}}*/
@@ -0,0 +1,233 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file MemberCache.cpp
+ * @error -2900
+ *
+ * Caches the member lists of library tarballs, keyed by their device, inode, size and mtime.
+ * Walking the headers of a tarball means a read for every member, scattered across the whole file. Listing the contents of a package, finding its scripts and installing it all need that list, and it never changes until the tarball does.
+ * Seekable packages carry their own index, and never touch the cache. Compressed ones can't be seeked through, so their offsets are no use to anyone, and they aren't cached either.
+ */
+
+#include "MemberCache.h"
+
+// The offsets of the header's fields
+#define HEADER_VERSION_OFFSET 8
+#define HEADER_DEVICE_OFFSET 16
+#define HEADER_INODE_OFFSET 24
+#define HEADER_SIZE_OFFSET 32
+#define HEADER_MTIME_OFFSET 40
+#define HEADER_MTIME_NSEC_OFFSET 48
+#define HEADER_LENGTH_OFFSET 56
+#define HEADER_DIGEST_OFFSET 64
+
+/**
+ * Constructor for the MemberCache class
+ * The directory is created if it doesn't exist. If it can't be, every lookup misses, and nothing is stored
+ *
+ * @param [in] std::string dir
+ * @param [in] unsigned int verbosity
+ */
+MemberCache::MemberCache(std::string dir, unsigned int verbosity) {/*{{{*/
+    this->dir = dir;
+    this->verbosity = verbosity;
+
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+
+    if(ec && verbosity >= 4) {
+        fprintf(stderr,"Warning: Could not create the member cache %s. %s\n",dir.c_str(),ec.message().c_str());
+    }
+}/*}}}*/
+
+/**
+ * @param [in] const struct stat& st The tarball's
+ *
+ * @returns std::string The path of the tarball's entry
+ */
+std::string MemberCache::entryPath(const struct stat& st) {/*{{{*/
+    char name[64];
+    snprintf(name, sizeof(name), "%llx-%llx", (unsigned long long)st.st_dev, (unsigned long long)st.st_ino);
+    return dir + "/" + name;
+}/*}}}*/
+
+/**
+ * Looks up the members of a tarball
+ *
+ * @param [in] int fd The tarball
+ * @param [out] std::vector<tarMember_s>& members
+ *
+ * @returns bool wasThereAFreshEntry
+ */
+bool MemberCache::load(int fd, std::vector<tarMember_s>& members) {/*{{{*/
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        return false;
+    }
+
+    std::string path = entryPath(st);
+    int entryFd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(entryFd < 0) {
+        if(verbosity >= 4) {
+            printf("The member cache has no entry for this tarball. Walking its headers\n");
+        }
+
+        return false;
+    }
+
+    struct stat entrySt;
+    char header[MEMBER_CACHE_HEADER_SIZE];
+    bool fresh = fstat(entryFd, &entrySt) == 0
+        && pread(entryFd, header, MEMBER_CACHE_HEADER_SIZE, 0) == MEMBER_CACHE_HEADER_SIZE
+        && memcmp(header, MEMBER_CACHE_MAGIC, MEMBER_CACHE_MAGIC_SIZE) == 0
+        && getLE(header + HEADER_VERSION_OFFSET, 4) == MEMBER_CACHE_VERSION
+        && getLE(header + HEADER_DEVICE_OFFSET, 8) == (uint64_t)st.st_dev
+        && getLE(header + HEADER_INODE_OFFSET, 8) == (uint64_t)st.st_ino
+        && getLE(header + HEADER_SIZE_OFFSET, 8) == (uint64_t)st.st_size
+        && getLE(header + HEADER_MTIME_OFFSET, 8) == (uint64_t)st.st_mtim.tv_sec
+        && getLE(header + HEADER_MTIME_NSEC_OFFSET, 8) == (uint64_t)st.st_mtim.tv_nsec
+        && getLE(header + HEADER_LENGTH_OFFSET, 8) == (uint64_t)(entrySt.st_size - MEMBER_CACHE_HEADER_SIZE);
+
+    if(!fresh) {
+        close(entryFd);
+
+        if(verbosity >= 4) {
+            printf("The member cache entry %s is stale. Walking the tarball's headers again\n",path.c_str());
+        }
+
+        return false;
+    }
+
+    std::string data;
+    bool valid = readTarRange(entryFd, MEMBER_CACHE_HEADER_SIZE, getLE(header + HEADER_LENGTH_OFFSET, 8), data)
+        && sha256(data.data(), data.size()) == std::string(header + HEADER_DIGEST_OFFSET, SHA256_DIGEST_SIZE)
+        && parsePkgIndex(data, st.st_size, members);
+
+    close(entryFd);
+
+    if(!valid) {
+        members.clear();
+
+        if(verbosity >= 4) {
+            fprintf(stderr,"Warning: The member cache entry %s is damaged. Walking the tarball's headers again\n",path.c_str());
+        }
+
+        return false;
+    }
+
+    if(verbosity >= 4) {
+        printf("Read %lu members from the member cache entry %s\n",members.size(),path.c_str());
+    }
+
+    return true;
+}/*}}}*/
+
+/**
+ * Records the members of a tarball, replacing any entry it had
+ *
+ * @param [in] int fd The tarball
+ * @param [in] const std::vector<tarMember_s>& members
+ *
+ * @returns bool wasTheEntryWritten
+ */
+bool MemberCache::store(int fd, const std::vector<tarMember_s>& members) {/*{{{*/
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        return false;
+    }
+
+    std::string data = serializePkgIndex(members);
+
+    std::string buf(MEMBER_CACHE_MAGIC, MEMBER_CACHE_MAGIC_SIZE);
+    putLE(buf, MEMBER_CACHE_VERSION, 4);
+    putLE(buf, 0, 4);
+    putLE(buf, st.st_dev, 8);
+    putLE(buf, st.st_ino, 8);
+    putLE(buf, st.st_size, 8);
+    putLE(buf, st.st_mtim.tv_sec, 8);
+    putLE(buf, st.st_mtim.tv_nsec, 8);
+    putLE(buf, data.size(), 8);
+    buf.append(sha256(data.data(), data.size()));
+    buf.append(data);
+
+    // Every writer gets a temporary file of its own, so two runs caching the same tarball don't trip over each other
+    std::string path = entryPath(st);
+    std::string tmpPath = path + ".XXXXXX";
+    std::vector<char> tmpName(tmpPath.begin(), tmpPath.end());
+    tmpName.push_back('\0');
+
+    int entryFd = mkstemp(tmpName.data());
+    if(entryFd < 0) {
+        if(verbosity >= 4) {
+            fprintf(stderr,"Warning: Could not add a member cache entry in %s. %s\n",dir.c_str(),strerror(errno));
+        }
+
+        return false;
+    }
+
+    // The cache can always be rebuilt from the library, so it isn't worth an fsync
+    bool written = fchmod(entryFd, 0644) == 0 && writeBuffer(entryFd, buf.data(), buf.size());
+    written = (close(entryFd) == 0) && written && rename(tmpName.data(), path.c_str()) == 0;
+
+    if(!written) {
+        if(verbosity >= 4) {
+            fprintf(stderr,"Warning: Could not write the member cache entry %s. %s\n",path.c_str(),strerror(errno));
+        }
+
+        unlink(tmpName.data());
+        return false;
+    }
+
+    if(verbosity >= 4) {
+        printf("Cached %lu members in %s\n",members.size(),path.c_str());
+    }
+
+    return true;
+}/*}}}*/
+
+/**
+ * Removes the entry of every tarball which isn't in tarballs
+ * Only entries are looked at. Temporary files may belong to a run which is still writing them, and are left alone
+ *
+ * @param [in] const std::set<std::pair<uint64_t, uint64_t>>& tarballs The device and inode of every tarball in the library
+ *
+ * @returns unsigned long removed
+ */
+unsigned long MemberCache::prune(const std::set<std::pair<uint64_t, uint64_t>>& tarballs) {/*{{{*/
+    std::error_code ec;
+    std::filesystem::directory_iterator di(dir, ec);
+    if(ec) {
+        return 0;
+    }
+
+    unsigned long removed = 0;
+    for(auto& p : di) {
+        std::string name = p.path().filename().string();
+        unsigned long long device;
+        unsigned long long inode;
+        int length = 0;
+
+        if(sscanf(name.c_str(), "%llx-%llx%n", &device, &inode, &length) != 2 || (size_t)length != name.size()) {
+            continue;
+        }
+
+        if(tarballs.count(std::pair<uint64_t, uint64_t>(device, inode)) != 0) {
+            continue;
+        }
+
+        if(unlink(p.path().c_str()) == 0) {
+            removed++;
+        }
+
+        else if(verbosity >= 4) {
+            fprintf(stderr,"Warning: Could not remove the member cache entry %s. %s\n",p.path().c_str(),strerror(errno));
+        }
+    }
+
+    if(verbosity >= 4 && removed != 0) {
+        printf("Removed %lu member cache entries of tarballs no longer in the library\n",removed);
+    }
+
+    return removed;
+}/*}}}*/
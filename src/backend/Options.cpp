@@ -25,7 +25,19 @@ std::map<std::string, unsigned int> configKeys =
     { KEY_SYSTEM_ROOT, MASK_SYSTEM_ROOT },
     { KEY_TAR_LIBRARY_PATH, MASK_TAR_LIBRARY_PATH },
     { KEY_INSTALLED_PKG_PATH, MASK_INSTALLED_PKG_PATH },
-    //{ KEY_EXCLUDED_FILES, MASK_EXCLUDED_FILES } // Not yet implemented
+    { KEY_EXCLUDED_FILES, MASK_EXCLUDED_FILES },
+    { KEY_JOBS, MASK_JOBS },
+    { KEY_WRITERS, MASK_WRITERS },
+    { KEY_QUARANTINE, MASK_QUARANTINE },
+    { KEY_STAGED, MASK_STAGED },
+    { KEY_DURABILITY, MASK_DURABILITY },
+    { KEY_STORE_PATH, MASK_STORE_PATH },
+    { KEY_STORE_HARDLINKS, MASK_STORE_HARDLINKS },
+    { KEY_STORE_SIZE, MASK_STORE_SIZE },
+    { KEY_FANOUT_ROOTS, MASK_FANOUT_ROOTS },
+    { KEY_PREFETCH_DEPTH, MASK_PREFETCH_DEPTH },
+    { KEY_PREFETCH_SIZE, MASK_PREFETCH_SIZE },
+    { KEY_MEMBER_CACHE_PATH, MASK_MEMBER_CACHE_PATH },
 };
 
 // @TODO See if we really need this
@@ -36,6 +48,11 @@ std::map<int, mode_s> modes = {
     { UNFOLLOW, mode_s{ UNFOLLOW, "unfollow" } },
     { LIST_ALL, mode_s{ LIST_ALL, "list-all" } },
     { LIST_INSTALLED, mode_s{ LIST_INSTALLED, "list-installed" } },
+    { SEARCH, mode_s{ SEARCH, "search" } },
+    { OWNER, mode_s{ OWNER, "owner" } },
+    { INDEX, mode_s{ INDEX, "index" } },
+    { EXTRACT, mode_s{ EXTRACT, "extract" } },
+    { BUILD, mode_s{ BUILD, "build" } },
     { NOP, mode_s{ NOP, NOP_KEY } }
 };
 
@@ -60,15 +77,36 @@ std::map<std::string, unsigned int> modeStrToInt = {
     { "la",             LIST_ALL },
     { "list-installed", LIST_INSTALLED },
     { "li",             LIST_INSTALLED },
+    { "search",         SEARCH },
+    { "s",              SEARCH },
+    { "owner",          OWNER },
+    { "o",              OWNER },
+    { "index",          INDEX },
+    { "ix",             INDEX },
+    { "extract",        EXTRACT },
+    { "e",              EXTRACT },
+    { "build",          BUILD },
+    { "b",              BUILD },
     { NOP_KEY,          NOP }
 };
 
+/**
+ * A dictionary used to translate the values of the durability option into integers we can switch on
+ * All of the integers are defined per pre-processor directives in Options.h
+ */
+std::map<std::string, unsigned int> durabilityStrToInt = {
+    { "none",           DURABILITY_NONE },
+    { "transaction",    DURABILITY_TRANSACTION },
+    { "package",        DURABILITY_PACKAGE },
+    { "file",           DURABILITY_FILE }
+};
+
 /**
  * This is used as a validation set, such that we can check if a given mode is valid
  * In order to add a new mode of operation, its identifier must be added to this set
  */
 std::set<unsigned int> validModes = {
-    0,1,2,3,4,5,6,7,8,9,99
+    0,1,2,3,4,5,6,7,8,9,10,11,12,99
 };
 
 /**
@@ -76,9 +114,31 @@ std::set<unsigned int> validModes = {
  * Specifically, this set is used to make sure that any values given to addToOptMask are powers of two
  */
 std::set<unsigned int> validOptMaskVals = {
-    0,1,2,4,8,16,32,64,128,256
+    0,1,2,4,8,16,32,64,128,256,512,1024,2048,4096,8192,16384,32768,65536,131072,262144,524288,1048576,2097152,4194304
 };
 
+/**
+ * Reads an on/off value from a configuration file
+ *
+ * @param const char* str One of true, yes, on, or 1, or false, no, off, or 0
+ * @param bool& val
+ *
+ * @returns bool wasTheValueRecognized
+ */
+static bool parseSwitch(const char* str, bool& val) {/*{{{*/
+    if(strcmp(str, "true") == 0 || strcmp(str, "yes") == 0 || strcmp(str, "on") == 0 || strcmp(str, "1") == 0) {
+        val = true;
+        return true;
+    }
+
+    if(strcmp(str, "false") == 0 || strcmp(str, "no") == 0 || strcmp(str, "off") == 0 || strcmp(str, "0") == 0) {
+        val = false;
+        return true;
+    }
+
+    return false;
+}/*}}}*/
+
 /**
  * The constructor for the Options class. Most of these have default values set by the pre-processor at compile time via environment variables in config.h. If those can't be found (which should never be the case), there are hard-coded fail-safe values in the header Options.h
  *
@@ -94,10 +154,24 @@ std::set<unsigned int> validOptMaskVals = {
  * @param std::string tarLibraryPath
  * @param std::string installedPkgsPath
  * @param std::set<std::string> excludedFiles
+ * @param unsigned int jobs
+ * @param unsigned int writers
+ * @param bool quarantine
+ * @param bool staged
+ * @param unsigned int durability
+ * @param std::string storePath
+ * @param bool storeHardlinks
+ * @param unsigned long long storeSize
+ * @param std::vector<std::string> fanoutRoots
+ * @param unsigned int prefetchDepth
+ * @param unsigned long long prefetchSize
+ * @param std::string outputPath
+ * @param std::string memberCachePath
+ * @param bool buildZstd
  *
  * @returns Constructed Options object
  */
-Options::Options(unsigned int mode, unsigned int verbosity, bool smartOperation, unsigned int optMask, std::string globalConfigPath, std::string userConfigPath, std::string systemRoot, std::string tarLibraryPath, std::string installedPkgsPath, std::set<std::string> excludedFiles) {/*{{{*/
+Options::Options(unsigned int mode, unsigned int verbosity, bool smartOperation, unsigned int optMask, std::string globalConfigPath, std::string userConfigPath, std::string systemRoot, std::string tarLibraryPath, std::string installedPkgsPath, std::set<std::string> excludedFiles, unsigned int jobs, unsigned int writers, bool quarantine, bool staged, unsigned int durability, std::string storePath, bool storeHardlinks, unsigned long long storeSize, std::vector<std::string> fanoutRoots, unsigned int prefetchDepth, unsigned long long prefetchSize, std::string outputPath, std::string memberCachePath, bool buildZstd) {/*{{{*/
     setMode(mode);
     setVerbosity(verbosity);
     setSmartOperation(smartOperation);
@@ -107,6 +181,20 @@ Options::Options(unsigned int mode, unsigned int verbosity, bool smartOperation,
     setTarLibraryPath(tarLibraryPath);
     setInstalledPkgsPath(installedPkgsPath);
     setExcludedFiles(excludedFiles);
+    setJobs(jobs);
+    setWriters(writers);
+    setQuarantine(quarantine);
+    setStaged(staged);
+    setDurability(durability);
+    setStorePath(storePath);
+    setStoreHardlinks(storeHardlinks);
+    setStoreSize(storeSize);
+    setFanoutRoots(fanoutRoots);
+    setPrefetchDepth(prefetchDepth);
+    setPrefetchSize(prefetchSize);
+    setOutputPath(outputPath);
+    setMemberCachePath(memberCachePath);
+    setBuildZstd(buildZstd);
     setOptMask(optMask);
 }/*}}}*/
 
@@ -218,6 +306,132 @@ std::set<std::string> Options::getExcludedFiles() {/*{{{*/
     return excludedFiles;
 }/*}}}*/
 
+/**
+ * Getter for the number of packages which may be extracted at the same time
+ *
+ * @returns unsigned int jobs
+ */
+unsigned int Options::getJobs() {/*{{{*/
+    return jobs;
+}/*}}}*/
+
+/**
+ * Getter for the number of threads writing out the files of a single package
+ *
+ * @returns unsigned int writers
+ */
+unsigned int Options::getWriters() {/*{{{*/
+    return writers;
+}/*}}}*/
+
+/**
+ * Getter for whether packages are moved into the trash when uninstalled, instead of deleted in place
+ *
+ * @returns bool quarantine
+ */
+bool Options::getQuarantine() {/*{{{*/
+    return quarantine;
+}/*}}}*/
+
+/**
+ * Getter for whether packages are extracted next to the system root, and moved into place once complete, instead of written straight into it
+ *
+ * @returns bool staged
+ */
+bool Options::getStaged() {/*{{{*/
+    return staged;
+}/*}}}*/
+
+/**
+ * Getter for when installed files are made to reach the disk. One of the DURABILITY_* modes
+ *
+ * @returns unsigned int durability
+ */
+unsigned int Options::getDurability() {/*{{{*/
+    return durability;
+}/*}}}*/
+
+/**
+ * Getter for the directory of the content addressed package store. Empty when there is no store
+ *
+ * @returns std::string storePath
+ */
+std::string Options::getStorePath() {/*{{{*/
+    return storePath;
+}/*}}}*/
+
+/**
+ * Getter for whether files installed from the store are hard linked to it, instead of cloned or copied
+ *
+ * @returns bool storeHardlinks
+ */
+bool Options::getStoreHardlinks() {/*{{{*/
+    return storeHardlinks;
+}/*}}}*/
+
+/**
+ * Getter for how large the store may grow, in MiB, before the packages used longest ago are dropped. 0 is unlimited
+ *
+ * @returns unsigned long long storeSize
+ */
+unsigned long long Options::getStoreSize() {/*{{{*/
+    return storeSize;
+}/*}}}*/
+
+/**
+ * Getter for the roots installs are fanned out to, besides the system root. Each is a path, optionally followed by a colon and the root's own installed package directory
+ *
+ * @returns std::vector<std::string> fanoutRoots
+ */
+std::vector<std::string> Options::getFanoutRoots() {/*{{{*/
+    return fanoutRoots;
+}/*}}}*/
+
+/**
+ * Getter for how many of the upcoming packages' tarballs are read ahead while installing. 0 disables reading ahead
+ *
+ * @returns unsigned int prefetchDepth
+ */
+unsigned int Options::getPrefetchDepth() {/*{{{*/
+    return prefetchDepth;
+}/*}}}*/
+
+/**
+ * Getter for how much of the upcoming tarballs may be read ahead at once, in MiB
+ *
+ * @returns unsigned long long prefetchSize
+ */
+unsigned long long Options::getPrefetchSize() {/*{{{*/
+    return prefetchSize;
+}/*}}}*/
+
+/**
+ * Getter for the directory the extract mode writes members to. Empty writes them to standard output
+ *
+ * @returns std::string outputPath
+ */
+std::string Options::getOutputPath() {/*{{{*/
+    return outputPath;
+}/*}}}*/
+
+/**
+ * Getter for the directory the member lists of library tarballs are cached in. Empty keeps them within the installed package database
+ *
+ * @returns std::string memberCachePath
+ */
+std::string Options::getMemberCachePath() {/*{{{*/
+    return memberCachePath;
+}/*}}}*/
+
+/**
+ * Getter for whether the build mode compresses the packages it writes with zstd
+ *
+ * @returns bool buildZstd
+ */
+bool Options::getBuildZstd() {/*{{{*/
+    return buildZstd;
+}/*}}}*/
+
 // @TODO Refactor this to have an actual integer verbosity level like everything else
 /**
  * Sets a mode based on the mode_s passed to it
@@ -551,7 +765,7 @@ bool Options::setInstalledPkgsPath(std::string ipp, bool silent) {/*{{{*/
 /**
  * Sets the files which should be ignored when installing or uninstalling packages.
  *
- * The actual implementation of excluded files is not complete. As such, this option currently does nothing.
+ * Each entry is a glob pattern relative to the system root, such as usr/share/doc or usr/share/man/man?. See ExclusionMatcher for the syntax.
  *
  * Always returns true
  *
@@ -565,6 +779,399 @@ bool Options::setExcludedFiles(std::set<std::string> ef, bool silent) {/*{{{*/
     return true;
 }/*}}}*/
 
+/**
+ * Sets the files which should be ignored when installing or uninstalling packages.
+ * This overload is meant to take the value straight from a configuration file, where the patterns are separated by commas
+ *
+ * Always returns true
+ *
+ * @param const char* excludedFileList
+ * @param bool silent
+ *
+ * @returns bool true
+ */
+bool Options::setExcludedFiles(const char* ef, bool silent) {/*{{{*/
+    std::set<std::string> patterns;
+    std::string list = ef;
+    size_t start = 0;
+
+    while(start <= list.size()) {
+        size_t end = list.find(',', start);
+        if(end == std::string::npos) {
+            end = list.size();
+        }
+
+        size_t first = list.find_first_not_of(" \t", start);
+        size_t last = list.find_last_not_of(" \t", end - 1);
+        if(first != std::string::npos && first < end && last != std::string::npos && last >= first) {
+            patterns.insert(list.substr(first, last - first + 1));
+        }
+
+        start = end + 1;
+    }
+
+    return setExcludedFiles(patterns, silent);
+}/*}}}*/
+
+/**
+ * Sets the number of packages which may be extracted at the same time when installing.
+ * Scripts and database updates are still done one package at a time, in the order the packages were given. 1 disables the pipeline entirely.
+ *
+ * @param unsigned int jobs
+ * @param bool silent
+ *
+ * @returns bool wereJobsValid
+ */
+bool Options::setJobs(unsigned int j, bool silent) {/*{{{*/
+    if(j >= 1) {
+        jobs = j;
+        return true;
+    }
+
+    else {
+        if(!silent) {
+            fprintf(stderr,"Error: The number of jobs must be a positive integer.\n");
+        }
+
+        return false;
+    }
+}/*}}}*/
+
+/**
+ * Sets the number of packages which may be extracted at the same time when installing.
+ * This overload is meant to take the value straight from the command-line or a configuration file
+ *
+ * @param const char* jobs
+ * @param bool silent
+ *
+ * @returns bool wereJobsValid
+ */
+bool Options::setJobs(const char* j, bool silent) {/*{{{*/
+    char* end = NULL;
+    long val = strtol(j, &end, 10);
+
+    if(end != j && *end == '\0' && val > 0) {
+        return setJobs((unsigned int)val, silent);
+    }
+
+    else {
+        if(!silent) {
+            fprintf(stderr,"Error: The number of jobs must be a positive integer.\n");
+        }
+
+        return false;
+    }
+}/*}}}*/
+
+/**
+ * Sets the number of threads which write out the files of a package while it is being extracted.
+ * The archive is still read by a single thread; Only creating and filling in the files is spread out. 1 writes everything from the thread reading the archive.
+ *
+ * @param unsigned int writers
+ * @param bool silent
+ *
+ * @returns bool wereWritersValid
+ */
+bool Options::setWriters(unsigned int w, bool silent) {/*{{{*/
+    if(w >= 1) {
+        writers = w;
+        return true;
+    }
+
+    else {
+        if(!silent) {
+            fprintf(stderr,"Error: The number of writers must be a positive integer.\n");
+        }
+
+        return false;
+    }
+}/*}}}*/
+
+/**
+ * Sets the number of threads which write out the files of a package while it is being extracted.
+ * This overload is meant to take the value straight from the command-line or a configuration file
+ *
+ * @param const char* writers
+ * @param bool silent
+ *
+ * @returns bool wereWritersValid
+ */
+bool Options::setWriters(const char* w, bool silent) {/*{{{*/
+    char* end = NULL;
+    long val = strtol(w, &end, 10);
+
+    if(end != w && *end == '\0' && val > 0) {
+        return setWriters((unsigned int)val, silent);
+    }
+
+    else {
+        if(!silent) {
+            fprintf(stderr,"Error: The number of writers must be a positive integer.\n");
+        }
+
+        return false;
+    }
+}/*}}}*/
+
+/**
+ * Sets whether uninstalling moves a package into a trash directory under the system root, which is emptied afterwards, instead of deleting it in place.
+ * This function always returns true, since there cannot be an invalid value without error'ing out when the function is called
+ *
+ * @param bool quarantine
+ * @param bool silent
+ *
+ * @returns bool wasQuarantineValid
+ */
+bool Options::setQuarantine(bool q, bool silent) {/*{{{*/
+    quarantine = q;
+    return true;
+}/*}}}*/
+
+/**
+ * Sets whether uninstalling moves a package into a trash directory under the system root, which is emptied afterwards, instead of deleting it in place.
+ * This overload is meant to take the value straight from a configuration file. One of true, yes, on, or 1, or false, no, off, or 0
+ *
+ * @param const char* quarantine
+ * @param bool silent
+ *
+ * @returns bool wasQuarantineValid
+ */
+bool Options::setQuarantine(const char* q, bool silent) {/*{{{*/
+    bool val;
+    if(parseSwitch(q, val)) {
+        return setQuarantine(val, silent);
+    }
+
+    if(!silent) {
+        fprintf(stderr,"Error: quarantine must be either true or false.\n");
+    }
+
+    return false;
+}/*}}}*/
+
+/**
+ * Sets whether installing extracts a package into a staging directory under the system root first, and only moves it into place once it was extracted entirely.
+ * This function always returns true, since there cannot be an invalid value without error'ing out when the function is called
+ *
+ * @param bool staged
+ * @param bool silent
+ *
+ * @returns bool wasStagedValid
+ */
+bool Options::setStaged(bool st, bool silent) {/*{{{*/
+    staged = st;
+    return true;
+}/*}}}*/
+
+/**
+ * Sets whether installing extracts a package into a staging directory under the system root first, and only moves it into place once it was extracted entirely.
+ * This overload is meant to take the value straight from a configuration file. One of true, yes, on, or 1, or false, no, off, or 0
+ *
+ * @param const char* staged
+ * @param bool silent
+ *
+ * @returns bool wasStagedValid
+ */
+bool Options::setStaged(const char* st, bool silent) {/*{{{*/
+    bool val;
+    if(parseSwitch(st, val)) {
+        return setStaged(val, silent);
+    }
+
+    if(!silent) {
+        fprintf(stderr,"Error: staged must be either true or false.\n");
+    }
+
+    return false;
+}/*}}}*/
+
+/**
+ * Sets when installed files are made to reach the disk
+ *
+ * @param unsigned int durability One of the DURABILITY_* modes
+ * @param bool silent
+ *
+ * @returns bool wasDurabilityValid
+ */
+bool Options::setDurability(unsigned int d, bool silent) {/*{{{*/
+    if(d <= DURABILITY_FILE) {
+        durability = d;
+        return true;
+    }
+
+    else {
+        if(!silent) {
+            fprintf(stderr,"Error: durability must be one of none, transaction, package, or file.\n");
+        }
+
+        return false;
+    }
+}/*}}}*/
+
+/**
+ * Sets when installed files are made to reach the disk, by the name of the mode, as used on the command line and in configuration files
+ *
+ * @param const char* durability One of none, transaction, package, or file
+ * @param bool silent
+ *
+ * @returns bool wasDurabilityValid
+ */
+bool Options::setDurability(const char* d, bool silent) {/*{{{*/
+    auto it = durabilityStrToInt.find(d);
+    if(it != durabilityStrToInt.end()) {
+        return setDurability(it->second, silent);
+    }
+
+    else {
+        if(!silent) {
+            fprintf(stderr,"Error: durability must be one of none, transaction, package, or file.\n");
+        }
+
+        return false;
+    }
+}/*}}}*/
+
+/**
+ * Sets the directory of the content addressed package store, which is created on first use. An empty path disables the store.
+ * Always returns true
+ *
+ * @param std::string storePath
+ * @param bool silent
+ *
+ * @returns bool true
+ */
+bool Options::setStorePath(std::string sp, bool silent) {/*{{{*/
+    // If the path given is not absolute, make it so
+    storePath = sp.empty() ? sp : std::string(std::filesystem::absolute(sp));
+    return true;
+}/*}}}*/
+
+/**
+ * Sets whether files installed from the store are hard linked to it, instead of cloned or copied.
+ * This function always returns true, since there cannot be an invalid value without error'ing out when the function is called
+ *
+ * @param bool storeHardlinks
+ * @param bool silent
+ *
+ * @returns bool wasStoreHardlinksValid
+ */
+bool Options::setStoreHardlinks(bool sh, bool silent) {/*{{{*/
+    storeHardlinks = sh;
+    return true;
+}/*}}}*/
+
+/**
+ * Sets whether files installed from the store are hard linked to it, instead of cloned or copied.
+ * This overload is meant to take the value straight from a configuration file. One of true, yes, on, or 1, or false, no, off, or 0
+ *
+ * @param const char* storeHardlinks
+ * @param bool silent
+ *
+ * @returns bool wasStoreHardlinksValid
+ */
+bool Options::setStoreHardlinks(const char* sh, bool silent) {/*{{{*/
+    bool val;
+    if(parseSwitch(sh, val)) {
+        return setStoreHardlinks(val, silent);
+    }
+
+    if(!silent) {
+        fprintf(stderr,"Error: storeHardlinks must be either true or false.\n");
+    }
+
+    return false;
+}/*}}}*/
+
+/**
+ * Sets how large the store may grow, in MiB, before the packages used longest ago are dropped. 0 is unlimited
+ * Always returns true
+ *
+ * @param unsigned long long storeSize
+ * @param bool silent
+ *
+ * @returns bool true
+ */
+bool Options::setStoreSize(unsigned long long ss, bool silent) {/*{{{*/
+    storeSize = ss;
+    return true;
+}/*}}}*/
+
+/**
+ * Sets how large the store may grow, in MiB, before the packages used longest ago are dropped.
+ * This overload is meant to take the value straight from the command-line or a configuration file
+ *
+ * @param const char* storeSize
+ * @param bool silent
+ *
+ * @returns bool wasStoreSizeValid
+ */
+bool Options::setStoreSize(const char* ss, bool silent) {/*{{{*/
+    char* end = NULL;
+    long long val = strtoll(ss, &end, 10);
+
+    if(end != ss && *end == '\0' && val >= 0) {
+        return setStoreSize((unsigned long long)val, silent);
+    }
+
+    else {
+        if(!silent) {
+            fprintf(stderr,"Error: The store size must be a number of MiB, or 0 for no limit.\n");
+        }
+
+        return false;
+    }
+}/*}}}*/
+
+/**
+ * Sets the roots every package is installed into along with the system root, from a single read of its tarball.
+ * Each is a path, optionally followed by a colon and the root's own installed package directory. Without one, the installed package path is used within the root.
+ *
+ * Always returns true
+ *
+ * @param std::vector<std::string> fanoutRoots
+ * @param bool silent
+ *
+ * @returns bool true
+ */
+bool Options::setFanoutRoots(std::vector<std::string> fr, bool silent) {/*{{{*/
+    fanoutRoots = fr;
+    return true;
+}/*}}}*/
+
+/**
+ * Sets the roots every package is installed into along with the system root, from a single read of its tarball.
+ * This overload is meant to take the value straight from a configuration file, where the roots are separated by commas
+ *
+ * Always returns true
+ *
+ * @param const char* fanoutRootList
+ * @param bool silent
+ *
+ * @returns bool true
+ */
+bool Options::setFanoutRoots(const char* fr, bool silent) {/*{{{*/
+    std::vector<std::string> roots;
+    std::string list = fr;
+    size_t start = 0;
+
+    while(start <= list.size()) {
+        size_t end = list.find(',', start);
+        if(end == std::string::npos) {
+            end = list.size();
+        }
+
+        size_t first = list.find_first_not_of(" \t", start);
+        size_t last = list.find_last_not_of(" \t", end - 1);
+        if(first != std::string::npos && first < end && last != std::string::npos && last >= first) {
+            roots.push_back(list.substr(first, last - first + 1));
+        }
+
+        start = end + 1;
+    }
+
+    return setFanoutRoots(roots, silent);
+}/*}}}*/
+
 // @TODO Refactor this to have an actual integer verbosity level like everything else
 /**
  * OR's a given value with the current option mask.
@@ -594,7 +1201,7 @@ bool Options::addToOptMask(unsigned int opt, bool silent) {/*{{{*/
 
 // @TODO Refactor this to have an actual integer verbosity level like everything else
 /**
- * This adds the file path given to the excluded files set. Currently, however, the usage of that set is not implemented. As such, this option currently does not do anything.
+ * This adds the glob pattern given to the excluded files set.
  *
  * Always returns true
  *
@@ -608,6 +1215,146 @@ bool Options::addToExcludedFiles(std::string path, bool silent) {/*{{{*/
     return true;
 }/*}}}*/
 
+/**
+ * This adds a root to the roots installs are fanned out to.
+ *
+ * Always returns true
+ *
+ * @param std::string rootToAdd
+ * @param bool silent
+ *
+ * @returns bool true
+ */
+bool Options::addToFanoutRoots(std::string root, bool silent) {/*{{{*/
+    fanoutRoots.push_back(root);
+    return true;
+}/*}}}*/
+
+/**
+ * Sets how many of the upcoming packages' tarballs are read ahead while the current package installs. 0 disables reading ahead
+ * Always returns true
+ *
+ * @param unsigned int prefetchDepth
+ * @param bool silent
+ *
+ * @returns bool true
+ */
+bool Options::setPrefetchDepth(unsigned int pd, bool silent) {/*{{{*/
+    prefetchDepth = pd;
+    return true;
+}/*}}}*/
+
+/**
+ * Sets how many of the upcoming packages' tarballs are read ahead while the current package installs.
+ * This overload is meant to take the value straight from the command-line or a configuration file
+ *
+ * @param const char* prefetchDepth
+ * @param bool silent
+ *
+ * @returns bool wasPrefetchDepthValid
+ */
+bool Options::setPrefetchDepth(const char* pd, bool silent) {/*{{{*/
+    char* end = NULL;
+    long val = strtol(pd, &end, 10);
+
+    if(end != pd && *end == '\0' && val >= 0) {
+        return setPrefetchDepth((unsigned int)val, silent);
+    }
+
+    else {
+        if(!silent) {
+            fprintf(stderr,"Error: The prefetch depth must be a number of packages, or 0 to disable reading ahead.\n");
+        }
+
+        return false;
+    }
+}/*}}}*/
+
+/**
+ * Sets how much of the upcoming tarballs may be read ahead at once, in MiB
+ * Always returns true
+ *
+ * @param unsigned long long prefetchSize
+ * @param bool silent
+ *
+ * @returns bool true
+ */
+bool Options::setPrefetchSize(unsigned long long ps, bool silent) {/*{{{*/
+    prefetchSize = ps;
+    return true;
+}/*}}}*/
+
+/**
+ * Sets how much of the upcoming tarballs may be read ahead at once, in MiB
+ * This overload is meant to take the value straight from the command-line or a configuration file
+ *
+ * @param const char* prefetchSize
+ * @param bool silent
+ *
+ * @returns bool wasPrefetchSizeValid
+ */
+bool Options::setPrefetchSize(const char* ps, bool silent) {/*{{{*/
+    char* end = NULL;
+    long long val = strtoll(ps, &end, 10);
+
+    if(end != ps && *end == '\0' && val >= 0) {
+        return setPrefetchSize((unsigned long long)val, silent);
+    }
+
+    else {
+        if(!silent) {
+            fprintf(stderr,"Error: The prefetch size must be a number of MiB.\n");
+        }
+
+        return false;
+    }
+}/*}}}*/
+
+/**
+ * Sets the directory the extract mode writes members to, which is created if it doesn't exist. Empty writes them to standard output
+ * This is only ever given on the command-line, so there is no configuration key for it
+ * Always returns true
+ *
+ * @param std::string outputPath
+ * @param bool silent
+ *
+ * @returns bool true
+ */
+bool Options::setOutputPath(std::string op, bool silent) {/*{{{*/
+    outputPath = op;
+    return true;
+}/*}}}*/
+
+/**
+ * Sets the directory the member lists of library tarballs are cached in, which is created on first use. An empty path keeps them within the installed package database
+ * Always returns true
+ *
+ * @param std::string memberCachePath
+ * @param bool silent
+ *
+ * @returns bool true
+ */
+bool Options::setMemberCachePath(std::string mcp, bool silent) {/*{{{*/
+    // If the path given is not absolute, make it so
+    memberCachePath = mcp.empty() ? mcp : std::string(std::filesystem::absolute(mcp));
+    return true;
+}/*}}}*/
+
+/**
+ * Sets whether the build mode compresses the packages it writes with zstd, in independently decodable frames
+ * This is only ever given on the command-line, so there is no configuration key for it
+ * This function always returns true, since there cannot be an invalid value without error'ing out when the function is called
+ *
+ * @param bool buildZstd
+ * @param bool silent
+ *
+ * @returns bool wasBuildZstdValid
+ */
+bool Options::setBuildZstd(bool bz, bool silent) {/*{{{*/
+    buildZstd = bz;
+    return true;
+}/*}}}*/
+
 // @TODO Refactor this to have an actual integer verbosity level like everything else
 /**
  * Turns a mode string into an integer, per modeStrToInt
@@ -730,15 +1477,123 @@ bool Options::applyConfig(IConfigMap& conf, bool silent) {/*{{{*/
 
             case MASK_EXCLUDED_FILES: 
                 if((mask & MASK_EXCLUDED_FILES) == 0) {
-                    //@TODO
-                    if(!silent) {
-                        fprintf(stderr,"Warning: Excluded files not yet implemented...\n");
+                    if(!setExcludedFiles(it->second.c_str())) {
+                        return false;
                     }
                 }
 
                 break;
                                       
 
+            case MASK_JOBS:
+                if((mask & MASK_JOBS) == 0) {
+                    if(!setJobs(it->second.c_str())) {
+                        return false;
+                    }
+                }
+
+                break;
+
+            case MASK_WRITERS:
+                if((mask & MASK_WRITERS) == 0) {
+                    if(!setWriters(it->second.c_str())) {
+                        return false;
+                    }
+                }
+
+                break;
+
+            case MASK_QUARANTINE:
+                if((mask & MASK_QUARANTINE) == 0) {
+                    if(!setQuarantine(it->second.c_str())) {
+                        return false;
+                    }
+                }
+
+                break;
+
+            case MASK_STAGED:
+                if((mask & MASK_STAGED) == 0) {
+                    if(!setStaged(it->second.c_str())) {
+                        return false;
+                    }
+                }
+
+                break;
+
+            case MASK_DURABILITY:
+                if((mask & MASK_DURABILITY) == 0) {
+                    if(!setDurability(it->second.c_str())) {
+                        return false;
+                    }
+                }
+
+                break;
+
+            case MASK_STORE_PATH:
+                if((mask & MASK_STORE_PATH) == 0) {
+                    if(!setStorePath(it->second)) {
+                        return false;
+                    }
+                }
+
+                break;
+
+            case MASK_STORE_HARDLINKS:
+                if((mask & MASK_STORE_HARDLINKS) == 0) {
+                    if(!setStoreHardlinks(it->second.c_str())) {
+                        return false;
+                    }
+                }
+
+                break;
+
+            case MASK_STORE_SIZE:
+                if((mask & MASK_STORE_SIZE) == 0) {
+                    if(!setStoreSize(it->second.c_str())) {
+                        return false;
+                    }
+                }
+
+                break;
+
+            case MASK_FANOUT_ROOTS:
+                if((mask & MASK_FANOUT_ROOTS) == 0) {
+                    if(!setFanoutRoots(it->second.c_str())) {
+                        return false;
+                    }
+                }
+
+                break;
+
+            case MASK_PREFETCH_DEPTH:
+                if((mask & MASK_PREFETCH_DEPTH) == 0) {
+                    if(!setPrefetchDepth(it->second.c_str())) {
+                        return false;
+                    }
+                }
+
+                break;
+
+            case MASK_PREFETCH_SIZE:
+                if((mask & MASK_PREFETCH_SIZE) == 0) {
+                    if(!setPrefetchSize(it->second.c_str())) {
+                        return false;
+                    }
+                }
+
+                break;
+
+            case MASK_MEMBER_CACHE_PATH:
+                if((mask & MASK_MEMBER_CACHE_PATH) == 0) {
+                    if(!setMemberCachePath(it->second)) {
+                        return false;
+                    }
+                }
+
+                break;
+
+
             default: 
                 if(!silent) {
                     fprintf(stderr,"Warning: Unrecognized configuration option %s\n. Attempting to continue normally...",it->first.c_str());
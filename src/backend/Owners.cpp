@@ -0,0 +1,496 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Owners.cpp
+ * @error -1100
+ *
+ * The reverse index from installed paths to the packages owning them. See Owners.h for the layout.
+ * The index is only ever written by the installed package database, while it holds its lock, so the two are updated together.
+ */
+
+#include "Owners.h"
+
+/**
+ * Decodes the next entry of a block
+ *
+ * @param [in/out] const char*& p
+ * @param [in] const char* end
+ * @param [in/out] std::string& path The previous path, which is replaced by the decoded one
+ * @param [out] uint64_t& pkg
+ *
+ * @returns bool wasValid
+ */
+static bool nextEntry(const char*& p, const char* end, std::string& path, uint64_t& pkg) {/*{{{*/
+    uint64_t shared;
+    uint64_t suffixLen;
+
+    if(!getVarint(p, end, shared) || !getVarint(p, end, suffixLen) || shared > path.size() || suffixLen > (uint64_t)(end - p)) {
+        return false;
+    }
+
+    path.resize(shared);
+    path.append(p, suffixLen);
+    p += suffixLen;
+
+    return getVarint(p, end, pkg);
+}/*}}}*/
+
+/**
+ * Maps the owner index inside installedPkgsPath, if there is one
+ *
+ * @param [in] std::string installedPkgsPath
+ * @param [in] unsigned int verbosity
+ */
+OwnerIndex::OwnerIndex(std::string installedPkgsPath, unsigned int verbosity) {/*{{{*/
+    this->verbosity = verbosity;
+
+    std::string path = installedPkgsPath + "/" + OWNERS_FILENAME;
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        return;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size < OWNERS_HEADER_SIZE) {
+        close(fd);
+        return;
+    }
+
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(map == MAP_FAILED) {
+        return;
+    }
+
+    data = (const char*)map;
+    dataSize = st.st_size;
+
+    pkgCount = getLE(data + 12, 4);
+    entryCount = getLE(data + 16, 8);
+    blockCount = getLE(data + 24, 8);
+    uint64_t namesOffset = getLE(data + 32, 8);
+    blockIndexOffset = getLE(data + 40, 8);
+    generation = getLE(data + 48, 8);
+
+    // An index from an older version is simply rebuilt
+    if(memcmp(data, OWNERS_MAGIC, OWNERS_MAGIC_SIZE) == 0 && getLE(data + 8, 4) != OWNERS_VERSION) {
+        return;
+    }
+
+    if(memcmp(data, OWNERS_MAGIC, OWNERS_MAGIC_SIZE) != 0 || namesOffset != OWNERS_HEADER_SIZE || blockIndexOffset < namesOffset || blockIndexOffset > dataSize || blockCount > (dataSize - blockIndexOffset) / 8) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: The owner index %s is corrupt. It will be rebuilt.\n",path.c_str());
+        }
+
+        return;
+    }
+
+    const char* p = data + namesOffset;
+    const char* end = data + blockIndexOffset;
+    for(uint32_t index = 0; index < pkgCount; index++) {
+        if(end - p < 2 || (uint64_t)(end - p - 2) < getLE(p, 2)) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: The owner index %s is corrupt. It will be rebuilt.\n",path.c_str());
+            }
+
+            return;
+        }
+
+        size_t len = getLE(p, 2);
+        names.push_back(std::string(p + 2, len));
+        p += 2 + len;
+    }
+
+    valid = true;
+}/*}}}*/
+
+OwnerIndex::~OwnerIndex() {/*{{{*/
+    if(data != NULL) {
+        munmap((void*)data, dataSize);
+    }
+}/*}}}*/
+
+/**
+ * @returns bool isIndexUsable
+ */
+bool OwnerIndex::isValid() {/*{{{*/
+    return valid;
+}/*}}}*/
+
+/**
+ * @returns uint32_t The number of packages the index was built from, including packages which own no paths
+ */
+uint32_t OwnerIndex::getPkgCount() {/*{{{*/
+    return pkgCount;
+}/*}}}*/
+
+/**
+ * @returns uint64_t The generation of the installed package database the index was written for
+ */
+uint64_t OwnerIndex::getGeneration() {/*{{{*/
+    return generation;
+}/*}}}*/
+
+/**
+ * @returns std::vector<std::string> names The packages in the index, indexed by the ids used in its entries
+ */
+std::vector<std::string> OwnerIndex::getPkgNames() {/*{{{*/
+    return names;
+}/*}}}*/
+
+/**
+ * Reads the full path stored at the start of a block
+ *
+ * @param [in] uint64_t block
+ *
+ * @returns std::string path, or an empty string if the block is damaged
+ */
+std::string OwnerIndex::blockFirstPath(uint64_t block) {/*{{{*/
+    uint64_t offset = getLE(data + blockIndexOffset + block * 8, 8);
+    if(offset >= dataSize) {
+        return std::string();
+    }
+
+    const char* p = data + offset;
+    std::string path;
+    uint64_t pkg;
+
+    if(!nextEntry(p, data + dataSize, path, pkg)) {
+        return std::string();
+    }
+
+    return path;
+}/*}}}*/
+
+/**
+ * Decodes every entry in the index, in path order
+ *
+ * @returns std::vector<ownerEntry_s> entries
+ */
+std::vector<ownerEntry_s> OwnerIndex::getEntries() {/*{{{*/
+    std::vector<ownerEntry_s> entries;
+    if(!valid) {
+        return entries;
+    }
+
+    entries.reserve(entryCount);
+
+    for(uint64_t block = 0; block < blockCount; block++) {
+        uint64_t start = getLE(data + blockIndexOffset + block * 8, 8);
+        uint64_t stop = (block + 1 < blockCount) ? getLE(data + blockIndexOffset + (block + 1) * 8, 8) : dataSize;
+        if(start > stop || stop > dataSize) {
+            break;
+        }
+
+        const char* p = data + start;
+        const char* end = data + stop;
+        std::string path;
+        uint64_t pkg;
+
+        while(p < end && nextEntry(p, end, path, pkg)) {
+            if(pkg < names.size()) {
+                entries.push_back(ownerEntry_s{ path, (uint32_t)pkg });
+            }
+        }
+    }
+
+    return entries;
+}/*}}}*/
+
+/**
+ * Finds every package owning path
+ *
+ * @param [in] const std::string& path A path relative to the system root
+ *
+ * @returns std::vector<std::string> owners
+ */
+std::vector<std::string> OwnerIndex::findOwners(const std::string& path) {/*{{{*/
+    std::vector<std::string> owners;
+    if(!valid || blockCount == 0) {
+        return owners;
+    }
+
+    std::string key = normalizeMemberPath(path);
+
+    // Find the first block starting at or after the key. The key may also sit at the end of the block before it
+    uint64_t low = 0;
+    uint64_t high = blockCount;
+    while(low < high) {
+        uint64_t mid = low + (high - low) / 2;
+        if(blockFirstPath(mid) < key) {
+            low = mid + 1;
+        }
+
+        else {
+            high = mid;
+        }
+    }
+
+    // A path owned by many packages can span several blocks, so keep going until we're past it
+    for(uint64_t block = (low > 0) ? low - 1 : 0; block < blockCount; block++) {
+        uint64_t start = getLE(data + blockIndexOffset + block * 8, 8);
+        uint64_t stop = (block + 1 < blockCount) ? getLE(data + blockIndexOffset + (block + 1) * 8, 8) : dataSize;
+        if(start > stop || stop > dataSize) {
+            break;
+        }
+
+        const char* p = data + start;
+        const char* end = data + stop;
+        std::string cur;
+        uint64_t pkg;
+
+        while(p < end && nextEntry(p, end, cur, pkg)) {
+            int cmp = cur.compare(key);
+            if(cmp == 0 && pkg < names.size()) {
+                owners.push_back(names[pkg]);
+            }
+
+            else if(cmp > 0) {
+                return owners;
+            }
+        }
+    }
+
+    return owners;
+}/*}}}*/
+
+/**
+ * Lists the paths in a serialized manifest, in the form the owner index stores them
+ *
+ * @param [in] const std::string& manifest
+ *
+ * @returns std::vector<std::string> paths, empty if the manifest can't be parsed
+ */
+std::vector<std::string> manifestPaths(const std::string& manifest) {/*{{{*/
+    std::vector<std::string> paths;
+    std::vector<manifestEntry_s> entries;
+
+    if(parseManifest(manifest.data(), manifest.size(), entries) != 0) {
+        return paths;
+    }
+
+    paths.reserve(entries.size());
+    for(const manifestEntry_s& e : entries) {
+        std::string path = normalizeMemberPath(e.path);
+        if(!path.empty()) {
+            paths.push_back(path);
+        }
+    }
+
+    return paths;
+}/*}}}*/
+
+/**
+ * Writes the owner index from a sorted list of entries, and renames it into place
+ *
+ * @param [in] std::string installedPkgsPath
+ * @param [in] const std::vector<std::string>& names
+ * @param [in] const std::vector<ownerEntry_s>& entries Sorted by path
+ * @param [in] uint64_t generation
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 on success, or OWNERS_IO_ERROR
+ */
+static int writeOwnerEntries(std::string installedPkgsPath, const std::vector<std::string>& names, const std::vector<ownerEntry_s>& entries, uint64_t generation, unsigned int verbosity) {/*{{{*/
+    std::string nameTable;
+    for(const std::string& name : names) {
+        putLE(nameTable, name.size(), 2);
+        nameTable.append(name);
+    }
+
+    std::string blocks;
+    std::vector<uint64_t> blockOffsets;
+    const std::string* prev = NULL;
+
+    for(size_t index = 0; index < entries.size(); index++) {
+        const std::string& cur = entries[index].path;
+        size_t shared = 0;
+
+        if(index % OWNERS_BLOCK_ENTRIES == 0) {
+            blockOffsets.push_back(blocks.size());
+        }
+
+        else {
+            size_t limit = std::min(prev->size(), cur.size());
+            while(shared < limit && (*prev)[shared] == cur[shared]) {
+                shared++;
+            }
+        }
+
+        putVarint(blocks, shared);
+        putVarint(blocks, cur.size() - shared);
+        blocks.append(cur, shared, std::string::npos);
+        putVarint(blocks, entries[index].pkg);
+        prev = &cur;
+    }
+
+    uint64_t blockIndexOffset = OWNERS_HEADER_SIZE + nameTable.size();
+    uint64_t blocksOffset = blockIndexOffset + blockOffsets.size() * 8;
+
+    std::string buf;
+    buf.reserve(blocksOffset + blocks.size());
+    buf.append(OWNERS_MAGIC, OWNERS_MAGIC_SIZE);
+    putLE(buf, OWNERS_VERSION, 4);
+    putLE(buf, names.size(), 4);
+    putLE(buf, entries.size(), 8);
+    putLE(buf, blockOffsets.size(), 8);
+    putLE(buf, OWNERS_HEADER_SIZE, 8);
+    putLE(buf, blockIndexOffset, 8);
+    putLE(buf, generation, 8);
+    buf.append(nameTable);
+    for(uint64_t offset : blockOffsets) {
+        putLE(buf, blocksOffset + offset, 8);
+    }
+    buf.append(blocks);
+
+    std::string tmpPath = installedPkgsPath + "/" + OWNERS_TMP_FILENAME;
+    std::string path = installedPkgsPath + "/" + OWNERS_FILENAME;
+
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd < 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not create %s. %s\n",tmpPath.c_str(),strerror(errno));
+        }
+
+        return OWNERS_IO_ERROR;
+    }
+
+    size_t done = 0;
+    while(done < buf.size()) {
+        ssize_t w = write(fd, buf.data() + done, buf.size() - done);
+        if(w < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if(w < 0) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Could not write %s. %s\n",tmpPath.c_str(),strerror(errno));
+            }
+
+            close(fd);
+            unlink(tmpPath.c_str());
+            return OWNERS_IO_ERROR;
+        }
+
+        done += w;
+    }
+
+    if(fsync(fd) != 0 || close(fd) != 0 || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not update the owner index %s. %s\n",path.c_str(),strerror(errno));
+        }
+
+        unlink(tmpPath.c_str());
+        return OWNERS_IO_ERROR;
+    }
+
+    if(verbosity >= 4) {
+        printf("Wrote %lu paths owned by %lu packages (%lu bytes) to the owner index %s\n",entries.size(),names.size(),buf.size(),path.c_str());
+    }
+
+    return 0;
+}/*}}}*/
+
+/**
+ * Builds the owner index from scratch
+ *
+ * @param [in] std::string installedPkgsPath
+ * @param [in] const std::map<std::string, std::vector<std::string>>& pkgPaths The paths of every installed package with a manifest, per manifestPaths
+ * @param [in] uint64_t generation The generation of the installed package database pkgPaths came from
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 on success, or OWNERS_IO_ERROR
+ */
+int writeOwnerIndex(std::string installedPkgsPath, const std::map<std::string, std::vector<std::string>>& pkgPaths, uint64_t generation, unsigned int verbosity) {/*{{{*/
+    std::vector<std::string> names;
+    std::vector<ownerEntry_s> entries;
+
+    for(auto& it : pkgPaths) {
+        uint32_t id = names.size();
+        names.push_back(it.first);
+
+        for(const std::string& path : it.second) {
+            entries.push_back(ownerEntry_s{ path, id });
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const ownerEntry_s& a, const ownerEntry_s& b) { return a.path < b.path || (a.path == b.path && a.pkg < b.pkg); });
+    entries.erase(std::unique(entries.begin(), entries.end(), [](const ownerEntry_s& a, const ownerEntry_s& b) { return a.pkg == b.pkg && a.path == b.path; }), entries.end());
+
+    return writeOwnerEntries(installedPkgsPath, names, entries, generation, verbosity);
+}/*}}}*/
+
+/**
+ * Applies the changes from a single database update to the owner index
+ *
+ * The existing entries are already sorted, so only the added packages' paths need sorting. They're merged into the surviving entries in one pass, instead of rebuilding the index from every manifest.
+ *
+ * @param [in] std::string installedPkgsPath
+ * @param [in] const std::set<std::string>& removed Packages whose entries must go
+ * @param [in] const std::map<std::string, std::vector<std::string>>& added Packages to add, along with their paths. Any existing entries of these are replaced
+ * @param [in] uint64_t generation The generation of the installed package database after the update
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 on success, or OWNERS_IO_ERROR, including when there is no usable index to update
+ */
+int updateOwnerIndex(std::string installedPkgsPath, const std::set<std::string>& removed, const std::map<std::string, std::vector<std::string>>& added, uint64_t generation, unsigned int verbosity) {/*{{{*/
+    OwnerIndex old(installedPkgsPath, verbosity);
+    if(!old.isValid()) {
+        return OWNERS_IO_ERROR;
+    }
+
+    std::vector<std::string> oldNames = old.getPkgNames();
+
+    std::set<std::string> nameSet;
+    for(const std::string& name : oldNames) {
+        if(removed.count(name) == 0 && added.count(name) == 0) {
+            nameSet.insert(name);
+        }
+    }
+
+    for(auto& it : added) {
+        nameSet.insert(it.first);
+    }
+
+    std::vector<std::string> names(nameSet.begin(), nameSet.end());
+    std::map<std::string, uint32_t> ids;
+    for(uint32_t index = 0; index < names.size(); index++) {
+        ids[names[index]] = index;
+    }
+
+    // Translate the old ids, dropping the packages which were removed or replaced
+    std::vector<int64_t> remap(oldNames.size(), -1);
+    for(size_t index = 0; index < oldNames.size(); index++) {
+        if(removed.count(oldNames[index]) == 0 && added.count(oldNames[index]) == 0) {
+            remap[index] = ids[oldNames[index]];
+        }
+    }
+
+    std::vector<ownerEntry_s> kept;
+    for(ownerEntry_s& e : old.getEntries()) {
+        if(remap[e.pkg] >= 0) {
+            e.pkg = remap[e.pkg];
+            kept.push_back(std::move(e));
+        }
+    }
+
+    std::vector<ownerEntry_s> fresh;
+    for(auto& it : added) {
+        uint32_t id = ids[it.first];
+        for(const std::string& path : it.second) {
+            fresh.push_back(ownerEntry_s{ path, id });
+        }
+    }
+
+    auto byPath = [](const ownerEntry_s& a, const ownerEntry_s& b) { return a.path < b.path; };
+    std::sort(fresh.begin(), fresh.end(), [](const ownerEntry_s& a, const ownerEntry_s& b) { return a.path < b.path || (a.path == b.path && a.pkg < b.pkg); });
+    fresh.erase(std::unique(fresh.begin(), fresh.end(), [](const ownerEntry_s& a, const ownerEntry_s& b) { return a.pkg == b.pkg && a.path == b.path; }), fresh.end());
+
+    std::vector<ownerEntry_s> entries;
+    entries.reserve(kept.size() + fresh.size());
+    std::merge(std::make_move_iterator(kept.begin()), std::make_move_iterator(kept.end()), std::make_move_iterator(fresh.begin()), std::make_move_iterator(fresh.end()), std::back_inserter(entries), byPath);
+
+    return writeOwnerEntries(installedPkgsPath, names, entries, generation, verbosity);
+}/*}}}*/
@@ -0,0 +1,314 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Pipeline.cpp
+ * @error -800
+ *
+ * The multi-package install pipeline.
+ * Extraction is handed to a pool of worker threads, while the calling thread runs every script and database update itself, in the order the packages were given.
+ * Packages are dispatched strictly in order, and a package is only dispatched once none of the packages still in flight write any of its non-directory paths. A package with a pre-install script waits for every package before it to be committed, and nothing after a package with a post-install script is dispatched until that package was committed. Every script therefore sees the root as installing the packages one at a time would leave it. Because the dispatch decisions only depend on the package list and the number of jobs, and never on timing, two runs with the same arguments run their scripts in the same order, against the same root.
+ */
+
+#include "Pipeline.h"
+
+/**
+ * The paths a package writes, split by whether or not they may be shared with other packages
+ * Directories are shared freely; Anything else belongs to one package at a time
+ * collected tells a package which writes nothing apart from one whose paths weren't read yet
+ */
+struct pkgPaths_s {
+    std::vector<std::string> files;
+    std::vector<std::string> dirs;
+    bool collected = false;
+};
+
+/**
+ * Reads the headers of a package to find out what it will write
+ * Excluded paths, which include the scripts every package names the same, are never written, so they're left out
+ * Every directory above a member is written as well, whether or not the package has a member for it
+ *
+ * @param [in] Pkg& pkg
+ * @param [in] const ExclusionMatcher& exclusions
+ * @param [in] unsigned int verbosity
+ *
+ * @returns pkgPaths_s paths
+ */
+static pkgPaths_s collectPkgPaths(Pkg& pkg, const ExclusionMatcher& exclusions, unsigned int verbosity) {/*{{{*/
+    pkgPaths_s paths;
+    std::unordered_set<std::string> dirs;
+
+    for(const tarMember_s& m : pkg.getPkgMembers(verbosity)) {
+        std::string path = normalizeMemberPath(m.path);
+        if(path.empty() || exclusions.matches(path)) {
+            continue;
+        }
+
+        for(size_t slash = path.find('/'); slash != std::string::npos; slash = path.find('/', slash + 1)) {
+            dirs.insert(path.substr(0, slash));
+        }
+
+        if(m.type == TAR_TYPE_DIRECTORY) {
+            dirs.insert(path);
+        }
+
+        else {
+            paths.files.push_back(path);
+        }
+    }
+
+    paths.dirs.assign(dirs.begin(), dirs.end());
+    paths.collected = true;
+    return paths;
+}/*}}}*/
+
+/**
+ * Tracks the paths written by the packages which are currently being extracted
+ */
+class InstallWindow {/*{{{*/
+    private:
+        std::unordered_map<std::string, unsigned int> files;
+        std::unordered_map<std::string, unsigned int> dirs;
+
+    public:
+        // A file may not be written by two packages at once, and may not be where another package needs a directory, even one it only writes below
+        bool conflicts(const pkgPaths_s& p) {
+            for(const std::string& f : p.files) {
+                if(files.count(f) != 0 || dirs.count(f) != 0) {
+                    return true;
+                }
+            }
+
+            for(const std::string& d : p.dirs) {
+                if(files.count(d) != 0) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        void add(const pkgPaths_s& p) {
+            for(const std::string& f : p.files) {
+                files[f]++;
+            }
+
+            for(const std::string& d : p.dirs) {
+                dirs[d]++;
+            }
+        }
+
+        void remove(const pkgPaths_s& p) {
+            for(const std::string& f : p.files) {
+                if(--files[f] == 0) {
+                    files.erase(f);
+                }
+            }
+
+            for(const std::string& d : p.dirs) {
+                if(--dirs[d] == 0) {
+                    dirs.erase(d);
+                }
+            }
+        }
+};/*}}}*/
+
+/**
+ * Installs a list of packages, extracting up to jobs of them at the same time
+ *
+ * The calling thread acts as the dispatcher and the committer. It runs each package's pre-install script right before handing the package to a worker, and once the oldest package in flight is extracted, it runs that package's post-install script and follows it.
+ * Because of this, the scripts and the database updates happen one at a time, in command-line order. A package with a pre-install script is only dispatched once nothing is in flight, so its script never runs while earlier packages are still being extracted, or before their post-install scripts. A package with a post-install script is the last one in flight, so its script never runs while later packages are being extracted.
+ * With jobs set to 1, this behaves exactly like calling installPkgWithScripts on each package in turn.
+ *
+ * @param [in] std::vector<Pkg>& pkgs
+ * @param [in] std::string root
+ * @param [in] std::string installedPkgsPath
+ * @param [in] unsigned int verbosity
+ * @param [in] const ExclusionMatcher& exclusions
+ * @param [in] bool quick
+ * @param [in] unsigned int jobs
+ * @param [in] unsigned int writers, The number of threads writing out the files of each package
+ * @param [in] bool staged, Whether each package is extracted next to the root, and moved into place once it's complete
+ * @param [in] unsigned int durability, One of the DURABILITY_* modes. The transaction mode is left to the caller
+ * @param [in] ContentStore* store, If not NULL, packages are installed from and added to it
+ * @param [in] Prefetcher* prefetcher, If not NULL, told as each package is dispatched and extracted
+ *
+ * @returns int 0 if every package was installed, or minus the number of packages which failed
+ */
+int installPkgsPipelined(std::vector<Pkg>& pkgs, std::string root, std::string installedPkgsPath, unsigned int verbosity, const ExclusionMatcher& exclusions, bool quick, unsigned int jobs, unsigned int writers, bool staged, unsigned int durability, ContentStore* store, Prefetcher* prefetcher) {/*{{{*/
+    if(jobs < 1) {
+        jobs = 1;
+    }
+
+    // The scripts change our working directory while the workers are running, so nothing can be relative from here on
+    root = std::filesystem::absolute(root);
+    installedPkgsPath = std::filesystem::absolute(installedPkgsPath);
+
+    size_t n = pkgs.size();
+    std::vector<std::string> tarPaths;
+    for(size_t index = 0; index < n; index++) {
+        tarPaths.push_back(std::filesystem::absolute(pkgs[index].getPathname()));
+    }
+
+    std::vector<int> results(n, 0);
+    std::vector<bool> done(n, false);
+    std::vector<bool> dispatched(n, false);
+    std::vector<pkgPaths_s> paths(n);
+    std::deque<size_t> queue;
+    bool stopping = false;
+
+    std::mutex m;
+    std::condition_variable workCv;
+    std::condition_variable doneCv;
+
+    auto worker = [&]() {
+        while(true) {
+            size_t index;
+
+            {
+                std::unique_lock<std::mutex> lock(m);
+                workCv.wait(lock, [&]{ return stopping || !queue.empty(); });
+
+                if(queue.empty()) {
+                    return;
+                }
+
+                index = queue.front();
+                queue.pop_front();
+            }
+
+            int res = pkgs[index].installPkg(tarPaths[index], root, installedPkgsPath, verbosity, exclusions, quick, writers, staged, durability, store);
+
+            if(prefetcher != NULL) {
+                prefetcher->finish(index);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m);
+                results[index] = res;
+                done[index] = true;
+            }
+
+            doneCv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for(unsigned int index = 0; index < jobs && index < n; index++) {
+        workers.push_back(std::thread(worker));
+    }
+
+    if(verbosity >= 3) {
+        printf("Installing %lu packages with %lu worker threads\n",n,workers.size());
+    }
+
+    InstallWindow window;
+    size_t next = 0;
+    int failures = 0;
+
+    for(size_t commit = 0; commit < n; commit++) {
+        // Dispatch as far ahead as the window allows. Stopping at the first blocked package keeps everything in order
+        while(next < n && next - commit < jobs) {
+            // A package that was blocked last time around already has its paths
+            if(!paths[next].collected) {
+                paths[next] = collectPkgPaths(pkgs[next], exclusions, verbosity);
+            }
+
+            if(window.conflicts(paths[next])) {
+                if(verbosity >= 4) {
+                    printf("%s shares files with a package still being extracted. Waiting for it...\n",pkgs[next].getPkgName().c_str());
+                }
+
+                break;
+            }
+
+            // A pre-install script may look at anything in the root, so it conflicts with every package still in flight
+            if(next != commit && pkgs[next].hasScript(PRE_INSTALL_NAME, verbosity)) {
+                if(verbosity >= 4) {
+                    printf("%s has a pre-install script. Waiting for the packages before it to be installed...\n",pkgs[next].getPkgName().c_str());
+                }
+
+                break;
+            }
+
+            // So may a post-install script, so nothing is extracted past a package with one until it ran
+            // Every package in flight before the last one was dispatched with this check, so none of them have one
+            if(next != commit && pkgs[next - 1].hasScript(POST_INSTALL_NAME, verbosity)) {
+                if(verbosity >= 4) {
+                    printf("%s has a post-install script. Waiting for it to be installed before extracting %s...\n",pkgs[next - 1].getPkgName().c_str(),pkgs[next].getPkgName().c_str());
+                }
+
+                break;
+            }
+
+            if(verbosity >= 3) {
+                printf("Operation: install\nCurrent package: %s\n",pkgs[next].getPkgName().c_str());
+            }
+
+            if(prefetcher != NULL) {
+                prefetcher->start(next);
+            }
+
+            int pre = pkgs[next].runPreInstall(root, verbosity);
+
+            if(pre < 0) {
+                if(prefetcher != NULL) {
+                    prefetcher->finish(next);
+                }
+
+                std::lock_guard<std::mutex> lock(m);
+                results[next] = pre;
+                done[next] = true;
+            }
+
+            else {
+                window.add(paths[next]);
+                dispatched[next] = true;
+
+                {
+                    std::lock_guard<std::mutex> lock(m);
+                    queue.push_back(next);
+                }
+
+                workCv.notify_one();
+            }
+
+            next++;
+        }
+
+        // Wait for the oldest package to be extracted, then finish it off
+        int res;
+
+        {
+            std::unique_lock<std::mutex> lock(m);
+            doneCv.wait(lock, [&]{ return (bool)done[commit]; });
+            res = results[commit];
+        }
+
+        // Packages whose pre-install script failed were never added to the window, and must not be followed
+        if(!dispatched[commit]) {
+            failures++;
+            continue;
+        }
+
+        window.remove(paths[commit]);
+        paths[commit] = pkgPaths_s();
+
+        if(pkgs[commit].finishInstall(res, root, installedPkgsPath, verbosity) < 0) {
+            failures++;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m);
+        stopping = true;
+    }
+
+    workCv.notify_all();
+
+    for(std::thread& t : workers) {
+        t.join();
+    }
+
+    return -failures;
+}/*}}}*/
@@ -13,17 +13,21 @@
  * This sets up a Pkg object based on the path given.
  *
  * The tar library path is not taken into account by this function, in order to maintain loose coupling of parts. The extention is also required.
- * Currently, only *.tar packages are acceptable, but compressed packages will likely be added later.
+ * Any of PKG_EXTENSIONS is acceptable, so packages may be plain tarballs, or compressed with zstd, xz or gzip.
+ * If installedPkgsPath is given, a package whose tarball is gone is still accepted, as long as it is being followed.
+ * If memberCache is given, the members of an uncompressed tarball are looked up in it before its headers are walked. It has to outlive the package.
  * This sets the package name variable, verifies the existance of the package, and nothing else. Other variables are set only when they are used. Specifically, the package contents are only checked when uninstalling a package. However, this is likely to change when smart operation is implemented.
  */
-Pkg::Pkg(std::string path, unsigned int verbosity) {/*{{{*/
+Pkg::Pkg(std::string path, unsigned int verbosity, std::string installedPkgsPath, MemberCache* memberCache) {/*{{{*/
     pathname = path;
+    this->memberCache = memberCache;
 
     // Get the filename, then remove the extension
-    pkgName = std::filesystem::path(pathname).stem().string();
+    pkgName = pkgNameFromPath(pathname);
     
     // Verify the package actually exists
-    if(!std::filesystem::exists(pathname)) {
+    // An installed package can still be uninstalled or unfollowed from its manifest after its tarball has been pruned from the library
+    if(!std::filesystem::exists(pathname) && (installedPkgsPath.empty() || !PkgDatabase(installedPkgsPath, 0).contains(pkgName))) {
         if(verbosity != 0) {
             fprintf(stderr,"Package %s could not be found\n",pkgName.c_str());
         }
@@ -39,21 +43,238 @@ Pkg::Pkg(std::string path, unsigned int verbosity) {/*{{{*/
 std::set<std::string> Pkg::buildPkgContents(unsigned int verbosity) {/*{{{*/
     std::set<std::string> pkgSet;
 
+    for(const tarMember_s& m : getPkgMembers(verbosity)) {
+        pkgSet.insert(m.path);
+    }
+
+    return pkgSet;
+}/*}}}*/
+
+/**
+ * Builds the set of paths an installed package owns
+ *
+ * This reads the manifest stored in the installed package database when the package was followed, which works even if the tarball is gone.
+ * Packages followed before manifests existed have no manifest, so for those, and for damaged manifests, we fall back to reading the tarball.
+ *
+ * @param [in] std::string installedPkgsPath
+ * @param [in] unsigned int verbosity
+ *
+ * @returns std::set<std::string> pkgContents
+ */
+std::set<std::string> Pkg::loadPkgContents(std::string installedPkgsPath, unsigned int verbosity) {/*{{{*/
+    std::vector<manifestEntry_s> entries;
+    PkgDatabase db(installedPkgsPath, verbosity);
+    int res = db.getManifest(pkgName, entries);
+
+    if(res == 0) {
+        std::set<std::string> pkgSet;
+        for(const manifestEntry_s& e : entries) {
+            pkgSet.insert(pkgSet.end(), e.path);
+        }
+
+        if(verbosity >= 3) {
+            printf("Read %lu paths from the manifest of %s\n",pkgSet.size(),pkgName.c_str());
+        }
+
+        return pkgSet;
+    }
+
+    if(verbosity >= 3) {
+        printf("No usable manifest for %s. Reading the contents from the tarball instead\n",pkgName.c_str());
+    }
+
+    if(!std::filesystem::exists(pathname)) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: The package %s has neither a manifest nor a tarball. Its contents cannot be determined.\n",pkgName.c_str());
+        }
+
+        return std::set<std::string>();
+    }
+
+    return buildPkgContents(verbosity);
+}/*}}}*/
+
+/**
+ * Whether the members scanPkg walked still describe the tarball open at fd, so extraction can use their offsets instead of walking the headers again
+ * They don't if the tarball was replaced or changed since, which is told apart by its inode, size and modification time
+ *
+ * @param [in] int fd
+ *
+ * @returns bool canReuse
+ */
+bool Pkg::canReuseMembers(int fd) {/*{{{*/
+    struct stat st;
+    return walked && fstat(fd, &st) == 0 && st.st_dev == scannedStat.st_dev && st.st_ino == scannedStat.st_ino && st.st_size == scannedStat.st_size && st.st_mtim.tv_sec == scannedStat.st_mtim.tv_sec && st.st_mtim.tv_nsec == scannedStat.st_mtim.tv_nsec;
+}/*}}}*/
+
+/**
+ * Describes an entry libarchive read as one of our members. Its offsets are left at 0
+ *
+ * @param [in] struct archive_entry* ae
+ *
+ * @returns tarMember_s member
+ */
+static tarMember_s memberFromEntry(struct archive_entry* ae) {/*{{{*/
+    tarMember_s m;
+    m.path = archive_entry_pathname(ae);
+    m.size = archive_entry_size(ae);
+    m.mode = archive_entry_perm(ae);
+    m.mtime = archive_entry_mtime(ae);
+
+    switch(archive_entry_filetype(ae)) {
+        case AE_IFDIR:
+            m.type = TAR_TYPE_DIRECTORY;
+            break;
+        case AE_IFLNK:
+            m.type = TAR_TYPE_SYMLINK;
+            m.linkTarget = archive_entry_symlink(ae);
+            break;
+        case AE_IFREG:
+            m.type = TAR_TYPE_REGULAR;
+            break;
+        default:
+            m.type = TAR_TYPE_FIFO;
+            m.needsFallback = true;
+            break;
+    }
+
+    if(archive_entry_hardlink(ae) != NULL) {
+        m.type = TAR_TYPE_HARDLINK;
+        m.linkTarget = archive_entry_hardlink(ae);
+    }
+
+    return m;
+}/*}}}*/
+
+/**
+ * Reads the tarball once, recording every member along with the bodies of the pre- and post- install/uninstall scripts
+ *
+ * Uncompressed tarballs are read with our own header walker, which never touches file data, and the scripts are read straight from their offsets. A seekable package's index takes the place of the walk. See readPkgMembers.
+ * Anything else is read through libarchive, in which case the offsets of each member are left at 0. installPkgWithScripts usually spares a compressed package this pass, by capturing the same things while extracting it. See captureEntry.
+ * The results are kept, so installing a package, running its scripts and following it all share this one pass.
+ *
+ * @param [in] unsigned int verbosity
+ */
+void Pkg::scanPkg(unsigned int verbosity) {/*{{{*/
+    if(scanned) {
+        return;
+    }
+
+    scanned = true;
+    walked = false;
+    members.clear();
+    scripts.clear();
+
+    int fd = open(pathname.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd >= 0 && fstat(fd, &scannedStat) == 0 && isPlainTar(fd)) {
+        adviseSequential(fd);
+        int res = readPkgMembers(fd, members, (verbosity >= 3) ? verbosity : 0, memberCache);
+
+        if(res == 0) {
+            walked = true;
+
+            // A later member of the same name replaces an earlier one, just as it would on extraction
+            for(const tarMember_s& m : members) {
+                if(!isPkgScript(m.path) || !isRegularTarType(m.type)) {
+                    continue;
+                }
+
+                pkgScript_s script;
+                script.mode = m.mode;
+
+                if(!readTarRange(fd, m.dataOffset, m.size, script.body)) {
+                    if(verbosity != 0) {
+                        fprintf(stderr,"Error: Could not read the script %s from the package %s. %s\n",m.path.c_str(),pkgName.c_str(),strerror(errno));
+                    }
+
+                    continue;
+                }
+
+                scripts[normalizeMemberPath(m.path)] = script;
+            }
+
+            close(fd);
+            return;
+        }
+
+        members.clear();
+    }
+
+    if(fd >= 0) {
+        close(fd);
+    }
+
     // First, get a new archive struct and enable tar support
-    archive* a = archive_read_new();
-    if(!openArchiveWithTarSupport(a, pathname.c_str())) {
-        return std::set<std::string>{};
+    archive* a;
+    if(!openArchiveWithTarSupport(a, pathname.c_str(), verbosity)) {
+        return;
     }
     
     archive_entry* ae;
     
-    // Read our headers, and add each file path to our set
+    // Read our headers, and add each member to our list
     while(archive_read_next_header(a,&ae) == ARCHIVE_OK) {
-        std::string filePath = archive_entry_pathname(ae);
-        pkgSet.insert(filePath);
+        // A compressed package may still carry the index it had before it was compressed. It's no use to us
+        if(isPkgIndex(archive_entry_pathname(ae))) {
+            continue;
+        }
+
+        tarMember_s m = memberFromEntry(ae);
+
+        // The scripts are the only data we keep. libarchive skips over everything else for us
+        if(m.type == TAR_TYPE_REGULAR && isPkgScript(m.path)) {
+            captureScript(a, m, verbosity);
+        }
+
+        members.push_back(m);
     }
 
-    return pkgSet;
+    archive_read_free(a);
+}/*}}}*/
+
+/**
+ * Reads the body of one of the scripts from the entry libarchive is positioned at, and keeps it
+ *
+ * @param [in] struct archive* a
+ * @param [in] const tarMember_s& m
+ * @param [in] unsigned int verbosity
+ *
+ * @returns bool success
+ */
+bool Pkg::captureScript(struct archive* a, const tarMember_s& m, unsigned int verbosity) {/*{{{*/
+    pkgScript_s script;
+    script.mode = m.mode;
+
+    char buf[4096];
+    la_ssize_t r;
+    while((r = archive_read_data(a, buf, sizeof(buf))) > 0) {
+        script.body.append(buf, r);
+    }
+
+    if(r != 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not read the script %s from the package %s. %s\n",m.path.c_str(),pkgName.c_str(),archive_error_string(a));
+        }
+
+        return false;
+    }
+
+    scripts[normalizeMemberPath(m.path)] = script;
+    return true;
+}/*}}}*/
+
+/**
+ * Builds a list of the members of the package, in archive order, along with their types, sizes and modes
+ * See scanPkg for how the tarball is read
+ *
+ * @param [in] unsigned int verbosity
+ *
+ * @returns std::vector<tarMember_s> members, empty if the archive could not be read
+ */
+std::vector<tarMember_s> Pkg::getPkgMembers(unsigned int verbosity) {/*{{{*/
+    scanPkg(verbosity);
+
+    return members;
 }/*}}}*/
 
 /**
@@ -78,9 +299,18 @@ std::string Pkg::getPkgName() {/*{{{*/
 // @TODO Add in the capability for pre- and post- install scripts
 // @TODO Add in checks for whether or not each file already exists in the filesystem (this can be external, and then passed in the exclusions set)
 // @TODO Implement quick and smart modes. At the moment, it only operates in quick mode
-// @TODO Add a quarentine mode, such that all old files are moved to a temporary directory and then deleted from there after the fact. That will let us catch certain signals, and undo our actions
 */
-int Pkg::installPkg(std::string tarPath, std::string root, std::string installedPkgsPath, unsigned int verbosity, std::set<std::string> exclusions, bool quick) {/*{{{*/
+/**
+ * Extracts a package into the system root.
+ *
+ * By default, the files are written straight into the root, one member at a time. When staged, the package is first extracted next to the root, and only moved into place once all of it was extracted. See commitStaged.
+ * In the package and file durability modes, this only returns once the package has reached the disk. See WritebackTracker. The transaction mode is left to the caller.
+ * Given a store, a tarball it already holds is installed from it instead of being extracted, and any other tarball is added to it once extracted. See ContentStore.
+ * Given a hook, the tarball is always extracted through libarchive, and the hook is shown each of its headers. It's only meant for unstaged installs without a store. See entryHook_t.
+ *
+ * @returns int ARCHIVE_EOF on success, or an error code
+ */
+int Pkg::installPkg(std::string tarPath, std::string root, std::string installedPkgsPath, unsigned int verbosity, const ExclusionMatcher& exclusions, bool quick, unsigned int writers, bool staged, unsigned int durability, ContentStore* store, entryHook_t hook, void* hookContext) {/*{{{*/
     // Before doing anything, we should verify all paths we are given, sans exclusions, actually exist
     if(!std::filesystem::is_directory(std::filesystem::status(root))) {
         if(verbosity != 0) {
@@ -103,44 +333,148 @@ int Pkg::installPkg(std::string tarPath, std::string root, std::string installed
         }
     }
 
+    // Nothing in the root is touched until the package was extracted entirely
+    if(staged) {
+        std::string stagePath;
+        int err = makeStagingDir(root, getPkgName(), stagePath, verbosity);
+        if(err != 0) {
+            return err;
+        }
+
+        // commitStaged syncs the staged files before any of them are moved, so only the renames are left to wait on
+        int res = installPkg(tarPath, stagePath, installedPkgsPath, verbosity, exclusions, quick, writers, false, DURABILITY_NONE, store);
+        if(res == ARCHIVE_EOF) {
+            err = commitStaged(stagePath, root, verbosity);
+            if(err != 0) {
+                res = err;
+            }
+        }
 
-    // Add our scripts to our exclusions
-    addScriptsToExclusions(exclusions);
+        if(res == ARCHIVE_EOF && (durability == DURABILITY_PACKAGE || durability == DURABILITY_FILE)) {
+            double seconds = 0;
+            err = syncRoot(root, verbosity, &seconds);
+            if(err != 0) {
+                res = err;
+            }
 
-    // Open our tar file
-    archive* a;
-    archive_entry* ae;
-    if(!openArchiveWithTarSupport(a, tarPath.c_str(), verbosity)) {
-        return -113;
+            if(verbosity >= 3) {
+                printf("Waited %.3f seconds for %s to reach the disk (durability: %s)\n",seconds,getPkgName().c_str(),durabilityName(durability).c_str());
+            }
+        }
+
+        // Whatever the package replaced is left in the staging directory
+        discardStaged(root, stagePath);
+        return res;
     }
 
-    int err = 0;
-    int res = 0;
+    // The files only need to be handed over when something has to wait on them
+    WritebackTracker* tracker = NULL;
+    if(durability == DURABILITY_PACKAGE || durability == DURABILITY_FILE) {
+        tracker = new WritebackTracker(root, durability, verbosity);
+        if(!tracker->isOpen()) {
+            delete tracker;
+            return DURABILITY_ROOT_ERROR;
+        }
+    }
 
-    // Go through each header, and extract the files/folders
-    while((res = archive_read_next_header(a,&ae)) == ARCHIVE_OK && err == 0) {
-        // First, change our pathname to reflect our system root
-        const char* aePath = archive_entry_pathname(ae);
-        std::string new_aePath = root + "/";
-        new_aePath += aePath;
-        archive_entry_set_pathname(ae,new_aePath.c_str());
+    int res = (store != NULL) ? store->materialize(tarPath, getPkgName(), root, exclusions, tracker) : STORE_MISS;
+    if(res == STORE_MISS) {
+        res = extractPkg(tarPath, root, verbosity, exclusions, writers, tracker, hook, hookContext);
 
-        // Check our exception list
-        if(exclusions.find(std::string(new_aePath)) == exclusions.end()) {
-            err = archive_read_extract(a, ae, ARCHIVE_EXTRACT_ACL | ARCHIVE_EXTRACT_PERM | ARCHIVE_EXTRACT_SECURE_NODOTDOT | ARCHIVE_EXTRACT_XATTR);
+        // Not being able to store a package never fails its install
+        if(res == ARCHIVE_EOF && store != NULL) {
+            store->populate(tarPath, getPkgName(), getPkgMembers(verbosity), root, exclusions);
         }
     }
 
-    if(err != ARCHIVE_OK && err != ARCHIVE_EOF) {
-        if(verbosity != 0) {
-            fprintf(stderr,"Error: An error occured while reading the tar file %s.\n",pathname);
+    // This is the barrier: Nothing goes on to the post-install script or the database until the package is on the disk
+    if(tracker != NULL) {
+        if(res == ARCHIVE_EOF) {
+            int err = tracker->finish();
+            if(err != 0) {
+                res = err;
+            }
+
+            if(verbosity >= 3) {
+                printf("Waited %.3f seconds for %s to reach the disk (durability: %s, %lu files synced)\n",tracker->getSeconds(),getPkgName().c_str(),durabilityName(durability).c_str(),tracker->getFilesSynced());
+            }
         }
 
-        return err;
+        delete tracker;
     }
 
     return res;
+}/*}}}*/
+
+/**
+ * Extracts a package into root with whichever engine can handle it
+ *
+ * @param [in] std::string tarPath
+ * @param [in] std::string root
+ * @param [in] unsigned int verbosity
+ * @param [in] const ExclusionMatcher& exclusions
+ * @param [in] unsigned int writers
+ * @param [in] WritebackTracker* durability If not NULL, every entry extracted is reported to it
+ * @param [in] entryHook_t hook If not NULL, the tarball goes through libarchive, which shows the hook every header
+ * @param [in] void* hookContext
+ *
+ * @returns int ARCHIVE_EOF on success, or an error code
+ */
+int Pkg::extractPkg(std::string tarPath, std::string root, unsigned int verbosity, const ExclusionMatcher& exclusions, unsigned int writers, WritebackTracker* durability, entryHook_t hook, void* hookContext) {/*{{{*/
+    // Uncompressed tarballs keep each file's data contiguous, so we can have the kernel copy it straight out of the archive
+    // Compressed ones, and anything our own header walker doesn't understand, go through libarchive as before
+    int fd = open(tarPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd >= 0 && hook == NULL && isPlainTar(fd)) {
+        adviseSequential(fd);
+
+        // If the scripts were already run, the headers were already walked. Reuse them, unless the tarball was replaced since
+        bool reuse = canReuseMembers(fd);
+
+        // Anything our walker chokes on is retried with libarchive, so keep its complaints to the higher verbosities
+        std::vector<tarMember_s> walkedMembers;
+        int err = reuse ? 0 : readPkgMembers(fd, walkedMembers, (verbosity >= 3) ? verbosity : 0, memberCache);
+        const std::vector<tarMember_s>& members = reuse ? this->members : walkedMembers;
+
+        if(verbosity >= 4 && reuse) {
+            printf("Reusing the %lu headers already read from %s\n",members.size(),tarPath.c_str());
+        }
+
+        if(err == 0) {
+            std::set<std::string> fallbackPaths;
+            std::vector<std::pair<std::string, mode_t>> dirModes;
+            WriterPool* pool = (writers > 1) ? new WriterPool(writers, verbosity, durability) : NULL;
+            err = extractTarZeroCopy(fd, members, root, exclusions, fallbackPaths, verbosity, pool, durability, &dirModes);
+            delete pool;
+            close(fd);
+
+            if(err != 0) {
+                if(verbosity != 0) {
+                    fprintf(stderr,"Error: An error occured while extracting the tar file %s.\n",tarPath.c_str());
+                }
+
+                return err;
+            }
+
+            // Only the members the engine couldn't restore by itself are left. They go in before the directories are locked down
+            int res = ARCHIVE_EOF;
+            if(!fallbackPaths.empty()) {
+                res = extractWithLibarchive(tarPath, root, exclusions, &fallbackPaths, verbosity, DEFAULT_WRITERS, durability);
+            }
+
+            applyDirModes(root, dirModes, verbosity);
+            return res;
+        }
+
+        if(err != TAR_UNSUPPORTED && verbosity >= 3) {
+            printf("Could not read the headers of %s ourselves. Falling back to libarchive.\n",tarPath.c_str());
+        }
+    }
 
+    if(fd >= 0) {
+        close(fd);
+    }
+
+    return extractWithLibarchive(tarPath, root, exclusions, NULL, verbosity, writers, durability, hook, hookContext);
 }/*}}}*/
 
 // This function is here to work around the fact that I can't use member vars/functions as default parameters
@@ -148,19 +482,258 @@ int Pkg::installPkg(std::string tarPath, std::string root, std::string installed
  * Installs a package using the values set when constructing the object.
  * Calls the superset overload with the objects derived from the constructor.
  */
-int Pkg::installPkg(std::string root, std::string installedPkgsPath, unsigned int verbosity, std::set<std::string> exclusions, bool quick) {/*{{{*/
-    return installPkg(pathname, root, installedPkgsPath, verbosity, exclusions, quick);
+int Pkg::installPkg(std::string root, std::string installedPkgsPath, unsigned int verbosity, const ExclusionMatcher& exclusions, bool quick, unsigned int writers, bool staged, unsigned int durability, ContentStore* store) {/*{{{*/
+    return installPkg(pathname, root, installedPkgsPath, verbosity, exclusions, quick, writers, staged, durability, store);
 }/*}}}*/
 
 /**
  * Calls installPkg, followPkg, and the appropriate scripts at the approrpiate times
+ *
+ * A compressed package is decoded only once when it can be: Its members and scripts are captured while it's extracted, and the pre-install script is run right before the first entry is written. See captureEntry.
+ * Otherwise, or if the pre-install script can't be known to be missing by the time the first entry would be written, the package is scanned for its scripts first, and decoded a second time to be extracted.
+ */
+int Pkg::installPkgWithScripts(std::string root, std::string installedPkgsPath, unsigned int verbosity, const ExclusionMatcher& exclusions, bool quick, unsigned int writers, bool staged, unsigned int durability, ContentStore* store) {/*{{{*/
+    if(canInstallInOnePass(exclusions, staged, store)) {
+        scanned = true;
+        walked = false;
+        members.clear();
+        scripts.clear();
+
+        onePass_s pass;
+        pass.pkg = this;
+        pass.root = root;
+        pass.exclusions = &exclusions;
+        pass.verbosity = verbosity;
+
+        int res = installPkg(pathname, root, installedPkgsPath, verbosity, exclusions, quick, writers, staged, durability, store, captureEntry, &pass);
+
+        // Nothing was written, and no script was run, so we start over as if this never happened
+        if(res == ENTRY_STOPPED && !pass.preInstallRun) {
+            scanned = false;
+
+            if(verbosity >= 3) {
+                printf("Could not tell whether %s has a pre-install script before extracting it. Scanning it first\n",pathname.c_str());
+            }
+        }
+
+        else {
+            // A package with nothing to write out only runs its pre-install script once all of it was read
+            if(res == ARCHIVE_EOF && !pass.preInstallRun) {
+                pass.preInstallRes = runPreInstallScript(root, verbosity);
+            }
+
+            // What was captured of a package which didn't make it all the way through is no use to anyone else
+            if(res != ARCHIVE_EOF) {
+                scanned = false;
+            }
+
+            if(pass.preInstallRes < 0) {
+                return pass.preInstallRes;
+            }
+
+            return finishInstall(res, root, installedPkgsPath, verbosity);
+        }
+    }
+
+    int res = runPreInstall(root, verbosity);
+    if(res < 0) {
+        return res;
+    }
+
+    res = installPkg(root,installedPkgsPath,verbosity,exclusions,quick,writers,staged,durability,store);
+
+    return finishInstall(res, root, installedPkgsPath, verbosity);
+}/*}}}*/
+
+/**
+ * Installs the package into several roots, reading and decoding its tarball only once
+ *
+ * Each root runs the scripts and records the package in its own database, just as installPkgWithScripts would. A root which fails, at any step, is reported in its result, and never holds up the others.
+ * Staging and the package store aren't used. In the package and file durability modes, each root has a WritebackTracker of its own, which is waited on before the package is recorded there.
+ *
+ * @param [in/out] std::vector<fanoutRoot_s>& roots The result of each root is set
+ * @param [in] unsigned int verbosity
+ * @param [in] const ExclusionMatcher& exclusions
+ * @param [in] unsigned int durability
+ *
+ * @returns int The number of roots the package could not be installed into
+ */
+int Pkg::installPkgFanout(std::vector<fanoutRoot_s>& roots, unsigned int verbosity, const ExclusionMatcher& exclusions, unsigned int durability) {/*{{{*/
+    std::vector<std::string> targets;
+    std::vector<size_t> targetRoots;
+    std::vector<WritebackTracker*> trackers;
+
+    for(size_t index = 0; index < roots.size(); index++) {
+        fanoutRoot_s& r = roots[index];
+
+        if(!std::filesystem::is_directory(std::filesystem::status(r.root)) || !std::filesystem::is_directory(std::filesystem::status(r.installedPkgsPath))) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Either the root %s or its installed package directory %s is not a directory.\n",r.root.c_str(),r.installedPkgsPath.c_str());
+            }
+
+            r.result = FANOUT_ROOT_ERROR;
+            continue;
+        }
+
+        // The files only need to be handed over when something has to wait on them
+        WritebackTracker* tracker = NULL;
+        if(durability == DURABILITY_PACKAGE || durability == DURABILITY_FILE) {
+            tracker = new WritebackTracker(r.root, durability, verbosity);
+            if(!tracker->isOpen()) {
+                delete tracker;
+                r.result = DURABILITY_ROOT_ERROR;
+                continue;
+            }
+        }
+
+        r.result = runPreInstall(r.root, verbosity);
+        if(r.result < 0) {
+            delete tracker;
+            continue;
+        }
+
+        targets.push_back(r.root);
+        targetRoots.push_back(index);
+        trackers.push_back(tracker);
+    }
+
+    std::vector<int> results(targets.size(), 0);
+    if(!targets.empty()) {
+        extractPkgFanout(targets, results, verbosity, exclusions, trackers);
+    }
+
+    for(size_t index = 0; index < targets.size(); index++) {
+        fanoutRoot_s& r = roots[targetRoots[index]];
+        int res = (results[index] == 0) ? ARCHIVE_EOF : results[index];
+
+        // This is the barrier: Nothing goes on to the post-install script or the database until the package is on the disk
+        if(trackers[index] != NULL) {
+            if(res == ARCHIVE_EOF) {
+                int err = trackers[index]->finish();
+                if(err != 0) {
+                    res = err;
+                }
+
+                if(verbosity >= 3) {
+                    printf("Waited %.3f seconds for %s to reach the disk in %s (durability: %s, %lu files synced)\n",trackers[index]->getSeconds(),getPkgName().c_str(),r.root.c_str(),durabilityName(durability).c_str(),trackers[index]->getFilesSynced());
+                }
+            }
+
+            delete trackers[index];
+        }
+
+        r.result = finishInstall(res, r.root, r.installedPkgsPath, verbosity);
+    }
+
+    int failures = 0;
+    for(fanoutRoot_s& r : roots) {
+        if(r.result == ARCHIVE_EOF) {
+            r.installed++;
+        }
+
+        else {
+            r.failed.push_back(getPkgName());
+            failures++;
+        }
+    }
+
+    return failures;
+}/*}}}*/
+
+/**
+ * Extracts the package into every root with whichever engine can handle it
+ *
+ * @param [in] const std::vector<std::string>& roots
+ * @param [out] std::vector<int>& results 0 for each root which was extracted into, or a negative error code
+ * @param [in] unsigned int verbosity
+ * @param [in] const ExclusionMatcher& exclusions
+ * @param [in] const std::vector<WritebackTracker*>& durability The tracker of each root, or NULL for a root nothing waits on
  */
-int Pkg::installPkgWithScripts(std::string root, std::string installedPkgsPath, unsigned int verbosity, std::set<std::string> exclusions, bool quick) {/*{{{*/
+void Pkg::extractPkgFanout(const std::vector<std::string>& roots, std::vector<int>& results, unsigned int verbosity, const ExclusionMatcher& exclusions, const std::vector<WritebackTracker*>& durability) {/*{{{*/
+    results.assign(roots.size(), 0);
+
+    int fd = open(pathname.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd >= 0 && isPlainTar(fd)) {
+        adviseSequential(fd);
+
+        // The scripts were already run, so the headers were already walked. Reuse them, unless the tarball was replaced since
+        bool reuse = canReuseMembers(fd);
+
+        std::vector<tarMember_s> walkedMembers;
+        int err = reuse ? 0 : readPkgMembers(fd, walkedMembers, (verbosity >= 3) ? verbosity : 0, memberCache);
+        const std::vector<tarMember_s>& members = reuse ? this->members : walkedMembers;
+
+        if(err == 0) {
+            std::vector<std::set<std::string>> fallbackPaths;
+            std::vector<std::vector<std::pair<std::string, mode_t>>> dirModes;
+            extractTarFanout(fd, members, roots, exclusions, fallbackPaths, dirModes, results, verbosity, &durability);
+            close(fd);
+
+            // Only the members the engine couldn't restore by itself are left. They're rare enough to be read once per root, and go in before the directories are locked down
+            for(size_t index = 0; index < roots.size(); index++) {
+                if(results[index] == 0 && !fallbackPaths[index].empty()) {
+                    int res = extractWithLibarchive(pathname, roots[index], exclusions, &fallbackPaths[index], verbosity, DEFAULT_WRITERS, durability[index]);
+                    results[index] = (res == ARCHIVE_EOF) ? 0 : res;
+                }
+
+                if(results[index] == 0) {
+                    applyDirModes(roots[index], dirModes[index], verbosity);
+                }
+            }
+
+            return;
+        }
+    }
+
+    if(fd >= 0) {
+        close(fd);
+    }
+
+    archive* a;
+    if(!openArchiveWithTarSupport(a, pathname.c_str(), verbosity)) {
+        results.assign(roots.size(), -113);
+        return;
+    }
+
+    int err = extractArchiveFanout(a, roots, exclusions, results, verbosity, &durability);
+    archive_read_free(a);
+
+    if(err != 0 && verbosity != 0) {
+        fprintf(stderr,"Error: An error occured while reading the tar file %s.\n",pathname.c_str());
+    }
+}/*}}}*/
+
+/**
+ * Runs the pre-install script from within the system root, then returns to the old working directory
+ * This is the part of installPkgWithScripts which comes before any files are written
+ *
+ * @param [in] std::string root
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int scriptResult, negative if we should bail out
+ */
+int Pkg::runPreInstall(std::string root, unsigned int verbosity) {/*{{{*/
+    // Read the package while its path still means what the caller meant by it. The scripts and members are kept from here on
+    scanPkg(verbosity);
+
+    return runPreInstallScript(root, verbosity);
+}/*}}}*/
+
+/**
+ * Runs the pre-install script the package was already scanned for, from within the system root, then returns to the old working directory
+ *
+ * @param [in] std::string root
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int scriptResult, negative if we should bail out
+ */
+int Pkg::runPreInstallScript(std::string root, unsigned int verbosity) {/*{{{*/
     // Store our original working directory
     char* oldDir = get_current_dir_name();
 
     // cd into the system root
     if(!moveToDir(root,verbosity)) {
+        free(oldDir);
         return -118;
     }
 
@@ -170,68 +743,188 @@ int Pkg::installPkgWithScripts(std::string root, std::string installedPkgsPath,
         if(verbosity != 0) {
             fprintf(stderr,"Error: The pre-install script for the package %s returned error code %d. Bailing out...\n",pkgName.c_str(), res);
         }
-
-        return res;
     }
 
-    // Return to the old directory
+    // Return to the old directory, even when bailing out, since the packages after this one may still be installed
     // Don't use moveToDir so we can be more specific with our error
     if(chdir(oldDir) != 0) {
         if(verbosity != 0) {
             fprintf(stderr,"Error: Could not return to the old working directory %s after running the pre-install script. Bailing out...\n",oldDir);
         }
 
-        return -114;
+        free(oldDir);
+        return (res < 0) ? res : -114;
     }
-    
-    res = installPkg(root,installedPkgsPath,verbosity,exclusions,quick);
 
-    if(res == ARCHIVE_EOF) {
-        // cd into the system root
-        if(!moveToDir(root,verbosity)) {
-            return -113;
+    free(oldDir);
+
+    return res;
+}/*}}}*/
+
+/**
+ * Whether installPkgWithScripts can capture the scripts while extracting the package, instead of scanning it first
+ * Only a compressed package which wasn't scanned yet, installed straight into the root, can. Its scripts and metadata have to be excluded, since their data is read by captureEntry instead of being extracted
+ *
+ * @param [in] const ExclusionMatcher& exclusions
+ * @param [in] bool staged
+ * @param [in] ContentStore* store
+ *
+ * @returns bool canInstallInOnePass
+ */
+bool Pkg::canInstallInOnePass(const ExclusionMatcher& exclusions, bool staged, ContentStore* store) {/*{{{*/
+    if(scanned || staged || store != NULL || !exclusions.matches(PKG_META_NAME)) {
+        return false;
+    }
+
+    for(const char* name : PKG_SCRIPT_NAMES) {
+        if(!exclusions.matches(name)) {
+            return false;
         }
+    }
 
-        // Run our post-install script, if it exists
-        int scriptRes = execPostInstallScript(verbosity);
-        if(scriptRes < 0) {
-            if(verbosity != 0) {
-                fprintf(stderr,"Error: The post-install script for the package %s returned error code %d. Attempting to continue...\n",pkgName.c_str(),res);
-            }
+    // An uncompressed tarball is scanned without touching its data, so there's nothing to save
+    int fd = open(pathname.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        return false;
+    }
+
+    bool plain = isPlainTar(fd);
+    close(fd);
+
+    return !plain;
+}/*}}}*/
+
+/**
+ * The hook installPkgWithScripts extracts a compressed package with. It records every member and captures the scripts, just as scanPkg would
+ *
+ * The pre-install script is run right before the first entry which will be written. By then, it has to have been read, or the metadata has to have said there is none. Otherwise, the extraction is stopped before anything was written.
+ * PkgBuild puts the metadata, then the scripts, ahead of everything else, so the packages it builds are always extracted in this one pass.
+ *
+ * @param [in] struct archive* a
+ * @param [in] struct archive_entry* ae
+ * @param [in/out] void* context The onePass_s of the install
+ *
+ * @returns int ENTRY_EXTRACT, ENTRY_SKIP, or ENTRY_STOPPED
+ */
+int Pkg::captureEntry(struct archive* a, struct archive_entry* ae, void* context) {/*{{{*/
+    onePass_s* pass = (onePass_s*)context;
+    Pkg* pkg = pass->pkg;
+
+    // A compressed package may still carry the index it had before it was compressed. It's no use to us
+    const char* aePath = archive_entry_pathname(ae);
+    if(aePath == NULL || isPkgIndex(aePath)) {
+        return ENTRY_SKIP;
+    }
+
+    tarMember_s m = memberFromEntry(ae);
+    pkg->members.push_back(m);
+
+    if(m.type == TAR_TYPE_REGULAR && isPkgScript(m.path)) {
+        if(pkg->captureScript(a, m, pass->verbosity) && pass->preInstallRun && normalizeMemberPath(m.path) == PRE_INSTALL_NAME && pass->verbosity != 0) {
+            fprintf(stderr,"Error: The metadata of %s says it has no pre-install script, but it has one after the files it should have run before. It was not run.\n",pkg->pkgName.c_str());
         }
-        
-        // Return to the old directory
-        // Don't use moveToDir so we can be more specific with our error
-        if(chdir(oldDir) != 0) {
-            if(verbosity != 0) {
-                fprintf(stderr,"Error: Could not return to the old working directory %s after running the post-install script. This is mostly harmless, unless tests are being run...\n",oldDir);
-            }
+
+        return ENTRY_SKIP;
+    }
+
+    // The metadata is always the first member, and lists the scripts the package has
+    if(m.type == TAR_TYPE_REGULAR && isPkgMeta(m.path) && pkg->members.size() == 1 && m.size <= PKG_META_MAX_SIZE) {
+        std::string data;
+        char buf[PKG_META_READ_SIZE];
+        la_ssize_t r;
+        while((r = archive_read_data(a, buf, sizeof(buf))) > 0) {
+            data.append(buf, r);
         }
 
-        if(followPkg(installedPkgsPath, verbosity)) {
-            if(verbosity >= 2) {
-                printf("The package %s has been installed!\n",getPkgName().c_str());
-            }
+        // Metadata without a list of scripts doesn't say there's no pre-install script
+        pkgMeta_s meta;
+        meta.scripts = PKG_META_PRE_INSTALL;
+        if(r == 0 && parsePkgMeta(data, meta, (pass->verbosity >= 3) ? pass->verbosity : 0)) {
+            pass->noPreInstall = (meta.scripts & PKG_META_PRE_INSTALL) == 0;
         }
 
-        else {
-            if(verbosity != 0) {
-                fprintf(stderr,"The package appears to have been installed, but the database could not be updated. Run \"touch %s\" to update the database\n",(installedPkgsPath + "/" + getPkgName()).c_str());
-            }
+        return ENTRY_SKIP;
+    }
+
+    if(pass->exclusions->matches(aePath) || pass->exclusions->matches(archive_entry_hardlink(ae))) {
+        return ENTRY_SKIP;
+    }
+
+    if(!pass->preInstallRun) {
+        if(!pass->noPreInstall && pkg->scripts.count(PRE_INSTALL_NAME) == 0) {
+            return ENTRY_STOPPED;
+        }
+
+        pass->preInstallRun = true;
+        pass->preInstallRes = pkg->runPreInstallScript(pass->root, pass->verbosity);
+        if(pass->preInstallRes < 0) {
+            return ENTRY_STOPPED;
         }
     }
 
-    else {
+    return ENTRY_EXTRACT;
+}/*}}}*/
+
+/**
+ * Runs the post-install script and follows the package, given the result of installPkg
+ * This is the part of installPkgWithScripts which comes after the files are written
+ *
+ * @param [in] int installRes, the return value of installPkg
+ * @param [in] std::string root
+ * @param [in] std::string installedPkgsPath
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int installRes, or a negative value if the package could not be installed
+ */
+int Pkg::finishInstall(int installRes, std::string root, std::string installedPkgsPath, unsigned int verbosity) {/*{{{*/
+    if(installRes != ARCHIVE_EOF) {
         if(verbosity != 0) {
-            fprintf(stderr,"Error: The archive ran into an issue while attempting to install the package %s.  Bailing out...\n");
+            fprintf(stderr,"Error: The archive ran into an issue while attempting to install the package %s.  Bailing out...\n",pkgName.c_str());
         }
 
         return -114;
     }
 
+    // Store our original working directory
+    char* oldDir = get_current_dir_name();
+
+    // cd into the system root
+    if(!moveToDir(root,verbosity)) {
+        free(oldDir);
+        return -113;
+    }
+
+    // Run our post-install script, if it exists
+    int scriptRes = execPostInstallScript(verbosity);
+    if(scriptRes < 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: The post-install script for the package %s returned error code %d. Attempting to continue...\n",pkgName.c_str(),scriptRes);
+        }
+    }
+    
+    // Return to the old directory
+    // Don't use moveToDir so we can be more specific with our error
+    if(chdir(oldDir) != 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not return to the old working directory %s after running the post-install script. This is mostly harmless, unless tests are being run...\n",oldDir);
+        }
+    }
+
     free(oldDir);
 
-    return res;
+    if(followPkg(installedPkgsPath, verbosity, true)) {
+        if(verbosity >= 2) {
+            printf("The package %s has been installed!\n",getPkgName().c_str());
+        }
+    }
+
+    else {
+        if(verbosity != 0) {
+            fprintf(stderr,"The package appears to have been installed, but the database could not be updated. Run \"pkg-mgr -m f %s\" to add it to the database\n",getPkgName().c_str());
+        }
+    }
+
+    return installRes;
 }/*}}}*/
 
 // Here, we can just look at the package contents and remove the files
@@ -240,122 +933,60 @@ int Pkg::installPkgWithScripts(std::string root, std::string installedPkgsPath,
 // @TODO Add in checks for any shared files between packages (this can be external, and then passed in the exclusions set)
 // @TODO Implement quick and smart modes. At the moment, it only operates in quick mode
 // @TODO Decide on whether I want more sophisticated decision making, even for quick mode. Specifically, if we should delete pipes, block devices, sockets, character devices, etc
-// @TODO Add a quarentine mode, such that all files are moved to a temporary directory and then deleted from there. That will let us catch certain signals, and undo our actions
 // @TODO Seperate the installation and the scripts, have another function call them both
 /**
  * Removes the files which are contained in a package.
  *
- * Currently, this does not check for other packages which have file collisions with the package being uninstalled. In addition, instead of moving the files to a temporary directory to be removed, it simply removes the files outright, as if calling "rm" on the file from a shell. This means that if we cancel an uninstallation part-way through, the damage cannot be undone. This is likely going to be changed in the future.
+ * Currently, this does not check for other packages which have file collisions with the package being uninstalled.
+ * By default, the files are removed outright, as if calling "rm" on the file from a shell, so if we cancel an uninstallation part-way through, the damage cannot be undone. See removePkgPaths.
+ * In quarantine mode, the package is instead moved into a trash directory under the system root, and deleted from there once it's entirely out of place. Until then, it can be put back. See quarantinePkgPaths.
+ *
+ * @returns int objectsRemoved, or a negative error code
  */
-int Pkg::uninstallPkg(std::set<std::string> pkgContents, std::string root, std::string installedPkgsPath, unsigned int verbosity, std::set<std::string> exclusions, bool quick) {/*{{{*/
+int Pkg::uninstallPkg(std::set<std::string> pkgContents, std::string root, std::string installedPkgsPath, unsigned int verbosity, const ExclusionMatcher& exclusions, bool quick, bool quarantine) {/*{{{*/
     // Before doing anything, we should verify all paths we are given, sans exclusions, actually exist
     if(!std::filesystem::is_directory(std::filesystem::status(root))) {
-        if(verbosity != 0) {
-            fprintf(stderr,"Error: The installation path must be a directory, or a symbolic link to a directory.\n");
-        }
-
-        return -110;
-    }
-
-    if(!std::filesystem::is_directory(std::filesystem::status(installedPkgsPath))) {
-        if(verbosity != 0) {
-            fprintf(stderr,"Error: The \"installed packages\" path must be a directory, or a symbolic link to a directory.\n");
-        }
-
-        return -111;
-    }
-
-    // Add our scripts to our exclusions
-    addScriptsToExclusions(exclusions);
-
-    // Next, delete all the files within the package
-    // To do this, we'll interate through our pkgContents
-    // While doing so, we'll remove the files while putting directory paths into another vector
-    // After we've deleted all the files, we'll delete all the now-empty directories within our package. We do this so we don't remove the root directory or anything of the like.
-    int objectsRemoved = 0;
-    int res = 0;
-
-    // Turn our package contents into a vector
-    std::vector<std::string> pkgContentsVector(pkgContents.begin(),pkgContents.end());
-
-    // We know this vector is in alphabetical order, due to the stdlib implementation of sets
-    // Because of this, if we iterate backwards through the paths, we will definitly get our deepest ones first
-    // This means that if only the package wrote to those folders, they'll be empty, and we can safely delete them
-    for(int index = pkgContentsVector.size() - 1; index >= 0; index--) {
-        // Make a std::filesystem::path object so we can execute fs functions on it
-        std::filesystem::path filePath = std::string(root + "/" + pkgContentsVector[index]);
-
-        // If we're supposed to ignore the file, move on to the next one
-        if(exclusions.find(filePath) != exclusions.end()) {
-            continue;
-        }
-
-        // Check if its a directory. May want to check if its a symlink too...
-        // @TODO
-        bool isDir = std::filesystem::is_directory(filePath);
-        bool exists = std::filesystem::exists(filePath);
-        bool isEmpty = true;
-        
-        // This is to prevent errors arising from running is_empty on a non-existent path
-        if(exists) {
-            isEmpty = std::filesystem::is_empty(filePath);
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: The installation path must be a directory, or a symbolic link to a directory.\n");
         }
 
-        // If it's an empty directory or some sort of file, remove it
-        // @TODO Make this not be dangerous with things like device files
-        if((isDir && isEmpty) || (exists && !isDir)) {
-            if(std::filesystem::remove(filePath)) {
-                // If we're here, remove returned 0. Tick our counter and move on.
-                objectsRemoved++;
-                continue;
-            }
-
-            else {
-                if(verbosity != 0) {
-                    fprintf(stderr,"The path %s existed, but could not be removed\n",filePath.c_str());
-                }
-                res = -1;
-            }
-        }
+        return -110;
+    }
 
-        // If it didn't exist, print a message saying so...
-        else if (!exists) {
-            if(verbosity != 0) {
-                fprintf(stderr,"The path %s did not exist in the filesystem. Continuing.\n", filePath.c_str());
-            }
+    if(!std::filesystem::is_directory(std::filesystem::status(installedPkgsPath))) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: The \"installed packages\" path must be a directory, or a symbolic link to a directory.\n");
         }
 
-        else if (isDir && !isEmpty) {
-            if(verbosity != 0) {
-                fprintf(stderr,"The path %s is a non-empty directory, and so cannot be removed. Continuing.\n",filePath.c_str());
-            }
-        }
+        return -111;
+    }
 
-        else {
-            // @TODO Make this less helpful /s
-            // Added in strerror. Not sure if that actually makes this more helpful though, considering I don't even know what would cause this.
-            if(verbosity != 0) {
-                fprintf(stderr,"Error: Something went wrong while uninstalling %s, a part of %s, and we cannot tell what. strerror may. %s\n",filePath.c_str(),pkgName.c_str(),strerror(errno));
-            }
-        }
+    if(quarantine) {
+        return quarantinePkgPaths(pkgContents, root, getPkgName(), exclusions, verbosity);
     }
 
-    // Finally, return our objectsRemoved count
-    return objectsRemoved;
+    // Delete everything in the package, a directory at a time, leaving any directory which still holds something else
+    return removePkgPaths(pkgContents, root, exclusions, verbosity);
 }/*}}}*/
 
 /**
  * Uninstalls a package using the values set when constructing the object.
- * Calls the superset overload with the objects derived from the constructor.
+ * Calls the superset overload with the contents recorded in the package's manifest, falling back to the tarball.
  */
-int Pkg::uninstallPkg(std::string root, std::string installedPkgsPath, unsigned int verbosity, std::set<std::string> exclusions, bool quick) {/*{{{*/
-    return uninstallPkg(buildPkgContents(verbosity), root, installedPkgsPath, verbosity, exclusions, quick);
+int Pkg::uninstallPkg(std::string root, std::string installedPkgsPath, unsigned int verbosity, const ExclusionMatcher& exclusions, bool quick, bool quarantine) {/*{{{*/
+    return uninstallPkg(loadPkgContents(installedPkgsPath, verbosity), root, installedPkgsPath, verbosity, exclusions, quick, quarantine);
 }/*}}}*/
 
 /**
  * Calls uninstallPkg, unfollowPkg, and the appropriate scripts at the appropriate times
  */
-int Pkg::uninstallPkgWithScripts(std::string root, std::string installedPkgsPath, unsigned int verbosity, std::set<std::string> exclusions, bool quick) {/*{{{*/
+int Pkg::uninstallPkgWithScripts(std::string root, std::string installedPkgsPath, unsigned int verbosity, const ExclusionMatcher& exclusions, bool quick, bool quarantine) {/*{{{*/
+    // As when installing, the package has to be read before its path stops making sense
+    // A package whose tarball was pruned has no scripts left to run, so there's nothing to read
+    if(std::filesystem::exists(pathname)) {
+        scanPkg(verbosity);
+    }
+
     // Store our old working directory
     char* oldDir = get_current_dir_name();
 
@@ -384,7 +1015,7 @@ int Pkg::uninstallPkgWithScripts(std::string root, std::string installedPkgsPath
         return -114;
     }
 
-    res = uninstallPkg(root, installedPkgsPath, verbosity, exclusions, quick);
+    res = uninstallPkg(root, installedPkgsPath, verbosity, exclusions, quick, quarantine);
 
     // Move back into our system root for the post script
     if(!moveToDir(root,verbosity)) {
@@ -429,100 +1060,253 @@ int Pkg::uninstallPkgWithScripts(std::string root, std::string installedPkgsPath
 }/*}}}*/
 
 /**
- * Creates a file in the installed package index directory for the given Pkg object.
+ * The members of a package which end up in the root, which is all of them but the scripts, the metadata and the package index
+ *
+ * @param [in] const std::vector<tarMember_s>& members
+ *
+ * @returns std::vector<tarMember_s> installed
+ */
+static std::vector<tarMember_s> installedMembers(const std::vector<tarMember_s>& members) {/*{{{*/
+    std::vector<tarMember_s> installed;
+    installed.reserve(members.size());
+
+    for(const tarMember_s& m : members) {
+        if(!isPkgScript(m.path) && !isPkgMeta(m.path) && !isPkgIndex(m.path)) {
+            installed.push_back(m);
+        }
+    }
+
+    return installed;
+}/*}}}*/
+
+/**
+ * The version the metadata of a package gives, if it has any
+ *
+ * @param [in] const std::string& tarPath
+ * @param [in] unsigned int verbosity
+ *
+ * @returns std::string version, empty if the package has no metadata
+ */
+static std::string pkgVersion(const std::string& tarPath, unsigned int verbosity) {/*{{{*/
+    pkgMeta_s meta;
+    return (readPkgMeta(tarPath, meta, verbosity) == 0) ? meta.version : "";
+}/*}}}*/
+
+/**
+ * Adds the given Pkg object to the installed package database, along with its manifest, which lists every path the package installed, so it can later be uninstalled without its tarball.
+ * The version is taken from the package's metadata. Packages without metadata are recorded without one.
  *
- * This function verifies whether or not the package is already being followed (file matching the package name in the index directory), and if it is, does not touch it.
+ * This function verifies whether or not the package is already being followed, and if it is, does not touch it.
  * This is such that the user can still check when the package was followed/installed, even if they call this function after doing so.
+ * When the package was just installed, though, its files came from this tarball, which may not be the one it was followed from. Its manifest is then always rewritten, still keeping the time it was first followed.
+ *
+ * @param [in] std::string installedPkgsPath
+ * @param [in] unsigned int verbosity
+ * @param [in] bool installed Whether the package was just installed from its tarball
  */
-bool Pkg::followPkg(std::string installedPkgsPath, unsigned int verbosity) {/*{{{*/
-    std::string path = installedPkgsPath + "/" + pkgName;
-    bool exists = std::filesystem::exists(path);
-
-    // If it's not there, create it
-    if(!exists) {
-        std::ofstream o;
-        o.open(path);
-        o.close();
-        
-        // Check again, If it's there, say so
-        // Update the var so we don't check the disk again at return
-        exists = std::filesystem::exists(path);
-        if(exists) {
-            if(verbosity >= 2) {
-                printf("You are now following %s\n",pkgName.c_str());
+bool Pkg::followPkg(std::string installedPkgsPath, unsigned int verbosity, bool installed) {/*{{{*/
+    PkgDatabase db(installedPkgsPath, verbosity);
+    dbRecord_s rec;
+
+    if(db.lookup(pkgName, rec)) {
+        // Packages followed before manifests existed get one now, keeping the time they were followed
+        if((installed || rec.manifest.empty()) && std::filesystem::exists(pathname)) {
+            std::string manifest = serializeManifest(manifestFromMembers(installedMembers(getPkgMembers(verbosity))));
+            std::string version = pkgVersion(pathname, verbosity);
+
+            if(manifest != rec.manifest || version != rec.version) {
+                rec.manifest = manifest;
+                rec.version = version;
+
+                if(db.put(rec) != 0) {
+                    if(verbosity != 0) {
+                        fprintf(stderr,"Attempt to update the database in %s could not be completed\n",installedPkgsPath.c_str());
+                    }
+
+                    return false;
+                }
             }
         }
 
-        else {
-            if(verbosity != 0) {
-                fprintf(stderr,"Attempt to update the database could not be completed. Run \"touch %s\" to update the database manually\n",(installedPkgsPath + "/" + pkgName).c_str());
-            }
+        if(verbosity >= 2 && !installed) {
+            printf("You are already following %s\n",pkgName.c_str());
         }
+
+        return true;
     }
 
-    else {
+    rec.name = pkgName;
+    rec.version = pkgVersion(pathname, verbosity);
+    rec.installTime = time(NULL);
+    rec.manifest = serializeManifest(manifestFromMembers(installedMembers(getPkgMembers(verbosity))));
+
+    if(db.put(rec) == 0 && db.contains(pkgName)) {
         if(verbosity >= 2) {
-            printf("You are already following %s\n",pkgName.c_str());
+            printf("You are now following %s\n",pkgName.c_str());
         }
+
+        return true;
+    }
+
+    if(verbosity != 0) {
+        fprintf(stderr,"Attempt to update the database in %s could not be completed\n",installedPkgsPath.c_str());
     }
 
-    return std::filesystem::exists(installedPkgsPath + "/" + pkgName);
+    return false;
 }/*}}}*/
 
 /**
- * Removes a file in the installed package index directory for the given Pkg object.
+ * Removes the given Pkg object from the installed package database.
  *
- * This function checks whether or not the file actually exists, and if it does not, prints out a warning.
+ * This function checks whether or not the package is actually being followed, and if it is not, prints out a warning.
  */
 bool Pkg::unfollowPkg(std::string installedPkgsPath, unsigned int verbosity) {/*{{{*/
-    std::string path = installedPkgsPath + "/" + pkgName;
-    bool exists = std::filesystem::exists(path);
+    PkgDatabase db(installedPkgsPath, verbosity);
 
-    // If the file exists, remove it
-    if(exists) {
-        std::filesystem::remove(path);
+    if(!db.contains(pkgName)) {
+        if(verbosity >= 2) {
+            printf("You are not following %s\n",pkgName.c_str());
+        }
 
-        // Make sure its gone, update the var so we don't check the disk again at return
-        exists = std::filesystem::exists(path);
-        if(!exists) {
-            if(verbosity >= 2) {
-                printf("You are no longer following %s\n",pkgName.c_str());
-            }
+        return true;
+    }
+
+    if(db.remove(pkgName) == 0 && !db.contains(pkgName)) {
+        if(verbosity >= 2) {
+            printf("You are no longer following %s\n",pkgName.c_str());
         }
-        else {
-            if(verbosity != 0) {
-                fprintf(stderr,"Attempt to update the database could not be completed. Run \"rm %s\" to update the database manually\n",(installedPkgsPath + "/" + pkgName).c_str());
-            }
+
+        return true;
+    }
+
+    if(verbosity != 0) {
+        fprintf(stderr,"Attempt to update the database in %s could not be completed\n",installedPkgsPath.c_str());
+    }
+
+    return false;
+}/*}}}*/
+
+/**
+ * Finds which of PKG_EXTENSIONS a file name ends with
+ *
+ * @param [in] const std::string& path
+ *
+ * @returns size_t The length of the extension, or 0 if the file isn't a package
+ */
+static size_t pkgExtensionLength(const std::string& path) {/*{{{*/
+    static const std::vector<std::string> extensions = PKG_EXTENSIONS;
+    std::string filename = std::filesystem::path(path).filename().string();
+
+    for(const std::string& ext : extensions) {
+        if(filename.size() > ext.size() && filename.compare(filename.size() - ext.size(), ext.size(), ext) == 0) {
+            return ext.size();
         }
     }
 
-    else {
-        if(verbosity >= 2) {
-            printf("You are not following %s\n",pkgName.c_str());
+    return 0;
+}/*}}}*/
+
+/**
+ * @param [in] const std::string& path
+ *
+ * @returns bool doesThePathNameAPackageTarball
+ */
+bool isPkgFile(const std::string& path) {/*{{{*/
+    return pkgExtensionLength(path) != 0;
+}/*}}}*/
+
+/**
+ * Strips the directories and the package extension from the path of a tarball, leaving the name of the package
+ * Files with any other extension just lose their last one, as they always have
+ *
+ * @param [in] const std::string& path
+ *
+ * @returns std::string pkgName
+ */
+std::string pkgNameFromPath(const std::string& path) {/*{{{*/
+    size_t extLength = pkgExtensionLength(path);
+    if(extLength == 0) {
+        return std::filesystem::path(path).stem().string();
+    }
+
+    std::string filename = std::filesystem::path(path).filename().string();
+    return filename.substr(0, filename.size() - extLength);
+}/*}}}*/
+
+/**
+ * Finds the tarball of a package in the library, trying each of PKG_EXTENSIONS in turn
+ *
+ * @param [in] std::string libraryPath
+ * @param [in] std::string name
+ *
+ * @returns std::string tarPath. If there is no such package, the path it would have as a plain tarball
+ */
+std::string findPkgTarball(std::string libraryPath, std::string name) {/*{{{*/
+    static const std::vector<std::string> extensions = PKG_EXTENSIONS;
+    std::string base = libraryPath + "/" + name;
+
+    for(const std::string& ext : extensions) {
+        struct stat st;
+        if(stat((base + ext).c_str(), &st) == 0 && !S_ISDIR(st.st_mode)) {
+            return base + ext;
         }
     }
 
-    return !exists;
+    return base + extensions.front();
 }/*}}}*/
 
 /**
  * Lists all of the packages which we can find in a given directory
+ * Packages with metadata are listed with their version, and at higher verbosities, with their size and dependencies. Only the first few KB of each package are read for it. See readPkgMeta
+ *
+ * Since every tarball in the library is visited anyway, the member cache is pruned of the ones which are gone
  *
  * Per libc standards, none of the functions here can throw exceptions. Therefore, this function will always return true.
  *
  * @param std::string tarLibrary
  * @param unsigned int verbosity
+ * @param MemberCache* memberCache May be NULL
  *
  * @returns bool wasListSuccessful
  */
-bool listAllPkgs(std::string libraryPath, unsigned int verbosity) {/*{{{*/
+bool listAllPkgs(std::string libraryPath, unsigned int verbosity, MemberCache* memberCache) {/*{{{*/
     // Build a (recursive?) directory iterator, and for each tar file, print out its name (path?), sans the extension
     std::filesystem::recursive_directory_iterator di(libraryPath);
+    std::set<std::pair<uint64_t, uint64_t>> tarballs;
 
     for(auto& p: di) {
-        if(p.path().extension() == ".tar") {
-            printf("%s\n",p.path().stem().c_str());
+        if(!isPkgFile(p.path().string())) {
+            continue;
+        }
+
+        struct stat st;
+        if(stat(p.path().c_str(), &st) == 0) {
+            tarballs.insert(std::pair<uint64_t, uint64_t>(st.st_dev, st.st_ino));
+        }
+
+        std::string name = pkgNameFromPath(p.path().string());
+        pkgMeta_s meta;
+
+        if(readPkgMeta(p.path().string(), meta, verbosity) != 0 || meta.version.empty()) {
+            printf("%s\n",name.c_str());
+            continue;
+        }
+
+        if(verbosity < 3) {
+            printf("%s %s\n",name.c_str(),meta.version.c_str());
+            continue;
         }
+
+        std::string depends;
+        for(const std::string& dep : meta.depends) {
+            depends += " " + dep;
+        }
+
+        printf("%s %s: %llu files, %llu bytes installed%s%s\n",name.c_str(),meta.version.c_str(),(unsigned long long)meta.files,(unsigned long long)meta.installedSize,depends.empty() ? "" : ", depends on",depends.c_str());
+    }
+
+    if(memberCache != NULL) {
+        memberCache->prune(tarballs);
     }
 
     return true;
@@ -530,6 +1314,7 @@ bool listAllPkgs(std::string libraryPath, unsigned int verbosity) {/*{{{*/
 
 /**
  * Lists all of the installed packages which we can find in our installed package index directory
+ * Packages followed with metadata are listed with their version, as in listAllPkgs
  *
  * Per libc standards, none of the functions here can throw exceptions. Therefore, this function will always return true.
  *
@@ -539,64 +1324,129 @@ bool listAllPkgs(std::string libraryPath, unsigned int verbosity) {/*{{{*/
  * @returns bool wasListSuccessful
  */
 bool listInstalledPkgs(std::string installedPkgsPath, unsigned int verbosity) {/*{{{*/
-    // Build a (recursive?) directory iterator, and for each file, print our its name (path?)
-    std::filesystem::recursive_directory_iterator di(installedPkgsPath);
+    PkgDatabase db(installedPkgsPath, verbosity);
 
-    for(auto& p: di) {
-        printf("%s\n",p.path().filename().c_str());
+    for(const std::string& name : db.listNames()) {
+        std::string version = db.getVersion(name);
+
+        if(version.empty()) {
+            printf("%s\n",name.c_str());
+        }
+
+        else {
+            printf("%s %s\n",name.c_str(),version.c_str());
+        }
     }
 
     return true;
 }/*}}}*/
 
+/**
+ * Prints the installed packages which own each of the given paths
+ *
+ * Paths are resolved against the current working directory, and must lie within the system root. Lookups go through the owner index, which is rebuilt first if it is missing or out of date.
+ *
+ * @param std::vector<std::string> paths
+ * @param std::string root
+ * @param std::string installedPkgsPath
+ * @param unsigned int verbosity
+ *
+ * @returns bool wasEveryPathOwned
+ */
+bool listOwners(std::vector<std::string> paths, std::string root, std::string installedPkgsPath, unsigned int verbosity) {/*{{{*/
+    {
+        PkgDatabase db(installedPkgsPath, verbosity);
+        if(!db.ownersAreCurrent()) {
+            db.refreshOwners();
+        }
+    }
+
+    OwnerIndex owners(installedPkgsPath, verbosity);
+    std::filesystem::path rootPath = std::filesystem::absolute(root).lexically_normal();
+    bool allOwned = true;
+
+    for(const std::string& path : paths) {
+        std::filesystem::path rel = std::filesystem::absolute(path).lexically_normal().lexically_relative(rootPath);
+
+        if(rel.empty() || *rel.begin() == "..") {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: %s is not inside the system root %s\n",path.c_str(),rootPath.c_str());
+            }
+
+            allOwned = false;
+            continue;
+        }
+
+        std::vector<std::string> pkgs = owners.findOwners(rel.string());
+        if(pkgs.empty()) {
+            if(verbosity != 0) {
+                fprintf(stderr,"No installed package owns %s\n",path.c_str());
+            }
+
+            allOwned = false;
+            continue;
+        }
+
+        printf("%s:",path.c_str());
+        for(const std::string& pkg : pkgs) {
+            printf(" %s",pkg.c_str());
+        }
+        printf("\n");
+    }
+
+    return allOwned;
+}/*}}}*/
+
 /**
  * Executes the pre-install shell script of the package, if it exists
- * @TODO Allow the user to use any given temporary directory
- * 
+ *
  * @param [in] unsigned int verbosity
  *
  * @returns int scriptExitCode
  */
 int Pkg::execPreInstallScript(unsigned int verbosity) {/*{{{*/
     const std::string SCRIPT_NAME = PRE_INSTALL_NAME;
-    const std::string EXTRACTION_DIR = "/tmp/" + pkgName + "-pre-install/";
 
-    return extractAndExecScript(SCRIPT_NAME, EXTRACTION_DIR, pathname, verbosity);
+    return execScript(SCRIPT_NAME, verbosity);
 }/*}}}*/
 
 /**
  * Executes the post-install shell script of the package, if it exists
- * @TODO Allow the user to use any given temporary directory
- * 
+ *
  * @param [in] unsigned int verbosity
  *
  * @returns int scriptExitCode
  */
 int Pkg::execPostInstallScript(unsigned int verbosity) {/*{{{*/
     const std::string SCRIPT_NAME = POST_INSTALL_NAME;
-    const std::string EXTRACTION_DIR = "/tmp/" + pkgName + "-post-install/";
 
-    return extractAndExecScript(SCRIPT_NAME, EXTRACTION_DIR, pathname, verbosity);
+    return execScript(SCRIPT_NAME, verbosity);
 }/*}}}*/
 
 /**
  * Executes the pre-uninstall shell script of the package, if it exists
- * @TODO Allow the user to use any given temporary directory
- * 
+ *
  * @param [in] unsigned int verbosity
  *
  * @returns int scriptExitCode
  */
 int Pkg::execPreUninstallScript(unsigned int verbosity) {/*{{{*/
     const std::string SCRIPT_NAME = PRE_UNINSTALL_NAME;
-    const std::string EXTRACTION_DIR = "/tmp/" + pkgName + "-pre-uninstall/";
 
-    return extractAndExecScript(SCRIPT_NAME, EXTRACTION_DIR, pathname, verbosity);
+    // The tarball may have been pruned since the package was installed
+    if(!std::filesystem::exists(pathname)) {
+        if(verbosity >= 2) {
+            printf("The tarball of %s is gone. Skipping its pre-uninstall script\n",pkgName.c_str());
+        }
+
+        return 0;
+    }
+
+    return execScript(SCRIPT_NAME, verbosity);
 }/*}}}*/
 
 /**
  * Executes the post-uninstall shell script of the package, if it exists
- * @TODO Allow the user to use any given temporary directory
  *
  * @param [in] unsigned int verbosity
  *
@@ -604,13 +1454,21 @@ int Pkg::execPreUninstallScript(unsigned int verbosity) {/*{{{*/
  */
 int Pkg::execPostUninstallScript(unsigned int verbosity) {/*{{{*/
     const std::string SCRIPT_NAME = POST_UNINSTALL_NAME;
-    const std::string EXTRACTION_DIR = "/tmp/" + pkgName + "-post-uninstall/";
 
-    return extractAndExecScript(SCRIPT_NAME, EXTRACTION_DIR, pathname, verbosity);
+    // The tarball may have been pruned since the package was installed
+    if(!std::filesystem::exists(pathname)) {
+        if(verbosity >= 2) {
+            printf("The tarball of %s is gone. Skipping its post-uninstall script\n",pkgName.c_str());
+        }
+
+        return 0;
+    }
+
+    return execScript(SCRIPT_NAME, verbosity);
 }/*}}}*/
 
 /**
- * Opens an archive for reading and sets up tar support
+ * Opens an archive for reading and sets up tar support, along with zstd, xz and gzip decompression
  *
  * @param [out] archive* archive
  * @param [in] std::string archivePath
@@ -621,14 +1479,24 @@ int Pkg::execPostUninstallScript(unsigned int verbosity) {/*{{{*/
 bool openArchiveWithTarSupport(struct archive*& a, std::string archivePath, unsigned int verbosity) {/*{{{*/
     a = archive_read_new();
     archive_read_support_format_tar(a);
-    int res = archive_read_open_filename(a, archivePath.c_str(), TAR_BLOCKSIZE);
+    archive_read_support_filter_zstd(a);
+    archive_read_support_filter_xz(a);
+    archive_read_support_filter_gzip(a);
+
+    // Compression formats which can be split up are decoded on several threads. The rest, libarchive decompresses itself, from a memory map or a large buffer
+    int res = ARCHIVE_OK;
+    if(!openParallelDecompression(a, archivePath, res, verbosity)) {
+        res = openArchiveInput(a, archivePath, verbosity);
+    }
 
     // Verify the archive is still okay
     if(res != ARCHIVE_OK) {
         if(verbosity != 0) {
-            fprintf(stderr,"Error: Could not prepare tarball support for package %s. %s\n",archivePath.c_str(),strerror(errno));
+            fprintf(stderr,"Error: Could not prepare tarball support for package %s. %s\n",archivePath.c_str(),archive_error_string(a));
         }
 
+        archive_read_free(a);
+        a = NULL;
         return false;
     }
 
@@ -636,82 +1504,157 @@ bool openArchiveWithTarSupport(struct archive*& a, std::string archivePath, unsi
 }/*}}}*/
 
 /**
- * Extracts and executes a script from a tarball
- * The script must be in the root of the tarball
+ * Extracts an archive into the system root through libarchive
+ * This handles compressed archives, and any members the zero-copy engine can't restore on its own
  *
- * @param [in] std::string scriptName
- * @param [in] std::stirng extractionDir
  * @param [in] std::string archivePath
+ * @param [in] std::string root
+ * @param [in] const ExclusionMatcher& exclusions
+ * @param [in] const std::set<std::string>* onlyPaths, If not NULL, only the members with these archive paths are extracted
  * @param [in] unsigned int verbosity
+ * @param [in] unsigned int writers, The number of threads writing out files. Only used when extracting the whole archive
+ * @param [in] WritebackTracker* durability, If not NULL, every entry extracted is reported to it
+ * @param [in] entryHook_t hook, If not NULL, shown every header first. See entryHook_t
+ * @param [in] void* hookContext, Handed to the hook
+ *
+ * @returns int ARCHIVE_EOF on success, ENTRY_STOPPED if the hook stopped the extraction, or an error code
  */
-int extractAndExecScript(std::string scriptName, std::string extractionDir, std::string archivePath, unsigned int verbosity) {/*{{{*/
-    // Create the extraction directory if it does not already exist
-    std::error_code e;
-    if(!std::filesystem::create_directories(extractionDir, e) && e.value() != 0) {
-        if(verbosity != 0) {
-            fprintf(stderr,"Error: While attempting to create the folder %s to extract the script %s in archive %s, an unknown error occured\n",extractionDir.c_str(),scriptName.c_str(), archivePath.c_str());
-            fprintf(stderr,"%s\n",e.message().c_str());
-        }
-
-        return -256;
+int extractWithLibarchive(std::string archivePath, std::string root, const ExclusionMatcher& exclusions, const std::set<std::string>* onlyPaths, unsigned int verbosity, unsigned int writers, WritebackTracker* durability, entryHook_t hook, void* hookContext) {/*{{{*/
+    // Open our tar file
+    archive* a;
+    archive_entry* ae;
+    if(!openArchiveWithTarSupport(a, archivePath.c_str(), verbosity)) {
+        return -113;
     }
-    
-    archive* a = archive_read_new();
-    archive_entry* ae = archive_entry_new();
+
+    int err = 0;
     int res = 0;
-    bool found = false;
 
-    if(!openArchiveWithTarSupport(a,archivePath,verbosity)) {
-        return -256;
+    // Decoding can't be split up, but writing the files out can
+    if(writers > 1 && onlyPaths == NULL) {
+        WriterPool pool(writers, verbosity, durability);
+        res = extractArchiveWithWriters(a, root, exclusions, pool, verbosity, hook, hookContext);
+        archive_read_free(a);
+
+        if(res != ARCHIVE_EOF && res != ENTRY_STOPPED && verbosity != 0) {
+            fprintf(stderr,"Error: An error occured while reading the tar file %s.\n",archivePath.c_str());
+        }
+
+        return res;
     }
 
-    // Read our headers, and see if any of them match our script name
-    while((res = archive_read_next_header2(a, ae)) == ARCHIVE_OK) {
-        std::string entryPath = archive_entry_pathname(ae);
-        if(scriptName == entryPath) {
-            if(verbosity >= 3) {
-                found = true;
-                printf("%s found for package %s\n", scriptName.c_str(), archivePath.c_str());
+    // Go through each header, and extract the files/folders
+    while((res = archive_read_next_header(a,&ae)) == ARCHIVE_OK && err == 0) {
+        // First, change our pathname to reflect our system root
+        const char* aePath = archive_entry_pathname(ae);
+
+        if(onlyPaths != NULL && onlyPaths->find(aePath) == onlyPaths->end()) {
+            continue;
+        }
+
+        if(hook != NULL) {
+            int r = hook(a, ae, hookContext);
+            if(r < 0) {
+                err = r;
                 break;
             }
+
+            if(r == ENTRY_SKIP) {
+                continue;
+            }
         }
-    }
 
-    if(verbosity >= 3) {
-        printf("Script %s returned %d\n",scriptName.c_str(),res);
+        // Check our exception list. libarchive skips over the data of anything we don't extract
+        if(exclusions.matches(aePath) || exclusions.matches(archive_entry_hardlink(ae))) {
+            continue;
+        }
+
+        std::string rel = canonicalMemberPath(aePath);
+        bool isFile = archive_entry_filetype(ae) == AE_IFREG && archive_entry_hardlink(ae) == NULL;
+
+        std::string new_aePath = root + "/";
+        new_aePath += aePath;
+        archive_entry_set_pathname(ae,new_aePath.c_str());
+
+        // A hard link names its target within the archive, which has to be moved under the root as well
+        if(archive_entry_hardlink(ae) != NULL) {
+            archive_entry_set_hardlink(ae,(root + "/" + archive_entry_hardlink(ae)).c_str());
+        }
+
+        err = archive_read_extract(a, ae, LIBARCHIVE_EXTRACT_FLAGS);
+
+        if(err == ARCHIVE_OK && durability != NULL && !rel.empty()) {
+            durability->pathRestored(new_aePath, rel, isFile);
+        }
     }
-    
-    // Error
-    if(res == -1) {
-        return -258;
+
+    archive_read_free(a);
+
+    if(err != ARCHIVE_OK && err != ARCHIVE_EOF) {
+        if(verbosity != 0 && err != ENTRY_STOPPED) {
+            fprintf(stderr,"Error: An error occured while reading the tar file %s.\n",archivePath.c_str());
+        }
+
+        return err;
     }
 
-    // Found the script
-    else if(found) {
-        // Change the path at which the entry will be extracted
-        std::string extractionPath = extractionDir + scriptName;
-        archive_entry_set_pathname(ae, extractionPath.c_str());
+    return res;
+}/*}}}*/
+
+/**
+ * Whether the package carries one of the scripts, without running it
+ * See scanPkg for how the tarball is read
+ *
+ * @param [in] std::string scriptName
+ * @param [in] unsigned int verbosity
+ *
+ * @returns bool hasScript
+ */
+bool Pkg::hasScript(std::string scriptName, unsigned int verbosity) {/*{{{*/
+    scanPkg(verbosity);
+    return scripts.count(scriptName) != 0;
+}/*}}}*/
 
-        // Create a string for the system() call
-        // @TODO Allow the shell used to be set on configure
-        std::string execCmd = extractionPath;
+/**
+ * Runs one of the package's scripts, if it has it
+ * All of the scripts are captured by the same pass over the tarball, so only the first script run for a package reads it
+ *
+ * @param [in] std::string scriptName
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int scriptExitCode, or 256 if the package has no such script
+ */
+int Pkg::execScript(std::string scriptName, unsigned int verbosity) {/*{{{*/
+    scanPkg(verbosity);
 
-        // Extract the script
-        int err = archive_read_extract(a, ae, ARCHIVE_EXTRACT_ACL | ARCHIVE_EXTRACT_PERM | ARCHIVE_EXTRACT_SECURE_NODOTDOT | ARCHIVE_EXTRACT_XATTR );
+    auto it = scripts.find(scriptName);
 
-        // Run the script
-        return system(execCmd.c_str());
+    // The script was not found. Exit statuses only go up to 255, so this can't be mistaken for one
+    if(it == scripts.end()) {
+        return 256;
     }
 
-    // The script was not found. 256 chosen since shell scripts, to my knowledge, should only return up to 255
-    // @TODO Verify this
-    else {
-        return 256;
+    if(verbosity >= 3) {
+        printf("%s found for package %s\n", scriptName.c_str(), pathname.c_str());
     }
+
+    return runScript(scriptName, it->second, pkgName, verbosity);
+}/*}}}*/
+
+/**
+ * A package made with tar -C dir . stores its scripts as ./pre-install.sh and so on, which are the same scripts
+ *
+ * @param [in] const std::string& path A path within a tarball
+ *
+ * @returns bool isPathOneOfOurScripts
+ */
+bool isPkgScript(const std::string& path) {/*{{{*/
+    std::string normalized = normalizeMemberPath(path);
+    return normalized == PRE_INSTALL_NAME || normalized == POST_INSTALL_NAME || normalized == PRE_UNINSTALL_NAME || normalized == POST_UNINSTALL_NAME;
 }/*}}}*/
 
 /**
- * Adds the pre- and post- install/uninstall scripts to the exclusions list
+ * Adds the pre- and post- install/uninstall scripts, the package metadata and the package index, to the exclusions list
  *
  * @param [in/out] std::set<std::string>& exclusions
  */
@@ -720,6 +1663,19 @@ void addScriptsToExclusions(std::set<std::string>& exclusions) {/*{{{*/
     exclusions.insert(POST_INSTALL_NAME);
     exclusions.insert(PRE_UNINSTALL_NAME);
     exclusions.insert(POST_UNINSTALL_NAME);
+    exclusions.insert(PKG_META_NAME);
+    exclusions.insert(PKG_INDEX_NAME);
+}/*}}}*/
+
+/**
+ * The exclusions the install and uninstall functions default to, so a caller which gives none still keeps the scripts, the metadata and the index out of the root
+ *
+ * @returns std::set<std::string> exclusions
+ */
+std::set<std::string> defaultPkgExclusions() {/*{{{*/
+    std::set<std::string> exclusions;
+    addScriptsToExclusions(exclusions);
+    return exclusions;
 }/*}}}*/
 
 /**
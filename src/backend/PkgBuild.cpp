@@ -0,0 +1,754 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file PkgBuild.cpp
+ * @error -3000
+ *
+ * Builds packages out of directories, laid out for how they get installed.
+ * tar puts members in whatever order the filesystem hands them out, so a package from it makes the installer jump between directories, and its hard links and sparse files depend on the flags it was given.
+ * Here, the metadata comes first, so listing the library only reads the start of each package. See PkgMeta.h. The scripts come next, so they can be read without going any further into the package. Every directory comes next, so they all exist before any file is written. Then the files follow, grouped by the directory they're in, so the installer works through one directory at a time. Hard links come last, once everything they can point at was written.
+ * The order only depends on the paths, and the owners and subsecond times are dropped, so building the same directory twice gives the same package.
+ *
+ * Every package gets an index, so it's seekable. See PkgIndex.h.
+ * A compressed package is zstd, in frames which are cut where a member starts whenever they can be, followed by the seek table of the zstd seekable format. Any zstd decoder reads it, and ours decodes the frames on several threads at once.
+ */
+
+#include "PkgBuild.h"
+
+/**
+ * The order of the members of a package
+ * Directories sort by path, which puts every directory before those within it. Files sort by the directory they're in, in that same order, then by name
+ *
+ * @param [in] const buildEntry_s& a
+ * @param [in] const buildEntry_s& b
+ *
+ * @returns bool doesAComeBeforeB
+ */
+static bool buildOrder(const buildEntry_s& a, const buildEntry_s& b) {/*{{{*/
+    if(a.rank != b.rank) {
+        return a.rank < b.rank;
+    }
+
+    if(a.rank == PKG_BUILD_RANK_DIRECTORY) {
+        return a.path < b.path;
+    }
+
+    if(a.parent != b.parent) {
+        return a.parent < b.parent;
+    }
+
+    return a.name < b.name;
+}/*}}}*/
+
+/**
+ * Lists everything under the directory a package is built from
+ *
+ * @param [in] const std::string& srcDir
+ * @param [out] std::vector<buildEntry_s>& entries
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 on success, or PKG_BUILD_READ_ERROR
+ */
+static int collectEntries(const std::string& srcDir, std::vector<buildEntry_s>& entries, unsigned int verbosity) {/*{{{*/
+    std::error_code ec;
+    std::filesystem::recursive_directory_iterator di(srcDir, ec);
+
+    for(; !ec && di != std::filesystem::recursive_directory_iterator(); di.increment(ec)) {
+        buildEntry_s e;
+        std::filesystem::path rel = di->path().lexically_relative(srcDir);
+        e.path = rel.string();
+        e.parent = rel.parent_path().string();
+        e.name = rel.filename().string();
+
+        if(lstat(di->path().c_str(), &e.st) != 0) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Could not stat %s. %s\n",di->path().c_str(),strerror(errno));
+            }
+
+            return PKG_BUILD_READ_ERROR;
+        }
+
+        // The metadata is where the packager gives the version and dependencies. It's written anew, along with the rest of it. See buildPkg
+        if(isPkgMeta(e.path)) {
+            continue;
+        }
+
+        // tar can't hold a socket, and the index is always written anew
+        if(S_ISSOCK(e.st.st_mode) || isPkgIndex(e.path)) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Warning: Leaving %s out of the package\n",e.path.c_str());
+            }
+
+            continue;
+        }
+
+        if(S_ISDIR(e.st.st_mode)) {
+            e.rank = PKG_BUILD_RANK_DIRECTORY;
+        }
+
+        else if(S_ISREG(e.st.st_mode) && e.parent.empty() && isPkgScript(e.path)) {
+            e.rank = PKG_BUILD_RANK_SCRIPT;
+        }
+
+        entries.push_back(e);
+    }
+
+    if(ec) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not read the directory %s. %s\n",srcDir.c_str(),ec.message().c_str());
+        }
+
+        return PKG_BUILD_READ_ERROR;
+    }
+
+    return 0;
+}/*}}}*/
+
+/**
+ * Puts the entries in the order they're written to the package, and turns every file after the first one sharing an inode into a hard link to it
+ *
+ * @param [in/out] std::vector<buildEntry_s>& entries
+ */
+static void orderEntries(std::vector<buildEntry_s>& entries) {/*{{{*/
+    std::sort(entries.begin(), entries.end(), buildOrder);
+
+    std::map<std::pair<dev_t, ino_t>, std::string> firstPaths;
+    for(buildEntry_s& e : entries) {
+        if(!S_ISREG(e.st.st_mode) || e.st.st_nlink < 2) {
+            continue;
+        }
+
+        auto inserted = firstPaths.insert({ { e.st.st_dev, e.st.st_ino }, e.path });
+        if(!inserted.second) {
+            e.rank = PKG_BUILD_RANK_HARDLINK;
+            e.linkTarget = inserted.first->second;
+        }
+    }
+
+    // The links move to the end, and everything else keeps its order
+    std::stable_sort(entries.begin(), entries.end(), [](const buildEntry_s& a, const buildEntry_s& b) { return a.rank < b.rank; });
+}/*}}}*/
+
+/**
+ * Works out the metadata of a package
+ * The packager may give the version and dependencies in a metadata file at the top of the directory. Everything else is taken from the entries, and overrides whatever the file said
+ *
+ * @param [in] const std::string& srcDir
+ * @param [in] const std::string& name
+ * @param [in] const std::vector<buildEntry_s>& entries
+ * @param [out] pkgMeta_s& meta
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 on success, or PKG_BUILD_READ_ERROR
+ */
+static int describePkg(const std::string& srcDir, const std::string& name, const std::vector<buildEntry_s>& entries, pkgMeta_s& meta, unsigned int verbosity) {/*{{{*/
+    meta = pkgMeta_s();
+
+    std::string path = srcDir + "/" + PKG_META_NAME;
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd >= 0) {
+        struct stat st;
+        std::string data;
+        bool valid = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size <= PKG_META_MAX_SIZE && readTarRange(fd, 0, st.st_size, data) && parsePkgMeta(data, meta, verbosity);
+        close(fd);
+
+        if(!valid) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Could not read the package metadata in %s\n",path.c_str());
+            }
+
+            return PKG_BUILD_READ_ERROR;
+        }
+
+        if(!meta.name.empty() && meta.name != name && verbosity != 0) {
+            fprintf(stderr,"Warning: %s names the package %s, but it's named after its directory, %s\n",path.c_str(),meta.name.c_str(),name.c_str());
+        }
+    }
+
+    else if(errno != ENOENT) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not open %s. %s\n",path.c_str(),strerror(errno));
+        }
+
+        return PKG_BUILD_READ_ERROR;
+    }
+
+    meta.name = name;
+    meta.installedSize = 0;
+    meta.files = 0;
+    meta.scripts = 0;
+
+    for(const buildEntry_s& e : entries) {
+        if(e.rank == PKG_BUILD_RANK_SCRIPT) {
+            meta.scripts |= (e.name == PRE_INSTALL_NAME) ? PKG_META_PRE_INSTALL : (e.name == POST_INSTALL_NAME) ? PKG_META_POST_INSTALL : (e.name == PRE_UNINSTALL_NAME) ? PKG_META_PRE_UNINSTALL : PKG_META_POST_UNINSTALL;
+            continue;
+        }
+
+        // A hard link takes up no more space than the file it points at
+        if(e.rank == PKG_BUILD_RANK_FILE && S_ISREG(e.st.st_mode)) {
+            meta.installedSize += e.st.st_size;
+        }
+
+        meta.files++;
+    }
+
+    return 0;
+}/*}}}*/
+
+/**
+ * Finds where a file holds data, if it has any holes
+ *
+ * @param [in] int fd
+ * @param [in] const struct stat& st
+ * @param [out] std::vector<std::pair<off_t, off_t>>& regions The offset and length of each stretch of data
+ *
+ * @returns bool isTheFileSparse
+ */
+static bool findSparseRegions(int fd, const struct stat& st, std::vector<std::pair<off_t, off_t>>& regions) {/*{{{*/
+    regions.clear();
+
+    // A file with every block allocated has no holes to find
+    if(st.st_size == 0 || (off_t)st.st_blocks * 512 >= st.st_size) {
+        return false;
+    }
+
+    off_t pos = 0;
+    while(pos < st.st_size) {
+        off_t data = lseek(fd, pos, SEEK_DATA);
+        if(data < 0) {
+            // Only a hole is left. Anything else means the filesystem can't tell us
+            if(errno != ENXIO) {
+                regions.clear();
+                return false;
+            }
+
+            break;
+        }
+
+        off_t hole = lseek(fd, data, SEEK_HOLE);
+        if(hole < 0) {
+            regions.clear();
+            return false;
+        }
+
+        regions.push_back({ data, hole - data });
+        pos = hole;
+    }
+
+    if(regions.size() == 1 && regions[0].first == 0 && regions[0].second == st.st_size) {
+        regions.clear();
+        return false;
+    }
+
+    return true;
+}/*}}}*/
+
+/**
+ * Hands the data of a file to libarchive
+ * The holes of a sparse file are never read. The pax writer leaves them out of the archive, but still wants to be handed them
+ *
+ * @param [in] archive* a
+ * @param [in] int fd
+ * @param [in] const buildEntry_s& e
+ * @param [in] bool sparse
+ * @param [in] const std::vector<std::pair<off_t, off_t>>& regions Where a sparse file holds data
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 on success, or an error code
+ */
+static int writeFileData(archive* a, int fd, const buildEntry_s& e, bool sparse, const std::vector<std::pair<off_t, off_t>>& regions, unsigned int verbosity) {/*{{{*/
+    static const std::vector<char> zeros(PKG_BUILD_READ_SIZE, 0);
+    std::vector<char> buf(PKG_BUILD_READ_SIZE);
+
+    std::vector<std::pair<off_t, off_t>> data = regions;
+    if(!sparse) {
+        data.assign(1, { 0, e.st.st_size });
+    }
+
+    data.push_back({ e.st.st_size, 0 });
+
+    off_t pos = 0;
+    for(const auto& region : data) {
+        while(pos < region.first) {
+            size_t n = (region.first - pos < PKG_BUILD_READ_SIZE) ? region.first - pos : PKG_BUILD_READ_SIZE;
+            if(archive_write_data(a, zeros.data(), n) < 0) {
+                if(verbosity != 0) {
+                    fprintf(stderr,"Error: Could not write %s to the package. %s\n",e.path.c_str(),archive_error_string(a));
+                }
+
+                return PKG_BUILD_WRITE_ERROR;
+            }
+
+            pos += n;
+        }
+
+        while(pos < region.first + region.second) {
+            size_t n = (region.first + region.second - pos < PKG_BUILD_READ_SIZE) ? region.first + region.second - pos : PKG_BUILD_READ_SIZE;
+            ssize_t r = pread(fd, buf.data(), n, pos);
+            if(r < 0 && errno == EINTR) {
+                continue;
+            }
+
+            // The file shrank since it was stat'ed
+            if(r <= 0) {
+                if(verbosity != 0) {
+                    fprintf(stderr,"Error: Could not read %s. %s\n",e.path.c_str(),(r == 0) ? "It changed while the package was built" : strerror(errno));
+                }
+
+                return PKG_BUILD_READ_ERROR;
+            }
+
+            if(archive_write_data(a, buf.data(), r) < 0) {
+                if(verbosity != 0) {
+                    fprintf(stderr,"Error: Could not write %s to the package. %s\n",e.path.c_str(),archive_error_string(a));
+                }
+
+                return PKG_BUILD_WRITE_ERROR;
+            }
+
+            pos += r;
+        }
+    }
+
+    return 0;
+}/*}}}*/
+
+/**
+ * Writes the metadata, then the entries in the order given, out as a pax archive
+ * Every member is owned by root, and its mtime is cut down to whole seconds, so ustar headers hold nearly everything, and nothing about the machine the package was built on ends up in it
+ *
+ * @param [in] const std::string& srcDir
+ * @param [in] const std::string& meta
+ * @param [in] const std::vector<buildEntry_s>& entries
+ * @param [in] int outFd
+ * @param [out] unsigned long& sparseFiles
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 on success, or an error code
+ */
+static int writePkgTar(const std::string& srcDir, const std::string& meta, const std::vector<buildEntry_s>& entries, int outFd, unsigned long& sparseFiles, unsigned int verbosity) {/*{{{*/
+    archive* a = archive_write_new();
+    archive_write_set_format_pax_restricted(a);
+
+    if(archive_write_open_fd(a, outFd) != ARCHIVE_OK) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not start the package. %s\n",archive_error_string(a));
+        }
+
+        archive_write_free(a);
+        return PKG_BUILD_WRITE_ERROR;
+    }
+
+    // The metadata takes the mtime of the newest entry, so it only changes along with them
+    time_t newest = 0;
+    for(const buildEntry_s& e : entries) {
+        newest = (e.st.st_mtime > newest) ? e.st.st_mtime : newest;
+    }
+
+    int err = 0;
+    archive_entry* metaEntry = archive_entry_new();
+    archive_entry_set_pathname(metaEntry, PKG_META_NAME);
+    archive_entry_set_filetype(metaEntry, AE_IFREG);
+    archive_entry_set_perm(metaEntry, 0644);
+    archive_entry_set_size(metaEntry, meta.size());
+    archive_entry_set_uname(metaEntry, "root");
+    archive_entry_set_gname(metaEntry, "root");
+    archive_entry_set_mtime(metaEntry, newest, 0);
+
+    if(archive_write_header(a, metaEntry) < ARCHIVE_WARN || archive_write_data(a, meta.data(), meta.size()) < 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not add the metadata to the package. %s\n",archive_error_string(a));
+        }
+
+        err = PKG_BUILD_WRITE_ERROR;
+    }
+
+    archive_entry_free(metaEntry);
+
+    for(const buildEntry_s& e : entries) {
+        if(err != 0) {
+            break;
+        }
+
+        std::string full = srcDir + "/" + e.path;
+        archive_entry* ae = archive_entry_new();
+        archive_entry_copy_stat(ae, &e.st);
+        archive_entry_set_pathname(ae, e.path.c_str());
+        archive_entry_set_uid(ae, 0);
+        archive_entry_set_gid(ae, 0);
+        archive_entry_set_uname(ae, "root");
+        archive_entry_set_gname(ae, "root");
+        archive_entry_set_mtime(ae, e.st.st_mtime, 0);
+        archive_entry_unset_atime(ae);
+        archive_entry_unset_ctime(ae);
+        archive_entry_unset_birthtime(ae);
+
+        int fd = -1;
+        bool sparse = false;
+        std::vector<std::pair<off_t, off_t>> regions;
+
+        if(e.rank == PKG_BUILD_RANK_HARDLINK) {
+            archive_entry_set_hardlink(ae, e.linkTarget.c_str());
+            archive_entry_set_size(ae, 0);
+        }
+
+        else if(S_ISLNK(e.st.st_mode)) {
+            std::error_code ec;
+            std::string target = std::filesystem::read_symlink(full, ec).string();
+            if(ec) {
+                if(verbosity != 0) {
+                    fprintf(stderr,"Error: Could not read the symlink %s. %s\n",full.c_str(),ec.message().c_str());
+                }
+
+                err = PKG_BUILD_READ_ERROR;
+            }
+
+            archive_entry_set_symlink(ae, target.c_str());
+        }
+
+        else if(S_ISREG(e.st.st_mode)) {
+            fd = open(full.c_str(), O_RDONLY | O_CLOEXEC);
+            if(fd < 0) {
+                if(verbosity != 0) {
+                    fprintf(stderr,"Error: Could not open %s. %s\n",full.c_str(),strerror(errno));
+                }
+
+                err = PKG_BUILD_READ_ERROR;
+            }
+
+            else if((sparse = findSparseRegions(fd, e.st, regions))) {
+                for(const auto& region : regions) {
+                    archive_entry_sparse_add_entry(ae, region.first, region.second);
+                }
+
+                // A file which is nothing but a hole still needs a map, or it's stored as zeros
+                if(regions.empty()) {
+                    archive_entry_sparse_add_entry(ae, e.st.st_size, 0);
+                }
+
+                sparseFiles++;
+            }
+        }
+
+        else {
+            archive_entry_set_size(ae, 0);
+        }
+
+        if(err == 0 && archive_write_header(a, ae) < ARCHIVE_WARN) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Could not add %s to the package. %s\n",e.path.c_str(),archive_error_string(a));
+            }
+
+            err = PKG_BUILD_WRITE_ERROR;
+        }
+
+        if(err == 0 && fd >= 0) {
+            err = writeFileData(a, fd, e, sparse, regions, verbosity);
+        }
+
+        if(fd >= 0) {
+            close(fd);
+        }
+
+        archive_entry_free(ae);
+
+        if(err != 0) {
+            break;
+        }
+    }
+
+    if(archive_write_close(a) != ARCHIVE_OK && err == 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not finish the package. %s\n",archive_error_string(a));
+        }
+
+        err = PKG_BUILD_WRITE_ERROR;
+    }
+
+    archive_write_free(a);
+    return err;
+}/*}}}*/
+
+/**
+ * Compresses an indexed tarball into zstd frames, followed by the seek table of the zstd seekable format
+ * Each frame records its size, so the installer can decode them all at once, and ends where a member starts, unless it grew too large first
+ *
+ * @param [in] int tarFd
+ * @param [in] int outFd
+ * @param [out] unsigned long& frames
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 on success, or an error code
+ */
+static int compressSeekable(int tarFd, int outFd, unsigned long& frames, unsigned int verbosity) {/*{{{*/
+#ifdef WITH_ZSTD
+    struct stat st;
+    std::vector<tarMember_s> members;
+    if(fstat(tarFd, &st) != 0 || readPkgMembers(tarFd, members, 0) != 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not read back the package to compress it. %s\n",strerror(errno));
+        }
+
+        return PKG_BUILD_READ_ERROR;
+    }
+
+    std::vector<off_t> boundaries;
+    for(const tarMember_s& m : members) {
+        boundaries.push_back(m.headerOffset);
+    }
+
+    std::sort(boundaries.begin(), boundaries.end());
+
+    ZSTD_CCtx* cctx = ZSTD_createCCtx();
+    std::string src;
+    std::string dst;
+    std::string seekTable;
+    int err = 0;
+
+    for(off_t pos = 0; pos < st.st_size; ) {
+        off_t end = (st.st_size - pos < PKG_BUILD_MAX_FRAME_SIZE) ? st.st_size : pos + PKG_BUILD_MAX_FRAME_SIZE;
+
+        auto boundary = std::lower_bound(boundaries.begin(), boundaries.end(), pos + PKG_BUILD_FRAME_SIZE);
+        if(boundary != boundaries.end() && *boundary < end) {
+            end = *boundary;
+        }
+
+        if(!readTarRange(tarFd, pos, end - pos, src)) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Could not read back the package to compress it. %s\n",strerror(errno));
+            }
+
+            err = PKG_BUILD_READ_ERROR;
+            break;
+        }
+
+        dst.resize(ZSTD_compressBound(src.size()));
+        size_t length = ZSTD_compressCCtx(cctx, &dst[0], dst.size(), src.data(), src.size(), PKG_BUILD_ZSTD_LEVEL);
+
+        if(ZSTD_isError(length)) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Could not compress the package. %s\n",ZSTD_getErrorName(length));
+            }
+
+            err = PKG_BUILD_WRITE_ERROR;
+            break;
+        }
+
+        if(!writeBuffer(outFd, dst.data(), length)) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Could not write the compressed package. %s\n",strerror(errno));
+            }
+
+            err = PKG_BUILD_WRITE_ERROR;
+            break;
+        }
+
+        putLE(seekTable, length, 4);
+        putLE(seekTable, src.size(), 4);
+        frames++;
+        pos = end;
+    }
+
+    ZSTD_freeCCtx(cctx);
+
+    if(err != 0) {
+        return err;
+    }
+
+    // The footer: the number of frames, a descriptor saying there are no checksums, and the magic
+    putLE(seekTable, frames, 4);
+    seekTable.push_back(0);
+    putLE(seekTable, PKG_BUILD_SEEKABLE_MAGIC, 4);
+
+    std::string skippable;
+    putLE(skippable, PKG_BUILD_SKIPPABLE_MAGIC, 4);
+    putLE(skippable, seekTable.size(), 4);
+    skippable.append(seekTable);
+
+    if(!writeBuffer(outFd, skippable.data(), skippable.size())) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not write the compressed package. %s\n",strerror(errno));
+        }
+
+        return PKG_BUILD_WRITE_ERROR;
+    }
+
+    return 0;
+#else
+    if(verbosity != 0) {
+        fprintf(stderr,"Error: The package manager was built without libzstd, so it can't compress packages\n");
+    }
+
+    return PKG_BUILD_NO_ZSTD;
+#endif /* WITH_ZSTD */
+}/*}}}*/
+
+/**
+ * Makes a temporary file in a directory, which is renamed into place once it's complete
+ *
+ * @param [in] const std::string& pattern Ending in XXXXXX
+ * @param [out] std::string& path
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int fd, or -1
+ */
+static int makeTempFile(const std::string& pattern, std::string& path, unsigned int verbosity) {/*{{{*/
+    std::vector<char> name(pattern.begin(), pattern.end());
+    name.push_back('\0');
+
+    int fd = mkstemp(name.data());
+    if(fd < 0 || fchmod(fd, 0644) != 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not create %s. %s\n",pattern.c_str(),strerror(errno));
+        }
+
+        if(fd >= 0) {
+            close(fd);
+            unlink(name.data());
+        }
+
+        return -1;
+    }
+
+    path = name.data();
+    return fd;
+}/*}}}*/
+
+/**
+ * Builds a package out of a directory, which becomes the root the package is installed to
+ * The package is named after the directory, and written to outDir as an uncompressed, seekable tarball, or as zstd if asked for. It replaces any package of that name and format already there, once it's complete
+ *
+ * The metadata comes first, then the scripts at the top of the directory, then every directory, then the files grouped by the directory they're in, then the hard links. Files sharing an inode are stored once, and every other path to them as a hard link. Sparse files are stored without their holes.
+ *
+ * @param [in] std::string srcDir
+ * @param [in] std::string outDir
+ * @param [in] bool zstd
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 on success, or an error code
+ */
+int buildPkg(std::string srcDir, std::string outDir, bool zstd, unsigned int verbosity) {/*{{{*/
+    std::error_code ec;
+    if(!std::filesystem::is_directory(srcDir, ec)) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: %s is not a directory, so no package can be built from it\n",srcDir.c_str());
+        }
+
+        return PKG_BUILD_NOT_A_DIRECTORY;
+    }
+
+    std::filesystem::path src = std::filesystem::absolute(srcDir).lexically_normal();
+    if(src.filename().empty()) {
+        src = src.parent_path();
+    }
+
+    std::string out = std::filesystem::absolute(outDir).lexically_normal().string();
+    if(out.compare(0, src.string().size() + 1, src.string() + "/") == 0 || out == src.string()) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: The package can't be written into %s, since that's within the directory it's built from\n",out.c_str());
+        }
+
+        return PKG_BUILD_NOT_A_DIRECTORY;
+    }
+
+    std::filesystem::create_directories(out, ec);
+
+    std::string name = src.filename().string();
+    std::string tarPath = out + "/" + name + ".tar";
+    std::string pkgPath = zstd ? tarPath + ".zst" : tarPath;
+
+    std::vector<buildEntry_s> entries;
+    int err = collectEntries(src.string(), entries, verbosity);
+    if(err != 0) {
+        return err;
+    }
+
+    orderEntries(entries);
+
+    pkgMeta_s meta;
+    err = describePkg(src.string(), name, entries, meta, verbosity);
+    if(err != 0) {
+        return err;
+    }
+
+    std::string tmpTarPath;
+    int fd = makeTempFile(out + "/." + name + ".tar.XXXXXX", tmpTarPath, verbosity);
+    if(fd < 0) {
+        return PKG_BUILD_WRITE_ERROR;
+    }
+
+    unsigned long sparseFiles = 0;
+    err = writePkgTar(src.string(), serializePkgMeta(meta), entries, fd, sparseFiles, verbosity);
+    close(fd);
+
+    if(err == 0) {
+        err = writePkgIndex(tmpTarPath, verbosity);
+    }
+
+    unsigned long frames = 0;
+    if(err == 0 && zstd) {
+        std::string tmpZstPath;
+        int tarFd = open(tmpTarPath.c_str(), O_RDONLY | O_CLOEXEC);
+        int zstFd = (tarFd >= 0) ? makeTempFile(out + "/." + name + ".tar.zst.XXXXXX", tmpZstPath, verbosity) : -1;
+
+        err = (zstFd >= 0) ? compressSeekable(tarFd, zstFd, frames, verbosity) : PKG_BUILD_WRITE_ERROR;
+
+        if(err == 0 && fdatasync(zstFd) != 0) {
+            err = PKG_BUILD_WRITE_ERROR;
+        }
+
+        if(tarFd >= 0) {
+            close(tarFd);
+        }
+
+        if(zstFd >= 0) {
+            close(zstFd);
+        }
+
+        unlink(tmpTarPath.c_str());
+        tmpTarPath = tmpZstPath;
+    }
+
+    if(err == 0 && rename(tmpTarPath.c_str(), pkgPath.c_str()) != 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not move the package into place at %s. %s\n",pkgPath.c_str(),strerror(errno));
+        }
+
+        err = PKG_BUILD_WRITE_ERROR;
+    }
+
+    if(err != 0) {
+        if(!tmpTarPath.empty()) {
+            unlink(tmpTarPath.c_str());
+        }
+
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not build the package %s from %s\n",name.c_str(),src.c_str());
+        }
+
+        return err;
+    }
+
+    // The library is searched in the order of PKG_EXTENSIONS, so an uncompressed package of the same name still wins
+    if(zstd && verbosity != 0 && std::filesystem::exists(tarPath, ec)) {
+        fprintf(stderr,"Warning: %s is still there next to the package just built, and is the one which gets installed\n",tarPath.c_str());
+    }
+
+    if(verbosity >= 3) {
+        unsigned long counts[4] = { 0, 0, 0, 0 };
+        for(const buildEntry_s& e : entries) {
+            counts[e.rank]++;
+        }
+
+        printf("Built %s: %lu scripts, %lu directories, %lu files, %lu hard links, %lu sparse files",pkgPath.c_str(),counts[PKG_BUILD_RANK_SCRIPT],counts[PKG_BUILD_RANK_DIRECTORY],counts[PKG_BUILD_RANK_FILE],counts[PKG_BUILD_RANK_HARDLINK],sparseFiles);
+
+        if(zstd) {
+            printf(", in %lu zstd frames",frames);
+        }
+
+        printf("\n");
+    }
+
+    return 0;
+}/*}}}*/
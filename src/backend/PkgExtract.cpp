@@ -0,0 +1,562 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file PkgExtract.cpp
+ * @error -2800
+ *
+ * The extract mode; Pulls single members out of a package, to standard output or into a directory, without installing it.
+ * An uncompressed package is never read past what was asked for. Its members are listed from its index if it has one, or from its headers otherwise, and each requested file's data is then copied straight from its offset.
+ * A compressed package can't be seeked through, so it is decoded until its end, and only the requested members are kept.
+ */
+
+#include "PkgExtract.h"
+
+/**
+ * Whether or not a member was asked for. When extracting into a directory, asking for a directory also asks for everything below it
+ *
+ * @param [in] const std::string& path The normalized path of the member
+ * @param [in] const std::set<std::string>& requested The normalized paths asked for. An empty one asks for the whole package
+ * @param [in] bool recursive
+ * @param [out] std::string& matched The request the member answers
+ *
+ * @returns bool wasTheMemberRequested
+ */
+static bool isRequested(const std::string& path, const std::set<std::string>& requested, bool recursive, std::string& matched) {/*{{{*/
+    if(requested.count(path) != 0) {
+        matched = path;
+        return true;
+    }
+
+    if(!recursive) {
+        return false;
+    }
+
+    for(size_t slash = path.rfind('/'); slash != std::string::npos && slash > 0; slash = path.rfind('/', slash - 1)) {
+        if(requested.count(path.substr(0, slash)) != 0) {
+            matched = path.substr(0, slash);
+            return true;
+        }
+    }
+
+    if(requested.count("") != 0) {
+        matched = "";
+        return true;
+    }
+
+    return false;
+}/*}}}*/
+
+/**
+ * Copies the data of each requested file to standard output, in the order they were asked for
+ * Only the data of those members is read
+ *
+ * @param [in] int fd
+ * @param [in] const std::vector<tarMember_s>& members
+ * @param [in] const std::vector<std::string>& paths Normalized, in the order they were asked for
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 if every path was written out, or the error of the last one which wasn't
+ */
+static int catSeekable(int fd, const std::vector<tarMember_s>& members, const std::vector<std::string>& paths, unsigned int verbosity) {/*{{{*/
+    // A later member at the same path is the one extraction would leave behind
+    std::unordered_map<std::string, size_t> latest;
+    for(size_t index = 0; index < members.size(); index++) {
+        latest[normalizeMemberPath(members[index].path)] = index;
+    }
+
+    int err = 0;
+
+    for(const std::string& path : paths) {
+        auto it = latest.find(path);
+        if(it == latest.end()) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: The package has no member %s\n",path.c_str());
+            }
+
+            err = PKG_EXTRACT_NOT_FOUND;
+            continue;
+        }
+
+        const tarMember_s* m = &members[it->second];
+
+        // A hard link's data is its target's
+        if(m->type == TAR_TYPE_HARDLINK && m->size == 0) {
+            auto target = latest.find(normalizeMemberPath(m->linkTarget));
+            m = (target != latest.end()) ? &members[target->second] : NULL;
+        }
+
+        if(m == NULL || !isRegularTarType(m->type) || m->needsFallback) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: %s is not a plain file, so it can't be written to standard output. Extract it into a directory instead.\n",path.c_str());
+            }
+
+            err = PKG_EXTRACT_NOT_REGULAR;
+            continue;
+        }
+
+        // Anything we printed ourselves has to come out before the data
+        fflush(stdout);
+
+        if(copyFileData(fd, m->dataOffset, STDOUT_FILENO, m->size) != m->size) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Could not write %s to standard output. %s\n",path.c_str(),strerror(errno));
+            }
+
+            return PKG_EXTRACT_WRITE_ERROR;
+        }
+    }
+
+    return err;
+}/*}}}*/
+
+/**
+ * Extracts the requested members of an uncompressed package into a directory, through the zero-copy engine
+ * A hard link whose target wasn't asked for is extracted as a copy of the target
+ *
+ * @param [in] int fd
+ * @param [in] std::string tarPath
+ * @param [in] const std::vector<tarMember_s>& members
+ * @param [in] const std::set<std::string>& requested Normalized
+ * @param [in] std::string outputDir
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 if every path was extracted, or an error code
+ */
+static int extractSeekable(int fd, std::string tarPath, const std::vector<tarMember_s>& members, const std::set<std::string>& requested, std::string outputDir, unsigned int verbosity) {/*{{{*/
+    std::unordered_map<std::string, size_t> latest;
+    for(size_t index = 0; index < members.size(); index++) {
+        latest[normalizeMemberPath(members[index].path)] = index;
+    }
+
+    std::vector<tarMember_s> selected;
+    std::set<std::string> found;
+
+    for(const tarMember_s& m : members) {
+        std::string matched;
+        if(!isRequested(normalizeMemberPath(m.path), requested, true, matched)) {
+            continue;
+        }
+
+        found.insert(matched);
+
+        std::string unused;
+        auto target = latest.find(normalizeMemberPath(m.linkTarget));
+        if(m.type == TAR_TYPE_HARDLINK && m.size == 0 && !isRequested(normalizeMemberPath(m.linkTarget), requested, true, unused) && target != latest.end()) {
+            tarMember_s copy = members[target->second];
+            copy.path = m.path;
+            selected.push_back(copy);
+            continue;
+        }
+
+        selected.push_back(m);
+    }
+
+    int err = 0;
+    for(const std::string& path : requested) {
+        if(found.count(path) == 0) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: The package has no member %s\n",path.c_str());
+            }
+
+            err = PKG_EXTRACT_NOT_FOUND;
+        }
+    }
+
+    if(selected.empty()) {
+        return err;
+    }
+
+    ExclusionMatcher none;
+    std::set<std::string> fallbackPaths;
+    std::vector<std::pair<std::string, mode_t>> dirModes;
+    int res = extractTarZeroCopy(fd, selected, outputDir, none, fallbackPaths, verbosity, NULL, NULL, &dirModes);
+
+    if(res == 0 && !fallbackPaths.empty()) {
+        res = extractWithLibarchive(tarPath, outputDir, none, &fallbackPaths, verbosity);
+        res = (res == ARCHIVE_EOF) ? 0 : res;
+    }
+
+    if(res == 0) {
+        applyDirModes(outputDir, dirModes, verbosity);
+    }
+
+    if(res != 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not extract the requested members of %s into %s\n",tarPath.c_str(),outputDir.c_str());
+        }
+
+        return res;
+    }
+
+    if(verbosity >= 3) {
+        printf("Extracted %lu members of %s into %s\n",selected.size(),tarPath.c_str(),outputDir.c_str());
+    }
+
+    return err;
+}/*}}}*/
+
+/**
+ * Decodes a package a second time, for the targets of hard links which were asked for when their targets weren't
+ * The first pass had already decoded past each target by the time its link came up. As when the package is seekable, the links are given the target's data
+ *
+ * @param [in] std::string tarPath
+ * @param [in] const std::map<std::string, std::string>& links The normalized path of each link, and of its target
+ * @param [in] std::string outputDir Empty for standard output
+ * @param [in/out] std::map<std::string, std::string>& bodies Where the data of each link is put, when writing to standard output
+ * @param [out] std::set<std::string>& resolved The links whose target was found
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 on success, or an error code
+ */
+static int extractLinkTargets(std::string tarPath, const std::map<std::string, std::string>& links, std::string outputDir, std::map<std::string, std::string>& bodies, std::set<std::string>& resolved, unsigned int verbosity) {/*{{{*/
+    archive* a;
+    archive_entry* ae;
+    if(!openArchiveWithTarSupport(a, tarPath.c_str(), verbosity)) {
+        return PKG_EXTRACT_OPEN_ERROR;
+    }
+
+    std::map<std::string, std::vector<std::string>> byTarget;
+    for(const auto& entry : links) {
+        byTarget[entry.second].push_back(entry.first);
+    }
+
+    int res;
+    int err = 0;
+
+    while(err == 0 && (res = archive_read_next_header(a, &ae)) == ARCHIVE_OK) {
+        const char* aePath = archive_entry_pathname(ae);
+        auto it = byTarget.find(normalizeMemberPath((aePath != NULL) ? aePath : ""));
+        if(it == byTarget.end() || archive_entry_hardlink(ae) != NULL || archive_entry_filetype(ae) != AE_IFREG) {
+            continue;
+        }
+
+        const std::vector<std::string>& paths = it->second;
+        resolved.insert(paths.begin(), paths.end());
+
+        if(outputDir.empty()) {
+            std::string body;
+            char buf[65536];
+            la_ssize_t r;
+
+            while((r = archive_read_data(a, buf, sizeof(buf))) > 0) {
+                body.append(buf, r);
+            }
+
+            if(r < 0) {
+                if(verbosity != 0) {
+                    fprintf(stderr,"Error: Could not read %s from %s. %s\n",it->first.c_str(),tarPath.c_str(),archive_error_string(a));
+                }
+
+                err = r;
+                break;
+            }
+
+            for(const std::string& path : paths) {
+                bodies[path] = body;
+            }
+
+            continue;
+        }
+
+        // The first link gets the data. The others are linked to it once the archive was read, as they were in the package
+        std::string dest = outputDir + "/" + paths.front();
+        archive_entry_set_pathname(ae, dest.c_str());
+
+        int r = archive_read_extract(a, ae, LIBARCHIVE_EXTRACT_FLAGS);
+        if(r < ARCHIVE_WARN) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Could not extract %s. %s\n",paths.front().c_str(),archive_error_string(a));
+            }
+
+            err = r;
+        }
+    }
+
+    if(err == 0 && res != ARCHIVE_EOF) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: An error occured while reading the tar file %s.\n",tarPath.c_str());
+        }
+
+        err = res;
+    }
+
+    archive_read_free(a);
+
+    if(err != 0 || outputDir.empty()) {
+        return err;
+    }
+
+    for(const auto& target : byTarget) {
+        std::string first = outputDir + "/" + target.second.front();
+
+        for(size_t index = 1; index < target.second.size() && resolved.count(target.second.front()) != 0; index++) {
+            std::string dest = outputDir + "/" + target.second[index];
+
+            std::error_code ec;
+            std::filesystem::create_directories(std::filesystem::path(dest).parent_path(), ec);
+            unlink(dest.c_str());
+
+            if(link(first.c_str(), dest.c_str()) != 0) {
+                if(verbosity != 0) {
+                    fprintf(stderr,"Error: Could not create the hard link %s. %s\n",dest.c_str(),strerror(errno));
+                }
+
+                return PKG_EXTRACT_WRITE_ERROR;
+            }
+        }
+    }
+
+    return 0;
+}/*}}}*/
+
+/**
+ * Decodes a package which can't be seeked through, and keeps only the requested members
+ * Files written to standard output are held in memory until the end of the archive, since a later member may replace them, and come out in the order they were asked for
+ * A hard link whose target wasn't asked for is given a copy of the target's data, which is read on a second pass. See extractLinkTargets
+ *
+ * @param [in] std::string tarPath
+ * @param [in] const std::vector<std::string>& paths Normalized, in the order they were asked for
+ * @param [in] std::string outputDir Empty for standard output
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 if every path was extracted, or an error code
+ */
+static int extractStreamed(std::string tarPath, const std::vector<std::string>& paths, std::string outputDir, unsigned int verbosity) {/*{{{*/
+    archive* a;
+    archive_entry* ae;
+    if(!openArchiveWithTarSupport(a, tarPath.c_str(), verbosity)) {
+        return PKG_EXTRACT_OPEN_ERROR;
+    }
+
+    std::set<std::string> requested(paths.begin(), paths.end());
+    std::set<std::string> found;
+    std::map<std::string, std::string> bodies;
+    std::set<std::string> notRegular;
+    std::map<std::string, std::string> pendingLinks;
+    int res;
+    int err = 0;
+
+    while(err == 0 && (res = archive_read_next_header(a, &ae)) == ARCHIVE_OK) {
+        const char* aePath = archive_entry_pathname(ae);
+        std::string path = normalizeMemberPath((aePath != NULL) ? aePath : "");
+        std::string matched;
+
+        if(isPkgIndex(path) || !isRequested(path, requested, !outputDir.empty(), matched)) {
+            continue;
+        }
+
+        found.insert(matched);
+
+        // A later member at the same path replaces the link
+        const char* link = archive_entry_hardlink(ae);
+        pendingLinks.erase(path);
+
+        if(outputDir.empty()) {
+            if(link != NULL && bodies.count(normalizeMemberPath(link)) != 0) {
+                bodies[path] = bodies[normalizeMemberPath(link)];
+                notRegular.erase(path);
+            }
+
+            // The target wasn't asked for, so its data was skipped
+            else if(link != NULL && archive_entry_size(ae) == 0) {
+                bodies.erase(path);
+                notRegular.erase(path);
+                pendingLinks[path] = normalizeMemberPath(link);
+            }
+
+            else if(link != NULL || archive_entry_filetype(ae) != AE_IFREG) {
+                bodies.erase(path);
+                notRegular.insert(path);
+            }
+
+            else {
+                std::string body;
+                char buf[65536];
+                la_ssize_t r;
+
+                while((r = archive_read_data(a, buf, sizeof(buf))) > 0) {
+                    body.append(buf, r);
+                }
+
+                if(r < 0) {
+                    if(verbosity != 0) {
+                        fprintf(stderr,"Error: Could not read %s from %s. %s\n",path.c_str(),tarPath.c_str(),archive_error_string(a));
+                    }
+
+                    err = r;
+                    break;
+                }
+
+                bodies[path] = body;
+                notRegular.erase(path);
+            }
+
+            continue;
+        }
+
+        if(!isSafeMemberPath(aePath)) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: The archive member %s would be extracted outside of %s. Refusing to continue.\n",aePath,outputDir.c_str());
+            }
+
+            err = -701;
+            break;
+        }
+
+        std::string unused;
+        if(link != NULL && archive_entry_size(ae) == 0 && !isRequested(normalizeMemberPath(link), requested, true, unused)) {
+            pendingLinks[path] = normalizeMemberPath(link);
+            continue;
+        }
+
+        std::string dest = outputDir + "/" + aePath;
+        archive_entry_set_pathname(ae, dest.c_str());
+
+        if(archive_entry_hardlink(ae) != NULL) {
+            archive_entry_set_hardlink(ae, (outputDir + "/" + archive_entry_hardlink(ae)).c_str());
+        }
+
+        int r = archive_read_extract(a, ae, LIBARCHIVE_EXTRACT_FLAGS);
+        if(r < ARCHIVE_WARN) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Could not extract %s. %s\n",path.c_str(),archive_error_string(a));
+            }
+
+            err = r;
+        }
+    }
+
+    if(err == 0 && res != ARCHIVE_EOF) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: An error occured while reading the tar file %s.\n",tarPath.c_str());
+        }
+
+        err = res;
+    }
+
+    archive_read_free(a);
+
+    std::set<std::string> resolved;
+    if(err == 0 && !pendingLinks.empty()) {
+        if(verbosity >= 3) {
+            printf("Decoding %s again for the targets of %lu hard links\n",tarPath.c_str(),pendingLinks.size());
+        }
+
+        err = extractLinkTargets(tarPath, pendingLinks, outputDir, bodies, resolved, verbosity);
+    }
+
+    if(err != 0) {
+        return err;
+    }
+
+    for(const auto& entry : pendingLinks) {
+        if(resolved.count(entry.first) == 0) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: The package has no file %s for the hard link %s to point to\n",entry.second.c_str(),entry.first.c_str());
+            }
+
+            err = PKG_EXTRACT_NOT_FOUND;
+        }
+    }
+
+    for(const std::string& path : paths) {
+        if(pendingLinks.count(path) != 0 && resolved.count(path) == 0) {
+            continue;
+        }
+
+        if(found.count(path) == 0) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: The package has no member %s\n",path.c_str());
+            }
+
+            err = PKG_EXTRACT_NOT_FOUND;
+            continue;
+        }
+
+        if(!outputDir.empty()) {
+            continue;
+        }
+
+        if(notRegular.count(path) != 0) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: %s is not a plain file, so it can't be written to standard output. Extract it into a directory instead.\n",path.c_str());
+            }
+
+            err = PKG_EXTRACT_NOT_REGULAR;
+            continue;
+        }
+
+        fflush(stdout);
+
+        const std::string& body = bodies[path];
+        if(!writeBuffer(STDOUT_FILENO, body.data(), body.size())) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Could not write %s to standard output. %s\n",path.c_str(),strerror(errno));
+            }
+
+            return PKG_EXTRACT_WRITE_ERROR;
+        }
+    }
+
+    return err;
+}/*}}}*/
+
+/**
+ * Writes members of a package to standard output, or extracts them into a directory
+ *
+ * Written to standard output, each path has to be a file, and the files come out one after the other, in the order they were asked for.
+ * Extracted into a directory, which is created if need be, a path may also be a directory, in which case everything below it is extracted too.
+ * Uncompressed packages are read at random, through their index or the member cache if they have either. See readPkgMembers.
+ *
+ * @param [in] std::string tarPath
+ * @param [in] const std::vector<std::string>& paths Paths within the package
+ * @param [in] std::string outputDir Empty for standard output
+ * @param [in] unsigned int verbosity
+ * @param [in] MemberCache* cache Where the members of a tarball without an index are looked up before its headers are walked. May be NULL
+ *
+ * @returns int 0 if every path was found and written out, or an error code
+ */
+int extractPkgMembers(std::string tarPath, const std::vector<std::string>& paths, std::string outputDir, unsigned int verbosity, MemberCache* cache) {/*{{{*/
+    std::vector<std::string> normalized;
+    for(const std::string& path : paths) {
+        normalized.push_back((path == ".") ? "" : normalizeMemberPath(path));
+    }
+
+    if(!outputDir.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(outputDir, ec);
+
+        if(!std::filesystem::is_directory(outputDir)) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: The output path %s is not a directory, and could not be created.\n",outputDir.c_str());
+            }
+
+            return PKG_EXTRACT_OPEN_ERROR;
+        }
+    }
+
+    int fd = open(tarPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not open %s. %s\n",tarPath.c_str(),strerror(errno));
+        }
+
+        return PKG_EXTRACT_OPEN_ERROR;
+    }
+
+    std::vector<tarMember_s> members;
+    if(isPlainTar(fd) && readPkgMembers(fd, members, (verbosity >= 3) ? verbosity : 0, cache) == 0) {
+        int res = outputDir.empty() ? catSeekable(fd, members, normalized, verbosity) : extractSeekable(fd, tarPath, members, std::set<std::string>(normalized.begin(), normalized.end()), outputDir, verbosity);
+        close(fd);
+        return res;
+    }
+
+    close(fd);
+
+    if(verbosity >= 3) {
+        printf("%s can't be read at random. Decoding all of it instead\n",tarPath.c_str());
+    }
+
+    return extractStreamed(tarPath, normalized, outputDir, verbosity);
+}/*}}}*/
@@ -0,0 +1,439 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file PkgIndex.cpp
+ * @error -2700
+ *
+ * Reads and writes the index of seekable packages.
+ * Tar has no index, so anything which wants a single member, or the list of them, has to walk every header from the start of the archive. A seekable package is an uncompressed tarball whose last member, PKG_INDEX_NAME, records every other member along with where its data lives and its hash.
+ * The index is an ordinary member, so tar and libarchive read the package unchanged, and only see one more file. We never install it.
+ *
+ * The index data is a 16 byte header (the magic, the format version and the number of records), followed by one record per member, in archive order.
+ * Each record is the type, the flags and the hash length, one byte each, then the path length, link target length, mode, uid, gid, size, mtime, header offset and data offset as LEB128 integers, and finally the path, the link target and the raw hash.
+ * The data is padded to a whole block, and followed by a trailer block: PKG_INDEX_TRAILER_MAGIC, the format version, the offset of the index member's header, the length of the index data and its SHA-256. All integers are little-endian.
+ * The trailer is the last block before the end-of-archive marker, so a reader finds it from the end of the file in a couple of reads, and can tell the index apart from anything appended to the archive since.
+ */
+
+#include "PkgIndex.h"
+#include "MemberCache.h"
+
+// The offsets of the trailer's fields
+#define TRAILER_VERSION_OFFSET 8
+#define TRAILER_HEADER_OFFSET 16
+#define TRAILER_LENGTH_OFFSET 24
+#define TRAILER_DIGEST_OFFSET 32
+
+/**
+ * Whether or not an archive member is the package index
+ *
+ * @param [in] const std::string& path
+ *
+ * @returns bool isPkgIndex
+ */
+bool isPkgIndex(const std::string& path) {/*{{{*/
+    return normalizeMemberPath(path) == PKG_INDEX_NAME;
+}/*}}}*/
+
+/**
+ * @param [in] off_t size
+ *
+ * @returns off_t size, rounded up to a whole number of tar blocks
+ */
+static off_t blockAlign(off_t size) {/*{{{*/
+    return ((size + TAR_BLOCKSIZE - 1) / TAR_BLOCKSIZE) * TAR_BLOCKSIZE;
+}/*}}}*/
+
+/**
+ * Writes the whole buffer at offset
+ *
+ * @param [in] int fd
+ * @param [in] const char* buf
+ * @param [in] size_t len
+ * @param [in] off_t offset
+ *
+ * @returns bool success, with errno set if not
+ */
+static bool writeAt(int fd, const char* buf, size_t len, off_t offset) {/*{{{*/
+    size_t done = 0;
+
+    while(done < len) {
+        ssize_t w = pwrite(fd, buf + done, len - done, offset + done);
+        if(w < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if(w <= 0) {
+            return false;
+        }
+
+        done += w;
+    }
+
+    return true;
+}/*}}}*/
+
+/**
+ * Writes value into a numeric header field, as zero-padded octal followed by a NUL
+ *
+ * @param [in] char* field
+ * @param [in] size_t len
+ * @param [in] unsigned long long value
+ */
+static void putTarNumber(char* field, size_t len, unsigned long long value) {/*{{{*/
+    snprintf(field, len, "%0*llo", (int)(len - 1), value);
+}/*}}}*/
+
+/**
+ * Builds the ustar header of the index member
+ * The owner and times are zeroed, so indexing the same archive twice gives the same bytes
+ *
+ * @param [out] char* block TAR_BLOCKSIZE bytes
+ * @param [in] off_t size The size of the index member's data
+ */
+static void buildIndexHeader(char* block, off_t size) {/*{{{*/
+    memset(block, 0, TAR_BLOCKSIZE);
+    memcpy(block, PKG_INDEX_NAME, strlen(PKG_INDEX_NAME));
+    putTarNumber(block + 100, 8, 0644);
+    putTarNumber(block + 108, 8, 0);
+    putTarNumber(block + 116, 8, 0);
+    putTarNumber(block + 124, 12, size);
+    putTarNumber(block + 136, 12, 0);
+    block[156] = TAR_TYPE_REGULAR;
+    memcpy(block + 257, "ustar\0" "00", 8);
+
+    // The checksum is taken with its own field set to spaces
+    memset(block + 148, ' ', 8);
+    unsigned long sum = 0;
+    for(int index = 0; index < TAR_BLOCKSIZE; index++) {
+        sum += (unsigned char)block[index];
+    }
+
+    snprintf(block + 148, 7, "%06lo", sum);
+}/*}}}*/
+
+/**
+ * Turns the members into the index data. The member cache stores the same records
+ *
+ * @param [in] const std::vector<tarMember_s>& members
+ *
+ * @returns std::string index
+ */
+std::string serializePkgIndex(const std::vector<tarMember_s>& members) {/*{{{*/
+    std::string buf(PKG_INDEX_MAGIC, PKG_INDEX_MAGIC_SIZE);
+    putLE(buf, PKG_INDEX_VERSION, 4);
+    putLE(buf, members.size(), 4);
+
+    for(const tarMember_s& m : members) {
+        buf.push_back(m.type);
+        buf.push_back(m.needsFallback ? PKG_INDEX_FLAG_FALLBACK : 0);
+        buf.push_back((char)m.hash.size());
+        putVarint(buf, m.path.size());
+        putVarint(buf, m.linkTarget.size());
+        putVarint(buf, m.mode);
+        putVarint(buf, m.uid);
+        putVarint(buf, m.gid);
+        putVarint(buf, m.size);
+        putVarint(buf, m.mtime);
+        putVarint(buf, m.headerOffset);
+        putVarint(buf, m.dataOffset);
+        buf.append(m.path);
+        buf.append(m.linkTarget);
+        buf.append(m.hash);
+    }
+
+    return buf;
+}/*}}}*/
+
+/**
+ * Parses the index data
+ *
+ * @param [in] const std::string& buf
+ * @param [in] off_t indexOffset Where the index member starts. Every member has to lie before it
+ * @param [out] std::vector<tarMember_s>& members
+ *
+ * @returns bool wasTheIndexValid
+ */
+bool parsePkgIndex(const std::string& buf, off_t indexOffset, std::vector<tarMember_s>& members) {/*{{{*/
+    if(buf.size() < PKG_INDEX_MAGIC_SIZE + 8 || memcmp(buf.data(), PKG_INDEX_MAGIC, PKG_INDEX_MAGIC_SIZE) != 0 || getLE(buf.data() + PKG_INDEX_MAGIC_SIZE, 4) != PKG_INDEX_VERSION) {
+        return false;
+    }
+
+    uint64_t count = getLE(buf.data() + PKG_INDEX_MAGIC_SIZE + 4, 4);
+    const char* p = buf.data() + PKG_INDEX_MAGIC_SIZE + 8;
+    const char* end = buf.data() + buf.size();
+
+    members.clear();
+
+    for(uint64_t index = 0; index < count; index++) {
+        if(end - p < 3) {
+            return false;
+        }
+
+        tarMember_s m;
+        m.type = p[0];
+        m.needsFallback = (p[1] & PKG_INDEX_FLAG_FALLBACK) != 0;
+        size_t hashLen = (unsigned char)p[2];
+        p += 3;
+
+        uint64_t pathLen, linkLen, mode, uid, gid, size, mtime, headerOffset, dataOffset;
+        if(!getVarint(p, end, pathLen) || !getVarint(p, end, linkLen) || !getVarint(p, end, mode) || !getVarint(p, end, uid) || !getVarint(p, end, gid) || !getVarint(p, end, size) || !getVarint(p, end, mtime) || !getVarint(p, end, headerOffset) || !getVarint(p, end, dataOffset)) {
+            return false;
+        }
+
+        if((uint64_t)(end - p) < pathLen + linkLen + hashLen || dataOffset > (uint64_t)indexOffset || size > (uint64_t)indexOffset - dataOffset) {
+            return false;
+        }
+
+        m.path.assign(p, pathLen);
+        m.linkTarget.assign(p + pathLen, linkLen);
+        m.hash.assign(p + pathLen + linkLen, hashLen);
+        p += pathLen + linkLen + hashLen;
+
+        m.mode = mode;
+        m.uid = uid;
+        m.gid = gid;
+        m.size = size;
+        m.mtime = mtime;
+        m.headerOffset = headerOffset;
+        m.dataOffset = dataOffset;
+        members.push_back(m);
+    }
+
+    return p == end;
+}/*}}}*/
+
+/**
+ * Reads the members of a seekable package from its index, without walking its headers
+ *
+ * The trailer is found by skipping back over the end-of-archive marker, and any padding, from the end of the file. It has to point at a valid header for PKG_INDEX_NAME which ends right at the trailer, and the index data has to match the hash the trailer records.
+ * Anything appended to the archive after it was indexed pushes the trailer away from the end, so an index which no longer describes the whole archive is never used.
+ *
+ * @param [in] int fd
+ * @param [out] std::vector<tarMember_s>& members
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 on success, PKG_INDEX_ABSENT if the archive has no index, or another negative value if it's damaged
+ */
+int readPkgIndex(int fd, std::vector<tarMember_s>& members, unsigned int verbosity) {/*{{{*/
+    static const char zeroBlock[TAR_BLOCKSIZE] = { 0 };
+
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        return PKG_INDEX_IO_ERROR;
+    }
+
+    if(st.st_size < 4 * TAR_BLOCKSIZE || st.st_size % TAR_BLOCKSIZE != 0) {
+        return PKG_INDEX_ABSENT;
+    }
+
+    char block[TAR_BLOCKSIZE];
+    off_t trailerOffset = st.st_size - TAR_BLOCKSIZE;
+    unsigned int zeroBlocks = 0;
+
+    while(zeroBlocks < PKG_INDEX_SEARCH_BLOCKS && trailerOffset >= 0) {
+        if(pread(fd, block, TAR_BLOCKSIZE, trailerOffset) != TAR_BLOCKSIZE) {
+            return PKG_INDEX_IO_ERROR;
+        }
+
+        if(memcmp(block, zeroBlock, TAR_BLOCKSIZE) != 0) {
+            break;
+        }
+
+        zeroBlocks++;
+        trailerOffset -= TAR_BLOCKSIZE;
+    }
+
+    // The end-of-archive marker is two zero blocks
+    if(zeroBlocks < 2 || trailerOffset < 0 || memcmp(block, PKG_INDEX_TRAILER_MAGIC, PKG_INDEX_MAGIC_SIZE) != 0 || getLE(block + TRAILER_VERSION_OFFSET, 4) != PKG_INDEX_VERSION) {
+        return PKG_INDEX_ABSENT;
+    }
+
+    off_t headerOffset = getLE(block + TRAILER_HEADER_OFFSET, 8);
+    off_t length = getLE(block + TRAILER_LENGTH_OFFSET, 8);
+    std::string digest(block + TRAILER_DIGEST_OFFSET, SHA256_DIGEST_SIZE);
+
+    char header[TAR_BLOCKSIZE];
+    if(headerOffset < 0 || length < 0 || headerOffset % TAR_BLOCKSIZE != 0 || headerOffset + TAR_BLOCKSIZE + blockAlign(length) != trailerOffset || pread(fd, header, TAR_BLOCKSIZE, headerOffset) != TAR_BLOCKSIZE || !isValidTarHeader(header) || !isPkgIndex(tarString(header, 100)) || parseTarNumber(header + 124, 12) != trailerOffset + TAR_BLOCKSIZE - headerOffset - TAR_BLOCKSIZE) {
+        if(verbosity >= 3) {
+            fprintf(stderr,"Warning: The index trailer of the archive doesn't match its index member. Walking its headers instead.\n");
+        }
+
+        return PKG_INDEX_CORRUPT;
+    }
+
+    std::string data;
+    if(!readTarRange(fd, headerOffset + TAR_BLOCKSIZE, length, data)) {
+        if(verbosity >= 3) {
+            fprintf(stderr,"Warning: Could not read the index of the archive. %s\n",strerror(errno));
+        }
+
+        return PKG_INDEX_IO_ERROR;
+    }
+
+    if(sha256(data.data(), data.size()) != digest || !parsePkgIndex(data, headerOffset, members)) {
+        if(verbosity >= 3) {
+            fprintf(stderr,"Warning: The index of the archive is damaged. Walking its headers instead.\n");
+        }
+
+        members.clear();
+        return PKG_INDEX_CORRUPT;
+    }
+
+    if(verbosity >= 4) {
+        printf("Read %lu members from the index of the archive\n",members.size());
+    }
+
+    return 0;
+}/*}}}*/
+
+/**
+ * Lists the members of an uncompressed tarball, from its index if it has a usable one, and by walking its headers otherwise
+ * A tarball without an index is looked up in the member cache before it's walked, and what the walk finds is cached for next time
+ * The index member itself is never listed
+ *
+ * @param [in] int fd
+ * @param [out] std::vector<tarMember_s>& members
+ * @param [in] unsigned int verbosity
+ * @param [in] MemberCache* cache May be NULL
+ *
+ * @returns int 0 on success, or an error code per readTarMembers
+ */
+int readPkgMembers(int fd, std::vector<tarMember_s>& members, unsigned int verbosity, MemberCache* cache) {/*{{{*/
+    if(readPkgIndex(fd, members, verbosity) == 0) {
+        return 0;
+    }
+
+    members.clear();
+
+    if(cache != NULL && cache->load(fd, members)) {
+        return 0;
+    }
+
+    int res = readTarMembers(fd, members, verbosity);
+    if(res != 0) {
+        return res;
+    }
+
+    for(size_t index = 0; index < members.size(); index++) {
+        if(isPkgIndex(members[index].path)) {
+            members.erase(members.begin() + index);
+            index--;
+        }
+    }
+
+    if(cache != NULL) {
+        cache->store(fd, members);
+    }
+
+    return 0;
+}/*}}}*/
+
+/**
+ * Makes an uncompressed tarball seekable, by appending an index of its members. An index it already had is replaced
+ *
+ * The archive is first cut off where the index will go, then the index is written behind that, and its header last. Whenever this is interrupted, what's on disk is still a tarball of every original member.
+ *
+ * @param [in] std::string tarPath
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 on success, or a negative error code
+ */
+int writePkgIndex(std::string tarPath, unsigned int verbosity) {/*{{{*/
+    int fd = open(tarPath.c_str(), O_RDWR | O_CLOEXEC);
+    if(fd < 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not open %s to index it. %s\n",tarPath.c_str(),strerror(errno));
+        }
+
+        return PKG_INDEX_IO_ERROR;
+    }
+
+    if(!isPlainTar(fd)) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: %s is not an uncompressed tarball. Only those can be indexed, since nothing else can be seeked through.\n",tarPath.c_str());
+        }
+
+        close(fd);
+        return PKG_INDEX_UNSUPPORTED;
+    }
+
+    std::vector<tarMember_s> walked;
+    int err = readTarMembers(fd, walked, verbosity);
+    if(err != 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not read the headers of %s, so it can't be indexed.\n",tarPath.c_str());
+        }
+
+        close(fd);
+        return (err == TAR_UNSUPPORTED) ? PKG_INDEX_UNSUPPORTED : err;
+    }
+
+    // An index which is the last member is replaced. Any other member ends where the next one may start
+    std::vector<tarMember_s> members;
+    off_t end = 0;
+
+    for(tarMember_s& m : walked) {
+        if(isPkgIndex(m.path)) {
+            end = m.headerOffset;
+            continue;
+        }
+
+        if(isRegularTarType(m.type) && !sha256File(fd, m.size, m.hash, m.dataOffset)) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Could not hash the member %s of %s. %s\n",m.path.c_str(),tarPath.c_str(),strerror(errno));
+            }
+
+            close(fd);
+            return PKG_INDEX_IO_ERROR;
+        }
+
+        end = m.dataOffset + blockAlign(m.size);
+        members.push_back(m);
+    }
+
+    std::string data = serializePkgIndex(members);
+    off_t length = data.size();
+    data.resize(blockAlign(length), '\0');
+
+    char trailer[TAR_BLOCKSIZE] = { 0 };
+    memcpy(trailer, PKG_INDEX_TRAILER_MAGIC, PKG_INDEX_MAGIC_SIZE);
+
+    std::string fields;
+    putLE(fields, PKG_INDEX_VERSION, 4);
+    putLE(fields, 0, 4);
+    putLE(fields, end, 8);
+    putLE(fields, length, 8);
+    memcpy(trailer + TRAILER_VERSION_OFFSET, fields.data(), fields.size());
+    memcpy(trailer + TRAILER_DIGEST_OFFSET, sha256(data.data(), length).data(), SHA256_DIGEST_SIZE);
+
+    data.append(trailer, TAR_BLOCKSIZE);
+
+    // The end-of-archive marker
+    data.append(2 * TAR_BLOCKSIZE, '\0');
+
+    char header[TAR_BLOCKSIZE];
+    buildIndexHeader(header, data.size() - 2 * TAR_BLOCKSIZE);
+
+    static const char zeroBlock[TAR_BLOCKSIZE] = { 0 };
+    bool written = writeAt(fd, zeroBlock, TAR_BLOCKSIZE, end) && fdatasync(fd) == 0;
+    written = written && writeAt(fd, data.data(), data.size(), end + TAR_BLOCKSIZE) && ftruncate(fd, end + TAR_BLOCKSIZE + data.size()) == 0 && fdatasync(fd) == 0;
+    written = written && writeAt(fd, header, TAR_BLOCKSIZE, end) && fdatasync(fd) == 0;
+
+    if(!written) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not write the index of %s. %s\n",tarPath.c_str(),strerror(errno));
+        }
+
+        close(fd);
+        return PKG_INDEX_IO_ERROR;
+    }
+
+    close(fd);
+
+    if(verbosity >= 3) {
+        printf("Indexed the %lu members of %s\n",members.size(),tarPath.c_str());
+    }
+
+    return 0;
+}/*}}}*/
@@ -0,0 +1,318 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file PkgMeta.cpp
+ * @error -3100
+ *
+ * Reads and writes the metadata member of a package.
+ * Besides its file name, all a tarball can tell us about its package is in its members, and finding those means walking or decompressing the whole thing. Listing the library, or working out what a package needs, shouldn't have to.
+ * So a package may start with a small member holding its name, version, installed size, file count, dependencies and which scripts it has. It's only looked for as the very first member, so reading it never goes past the first few KB of the package, compressed or not.
+ * The member is plain text, one key=value pair per line, in the same style as the config files. Keys we don't know are skipped, so older versions can read the metadata of newer packages.
+ */
+
+#include "PkgMeta.h"
+
+// The names the scripts go by in the metadata, in the order of the PKG_META_* script flags
+static const char* const scriptNames[] = { "pre-install", "post-install", "pre-uninstall", "post-uninstall" };
+
+/**
+ * Whether or not an archive member is the package metadata
+ *
+ * @param [in] const std::string& path
+ *
+ * @returns bool isPkgMeta
+ */
+bool isPkgMeta(const std::string& path) {/*{{{*/
+    return normalizeMemberPath(path) == PKG_META_NAME;
+}/*}}}*/
+
+/**
+ * Serializes the metadata of a package
+ * Every key is always written, in the same order, so building the same package twice gives the same member
+ *
+ * @param [in] const pkgMeta_s& meta
+ *
+ * @returns std::string buf
+ */
+std::string serializePkgMeta(const pkgMeta_s& meta) {/*{{{*/
+    std::string buf;
+    buf.append(PKG_META_KEY_NAME).push_back(DELIM_CHAR);
+    buf.append(meta.name).push_back('\n');
+    buf.append(PKG_META_KEY_VERSION).push_back(DELIM_CHAR);
+    buf.append(meta.version).push_back('\n');
+    buf.append(PKG_META_KEY_INSTALLED_SIZE).push_back(DELIM_CHAR);
+    buf.append(std::to_string(meta.installedSize)).push_back('\n');
+    buf.append(PKG_META_KEY_FILES).push_back(DELIM_CHAR);
+    buf.append(std::to_string(meta.files)).push_back('\n');
+
+    buf.append(PKG_META_KEY_DEPENDS).push_back(DELIM_CHAR);
+    for(size_t index = 0; index < meta.depends.size(); index++) {
+        if(index != 0) {
+            buf.push_back(' ');
+        }
+
+        buf.append(meta.depends[index]);
+    }
+    buf.push_back('\n');
+
+    buf.append(PKG_META_KEY_SCRIPTS).push_back(DELIM_CHAR);
+    bool first = true;
+    for(unsigned int index = 0; index < 4; index++) {
+        if((meta.scripts & (1u << index)) == 0) {
+            continue;
+        }
+
+        if(!first) {
+            buf.push_back(' ');
+        }
+
+        buf.append(scriptNames[index]);
+        first = false;
+    }
+    buf.push_back('\n');
+
+    return buf;
+}/*}}}*/
+
+/**
+ * @param [in] const std::string& value
+ * @param [out] uint64_t& num
+ *
+ * @returns bool wasTheValueANumber
+ */
+static bool parseMetaNumber(const std::string& value, uint64_t& num) {/*{{{*/
+    if(value.empty() || value.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+
+    errno = 0;
+    num = strtoull(value.c_str(), NULL, 10);
+    return errno == 0;
+}/*}}}*/
+
+/**
+ * Parses the metadata of a package
+ * Blank lines, comments and unknown keys are skipped. Any key left out keeps the value it had in meta
+ *
+ * @param [in] const std::string& buf
+ * @param [in/out] pkgMeta_s& meta
+ * @param [in] unsigned int verbosity
+ *
+ * @returns bool wasTheMetadataValid
+ */
+bool parsePkgMeta(const std::string& buf, pkgMeta_s& meta, unsigned int verbosity) {/*{{{*/
+    std::istringstream lines(buf);
+    std::string line;
+
+    while(std::getline(lines, line)) {
+        if(!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+
+        if(line.empty() || line[0] == COMMENT_CHAR) {
+            continue;
+        }
+
+        size_t delim = line.find(DELIM_CHAR);
+        if(delim == std::string::npos) {
+            if(verbosity >= 3) {
+                fprintf(stderr,"Error: The package metadata has a line without a key and value: %s\n",line.c_str());
+            }
+
+            return false;
+        }
+
+        std::string key = line.substr(0, delim);
+        std::string value = line.substr(delim + 1);
+
+        if(key == PKG_META_KEY_NAME) {
+            meta.name = value;
+        }
+
+        else if(key == PKG_META_KEY_VERSION) {
+            meta.version = value;
+        }
+
+        else if(key == PKG_META_KEY_INSTALLED_SIZE || key == PKG_META_KEY_FILES) {
+            if(!parseMetaNumber(value, (key == PKG_META_KEY_FILES) ? meta.files : meta.installedSize)) {
+                if(verbosity >= 3) {
+                    fprintf(stderr,"Error: The package metadata has %s for %s, which isn't a number\n",value.c_str(),key.c_str());
+                }
+
+                return false;
+            }
+        }
+
+        else if(key == PKG_META_KEY_DEPENDS || key == PKG_META_KEY_SCRIPTS) {
+            std::istringstream words(value);
+            std::string word;
+
+            if(key == PKG_META_KEY_DEPENDS) {
+                meta.depends.clear();
+            }
+
+            else {
+                meta.scripts = 0;
+            }
+
+            while(words >> word) {
+                if(key == PKG_META_KEY_DEPENDS) {
+                    meta.depends.push_back(word);
+                    continue;
+                }
+
+                for(unsigned int index = 0; index < 4; index++) {
+                    if(word == scriptNames[index]) {
+                        meta.scripts |= (1u << index);
+                    }
+                }
+            }
+        }
+    }
+
+    return true;
+}/*}}}*/
+
+/**
+ * Reads the metadata member from the start of an uncompressed package
+ * The header and the metadata are read in one go, unless the metadata is too large to fit in PKG_META_READ_SIZE
+ *
+ * @param [in] int fd
+ * @param [out] std::string& data
+ *
+ * @returns int 0 on success, or an error code
+ */
+static int readPlainPkgMeta(int fd, std::string& data) {/*{{{*/
+    std::string buf(PKG_META_READ_SIZE, '\0');
+    ssize_t got = pread(fd, &buf[0], buf.size(), 0);
+    if(got < 0) {
+        return PKG_META_IO_ERROR;
+    }
+
+    off_t offset = 0;
+    if(got >= TAR_BLOCKSIZE && isValidTarHeader(buf.data()) && buf[156] == TAR_TYPE_PAX_LOCAL) {
+        // Other tar writers put a pax header in front of every member. It can only hold attributes we don't need
+        offset = TAR_BLOCKSIZE + (parseTarNumber(buf.data() + 124, 12) + TAR_BLOCKSIZE - 1) / TAR_BLOCKSIZE * TAR_BLOCKSIZE;
+    }
+
+    char header[TAR_BLOCKSIZE];
+    if(offset + TAR_BLOCKSIZE <= got) {
+        memcpy(header, buf.data() + offset, TAR_BLOCKSIZE);
+    }
+
+    else if(offset + TAR_BLOCKSIZE > PKG_META_MAX_SIZE || pread(fd, header, TAR_BLOCKSIZE, offset) != TAR_BLOCKSIZE) {
+        return PKG_META_ABSENT;
+    }
+
+    std::string prefix = tarString(header + 345, 155);
+    std::string path = tarString(header, 100);
+    if(!prefix.empty()) {
+        path = prefix + "/" + path;
+    }
+
+    if(!isValidTarHeader(header) || !isRegularTarType(header[156]) || !isPkgMeta(path)) {
+        return PKG_META_ABSENT;
+    }
+
+    long long size = parseTarNumber(header + 124, 12);
+    if(size < 0 || size > PKG_META_MAX_SIZE) {
+        return PKG_META_CORRUPT;
+    }
+
+    offset += TAR_BLOCKSIZE;
+    if(offset + size <= got) {
+        data = buf.substr(offset, size);
+        return 0;
+    }
+
+    return readTarRange(fd, offset, size, data) ? 0 : PKG_META_IO_ERROR;
+}/*}}}*/
+
+/**
+ * Reads the metadata member from the start of a compressed package
+ * libarchive is given a small block at a time, so it decodes little more than the first member
+ *
+ * @param [in] const std::string& tarPath
+ * @param [out] std::string& data
+ *
+ * @returns int 0 on success, or an error code
+ */
+static int readArchivePkgMeta(const std::string& tarPath, std::string& data) {/*{{{*/
+    archive* a = archive_read_new();
+    archive_read_support_format_tar(a);
+    archive_read_support_filter_zstd(a);
+    archive_read_support_filter_xz(a);
+    archive_read_support_filter_gzip(a);
+
+    archive_entry* ae;
+    if(archive_read_open_filename(a, tarPath.c_str(), PKG_META_BLOCK_SIZE) != ARCHIVE_OK || archive_read_next_header(a, &ae) != ARCHIVE_OK) {
+        archive_read_free(a);
+        return PKG_META_IO_ERROR;
+    }
+
+    const char* path = archive_entry_pathname(ae);
+    if(path == NULL || !isPkgMeta(path) || archive_entry_filetype(ae) != AE_IFREG) {
+        archive_read_free(a);
+        return PKG_META_ABSENT;
+    }
+
+    if(archive_entry_size(ae) > PKG_META_MAX_SIZE) {
+        archive_read_free(a);
+        return PKG_META_CORRUPT;
+    }
+
+    char buf[4096];
+    la_ssize_t r;
+    while((r = archive_read_data(a, buf, sizeof(buf))) > 0) {
+        data.append(buf, r);
+    }
+
+    archive_read_free(a);
+    return (r == 0) ? 0 : PKG_META_IO_ERROR;
+}/*}}}*/
+
+/**
+ * Reads the metadata of a package, which is only looked for as its first member
+ *
+ * @param [in] std::string tarPath
+ * @param [out] pkgMeta_s& meta
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 on success, PKG_META_ABSENT if the package has no metadata, or an error code
+ */
+int readPkgMeta(std::string tarPath, pkgMeta_s& meta, unsigned int verbosity) {/*{{{*/
+    meta = pkgMeta_s();
+
+    int fd = open(tarPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not open the package %s. %s\n",tarPath.c_str(),strerror(errno));
+        }
+
+        return PKG_META_IO_ERROR;
+    }
+
+    std::string data;
+    int res = isPlainTar(fd) ? readPlainPkgMeta(fd, data) : readArchivePkgMeta(tarPath, data);
+    close(fd);
+
+    if(res == PKG_META_ABSENT) {
+        if(verbosity >= 4) {
+            printf("The package %s has no metadata\n",tarPath.c_str());
+        }
+
+        return res;
+    }
+
+    if(res == 0 && !parsePkgMeta(data, meta, verbosity)) {
+        meta = pkgMeta_s();
+        res = PKG_META_CORRUPT;
+    }
+
+    if(res != 0 && verbosity != 0) {
+        fprintf(stderr,"Error: Could not read the metadata of the package %s\n",tarPath.c_str());
+    }
+
+    return res;
+}/*}}}*/
@@ -0,0 +1,232 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Prefetch.cpp
+ * @error -2600
+ *
+ * Reads the tarballs of upcoming packages ahead of time, and drops the tarballs of finished ones from the page cache.
+ * On spinning disks and network mounts, a package which starts with a cold tarball otherwise waits on every read. Asking the kernel for the next tarballs with POSIX_FADV_WILLNEED while the current one installs overlaps those reads with the work already being done.
+ */
+
+#include "Prefetch.h"
+
+/**
+ * @param [in] const std::vector<std::string>& paths The tarball of each package, in the order they are installed
+ * @param [in] unsigned int depth How many packages after the current one are read ahead. 0 disables the prefetcher
+ * @param [in] unsigned long long maxBytes How many bytes of the upcoming tarballs may be read ahead at once
+ * @param [in] unsigned int verbosity
+ */
+Prefetcher::Prefetcher(const std::vector<std::string>& paths, unsigned int depth, unsigned long long maxBytes, unsigned int verbosity) {/*{{{*/
+    this->depth = depth;
+    this->maxBytes = maxBytes;
+    this->verbosity = verbosity;
+
+    // The scripts change our working directory while we read ahead, so nothing can be relative
+    for(const std::string& path : paths) {
+        std::error_code ec;
+        std::filesystem::path absolute = std::filesystem::absolute(path, ec);
+        this->paths.push_back(ec ? path : absolute.string());
+    }
+
+    held.assign(this->paths.size(), 0);
+    finished.assign(this->paths.size(), false);
+
+    if(depth > 0 && maxBytes > 0 && this->paths.size() > 1) {
+        thread = std::thread(&Prefetcher::work, this);
+    }
+}/*}}}*/
+
+Prefetcher::~Prefetcher() {/*{{{*/
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+
+    workReady.notify_all();
+
+    if(thread.joinable()) {
+        thread.join();
+    }
+}/*}}}*/
+
+/**
+ * Queues the packages within depth of current, in order, for as long as they fit in what's left of the budget
+ * A tarball larger than what's left only has its start read ahead. The caller holds the lock
+ *
+ * @param [in] size_t current The package most recently started
+ */
+void Prefetcher::fill(size_t current) {/*{{{*/
+    if(!thread.joinable()) {
+        return;
+    }
+
+    while(nextIndex < paths.size() && nextIndex <= current + depth && heldBytes < maxBytes) {
+        struct stat st;
+
+        if(finished[nextIndex] || stat(paths[nextIndex].c_str(), &st) != 0 || st.st_size == 0) {
+            nextIndex++;
+            continue;
+        }
+
+        unsigned long long bytes = ((unsigned long long)st.st_size < maxBytes - heldBytes) ? (unsigned long long)st.st_size : (maxBytes - heldBytes);
+        held[nextIndex] = bytes;
+        heldBytes += bytes;
+        queue.push_back(nextIndex);
+        nextIndex++;
+    }
+}/*}}}*/
+
+/**
+ * Called as a package starts installing. Anything before it which wasn't read ahead yet never will be
+ *
+ * @param [in] size_t index
+ */
+void Prefetcher::start(size_t index) {/*{{{*/
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        if(nextIndex <= index) {
+            nextIndex = index + 1;
+        }
+
+        lastStarted = index;
+        fill(index);
+    }
+
+    workReady.notify_one();
+}/*}}}*/
+
+/**
+ * Called once a package is done with its tarball, whether it was installed or not
+ * Drops the tarball from the page cache, unless a package which isn't finished yet uses the same one, and reads further ahead in its place
+ *
+ * @param [in] size_t index
+ */
+void Prefetcher::finish(size_t index) {/*{{{*/
+    if(index >= paths.size()) {
+        return;
+    }
+
+    bool shared = false;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        finished[index] = true;
+        heldBytes -= held[index];
+        held[index] = 0;
+
+        for(size_t other = 0; other < paths.size(); other++) {
+            if(!finished[other] && paths[other] == paths[index]) {
+                shared = true;
+                break;
+            }
+        }
+
+        fill(lastStarted);
+    }
+
+    workReady.notify_one();
+
+    if(shared) {
+        return;
+    }
+
+    int fd = open(paths[index].c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        return;
+    }
+
+    int err = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    if(err != 0 && verbosity >= 4) {
+        fprintf(stderr,"Warning: Could not drop %s from the page cache. %s\n",paths[index].c_str(),strerror(err));
+    }
+
+    close(fd);
+}/*}}}*/
+
+/**
+ * @returns unsigned long long How many bytes of the upcoming tarballs are read ahead, or queued to be, right now
+ */
+unsigned long long Prefetcher::getHeldBytes() {/*{{{*/
+    std::lock_guard<std::mutex> guard(lock);
+    return heldBytes;
+}/*}}}*/
+
+/**
+ * @param [in] size_t index
+ * @returns unsigned long long How many bytes of the tarball at index are read ahead, or queued to be. 0 once its package is finished
+ */
+unsigned long long Prefetcher::getHeldBytes(size_t index) {/*{{{*/
+    std::lock_guard<std::mutex> guard(lock);
+    return (index < held.size()) ? held[index] : 0;
+}/*}}}*/
+
+/**
+ * Reads ahead whatever was queued, one tarball at a time, until told to stop
+ */
+void Prefetcher::work() {/*{{{*/
+    while(true) {
+        size_t index;
+        unsigned long long bytes;
+
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            workReady.wait(guard, [&]{ return stopping || !queue.empty(); });
+
+            if(stopping) {
+                return;
+            }
+
+            index = queue.front();
+            queue.pop_front();
+            bytes = held[index];
+        }
+
+        readAhead(index, bytes);
+    }
+}/*}}}*/
+
+/**
+ * Asks the kernel to read the start of a tarball into the page cache, a chunk at a time
+ * Stops early if the package finishes first, since what's left would only be dropped again
+ *
+ * @param [in] size_t index
+ * @param [in] unsigned long long bytes
+ */
+void Prefetcher::readAhead(size_t index, unsigned long long bytes) {/*{{{*/
+    int fd = open(paths[index].c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        if(verbosity >= 4) {
+            fprintf(stderr,"Warning: Could not open %s to read it ahead. %s\n",paths[index].c_str(),strerror(errno));
+        }
+
+        return;
+    }
+
+    if(verbosity >= 4) {
+        printf("Reading ahead %llu bytes of %s\n",bytes,paths[index].c_str());
+    }
+
+    for(unsigned long long offset = 0; offset < bytes; offset += PREFETCH_CHUNK_SIZE) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if(stopping || finished[index]) {
+                break;
+            }
+        }
+
+        unsigned long long len = (bytes - offset < PREFETCH_CHUNK_SIZE) ? (bytes - offset) : PREFETCH_CHUNK_SIZE;
+        int err = posix_fadvise(fd, offset, len, POSIX_FADV_WILLNEED);
+        if(err != 0) {
+            if(verbosity >= 4) {
+                fprintf(stderr,"Warning: Could not read ahead %s. %s\n",paths[index].c_str(),strerror(err));
+            }
+
+            break;
+        }
+    }
+
+    close(fd);
+}/*}}}*/
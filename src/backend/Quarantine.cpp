@@ -0,0 +1,699 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Quarantine.cpp
+ * @error -2000
+ *
+ * Uninstalling a package by moving it out of place, and deleting it afterwards.
+ *
+ * Each uninstall gets its own directory in the trash, under the system root. Any directory of the package holding nothing but the package's own paths is renamed into it whole; Everything else of the package is renamed in one at a time. Nothing is unlinked while the package is being moved.
+ * Before the first rename, the paths about to be moved are written to a journal in that directory, the Nth path being moved to the name N. If a rename fails, or the run is interrupted, whatever made it into the trash can be put back from the journal.
+ * Once everything is moved, the directory is marked as committed, and from then on it's only ever deleted. That is left to a detached process by default, so the uninstall returns as soon as the package is out of place.
+ *
+ * The journal isn't synced to the disk. It guards against the process being interrupted or failing part-way, not against losing power.
+ */
+
+#include "Quarantine.h"
+
+// What a directory the package recorded turned out to be
+#define DIR_STATE_NOT_DIR 0     // Not a directory, such as a symbolic link to one
+#define DIR_STATE_MISSING 1
+#define DIR_STATE_OWNED 2       // Holds nothing but the package's own paths, so it can be moved whole
+#define DIR_STATE_SHARED 3      // Holds something else, or something excluded
+#define DIR_STATE_UNREADABLE 4
+
+/**
+ * Lists the uninstalls in the trash
+ *
+ * @param [in] int trashFd
+ * @param [out] std::vector<std::string>& committed Those which were fully moved in, and are only waiting to be deleted
+ * @param [out] std::vector<std::string>& uncommitted Those still being moved in, or interrupted while they were
+ */
+static void listTrash(int trashFd, std::vector<std::string>& committed, std::vector<std::string>& uncommitted) {/*{{{*/
+    int fd = openat(trashFd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(fd < 0) {
+        return;
+    }
+
+    DIR* d = fdopendir(fd);
+    if(d == NULL) {
+        close(fd);
+        return;
+    }
+
+    struct dirent* ent;
+    while((ent = readdir(d)) != NULL) {
+        if(strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) {
+            continue;
+        }
+
+        struct stat st;
+        std::string name = ent->d_name;
+        if(fstatat(trashFd, (name + "/" + TRASH_COMMITTED_NAME).c_str(), &st, AT_SYMLINK_NOFOLLOW) == 0) {
+            committed.push_back(name);
+        }
+
+        else {
+            uncommitted.push_back(name);
+        }
+    }
+
+    closedir(d);
+}/*}}}*/
+
+/**
+ * Deletes every uninstall in the trash which was fully moved in, and then the trash itself, unless another uninstall is still using it
+ *
+ * @param [in] int rootFd
+ */
+static void reclaimCommitted(int rootFd) {/*{{{*/
+    int trashFd = openat(rootFd, TRASH_DIR_NAME, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if(trashFd < 0) {
+        return;
+    }
+
+    std::vector<std::string> committed;
+    std::vector<std::string> uncommitted;
+    listTrash(trashFd, committed, uncommitted);
+
+    // The journal goes first, so a reclaimer stopped part-way, along with the mark, can't have a later run put back what's left
+    for(const std::string& name : committed) {
+        unlinkat(trashFd, (name + "/" + TRASH_JOURNAL_NAME).c_str(), 0);
+        removeTree(trashFd, name.c_str(), true);
+    }
+
+    close(trashFd);
+    unlinkat(rootFd, TRASH_DIR_NAME, AT_REMOVEDIR);
+}/*}}}*/
+
+/**
+ * Starts a detached process to empty the trash, and returns without waiting for it
+ * The process is orphaned right away, so it's never left as a zombie, and it holds none of our files open, so it can't keep the database locked
+ *
+ * @param [in] int rootFd
+ *
+ * @returns bool wasTheProcessStarted
+ */
+static bool spawnReclaimer(int rootFd) {/*{{{*/
+    pid_t pid = fork();
+    if(pid < 0) {
+        return false;
+    }
+
+    if(pid == 0) {
+        if(fork() != 0) {
+            _exit(0);
+        }
+
+        setsid();
+
+        int null = open("/dev/null", O_RDWR);
+        if(null >= 0) {
+            dup2(null, STDIN_FILENO);
+            dup2(null, STDOUT_FILENO);
+            dup2(null, STDERR_FILENO);
+        }
+
+        long maxFd = sysconf(_SC_OPEN_MAX);
+        if(maxFd < 0 || maxFd > 65536) {
+            maxFd = 65536;
+        }
+
+        for(int fd = STDERR_FILENO + 1; fd < maxFd; fd++) {
+            if(fd != rootFd) {
+                close(fd);
+            }
+        }
+
+        reclaimCommitted(rootFd);
+        _exit(0);
+    }
+
+    waitpid(pid, NULL, 0);
+    return true;
+}/*}}}*/
+
+/**
+ * Puts whatever is in an uninstall's trash directory back where its journal says it came from, the last path moved first
+ * A path with something else in its place by now is left in the trash, since whatever is there is newer
+ *
+ * @param [in] DirFdCache& dirs
+ * @param [in] int subFd The uninstall's directory in the trash
+ * @param [in] const std::string& root
+ * @param [in] unsigned int verbosity
+ * @param [out] unsigned long& failed The number of paths which could not be put back
+ *
+ * @returns unsigned long The number of paths put back
+ */
+static unsigned long restoreFromTrash(DirFdCache& dirs, int subFd, const std::string& root, unsigned int verbosity, unsigned long& failed) {/*{{{*/
+    failed = 0;
+
+    int fd = openat(subFd, TRASH_JOURNAL_NAME, O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        return 0;
+    }
+
+    std::string journal;
+    char buf[65536];
+    ssize_t r;
+    while((r = read(fd, buf, sizeof(buf))) > 0 || (r < 0 && errno == EINTR)) {
+        if(r > 0) {
+            journal.append(buf, r);
+        }
+    }
+
+    close(fd);
+
+    std::vector<std::string> rels;
+    size_t start = 0;
+    size_t end;
+    while((end = journal.find('\0', start)) != std::string::npos) {
+        rels.push_back(journal.substr(start, end - start));
+        start = end + 1;
+    }
+
+    unsigned long restored = 0;
+    for(size_t index = rels.size(); index-- > 0;) {
+        std::string name = std::to_string(index);
+
+        // Paths which were never moved, because they were missing or the run stopped before them
+        struct stat st;
+        if(fstatat(subFd, name.c_str(), &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            continue;
+        }
+
+        std::string leaf;
+        int parent = dirs.parentFd(rels[index], leaf, false);
+        if(parent >= 0 && fstatat(parent, leaf.c_str(), &st, AT_SYMLINK_NOFOLLOW) == 0) {
+            if(verbosity != 0) {
+                fprintf(stderr,"The path %s was not put back, since something else is there now. Continuing.\n",(root + "/" + rels[index]).c_str());
+            }
+
+            continue;
+        }
+
+        if(parent < 0 || renameat(subFd, name.c_str(), parent, leaf.c_str()) != 0) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: The path %s could not be put back. %s\n",(root + "/" + rels[index]).c_str(),strerror(errno));
+            }
+
+            failed++;
+            continue;
+        }
+
+        restored++;
+    }
+
+    return restored;
+}/*}}}*/
+
+/**
+ * Puts back the packages of any uninstall which was interrupted while moving them into the trash
+ * An uninstall is known to be interrupted when the process named in its directory is gone
+ *
+ * @param [in] DirFdCache& dirs
+ * @param [in] const std::string& root
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int The number of paths put back
+ */
+static int recoverInterrupted(DirFdCache& dirs, const std::string& root, unsigned int verbosity) {/*{{{*/
+    int trashFd = openat(dirs.getRootFd(), TRASH_DIR_NAME, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if(trashFd < 0) {
+        return 0;
+    }
+
+    std::vector<std::string> committed;
+    std::vector<std::string> uncommitted;
+    listTrash(trashFd, committed, uncommitted);
+
+    unsigned long restored = 0;
+    for(const std::string& name : uncommitted) {
+        char* end = NULL;
+        long pid = strtol(name.c_str(), &end, 10);
+        if(end == name.c_str() || *end != '.' || pid <= 0 || pid == getpid()) {
+            continue;
+        }
+
+        // Still moving its package in
+        if(kill((pid_t)pid, 0) == 0 || errno == EPERM) {
+            continue;
+        }
+
+        int subFd = openat(trashFd, name.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if(subFd < 0) {
+            continue;
+        }
+
+        unsigned long failed = 0;
+        unsigned long put = restoreFromTrash(dirs, subFd, root, verbosity, failed);
+        close(subFd);
+
+        if(verbosity >= 2 && put != 0) {
+            printf("Put back %lu paths from an interrupted uninstall\n",put);
+        }
+
+        // Whatever couldn't be put back is tried again next time
+        if(failed == 0) {
+            removeTree(trashFd, name.c_str(), true);
+        }
+
+        restored += put;
+    }
+
+    close(trashFd);
+    unlinkat(dirs.getRootFd(), TRASH_DIR_NAME, AT_REMOVEDIR);
+    return (int)restored;
+}/*}}}*/
+
+/**
+ * Puts back the packages of any uninstall which was interrupted while moving them into the trash
+ *
+ * @param [in] std::string root
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int The number of paths put back, or QUARANTINE_ROOT_ERROR if the system root could not be opened
+ */
+int recoverTrash(std::string root, unsigned int verbosity) {/*{{{*/
+    DirFdCache dirs(root, verbosity);
+    if(!dirs.isOpen()) {
+        return QUARANTINE_ROOT_ERROR;
+    }
+
+    return recoverInterrupted(dirs, root, verbosity);
+}/*}}}*/
+
+/**
+ * Works out whether a directory of the package holds anything besides the package's own paths
+ *
+ * @param [in] DirFdCache& dirs
+ * @param [in] const std::string& rel
+ * @param [in] const std::unordered_set<std::string>* ours The names the package has in the directory, if any
+ * @param [in] const std::unordered_map<std::string, int>& dirState What the directories below it turned out to be
+ * @param [out] int& err The error, for a DIR_STATE_UNREADABLE directory
+ *
+ * @returns int One of the DIR_STATE_* values
+ */
+static int examineDir(DirFdCache& dirs, const std::string& rel, const std::unordered_set<std::string>* ours, const std::unordered_map<std::string, int>& dirState, int& err) {/*{{{*/
+    std::string leaf;
+    int parent = dirs.parentFd(rel, leaf, false);
+    int fd = (parent < 0) ? -1 : openat(parent, leaf.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+    if(fd < 0) {
+        err = errno;
+        if(err == ENOENT || (parent < 0 && err == ENOTDIR)) {
+            return DIR_STATE_MISSING;
+        }
+
+        if(err == ENOTDIR || err == ELOOP) {
+            return DIR_STATE_NOT_DIR;
+        }
+
+        return DIR_STATE_UNREADABLE;
+    }
+
+    DIR* d = fdopendir(fd);
+    if(d == NULL) {
+        err = errno;
+        close(fd);
+        return DIR_STATE_UNREADABLE;
+    }
+
+    int state = DIR_STATE_OWNED;
+    struct dirent* ent;
+    while((ent = readdir(d)) != NULL) {
+        if(strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) {
+            continue;
+        }
+
+        if(ours == NULL || ours->count(ent->d_name) == 0) {
+            state = DIR_STATE_SHARED;
+            break;
+        }
+
+        bool isDir = (ent->d_type == DT_DIR);
+        if(ent->d_type == DT_UNKNOWN) {
+            struct stat st;
+            isDir = fstatat(dirfd(d), ent->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode);
+        }
+
+        // The directories below were looked at first, so this only has to ask whether they were whole
+        if(isDir) {
+            auto found = dirState.find(rel + "/" + ent->d_name);
+            if(found == dirState.end() || found->second != DIR_STATE_OWNED) {
+                state = DIR_STATE_SHARED;
+                break;
+            }
+        }
+    }
+
+    closedir(d);
+    return state;
+}/*}}}*/
+
+/**
+ * Makes this uninstall's directory in the trash, making the trash first if need be
+ *
+ * @param [in] int rootFd
+ * @param [in] const std::string& pkgName
+ * @param [out] int& trashFd
+ * @param [out] std::string& subName
+ *
+ * @returns int The new directory's fd, or -1 with errno set
+ */
+static int makeTrashDir(int rootFd, const std::string& pkgName, int& trashFd, std::string& subName) {/*{{{*/
+    // Parallel uninstalls from one process share this counter
+    static std::atomic<unsigned int> sequence(0);
+
+    // A reclaimer may remove the trash between us making and using it, while it's empty
+    for(int attempt = 0; attempt < 3; attempt++) {
+        if(mkdirat(rootFd, TRASH_DIR_NAME, S_IRWXU) != 0 && errno != EEXIST) {
+            return -1;
+        }
+
+        trashFd = openat(rootFd, TRASH_DIR_NAME, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if(trashFd < 0) {
+            if(errno == ENOENT) {
+                continue;
+            }
+
+            return -1;
+        }
+
+        // Named after our pid first, so an interrupted uninstall can be told apart from one still running
+        int made;
+        do {
+            subName = std::to_string(getpid()) + "." + std::to_string(sequence++) + "." + pkgName;
+        } while((made = mkdirat(trashFd, subName.c_str(), S_IRWXU)) != 0 && errno == EEXIST);
+
+        if(made == 0) {
+            int subFd = openat(trashFd, subName.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if(subFd >= 0) {
+                return subFd;
+            }
+        }
+
+        int err = errno;
+        close(trashFd);
+        trashFd = -1;
+
+        if(err != ENOENT) {
+            errno = err;
+            return -1;
+        }
+    }
+
+    errno = ENOENT;
+    return -1;
+}/*}}}*/
+
+/**
+ * Writes out the journal of the paths about to be moved into the trash, each followed by a NUL
+ *
+ * @param [in] int subFd
+ * @param [in] const std::vector<const std::string*>& moves
+ *
+ * @returns bool wasTheJournalWritten
+ */
+static bool writeJournal(int subFd, const std::vector<const std::string*>& moves) {/*{{{*/
+    std::string journal;
+    for(const std::string* rel : moves) {
+        journal.append(*rel);
+        journal.push_back('\0');
+    }
+
+    int fd = openat(subFd, TRASH_JOURNAL_NAME, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if(fd < 0) {
+        return false;
+    }
+
+    size_t done = 0;
+    while(done < journal.size()) {
+        ssize_t w = write(fd, journal.data() + done, journal.size() - done);
+        if(w < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+
+            close(fd);
+            return false;
+        }
+
+        done += w;
+    }
+
+    return close(fd) == 0;
+}/*}}}*/
+
+/**
+ * Uninstalls a package by moving its paths into the trash under the system root, and leaves deleting them for later
+ *
+ * Paths matching the exclusions are left alone, as are directories which still hold anything besides the package.
+ * If a path can't be moved, everything already moved is put back, and nothing is deleted. A path on another filesystem than the root, which can't be renamed into the trash, is deleted where it is instead.
+ *
+ * @param [in] const std::set<std::string>& pkgContents The paths of the package, as recorded in its manifest or tarball
+ * @param [in] std::string root
+ * @param [in] std::string pkgName
+ * @param [in] const ExclusionMatcher& exclusions
+ * @param [in] unsigned int verbosity
+ * @param [in] bool background Whether to empty the trash from a detached process, instead of before returning
+ *
+ * @returns int The number of paths removed, or a negative error code
+ */
+int quarantinePkgPaths(const std::set<std::string>& pkgContents, std::string root, std::string pkgName, const ExclusionMatcher& exclusions, unsigned int verbosity, bool background) {/*{{{*/
+    // The package's canonical paths, with whether any of them was recorded as a directory, and the first as it was recorded
+    std::map<std::string, std::pair<bool, const std::string*>> paths;
+    std::unordered_map<std::string, std::unordered_set<std::string>> children;
+    const std::string trashPrefix = std::string(TRASH_DIR_NAME) + "/";
+
+    for(const std::string& path : pkgContents) {
+        if(exclusions.matches(path)) {
+            continue;
+        }
+
+        std::string rel = canonicalMemberPath(path);
+        if(rel.empty() || rel == TRASH_DIR_NAME || rel.compare(0, trashPrefix.size(), trashPrefix) == 0) {
+            continue;
+        }
+
+        auto& entry = paths[rel];
+        entry.first = entry.first || path.back() == '/';
+        if(entry.second == NULL) {
+            entry.second = &path;
+        }
+
+        size_t slash = rel.rfind('/');
+        children[(slash == std::string::npos) ? std::string() : rel.substr(0, slash)].insert(rel.substr(slash + 1));
+    }
+
+    // Deepest first, so a directory's contents are always dealt with before it
+    std::vector<std::pair<size_t, const std::string*>> order;
+    order.reserve(paths.size());
+    for(const auto& entry : paths) {
+        order.push_back(std::make_pair(std::count(entry.first.begin(), entry.first.end(), '/'), &entry.first));
+    }
+
+    std::stable_sort(order.begin(), order.end(), [](const std::pair<size_t, const std::string*>& a, const std::pair<size_t, const std::string*>& b) {
+        return a.first > b.first;
+    });
+
+    DirFdCache dirs(root, verbosity);
+    if(!dirs.isOpen()) {
+        return QUARANTINE_ROOT_ERROR;
+    }
+
+    recoverInterrupted(dirs, root, verbosity);
+
+    // Find the directories which hold nothing but the package
+    std::unordered_map<std::string, int> dirState;
+    std::unordered_map<std::string, int> dirErrors;
+    for(const auto& item : order) {
+        const std::string& rel = *item.second;
+        auto ours = children.find(rel);
+        if(!paths[rel].first && ours == children.end()) {
+            continue;
+        }
+
+        int err = 0;
+        int state = examineDir(dirs, rel, (ours == children.end()) ? NULL : &ours->second, dirState, err);
+        dirState[rel] = state;
+        if(state == DIR_STATE_UNREADABLE) {
+            dirErrors[rel] = err;
+        }
+    }
+
+    // Only the outermost of those is moved, taking everything below it along
+    auto isCovered = [&](const std::string& rel) {
+        for(size_t slash = rel.find('/'); slash != std::string::npos; slash = rel.find('/', slash + 1)) {
+            auto found = dirState.find(rel.substr(0, slash));
+            if(found != dirState.end() && found->second == DIR_STATE_OWNED) {
+                return true;
+            }
+        }
+
+        return false;
+    };
+
+    std::vector<const std::string*> moves;
+    for(const auto& item : order) {
+        const std::string& rel = *item.second;
+        if(isCovered(rel)) {
+            continue;
+        }
+
+        auto found = dirState.find(rel);
+        int state = (found == dirState.end()) ? DIR_STATE_NOT_DIR : found->second;
+        if(state == DIR_STATE_NOT_DIR || state == DIR_STATE_OWNED) {
+            moves.push_back(&rel);
+            continue;
+        }
+
+        if(verbosity == 0) {
+            continue;
+        }
+
+        std::string displayPath = root + "/" + *paths[rel].second;
+        if(state == DIR_STATE_MISSING) {
+            fprintf(stderr,"The path %s did not exist in the filesystem. Continuing.\n",displayPath.c_str());
+        }
+
+        else if(state == DIR_STATE_SHARED) {
+            fprintf(stderr,"The path %s is a non-empty directory, and so cannot be removed. Continuing.\n",displayPath.c_str());
+        }
+
+        else {
+            fprintf(stderr,"The path %s existed, but could not be removed. %s\n",displayPath.c_str(),strerror(dirErrors[rel]));
+        }
+    }
+
+    int trashFd = -1;
+    std::string subName;
+    int subFd = makeTrashDir(dirs.getRootFd(), pkgName, trashFd, subName);
+    if(subFd < 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not make the trash directory %s/%s. %s\n",root.c_str(),TRASH_DIR_NAME,strerror(errno));
+        }
+
+        return QUARANTINE_TRASH_ERROR;
+    }
+
+    if(!writeJournal(subFd, moves)) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not write the journal of the uninstall to %s/%s/%s. %s\n",root.c_str(),TRASH_DIR_NAME,subName.c_str(),strerror(errno));
+        }
+
+        close(subFd);
+        removeTree(trashFd, subName.c_str(), true);
+        close(trashFd);
+        return QUARANTINE_TRASH_ERROR;
+    }
+
+    // Paths which have to be deleted where they are, as recorded
+    std::set<std::string> inPlace;
+    unsigned long removed = 0;
+    unsigned long renames = 0;
+
+    for(size_t index = 0; index < moves.size(); index++) {
+        const std::string& rel = *moves[index];
+        bool wholeDir = (dirState.count(rel) != 0);
+
+        std::string leaf;
+        int parent = dirs.parentFd(rel, leaf, false);
+        if(parent >= 0 && renameat(parent, leaf.c_str(), subFd, std::to_string(index).c_str()) == 0) {
+            renames++;
+            removed++;
+
+            if(wholeDir && dirState[rel] == DIR_STATE_OWNED) {
+                const std::string below = rel + "/";
+                for(auto it = paths.lower_bound(below); it != paths.end() && it->first.compare(0, below.size(), below) == 0; it++) {
+                    removed++;
+                }
+            }
+
+            continue;
+        }
+
+        int err = errno;
+        if(err == ENOENT || (parent < 0 && err == ENOTDIR)) {
+            if(verbosity != 0) {
+                fprintf(stderr,"The path %s did not exist in the filesystem. Continuing.\n",(root + "/" + *paths[rel].second).c_str());
+            }
+
+            continue;
+        }
+
+        // A mount point, or something else on another filesystem
+        if(err == EXDEV || err == EBUSY) {
+            inPlace.insert(*paths[rel].second);
+
+            const std::string below = rel + "/";
+            for(auto it = paths.lower_bound(below); it != paths.end() && it->first.compare(0, below.size(), below) == 0; it++) {
+                inPlace.insert(*it->second.second);
+            }
+
+            continue;
+        }
+
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: The path %s could not be moved into the trash. %s. Putting back what was already moved.\n",(root + "/" + *paths[rel].second).c_str(),strerror(err));
+        }
+
+        unsigned long failed = 0;
+        unsigned long restored = restoreFromTrash(dirs, subFd, root, verbosity, failed);
+        close(subFd);
+
+        if(failed == 0) {
+            removeTree(trashFd, subName.c_str(), true);
+        }
+
+        else if(verbosity != 0) {
+            fprintf(stderr,"Error: %lu paths could not be put back. They are kept in %s/%s/%s, and will be tried again the next time a package is uninstalled.\n",failed,root.c_str(),TRASH_DIR_NAME,subName.c_str());
+        }
+
+        if(verbosity >= 2) {
+            printf("Put back %lu paths\n",restored);
+        }
+
+        close(trashFd);
+        unlinkat(dirs.getRootFd(), TRASH_DIR_NAME, AT_REMOVEDIR);
+        return QUARANTINE_MOVE_ERROR;
+    }
+
+    // From here on, the package is only ever deleted
+    // Without the mark, a later run would think this uninstall was interrupted, and put the package back. So it's deleted now instead
+    int marker = openat(subFd, TRASH_COMMITTED_NAME, O_WRONLY | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if(marker >= 0) {
+        close(marker);
+    }
+
+    else {
+        background = false;
+        unlinkat(subFd, TRASH_JOURNAL_NAME, 0);
+        removeTree(trashFd, subName.c_str(), true);
+    }
+
+    close(subFd);
+    close(trashFd);
+
+    if(verbosity >= 3) {
+        printf("Moved %lu of %lu paths into the trash with %lu renames\n",removed,(unsigned long)pkgContents.size(),renames);
+    }
+
+    if(!inPlace.empty()) {
+        int res = removePkgPaths(inPlace, root, ExclusionMatcher(), verbosity);
+        if(res > 0) {
+            removed += res;
+        }
+    }
+
+    if(!background || !spawnReclaimer(dirs.getRootFd())) {
+        reclaimCommitted(dirs.getRootFd());
+    }
+
+    else if(verbosity >= 4) {
+        printf("Emptying %s/%s in the background\n",root.c_str(),TRASH_DIR_NAME);
+    }
+
+    return (int)removed;
+}/*}}}*/
@@ -0,0 +1,303 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Remove.cpp
+ * @error -1900
+ *
+ * Removing the paths of a package from the system root, a directory at a time.
+ *
+ * The paths are grouped by the directory they are in, and each directory is opened once. Its entries are then removed with unlinkat relative to it, so the kernel only ever looks up their last component.
+ * A directory which still holds anything fails to be removed with ENOTEMPTY, which is the only emptiness check made.
+ * Every directory's own entries are removed before the directory itself, by going from the deepest directories up, and each level is spread over several threads.
+ *
+ * The paths are grouped as the package recorded them, and symbolic links aren't resolved, just as installs follow them. A path recorded through a link to a directory puts that directory in two groups, possibly at different depths.
+ * Its entries are still only ever removed by the names the package recorded, so nothing else is touched. But the directory itself may be tried before the entries reached through the link are gone, in which case it's left in place, like any directory which isn't empty.
+ */
+
+#include "Remove.h"
+
+// The paths of a package within one directory, in the order they're removed
+struct removeGroup_s {
+    std::string dir;
+    size_t depth = 0;
+
+    // The name within dir, whether the package recorded it as a directory, and the path as recorded, for messages
+    std::vector<std::pair<std::string, const std::string*>> leaves;
+    std::vector<bool> isDir;
+};
+
+/**
+ * @returns unsigned int The number of threads to remove a package with
+ */
+unsigned int uninstallThreads() {/*{{{*/
+    long n = UNINSTALL_THREADS;
+    if(n <= 0) {
+        n = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+
+    if(n < 1) {
+        n = 1;
+    }
+
+    if(n > UNINSTALL_MAX_THREADS) {
+        n = UNINSTALL_MAX_THREADS;
+    }
+
+    return (unsigned int)n;
+}/*}}}*/
+
+/**
+ * Removes a single entry of a directory
+ * The entry is unlinked, or removed as a directory if the package recorded it as one. The other is only tried if the first call says it was wrong
+ *
+ * @param [in] int dirFd
+ * @param [in] const std::string& leaf
+ * @param [in] bool isDir
+ * @param [in] const std::string& displayPath
+ * @param [in] unsigned int verbosity
+ *
+ * @returns bool wasTheEntryRemoved
+ */
+static bool removeEntry(int dirFd, const std::string& leaf, bool isDir, const std::string& displayPath, unsigned int verbosity) {/*{{{*/
+    int flags = isDir ? AT_REMOVEDIR : 0;
+    if(unlinkat(dirFd, leaf.c_str(), flags) == 0) {
+        return true;
+    }
+
+    // Linux says EISDIR when unlinking a directory, and POSIX allows EPERM. A trailing / aside, the package doesn't say which a path is
+    int err = errno;
+    if((flags == 0 && (err == EISDIR || err == EPERM)) || (flags == AT_REMOVEDIR && err == ENOTDIR)) {
+        if(unlinkat(dirFd, leaf.c_str(), flags ^ AT_REMOVEDIR) == 0) {
+            return true;
+        }
+
+        if(errno != ENOTDIR) {
+            err = errno;
+        }
+    }
+
+    if(verbosity == 0) {
+        return false;
+    }
+
+    if(err == ENOENT) {
+        fprintf(stderr,"The path %s did not exist in the filesystem. Continuing.\n",displayPath.c_str());
+    }
+
+    else if(err == ENOTEMPTY || err == EEXIST) {
+        fprintf(stderr,"The path %s is a non-empty directory, and so cannot be removed. Continuing.\n",displayPath.c_str());
+    }
+
+    else {
+        fprintf(stderr,"The path %s existed, but could not be removed. %s\n",displayPath.c_str(),strerror(err));
+    }
+
+    return false;
+}/*}}}*/
+
+/**
+ * Removes the entries of a single directory
+ *
+ * @param [in] DirFdCache& dirs
+ * @param [in] const removeGroup_s& group
+ * @param [in] const std::string& root
+ * @param [in] unsigned int verbosity
+ *
+ * @returns unsigned long The number of entries removed
+ */
+static unsigned long removeGroup(DirFdCache& dirs, const removeGroup_s& group, const std::string& root, unsigned int verbosity) {/*{{{*/
+    unsigned long removed = 0;
+
+    int dirFd = dirs.dirFd(group.dir, false);
+    if(dirFd < 0) {
+        int err = errno;
+        if(verbosity != 0) {
+            for(const auto& leaf : group.leaves) {
+                if(err == ENOENT) {
+                    fprintf(stderr,"The path %s did not exist in the filesystem. Continuing.\n",(root + "/" + *leaf.second).c_str());
+                }
+
+                else {
+                    fprintf(stderr,"The path %s existed, but could not be removed. %s\n",(root + "/" + *leaf.second).c_str(),strerror(err));
+                }
+            }
+        }
+
+        return 0;
+    }
+
+    for(size_t index = 0; index < group.leaves.size(); index++) {
+        if(removeEntry(dirFd, group.leaves[index].first, group.isDir[index], root + "/" + *group.leaves[index].second, verbosity)) {
+            removed++;
+        }
+    }
+
+    return removed;
+}/*}}}*/
+
+/**
+ * Removes the paths of a package from the system root
+ *
+ * Paths matching the exclusions are left alone, as are directories which still hold anything once the package's own entries are gone.
+ *
+ * @param [in] const std::set<std::string>& pkgContents The paths of the package, as recorded in its manifest or tarball
+ * @param [in] std::string root
+ * @param [in] const ExclusionMatcher& exclusions
+ * @param [in] unsigned int verbosity
+ * @param [in] unsigned int threads
+ *
+ * @returns int The number of paths removed, or REMOVE_ROOT_ERROR if the system root could not be opened
+ */
+int removePkgPaths(const std::set<std::string>& pkgContents, std::string root, const ExclusionMatcher& exclusions, unsigned int verbosity, unsigned int threads) {/*{{{*/
+    std::vector<removeGroup_s> groups;
+    std::unordered_map<std::string, size_t> groupIndex;
+    size_t maxDepth = 0;
+
+    // Going backwards through the sorted paths puts every directory's contents ahead of it
+    for(auto it = pkgContents.rbegin(); it != pkgContents.rend(); it++) {
+        if(exclusions.matches(*it)) {
+            continue;
+        }
+
+        // The root itself is never removed
+        std::string rel = canonicalMemberPath(*it);
+        if(rel.empty()) {
+            continue;
+        }
+
+        size_t slash = rel.rfind('/');
+        std::string dir = (slash == std::string::npos) ? std::string() : rel.substr(0, slash);
+
+        auto found = groupIndex.find(dir);
+        if(found == groupIndex.end()) {
+            removeGroup_s group;
+            group.dir = dir;
+            group.depth = dir.empty() ? 0 : 1 + std::count(dir.begin(), dir.end(), '/');
+
+            if(group.depth > maxDepth) {
+                maxDepth = group.depth;
+            }
+
+            found = groupIndex.insert(std::make_pair(dir, groups.size())).first;
+            groups.push_back(group);
+        }
+
+        removeGroup_s& group = groups[found->second];
+        group.leaves.push_back(std::make_pair(rel.substr(slash + 1), &*it));
+        group.isDir.push_back(it->back() == '/');
+    }
+
+    std::vector<std::vector<size_t>> levels(maxDepth + 1);
+    for(size_t index = 0; index < groups.size(); index++) {
+        levels[groups[index].depth].push_back(index);
+    }
+
+    if(pkgContents.size() < UNINSTALL_PARALLEL_MIN) {
+        threads = 1;
+    }
+
+    DirFdCache dirs(root, verbosity);
+    if(!dirs.isOpen()) {
+        return REMOVE_ROOT_ERROR;
+    }
+
+    unsigned long removed = 0;
+
+    for(size_t depth = maxDepth + 1; depth-- > 0;) {
+        const std::vector<size_t>& level = levels[depth];
+        unsigned int workers = (threads < level.size()) ? threads : level.size();
+
+        if(workers <= 1) {
+            for(size_t index : level) {
+                removed += removeGroup(dirs, groups[index], root, verbosity);
+            }
+
+            continue;
+        }
+
+        // Each thread claims the next directory of this level until there are none left
+        std::atomic<size_t> next(0);
+        std::atomic<unsigned long> levelRemoved(0);
+        std::vector<std::thread> pool;
+
+        for(unsigned int t = 0; t < workers; t++) {
+            pool.emplace_back([&]() {
+                DirFdCache threadDirs(root, verbosity);
+                if(!threadDirs.isOpen()) {
+                    return;
+                }
+
+                unsigned long mine = 0;
+                size_t claimed;
+                while((claimed = next++) < level.size()) {
+                    mine += removeGroup(threadDirs, groups[level[claimed]], root, verbosity);
+                }
+
+                levelRemoved += mine;
+            });
+        }
+
+        for(std::thread& t : pool) {
+            t.join();
+        }
+
+        // A thread which couldn't open the root left its share for us
+        size_t claimed;
+        while((claimed = next++) < level.size()) {
+            removed += removeGroup(dirs, groups[level[claimed]], root, verbosity);
+        }
+
+        removed += levelRemoved;
+    }
+
+    if(verbosity >= 3) {
+        printf("Removed %lu of %lu paths from %lu directories\n",removed,(unsigned long)pkgContents.size(),(unsigned long)groups.size());
+    }
+
+    return (int)removed;
+}/*}}}*/
+
+/**
+ * Removes a path, and everything below it if it's a directory
+ * Failures are ignored, since this is only used on our own trash and staging directories, which are tried again later
+ *
+ * @param [in] int dirFd
+ * @param [in] const char* name
+ * @param [in] bool isDir Whether name is thought to be a directory, which is tried first
+ */
+void removeTree(int dirFd, const char* name, bool isDir) {/*{{{*/
+    if(!isDir && (unlinkat(dirFd, name, 0) == 0 || (errno != EISDIR && errno != EPERM))) {
+        return;
+    }
+
+    int fd = openat(dirFd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if(fd < 0) {
+        if(errno == ENOTDIR || errno == ELOOP) {
+            unlinkat(dirFd, name, 0);
+        }
+
+        return;
+    }
+
+    // A read-only directory from the package would otherwise keep its entries
+    fchmod(fd, S_IRWXU);
+
+    DIR* d = fdopendir(fd);
+    if(d == NULL) {
+        close(fd);
+        return;
+    }
+
+    struct dirent* ent;
+    while((ent = readdir(d)) != NULL) {
+        if(strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) {
+            continue;
+        }
+
+        removeTree(dirfd(d), ent->d_name, ent->d_type == DT_DIR);
+    }
+
+    closedir(d);
+    unlinkat(dirFd, name, AT_REMOVEDIR);
+}/*}}}*/
@@ -0,0 +1,158 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Script.cpp
+ * @error -1300
+ *
+ * Runs the pre- and post- install/uninstall scripts of a package.
+ * Scripts never touch the disk: Their bodies are copied into an anonymous memory file, which is executed directly, without a shell in between. Scripts are run from the current working directory, with our environment.
+ */
+
+#include "Script.h"
+
+extern char** environ;
+
+/**
+ * Spawns path with argv, handing it the memory file at fd
+ * Duplicating the fd onto itself clears close-on-exec in the child alone
+ *
+ * @param [out] pid_t& pid
+ * @param [in] const char* path
+ * @param [in] char* const argv[]
+ * @param [in] int fd
+ *
+ * @returns int 0 on success, or the error posix_spawn ran into
+ */
+static int spawnWithFd(pid_t& pid, const char* path, char* const argv[], int fd) {/*{{{*/
+    posix_spawn_file_actions_t actions;
+    int err = posix_spawn_file_actions_init(&actions);
+    if(err != 0) {
+        return err;
+    }
+
+    err = posix_spawn_file_actions_adddup2(&actions, fd, fd);
+    if(err == 0) {
+        err = posix_spawn(&pid, path, &actions, NULL, argv, environ);
+    }
+
+    posix_spawn_file_actions_destroy(&actions);
+    return err;
+}/*}}}*/
+
+/**
+ * Runs a script held in memory, and waits for it to finish
+ *
+ * The script is executed through /proc/self/fd, so its #! line picks the interpreter, just as if it had been run from a file. A script without a #! line is run by /bin/sh, as system() used to. The memory file is close-on-exec, so scripts spawned by other jobs at the same time don't inherit it; only this script gets it, so that its interpreter can open it. It's sealed so nothing can change it once it's been written.
+ *
+ * @param [in] std::string scriptName
+ * @param [in] const pkgScript_s& script
+ * @param [in] std::string pkgName
+ * @param [in] unsigned int verbosity
+ * @param [out] double* seconds If not NULL, how long the script ran for
+ *
+ * @returns int The exit status of the script, 128 plus the signal number if it was killed, or a negative error code if it could not be run
+ */
+int runScript(std::string scriptName, const pkgScript_s& script, std::string pkgName, unsigned int verbosity, double* seconds) {/*{{{*/
+    int fd = memfd_create(scriptName.c_str(), MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if(fd < 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not create a memory file for the script %s of %s. %s\n",scriptName.c_str(),pkgName.c_str(),strerror(errno));
+        }
+
+        return SCRIPT_MEMFD_ERROR;
+    }
+
+    size_t done = 0;
+    while(done < script.body.size()) {
+        ssize_t w = write(fd, script.body.data() + done, script.body.size() - done);
+        if(w < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if(w < 0) {
+            break;
+        }
+
+        done += w;
+    }
+
+    // Keep the permissions from the tarball, so a script which isn't executable still fails to run like it used to
+    if(done != script.body.size() || fchmod(fd, script.mode & 0777) != 0 || fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) != 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not load the script %s of %s into memory. %s\n",scriptName.c_str(),pkgName.c_str(),strerror(errno));
+        }
+
+        close(fd);
+        return SCRIPT_MEMFD_ERROR;
+    }
+
+    std::string execPath = "/proc/self/fd/" + std::to_string(fd);
+    char* argv[] = { (char*)scriptName.c_str(), NULL };
+
+    // Anything we've printed so far should come before whatever the script prints
+    fflush(stdout);
+    fflush(stderr);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    pid_t pid;
+    int err = spawnWithFd(pid, execPath.c_str(), argv, fd);
+
+    // The kernel can't execute a script without a #! line. The shell system() went through ran those as shell scripts, so hand them to it
+    if(err == ENOEXEC) {
+        char* shArgv[] = { (char*)SCRIPT_SHELL, (char*)execPath.c_str(), NULL };
+        err = spawnWithFd(pid, SCRIPT_SHELL, shArgv, fd);
+    }
+
+    close(fd);
+
+    if(err != 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not run the script %s of %s. %s\n",scriptName.c_str(),pkgName.c_str(),strerror(err));
+        }
+
+        return SCRIPT_SPAWN_ERROR;
+    }
+
+    int status;
+    pid_t res;
+    while((res = waitpid(pid, &status, 0)) < 0 && errno == EINTR);
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    if(seconds != NULL) {
+        *seconds = elapsed;
+    }
+
+    if(res < 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Lost track of the script %s of %s. %s\n",scriptName.c_str(),pkgName.c_str(),strerror(errno));
+        }
+
+        return SCRIPT_WAIT_ERROR;
+    }
+
+    if(WIFSIGNALED(status)) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: The script %s of %s was killed by signal %d after %.3f seconds\n",scriptName.c_str(),pkgName.c_str(),WTERMSIG(status),elapsed);
+        }
+
+        return 128 + WTERMSIG(status);
+    }
+
+    int exitStatus = WEXITSTATUS(status);
+
+    if(verbosity >= 3) {
+        printf("The script %s of %s exited with status %d after %.3f seconds\n",scriptName.c_str(),pkgName.c_str(),exitStatus,elapsed);
+    }
+
+    else if(exitStatus != 0 && verbosity >= 2) {
+        printf("The script %s of %s exited with status %d\n",scriptName.c_str(),pkgName.c_str(),exitStatus);
+    }
+
+    return exitStatus;
+}/*}}}*/
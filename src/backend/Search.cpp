@@ -0,0 +1,745 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Search.cpp
+ * @error -1200
+ *
+ * The search index over the tarball library. See Search.h for the layout.
+ * The library is only ever walked and stat'ed when refreshing the index. Tarballs are opened only when they are new or have changed since the last refresh.
+ */
+
+#include "Search.h"
+
+/**
+ * Lowercases the ASCII letters in text
+ *
+ * @param [in] std::string text
+ *
+ * @returns std::string lowered
+ */
+static std::string lowercase(std::string text) {/*{{{*/
+    for(char& c : text) {
+        if(c >= 'A' && c <= 'Z') {
+            c = c - 'A' + 'a';
+        }
+    }
+
+    return text;
+}/*}}}*/
+
+/**
+ * Appends every trigram of text to trigrams, packed into the low 24 bits of an integer
+ *
+ * @param [in] const std::string& text Already lowercased
+ * @param [in/out] std::vector<uint32_t>& trigrams
+ */
+static void addTrigrams(const std::string& text, std::vector<uint32_t>& trigrams) {/*{{{*/
+    for(size_t index = 0; index + 3 <= text.size(); index++) {
+        trigrams.push_back(((uint32_t)(unsigned char)text[index] << 16) | ((uint32_t)(unsigned char)text[index + 1] << 8) | (uint32_t)(unsigned char)text[index + 2]);
+    }
+}/*}}}*/
+
+/**
+ * @param [in] const std::string& text Already lowercased
+ * @param [in] const std::vector<std::string>& terms Already lowercased
+ *
+ * @returns bool doesTextContainEveryTerm
+ */
+static bool matchesAll(const std::string& text, const std::vector<std::string>& terms) {/*{{{*/
+    for(const std::string& term : terms) {
+        if(text.find(term) == std::string::npos) {
+            return false;
+        }
+    }
+
+    return true;
+}/*}}}*/
+
+/**
+ * Opens the search index inside installedPkgsPath
+ *
+ * @param [in] std::string installedPkgsPath
+ * @param [in] unsigned int verbosity
+ * @param [in] std::string buf A freshly built index to use instead of the file, for when it could not be saved
+ */
+SearchIndex::SearchIndex(std::string installedPkgsPath, unsigned int verbosity, std::string buf) {/*{{{*/
+    this->verbosity = verbosity;
+
+    if(!buf.empty()) {
+        owned = std::move(buf);
+        data = owned.data();
+        dataSize = owned.size();
+        valid = validate();
+        return;
+    }
+
+    std::string path = installedPkgsPath + "/" + SEARCH_FILENAME;
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        return;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size < SEARCH_HEADER_SIZE) {
+        close(fd);
+        return;
+    }
+
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(map == MAP_FAILED) {
+        return;
+    }
+
+    data = (const char*)map;
+    dataSize = st.st_size;
+    mapped = true;
+
+    // Queries jump between the tables
+    madvise((void*)data, dataSize, MADV_RANDOM);
+
+    valid = validate();
+    if(!valid && verbosity != 0) {
+        fprintf(stderr,"Error: The search index %s is corrupt. It will be rebuilt.\n",path.c_str());
+    }
+}/*}}}*/
+
+SearchIndex::~SearchIndex() {/*{{{*/
+    if(mapped) {
+        munmap((void*)data, dataSize);
+    }
+}/*}}}*/
+
+/**
+ * Reads the header, and checks that every table lies within the index
+ *
+ * @returns bool isIndexUsable
+ */
+bool SearchIndex::validate() {/*{{{*/
+    if(dataSize < SEARCH_HEADER_SIZE || memcmp(data, SEARCH_MAGIC, SEARCH_MAGIC_SIZE) != 0 || getLE(data + 8, 4) != SEARCH_VERSION) {
+        return false;
+    }
+
+    pkgCount = getLE(data + 12, 4);
+    pathCount = getLE(data + 16, 8);
+    trigramCount = getLE(data + 24, 8);
+    pathTableOffset = getLE(data + 32, 8);
+    trigramTableOffset = getLE(data + 40, 8);
+    stringsOffset = getLE(data + 48, 8);
+
+    if(pathTableOffset != SEARCH_HEADER_SIZE + (uint64_t)pkgCount * SEARCH_PKG_RECORD_SIZE || pathTableOffset > dataSize || pathCount > (dataSize - pathTableOffset) / SEARCH_PATH_RECORD_SIZE) {
+        return false;
+    }
+
+    if(trigramTableOffset < pathTableOffset + pathCount * SEARCH_PATH_RECORD_SIZE || trigramTableOffset > dataSize || trigramCount > (dataSize - trigramTableOffset) / SEARCH_TRIGRAM_RECORD_SIZE) {
+        return false;
+    }
+
+    if(stringsOffset < trigramTableOffset + trigramCount * SEARCH_TRIGRAM_RECORD_SIZE || stringsOffset > dataSize || getLE(data + 56, 4) > dataSize - stringsOffset) {
+        return false;
+    }
+
+    libraryPath = stringAt(0, getLE(data + 56, 4));
+    return true;
+}/*}}}*/
+
+/**
+ * @param [in] uint64_t offset Relative to the string area
+ * @param [in] uint64_t len
+ *
+ * @returns std::string str, or an empty string if it lies outside the index
+ */
+std::string SearchIndex::stringAt(uint64_t offset, uint64_t len) {/*{{{*/
+    uint64_t avail = dataSize - stringsOffset;
+    if(offset > avail || len > avail - offset) {
+        return std::string();
+    }
+
+    return std::string(data + stringsOffset + offset, len);
+}/*}}}*/
+
+/**
+ * @returns bool isIndexUsable
+ */
+bool SearchIndex::isValid() {/*{{{*/
+    return valid;
+}/*}}}*/
+
+/**
+ * @returns std::string libraryPath The absolute path of the library the index was built from
+ */
+std::string SearchIndex::getLibraryPath() {/*{{{*/
+    return libraryPath;
+}/*}}}*/
+
+/**
+ * @returns uint32_t pkgCount
+ */
+uint32_t SearchIndex::getPkgCount() {/*{{{*/
+    return pkgCount;
+}/*}}}*/
+
+/**
+ * Reads the package with the given id. Ids follow the order of the tarball paths
+ *
+ * @param [in] uint32_t id
+ * @param [out] searchPkg_s& pkg
+ * @param [in] bool withPaths Whether or not to read the paths the package contains, too
+ *
+ * @returns bool wasFound
+ */
+bool SearchIndex::getPkg(uint32_t id, searchPkg_s& pkg, bool withPaths) {/*{{{*/
+    if(!valid || id >= pkgCount) {
+        return false;
+    }
+
+    const char* rec = data + SEARCH_HEADER_SIZE + (uint64_t)id * SEARCH_PKG_RECORD_SIZE;
+    uint64_t count = getLE(rec + 12, 4);
+    uint64_t first = getLE(rec + 16, 8);
+
+    if(first > pathCount || count > pathCount - first) {
+        return false;
+    }
+
+    pkg.tarPath = stringAt(getLE(rec, 8), getLE(rec + 8, 4));
+    pkg.size = getLE(rec + 24, 8);
+    pkg.mtime = (int64_t)getLE(rec + 32, 8);
+    pkg.paths.clear();
+
+    if(withPaths) {
+        pkg.paths.reserve(count);
+        for(uint64_t index = first; index < first + count; index++) {
+            const char* p = data + pathTableOffset + index * SEARCH_PATH_RECORD_SIZE;
+            pkg.paths.push_back(stringAt(getLE(p, 8), getLE(p + 8, 4)));
+        }
+    }
+
+    return true;
+}/*}}}*/
+
+/**
+ * @returns std::vector<uint32_t> trigrams Every trigram in the index, in ascending order
+ */
+std::vector<uint32_t> SearchIndex::getTrigrams() {/*{{{*/
+    std::vector<uint32_t> trigrams;
+    if(!valid) {
+        return trigrams;
+    }
+
+    trigrams.reserve(trigramCount);
+    for(uint64_t index = 0; index < trigramCount; index++) {
+        trigrams.push_back(getLE(data + trigramTableOffset + index * SEARCH_TRIGRAM_RECORD_SIZE, 4));
+    }
+
+    return trigrams;
+}/*}}}*/
+
+/**
+ * Decodes the posting list of a trigram
+ *
+ * @param [in] uint32_t trigram
+ *
+ * @returns std::vector<uint32_t> ids The packages containing the trigram, in ascending order
+ */
+std::vector<uint32_t> SearchIndex::getPostings(uint32_t trigram) {/*{{{*/
+    std::vector<uint32_t> ids;
+    if(!valid) {
+        return ids;
+    }
+
+    uint64_t low = 0;
+    uint64_t high = trigramCount;
+    while(low < high) {
+        uint64_t mid = low + (high - low) / 2;
+        if(getLE(data + trigramTableOffset + mid * SEARCH_TRIGRAM_RECORD_SIZE, 4) < trigram) {
+            low = mid + 1;
+        }
+
+        else {
+            high = mid;
+        }
+    }
+
+    const char* rec = data + trigramTableOffset + low * SEARCH_TRIGRAM_RECORD_SIZE;
+    if(low == trigramCount || getLE(rec, 4) != trigram) {
+        return ids;
+    }
+
+    uint64_t count = getLE(rec + 4, 4);
+    uint64_t offset = getLE(rec + 8, 8);
+    if(offset > stringsOffset) {
+        return ids;
+    }
+
+    const char* p = data + offset;
+    const char* end = data + stringsOffset;
+    uint64_t id = 0;
+
+    ids.reserve(count);
+    for(uint64_t index = 0; index < count; index++) {
+        uint64_t delta;
+        if(!getVarint(p, end, delta)) {
+            break;
+        }
+
+        id += delta;
+        if(id >= pkgCount) {
+            break;
+        }
+
+        ids.push_back(id);
+    }
+
+    return ids;
+}/*}}}*/
+
+/**
+ * Narrows the packages down to the ones which may contain every term
+ * Terms shorter than a trigram can't be looked up, and don't narrow anything down
+ *
+ * @param [in] const std::vector<std::string>& terms Already lowercased
+ *
+ * @returns std::vector<uint32_t> ids
+ */
+std::vector<uint32_t> SearchIndex::findCandidates(const std::vector<std::string>& terms) {/*{{{*/
+    std::vector<uint32_t> trigrams;
+    for(const std::string& term : terms) {
+        addTrigrams(term, trigrams);
+    }
+
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+    std::vector<uint32_t> ids;
+    if(trigrams.empty()) {
+        for(uint32_t id = 0; id < pkgCount; id++) {
+            ids.push_back(id);
+        }
+
+        return ids;
+    }
+
+    ids = getPostings(trigrams[0]);
+    for(size_t index = 1; index < trigrams.size() && !ids.empty(); index++) {
+        std::vector<uint32_t> postings = getPostings(trigrams[index]);
+        std::vector<uint32_t> both;
+
+        std::set_intersection(ids.begin(), ids.end(), postings.begin(), postings.end(), std::back_inserter(both));
+        ids.swap(both);
+    }
+
+    return ids;
+}/*}}}*/
+
+/**
+ * Reads the paths of a tarball in the library, other than its metadata
+ *
+ * @param [in] const std::string& tarball
+ * @param [in] unsigned int verbosity
+ *
+ * @returns std::vector<std::string> paths
+ */
+static std::vector<std::string> readTarballPaths(const std::string& tarball, unsigned int verbosity) {/*{{{*/
+    std::vector<std::string> paths;
+
+    for(const tarMember_s& m : Pkg(tarball, verbosity).getPkgMembers((verbosity >= 3) ? verbosity : 0)) {
+        std::string path = normalizeMemberPath(m.path);
+        if(!path.empty() && !isPkgMeta(path)) {
+            paths.push_back(path);
+        }
+    }
+
+    return paths;
+}/*}}}*/
+
+/**
+ * Serializes the search index
+ *
+ * @param [in] const std::string& libraryPath
+ * @param [in] const std::vector<searchPkg_s>& pkgs Sorted by tarball path
+ * @param [in] const std::vector<std::pair<uint32_t, std::vector<uint32_t>>>& postings Sorted by trigram
+ *
+ * @returns std::string buf
+ */
+static std::string serializeSearchIndex(const std::string& libraryPath, const std::vector<searchPkg_s>& pkgs, const std::vector<std::pair<uint32_t, std::vector<uint32_t>>>& postings) {/*{{{*/
+    std::string strings = libraryPath;
+    std::string pkgTable;
+    std::string pathTable;
+    uint64_t pathCount = 0;
+
+    for(const searchPkg_s& pkg : pkgs) {
+        putLE(pkgTable, strings.size(), 8);
+        putLE(pkgTable, pkg.tarPath.size(), 4);
+        putLE(pkgTable, pkg.paths.size(), 4);
+        putLE(pkgTable, pathCount, 8);
+        putLE(pkgTable, pkg.size, 8);
+        putLE(pkgTable, (uint64_t)pkg.mtime, 8);
+        strings.append(pkg.tarPath);
+
+        for(const std::string& path : pkg.paths) {
+            putLE(pathTable, strings.size(), 8);
+            putLE(pathTable, path.size(), 4);
+            strings.append(path);
+        }
+
+        pathCount += pkg.paths.size();
+    }
+
+    std::string lists;
+    std::vector<uint64_t> listOffsets;
+    for(auto& it : postings) {
+        listOffsets.push_back(lists.size());
+
+        uint32_t prev = 0;
+        for(uint32_t id : it.second) {
+            putVarint(lists, id - prev);
+            prev = id;
+        }
+    }
+
+    uint64_t pathTableOffset = SEARCH_HEADER_SIZE + pkgTable.size();
+    uint64_t trigramTableOffset = pathTableOffset + pathTable.size();
+    uint64_t listsOffset = trigramTableOffset + postings.size() * SEARCH_TRIGRAM_RECORD_SIZE;
+    uint64_t stringsOffset = listsOffset + lists.size();
+
+    std::string buf;
+    buf.reserve(stringsOffset + strings.size());
+    buf.append(SEARCH_MAGIC, SEARCH_MAGIC_SIZE);
+    putLE(buf, SEARCH_VERSION, 4);
+    putLE(buf, pkgs.size(), 4);
+    putLE(buf, pathCount, 8);
+    putLE(buf, postings.size(), 8);
+    putLE(buf, pathTableOffset, 8);
+    putLE(buf, trigramTableOffset, 8);
+    putLE(buf, stringsOffset, 8);
+    putLE(buf, libraryPath.size(), 4);
+    putLE(buf, 0, 4);
+    buf.append(pkgTable);
+    buf.append(pathTable);
+
+    for(size_t index = 0; index < postings.size(); index++) {
+        putLE(buf, postings[index].first, 4);
+        putLE(buf, postings[index].second.size(), 4);
+        putLE(buf, listsOffset + listOffsets[index], 8);
+    }
+
+    buf.append(lists);
+    buf.append(strings);
+
+    return buf;
+}/*}}}*/
+
+/**
+ * Writes the search index to a temporary file, and renames it into place
+ *
+ * @param [in] std::string installedPkgsPath
+ * @param [in] const std::string& buf
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 on success, or SEARCH_IO_ERROR
+ */
+static int saveSearchIndex(std::string installedPkgsPath, const std::string& buf, unsigned int verbosity) {/*{{{*/
+    std::string tmpPath = installedPkgsPath + "/" + SEARCH_TMP_FILENAME;
+    std::string path = installedPkgsPath + "/" + SEARCH_FILENAME;
+
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd < 0) {
+        return SEARCH_IO_ERROR;
+    }
+
+    size_t done = 0;
+    while(done < buf.size()) {
+        ssize_t w = write(fd, buf.data() + done, buf.size() - done);
+        if(w < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if(w < 0) {
+            close(fd);
+            unlink(tmpPath.c_str());
+            return SEARCH_IO_ERROR;
+        }
+
+        done += w;
+    }
+
+    // The index can always be rebuilt from the library, so it isn't worth an fsync
+    if(close(fd) != 0 || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        unlink(tmpPath.c_str());
+        return SEARCH_IO_ERROR;
+    }
+
+    if(verbosity >= 4) {
+        printf("Wrote %lu bytes to the search index %s\n",buf.size(),path.c_str());
+    }
+
+    return 0;
+}/*}}}*/
+
+/**
+ * Brings the search index in line with the tarball library
+ *
+ * The library is walked and every tarball is stat'ed. Tarballs whose size and mtime match the index keep their entries, and their posting lists are carried over with their ids renumbered. Only new and changed tarballs are read.
+ * If nothing changed, the index is left alone.
+ *
+ * @param [in] std::string libraryPath
+ * @param [in] std::string installedPkgsPath
+ * @param [out] std::string& unsaved The rebuilt index, if it could not be saved. The search can still go ahead with it
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 on success, or SEARCH_IO_ERROR if the library can't be read
+ */
+int refreshSearchIndex(std::string libraryPath, std::string installedPkgsPath, std::string& unsaved, unsigned int verbosity) {/*{{{*/
+    std::filesystem::path library = std::filesystem::absolute(libraryPath).lexically_normal();
+    if(!library.has_filename() && library.has_parent_path()) {
+        library = library.parent_path();
+    }
+
+    // Concurrent searches would otherwise race each other to rebuild the index
+    std::string lockPath = installedPkgsPath + "/" + SEARCH_LOCK_FILENAME;
+    int lockFd = open(lockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if(lockFd >= 0) {
+        flock(lockFd, LOCK_EX);
+    }
+
+    // Walk the library
+    std::map<std::string, std::pair<uint64_t, int64_t>> found;
+    std::error_code ec;
+    std::filesystem::recursive_directory_iterator di(library, std::filesystem::directory_options::skip_permission_denied, ec);
+
+    for(; !ec && di != std::filesystem::recursive_directory_iterator(); di.increment(ec)) {
+        if(!isPkgFile(di->path().string())) {
+            continue;
+        }
+
+        struct stat st;
+        if(stat(di->path().c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+
+        found[di->path().lexically_relative(library).string()] = std::make_pair((uint64_t)st.st_size, (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec);
+    }
+
+    if(ec) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not read the package library %s. %s\n",library.c_str(),ec.message().c_str());
+        }
+
+        if(lockFd >= 0) {
+            close(lockFd);
+        }
+
+        return SEARCH_IO_ERROR;
+    }
+
+    // Find out what we already know
+    SearchIndex old(installedPkgsPath, verbosity);
+    std::map<std::string, uint32_t> oldIds;
+    std::vector<searchPkg_s> oldPkgs;
+    bool reusable = old.isValid() && old.getLibraryPath() == library.string();
+
+    if(reusable) {
+        oldPkgs.resize(old.getPkgCount());
+        for(uint32_t id = 0; id < old.getPkgCount(); id++) {
+            if(old.getPkg(id, oldPkgs[id], false)) {
+                oldIds[oldPkgs[id].tarPath] = id;
+            }
+        }
+    }
+
+    std::vector<searchPkg_s> pkgs;
+    std::vector<int64_t> remap(oldPkgs.size(), -1);
+    std::vector<uint32_t> freshIds;
+
+    for(auto& it : found) {
+        uint32_t id = pkgs.size();
+        auto prev = oldIds.find(it.first);
+
+        if(prev != oldIds.end() && oldPkgs[prev->second].size == it.second.first && oldPkgs[prev->second].mtime == it.second.second) {
+            searchPkg_s pkg;
+            old.getPkg(prev->second, pkg, true);
+            remap[prev->second] = id;
+            pkgs.push_back(std::move(pkg));
+            continue;
+        }
+
+        if(verbosity >= 4) {
+            printf("Indexing %s\n",it.first.c_str());
+        }
+
+        searchPkg_s pkg;
+        pkg.tarPath = it.first;
+        pkg.size = it.second.first;
+        pkg.mtime = it.second.second;
+        pkg.paths = readTarballPaths((library / it.first).string(), verbosity);
+
+        freshIds.push_back(id);
+        pkgs.push_back(std::move(pkg));
+    }
+
+    size_t dropped = 0;
+    for(auto& it : oldIds) {
+        if(found.count(it.first) == 0) {
+            dropped++;
+        }
+    }
+
+    if(reusable && freshIds.empty() && dropped == 0) {
+        if(verbosity >= 3) {
+            printf("The search index is up to date with %lu packages\n",pkgs.size());
+        }
+
+        if(lockFd >= 0) {
+            close(lockFd);
+        }
+
+        return 0;
+    }
+
+    // Collect the trigrams of the new and changed packages
+    std::vector<std::pair<uint32_t, uint32_t>> fresh;
+    for(uint32_t id : freshIds) {
+        std::vector<uint32_t> trigrams;
+        addTrigrams(lowercase(pkgNameFromPath(pkgs[id].tarPath)), trigrams);
+
+        for(const std::string& path : pkgs[id].paths) {
+            addTrigrams(lowercase(path), trigrams);
+        }
+
+        std::sort(trigrams.begin(), trigrams.end());
+        trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+        for(uint32_t trigram : trigrams) {
+            fresh.push_back(std::make_pair(trigram, id));
+        }
+    }
+
+    std::sort(fresh.begin(), fresh.end());
+
+    // Merge them into the surviving posting lists. Renumbering keeps the old ids in order, so each list only needs a merge
+    std::vector<std::pair<uint32_t, std::vector<uint32_t>>> postings;
+    std::vector<uint32_t> oldTrigrams = reusable ? old.getTrigrams() : std::vector<uint32_t>();
+    size_t next = 0;
+
+    auto takeFresh = [&](uint32_t trigram, std::vector<uint32_t>& ids) {
+        std::vector<uint32_t> added;
+        for(; next < fresh.size() && fresh[next].first == trigram; next++) {
+            added.push_back(fresh[next].second);
+        }
+
+        std::vector<uint32_t> merged;
+        std::merge(ids.begin(), ids.end(), added.begin(), added.end(), std::back_inserter(merged));
+        ids.swap(merged);
+    };
+
+    for(uint32_t trigram : oldTrigrams) {
+        for(; next < fresh.size() && fresh[next].first < trigram; ) {
+            uint32_t t = fresh[next].first;
+            std::vector<uint32_t> ids;
+            takeFresh(t, ids);
+            postings.push_back(std::make_pair(t, std::move(ids)));
+        }
+
+        std::vector<uint32_t> ids;
+        for(uint32_t id : old.getPostings(trigram)) {
+            if(remap[id] >= 0) {
+                ids.push_back(remap[id]);
+            }
+        }
+
+        takeFresh(trigram, ids);
+        if(!ids.empty()) {
+            postings.push_back(std::make_pair(trigram, std::move(ids)));
+        }
+    }
+
+    while(next < fresh.size()) {
+        uint32_t t = fresh[next].first;
+        std::vector<uint32_t> ids;
+        takeFresh(t, ids);
+        postings.push_back(std::make_pair(t, std::move(ids)));
+    }
+
+    if(verbosity >= 3) {
+        printf("Search index: %lu packages, %lu read from their tarballs, %lu no longer in the library\n",pkgs.size(),freshIds.size(),dropped);
+    }
+
+    std::string buf = serializeSearchIndex(library.string(), pkgs, postings);
+
+    if(lockFd < 0 || saveSearchIndex(installedPkgsPath, buf, verbosity) != 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Warning: Could not save the search index to %s. The next search will have to read the library again.\n",installedPkgsPath.c_str());
+        }
+
+        unsaved = std::move(buf);
+    }
+
+    if(lockFd >= 0) {
+        close(lockFd);
+    }
+
+    return 0;
+}/*}}}*/
+
+/**
+ * Searches the tarball library for packages whose name or paths contain every term, ignoring case
+ *
+ * Matching package names are printed on their own. Matching paths are printed after the name of the package containing them.
+ *
+ * @param [in] std::vector<std::string> terms
+ * @param [in] std::string libraryPath
+ * @param [in] std::string installedPkgsPath
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 if anything matched, SEARCH_NO_MATCH if nothing did, or SEARCH_IO_ERROR
+ */
+int searchLibrary(std::vector<std::string> terms, std::string libraryPath, std::string installedPkgsPath, unsigned int verbosity) {/*{{{*/
+    std::string unsaved;
+    int res = refreshSearchIndex(libraryPath, installedPkgsPath, unsaved, verbosity);
+    if(res != 0) {
+        return res;
+    }
+
+    SearchIndex index(installedPkgsPath, verbosity, unsaved);
+    if(!index.isValid()) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: The search index could not be read\n");
+        }
+
+        return SEARCH_IO_ERROR;
+    }
+
+    for(std::string& term : terms) {
+        term = lowercase(term);
+    }
+
+    std::vector<uint32_t> candidates = index.findCandidates(terms);
+    if(verbosity >= 4) {
+        printf("%lu of %u packages may match\n",candidates.size(),index.getPkgCount());
+    }
+
+    unsigned long matches = 0;
+    for(uint32_t id : candidates) {
+        searchPkg_s pkg;
+        if(!index.getPkg(id, pkg, true)) {
+            continue;
+        }
+
+        std::string name = pkgNameFromPath(pkg.tarPath);
+        if(matchesAll(lowercase(name), terms)) {
+            printf("%s\n",name.c_str());
+            matches++;
+        }
+
+        for(const std::string& path : pkg.paths) {
+            if(matchesAll(lowercase(path), terms)) {
+                printf("%s: %s\n",name.c_str(),path.c_str());
+                matches++;
+            }
+        }
+    }
+
+    return (matches != 0) ? 0 : SEARCH_NO_MATCH;
+}/*}}}*/
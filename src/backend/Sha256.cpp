@@ -0,0 +1,235 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Sha256.cpp
+ * @error -2300
+ *
+ * A plain SHA-256, so identifying file contents doesn't pull in a crypto library. See FIPS 180-4 for the algorithm.
+ */
+
+#include "Sha256.h"
+
+// The round constants; The first 32 bits of the fractional parts of the cube roots of the first 64 primes
+static const uint32_t roundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t rotr(uint32_t x, unsigned int n) {/*{{{*/
+    return (x >> n) | (x << (32 - n));
+}/*}}}*/
+
+/**
+ * Starts a new digest
+ */
+Sha256::Sha256() {/*{{{*/
+    state[0] = 0x6a09e667;
+    state[1] = 0xbb67ae85;
+    state[2] = 0x3c6ef372;
+    state[3] = 0xa54ff53a;
+    state[4] = 0x510e527f;
+    state[5] = 0x9b05688c;
+    state[6] = 0x1f83d9ab;
+    state[7] = 0x5be0cd19;
+}/*}}}*/
+
+/**
+ * Mixes one 64 byte block into the state
+ *
+ * @param [in] const unsigned char* data
+ */
+void Sha256::compress(const unsigned char* data) {/*{{{*/
+    uint32_t w[64];
+    for(int index = 0; index < 16; index++) {
+        w[index] = ((uint32_t)data[index * 4] << 24) | ((uint32_t)data[index * 4 + 1] << 16) | ((uint32_t)data[index * 4 + 2] << 8) | (uint32_t)data[index * 4 + 3];
+    }
+
+    for(int index = 16; index < 64; index++) {
+        uint32_t s0 = rotr(w[index - 15], 7) ^ rotr(w[index - 15], 18) ^ (w[index - 15] >> 3);
+        uint32_t s1 = rotr(w[index - 2], 17) ^ rotr(w[index - 2], 19) ^ (w[index - 2] >> 10);
+        w[index] = w[index - 16] + s0 + w[index - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for(int index = 0; index < 64; index++) {
+        uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + roundConstants[index] + w[index];
+        uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}/*}}}*/
+
+/**
+ * Adds data to the digest
+ *
+ * @param [in] const void* data
+ * @param [in] size_t len
+ */
+void Sha256::update(const void* data, size_t len) {/*{{{*/
+    const unsigned char* p = (const unsigned char*)data;
+    totalBytes += len;
+
+    // Top up a partial block first
+    if(blockUsed > 0) {
+        size_t take = SHA256_BLOCK_SIZE - blockUsed;
+        if(take > len) {
+            take = len;
+        }
+
+        memcpy(block + blockUsed, p, take);
+        blockUsed += take;
+        p += take;
+        len -= take;
+
+        if(blockUsed < SHA256_BLOCK_SIZE) {
+            return;
+        }
+
+        compress(block);
+        blockUsed = 0;
+    }
+
+    while(len >= SHA256_BLOCK_SIZE) {
+        compress(p);
+        p += SHA256_BLOCK_SIZE;
+        len -= SHA256_BLOCK_SIZE;
+    }
+
+    memcpy(block, p, len);
+    blockUsed = len;
+}/*}}}*/
+
+/**
+ * Pads the message, and returns the digest
+ * The object can't be used afterwards
+ *
+ * @returns std::string The SHA256_DIGEST_SIZE raw bytes of the digest
+ */
+std::string Sha256::digest() {/*{{{*/
+    uint64_t bits = totalBytes * 8;
+
+    unsigned char pad[SHA256_BLOCK_SIZE * 2] = { 0x80 };
+    size_t padLen = (blockUsed < 56) ? (56 - blockUsed) : (120 - blockUsed);
+    update(pad, padLen);
+
+    unsigned char lenBytes[8];
+    for(int index = 0; index < 8; index++) {
+        lenBytes[index] = (unsigned char)(bits >> (56 - 8 * index));
+    }
+
+    update(lenBytes, 8);
+
+    std::string out(SHA256_DIGEST_SIZE, '\0');
+    for(int index = 0; index < 8; index++) {
+        out[index * 4] = (char)(state[index] >> 24);
+        out[index * 4 + 1] = (char)(state[index] >> 16);
+        out[index * 4 + 2] = (char)(state[index] >> 8);
+        out[index * 4 + 3] = (char)state[index];
+    }
+
+    return out;
+}/*}}}*/
+
+/**
+ * Hashes a buffer in one go
+ *
+ * @param [in] const void* data
+ * @param [in] size_t len
+ *
+ * @returns std::string The raw digest
+ */
+std::string sha256(const void* data, size_t len) {/*{{{*/
+    Sha256 h;
+    h.update(data, len);
+
+    return h.digest();
+}/*}}}*/
+
+/**
+ * Hashes len bytes of a file, starting at offset, without moving its offset
+ *
+ * @param [in] int fd
+ * @param [in] off_t len
+ * @param [out] std::string& digest The raw digest
+ * @param [in] off_t offset Where in the file to start, such as the data of a tar member
+ *
+ * @returns bool wasTheWholeLengthRead, with errno set if not
+ */
+bool sha256File(int fd, off_t len, std::string& digest, off_t offset) {/*{{{*/
+    char* buf = (char*)malloc(SHA256_READ_SIZE);
+    if(buf == NULL) {
+        return false;
+    }
+
+    Sha256 h;
+    off_t done = 0;
+
+    while(done < len) {
+        size_t want = ((len - done) > SHA256_READ_SIZE) ? SHA256_READ_SIZE : (len - done);
+        ssize_t r = pread(fd, buf, want, offset + done);
+        if(r < 0 && errno == EINTR) {
+            continue;
+        }
+
+        // The file shrank underneath us
+        if(r <= 0) {
+            if(r == 0) {
+                errno = EIO;
+            }
+
+            free(buf);
+            return false;
+        }
+
+        h.update(buf, r);
+        done += r;
+    }
+
+    free(buf);
+    digest = h.digest();
+    return true;
+}/*}}}*/
+
+/**
+ * @param [in] const std::string& digest Raw bytes
+ *
+ * @returns std::string The lowercase hex form
+ */
+std::string hexDigest(const std::string& digest) {/*{{{*/
+    static const char digits[] = "0123456789abcdef";
+
+    std::string out;
+    out.reserve(digest.size() * 2);
+
+    for(unsigned char c : digest) {
+        out.push_back(digits[c >> 4]);
+        out.push_back(digits[c & 0xf]);
+    }
+
+    return out;
+}/*}}}*/
@@ -0,0 +1,464 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Stage.cpp
+ * @error -2100
+ *
+ * Installing a package by extracting it next to the system root, and then moving it into place.
+ *
+ * The package is extracted by the usual engines into its own directory under the staging directory, on the same filesystem as the root, so nothing in the root changes while the package is being read.
+ * Once the whole package is extracted, its data is flushed with a single syncfs, and it's committed: The staging directory is walked from the top, and each path is renamed into place. A directory which isn't in the root yet is moved whole. One which is gets the package's contents merged into it.
+ * Anything the package replaces is swapped with the new version using RENAME_EXCHANGE, so the old one ends up in the staging directory, and a failed commit can swap everything back.
+ */
+
+#include "Stage.h"
+
+// What committing a single path did, so it can be undone
+#define STAGE_OP_MOVED 0        // Renamed into a place nothing was
+#define STAGE_OP_EXCHANGED 1    // Swapped with what was there, which is now in the staging directory
+#define STAGE_OP_MODE 2         // A directory already in place was given the package's permissions
+
+struct stageOp_s {
+    std::string rel;
+    int op;
+    mode_t oldMode;
+};
+
+/**
+ * renameat2, through syscall, since older C libraries don't wrap it
+ * Where the kernel or filesystem doesn't support it, RENAME_NOREPLACE is checked for beforehand instead, and RENAME_EXCHANGE fails with EINVAL
+ *
+ * @param [in] int oldDirFd
+ * @param [in] const char* oldName
+ * @param [in] int newDirFd
+ * @param [in] const char* newName
+ * @param [in] unsigned int flags
+ *
+ * @returns int 0 on success, or -1 with errno set
+ */
+static int renameWithFlags(int oldDirFd, const char* oldName, int newDirFd, const char* newName, unsigned int flags) {/*{{{*/
+#ifdef SYS_renameat2
+    if(syscall(SYS_renameat2, oldDirFd, oldName, newDirFd, newName, flags) == 0) {
+        return 0;
+    }
+
+    if(errno != EINVAL && errno != ENOSYS) {
+        return -1;
+    }
+#endif /* SYS_renameat2 */
+
+    if(flags & RENAME_EXCHANGE) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct stat st;
+    if(fstatat(newDirFd, newName, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+        errno = EEXIST;
+        return -1;
+    }
+
+    return renameat(oldDirFd, oldName, newDirFd, newName);
+}/*}}}*/
+
+/**
+ * Deletes the directories of installs which were interrupted, found by the process named in them being gone
+ *
+ * @param [in] int stageFd
+ * @param [in] const std::string& root
+ * @param [in] unsigned int verbosity
+ */
+static void removeStaleStages(int stageFd, const std::string& root, unsigned int verbosity) {/*{{{*/
+    int fd = openat(stageFd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR* d = (fd < 0) ? NULL : fdopendir(fd);
+    if(d == NULL) {
+        if(fd >= 0) {
+            close(fd);
+        }
+
+        return;
+    }
+
+    std::vector<std::string> stale;
+    struct dirent* ent;
+    while((ent = readdir(d)) != NULL) {
+        char* end = NULL;
+        long pid = strtol(ent->d_name, &end, 10);
+        if(end == ent->d_name || *end != '.' || pid <= 0 || pid == getpid()) {
+            continue;
+        }
+
+        if(kill((pid_t)pid, 0) != 0 && errno == ESRCH) {
+            stale.push_back(ent->d_name);
+        }
+    }
+
+    closedir(d);
+
+    for(const std::string& name : stale) {
+        if(verbosity >= 3) {
+            printf("Deleting %s/%s/%s, left behind by an interrupted install\n",root.c_str(),STAGE_DIR_NAME,name.c_str());
+        }
+
+        removeTree(stageFd, name.c_str(), true);
+    }
+}/*}}}*/
+
+/**
+ * Makes a new directory for a package to be extracted into, under the staging directory
+ * The directories of installs which were interrupted are deleted first. See removeStaleStages
+ *
+ * @param [in] std::string root
+ * @param [in] std::string pkgName
+ * @param [out] std::string& stagePath The full path of the new directory
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 on success, or STAGE_DIR_ERROR
+ */
+int makeStagingDir(std::string root, std::string pkgName, std::string& stagePath, unsigned int verbosity) {/*{{{*/
+    // Installs run in parallel when more than one job is allowed, and each needs a name of its own
+    static std::atomic<unsigned int> sequence(0);
+
+    int rootFd = open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(rootFd < 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not open the system root %s. %s\n",root.c_str(),strerror(errno));
+        }
+
+        return STAGE_DIR_ERROR;
+    }
+
+    // Another install's discardStaged may remove the staging directory between us making and using it, while it's empty
+    std::string name;
+    int made = -1;
+    for(int attempt = 0; attempt < 3 && made != 0; attempt++) {
+        if(mkdirat(rootFd, STAGE_DIR_NAME, S_IRWXU) != 0 && errno != EEXIST) {
+            break;
+        }
+
+        int stageFd = openat(rootFd, STAGE_DIR_NAME, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if(stageFd < 0) {
+            if(errno == ENOENT) {
+                continue;
+            }
+
+            break;
+        }
+
+        removeStaleStages(stageFd, root, verbosity);
+
+        // Named after our pid first, so an interrupted install can be told apart from one still running
+        do {
+            name = std::to_string(getpid()) + "." + std::to_string(sequence++) + "." + pkgName;
+        } while((made = mkdirat(stageFd, name.c_str(), S_IRWXU)) != 0 && errno == EEXIST);
+
+        int err = errno;
+        close(stageFd);
+
+        if(made != 0 && err != ENOENT) {
+            errno = err;
+            break;
+        }
+    }
+
+    int err = errno;
+    close(rootFd);
+
+    if(made != 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not make a directory in %s/%s. %s\n",root.c_str(),STAGE_DIR_NAME,strerror(err));
+        }
+
+        return STAGE_DIR_ERROR;
+    }
+
+    stagePath = root + "/" + STAGE_DIR_NAME + "/" + name;
+    return 0;
+}/*}}}*/
+
+/**
+ * Moves the contents of one staged directory into place, and merges its subdirectories into those already there
+ *
+ * @param [in] DirFdCache& live The system root
+ * @param [in] int stagedFd The staged directory
+ * @param [in] const std::string& rel The directory's canonical path, which is the same in both
+ * @param [in,out] std::vector<stageOp_s>& ops What was done so far
+ * @param [in,out] unsigned long& renames
+ * @param [in] const std::string& root
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 on success, or STAGE_COMMIT_ERROR
+ */
+static int commitDir(DirFdCache& live, int stagedFd, const std::string& rel, std::vector<stageOp_s>& ops, unsigned long& renames, const std::string& root, unsigned int verbosity) {/*{{{*/
+    // Read the whole directory first, since swapping puts the old versions into it under the same names
+    std::vector<std::pair<std::string, bool>> entries;
+    int fd = openat(stagedFd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR* d = (fd < 0) ? NULL : fdopendir(fd);
+    if(d == NULL) {
+        if(fd >= 0) {
+            close(fd);
+        }
+
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not read the staged directory %s. %s\n",rel.c_str(),strerror(errno));
+        }
+
+        return STAGE_COMMIT_ERROR;
+    }
+
+    struct dirent* ent;
+    while((ent = readdir(d)) != NULL) {
+        if(strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) {
+            continue;
+        }
+
+        bool isDir = (ent->d_type == DT_DIR);
+        if(ent->d_type == DT_UNKNOWN) {
+            struct stat st;
+            isDir = fstatat(stagedFd, ent->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode);
+        }
+
+        entries.push_back(std::make_pair(std::string(ent->d_name), isDir));
+    }
+
+    closedir(d);
+
+    // Looking up the subdirectories may close the cache's copy of this one, so hold on to our own
+    int liveFd = live.dirFd(rel, false);
+    liveFd = (liveFd >= 0) ? fcntl(liveFd, F_DUPFD_CLOEXEC, 0) : -1;
+    if(liveFd < 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not open %s/%s. %s\n",root.c_str(),rel.c_str(),strerror(errno));
+        }
+
+        return STAGE_COMMIT_ERROR;
+    }
+
+    int res = 0;
+    for(const auto& entry : entries) {
+        const char* name = entry.first.c_str();
+        std::string childRel = rel.empty() ? entry.first : rel + "/" + entry.first;
+        std::string dest = root + "/" + childRel;
+
+        struct stat st;
+        bool exists = fstatat(liveFd, name, &st, AT_SYMLINK_NOFOLLOW) == 0;
+        int err = exists ? 0 : errno;
+
+        if(!exists && err != ENOENT) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Could not install %s. %s\n",dest.c_str(),strerror(err));
+            }
+
+            res = STAGE_COMMIT_ERROR;
+            break;
+        }
+
+        // Nothing in the way. A directory is moved along with everything in it
+        if(!exists) {
+            if(renameWithFlags(stagedFd, name, liveFd, name, RENAME_NOREPLACE) == 0) {
+                ops.push_back(stageOp_s{ childRel, STAGE_OP_MOVED, 0 });
+                renames++;
+                continue;
+            }
+
+            // Another install sharing the directory may have moved its own into place since we looked. Ours is merged into it instead
+            err = errno;
+            exists = entry.second && err == EEXIST && fstatat(liveFd, name, &st, AT_SYMLINK_NOFOLLOW) == 0;
+            if(!exists) {
+                if(verbosity != 0) {
+                    fprintf(stderr,"Error: Could not install %s. %s\n",dest.c_str(),strerror(err));
+                }
+
+                res = STAGE_COMMIT_ERROR;
+                break;
+            }
+        }
+
+        if(entry.second) {
+            // As when extracting in place, a directory, or a symbolic link to one, has the package merged into it
+            struct stat target = st;
+            if(!S_ISDIR(st.st_mode) && !(S_ISLNK(st.st_mode) && fstatat(liveFd, name, &target, 0) == 0 && S_ISDIR(target.st_mode))) {
+                if(verbosity != 0) {
+                    fprintf(stderr,"Error: Could not create the directory %s. %s\n",dest.c_str(),strerror(EEXIST));
+                }
+
+                res = STAGE_COMMIT_ERROR;
+                break;
+            }
+
+            struct stat staged;
+            int childFd = openat(stagedFd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if(childFd < 0 || fstat(childFd, &staged) != 0) {
+                if(verbosity != 0) {
+                    fprintf(stderr,"Error: Could not read the staged directory %s. %s\n",childRel.c_str(),strerror(errno));
+                }
+
+                if(childFd >= 0) {
+                    close(childFd);
+                }
+
+                res = STAGE_COMMIT_ERROR;
+                break;
+            }
+
+            // A read-only directory would otherwise keep its contents, unless we're root
+            fchmod(childFd, S_IRWXU);
+            res = commitDir(live, childFd, childRel, ops, renames, root, verbosity);
+            close(childFd);
+
+            if(res != 0) {
+                break;
+            }
+
+            // Its permissions are applied after its contents, as when extracting in place
+            mode_t mode = staged.st_mode & 07777;
+            if((target.st_mode & 07777) != mode && fchmodat(liveFd, name, mode, 0) == 0) {
+                ops.push_back(stageOp_s{ childRel, STAGE_OP_MODE, (mode_t)(target.st_mode & 07777) });
+            }
+
+            continue;
+        }
+
+        // Anything else replaces what's there, unless that's a directory
+        if(S_ISDIR(st.st_mode)) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Could not install %s. %s\n",dest.c_str(),strerror(EISDIR));
+            }
+
+            res = STAGE_COMMIT_ERROR;
+            break;
+        }
+
+        if(renameWithFlags(stagedFd, name, liveFd, name, RENAME_EXCHANGE) == 0) {
+            ops.push_back(stageOp_s{ childRel, STAGE_OP_EXCHANGED, 0 });
+            renames++;
+            continue;
+        }
+
+        // A filesystem which can't swap still replaces atomically, but then the old version can't be put back
+        if(errno == EINVAL && renameat(stagedFd, name, liveFd, name) == 0) {
+            ops.push_back(stageOp_s{ childRel, STAGE_OP_MOVED, 0 });
+            renames++;
+            continue;
+        }
+
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not install %s. %s\n",dest.c_str(),strerror(errno));
+        }
+
+        res = STAGE_COMMIT_ERROR;
+        break;
+    }
+
+    close(liveFd);
+    return res;
+}/*}}}*/
+
+/**
+ * Undoes a partial commit, last step first
+ *
+ * @param [in] DirFdCache& live
+ * @param [in] DirFdCache& staged
+ * @param [in] const std::vector<stageOp_s>& ops
+ * @param [in] const std::string& root
+ * @param [in] unsigned int verbosity
+ *
+ * @returns unsigned long The number of steps which could not be undone
+ */
+static unsigned long undoCommit(DirFdCache& live, DirFdCache& staged, const std::vector<stageOp_s>& ops, const std::string& root, unsigned int verbosity) {/*{{{*/
+    unsigned long failed = 0;
+
+    for(auto it = ops.rbegin(); it != ops.rend(); it++) {
+        std::string leaf;
+        int liveFd = live.parentFd(it->rel, leaf, false);
+        if(liveFd < 0) {
+            failed++;
+            continue;
+        }
+
+        if(it->op == STAGE_OP_MODE) {
+            if(fchmodat(liveFd, leaf.c_str(), it->oldMode, 0) != 0) {
+                failed++;
+            }
+
+            continue;
+        }
+
+        int stagedFd = staged.parentFd(it->rel, leaf, false);
+        int r = -1;
+        if(stagedFd >= 0) {
+            r = (it->op == STAGE_OP_EXCHANGED) ? renameWithFlags(stagedFd, leaf.c_str(), liveFd, leaf.c_str(), RENAME_EXCHANGE) : renameWithFlags(liveFd, leaf.c_str(), stagedFd, leaf.c_str(), RENAME_NOREPLACE);
+        }
+
+        if(r != 0) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Could not undo the installation of %s/%s. %s\n",root.c_str(),it->rel.c_str(),strerror(errno));
+            }
+
+            failed++;
+        }
+    }
+
+    return failed;
+}/*}}}*/
+
+/**
+ * Moves an extracted package from its staging directory into the system root
+ * The package's data is flushed to the disk first, so no file can appear in the root before its contents are safe. If any path can't be moved into place, the root is put back the way it was
+ *
+ * @param [in] std::string stagePath
+ * @param [in] std::string root
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 on success, or STAGE_COMMIT_ERROR
+ */
+int commitStaged(std::string stagePath, std::string root, unsigned int verbosity) {/*{{{*/
+    DirFdCache live(root, verbosity);
+    DirFdCache staged(stagePath, verbosity);
+    if(!live.isOpen() || !staged.isOpen()) {
+        return STAGE_COMMIT_ERROR;
+    }
+
+    if(syncfs(staged.getRootFd()) != 0 && verbosity != 0) {
+        fprintf(stderr,"Warning: Could not flush %s to the disk. %s. Continuing.\n",stagePath.c_str(),strerror(errno));
+    }
+
+    std::vector<stageOp_s> ops;
+    unsigned long renames = 0;
+
+    int res = commitDir(live, staged.getRootFd(), std::string(), ops, renames, root, verbosity);
+    if(res != 0) {
+        unsigned long failed = undoCommit(live, staged, ops, root, verbosity);
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: The package could not be moved into place. %s\n",(failed == 0) ? "Nothing was changed." : "Some of it could not be taken back out.");
+        }
+
+        return res;
+    }
+
+    if(verbosity >= 3) {
+        printf("Moved the package into place with %lu renames\n",renames);
+    }
+
+    return 0;
+}/*}}}*/
+
+/**
+ * Deletes a package's staging directory, along with whatever it replaced, and the staging directory itself once no other install is using it
+ *
+ * @param [in] std::string root
+ * @param [in] std::string stagePath
+ */
+void discardStaged(std::string root, std::string stagePath) {/*{{{*/
+    std::string stageDir = root + "/" + STAGE_DIR_NAME;
+    int stageFd = open(stageDir.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if(stageFd < 0) {
+        return;
+    }
+
+    removeTree(stageFd, stagePath.substr(stagePath.rfind('/') + 1).c_str(), true);
+    close(stageFd);
+
+    rmdir(stageDir.c_str());
+}/*}}}*/
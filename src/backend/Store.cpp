@@ -0,0 +1,845 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Store.cpp
+ * @error -2400
+ *
+ * The content addressed store of unpacked packages. See ContentStore in Store.h.
+ *
+ * An index is a 32 byte header (the magic, the format version, the number of entries, and the size and modification time of the tarball it was made from), followed by one record per entry.
+ * Each record is the type and flags, then the mode, size, path length and link target length as LEB128 integers, then the path, the link target and the hash length and hash. All fixed-width integers are little-endian.
+ * An index is only used while its tarball's size and modification time match; A rebuilt package is stored again.
+ */
+
+#include "Store.h"
+
+#define STORE_INDEX_HEADER_SIZE 32
+
+// Which of the counts placeFile keeps
+#define STORE_COUNT_CLONED 0
+#define STORE_COUNT_LINKED 1
+#define STORE_COUNT_COPIED 2
+
+/**
+ * Names the object holding a file's contents
+ *
+ * @param [in] const std::string& hash The raw SHA-256 of the contents
+ * @param [in] mode_t mode Hard links share the mode, so it's part of the name
+ *
+ * @returns std::string The object's path under the objects directory, such as ab/cdef...0123.755
+ */
+std::string storeObjectName(const std::string& hash, mode_t mode) {/*{{{*/
+    std::string hex = hexDigest(hash);
+
+    char modeStr[16];
+    snprintf(modeStr, sizeof(modeStr), ".%o", (unsigned int)(mode & 07777));
+
+    return hex.substr(0, 2) + "/" + hex.substr(2) + modeStr;
+}/*}}}*/
+
+/**
+ * Opens a directory below dirFd, creating it if need be
+ *
+ * @returns int fd, or -1 with errno set
+ */
+static int openStoreDir(int dirFd, const char* name) {/*{{{*/
+    if(mkdirat(dirFd, name, 0700) != 0 && errno != EEXIST) {
+        return -1;
+    }
+
+    return openat(dirFd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}/*}}}*/
+
+/**
+ * Opens the store, creating it if it doesn't exist yet
+ *
+ * @param [in] std::string path
+ * @param [in] bool hardlinks Whether installed files are hard linked to their objects, instead of cloned or copied
+ * @param [in] unsigned long long maxBytes The most the objects may take up before packages are dropped. 0 never drops anything
+ * @param [in] unsigned int verbosity
+ */
+ContentStore::ContentStore(std::string path, bool hardlinks, unsigned long long maxBytes, unsigned int verbosity) : tmpSeq(0) {/*{{{*/
+    this->path = path;
+    this->hardlinks = hardlinks;
+    this->maxBytes = maxBytes;
+    this->verbosity = verbosity;
+
+    if(mkdir(path.c_str(), 0700) != 0 && errno != EEXIST) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not create the package store %s. %s\n",path.c_str(),strerror(errno));
+        }
+
+        return;
+    }
+
+    storeFd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(storeFd >= 0) {
+        objectsFd = openStoreDir(storeFd, STORE_OBJECTS_DIR);
+        pkgsFd = openStoreDir(storeFd, STORE_PKGS_DIR);
+        tmpFd = openStoreDir(storeFd, STORE_TMP_DIR);
+    }
+
+    if(!isOpen() && verbosity != 0) {
+        fprintf(stderr,"Error: Could not open the package store %s. %s\n",path.c_str(),strerror(errno));
+    }
+}/*}}}*/
+
+ContentStore::~ContentStore() {/*{{{*/
+    for(int fd : { storeFd, objectsFd, pkgsFd, tmpFd }) {
+        if(fd >= 0) {
+            close(fd);
+        }
+    }
+}/*}}}*/
+
+/**
+ * @returns bool wasEveryPartOfTheStoreOpened
+ */
+bool ContentStore::isOpen() {/*{{{*/
+    return storeFd >= 0 && objectsFd >= 0 && pkgsFd >= 0 && tmpFd >= 0;
+}/*}}}*/
+
+/**
+ * Takes the store's lock. It's released by closing the returned fd
+ * Each call opens the lock file anew, so threads of the same process lock against each other too
+ *
+ * @param [in] int operation LOCK_SH or LOCK_EX
+ *
+ * @returns int fd, or -1 with errno set
+ */
+int ContentStore::lockStore(int operation) {/*{{{*/
+    int fd = openat(storeFd, STORE_LOCK_NAME, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if(fd < 0) {
+        return -1;
+    }
+
+    while(flock(fd, operation) != 0) {
+        if(errno != EINTR) {
+            close(fd);
+            return -1;
+        }
+    }
+
+    return fd;
+}/*}}}*/
+
+/**
+ * Reads a package's index
+ *
+ * @param [in] std::string name The package name
+ * @param [out] std::vector<storeEntry_s>& entries
+ * @param [out] off_t* tarSize If not NULL, the size of the tarball the index was made from
+ * @param [out] struct timespec* tarMtime If not NULL, its modification time
+ *
+ * @returns bool wasThereAValidIndex
+ */
+bool ContentStore::readIndex(std::string name, std::vector<storeEntry_s>& entries, off_t* tarSize, struct timespec* tarMtime) {/*{{{*/
+    int fd = openat(pkgsFd, name.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size < STORE_INDEX_HEADER_SIZE) {
+        close(fd);
+        return false;
+    }
+
+    std::string buf(st.st_size, '\0');
+    size_t got = 0;
+    while(got < buf.size()) {
+        ssize_t r = read(fd, &buf[got], buf.size() - got);
+        if(r < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if(r <= 0) {
+            break;
+        }
+
+        got += r;
+    }
+
+    close(fd);
+
+    if(got != buf.size() || memcmp(buf.data(), STORE_INDEX_MAGIC, STORE_INDEX_MAGIC_SIZE) != 0 || getLE(buf.data() + 8, 4) != STORE_INDEX_VERSION) {
+        return false;
+    }
+
+    uint64_t count = getLE(buf.data() + 12, 4);
+    if(tarSize != NULL) {
+        *tarSize = getLE(buf.data() + 16, 8);
+    }
+
+    if(tarMtime != NULL) {
+        tarMtime->tv_sec = getLE(buf.data() + 24, 5);
+        tarMtime->tv_nsec = getLE(buf.data() + 29, 3) * 1000;
+    }
+
+    const char* p = buf.data() + STORE_INDEX_HEADER_SIZE;
+    const char* end = buf.data() + buf.size();
+
+    entries.clear();
+    entries.reserve(count);
+
+    for(uint64_t index = 0; index < count; index++) {
+        if(end - p < 2) {
+            return false;
+        }
+
+        storeEntry_s e;
+        e.type = p[0];
+        e.flags = p[1];
+        p += 2;
+
+        uint64_t mode, size, pathLen, targetLen;
+        if(!getVarint(p, end, mode) || !getVarint(p, end, size) || !getVarint(p, end, pathLen) || !getVarint(p, end, targetLen)) {
+            return false;
+        }
+
+        if((uint64_t)(end - p) < pathLen + targetLen + 1) {
+            return false;
+        }
+
+        e.mode = mode;
+        e.size = size;
+        e.path.assign(p, pathLen);
+        p += pathLen;
+        e.linkTarget.assign(p, targetLen);
+        p += targetLen;
+
+        size_t hashLen = (unsigned char)*p++;
+        if((size_t)(end - p) < hashLen) {
+            return false;
+        }
+
+        e.hash.assign(p, hashLen);
+        p += hashLen;
+
+        entries.push_back(e);
+    }
+
+    return p == end;
+}/*}}}*/
+
+/**
+ * Writes a package's index, replacing any older one in a single rename
+ *
+ * @param [in] std::string name The package name
+ * @param [in] const std::vector<storeEntry_s>& entries
+ * @param [in] const struct stat& tarStat The tarball the entries were read from
+ *
+ * @returns bool wasItWritten
+ */
+bool ContentStore::writeIndex(std::string name, const std::vector<storeEntry_s>& entries, const struct stat& tarStat) {/*{{{*/
+    std::string buf(STORE_INDEX_MAGIC, STORE_INDEX_MAGIC_SIZE - 1);
+    buf.push_back('\0');
+    putLE(buf, STORE_INDEX_VERSION, 4);
+    putLE(buf, entries.size(), 4);
+    putLE(buf, tarStat.st_size, 8);
+
+    // Seconds in 40 bits, and microseconds in 24, since that's all cp -p and most tar implementations keep anyway
+    putLE(buf, tarStat.st_mtim.tv_sec, 5);
+    putLE(buf, tarStat.st_mtim.tv_nsec / 1000, 3);
+
+    for(const storeEntry_s& e : entries) {
+        buf.push_back(e.type);
+        buf.push_back((char)e.flags);
+        putVarint(buf, e.mode);
+        putVarint(buf, e.size);
+        putVarint(buf, e.path.size());
+        putVarint(buf, e.linkTarget.size());
+        buf.append(e.path);
+        buf.append(e.linkTarget);
+        buf.push_back((char)e.hash.size());
+        buf.append(e.hash);
+    }
+
+    std::string tmpName = std::to_string(getpid()) + "." + std::to_string(tmpSeq++) + ".idx";
+    int fd = openat(tmpFd, tmpName.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if(fd < 0) {
+        return false;
+    }
+
+    bool written = writeBuffer(fd, buf.data(), buf.size());
+    if(close(fd) != 0 || !written || renameat(tmpFd, tmpName.c_str(), pkgsFd, name.c_str()) != 0) {
+        unlinkat(tmpFd, tmpName.c_str(), 0);
+        return false;
+    }
+
+    return true;
+}/*}}}*/
+
+/**
+ * Adds a file's contents to the store, unless it already has them
+ * The object is filled in under tmp, and renamed into place once complete, so a half written object is never used
+ *
+ * @param [in] int srcFd The file, as extracted
+ * @param [in] const std::string& hash
+ * @param [in] mode_t mode
+ * @param [in] off_t size
+ *
+ * @returns int 0 on success, or a negative error code
+ */
+int ContentStore::addObject(int srcFd, const std::string& hash, mode_t mode, off_t size) {/*{{{*/
+    std::string name = storeObjectName(hash, mode);
+    struct stat st;
+
+    if(fstatat(objectsFd, name.c_str(), &st, AT_SYMLINK_NOFOLLOW) == 0) {
+        return 0;
+    }
+
+    std::string fanout = name.substr(0, 2);
+    if(mkdirat(objectsFd, fanout.c_str(), 0700) != 0 && errno != EEXIST) {
+        return STORE_OBJECT_ERROR;
+    }
+
+    std::string tmpName = std::to_string(getpid()) + "." + std::to_string(tmpSeq++);
+    int fd = openat(tmpFd, tmpName.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if(fd < 0) {
+        return STORE_OBJECT_ERROR;
+    }
+
+    bool copied = false;
+
+#ifdef FICLONE
+    copied = (ioctl(fd, FICLONE, srcFd) == 0);
+#endif /* FICLONE */
+
+    if(!copied) {
+        copied = (copyFileData(srcFd, 0, fd, size) == size);
+    }
+
+    // Another install may have added the same object in the meantime. Replacing it with the same contents is harmless
+    copied = copied && fchmod(fd, mode & 07777) == 0;
+    copied = (close(fd) == 0) && copied;
+
+    if(!copied || renameat(tmpFd, tmpName.c_str(), objectsFd, name.c_str()) != 0) {
+        unlinkat(tmpFd, tmpName.c_str(), 0);
+        return STORE_OBJECT_ERROR;
+    }
+
+    return 0;
+}/*}}}*/
+
+/**
+ * Puts a stored file in place at leaf within dirFd, replacing whatever was there
+ * Hard links are only tried when asked for. Otherwise, or when they can't be made, the object is cloned, and copied if it can't be cloned either
+ *
+ * @param [in] int dirFd
+ * @param [in] const std::string& leaf
+ * @param [in] const storeEntry_s& e
+ * @param [in] const std::string& dest The full path, for messages
+ * @param [in] WritebackTracker* durability May be NULL
+ * @param [in] const std::string& rel The canonical path
+ * @param [out] unsigned long* counts Indexed by STORE_COUNT_*
+ *
+ * @returns int 0 on success, STORE_MISS if the object is missing, or a negative error code
+ */
+int ContentStore::placeFile(int dirFd, const std::string& leaf, const storeEntry_s& e, const std::string& dest, WritebackTracker* durability, const std::string& rel, unsigned long* counts) {/*{{{*/
+    std::string name = storeObjectName(e.hash, e.mode);
+
+    if(hardlinks) {
+        if(unlinkat(dirFd, leaf.c_str(), 0) != 0 && errno != ENOENT) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Could not replace %s. %s\n",dest.c_str(),strerror(errno));
+            }
+
+            return STORE_ENTRY_ERROR;
+        }
+
+        if(linkat(objectsFd, name.c_str(), dirFd, leaf.c_str(), 0) == 0) {
+            if(durability != NULL) {
+                durability->pathRestored(dest, rel, true);
+            }
+
+            counts[STORE_COUNT_LINKED]++;
+            return 0;
+        }
+
+        // Different filesystems, or too many links already. Fall back to a clone
+        if(errno == ENOENT) {
+            return STORE_MISS;
+        }
+    }
+
+    int srcFd = openat(objectsFd, name.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if(srcFd < 0) {
+        return STORE_MISS;
+    }
+
+    int fd = createMemberFile(dirFd, leaf);
+    if(fd < 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not create the file %s. %s\n",dest.c_str(),strerror(errno));
+        }
+
+        close(srcFd);
+        return STORE_ENTRY_ERROR;
+    }
+
+    bool cloned = false;
+
+#ifdef FICLONE
+    cloned = (ioctl(fd, FICLONE, srcFd) == 0);
+#endif /* FICLONE */
+
+    if(!cloned && copyFileData(srcFd, 0, fd, e.size) != e.size) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not copy the contents of %s out of the store. %s\n",dest.c_str(),strerror(errno));
+        }
+
+        close(fd);
+        close(srcFd);
+        return STORE_ENTRY_ERROR;
+    }
+
+    close(srcFd);
+
+    // ARCHIVE_EXTRACT_PERM restores the full mode, ignoring the umask
+    fchmod(fd, e.mode);
+    closeWritten(durability, fd, rel);
+
+    counts[cloned ? STORE_COUNT_CLONED : STORE_COUNT_COPIED]++;
+    return 0;
+}/*}}}*/
+
+/**
+ * Installs a package into root from the store, if the store has this tarball
+ *
+ * The entries are replayed in archive order, just as the extraction engines would create them, and directory permissions are applied last.
+ * If any part of the package is missing from the store, STORE_MISS is returned, and the caller extracts the tarball instead. That overwrites anything already put in place here.
+ *
+ * @param [in] std::string tarPath
+ * @param [in] std::string pkgName
+ * @param [in] std::string root
+ * @param [in] const ExclusionMatcher& exclusions
+ * @param [in] WritebackTracker* durability If not NULL, every entry is reported to it
+ *
+ * @returns int ARCHIVE_EOF on success, STORE_MISS, or a negative error code
+ */
+int ContentStore::materialize(std::string tarPath, std::string pkgName, std::string root, const ExclusionMatcher& exclusions, WritebackTracker* durability) {/*{{{*/
+    struct stat tarStat;
+    if(!isOpen() || stat(tarPath.c_str(), &tarStat) != 0) {
+        return STORE_MISS;
+    }
+
+    int lockFd = lockStore(LOCK_SH);
+    if(lockFd < 0) {
+        return STORE_MISS;
+    }
+
+    std::vector<storeEntry_s> entries;
+    off_t tarSize = 0;
+    struct timespec tarMtime;
+
+    if(!readIndex(pkgName, entries, &tarSize, &tarMtime) || tarSize != tarStat.st_size || tarMtime.tv_sec != tarStat.st_mtim.tv_sec || tarMtime.tv_nsec != (tarStat.st_mtim.tv_nsec / 1000) * 1000) {
+        if(verbosity >= 4) {
+            printf("The store has no copy of this build of %s\n",pkgName.c_str());
+        }
+
+        close(lockFd);
+        return STORE_MISS;
+    }
+
+    // Anything which was excluded when the package was stored has to be excluded now, too
+    for(const storeEntry_s& e : entries) {
+        bool excluded = exclusions.matches(e.path) || (e.type == TAR_TYPE_HARDLINK && exclusions.matches(e.linkTarget));
+        if((e.flags & STORE_ENTRY_ABSENT) != 0 && !excluded) {
+            if(verbosity >= 4) {
+                printf("The store's copy of %s is missing %s\n",pkgName.c_str(),e.path.c_str());
+            }
+
+            close(lockFd);
+            return STORE_MISS;
+        }
+    }
+
+    DirFdCache dirs(root, verbosity);
+    if(!dirs.isOpen()) {
+        close(lockFd);
+        return STORE_ROOT_ERROR;
+    }
+
+    std::vector<std::pair<std::string, mode_t>> dirModes;
+    unsigned long counts[3] = { 0, 0, 0 };
+    int err = 0;
+
+    for(const storeEntry_s& e : entries) {
+        if((e.flags & STORE_ENTRY_ABSENT) != 0 || exclusions.matches(e.path) || (e.type == TAR_TYPE_HARDLINK && exclusions.matches(e.linkTarget))) {
+            continue;
+        }
+
+        std::string rel = canonicalMemberPath(e.path);
+        std::string dest = root + "/" + rel;
+
+        // An entry for the root itself, such as "./", only carries its permissions
+        if(rel.empty()) {
+            if(e.type == TAR_TYPE_DIRECTORY) {
+                dirModes.push_back(std::pair<std::string, mode_t>(rel, e.mode));
+            }
+
+            continue;
+        }
+
+        std::string leaf;
+        int dirFd = dirs.parentFd(rel, leaf, true);
+        if(dirFd < 0) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Could not create the parent directories of %s. %s\n",dest.c_str(),strerror(errno));
+            }
+
+            err = STORE_DIRECTORY_ERROR;
+            break;
+        }
+
+        if(e.type == TAR_TYPE_DIRECTORY) {
+            if(!createDirectory(dirFd, leaf)) {
+                if(verbosity != 0) {
+                    fprintf(stderr,"Error: Could not create the directory %s. %s\n",dest.c_str(),strerror(errno));
+                }
+
+                err = STORE_DIRECTORY_ERROR;
+                break;
+            }
+
+            dirModes.push_back(std::pair<std::string, mode_t>(rel, e.mode));
+        }
+
+        else if(e.type == TAR_TYPE_SYMLINK) {
+            if(!clearPath(dirFd, leaf) || symlinkat(e.linkTarget.c_str(), dirFd, leaf.c_str()) != 0) {
+                if(verbosity != 0) {
+                    fprintf(stderr,"Error: Could not create the symbolic link %s. %s\n",dest.c_str(),strerror(errno));
+                }
+
+                err = STORE_SYMLINK_ERROR;
+                break;
+            }
+        }
+
+        else if(e.type == TAR_TYPE_HARDLINK) {
+            if((err = createHardLink(dirs, rel, e.linkTarget, dest, root, verbosity)) != 0) {
+                break;
+            }
+        }
+
+        else if((err = placeFile(dirFd, leaf, e, dest, durability, rel, counts)) != 0) {
+            if(err == STORE_MISS && verbosity >= 3) {
+                printf("The store lost part of %s. Extracting it instead\n",pkgName.c_str());
+            }
+
+            break;
+        }
+
+        if(durability != NULL) {
+            durability->entryCreated(rel);
+        }
+
+        if(verbosity >= 4) {
+            printf("Extracted %s\n",dest.c_str());
+        }
+    }
+
+    if(err == 0) {
+        applyDirModes(dirs, dirModes);
+
+        // The collector drops the packages used longest ago first
+        utimensat(pkgsFd, pkgName.c_str(), NULL, 0);
+
+        if(verbosity >= 3) {
+            printf("Installed %s from the store: %lu files cloned, %lu hard linked, %lu copied\n",pkgName.c_str(),counts[STORE_COUNT_CLONED],counts[STORE_COUNT_LINKED],counts[STORE_COUNT_COPIED]);
+        }
+    }
+
+    close(lockFd);
+    return (err == 0) ? ARCHIVE_EOF : err;
+}/*}}}*/
+
+/**
+ * Adds a package which was just extracted into root to the store
+ *
+ * The files are read back from root, rather than from the tarball, so compressed packages aren't decoded a second time. This has to happen before anything, such as a post-install script, changes them.
+ * Packages with members only libarchive can restore (devices, FIFOs, xattrs, ACLs, sparse files) aren't stored, and are always extracted.
+ *
+ * @param [in] std::string tarPath
+ * @param [in] std::string pkgName
+ * @param [in] const std::vector<tarMember_s>& members As read from the tarball
+ * @param [in] std::string root
+ * @param [in] const ExclusionMatcher& exclusions The exclusions the package was extracted with
+ *
+ * @returns int 0 on success, STORE_MISS if the package can't be stored, or a negative error code
+ */
+int ContentStore::populate(std::string tarPath, std::string pkgName, const std::vector<tarMember_s>& members, std::string root, const ExclusionMatcher& exclusions) {/*{{{*/
+    struct stat tarStat;
+    if(!isOpen() || members.empty() || stat(tarPath.c_str(), &tarStat) != 0) {
+        return STORE_MISS;
+    }
+
+    // Only the last regular file at a path survives extraction, so that's the only one we can read back
+    std::unordered_map<std::string, size_t> lastFile;
+    for(size_t index = 0; index < members.size(); index++) {
+        if(members[index].needsFallback || !isSafeMemberPath(members[index].path)) {
+            if(verbosity >= 3) {
+                printf("%s has members only libarchive can restore, and won't be added to the store\n",pkgName.c_str());
+            }
+
+            return STORE_MISS;
+        }
+
+        if(isRegularTarType(members[index].type)) {
+            lastFile[canonicalMemberPath(members[index].path)] = index;
+        }
+    }
+
+    DirFdCache dirs(root, 0);
+    if(!dirs.isOpen()) {
+        return STORE_MISS;
+    }
+
+    int lockFd = lockStore(LOCK_SH);
+    if(lockFd < 0) {
+        return STORE_OPEN_ERROR;
+    }
+
+    std::vector<storeEntry_s> entries;
+    entries.reserve(members.size());
+    unsigned long added = 0;
+    int err = 0;
+
+    for(size_t index = 0; index < members.size() && err == 0; index++) {
+        const tarMember_s& m = members[index];
+        std::string rel = canonicalMemberPath(m.path);
+        bool regular = isRegularTarType(m.type);
+
+        if(regular && lastFile[rel] != index) {
+            continue;
+        }
+
+        storeEntry_s e;
+        e.path = m.path;
+        e.linkTarget = m.linkTarget;
+        e.type = regular ? TAR_TYPE_REGULAR : m.type;
+        e.mode = m.mode;
+        e.size = regular ? m.size : 0;
+
+        if(exclusions.matches(m.path) || (m.type == TAR_TYPE_HARDLINK && exclusions.matches(m.linkTarget))) {
+            e.flags |= STORE_ENTRY_ABSENT;
+            entries.push_back(e);
+            continue;
+        }
+
+        if(regular && !rel.empty()) {
+            std::string leaf;
+            int dirFd = dirs.parentFd(rel, leaf, false);
+            int fd = (dirFd >= 0) ? openat(dirFd, leaf.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC) : -1;
+
+            // Something other than the package put a different file there
+            struct stat st;
+            if(fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size != m.size || !sha256File(fd, m.size, e.hash)) {
+                if(verbosity >= 3) {
+                    printf("Could not read back %s/%s, so %s won't be added to the store\n",root.c_str(),rel.c_str(),pkgName.c_str());
+                }
+
+                err = STORE_MISS;
+            }
+
+            else {
+                struct stat objStat;
+                bool existed = fstatat(objectsFd, storeObjectName(e.hash, e.mode).c_str(), &objStat, AT_SYMLINK_NOFOLLOW) == 0;
+
+                if((err = addObject(fd, e.hash, e.mode, m.size)) != 0 && verbosity != 0) {
+                    fprintf(stderr,"Error: Could not add %s to the package store. %s\n",rel.c_str(),strerror(errno));
+                }
+
+                added += existed ? 0 : 1;
+            }
+
+            if(fd >= 0) {
+                close(fd);
+            }
+        }
+
+        entries.push_back(e);
+    }
+
+    if(err == 0 && !writeIndex(pkgName, entries, tarStat)) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not write the store's index of %s. %s\n",pkgName.c_str(),strerror(errno));
+        }
+
+        err = STORE_INDEX_ERROR;
+    }
+
+    if(err == 0 && verbosity >= 3) {
+        printf("Added %s to the store, with %lu new objects\n",pkgName.c_str(),added);
+    }
+
+    close(lockFd);
+    return err;
+}/*}}}*/
+
+/**
+ * Shrinks the store back under its cap
+ *
+ * The packages used longest ago are dropped first, by the modification time of their index, which every install from the store refreshes. Objects are deleted once no remaining package uses them.
+ * Anything left under tmp by an install which died is removed too.
+ *
+ * @returns int 0 on success, or a negative error code
+ */
+int ContentStore::collectGarbage() {/*{{{*/
+    if(!isOpen()) {
+        return STORE_OPEN_ERROR;
+    }
+
+    int lockFd = lockStore(LOCK_EX);
+    if(lockFd < 0) {
+        return STORE_OPEN_ERROR;
+    }
+
+    // Nobody else holds the lock, so nothing under tmp is still being written
+    int dupFd = fcntl(tmpFd, F_DUPFD_CLOEXEC, 0);
+    DIR* dir = (dupFd >= 0) ? fdopendir(dupFd) : NULL;
+    if(dir != NULL) {
+        struct dirent* ent;
+        while((ent = readdir(dir)) != NULL) {
+            if(strcmp(ent->d_name, ".") != 0 && strcmp(ent->d_name, "..") != 0) {
+                unlinkat(tmpFd, ent->d_name, 0);
+            }
+        }
+
+        closedir(dir);
+    }
+
+    if(maxBytes == 0) {
+        close(lockFd);
+        return 0;
+    }
+
+    // Every object, and how big it is
+    std::unordered_map<std::string, unsigned long long> objects;
+    unsigned long long total = 0;
+
+    dupFd = fcntl(objectsFd, F_DUPFD_CLOEXEC, 0);
+    dir = (dupFd >= 0) ? fdopendir(dupFd) : NULL;
+    if(dir != NULL) {
+        struct dirent* ent;
+        while((ent = readdir(dir)) != NULL) {
+            if(ent->d_name[0] == '.') {
+                continue;
+            }
+
+            int subFd = openat(objectsFd, ent->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            DIR* sub = (subFd >= 0) ? fdopendir(subFd) : NULL;
+            if(sub == NULL) {
+                continue;
+            }
+
+            struct dirent* obj;
+            while((obj = readdir(sub)) != NULL) {
+                struct stat st;
+                if(obj->d_name[0] != '.' && fstatat(subFd, obj->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+                    objects[std::string(ent->d_name) + "/" + obj->d_name] = st.st_size;
+                    total += st.st_size;
+                }
+            }
+
+            closedir(sub);
+        }
+
+        closedir(dir);
+    }
+
+    if(total <= maxBytes) {
+        close(lockFd);
+        return 0;
+    }
+
+    // Every package, oldest first, and how many packages use each object
+    std::vector<std::pair<struct timespec, std::string>> pkgs;
+    std::unordered_map<std::string, std::vector<std::string>> pkgObjects;
+    std::unordered_map<std::string, unsigned int> refs;
+
+    dupFd = fcntl(pkgsFd, F_DUPFD_CLOEXEC, 0);
+    dir = (dupFd >= 0) ? fdopendir(dupFd) : NULL;
+    if(dir != NULL) {
+        struct dirent* ent;
+        while((ent = readdir(dir)) != NULL) {
+            struct stat st;
+            if(ent->d_name[0] == '.' || fstatat(pkgsFd, ent->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                continue;
+            }
+
+            std::vector<storeEntry_s> entries;
+            std::vector<std::string>& used = pkgObjects[ent->d_name];
+
+            // An unreadable index protects nothing, and is dropped first
+            if(!readIndex(ent->d_name, entries, NULL, NULL)) {
+                st.st_mtim.tv_sec = 0;
+                st.st_mtim.tv_nsec = 0;
+            }
+
+            for(const storeEntry_s& e : entries) {
+                if(!e.hash.empty()) {
+                    used.push_back(storeObjectName(e.hash, e.mode));
+                }
+            }
+
+            std::sort(used.begin(), used.end());
+            used.erase(std::unique(used.begin(), used.end()), used.end());
+
+            for(const std::string& name : used) {
+                refs[name]++;
+            }
+
+            pkgs.push_back(std::pair<struct timespec, std::string>(st.st_mtim, ent->d_name));
+        }
+
+        closedir(dir);
+    }
+
+    std::sort(pkgs.begin(), pkgs.end(), [](const std::pair<struct timespec, std::string>& a, const std::pair<struct timespec, std::string>& b) {
+        return (a.first.tv_sec != b.first.tv_sec) ? (a.first.tv_sec < b.first.tv_sec) : (a.first.tv_nsec < b.first.tv_nsec);
+    });
+
+    unsigned long droppedPkgs = 0;
+    unsigned long droppedObjects = 0;
+    unsigned long long freed = 0;
+
+    // Objects no package uses at all go first
+    for(auto& obj : objects) {
+        if(refs.find(obj.first) == refs.end() && unlinkat(objectsFd, obj.first.c_str(), 0) == 0) {
+            total -= obj.second;
+            freed += obj.second;
+            droppedObjects++;
+        }
+    }
+
+    for(size_t index = 0; index < pkgs.size() && total > maxBytes; index++) {
+        if(unlinkat(pkgsFd, pkgs[index].second.c_str(), 0) != 0) {
+            continue;
+        }
+
+        droppedPkgs++;
+
+        for(const std::string& name : pkgObjects[pkgs[index].second]) {
+            if(--refs[name] != 0) {
+                continue;
+            }
+
+            auto it = objects.find(name);
+            if(it != objects.end() && unlinkat(objectsFd, name.c_str(), 0) == 0) {
+                total -= it->second;
+                freed += it->second;
+                droppedObjects++;
+            }
+        }
+    }
+
+    if(verbosity >= 3) {
+        printf("Dropped %lu packages and %lu objects (%llu bytes) from the store, which now holds %llu bytes\n",droppedPkgs,droppedObjects,freed,total);
+    }
+
+    close(lockFd);
+    return 0;
+}/*}}}*/
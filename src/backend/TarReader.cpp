@@ -0,0 +1,484 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file TarReader.cpp
+ * @error -600
+ *
+ * A small tar header walker which never reads member data. libarchive hides where each member's data lives inside the archive, but the zero-copy extraction engine needs exactly that, so this reads the headers itself.
+ * It understands ustar, GNU long names, and pax local headers. Anything it can't account for is either marked for libarchive (needsFallback), or the whole archive is reported as TAR_UNSUPPORTED.
+ */
+
+#include "TarReader.h"
+
+/**
+ * Parses a numeric tar header field
+ * Handles both the usual octal representation and the GNU base-256 extension used for large values
+ *
+ * @param [in] const char* field
+ * @param [in] size_t len
+ *
+ * @returns long long value, or -1 if a base-256 value doesn't fit
+ */
+long long parseTarNumber(const char* field, size_t len) {/*{{{*/
+    const unsigned char* f = (const unsigned char*)field;
+
+    // Base-256; The first byte carries the sign and the high bits
+    // A negative value is two's complement, so its bytes are flipped to read its magnitude, less one
+    if(f[0] & 0x80) {
+        unsigned char flip = (f[0] & 0x40) ? 0xff : 0;
+        uint64_t val = (f[0] ^ flip) & 0x3f;
+
+        for(size_t index = 1; index < len; index++) {
+            if(val > ((uint64_t)LLONG_MAX >> 8)) {
+                return -1;
+            }
+
+            val = (val << 8) | (unsigned char)(f[index] ^ flip);
+        }
+
+        return flip ? -(long long)val - 1 : (long long)val;
+    }
+
+    long long val = 0;
+    size_t index = 0;
+
+    // Leading spaces and NULs are allowed
+    while(index < len && (f[index] == ' ' || f[index] == '\0')) {
+        index++;
+    }
+
+    while(index < len && f[index] >= '0' && f[index] <= '7') {
+        val = (val << 3) | (f[index] - '0');
+        index++;
+    }
+
+    return val;
+}/*}}}*/
+
+/**
+ * Copies a header string field, which may or may not be NUL-terminated
+ *
+ * @param [in] const char* field
+ * @param [in] size_t len
+ *
+ * @returns std::string fieldString
+ */
+std::string tarString(const char* field, size_t len) {/*{{{*/
+    size_t strLen = 0;
+    while(strLen < len && field[strLen] != '\0') {
+        strLen++;
+    }
+
+    return std::string(field, strLen);
+}/*}}}*/
+
+/**
+ * Verifies the checksum of a 512 byte header block
+ * Some old implementations summed signed chars, so both are accepted
+ *
+ * @param [in] const char* block
+ *
+ * @returns bool isChecksumValid
+ */
+bool isValidTarHeader(const char* block) {/*{{{*/
+    long long expected = parseTarNumber(block + 148, 8);
+    long long unsignedSum = 0;
+    long long signedSum = 0;
+
+    for(int index = 0; index < TAR_BLOCKSIZE; index++) {
+        // The checksum field itself counts as spaces
+        char c = (index >= 148 && index < 156) ? ' ' : block[index];
+        unsignedSum += (unsigned char)c;
+        signedSum += (signed char)c;
+    }
+
+    return (expected == unsignedSum) || (expected == signedSum);
+}/*}}}*/
+
+/**
+ * Checks whether or not a block is entirely zeroes, which marks the end of the archive
+ *
+ * @param [in] const char* block
+ *
+ * @returns bool isZeroBlock
+ */
+static bool isZeroBlock(const char* block) {/*{{{*/
+    for(int index = 0; index < TAR_BLOCKSIZE; index++) {
+        if(block[index] != '\0') {
+            return false;
+        }
+    }
+
+    return true;
+}/*}}}*/
+
+/**
+ * Reads a byte range of the archive in full
+ *
+ * @param [in] int fd
+ * @param [in] off_t offset
+ * @param [in] off_t size
+ * @param [out] std::string& data
+ *
+ * @returns bool success
+ */
+bool readTarRange(int fd, off_t offset, off_t size, std::string& data) {/*{{{*/
+    data.resize(size);
+    off_t done = 0;
+
+    while(done < size) {
+        ssize_t r = pread(fd, &data[done], size - done, offset + done);
+        if(r < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if(r <= 0) {
+            return false;
+        }
+
+        done += r;
+    }
+
+    return true;
+}/*}}}*/
+
+/**
+ * Reads a member's data section in full. Only used for the (small) extension headers
+ *
+ * @param [in] int fd
+ * @param [in] off_t offset
+ * @param [in] off_t size
+ * @param [out] std::string& data
+ *
+ * @returns bool success
+ */
+static bool readTarData(int fd, off_t offset, off_t size, std::string& data) {/*{{{*/
+    if(!readTarRange(fd, offset, size, data)) {
+        return false;
+    }
+
+    // GNU long names are NUL-terminated within their data
+    size_t nul = data.find('\0');
+    if(nul != std::string::npos) {
+        data.resize(nul);
+    }
+
+    return true;
+}/*}}}*/
+
+/**
+ * Checks whether or not the file behind the descriptor starts with a valid, uncompressed tar header
+ * Compressed archives fail the checksum, so this doubles as our compression check
+ *
+ * @param [in] int fd
+ *
+ * @returns bool isPlainTar
+ */
+bool isPlainTar(int fd) {/*{{{*/
+    char block[TAR_BLOCKSIZE];
+
+    if(pread(fd, block, TAR_BLOCKSIZE, 0) != TAR_BLOCKSIZE) {
+        return false;
+    }
+
+    return !isZeroBlock(block) && isValidTarHeader(block);
+}/*}}}*/
+
+/**
+ * Whether or not the walker knows where a member of this type keeps its data
+ * Devices and FIFOs have none, and are left to libarchive member by member. Anything else means the whole archive is
+ *
+ * @param [in] char type
+ *
+ * @returns bool isKnown
+ */
+static bool isKnownTarType(char type) {/*{{{*/
+    switch(type) {
+        case TAR_TYPE_REGULAR:
+        case TAR_TYPE_REGULAR_OLD:
+        case TAR_TYPE_CONTIGUOUS:
+        case TAR_TYPE_HARDLINK:
+        case TAR_TYPE_SYMLINK:
+        case TAR_TYPE_CHAR:
+        case TAR_TYPE_BLOCK:
+        case TAR_TYPE_DIRECTORY:
+        case TAR_TYPE_FIFO:
+            return true;
+        default:
+            return false;
+    }
+}/*}}}*/
+
+/**
+ * Whether or not the typeflag describes a plain file with contiguous data
+ *
+ * @param [in] char type
+ *
+ * @returns bool isRegular
+ */
+bool isRegularTarType(char type) {/*{{{*/
+    return type == TAR_TYPE_REGULAR || type == TAR_TYPE_REGULAR_OLD || type == TAR_TYPE_CONTIGUOUS;
+}/*}}}*/
+
+/**
+ * Strips the decorations tar leaves on member paths, so "./usr/bin/", "/usr/bin" and "usr/bin" all compare equal
+ *
+ * @param [in] std::string path
+ *
+ * @returns std::string normalizedPath
+ */
+std::string normalizeMemberPath(std::string path) {/*{{{*/
+    size_t start = 0;
+    while(start < path.size() && (path[start] == '/' || path.compare(start, 2, "./") == 0)) {
+        start += (path[start] == '/') ? 1 : 2;
+    }
+
+    size_t end = path.size();
+    while(end > start && path[end - 1] == '/') {
+        end--;
+    }
+
+    return path.substr(start, end - start);
+}/*}}}*/
+
+/**
+ * Walks every header in an uncompressed tar archive, and records each member along with where its data lives
+ * Only the headers (and any extension headers) are read; The data of regular files is never touched
+ *
+ * @param [in] int fd
+ * @param [out] std::vector<tarMember_s>& members
+ * @param [in] unsigned int verbosity
+ *
+ * @returns int 0 on success, TAR_UNSUPPORTED if libarchive needs to handle the whole archive, or another negative value on error
+ */
+int readTarMembers(int fd, std::vector<tarMember_s>& members, unsigned int verbosity) {/*{{{*/
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not stat the archive while reading its headers. %s\n",strerror(errno));
+        }
+
+        return -602;
+    }
+
+    char block[TAR_BLOCKSIZE];
+    off_t offset = 0;
+    off_t entryStart = -1;
+
+    // Extension header state, which applies to the next real header
+    std::string longName;
+    std::string longLink;
+    std::string paxPath;
+    std::string paxLink;
+    long long paxSize = -1;
+    long long paxUid = -1;
+    long long paxGid = -1;
+    long long paxMtime = -1;
+    bool paxFallback = false;
+
+    while(true) {
+        ssize_t r = pread(fd, block, TAR_BLOCKSIZE, offset);
+
+        // Some writers leave off the end-of-archive marker
+        if(r == 0) {
+            break;
+        }
+
+        if(r != TAR_BLOCKSIZE) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: The archive is truncated at offset %lld.\n",(long long)offset);
+            }
+
+            return -603;
+        }
+
+        if(isZeroBlock(block)) {
+            break;
+        }
+
+        if(!isValidTarHeader(block)) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: Invalid tar header checksum at offset %lld.\n",(long long)offset);
+            }
+
+            return -604;
+        }
+
+        if(entryStart < 0) {
+            entryStart = offset;
+        }
+
+        char type = block[156];
+        off_t size = parseTarNumber(block + 124, 12);
+        off_t dataOffset = offset + TAR_BLOCKSIZE;
+
+        // Extension headers; Record them, and move on to the header they describe
+        if(type == TAR_TYPE_GNU_LONGNAME || type == TAR_TYPE_GNU_LONGLINK || type == TAR_TYPE_PAX_LOCAL) {
+            std::string data;
+            if(size < 0 || dataOffset + size > st.st_size || !readTarData(fd, dataOffset, size, data)) {
+                if(verbosity != 0) {
+                    fprintf(stderr,"Error: The extension header at offset %lld is truncated.\n",(long long)offset);
+                }
+
+                return -603;
+            }
+
+            if(type == TAR_TYPE_GNU_LONGNAME) {
+                longName = data;
+            }
+
+            else if(type == TAR_TYPE_GNU_LONGLINK) {
+                longLink = data;
+            }
+
+            // pax records look like "%d %s=%s\n", where the leading number is the length of the whole record
+            else {
+                // readTarData stops at a NUL, which pax values may not contain anyway
+                size_t pos = 0;
+                while(pos < data.size()) {
+                    size_t space = data.find(' ', pos);
+                    if(space == std::string::npos) {
+                        break;
+                    }
+
+                    long long recLen = atoll(data.substr(pos, space - pos).c_str());
+                    if(recLen <= 0 || pos + recLen > data.size()) {
+                        break;
+                    }
+
+                    std::string record = data.substr(space + 1, pos + recLen - space - 2);
+                    size_t eq = record.find('=');
+                    if(eq != std::string::npos) {
+                        std::string key = record.substr(0, eq);
+                        std::string val = record.substr(eq + 1);
+
+                        if(key == "path") {
+                            paxPath = val;
+                        }
+                        else if(key == "linkpath") {
+                            paxLink = val;
+                        }
+                        else if(key == "size") {
+                            paxSize = atoll(val.c_str());
+                        }
+                        else if(key == "uid") {
+                            paxUid = atoll(val.c_str());
+                        }
+                        else if(key == "gid") {
+                            paxGid = atoll(val.c_str());
+                        }
+                        else if(key == "mtime") {
+                            paxMtime = atoll(val.c_str());
+                        }
+                        // A sparse file in the 1.0 format keeps its real name here, and a made up one in its header
+                        else if(key == "GNU.sparse.name") {
+                            paxPath = val;
+                            paxFallback = true;
+                        }
+                        else if(key.compare(0, 6, "SCHILY") == 0 || key.compare(0, 10, "LIBARCHIVE") == 0 || key.compare(0, 10, "GNU.sparse") == 0) {
+                            // xattrs, ACLs, file flags and sparse maps are libarchive's job
+                            paxFallback = true;
+                        }
+                    }
+
+                    pos += recLen;
+                }
+            }
+
+            offset = dataOffset + ((size + TAR_BLOCKSIZE - 1) / TAR_BLOCKSIZE) * TAR_BLOCKSIZE;
+            continue;
+        }
+
+        // Global headers change every header after them, which we don't track
+        if(type == TAR_TYPE_PAX_GLOBAL) {
+            if(verbosity >= 4) {
+                printf("Found a pax global header at offset %lld. Leaving the archive to libarchive.\n",(long long)offset);
+            }
+
+            return TAR_UNSUPPORTED;
+        }
+
+        // Anything else, such as GNU sparse members and dumpdirs, lays its data out in ways we don't track. Guessing would have us read data as headers
+        if(!isKnownTarType(type)) {
+            if(verbosity >= 4) {
+                printf("Found a member of type '%c' at offset %lld. Leaving the archive to libarchive.\n",type,(long long)offset);
+            }
+
+            return TAR_UNSUPPORTED;
+        }
+
+        tarMember_s m;
+        m.type = type;
+        m.headerOffset = entryStart;
+        m.dataOffset = dataOffset;
+        m.mode = parseTarNumber(block + 100, 8) & 07777;
+        m.uid = (paxUid >= 0) ? paxUid : parseTarNumber(block + 108, 8);
+        m.gid = (paxGid >= 0) ? paxGid : parseTarNumber(block + 116, 8);
+        m.mtime = (paxMtime >= 0) ? paxMtime : parseTarNumber(block + 136, 12);
+        m.size = (paxSize >= 0) ? paxSize : size;
+
+        if(!paxPath.empty()) {
+            m.path = paxPath;
+        }
+        else if(!longName.empty()) {
+            m.path = longName;
+        }
+        else {
+            m.path = tarString(block, 100);
+
+            // POSIX ustar splits long paths into a prefix. GNU uses the same bytes for other things, hence the magic check
+            if(memcmp(block + 257, "ustar\0", 6) == 0 && block[345] != '\0') {
+                m.path = tarString(block + 345, 155) + "/" + m.path;
+            }
+        }
+
+        if(!paxLink.empty()) {
+            m.linkTarget = paxLink;
+        }
+        else if(!longLink.empty()) {
+            m.linkTarget = longLink;
+        }
+        else {
+            m.linkTarget = tarString(block + 157, 100);
+        }
+
+        // Only regular files (and hardlinks, which may carry data in pax archives) take up space after the header
+        off_t dataSize = m.size;
+        if(!isRegularTarType(type) && type != TAR_TYPE_HARDLINK) {
+            dataSize = 0;
+            m.size = 0;
+        }
+
+        if(dataSize < 0 || dataOffset + dataSize > st.st_size) {
+            if(verbosity != 0) {
+                fprintf(stderr,"Error: The member %s claims more data than the archive holds.\n",m.path.c_str());
+            }
+
+            return -603;
+        }
+
+        // Hardlinks with data attached are rare enough to leave to libarchive
+        m.needsFallback = paxFallback || !(isRegularTarType(type) || type == TAR_TYPE_HARDLINK || type == TAR_TYPE_SYMLINK || type == TAR_TYPE_DIRECTORY);
+        m.needsFallback = m.needsFallback || (type == TAR_TYPE_HARDLINK && m.size > 0);
+
+        members.push_back(m);
+
+        // Reset our extension state for the next member
+        longName.clear();
+        longLink.clear();
+        paxPath.clear();
+        paxLink.clear();
+        paxSize = paxUid = paxGid = paxMtime = -1;
+        paxFallback = false;
+        entryStart = -1;
+
+        offset = dataOffset + ((dataSize + TAR_BLOCKSIZE - 1) / TAR_BLOCKSIZE) * TAR_BLOCKSIZE;
+    }
+
+    if(verbosity >= 4) {
+        printf("Read %lu tar headers\n",members.size());
+    }
+
+    return 0;
+}/*}}}*/
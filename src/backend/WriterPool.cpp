@@ -0,0 +1,323 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file WriterPool.cpp
+ * @error -1500
+ *
+ * The threads which write out regular files while a single thread reads the archive. See WriterPool.h.
+ */
+
+#include "WriterPool.h"
+#include "Extract.h"
+
+/**
+ * Writes all of buf to fd, retrying short writes
+ *
+ * @param [in] int fd
+ * @param [in] const char* buf
+ * @param [in] size_t len
+ *
+ * @returns bool wasEverythingWritten, with errno set if not
+ */
+bool writeBuffer(int fd, const char* buf, size_t len) {/*{{{*/
+    size_t done = 0;
+    while(done < len) {
+        ssize_t w = write(fd, buf + done, len - done);
+        if(w < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+
+            return false;
+        }
+
+        done += w;
+    }
+
+    return true;
+}/*}}}*/
+
+/**
+ * Restores the extended attributes libarchive found for a member
+ *
+ * @param [in] int fd
+ * @param [in] const std::vector<std::pair<std::string, std::string>>& xattrs Names and values
+ *
+ * @returns int 0 on success, or WRITER_XATTR_ERROR with errno set
+ */
+int restoreXattrs(int fd, const std::vector<std::pair<std::string, std::string>>& xattrs) {/*{{{*/
+    for(const auto& x : xattrs) {
+        if(fsetxattr(fd, x.first.c_str(), x.second.data(), x.second.size(), 0) != 0) {
+            return WRITER_XATTR_ERROR;
+        }
+    }
+
+    return 0;
+}/*}}}*/
+
+/**
+ * Starts the writer threads
+ *
+ * @param [in] unsigned int writers
+ * @param [in] unsigned int verbosity
+ * @param [in] WritebackTracker* durability If not NULL, each file is handed to it once written, instead of closed
+ */
+WriterPool::WriterPool(unsigned int writers, unsigned int verbosity, WritebackTracker* durability) {/*{{{*/
+    if(writers < 1) {
+        writers = 1;
+    }
+
+    this->verbosity = verbosity;
+    this->durability = durability;
+    maxJobs = writers * WRITER_JOBS_PER_THREAD;
+    maxBuffers = writers * WRITER_BUFFERS_PER_THREAD;
+
+    for(unsigned int index = 0; index < writers; index++) {
+        threads.emplace_back(&WriterPool::work, this);
+    }
+}/*}}}*/
+
+/**
+ * Lets the writers finish whatever is still queued, then stops them
+ */
+WriterPool::~WriterPool() {/*{{{*/
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+
+    workReady.notify_all();
+
+    for(std::thread& t : threads) {
+        t.join();
+    }
+
+    for(char* buf : buffers) {
+        free(buf);
+    }
+}/*}}}*/
+
+/**
+ * Takes a data buffer of WRITER_BUFFER_SIZE bytes from the pool, waiting for a writer to give one back if they are all in use
+ * A single file must never hold more than half of getMaxBuffers() at once, or the decoder could wait on itself
+ *
+ * @returns char* buf, or NULL if it could not be allocated
+ */
+char* WriterPool::acquireBuffer() {/*{{{*/
+    std::unique_lock<std::mutex> guard(lock);
+    bufferFree.wait(guard, [this] { return !freeBuffers.empty() || buffers.size() < maxBuffers; });
+
+    if(!freeBuffers.empty()) {
+        char* buf = freeBuffers.back();
+        freeBuffers.pop_back();
+        return buf;
+    }
+
+    char* buf = (char*)malloc(WRITER_BUFFER_SIZE);
+    if(buf != NULL) {
+        buffers.push_back(buf);
+    }
+
+    return buf;
+}/*}}}*/
+
+/**
+ * Returns a buffer to the pool
+ *
+ * @param [in] char* buf
+ */
+void WriterPool::releaseBuffer(char* buf) {/*{{{*/
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        freeBuffers.push_back(buf);
+    }
+
+    bufferFree.notify_one();
+}/*}}}*/
+
+/**
+ * @returns size_t The most buffers the pool will hand out at once
+ */
+size_t WriterPool::getMaxBuffers() {/*{{{*/
+    return maxBuffers;
+}/*}}}*/
+
+/**
+ * @returns WritebackTracker* The tracker files written for this pool are handed to, or NULL
+ */
+WritebackTracker* WriterPool::getDurability() {/*{{{*/
+    return durability;
+}/*}}}*/
+
+/**
+ * Queues a file to be written, waiting for room in the queue if it's full
+ * The job is moved into the queue, and its path is in flight until it has been written
+ *
+ * @param [in] writeJob_s& job
+ */
+void WriterPool::submit(writeJob_s& job) {/*{{{*/
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        queueSpace.wait(guard, [this] { return queue.size() < maxJobs; });
+
+        inFlight[job.rel]++;
+        queue.push_back(std::move(job));
+    }
+
+    workReady.notify_one();
+}/*}}}*/
+
+/**
+ * Waits until no writer has anything left to do at a path
+ *
+ * @param [in] const std::string& rel A canonical path
+ */
+void WriterPool::waitForPath(const std::string& rel) {/*{{{*/
+    std::unique_lock<std::mutex> guard(lock);
+    jobDone.wait(guard, [this, &rel] { return inFlight.find(rel) == inFlight.end(); });
+}/*}}}*/
+
+/**
+ * Waits until every queued file has been written
+ *
+ * @returns int 0, or the error of the first file which could not be written
+ */
+int WriterPool::drain() {/*{{{*/
+    std::unique_lock<std::mutex> guard(lock);
+    jobDone.wait(guard, [this] { return queue.empty() && active == 0; });
+
+    return error;
+}/*}}}*/
+
+/**
+ * @returns int 0, or the error of the first file which could not be written
+ */
+int WriterPool::getError() {/*{{{*/
+    std::lock_guard<std::mutex> guard(lock);
+    return error;
+}/*}}}*/
+
+/**
+ * @returns unsigned long filesWritten
+ */
+unsigned long WriterPool::getFilesWritten() {/*{{{*/
+    std::lock_guard<std::mutex> guard(lock);
+    return filesWritten;
+}/*}}}*/
+
+/**
+ * @returns unsigned long long bytesWritten
+ */
+unsigned long long WriterPool::getBytesWritten() {/*{{{*/
+    std::lock_guard<std::mutex> guard(lock);
+    return bytesWritten;
+}/*}}}*/
+
+/**
+ * The loop each writer thread runs
+ * Once any file has failed, the rest of the queue is only emptied, not written, so the decoder can't block on it
+ */
+void WriterPool::work() {/*{{{*/
+    std::unique_lock<std::mutex> guard(lock);
+
+    while(true) {
+        workReady.wait(guard, [this] { return stopping || !queue.empty(); });
+        if(queue.empty()) {
+            return;
+        }
+
+        writeJob_s job = std::move(queue.front());
+        queue.pop_front();
+        active++;
+        bool skip = (error != 0);
+
+        guard.unlock();
+        queueSpace.notify_one();
+
+        int res = skip ? 0 : writeFile(job);
+        close(job.dirFd);
+
+        guard.lock();
+
+        for(auto& chunk : job.chunks) {
+            freeBuffers.push_back(chunk.first);
+        }
+
+        if(res != 0 && error == 0) {
+            error = res;
+        }
+
+        else if(res == 0 && !skip) {
+            filesWritten++;
+            bytesWritten += job.size;
+        }
+
+        auto it = inFlight.find(job.rel);
+        if(it != inFlight.end() && --it->second == 0) {
+            inFlight.erase(it);
+        }
+
+        active--;
+
+        bufferFree.notify_all();
+        jobDone.notify_all();
+    }
+}/*}}}*/
+
+/**
+ * Creates a file and fills in its data, permissions and extended attributes
+ *
+ * @param [in] writeJob_s& job
+ *
+ * @returns int 0 on success, or a negative error code
+ */
+int WriterPool::writeFile(writeJob_s& job) {/*{{{*/
+    int fd = createMemberFile(job.dirFd, job.leaf);
+    if(fd < 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not create the file %s. %s\n",job.dest.c_str(),strerror(errno));
+        }
+
+        return WRITER_CREATE_ERROR;
+    }
+
+    bool written = true;
+    if(job.srcFd >= 0) {
+        written = (copyFileData(job.srcFd, job.srcOffset, fd, job.size) == job.size);
+    }
+
+    else {
+        for(size_t index = 0; index < job.chunks.size() && written; index++) {
+            written = writeBuffer(fd, job.chunks[index].first, job.chunks[index].second);
+        }
+    }
+
+    if(!written) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not write the contents of %s. %s\n",job.dest.c_str(),strerror(errno));
+        }
+
+        close(fd);
+        return WRITER_WRITE_ERROR;
+    }
+
+    if(restoreXattrs(fd, job.xattrs) != 0) {
+        if(verbosity != 0) {
+            fprintf(stderr,"Error: Could not restore the extended attributes of %s. %s\n",job.dest.c_str(),strerror(errno));
+        }
+
+        close(fd);
+        return WRITER_XATTR_ERROR;
+    }
+
+    // ARCHIVE_EXTRACT_PERM restores the full mode, ignoring the umask
+    fchmod(fd, job.mode);
+    closeWritten(durability, fd, job.rel);
+
+    if(verbosity >= 4) {
+        printf("Extracted %s\n",job.dest.c_str());
+    }
+
+    return 0;
+}/*}}}*/
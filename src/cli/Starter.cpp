@@ -19,12 +19,13 @@
 #include "Options.h"
 #include "Config.h"
 #include "Pkg.h"
-
-// @TODO Remove this, check for the stem, NOT the full name, since we can't guarentee that they'll just be tars
-#define DEFAULT_EXTENSION ".tar"
+#include "Pipeline.h"
+#include "Prefetch.h"
+#include "PkgExtract.h"
+#include "PkgBuild.h"
+#include "Search.h"
 
 // @TODO See if I can move this to a header file
-// @TODO Add an exclusions option
 // @TODO Add a smart option
 struct option getopt_options[] =
 {
@@ -35,6 +36,21 @@ struct option getopt_options[] =
     { "package-library",        required_argument,  0,  'l' },
     { "installed-pkg-library",  required_argument,  0,  'i' },
     { "mode",                   required_argument,  0,  'm' },
+    { "jobs",                   required_argument,  0,  'j' },
+    { "writers",                required_argument,  0,  'w' },
+    { "exclude",                required_argument,  0,  'x' },
+    { "quarantine",             no_argument,        0,  'q' },
+    { "staged",                 no_argument,        0,  't' },
+    { "durability",             required_argument,  0,  'd' },
+    { "store",                  required_argument,  0,  'c' },
+    { "store-hardlinks",        no_argument,        0,  'k' },
+    { "store-size",             required_argument,  0,  'z' },
+    { "fanout-root",            required_argument,  0,  'r' },
+    { "prefetch-depth",         required_argument,  0,  'p' },
+    { "prefetch-size",          required_argument,  0,  'b' },
+    { "output",                 required_argument,  0,  'o' },
+    { "member-cache",           required_argument,  0,  'a' },
+    { "zstd",                   no_argument,        0,  'Z' },
     { "help",                   no_argument,        0,  'h' },
     { 0,                        0,                  0,  0   }
 };
@@ -42,6 +58,12 @@ struct option getopt_options[] =
 // Forward declaration of functions
 void printHelp();
 void parseOptions(Options& opts, char* argv[], int argc, char*& optarg, int& optind);
+void finishTransaction(Options& options);
+ContentStore* openStore(Options& options);
+void closeStore(ContentStore* store);
+std::string memberCacheDir(Options& options);
+int installFanout(std::vector<Pkg>& pkgs, Options& options, const ExclusionMatcher& exclusions, Prefetcher* prefetcher = NULL);
+bool isSameDir(const std::string& a, const std::string& b);
 
 int main(int argc, char* argv[]) {
 
@@ -122,15 +144,114 @@ int main(int argc, char* argv[]) {
 
     // Apply the config to our current options
     options.applyConfig(masterConfig);
-    
+
+    // The installed package database imports, then removes, the files it finds next to it. Sharing a directory with the tarballs would put them at risk
+    if(isSameDir(options.getInstalledPkgsPath(), options.getTarLibraryPath())) {
+        if(options.getVerbosity() != 0) {
+            fprintf(stderr,"Error: The installed package directory %s is the package library. Give them separate directories\n",options.getInstalledPkgsPath().c_str());
+        }
+
+        exit(-315);
+    }
+
+    // Fan-out installs read each tarball once for every root, which takes the place of the pipeline and the store. Nothing is staged either, so none of those may be asked for
+    if(options.getModeIndex() == INSTALL && !options.getFanoutRoots().empty()) {
+        std::string conflicts;
+        if(options.getStaged()) {
+            conflicts += " --staged";
+        }
+
+        if(!options.getStorePath().empty()) {
+            conflicts += " --store";
+        }
+
+        if(options.getJobs() > 1) {
+            conflicts += " --jobs";
+        }
+
+        if(!conflicts.empty()) {
+            if(options.getVerbosity() != 0) {
+                fprintf(stderr,"Error: --fanout-root can't be combined with:%s\n",conflicts.c_str());
+            }
+
+            exit(-317);
+        }
+    }
+
     switch(options.getModeIndex()) {
         case LIST_ALL:
-            listAllPkgs(options.getTarLibraryPath(), options.getVerbosity());
-            return 0;
+            {
+                MemberCache memberCache(memberCacheDir(options), options.getVerbosity());
+                listAllPkgs(options.getTarLibraryPath(), options.getVerbosity(), &memberCache);
+                return 0;
+            }
 
         case LIST_INSTALLED:
             listInstalledPkgs(options.getInstalledPkgsPath(), options.getVerbosity());
             return 0;
+
+        // The arguments are search terms rather than packages
+        case SEARCH:
+            if(argc <= optind) {
+                if(options.getVerbosity() != 0) {
+                    fprintf(stderr,"Error: The mode %s requires at least one search term\n",options.getModeStr().c_str());
+                }
+
+                exit(-308);
+            }
+
+            return (searchLibrary(std::vector<std::string>(argv + optind, argv + argc), options.getTarLibraryPath(), options.getInstalledPkgsPath(), options.getVerbosity()) == 0) ? 0 : -310;
+
+        // The arguments are paths rather than packages
+        case OWNER:
+            if(argc <= optind) {
+                if(options.getVerbosity() != 0) {
+                    fprintf(stderr,"Error: The mode %s requires at least one path\n",options.getModeStr().c_str());
+                }
+
+                exit(-308);
+            }
+
+            return listOwners(std::vector<std::string>(argv + optind, argv + argc), options.getSystemRoot(), options.getInstalledPkgsPath(), options.getVerbosity()) ? 0 : -309;
+
+        // The first argument is a package, and the rest are paths within it
+        case EXTRACT:
+            if(argc - optind < 2) {
+                if(options.getVerbosity() != 0) {
+                    fprintf(stderr,"Error: The mode %s requires a package, followed by at least one path within it\n",options.getModeStr().c_str());
+                }
+
+                exit(-308);
+            }
+
+            {
+                MemberCache memberCache(memberCacheDir(options), options.getVerbosity());
+                return (extractPkgMembers(findPkgTarball(options.getTarLibraryPath(), argv[optind]), std::vector<std::string>(argv + optind + 1, argv + argc), options.getOutputPath(), options.getVerbosity(), &memberCache) == 0) ? 0 : -313;
+            }
+
+        // The arguments are directories, each of which becomes a package
+        case BUILD:
+            if(argc <= optind) {
+                if(options.getVerbosity() != 0) {
+                    fprintf(stderr,"Error: The mode %s requires at least one directory to build a package from\n",options.getModeStr().c_str());
+                }
+
+                exit(-308);
+            }
+
+            {
+                // A package which can't be built doesn't stop the others
+                std::string outDir = options.getOutputPath().empty() ? options.getTarLibraryPath() : options.getOutputPath();
+                int res = 0;
+
+                for(int index = optind; index < argc; index++) {
+                    if(buildPkg(argv[index], outDir, options.getBuildZstd(), options.getVerbosity()) != 0) {
+                        res = -314;
+                    }
+                }
+
+                return res;
+            }
     }
 
     // Make sure there are packages listed
@@ -144,13 +265,61 @@ int main(int argc, char* argv[]) {
     std::vector<Pkg> pkgs;
     std::string tarLibrary = options.getTarLibraryPath();
 
+    // The packages only hold on to it, so it has to outlive all of them
+    MemberCache memberCache(memberCacheDir(options), options.getVerbosity());
+
     while (optind < argc) {
         // Build a list of packages which the user is requesting. By doing this, we can verify they all exist before moving forward, and risking breaking critical components if they require a dependency the user doesn't have or mistyped
         // Note that Pkg.cpp is what does the validation, not this class
-        pkgs.push_back(Pkg(std::string(tarLibrary + "/" + argv[optind] + DEFAULT_EXTENSION), options.getVerbosity()));
+        // Installed packages can be removed from their manifests, so their tarballs don't need to be around
+        if(options.getModeIndex() == UNINSTALL || options.getModeIndex() == UNFOLLOW) {
+            pkgs.push_back(Pkg(findPkgTarball(tarLibrary, argv[optind]), options.getVerbosity(), options.getInstalledPkgsPath(), &memberCache));
+        }
+
+        else {
+            pkgs.push_back(Pkg(findPkgTarball(tarLibrary, argv[optind]), options.getVerbosity(), "", &memberCache));
+        }
         optind++;
     }
 
+    // The exclusions are compiled once, and shared by every package. The package scripts are never installed as files
+    std::set<std::string> excludedFiles = options.getExcludedFiles();
+    addScriptsToExclusions(excludedFiles);
+
+    ExclusionMatcher exclusions(excludedFiles, options.getVerbosity());
+    if(!exclusions.isValid()) {
+        exit(-311);
+    }
+
+    // Only installs read the tarballs. While one package installs, the next ones' are read ahead
+    std::vector<std::string> tarPaths;
+    for(Pkg& p : pkgs) {
+        tarPaths.push_back(p.getPathname());
+    }
+
+    Prefetcher prefetcher(tarPaths, (options.getModeIndex() == INSTALL) ? options.getPrefetchDepth() : 0, options.getPrefetchSize() * 1024ULL * 1024ULL, options.getVerbosity());
+
+    // Every tarball is read once for all of the roots. That takes the place of the pipeline, and of the store
+    if(options.getModeIndex() == INSTALL && !options.getFanoutRoots().empty()) {
+        int res = installFanout(pkgs, options, exclusions, &prefetcher);
+        finishTransaction(options);
+        return (res == 0) ? 0 : -312;
+    }
+
+    ContentStore* store = (options.getModeIndex() == INSTALL) ? openStore(options) : NULL;
+
+    // Installing several packages can overlap their extraction. The pipeline keeps the scripts and the database updates in order
+    if(options.getModeIndex() == INSTALL && options.getJobs() > 1 && pkgs.size() > 1) {
+        int res = installPkgsPipelined(pkgs, options.getSystemRoot(), options.getInstalledPkgsPath(), options.getVerbosity(), exclusions, options.getSmartOperation(), options.getJobs(), options.getWriters(), options.getStaged(), options.getDurability(), store, &prefetcher);
+        if(res < 0 && options.getVerbosity() != 0) {
+            fprintf(stderr,"Error: %d package(s) could not be installed\n",-res);
+        }
+
+        finishTransaction(options);
+        closeStore(store);
+        return (res == 0) ? 0 : -316;
+    }
+
     for(int index = 0; index < pkgs.size(); index++) {
         int res = 0;
 
@@ -160,7 +329,10 @@ int main(int argc, char* argv[]) {
                     printf("Operation: install\nCurrent package: %s\n",pkgs[index].getPkgName().c_str());
                 }
 
-                res = pkgs[index].installPkgWithScripts(options.getSystemRoot(), options.getInstalledPkgsPath(), options.getVerbosity(), options.getExcludedFiles(), options.getSmartOperation());
+                prefetcher.start(index);
+                res = pkgs[index].installPkgWithScripts(options.getSystemRoot(), options.getInstalledPkgsPath(), options.getVerbosity(), exclusions, options.getSmartOperation(), options.getWriters(), options.getStaged(), options.getDurability(), store);
+                prefetcher.finish(index);
+
                 if(options.getVerbosity() == 4) {
                     fprintf(stderr,"Errno is %d\n",errno);
                     if(errno != 0) {
@@ -174,7 +346,7 @@ int main(int argc, char* argv[]) {
                     printf("Operation: uninstall\nCurrent package: %s\n",pkgs[index].getPkgName().c_str());
                 }
 
-                res = pkgs[index].uninstallPkgWithScripts(options.getSystemRoot(), options.getInstalledPkgsPath(), options.getVerbosity(), options.getExcludedFiles(), options.getSmartOperation());
+                res = pkgs[index].uninstallPkgWithScripts(options.getSystemRoot(), options.getInstalledPkgsPath(), options.getVerbosity(), exclusions, options.getSmartOperation(), options.getQuarantine());
                 if(options.getVerbosity() == 4) {
                     fprintf(stderr,"Errno is %d\n",errno);
                     if(errno != 0) {
@@ -210,6 +382,13 @@ int main(int argc, char* argv[]) {
                     }
                 }
 
+                break;
+            case INDEX:
+                if(options.getVerbosity() >= 3){ 
+                    printf("Operation: index\nCurrent package: %s\n",pkgs[index].getPkgName().c_str());
+                }
+
+                res = writePkgIndex(pkgs[index].getPathname(), options.getVerbosity());
                 break;
             default:
                 // Mode of operation is validated when set. This should never occur
@@ -217,13 +396,164 @@ int main(int argc, char* argv[]) {
                 break;
         }
     }
+
+    if(options.getModeIndex() == INSTALL) {
+        finishTransaction(options);
+        closeStore(store);
+    }
+}
+
+/**
+ * In the transaction durability mode, waits for everything installed to reach the disk, along with the database
+ * The other modes already waited for each package
+ */
+void finishTransaction(Options& options) {
+    if(options.getDurability() != DURABILITY_TRANSACTION) {
+        return;
+    }
+
+    double rootSeconds = 0;
+    double dbSeconds = 0;
+
+    // If both are on the same filesystem, the second sync has nothing left to write
+    syncRoot(options.getSystemRoot(), options.getVerbosity(), &rootSeconds);
+    syncRoot(options.getInstalledPkgsPath(), options.getVerbosity(), &dbSeconds);
+
+    if(options.getVerbosity() >= 3) {
+        printf("Waited %.3f seconds for the transaction to reach the disk (durability: transaction)\n",rootSeconds + dbSeconds);
+    }
+}
+
+/**
+ * Opens the package store, if there is one
+ * A store which can't be opened only costs us the speedup; Every package is extracted from its tarball instead
+ *
+ * @returns ContentStore* The store, or NULL
+ */
+ContentStore* openStore(Options& options) {
+    if(options.getStorePath().empty()) {
+        return NULL;
+    }
+
+    ContentStore* store = new ContentStore(options.getStorePath(), options.getStoreHardlinks(), options.getStoreSize() * 1024ULL * 1024ULL, options.getVerbosity());
+    if(!store->isOpen()) {
+        if(options.getVerbosity() != 0) {
+            fprintf(stderr,"Warning: Installing without the package store\n");
+        }
+
+        delete store;
+        return NULL;
+    }
+
+    return store;
+}
+
+/**
+ * Brings the package store back under its size limit, once nothing is being installed from it
+ */
+void closeStore(ContentStore* store) {
+    if(store == NULL) {
+        return;
+    }
+
+    store->collectGarbage();
+    delete store;
+}
+
+/**
+ * The member cache lives within the installed package database unless it was given a directory of its own, since the library may well be read-only
+ *
+ * @returns std::string The directory of the member cache
+ */
+std::string memberCacheDir(Options& options) {
+    if(options.getMemberCachePath().empty()) {
+        return options.getInstalledPkgsPath() + "/" + MEMBER_CACHE_DIRNAME;
+    }
+
+    return options.getMemberCachePath();
+}
+
+/**
+ * Installs every package into the system root and each of the fan-out roots, reading each tarball only once
+ * A root the package can't be installed into is reported, and the other roots carry on
+ *
+ * @param [in] Prefetcher* prefetcher If not NULL, told as each package starts and finishes
+ *
+ * @returns int The number of roots which failed to install at least one package
+ */
+int installFanout(std::vector<Pkg>& pkgs, Options& options, const ExclusionMatcher& exclusions, Prefetcher* prefetcher) {
+    std::vector<fanoutRoot_s> roots(1);
+    roots[0].root = options.getSystemRoot();
+    roots[0].installedPkgsPath = options.getInstalledPkgsPath();
+
+    for(const std::string& entry : options.getFanoutRoots()) {
+        fanoutRoot_s r;
+        size_t colon = entry.find(':');
+
+        // Without a database of its own, the root keeps one at the same place within itself
+        r.root = std::filesystem::absolute(entry.substr(0, colon));
+        r.installedPkgsPath = (colon != std::string::npos) ? std::string(std::filesystem::absolute(entry.substr(colon + 1))) : r.root + "/" + options.getInstalledPkgsPath();
+
+        std::error_code e;
+        std::filesystem::create_directories(r.installedPkgsPath, e);
+        roots.push_back(r);
+    }
+
+    if(options.getVerbosity() >= 3) {
+        printf("Installing %lu packages into %lu roots\n",pkgs.size(),roots.size());
+    }
+
+    for(size_t index = 0; index < pkgs.size(); index++) {
+        if(options.getVerbosity() >= 3) {
+            printf("Operation: install\nCurrent package: %s\n",pkgs[index].getPkgName().c_str());
+        }
+
+        if(prefetcher != NULL) {
+            prefetcher->start(index);
+        }
+
+        pkgs[index].installPkgFanout(roots, options.getVerbosity(), exclusions, options.getDurability());
+
+        if(prefetcher != NULL) {
+            prefetcher->finish(index);
+        }
+    }
+
+    int failures = 0;
+    for(const fanoutRoot_s& r : roots) {
+        if(options.getDurability() == DURABILITY_TRANSACTION && r.root != options.getSystemRoot()) {
+            syncRoot(r.root, options.getVerbosity(), NULL);
+            syncRoot(r.installedPkgsPath, options.getVerbosity(), NULL);
+        }
+
+        if(r.failed.empty()) {
+            if(options.getVerbosity() >= 2) {
+                printf("%s: %lu package(s) installed\n",r.root.c_str(),r.installed);
+            }
+
+            continue;
+        }
+
+        failures++;
+
+        if(options.getVerbosity() != 0) {
+            std::string names;
+            for(const std::string& name : r.failed) {
+                names += (names.empty() ? "" : ", ") + name;
+            }
+
+            fprintf(stderr,"Error: %s: %lu package(s) installed, %lu failed (%s)\n",r.root.c_str(),r.installed,r.failed.size(),names.c_str());
+        }
+    }
+
+    return failures;
 }
 
 void parseOptions(Options& opts, char* argv[], int argc, char*& optarg, int& optind) {
     int c;
 
     // Parse our options and react accordingly
-    while((c = getopt_long(argc, argv, "hv:g:u:s:l:i:m:", getopt_options, &optind)) != -1) {
+    while((c = getopt_long(argc, argv, "hqtkZv:g:u:s:l:i:m:j:w:x:d:c:z:r:p:b:o:a:", getopt_options, &optind)) != -1) {
         switch(c) {
             case 'v':
                 opts.setVerbosity((unsigned int)atoi(optarg));
@@ -253,6 +583,66 @@ void parseOptions(Options& opts, char* argv[], int argc, char*& optarg, int& opt
                 opts.setInstalledPkgsPath(optarg);
                 opts.addToOptMask(MASK_INSTALLED_PKG_PATH);
                 break;
+            case 'j':
+                opts.setJobs(optarg);
+                opts.addToOptMask(MASK_JOBS);
+                break;
+            case 'w':
+                opts.setWriters(optarg);
+                opts.addToOptMask(MASK_WRITERS);
+                break;
+            case 'x':
+                opts.addToExcludedFiles(optarg);
+                opts.addToOptMask(MASK_EXCLUDED_FILES);
+                break;
+            case 'q':
+                opts.setQuarantine(true);
+                opts.addToOptMask(MASK_QUARANTINE);
+                break;
+            case 't':
+                opts.setStaged(true);
+                opts.addToOptMask(MASK_STAGED);
+                break;
+            case 'd':
+                opts.setDurability(optarg);
+                opts.addToOptMask(MASK_DURABILITY);
+                break;
+            case 'c':
+                opts.setStorePath(optarg);
+                opts.addToOptMask(MASK_STORE_PATH);
+                break;
+            case 'k':
+                opts.setStoreHardlinks(true);
+                opts.addToOptMask(MASK_STORE_HARDLINKS);
+                break;
+            case 'z':
+                opts.setStoreSize(optarg);
+                opts.addToOptMask(MASK_STORE_SIZE);
+                break;
+            case 'r':
+                opts.addToFanoutRoots(optarg);
+                opts.addToOptMask(MASK_FANOUT_ROOTS);
+                break;
+            case 'p':
+                opts.setPrefetchDepth(optarg);
+                opts.addToOptMask(MASK_PREFETCH_DEPTH);
+                break;
+            case 'b':
+                opts.setPrefetchSize(optarg);
+                opts.addToOptMask(MASK_PREFETCH_SIZE);
+                break;
+            case 'o':
+                opts.setOutputPath(optarg);
+                opts.addToOptMask(MASK_OUTPUT_PATH);
+                break;
+            case 'a':
+                opts.setMemberCachePath(optarg);
+                opts.addToOptMask(MASK_MEMBER_CACHE_PATH);
+                break;
+            case 'Z':
+                opts.setBuildZstd(true);
+                opts.addToOptMask(MASK_BUILD_ZSTD);
+                break;
             case 'h':
                 printHelp();
                 exit(0);
@@ -267,14 +657,63 @@ void parseOptions(Options& opts, char* argv[], int argc, char*& optarg, int& opt
 void printHelp() {
     printf("Usage: pkg-mgr [-h] [-v n] [-g /path/to/file] [-u /path/to/file] [-s /path/to/sys/root/] [-l /path/to/pkgs] [-i /path/to/installed/pkgs] -m mode package(s)\n");
     printf("\n");
-    printf("    -m, --mode: The mode of operation; one of [i]nstall, [u]ninstall, [f]ollow, [u]n[f]ollow, [l]ist-[a]ll, [l]ist-[i]nstalled\n");
+    printf("    -m, --mode: The mode of operation; one of [i]nstall, [u]ninstall, [f]ollow, [u]n[f]ollow, [l]ist-[a]ll, [l]ist-[i]nstalled, [s]earch, [o]wner, [i]nde[x], [e]xtract, [b]uild\n");
     printf("    -v, --verbosity: When followed by an integer between 0 and 4, the verbosity is set to that level. 0 silences output, 1 only prints warnings and errors. Default setting: %d\n",DEFAULT_VERBOSITY);
     printf("    -g, --global-config: The path to the global config file. Any options in here can be overridden by the user config file. Default setting: %s\n",DEFAULT_GLOBAL_CONFIG_PATH);
     printf("    -u, --user-config: The path to the user config file. This file overrides the global config file. Default setting: %s\n",DEFAULT_USER_CONFIG_PATH);
     printf("    -s, --system-root: The path to the root directory to install packages to, or to uninstall them from. Default setting: %s\n",DEFAULT_SYSTEM_ROOT);
     printf("    -l, --package-library: The path the package tarballs are stored. Default setting: %s\n",DEFAULT_TAR_LIBRARY_PATH);
     printf("    -i, --installed-pkg-library: The path to the installed-pkgs directory. Default setting: %s\n",DEFAULT_INSTALLED_PKG_PATH);
+    printf("    -j, --jobs: The number of packages to extract at the same time when installing more than one. Scripts and the installed-pkg database are still handled one package at a time, in order, a package with a pre-install script waits for every package before it to be installed, and the packages after one with a post-install script wait for it to be installed. Default setting: %d\n",DEFAULT_JOBS);
+    printf("    -w, --writers: The number of threads writing out the files of each package being installed. The tarball itself is always read by a single thread. Default setting: %d\n",DEFAULT_WRITERS);
+    printf("    -x, --exclude: A path to leave alone when installing or uninstalling, relative to the system root. * and ? match within a path component, and a ** component matches any number of them. May be given more than once. Overrides excludedFiles in the config files\n");
+    printf("    -q, --quarantine: When uninstalling, move each package into a trash directory under the system root, and delete it from there in the background. If the package can't be moved entirely, it is put back. Default setting: %s\n",DEFAULT_QUARANTINE ? "on" : "off");
+    printf("    -t, --staged: When installing, extract each package into a staging directory under the system root, and only move it into place once it was extracted entirely. If it can't all be moved into place, the root is left as it was. Default setting: %s\n",DEFAULT_STAGED ? "on" : "off");
+    printf("    -d, --durability <none|transaction|package|file>: When installed files are made to reach the disk. none leaves it to the kernel. transaction syncs the root once every package was installed. package waits for each package to reach the disk before recording it as installed. file fsyncs every file, and the directories they were created in. The time spent waiting is shown at verbosity 3. Default setting: %s\n",durabilityName(DEFAULT_DURABILITY).c_str());
+    printf("    -c, --store: The path to a content addressed store of unpacked packages. A package is added to it the first time it's installed, and installing the same tarball again clones its files out of the store, instead of extracting them. Default setting: %s\n",(std::string(DEFAULT_STORE_PATH).empty()) ? "none" : DEFAULT_STORE_PATH);
+    printf("    -k, --store-hardlinks: Hard link files installed from the store to it, instead of cloning or copying them. The installed files then share their inode with the store, and every root installed from it. Default setting: %s\n",DEFAULT_STORE_HARDLINKS ? "on" : "off");
+    printf("    -z, --store-size: How large the store may grow, in MiB. Once it's larger, the packages installed from it longest ago are dropped. 0 is unlimited. Default setting: %llu\n",(unsigned long long)DEFAULT_STORE_SIZE);
+    printf("    -r, --fanout-root <root[:installed-pkg-library]>: Also install every package into this root. Each tarball is read and decoded once for all of the roots, which are written to at the same time. Each root runs the scripts and keeps a database of its own, in the given directory, or else at the installed-pkg-library path within the root. A root which fails is reported, without holding up the others. Can't be combined with --staged, --store, or more than one job. May be given more than once. Overrides fanoutRoots in the config files\n");
+    printf("    -p, --prefetch-depth: How many of the upcoming packages' tarballs are read ahead while the current package installs. Each tarball is dropped from memory once its package is installed. 0 disables reading ahead. Default setting: %d\n",DEFAULT_PREFETCH_DEPTH);
+    printf("    -b, --prefetch-size: How much of the upcoming tarballs may be read ahead at once, in MiB. Default setting: %llu\n",(unsigned long long)DEFAULT_PREFETCH_SIZE);
+    printf("    -o, --output: In extract mode, the directory to extract into, which is created if need be. When not given, the files are written to standard output. In build mode, the directory the packages are written to. When not given, they're written to the package-library\n");
+    printf("    -a, --member-cache: The directory the member list of each uncompressed library tarball is cached in, so its headers are only walked again once it changes. Tarballs carrying an index don't need it. Default setting: %s\n",(std::string(DEFAULT_MEMBER_CACHE_PATH).empty()) ? "within the installed-pkg-library" : DEFAULT_MEMBER_CACHE_PATH);
+    printf("    -Z, --zstd: In build mode, compress the packages with zstd, in frames which can be decompressed at the same time. Default setting: %s\n",DEFAULT_BUILD_ZSTD ? "on" : "off");
     printf("    -h, --help: Print this help message\n");
     printf("\n");
     printf("Any number of packages can be listed, unless in one of the list modes. Packages will be operated on from left to right.\n");
+    printf("In search mode, list search terms instead of packages. Every package name and packaged path containing all of the terms, ignoring case, is printed.\n");
+    printf("In owner mode, list paths instead of packages. Each path is printed along with the installed packages which own it.\n");
+    printf("In index mode, an index of its members is appended to each package's tarball, which has to be uncompressed. The package can still be read by any tar tool, while the package manager finds its members without walking every header.\n");
+    printf("In extract mode, list a package followed by paths within it. Each file is written to standard output, in the order listed, without installing the package. With --output, the paths are extracted into a directory instead, and may also be directories. An uncompressed package only has the requested files read out of it.\n");
+    printf("In build mode, list directories instead of packages. Each is packed into a package named after it, which installs its contents to the system root. The scripts come first, then the directories, then the files grouped by directory, so installing it is quick, and every package gets an index. A %s file at the top of the directory can give the package's version, and the packages it depends on, one per line as version=... and depends=...\n",PKG_META_NAME);
+    printf("In list-all mode, packages which start with metadata, as built ones do, are listed along with their version.\n");
+}
+
+/**
+ * Whether two paths name the same directory, once symlinks, dots and trailing slashes are resolved
+ *
+ * @param [in] const std::string& a
+ * @param [in] const std::string& b
+ *
+ * @returns bool areTheyTheSameDir
+ */
+bool isSameDir(const std::string& a, const std::string& b) {
+    std::error_code ea, eb;
+    std::filesystem::path pa = std::filesystem::weakly_canonical(a, ea);
+    std::filesystem::path pb = std::filesystem::weakly_canonical(b, eb);
+
+    if(ea || eb) {
+        return false;
+    }
+
+    if(pa.filename().empty()) {
+        pa = pa.parent_path();
+    }
+
+    if(pb.filename().empty()) {
+        pb = pb.parent_path();
+    }
+
+    return pa == pb;
 }
@@ -0,0 +1,73 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file ArchiveInput.h
+ * @error -1700
+ */
+
+#ifndef _THE2B_ARCHIVE_INPUT_H
+#define _THE2B_ARCHIVE_INPUT_H
+
+#include <stdio.h>          // printf
+#include <errno.h>          // errno
+#include <unistd.h>         // read, lseek, close
+#include <fcntl.h>          // open, posix_fadvise
+#include <sys/stat.h>       // fstat
+#include <sys/mman.h>       // mmap, madvise, munmap
+#include <string>           // std::string
+#include <vector>           // The read buffer
+#include <archive.h>
+
+#include "Options.h"
+
+// Packages up to this size are mapped into memory whole. Larger ones, and anything which can't be mapped, are read through a buffer
+#ifndef ARCHIVE_MMAP_MAX
+#define ARCHIVE_MMAP_MAX (1LL << 30)
+#endif /* ARCHIVE_MMAP_MAX */
+
+// The bounds of the read buffer, which is otherwise sized in whole blocks of the filesystem the package is on
+#define ARCHIVE_READ_BUFFER_MIN (128 << 10)
+#define ARCHIVE_READ_BUFFER_MAX (4 << 20)
+
+#define ARCHIVE_INPUT_OPEN_ERROR -1701
+#define ARCHIVE_INPUT_READ_ERROR -1702
+
+/**
+ * The data source libarchive reads a package from
+ *
+ * libarchive's own file reader would fetch a package in blocks of the size it is opened with, which for a tarball is 512 bytes, so scanning a package cost a read() per header and per block of data.
+ * Instead, a package is mapped into memory whole, and libarchive parses it in place. Anything too large to map, or which isn't a regular file, is read in large blocks, sized to the filesystem it is on, and skipped over with lseek where libarchive allows it.
+ * Either way, the kernel is told the package will be read from front to back, so it reads ahead aggressively.
+ *
+ * A mapped package must not be truncated while it is being read, or the read faults. The package library is only ever replaced whole, so this doesn't come up.
+ */
+class ArchiveInput {
+    private:
+        std::string path;
+        unsigned int verbosity;
+        int fd = -1;
+
+        const void* map = NULL;
+        size_t mapSize = 0;
+        bool mapHandedOut = false;
+
+        std::vector<char> buffer;
+        bool seekable = false;
+
+    public:
+        ArchiveInput(std::string path, unsigned int verbosity = DEFAULT_VERBOSITY);
+        ~ArchiveInput();
+        ArchiveInput(const ArchiveInput&) = delete;
+        ArchiveInput& operator=(const ArchiveInput&) = delete;
+
+        int open();
+        la_ssize_t read(const void** buf);
+        la_int64_t skip(la_int64_t request);
+        bool isSeekable();
+};
+
+void adviseSequential(int fd);
+int openArchiveInput(struct archive* a, std::string archivePath, unsigned int verbosity = DEFAULT_VERBOSITY);
+
+#endif /* _THE2B_ARCHIVE_INPUT_H */
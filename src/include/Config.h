@@ -23,6 +23,18 @@
 #define KEY_TAR_LIBRARY_PATH "packageLibraryPath"
 #define KEY_INSTALLED_PKG_PATH "installedPkgPath"
 #define KEY_EXCLUDED_FILES "excludedFiles"
+#define KEY_JOBS "jobs"
+#define KEY_WRITERS "writers"
+#define KEY_QUARANTINE "quarantine"
+#define KEY_STAGED "staged"
+#define KEY_DURABILITY "durability"
+#define KEY_STORE_PATH "storePath"
+#define KEY_STORE_HARDLINKS "storeHardlinks"
+#define KEY_STORE_SIZE "storeSize"
+#define KEY_FANOUT_ROOTS "fanoutRoots"
+#define KEY_PREFETCH_DEPTH "prefetchDepth"
+#define KEY_PREFETCH_SIZE "prefetchSize"
+#define KEY_MEMBER_CACHE_PATH "memberCachePath"
 
 // The character we use for comments
 #define COMMENT_CHAR '#'
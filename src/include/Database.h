@@ -0,0 +1,128 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Database.h
+ * @error -1000
+ */
+
+#ifndef _THE2B_DATABASE_H
+#define _THE2B_DATABASE_H
+
+#include <stdio.h>          // printf, fprintf, rename
+#include <stdint.h>         // Fixed-width integers
+#include <errno.h>          // errno
+#include <string.h>         // strerror, memcmp
+#include <time.h>           // time
+#include <unistd.h>         // read, write, fsync, close
+#include <fcntl.h>          // open
+#include <sys/stat.h>       // fstat
+#include <sys/mman.h>       // mmap, munmap
+#include <sys/file.h>       // flock
+#include <string>           // std::string
+#include <vector>           // vectors
+#include <map>              // maps
+#include <filesystem>       // directory_iterator
+
+#include "Options.h"
+#include "Manifest.h"
+#include "Owners.h"
+
+// The database lives inside the installed package path. The leading dot keeps it apart from legacy per-package files
+#define DB_FILENAME ".pkg-mgr.db"
+#define DB_LOCK_FILENAME ".pkg-mgr.db.lock"
+#define DB_TMP_FILENAME ".pkg-mgr.db.tmp"
+
+#define DB_MAGIC "PKGMGRDB"
+#define DB_MAGIC_SIZE 8
+#define DB_VERSION 2
+
+// Magic, version, record count, string area offset, blob area offset, generation
+#define DB_HEADER_SIZE 40
+
+// Databases written before the generation was added are still read. The next update rewrites them
+#define DB_V1_VERSION 1
+#define DB_V1_HEADER_SIZE 32
+
+// Name offset and length, version offset and length, install time, manifest offset and size
+#define DB_RECORD_SIZE 48
+
+#define DB_IO_ERROR -1001
+#define DB_CORRUPT -1002
+#define DB_NOT_FOUND -1003
+
+/**
+ * Everything the database knows about one installed package
+ * The manifest is kept in its serialized form, and is only parsed when asked for
+ */
+struct dbRecord_s {
+    std::string name;
+    std::string version;
+    int64_t installTime = 0;
+    std::string manifest;
+};
+
+/**
+ * The installed package database
+ *
+ * On disk, this is a single file: A header, a table of fixed-size records sorted by package name, a string area holding the names and versions, and a blob area holding each package's manifest.
+ * Readers map the file and binary search the record table, so looking a package up never touches more than a few pages, no matter how many packages are installed.
+ * Writers take a lock, write a complete new file next to the old one, and rename it into place, so readers always see either the old or the new database.
+ *
+ * Every update also updates the owner index (see Owners.h) while still holding the lock, so the two never disagree for long.
+ * Each update also bumps the database's generation, which the owner index records as well. An index with any other generation missed an update, and is rebuilt.
+ *
+ * Before this existed, each followed package was a file of its own in the installed package path. Those files are still read alongside the database, and the next update imports them.
+ */
+class PkgDatabase {
+    private:
+        std::string dirPath;
+        unsigned int verbosity;
+
+        // The mapped database, if there is one
+        const char* data = NULL;
+        size_t dataSize = 0;
+        uint32_t count = 0;
+        uint64_t generation = 0;
+        uint64_t tableOffset = DB_HEADER_SIZE;
+        uint64_t stringsOffset = 0;
+        uint64_t blobsOffset = 0;
+
+        // Set when there is a database file which couldn't be read. It's never written over, since it may hold the only record of what is installed
+        int mapError = 0;
+
+        // Legacy per-package files which haven't been imported yet
+        std::map<std::string, dbRecord_s> legacyRecords;
+
+        bool mapDatabase();
+        void unmapDatabase();
+        void loadLegacy();
+        bool recordAt(uint32_t index, dbRecord_s& rec, bool withManifest);
+        int64_t find(const std::string& name);
+        std::map<std::string, dbRecord_s> loadAll();
+        int commit(const std::map<std::string, dbRecord_s>& records, uint64_t newGeneration);
+        uint32_t countManifests();
+        int rebuildOwners(const std::map<std::string, dbRecord_s>& records, uint64_t ownersGeneration);
+        int update(const std::string& name, const dbRecord_s* rec);
+
+    public:
+        PkgDatabase(std::string installedPkgsPath, unsigned int verbosity = DEFAULT_VERBOSITY);
+        ~PkgDatabase();
+        PkgDatabase(const PkgDatabase&) = delete;
+        PkgDatabase& operator=(const PkgDatabase&) = delete;
+
+        bool contains(const std::string& name);
+        bool lookup(const std::string& name, dbRecord_s& rec);
+        std::string getVersion(const std::string& name);
+        int getManifest(const std::string& name, std::vector<manifestEntry_s>& entries);
+        std::vector<std::string> listNames();
+        uint64_t getGeneration();
+
+        int put(const dbRecord_s& rec);
+        int remove(const std::string& name);
+
+        bool ownersAreCurrent();
+        int refreshOwners();
+};
+
+#endif /* _THE2B_DATABASE_H */
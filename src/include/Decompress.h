@@ -0,0 +1,118 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Decompress.h
+ * @error -1600
+ */
+
+#ifndef _THE2B_DECOMPRESS_H
+#define _THE2B_DECOMPRESS_H
+
+#include <stdio.h>              // printf, fprintf
+#include <errno.h>              // errno
+#include <string.h>             // strerror, memcmp
+#include <unistd.h>             // pread, close, sysconf
+#include <fcntl.h>              // open
+#include <sys/stat.h>           // fstat
+#include <sys/mman.h>           // mmap, munmap
+#include <string>               // std::string
+#include <vector>               // vectors
+#include <thread>               // std::thread
+#include <mutex>                // std::mutex
+#include <condition_variable>   // std::condition_variable
+#include <archive.h>
+
+#include "Options.h"
+
+#ifdef WITH_ZSTD
+#include <zstd.h>
+#endif /* WITH_ZSTD */
+
+#ifdef WITH_LZMA_MT
+#include <lzma.h>
+#endif /* WITH_LZMA_MT */
+
+#define COMPRESSION_NONE 0
+#define COMPRESSION_GZIP 1
+#define COMPRESSION_XZ 2
+#define COMPRESSION_ZSTD 3
+
+// How many threads decompress a single package. 0 uses one per online CPU
+#ifndef DECOMPRESS_THREADS
+#define DECOMPRESS_THREADS 0
+#endif /* DECOMPRESS_THREADS */
+
+#define DECOMPRESS_MAX_THREADS 32
+
+// zstd frames are decoded whole, so bigger ones are left to libarchive's streaming decoder
+#define ZSTD_MAX_PARALLEL_FRAME (64 << 20)
+
+// The size of each block of xz output handed to libarchive
+#define XZ_OUTPUT_BUFFER_SIZE (1 << 20)
+
+/**
+ * Feeds libarchive the decompressed contents of a package, using several threads where the format allows it
+ *
+ * A zstd package made of several frames has its frames decompressed at the same time, each by its own thread, and handed over in order. Only a few frames past the one libarchive is reading are decoded ahead, which bounds the memory used.
+ * An xz package is decoded with liblzma's threaded decoder, which works on the independent blocks written by threaded xz encoders, and falls back to a single thread for anything else.
+ * A single zstd frame gets nothing out of more threads, so open() declines it, and libarchive decompresses it as usual, along with gzip.
+ */
+class ParallelDecoder {
+    private:
+        std::string path;
+        int type;
+        unsigned int threads;
+        unsigned int verbosity;
+        std::string error;
+
+        const unsigned char* map = NULL;
+        size_t mapSize = 0;
+
+#ifdef WITH_LZMA_MT
+        lzma_stream xz = LZMA_STREAM_INIT;
+        bool xzStarted = false;
+        bool xzDone = false;
+        std::vector<unsigned char> xzOut;
+#endif /* WITH_LZMA_MT */
+
+        struct frame_s {
+            size_t offset;
+            size_t length;
+            size_t contentSize;
+            std::vector<char> data;
+            bool ready = false;
+            bool failed = false;
+        };
+
+        std::vector<frame_s> frames;
+        std::vector<std::thread> workers;
+        std::mutex lock;
+        std::condition_variable frameReady;
+        std::condition_variable windowMoved;
+        size_t nextToDecode = 0;
+        size_t nextToRead = 0;
+        bool stopping = false;
+
+        bool openZstd();
+        bool openXz();
+        void zstdWorker();
+        la_ssize_t readZstd(const void** buf);
+        la_ssize_t readXz(const void** buf);
+
+    public:
+        ParallelDecoder(std::string path, int type, unsigned int threads, unsigned int verbosity = DEFAULT_VERBOSITY);
+        ~ParallelDecoder();
+        ParallelDecoder(const ParallelDecoder&) = delete;
+        ParallelDecoder& operator=(const ParallelDecoder&) = delete;
+
+        bool open();
+        la_ssize_t read(const void** buf);
+        const std::string& getError();
+};
+
+int detectCompression(int fd);
+unsigned int decompressThreads();
+bool openParallelDecompression(struct archive* a, std::string archivePath, int& res, unsigned int verbosity = DEFAULT_VERBOSITY);
+
+#endif /* _THE2B_DECOMPRESS_H */
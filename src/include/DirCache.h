@@ -0,0 +1,81 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file DirCache.h
+ * @error -1400
+ */
+
+#ifndef _THE2B_DIR_CACHE_H
+#define _THE2B_DIR_CACHE_H
+
+#include <stdio.h>          // printf, fprintf
+#include <errno.h>          // errno
+#include <string.h>         // strerror
+#include <unistd.h>         // close, syscall
+#include <fcntl.h>          // openat
+#include <sys/stat.h>       // mkdirat
+#include <string>           // std::string
+#include <list>             // The LRU order
+#include <unordered_map>    // Open directories by path
+
+#include "Options.h"
+
+#ifdef HAVE_LINUX_OPENAT2_H
+#include <sys/syscall.h>    // SYS_openat2
+#include <linux/openat2.h>  // open_how, RESOLVE_IN_ROOT
+#endif /* HAVE_LINUX_OPENAT2_H */
+
+// How many directories are kept open at once. Each extraction has its own cache, so this is per job
+#ifndef DIR_FD_CACHE_SIZE
+#define DIR_FD_CACHE_SIZE 64
+#endif /* DIR_FD_CACHE_SIZE */
+
+/**
+ * A cache of open directories below the system root
+ *
+ * Extraction creates every member relative to its parent directory's fd, so the kernel only resolves a member's last path component, instead of walking the whole path from / for each one.
+ * The most recently used directories are kept open. A directory which isn't cached is opened with a single lookup from the root, and any missing directories on the way are created.
+ *
+ * Where the kernel supports openat2 (Linux 5.6 and later), that lookup uses RESOLVE_IN_ROOT, so symbolic links in the tree, absolute or not, are resolved as if the system root were /, and can never lead out of it.
+ * Without it, symbolic links are followed the same way a full path would follow them.
+ */
+class DirFdCache {
+    private:
+        struct dirEntry_s {
+            int fd;
+            std::list<std::string>::iterator lruPos;
+        };
+
+        unsigned int verbosity;
+        int rootFd = -1;
+        size_t capacity;
+        bool useOpenat2 = true;
+        std::unordered_map<std::string, dirEntry_s> dirs;
+
+        // The front is the most recently used
+        std::list<std::string> lru;
+
+        unsigned long hits = 0;
+        unsigned long misses = 0;
+
+        int openFromRoot(const std::string& dir);
+        void insert(const std::string& dir, int fd);
+
+    public:
+        DirFdCache(std::string root, unsigned int verbosity = DEFAULT_VERBOSITY, size_t capacity = DIR_FD_CACHE_SIZE);
+        ~DirFdCache();
+        DirFdCache(const DirFdCache&) = delete;
+        DirFdCache& operator=(const DirFdCache&) = delete;
+
+        bool isOpen();
+        int getRootFd();
+        int dirFd(const std::string& dir, bool create);
+        int parentFd(const std::string& path, std::string& leaf, bool create);
+        unsigned long getHits();
+        unsigned long getMisses();
+};
+
+std::string canonicalMemberPath(const std::string& path);
+
+#endif /* _THE2B_DIR_CACHE_H */
@@ -0,0 +1,78 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Durability.h
+ * @error -2200
+ */
+
+#ifndef _THE2B_DURABILITY_H
+#define _THE2B_DURABILITY_H
+
+#include <stdio.h>          // printf, fprintf
+#include <errno.h>          // errno
+#include <string.h>         // strerror
+#include <unistd.h>         // fsync, syncfs, close
+#include <fcntl.h>          // openat, sync_file_range
+#include <time.h>           // clock_gettime
+#include <string>           // std::string
+#include <deque>            // Files still being written back, oldest first
+#include <set>              // Directories holding new entries
+#include <mutex>            // std::mutex
+
+#include "Options.h"
+
+// In file mode, how many files may have their writeback in flight before the oldest is waited on. Each one holds a file descriptor until then
+#ifndef DURABILITY_FILE_WINDOW
+#define DURABILITY_FILE_WINDOW 64
+#endif /* DURABILITY_FILE_WINDOW */
+
+#define DURABILITY_ROOT_ERROR -2201
+#define DURABILITY_SYNC_ERROR -2202
+
+/**
+ * Makes the files of one extraction reach the disk, as the package and file durability modes ask
+ *
+ * Whoever writes a file hands it over here instead of closing it, and writeback of its data is started right away with sync_file_range, so the disk works while the next files are extracted.
+ * In package mode, the file is closed there, and finish() is a single syncfs, which by then mostly waits for writes already under way.
+ * In file mode, the file is kept open until DURABILITY_FILE_WINDOW newer files were handed over, then fsync'd. finish() fsyncs the rest, then every directory new entries were created in.
+ * It is shared by the writers of a WriterPool, so every function is thread safe.
+ */
+class WritebackTracker {
+    private:
+        unsigned int mode;
+        unsigned int verbosity;
+        int rootFd = -1;
+
+        std::mutex lock;
+        std::deque<std::pair<int, std::string>> pending;
+        std::set<std::string> dirs;
+
+        int error = 0;
+        unsigned long filesSynced = 0;
+        double seconds = 0;
+
+        void addParents(const std::string& rel);
+        void syncFile(int fd, const std::string& rel);
+
+    public:
+        WritebackTracker(std::string root, unsigned int mode, unsigned int verbosity = DEFAULT_VERBOSITY);
+        ~WritebackTracker();
+        WritebackTracker(const WritebackTracker&) = delete;
+        WritebackTracker& operator=(const WritebackTracker&) = delete;
+
+        bool isOpen();
+        void fileWritten(int fd, const std::string& rel);
+        void entryCreated(const std::string& rel);
+        void pathRestored(const std::string& path, const std::string& rel, bool isFile);
+        int finish();
+
+        unsigned long getFilesSynced();
+        double getSeconds();
+};
+
+void closeWritten(WritebackTracker* durability, int fd, const std::string& rel);
+int syncRoot(std::string path, unsigned int verbosity = DEFAULT_VERBOSITY, double* seconds = NULL);
+std::string durabilityName(unsigned int durability);
+
+#endif /* _THE2B_DURABILITY_H */
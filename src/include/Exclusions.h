@@ -0,0 +1,71 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Exclusions.h
+ * @error -1800
+ */
+
+#ifndef _THE2B_EXCLUSIONS_H
+#define _THE2B_EXCLUSIONS_H
+
+#include <stdio.h>          // fprintf
+#include <stdint.h>         // uint32_t
+#include <string.h>         // strlen
+#include <string>           // std::string
+#include <vector>           // vectors
+#include <set>              // sets
+#include <map>              // DFA states by their NFA states
+#include <bitset>           // The bytes an NFA edge accepts
+
+#include "Options.h"
+
+// The most states the compiled patterns may need. Past this, the patterns are refused rather than using unbounded memory
+#define EXCLUSION_MAX_DFA_STATES 4096
+
+#define EXCLUSION_TOO_COMPLEX -1801
+
+/**
+ * The set of paths an install or uninstall leaves alone, compiled once from glob patterns
+ *
+ * Patterns are relative to the system root; A leading / or ./ is ignored. * and ? match within a single path component, [...] matches one of a set of characters, and a ** component matches any number of whole components.
+ * A pattern matching a directory also matches everything below it, so usr/share/doc drops a package's documentation, and so does usr/share/doc followed by a trailing ** component. The latter keeps the directory itself.
+ *
+ * Patterns without any wildcards, and those whose only wildcard is a trailing ** component, go into a trie of path prefixes. The rest are combined into a single NFA, which is turned into a DFA when the matcher is built.
+ * Matching an archive path is then a walk down the trie, followed by one table lookup per byte, with nothing allocated.
+ */
+class ExclusionMatcher {
+    private:
+        struct trieNode_s {
+            std::vector<std::pair<char, uint32_t>> children;
+
+            // exact matches the path itself and everything below it. below only matches what's below it
+            bool exact = false;
+            bool below = false;
+        };
+
+        std::vector<trieNode_s> trie;
+
+        // State 0 is the dead state, and state 1 is the start
+        uint32_t classCount = 0;
+        unsigned char byteClass[256] = { 0 };
+        std::vector<uint32_t> transitions;
+        std::vector<char> accepting;
+        bool hasGlobs = false;
+        bool valid = true;
+
+        void addPrefix(const std::string& prefix, bool belowOnly);
+        bool compileGlobs(const std::vector<std::string>& globs, unsigned int verbosity);
+        bool matchesTrie(const char* path, size_t length) const;
+        bool matchesDfa(const char* path, size_t length) const;
+
+    public:
+        ExclusionMatcher(const std::set<std::string>& patterns = std::set<std::string>{}, unsigned int verbosity = DEFAULT_VERBOSITY);
+
+        bool isValid() const;
+        bool matches(const char* path, size_t length) const;
+        bool matches(const char* path) const;
+        bool matches(const std::string& path) const;
+};
+
+#endif /* _THE2B_EXCLUSIONS_H */
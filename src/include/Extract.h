@@ -0,0 +1,62 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Extract.h
+ * @error -700
+ */
+
+#ifndef _THE2B_EXTRACT_H
+#define _THE2B_EXTRACT_H
+
+#include <stdio.h>          // printf, fprintf
+#include <stdlib.h>         // malloc, free
+#include <errno.h>          // errno
+#include <string.h>         // strerror
+#include <unistd.h>         // copy_file_range, pread, write, symlinkat, linkat, unlinkat
+#include <fcntl.h>          // open
+#include <sys/stat.h>       // fchmod, mkdirat, fstatat
+#include <sys/sendfile.h>   // sendfile
+#include <string>           // std::string
+#include <vector>           // vectors
+#include <set>              // sets
+#include <archive.h>
+#include <archive_entry.h>
+
+#include "Options.h"
+#include "TarReader.h"
+#include "DirCache.h"
+#include "WriterPool.h"
+#include "Durability.h"
+#include "Exclusions.h"
+
+// The most we'll hand to a single copy_file_range/sendfile call
+#define ZERO_COPY_CHUNK (1 << 30)
+
+// The buffer used when neither copy_file_range nor sendfile will work
+#define COPY_BUFFER_SIZE (1 << 17)
+
+// What we ask libarchive to restore for the members it extracts
+#define LIBARCHIVE_EXTRACT_FLAGS (ARCHIVE_EXTRACT_ACL | ARCHIVE_EXTRACT_PERM | ARCHIVE_EXTRACT_SECURE_NODOTDOT | ARCHIVE_EXTRACT_XATTR)
+
+// Shown every header libarchive reads, before the exclusions are checked, with the archive positioned at the entry's data
+// Returns ENTRY_EXTRACT to go on as usual, ENTRY_SKIP if the entry shouldn't be extracted (say, because the hook read its data), or a negative error code to stop
+typedef int (*entryHook_t)(struct archive* a, struct archive_entry* ae, void* context);
+#define ENTRY_EXTRACT 0
+#define ENTRY_SKIP 1
+
+// What a hook returns to stop the extraction without it being reported as an error. The hook says why itself
+#define ENTRY_STOPPED -707
+
+ssize_t copyFileData(int srcFd, off_t srcOffset, int dstFd, off_t len);
+bool isSafeMemberPath(const std::string& path);
+bool clearPath(int dirFd, const std::string& leaf);
+int createMemberFile(int dirFd, const std::string& leaf);
+bool createDirectory(int dirFd, const std::string& leaf);
+int createHardLink(DirFdCache& dirs, const std::string& rel, const std::string& linkTarget, const std::string& dest, const std::string& root, unsigned int verbosity);
+void applyDirModes(DirFdCache& dirs, const std::vector<std::pair<std::string, mode_t>>& dirModes);
+void applyDirModes(std::string root, const std::vector<std::pair<std::string, mode_t>>& dirModes, unsigned int verbosity = DEFAULT_VERBOSITY);
+int extractTarZeroCopy(int tarFd, const std::vector<tarMember_s>& members, std::string root, const ExclusionMatcher& exclusions, std::set<std::string>& fallbackPaths, unsigned int verbosity = DEFAULT_VERBOSITY, WriterPool* pool = NULL, WritebackTracker* durability = NULL, std::vector<std::pair<std::string, mode_t>>* deferredDirModes = NULL);
+int extractArchiveWithWriters(struct archive* a, std::string root, const ExclusionMatcher& exclusions, WriterPool& pool, unsigned int verbosity = DEFAULT_VERBOSITY, entryHook_t hook = NULL, void* hookContext = NULL);
+
+#endif /* _THE2B_EXTRACT_H */
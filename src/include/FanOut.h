@@ -0,0 +1,129 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file FanOut.h
+ * @error -2500
+ */
+
+#ifndef _THE2B_FAN_OUT_H
+#define _THE2B_FAN_OUT_H
+
+#include <stdio.h>              // printf, fprintf
+#include <errno.h>              // errno
+#include <string.h>             // strerror
+#include <string>               // std::string
+#include <vector>               // vectors
+#include <set>                  // sets
+#include <deque>                // The op queues
+#include <memory>               // std::shared_ptr
+#include <thread>               // std::thread
+#include <mutex>                // std::mutex
+#include <condition_variable>   // std::condition_variable
+#include <archive.h>
+#include <archive_entry.h>
+
+#include "Options.h"
+#include "TarReader.h"
+#include "Extract.h"
+#include "Exclusions.h"
+#include "Durability.h"
+
+// How many decoded bytes may be waiting on the slowest root, summed over every member. The decoder stalls beyond this
+#define FANOUT_BUFFER_BUDGET (64 << 20)
+
+// How many queued operations each root may fall behind by
+#define FANOUT_OPS_PER_ROOT 4096
+
+// What a root's writer is asked to do with the current member
+#define FANOUT_OP_HEADER 0
+#define FANOUT_OP_DATA 1
+#define FANOUT_OP_FINISH 2
+
+#define FANOUT_ROOT_ERROR -2501
+#define FANOUT_WRITE_ERROR -2502
+
+/**
+ * One of the roots a fan-out install writes to, along with its own installed package database
+ * The results are kept per root, so a root which failed never hides how the others did
+ */
+struct fanoutRoot_s {
+    std::string root;
+    std::string installedPkgsPath;
+
+    // The result of the package currently being installed; ARCHIVE_EOF on success
+    int result = ARCHIVE_EOF;
+
+    unsigned long installed = 0;
+    std::vector<std::string> failed;
+};
+
+/**
+ * A step of the extraction, shared by every root's writer
+ * The entry and the data are never changed once queued, so the roots can hold on to them for as long as they need
+ */
+struct fanoutOp_s {
+    int kind = FANOUT_OP_HEADER;
+    std::shared_ptr<struct archive_entry> entry;
+    std::shared_ptr<std::string> data;
+    int64_t offset = 0;
+};
+
+/**
+ * Bounds the decoded data waiting on the roots
+ */
+class FanoutBudget {
+    private:
+        size_t limit;
+        size_t used = 0;
+        std::mutex lock;
+        std::condition_variable space;
+
+    public:
+        FanoutBudget(size_t limit);
+
+        void acquire(size_t bytes);
+        void release(size_t bytes);
+};
+
+/**
+ * A thread restoring the members of an archive into a single root, through its own libarchive disk writer
+ *
+ * Once anything fails, the root is marked as failed and everything queued for it afterwards is dropped. The decoder and the other roots carry on.
+ * libarchive writes the files, so each one is only handed to the root's WritebackTracker, if there is one, after it was finished. See WritebackTracker::pathRestored
+ */
+class FanoutWriter {
+    private:
+        std::string root;
+        unsigned int verbosity;
+        struct archive* disk = NULL;
+        WritebackTracker* durability;
+
+        std::thread thread;
+        std::deque<fanoutOp_s> queue;
+        std::mutex lock;
+        std::condition_variable workReady;
+        std::condition_variable queueSpace;
+        bool stopping = false;
+        int error = 0;
+        std::string current;
+        std::string currentRel;
+        bool currentIsFile = false;
+
+        void work();
+        int apply(fanoutOp_s& op);
+
+    public:
+        FanoutWriter(std::string root, unsigned int verbosity = DEFAULT_VERBOSITY, WritebackTracker* durability = NULL);
+        ~FanoutWriter();
+        FanoutWriter(const FanoutWriter&) = delete;
+        FanoutWriter& operator=(const FanoutWriter&) = delete;
+
+        void submit(const fanoutOp_s& op);
+        int finish();
+};
+
+int extractTarFanout(int tarFd, const std::vector<tarMember_s>& members, const std::vector<std::string>& roots, const ExclusionMatcher& exclusions, std::vector<std::set<std::string>>& fallbackPaths, std::vector<std::vector<std::pair<std::string, mode_t>>>& dirModes, std::vector<int>& results, unsigned int verbosity = DEFAULT_VERBOSITY, const std::vector<WritebackTracker*>* durability = NULL);
+int extractArchiveFanout(struct archive* a, const std::vector<std::string>& roots, const ExclusionMatcher& exclusions, std::vector<int>& results, unsigned int verbosity = DEFAULT_VERBOSITY, const std::vector<WritebackTracker*>* durability = NULL);
+
+#endif /* _THE2B_FAN_OUT_H */
@@ -0,0 +1,60 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Manifest.h
+ * @error -900
+ */
+
+#ifndef _THE2B_MANIFEST_H
+#define _THE2B_MANIFEST_H
+
+#include <stdio.h>      // printf, fprintf, rename
+#include <stdint.h>     // Fixed-width integers
+#include <errno.h>      // errno
+#include <string.h>     // strerror, memcmp
+#include <unistd.h>     // read, write, close
+#include <fcntl.h>      // open
+#include <sys/stat.h>   // fstat
+#include <string>       // std::string
+#include <vector>       // vectors
+#include <algorithm>    // sort
+
+#include "Options.h"
+#include "TarReader.h"
+
+// The first bytes of every manifest, followed by the format version
+#define MANIFEST_MAGIC "PKGMANI"
+#define MANIFEST_MAGIC_SIZE 8
+#define MANIFEST_VERSION 1
+
+// The size of the fixed part of each record: type, hash length, path length, mode, size
+#define MANIFEST_RECORD_SIZE 16
+
+// Return values of readManifest
+#define MANIFEST_LEGACY -901
+#define MANIFEST_CORRUPT -902
+#define MANIFEST_IO_ERROR -903
+
+/**
+ * A single path owned by an installed package
+ * The hash is optional, and is stored as raw bytes. An empty hash means none was recorded
+ */
+struct manifestEntry_s {
+    std::string path;
+    char type = TAR_TYPE_REGULAR;
+    mode_t mode = 0;
+    off_t size = 0;
+    std::string hash;
+};
+
+void putLE(std::string& buf, uint64_t val, size_t bytes);
+uint64_t getLE(const char* buf, size_t bytes);
+void putVarint(std::string& buf, uint64_t val);
+bool getVarint(const char*& p, const char* end, uint64_t& val);
+std::vector<manifestEntry_s> manifestFromMembers(const std::vector<tarMember_s>& members);
+std::string serializeManifest(std::vector<manifestEntry_s> entries);
+int parseManifest(const char* buf, size_t len, std::vector<manifestEntry_s>& entries);
+int readManifest(std::string path, std::vector<manifestEntry_s>& entries, unsigned int verbosity = DEFAULT_VERBOSITY);
+
+#endif /* _THE2B_MANIFEST_H */
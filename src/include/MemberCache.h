@@ -0,0 +1,68 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file MemberCache.h
+ * @error -2900
+ */
+
+#ifndef _THE2B_MEMBER_CACHE_H
+#define _THE2B_MEMBER_CACHE_H
+
+#include <stdio.h>          // printf, fprintf, snprintf, rename
+#include <stdlib.h>         // mkstemp
+#include <stdint.h>         // Fixed-width integers
+#include <errno.h>          // errno
+#include <string.h>         // strerror, memcmp
+#include <unistd.h>         // close, unlink
+#include <fcntl.h>          // open
+#include <sys/stat.h>       // fstat, fchmod
+#include <string>           // std::string
+#include <vector>           // vectors
+#include <set>              // sets
+#include <utility>          // std::pair
+#include <filesystem>       // create_directories, directory_iterator
+
+#include "Options.h"
+#include "TarReader.h"
+#include "Manifest.h"
+#include "Sha256.h"
+#include "PkgIndex.h"
+#include "WriterPool.h"
+
+// The directory the cache is kept in, within the installed package database, unless memberCachePath says otherwise
+#define MEMBER_CACHE_DIRNAME ".pkg-mgr.members"
+
+#define MEMBER_CACHE_MAGIC "PKGMCCH"
+#define MEMBER_CACHE_MAGIC_SIZE 8
+#define MEMBER_CACHE_VERSION 1
+
+// Magic, version, padding, then the device, inode, size, mtime seconds and nanoseconds of the tarball, the length of the records, and their SHA-256
+#define MEMBER_CACHE_HEADER_SIZE 96
+
+/**
+ * Remembers the member list of each uncompressed tarball without an index, so its headers are only walked once
+ *
+ * Each tarball has an entry of its own, named after its device and inode, which holds the records a package index would, along with the tarball's size and mtime.
+ * An entry is only used while all four still match the tarball. Once it no longer does, the tarball is walked again, and the entry replaced. See readPkgMembers.
+ * An entry whose tarball was removed from the library would never be replaced, so listing the library drops them. See prune.
+ *
+ * Entries are written to a temporary file and renamed into place, so concurrent runs never see half of one, and the records are hashed, so a damaged entry is rebuilt rather than trusted.
+ * The cache can always be rebuilt from the tarballs, so nothing here can make an operation fail. Errors are only reported at the highest verbosity.
+ */
+class MemberCache {
+    private:
+        std::string dir;
+        unsigned int verbosity;
+
+        std::string entryPath(const struct stat& st);
+
+    public:
+        MemberCache(std::string dir, unsigned int verbosity = DEFAULT_VERBOSITY);
+
+        bool load(int fd, std::vector<tarMember_s>& members);
+        bool store(int fd, const std::vector<tarMember_s>& members);
+        unsigned long prune(const std::set<std::pair<uint64_t, uint64_t>>& tarballs);
+};
+
+#endif /* _THE2B_MEMBER_CACHE_H */
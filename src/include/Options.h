@@ -10,10 +10,12 @@
 #define _THE2B_OPTIONS_H
 
 #include <stdlib.h>     // getenv
+#include <string.h>     // strcmp
 #include <getopt.h>     // Processing command line flags
 #include <cmath>        // pow; Using cmath instead of math.h because it has additional overloads that are more efficient
 #include <string>       // strings
 #include <set>          // sets
+#include <vector>       // vectors
 #include <filesystem>   // exists
 #include <system_error>
 
@@ -49,13 +51,77 @@
 #endif /* DEFAULT_TAR_LIBRARY_PATH */
 
 #ifndef DEFAULT_INSTALLED_PKG_PATH
-#define DEFAULT_INSTALLED_PKG_PATH "/var/lib/pkg-mgr/pkgs/"
+#define DEFAULT_INSTALLED_PKG_PATH "/var/lib/pkg-mgr/installed/"
 #endif /* DEFAULT_INSTALLED_PKG_PATH */
 
 #ifndef DEFAULT_EXCLUDED_FILES
 #define DEFAULT_EXCLUDED_FILES {}
 #endif /* DEFAULT_EXCLUDED_FILES */
 
+#ifndef DEFAULT_JOBS
+#define DEFAULT_JOBS 1
+#endif /* DEFAULT_JOBS */
+
+#ifndef DEFAULT_WRITERS
+#define DEFAULT_WRITERS 1
+#endif /* DEFAULT_WRITERS */
+
+#ifndef DEFAULT_QUARANTINE
+#define DEFAULT_QUARANTINE false
+#endif /* DEFAULT_QUARANTINE */
+
+#ifndef DEFAULT_STAGED
+#define DEFAULT_STAGED false
+#endif /* DEFAULT_STAGED */
+
+#ifndef DEFAULT_DURABILITY
+#define DEFAULT_DURABILITY DURABILITY_NONE
+#endif /* DEFAULT_DURABILITY */
+
+// No store by default. Every package is extracted from its tarball
+#ifndef DEFAULT_STORE_PATH
+#define DEFAULT_STORE_PATH ""
+#endif /* DEFAULT_STORE_PATH */
+
+#ifndef DEFAULT_STORE_HARDLINKS
+#define DEFAULT_STORE_HARDLINKS false
+#endif /* DEFAULT_STORE_HARDLINKS */
+
+// In MiB. 0 never drops anything from the store
+#ifndef DEFAULT_STORE_SIZE
+#define DEFAULT_STORE_SIZE 0
+#endif /* DEFAULT_STORE_SIZE */
+
+// Installs only go to the system root by default
+#ifndef DEFAULT_FANOUT_ROOTS
+#define DEFAULT_FANOUT_ROOTS {}
+#endif /* DEFAULT_FANOUT_ROOTS */
+
+// How many of the upcoming packages' tarballs are read ahead while the current one installs. 0 disables reading ahead
+#ifndef DEFAULT_PREFETCH_DEPTH
+#define DEFAULT_PREFETCH_DEPTH 2
+#endif /* DEFAULT_PREFETCH_DEPTH */
+
+// In MiB. How much of the upcoming tarballs may be read ahead at once
+#ifndef DEFAULT_PREFETCH_SIZE
+#define DEFAULT_PREFETCH_SIZE 256
+#endif /* DEFAULT_PREFETCH_SIZE */
+
+// The extract mode writes to standard output unless given a directory
+#ifndef DEFAULT_OUTPUT_PATH
+#define DEFAULT_OUTPUT_PATH ""
+#endif /* DEFAULT_OUTPUT_PATH */
+
+// Empty keeps the member cache within the installed package database, since the library may well be a read-only mirror
+#ifndef DEFAULT_MEMBER_CACHE_PATH
+#define DEFAULT_MEMBER_CACHE_PATH ""
+#endif /* DEFAULT_MEMBER_CACHE_PATH */
+
+// The build mode writes uncompressed, seekable packages unless asked for zstd
+#ifndef DEFAULT_BUILD_ZSTD
+#define DEFAULT_BUILD_ZSTD false
+#endif /* DEFAULT_BUILD_ZSTD */
+
 #define DEFAULT_OPT_MASK 0
 
 // Modes of operation
@@ -69,9 +135,19 @@
 #define OWNER 7
 #define IMPORT 8
 #define PURGE 9
+#define INDEX 10
+#define EXTRACT 11
+#define BUILD 12
 #define NOP 99
 #define NOP_KEY "NONE_OF_THE_ABOVE"
 
+// Durability modes; When installed files are made to reach the disk
+// none leaves it to the kernel, transaction syncs once after every package was installed, package waits for each package before it's recorded as installed, and file fsyncs every file
+#define DURABILITY_NONE 0
+#define DURABILITY_TRANSACTION 1
+#define DURABILITY_PACKAGE 2
+#define DURABILITY_FILE 3
+
 // Mask bits
 #define MASK_VERBOSE 1
 #define MASK_SMART_OP 2
@@ -82,8 +158,22 @@
 #define MASK_TAR_LIBRARY_PATH 64
 #define MASK_INSTALLED_PKG_PATH 128
 #define MASK_EXCLUDED_FILES 256
+#define MASK_JOBS 512
+#define MASK_WRITERS 1024
+#define MASK_QUARANTINE 2048
+#define MASK_STAGED 4096
+#define MASK_DURABILITY 8192
+#define MASK_STORE_PATH 16384
+#define MASK_STORE_HARDLINKS 32768
+#define MASK_STORE_SIZE 65536
+#define MASK_FANOUT_ROOTS 131072
+#define MASK_PREFETCH_DEPTH 262144
+#define MASK_PREFETCH_SIZE 524288
+#define MASK_OUTPUT_PATH 1048576
+#define MASK_MEMBER_CACHE_PATH 2097152
+#define MASK_BUILD_ZSTD 4194304
 // The number of bits the mask uses
-#define MASK_SIZE 9
+#define MASK_SIZE 23
 
 struct mode_s {
     unsigned int modeIndex = NOP;
@@ -114,13 +204,27 @@ class Options {
         std::string tarLibraryPath;
         std::string installedPkgsPath;
         std::set<std::string> excludedFiles;
+        unsigned int jobs;
+        unsigned int writers;
+        bool quarantine;
+        bool staged;
+        unsigned int durability;
+        std::string storePath;
+        bool storeHardlinks;
+        unsigned long long storeSize;
+        std::vector<std::string> fanoutRoots;
+        unsigned int prefetchDepth;
+        unsigned long long prefetchSize;
+        std::string outputPath;
+        std::string memberCachePath;
+        bool buildZstd;
         
         // Takes a string mode and returns the proper mode integer
         unsigned int translateMode(std::string modeStr, bool silent = false);
 
     public:
         // Constructors
-        Options(unsigned int mode, unsigned int verbosity = DEFAULT_VERBOSITY, bool smartOperation = DEFAULT_SMART_OP, unsigned int optMask = DEFAULT_OPT_MASK, std::string globalConfigPath = DEFAULT_GLOBAL_CONFIG_PATH, std::string userConfigPath = DEFAULT_USER_CONFIG_PATH, std::string systemRoot = DEFAULT_SYSTEM_ROOT, std::string tarLibraryPath = DEFAULT_TAR_LIBRARY_PATH, std::string installedPkgsPath = DEFAULT_INSTALLED_PKG_PATH, std::set<std::string> excludedFiles = DEFAULT_EXCLUDED_FILES);
+        Options(unsigned int mode, unsigned int verbosity = DEFAULT_VERBOSITY, bool smartOperation = DEFAULT_SMART_OP, unsigned int optMask = DEFAULT_OPT_MASK, std::string globalConfigPath = DEFAULT_GLOBAL_CONFIG_PATH, std::string userConfigPath = DEFAULT_USER_CONFIG_PATH, std::string systemRoot = DEFAULT_SYSTEM_ROOT, std::string tarLibraryPath = DEFAULT_TAR_LIBRARY_PATH, std::string installedPkgsPath = DEFAULT_INSTALLED_PKG_PATH, std::set<std::string> excludedFiles = DEFAULT_EXCLUDED_FILES, unsigned int jobs = DEFAULT_JOBS, unsigned int writers = DEFAULT_WRITERS, bool quarantine = DEFAULT_QUARANTINE, bool staged = DEFAULT_STAGED, unsigned int durability = DEFAULT_DURABILITY, std::string storePath = DEFAULT_STORE_PATH, bool storeHardlinks = DEFAULT_STORE_HARDLINKS, unsigned long long storeSize = DEFAULT_STORE_SIZE, std::vector<std::string> fanoutRoots = DEFAULT_FANOUT_ROOTS, unsigned int prefetchDepth = DEFAULT_PREFETCH_DEPTH, unsigned long long prefetchSize = DEFAULT_PREFETCH_SIZE, std::string outputPath = DEFAULT_OUTPUT_PATH, std::string memberCachePath = DEFAULT_MEMBER_CACHE_PATH, bool buildZstd = DEFAULT_BUILD_ZSTD);
 
         // Getters
         mode_s getMode();
@@ -135,6 +239,20 @@ class Options {
         std::string getTarLibraryPath();
         std::string getInstalledPkgsPath();
         std::set<std::string> getExcludedFiles();
+        unsigned int getJobs();
+        unsigned int getWriters();
+        bool getQuarantine();
+        bool getStaged();
+        unsigned int getDurability();
+        std::string getStorePath();
+        bool getStoreHardlinks();
+        unsigned long long getStoreSize();
+        std::vector<std::string> getFanoutRoots();
+        unsigned int getPrefetchDepth();
+        unsigned long long getPrefetchSize();
+        std::string getOutputPath();
+        std::string getMemberCachePath();
+        bool getBuildZstd();
 
         // Setters
         bool setMode(unsigned int mode, bool silent = false);
@@ -150,10 +268,36 @@ class Options {
         bool setTarLibraryPath(std::string tarLibrary, bool silent = false);
         bool setInstalledPkgsPath(std::string installedPkgsPath, bool silent = false);
         bool setExcludedFiles(std::set<std::string> excludedFiles, bool silent = false);
+        bool setExcludedFiles(const char* excludedFiles, bool silent = false);
+        bool setJobs(unsigned int jobs, bool silent = false);
+        bool setJobs(const char* jobs, bool silent = false);
+        bool setWriters(unsigned int writers, bool silent = false);
+        bool setWriters(const char* writers, bool silent = false);
+        bool setQuarantine(bool quarantine, bool silent = false);
+        bool setQuarantine(const char* quarantine, bool silent = false);
+        bool setStaged(bool staged, bool silent = false);
+        bool setStaged(const char* staged, bool silent = false);
+        bool setDurability(unsigned int durability, bool silent = false);
+        bool setDurability(const char* durability, bool silent = false);
+        bool setStorePath(std::string storePath, bool silent = false);
+        bool setStoreHardlinks(bool storeHardlinks, bool silent = false);
+        bool setStoreHardlinks(const char* storeHardlinks, bool silent = false);
+        bool setStoreSize(unsigned long long storeSize, bool silent = false);
+        bool setStoreSize(const char* storeSize, bool silent = false);
+        bool setFanoutRoots(std::vector<std::string> fanoutRoots, bool silent = false);
+        bool setFanoutRoots(const char* fanoutRoots, bool silent = false);
+        bool setPrefetchDepth(unsigned int prefetchDepth, bool silent = false);
+        bool setPrefetchDepth(const char* prefetchDepth, bool silent = false);
+        bool setPrefetchSize(unsigned long long prefetchSize, bool silent = false);
+        bool setPrefetchSize(const char* prefetchSize, bool silent = false);
+        bool setOutputPath(std::string outputPath, bool silent = false);
+        bool setMemberCachePath(std::string memberCachePath, bool silent = false);
+        bool setBuildZstd(bool buildZstd, bool silent = false);
 
         // Adds the values to the options as appropriate
         bool addToOptMask(unsigned int optMask, bool silent = false);
         bool addToExcludedFiles(std::string, bool silent = false);
+        bool addToFanoutRoots(std::string, bool silent = false);
 
         // Applies a config to the options as appropriate
         // Has logic for CLI arguments to take priority
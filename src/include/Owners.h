@@ -0,0 +1,98 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Owners.h
+ * @error -1100
+ */
+
+#ifndef _THE2B_OWNERS_H
+#define _THE2B_OWNERS_H
+
+#include <stdio.h>          // printf, fprintf, rename
+#include <stdint.h>         // Fixed-width integers
+#include <errno.h>          // errno
+#include <string.h>         // strerror, memcmp
+#include <unistd.h>         // write, fsync, close
+#include <fcntl.h>          // open
+#include <sys/stat.h>       // fstat
+#include <sys/mman.h>       // mmap, munmap
+#include <string>           // std::string
+#include <vector>           // vectors
+#include <map>              // maps
+#include <set>              // sets
+#include <algorithm>        // sort, merge, unique
+#include <iterator>         // back_inserter, make_move_iterator
+
+#include "Options.h"
+#include "Manifest.h"
+
+// Lives next to the installed package database
+#define OWNERS_FILENAME ".pkg-mgr.owners"
+#define OWNERS_TMP_FILENAME ".pkg-mgr.owners.tmp"
+
+#define OWNERS_MAGIC "PKGOWNRS"
+#define OWNERS_MAGIC_SIZE 8
+#define OWNERS_VERSION 2
+
+// Magic, version, package count, entry count, block count, names offset, block index offset, database generation
+#define OWNERS_HEADER_SIZE 56
+
+// Every block starts with a full path, so a lookup decodes at most this many entries past the binary search
+#define OWNERS_BLOCK_ENTRIES 16
+
+#define OWNERS_IO_ERROR -1101
+
+/**
+ * One installed path and the package which owns it
+ * Directories are usually owned by several packages, in which case they appear once per package
+ */
+struct ownerEntry_s {
+    std::string path;
+    uint32_t pkg;
+};
+
+/**
+ * The reverse index from installed paths to the packages owning them
+ *
+ * On disk, this is a sorted string table: A header, the names of the packages, a table of block offsets, and the blocks themselves.
+ * Within a block, each path only stores the part which differs from the path before it (front coding), which keeps the index small, since most paths share long prefixes with their neighbours.
+ * Lookups map the file, binary search the block table by the first path of each block, and decode at most a block or two.
+ *
+ * Paths are stored relative to the system root, without leading or trailing slashes, per normalizeMemberPath.
+ * The header holds the generation of the installed package database the index was written for. See PkgDatabase::ownersAreCurrent
+ */
+class OwnerIndex {
+    private:
+        unsigned int verbosity;
+        const char* data = NULL;
+        size_t dataSize = 0;
+        bool valid = false;
+        uint32_t pkgCount = 0;
+        uint64_t generation = 0;
+        uint64_t entryCount = 0;
+        uint64_t blockCount = 0;
+        uint64_t blockIndexOffset = 0;
+        std::vector<std::string> names;
+
+        std::string blockFirstPath(uint64_t block);
+
+    public:
+        OwnerIndex(std::string installedPkgsPath, unsigned int verbosity = DEFAULT_VERBOSITY);
+        ~OwnerIndex();
+        OwnerIndex(const OwnerIndex&) = delete;
+        OwnerIndex& operator=(const OwnerIndex&) = delete;
+
+        bool isValid();
+        uint32_t getPkgCount();
+        uint64_t getGeneration();
+        std::vector<std::string> getPkgNames();
+        std::vector<ownerEntry_s> getEntries();
+        std::vector<std::string> findOwners(const std::string& path);
+};
+
+std::vector<std::string> manifestPaths(const std::string& manifest);
+int writeOwnerIndex(std::string installedPkgsPath, const std::map<std::string, std::vector<std::string>>& pkgPaths, uint64_t generation, unsigned int verbosity = DEFAULT_VERBOSITY);
+int updateOwnerIndex(std::string installedPkgsPath, const std::set<std::string>& removed, const std::map<std::string, std::vector<std::string>>& added, uint64_t generation, unsigned int verbosity = DEFAULT_VERBOSITY);
+
+#endif /* _THE2B_OWNERS_H */
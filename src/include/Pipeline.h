@@ -0,0 +1,30 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Pipeline.h
+ * @error -800
+ */
+
+#ifndef _THE2B_PIPELINE_H
+#define _THE2B_PIPELINE_H
+
+#include <stdio.h>              // printf, fprintf
+#include <string>               // std::string
+#include <vector>               // vectors
+#include <set>                  // sets
+#include <deque>                // The job queue
+#include <unordered_map>        // Path ownership within the window
+#include <unordered_set>        // The directories a package writes
+#include <thread>               // Worker threads
+#include <mutex>                // Guarding the job queue
+#include <condition_variable>   // Waking workers and the committer
+#include <filesystem>           // absolute
+
+#include "Options.h"
+#include "Pkg.h"
+#include "Prefetch.h"
+
+int installPkgsPipelined(std::vector<Pkg>& pkgs, std::string root = DEFAULT_SYSTEM_ROOT, std::string installedPkgsPath = DEFAULT_INSTALLED_PKG_PATH, unsigned int verbosity = DEFAULT_VERBOSITY, const ExclusionMatcher& exclusions = ExclusionMatcher(defaultPkgExclusions()), bool quick = DEFAULT_SMART_OP, unsigned int jobs = DEFAULT_JOBS, unsigned int writers = DEFAULT_WRITERS, bool staged = DEFAULT_STAGED, unsigned int durability = DEFAULT_DURABILITY, ContentStore* store = NULL, Prefetcher* prefetcher = NULL);
+
+#endif /* _THE2B_PIPELINE_H */
@@ -21,25 +21,68 @@
 #include <fcntl.h>      // O_RDONLY
 
 #include <set>          // Sets
+#include <map>          // Maps
+#include <sys/stat.h>   // fstat
 #include <archive.h>
 #include <archive_entry.h>
 
 #include "Config.h"
 #include "Options.h"
+#include "TarReader.h"
+#include "Extract.h"
+#include "Manifest.h"
+#include "Database.h"
+#include "Script.h"
+#include "Decompress.h"
+#include "ArchiveInput.h"
+#include "Exclusions.h"
+#include "Remove.h"
+#include "Quarantine.h"
+#include "Stage.h"
+#include "Durability.h"
+#include "Store.h"
+#include "FanOut.h"
+#include "PkgIndex.h"
+#include "MemberCache.h"
+#include "PkgMeta.h"
 
 // The names of our pre- and post- install/uninstall scripts
 #define PRE_INSTALL_NAME "pre-install.sh"
 #define POST_INSTALL_NAME "post-install.sh"
 #define PRE_UNINSTALL_NAME "pre-uninstall.sh"
 #define POST_UNINSTALL_NAME "post-uninstall.sh"
+#define PKG_SCRIPT_NAMES { PRE_INSTALL_NAME, POST_INSTALL_NAME, PRE_UNINSTALL_NAME, POST_UNINSTALL_NAME }
+
+// What an install leaves out of the root unless told otherwise: the scripts, the package metadata and the package index. See addScriptsToExclusions
+std::set<std::string> defaultPkgExclusions();
 
 // A tar file has a blocksize of 512
 #define TAR_BLOCKSIZE 512
 
+// The extensions a package tarball may have, in the order the library is searched for them
+#define PKG_EXTENSIONS { ".tar", ".tar.zst", ".tar.xz", ".tar.gz" }
+
 // I could not find these definitions in my header files, so I'll put it here. I may need to move this later, however, so don't rely on it
 #define likely(x) __builtin_expect(static_cast<bool>(x), 1)
 #define unlikely(x) __builtin_expect(static_cast<bool>(x), 0)
 
+class Pkg;
+
+// What installPkgWithScripts keeps track of while it captures the scripts of a compressed package during its extraction. See Pkg::captureEntry
+struct onePass_s {
+    Pkg* pkg;
+    std::string root;
+    const ExclusionMatcher* exclusions;
+    unsigned int verbosity;
+
+    // Set once the metadata said the package has no pre-install script
+    bool noPreInstall = false;
+
+    // Set once the pre-install script was run, or found to be missing, right before the first entry was written
+    bool preInstallRun = false;
+    int preInstallRes = 256;
+};
+
 class Pkg {
     friend bool operator ==(const Pkg& a, const Pkg& b);
     
@@ -48,21 +91,45 @@ class Pkg {
         std::string pathname;
         std::string pkgName;
 
+        // Where the members of an uncompressed tarball without an index are looked up before its headers are walked. May be NULL
+        MemberCache* memberCache;
+
         // This will be a list of files within the tar file
         std::set<std::string> buildPkgContents(unsigned int verbosity = DEFAULT_VERBOSITY);
 
+        // What a single pass over the tarball found: Every member, and the bodies of the scripts
+        // walked is set when the members came from our own header walker, and their offsets can be used to copy data out of the tarball
+        bool scanned = false;
+        bool walked = false;
+        struct stat scannedStat;
+        std::vector<tarMember_s> members;
+        std::map<std::string, pkgScript_s> scripts;
+
+        void scanPkg(unsigned int verbosity = DEFAULT_VERBOSITY);
+        bool canReuseMembers(int fd);
+        int execScript(std::string scriptName, unsigned int verbosity = DEFAULT_VERBOSITY);
+        bool captureScript(struct archive* a, const tarMember_s& m, unsigned int verbosity);
+        int extractPkg(std::string tarPath, std::string root, unsigned int verbosity, const ExclusionMatcher& exclusions, unsigned int writers, WritebackTracker* durability, entryHook_t hook = NULL, void* hookContext = NULL);
+        int runPreInstallScript(std::string root, unsigned int verbosity);
+        bool canInstallInOnePass(const ExclusionMatcher& exclusions, bool staged, ContentStore* store);
+        static int captureEntry(struct archive* a, struct archive_entry* ae, void* context);
+        void extractPkgFanout(const std::vector<std::string>& roots, std::vector<int>& results, unsigned int verbosity, const ExclusionMatcher& exclusions, const std::vector<WritebackTracker*>& durability);
+
     public:
         // Declare our functions
-        Pkg(std::string path, unsigned int verbosity = DEFAULT_VERBOSITY);
+        Pkg(std::string path, unsigned int verbosity = DEFAULT_VERBOSITY, std::string installedPkgsPath = "", MemberCache* memberCache = NULL);
         std::string getPathname();
         std::string getPkgName();
-        int installPkg(std::string tarPath, std::string root = DEFAULT_SYSTEM_ROOT, std::string installedPkgsPath = DEFAULT_INSTALLED_PKG_PATH, unsigned int verbosity = DEFAULT_VERBOSITY, std::set<std::string> exclusions = std::set<std::string>{}, bool quick = DEFAULT_SMART_OP);
-        int uninstallPkg(std::set<std::string> pkgContents, std::string root = DEFAULT_SYSTEM_ROOT, std::string installedPkgsPath = DEFAULT_INSTALLED_PKG_PATH, unsigned int verbosity = DEFAULT_VERBOSITY, std::set<std::string> exclusions = std::set<std::string>{}, bool quick = DEFAULT_SMART_OP);
+        std::set<std::string> loadPkgContents(std::string installedPkgsPath = DEFAULT_INSTALLED_PKG_PATH, unsigned int verbosity = DEFAULT_VERBOSITY);
+        std::vector<tarMember_s> getPkgMembers(unsigned int verbosity = DEFAULT_VERBOSITY);
+        bool hasScript(std::string scriptName, unsigned int verbosity = DEFAULT_VERBOSITY);
+        int installPkg(std::string tarPath, std::string root = DEFAULT_SYSTEM_ROOT, std::string installedPkgsPath = DEFAULT_INSTALLED_PKG_PATH, unsigned int verbosity = DEFAULT_VERBOSITY, const ExclusionMatcher& exclusions = ExclusionMatcher(defaultPkgExclusions()), bool quick = DEFAULT_SMART_OP, unsigned int writers = DEFAULT_WRITERS, bool staged = DEFAULT_STAGED, unsigned int durability = DEFAULT_DURABILITY, ContentStore* store = NULL, entryHook_t hook = NULL, void* hookContext = NULL);
+        int uninstallPkg(std::set<std::string> pkgContents, std::string root = DEFAULT_SYSTEM_ROOT, std::string installedPkgsPath = DEFAULT_INSTALLED_PKG_PATH, unsigned int verbosity = DEFAULT_VERBOSITY, const ExclusionMatcher& exclusions = ExclusionMatcher(defaultPkgExclusions()), bool quick = DEFAULT_SMART_OP, bool quarantine = DEFAULT_QUARANTINE);
 
         // The following functions call their overloads with the appropriate member vars (tarPath, pkgContents)
-        int installPkg(std::string root = DEFAULT_SYSTEM_ROOT, std::string installedPkgsPath = DEFAULT_INSTALLED_PKG_PATH, unsigned int verbosity = DEFAULT_VERBOSITY, std::set<std::string> exclusions = std::set<std::string>{}, bool quick = DEFAULT_SMART_OP);
-        int uninstallPkg(std::string root = DEFAULT_SYSTEM_ROOT, std::string installedPkgsPath = DEFAULT_INSTALLED_PKG_PATH, unsigned int verbosity = DEFAULT_VERBOSITY, std::set<std::string> exclusions = std::set<std::string>{}, bool quick = DEFAULT_SMART_OP);
-        bool followPkg(std::string installedPkgDir = DEFAULT_INSTALLED_PKG_PATH, unsigned int verbosity = DEFAULT_VERBOSITY);
+        int installPkg(std::string root = DEFAULT_SYSTEM_ROOT, std::string installedPkgsPath = DEFAULT_INSTALLED_PKG_PATH, unsigned int verbosity = DEFAULT_VERBOSITY, const ExclusionMatcher& exclusions = ExclusionMatcher(defaultPkgExclusions()), bool quick = DEFAULT_SMART_OP, unsigned int writers = DEFAULT_WRITERS, bool staged = DEFAULT_STAGED, unsigned int durability = DEFAULT_DURABILITY, ContentStore* store = NULL);
+        int uninstallPkg(std::string root = DEFAULT_SYSTEM_ROOT, std::string installedPkgsPath = DEFAULT_INSTALLED_PKG_PATH, unsigned int verbosity = DEFAULT_VERBOSITY, const ExclusionMatcher& exclusions = ExclusionMatcher(defaultPkgExclusions()), bool quick = DEFAULT_SMART_OP, bool quarantine = DEFAULT_QUARANTINE);
+        bool followPkg(std::string installedPkgDir = DEFAULT_INSTALLED_PKG_PATH, unsigned int verbosity = DEFAULT_VERBOSITY, bool installed = false);
         bool unfollowPkg(std::string installedPkgDir = DEFAULT_INSTALLED_PKG_PATH, unsigned int verbosity = DEFAULT_VERBOSITY);
 
         // The following functions call the execScript function with the correct arguments from the Pkg object
@@ -72,15 +139,23 @@ class Pkg {
         int execPostUninstallScript(unsigned int verbosity = DEFAULT_VERBOSITY);
 
         // The following functions combine install/uninstall, follow/unfollow, and pre-/post install/uninstall scripts
-        int installPkgWithScripts(std::string root = DEFAULT_SYSTEM_ROOT, std::string installedPkgsPath = DEFAULT_INSTALLED_PKG_PATH, unsigned int verbosity = DEFAULT_VERBOSITY, std::set<std::string> exclusions = std::set<std::string>{}, bool quick = DEFAULT_SMART_OP);
-        int uninstallPkgWithScripts(std::string root = DEFAULT_SYSTEM_ROOT, std::string installedPkgsPath = DEFAULT_INSTALLED_PKG_PATH, unsigned int verbosity = DEFAULT_VERBOSITY, std::set<std::string> exclusions = std::set<std::string>{}, bool quick = DEFAULT_SMART_OP);
+        int installPkgWithScripts(std::string root = DEFAULT_SYSTEM_ROOT, std::string installedPkgsPath = DEFAULT_INSTALLED_PKG_PATH, unsigned int verbosity = DEFAULT_VERBOSITY, const ExclusionMatcher& exclusions = ExclusionMatcher(defaultPkgExclusions()), bool quick = DEFAULT_SMART_OP, unsigned int writers = DEFAULT_WRITERS, bool staged = DEFAULT_STAGED, unsigned int durability = DEFAULT_DURABILITY, ContentStore* store = NULL);
+        int installPkgFanout(std::vector<fanoutRoot_s>& roots, unsigned int verbosity = DEFAULT_VERBOSITY, const ExclusionMatcher& exclusions = ExclusionMatcher(defaultPkgExclusions()), unsigned int durability = DEFAULT_DURABILITY);
+        int runPreInstall(std::string root = DEFAULT_SYSTEM_ROOT, unsigned int verbosity = DEFAULT_VERBOSITY);
+        int finishInstall(int installRes, std::string root = DEFAULT_SYSTEM_ROOT, std::string installedPkgsPath = DEFAULT_INSTALLED_PKG_PATH, unsigned int verbosity = DEFAULT_VERBOSITY);
+        int uninstallPkgWithScripts(std::string root = DEFAULT_SYSTEM_ROOT, std::string installedPkgsPath = DEFAULT_INSTALLED_PKG_PATH, unsigned int verbosity = DEFAULT_VERBOSITY, const ExclusionMatcher& exclusions = ExclusionMatcher(defaultPkgExclusions()), bool quick = DEFAULT_SMART_OP, bool quarantine = DEFAULT_QUARANTINE);
 };
 
-bool listAllPkgs(std::string libraryPath, unsigned int verbosity = DEFAULT_VERBOSITY);
+bool isPkgFile(const std::string& path);
+std::string pkgNameFromPath(const std::string& path);
+std::string findPkgTarball(std::string libraryPath, std::string name);
+bool listAllPkgs(std::string libraryPath, unsigned int verbosity = DEFAULT_VERBOSITY, MemberCache* memberCache = NULL);
 bool listInstalledPkgs(std::string installedPkgsPath, unsigned int verbosity = DEFAULT_VERBOSITY);
+bool listOwners(std::vector<std::string> paths, std::string root, std::string installedPkgsPath, unsigned int verbosity = DEFAULT_VERBOSITY);
 bool openArchiveWithTarSupport(struct archive*& a, std::string archivePath, unsigned int verbosity = DEFAULT_VERBOSITY);
+int extractWithLibarchive(std::string archivePath, std::string root, const ExclusionMatcher& exclusions, const std::set<std::string>* onlyPaths = NULL, unsigned int verbosity = DEFAULT_VERBOSITY, unsigned int writers = DEFAULT_WRITERS, WritebackTracker* durability = NULL, entryHook_t hook = NULL, void* hookContext = NULL);
 int setArchiveEntryToFile(std::string filepath, std::string archivePath, struct archive_entry*& archiveEntryToSet, unsigned int verbosity = DEFAULT_VERBOSITY);
-int extractAndExecScript(std::string scriptName, std::string extractionDir, std::string archivePath, unsigned int verbosity = DEFAULT_VERBOSITY);
+bool isPkgScript(const std::string& path);
 void addScriptsToExclusions(std::set<std::string>& exclusions);
 bool moveToDir(std::string path, unsigned int verbosity = DEFAULT_VERBOSITY);
 
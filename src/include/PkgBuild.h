@@ -0,0 +1,82 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file PkgBuild.h
+ * @error -3000
+ */
+
+#ifndef _THE2B_PKG_BUILD_H
+#define _THE2B_PKG_BUILD_H
+
+#include <stdio.h>          // printf, fprintf, rename
+#include <stdlib.h>         // mkstemp
+#include <stdint.h>         // Fixed-width integers
+#include <errno.h>          // errno
+#include <string.h>         // strerror
+#include <unistd.h>         // pread, lseek, readlink, fdatasync, close, unlink
+#include <fcntl.h>          // open
+#include <sys/stat.h>       // lstat, fchmod
+#include <string>           // std::string
+#include <vector>           // vectors
+#include <map>              // maps
+#include <utility>          // pairs
+#include <algorithm>        // sort, stable_sort, lower_bound
+#include <filesystem>       // recursive_directory_iterator
+#include <archive.h>
+#include <archive_entry.h>
+
+#ifdef WITH_ZSTD
+#include <zstd.h>
+#endif /* WITH_ZSTD */
+
+#include "Options.h"
+#include "TarReader.h"
+#include "Manifest.h"
+#include "PkgIndex.h"
+#include "PkgMeta.h"
+#include "WriterPool.h"
+#include "Pkg.h"
+
+// Where each kind of member goes in a built package. See buildPkg
+#define PKG_BUILD_RANK_SCRIPT 0
+#define PKG_BUILD_RANK_DIRECTORY 1
+#define PKG_BUILD_RANK_FILE 2
+#define PKG_BUILD_RANK_HARDLINK 3
+
+// How much of a file is read at once
+#define PKG_BUILD_READ_SIZE (1 << 20)
+
+// A zstd frame is closed at the first member boundary past PKG_BUILD_FRAME_SIZE, and wherever it reaches PKG_BUILD_MAX_FRAME_SIZE
+// The largest frame has to stay below ZSTD_MAX_PARALLEL_FRAME, or the package is left to libarchive's single-threaded decoder
+#define PKG_BUILD_FRAME_SIZE (4 << 20)
+#define PKG_BUILD_MAX_FRAME_SIZE (32 << 20)
+#define PKG_BUILD_ZSTD_LEVEL 19
+
+// The seek table of the zstd seekable format lives in a skippable frame, which any zstd decoder passes over
+#define PKG_BUILD_SKIPPABLE_MAGIC 0x184D2A5E
+#define PKG_BUILD_SEEKABLE_MAGIC 0x8F92EAB1
+
+#define PKG_BUILD_NOT_A_DIRECTORY -3001
+#define PKG_BUILD_READ_ERROR -3002
+#define PKG_BUILD_WRITE_ERROR -3003
+#define PKG_BUILD_NO_ZSTD -3004
+
+/**
+ * A path under the directory a package is built from, along with where it goes in the package
+ */
+struct buildEntry_s {
+    // Relative to the directory the package is built from
+    std::string path;
+    std::string parent;
+    std::string name;
+    struct stat st;
+    int rank = PKG_BUILD_RANK_FILE;
+
+    // The member a hard link points at
+    std::string linkTarget;
+};
+
+int buildPkg(std::string srcDir, std::string outDir, bool zstd = DEFAULT_BUILD_ZSTD, unsigned int verbosity = DEFAULT_VERBOSITY);
+
+#endif /* _THE2B_PKG_BUILD_H */
@@ -0,0 +1,42 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file PkgExtract.h
+ * @error -2800
+ */
+
+#ifndef _THE2B_PKG_EXTRACT_H
+#define _THE2B_PKG_EXTRACT_H
+
+#include <stdio.h>          // printf, fprintf, fflush
+#include <errno.h>          // errno
+#include <string.h>         // strerror
+#include <unistd.h>         // close, STDOUT_FILENO
+#include <fcntl.h>          // open
+#include <string>           // std::string
+#include <vector>           // vectors
+#include <set>              // sets
+#include <map>              // maps
+#include <unordered_map>    // The latest member at each path
+#include <filesystem>       // create_directories
+#include <archive.h>
+#include <archive_entry.h>
+
+#include "Options.h"
+#include "TarReader.h"
+#include "PkgIndex.h"
+#include "MemberCache.h"
+#include "Extract.h"
+#include "Exclusions.h"
+#include "WriterPool.h"
+#include "Pkg.h"
+
+#define PKG_EXTRACT_NOT_FOUND -2801
+#define PKG_EXTRACT_NOT_REGULAR -2802
+#define PKG_EXTRACT_WRITE_ERROR -2803
+#define PKG_EXTRACT_OPEN_ERROR -2804
+
+int extractPkgMembers(std::string tarPath, const std::vector<std::string>& paths, std::string outputDir = DEFAULT_OUTPUT_PATH, unsigned int verbosity = DEFAULT_VERBOSITY, MemberCache* cache = NULL);
+
+#endif /* _THE2B_PKG_EXTRACT_H */
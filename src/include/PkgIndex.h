@@ -0,0 +1,59 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file PkgIndex.h
+ * @error -2700
+ */
+
+#ifndef _THE2B_PKG_INDEX_H
+#define _THE2B_PKG_INDEX_H
+
+#include <stdio.h>          // printf, fprintf
+#include <stdint.h>         // Fixed-width integers
+#include <errno.h>          // errno
+#include <string.h>         // strerror, memcmp, memcpy
+#include <unistd.h>         // pread, pwrite, ftruncate, fdatasync, close
+#include <fcntl.h>          // open
+#include <sys/stat.h>       // fstat
+#include <string>           // std::string
+#include <vector>           // vectors
+
+#include "Options.h"
+#include "TarReader.h"
+#include "Manifest.h"
+#include "Sha256.h"
+
+class MemberCache;
+
+// The member holding the index. It's always the last member of the archive, and is never installed
+#define PKG_INDEX_NAME ".pkg-index"
+
+// The first bytes of the index, followed by the format version and the number of records
+#define PKG_INDEX_MAGIC "PKGINDX"
+#define PKG_INDEX_MAGIC_SIZE 8
+#define PKG_INDEX_VERSION 1
+
+// The last block of the index member, which points back at its header. See readPkgIndex
+#define PKG_INDEX_TRAILER_MAGIC "PKGITRL"
+
+// How many blocks at the end of the archive are searched for the trailer. Tar writers pad archives out to records of 20 blocks
+#define PKG_INDEX_SEARCH_BLOCKS 24
+
+// Set on a record whose member only libarchive can restore
+#define PKG_INDEX_FLAG_FALLBACK 1
+
+// Not an error; The archive has no index, and its headers have to be walked
+#define PKG_INDEX_ABSENT -2701
+#define PKG_INDEX_CORRUPT -2702
+#define PKG_INDEX_IO_ERROR -2703
+#define PKG_INDEX_UNSUPPORTED -2704
+
+bool isPkgIndex(const std::string& path);
+std::string serializePkgIndex(const std::vector<tarMember_s>& members);
+bool parsePkgIndex(const std::string& buf, off_t indexOffset, std::vector<tarMember_s>& members);
+int readPkgIndex(int fd, std::vector<tarMember_s>& members, unsigned int verbosity = DEFAULT_VERBOSITY);
+int readPkgMembers(int fd, std::vector<tarMember_s>& members, unsigned int verbosity = DEFAULT_VERBOSITY, MemberCache* cache = NULL);
+int writePkgIndex(std::string tarPath, unsigned int verbosity = DEFAULT_VERBOSITY);
+
+#endif /* _THE2B_PKG_INDEX_H */
@@ -0,0 +1,82 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file PkgMeta.h
+ * @error -3100
+ */
+
+#ifndef _THE2B_PKG_META_H
+#define _THE2B_PKG_META_H
+
+#include <stdio.h>          // printf, fprintf
+#include <stdlib.h>         // strtoull
+#include <stdint.h>         // Fixed-width integers
+#include <errno.h>          // errno
+#include <string.h>         // strerror
+#include <unistd.h>         // pread, close
+#include <fcntl.h>          // open
+#include <string>           // std::string
+#include <vector>           // vectors
+#include <sstream>          // Splitting the lists
+#include <archive.h>
+#include <archive_entry.h>
+
+#include "Config.h"
+#include "Options.h"
+#include "TarReader.h"
+
+// The member holding the metadata. It has to be the first member of the archive to be found, and is never installed
+#define PKG_META_NAME ".pkg-meta"
+
+// The keys of the metadata. See serializePkgMeta
+#define PKG_META_KEY_NAME "name"
+#define PKG_META_KEY_VERSION "version"
+#define PKG_META_KEY_INSTALLED_SIZE "installedSize"
+#define PKG_META_KEY_FILES "files"
+#define PKG_META_KEY_DEPENDS "depends"
+#define PKG_META_KEY_SCRIPTS "scripts"
+
+// Which of the pre- and post- install/uninstall scripts a package carries
+#define PKG_META_PRE_INSTALL 1
+#define PKG_META_POST_INSTALL 2
+#define PKG_META_PRE_UNINSTALL 4
+#define PKG_META_POST_UNINSTALL 8
+
+// The largest metadata member we read. Anything larger isn't ours
+#define PKG_META_MAX_SIZE (64 << 10)
+
+// How much of an uncompressed package is read in one go, which covers the header and the metadata of nearly every package
+#define PKG_META_READ_SIZE 4096
+
+// How much of a compressed package libarchive is handed at once, so it stops shortly after the first member
+#define PKG_META_BLOCK_SIZE 16384
+
+// Not an error; The package has no metadata, or it isn't the first member
+#define PKG_META_ABSENT -3101
+#define PKG_META_CORRUPT -3102
+#define PKG_META_IO_ERROR -3103
+
+/**
+ * What a package says about itself, without having to read past its first member
+ */
+struct pkgMeta_s {
+    std::string name;
+    std::string version;
+
+    // The bytes and paths the package installs, leaving out its scripts and metadata
+    uint64_t installedSize = 0;
+    uint64_t files = 0;
+
+    std::vector<std::string> depends;
+
+    // A combination of the PKG_META_* script flags
+    unsigned int scripts = 0;
+};
+
+bool isPkgMeta(const std::string& path);
+std::string serializePkgMeta(const pkgMeta_s& meta);
+bool parsePkgMeta(const std::string& buf, pkgMeta_s& meta, unsigned int verbosity = DEFAULT_VERBOSITY);
+int readPkgMeta(std::string tarPath, pkgMeta_s& meta, unsigned int verbosity = DEFAULT_VERBOSITY);
+
+#endif /* _THE2B_PKG_META_H */
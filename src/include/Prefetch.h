@@ -0,0 +1,76 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Prefetch.h
+ * @error -2600
+ */
+
+#ifndef _THE2B_PREFETCH_H
+#define _THE2B_PREFETCH_H
+
+#include <stdio.h>              // printf, fprintf
+#include <errno.h>              // errno
+#include <string.h>             // strerror
+#include <unistd.h>             // close
+#include <fcntl.h>              // open, posix_fadvise
+#include <sys/stat.h>           // stat
+#include <string>               // std::string
+#include <vector>               // vectors
+#include <deque>                // The read ahead queue
+#include <thread>               // The read ahead thread
+#include <mutex>                // std::mutex
+#include <condition_variable>   // std::condition_variable
+#include <filesystem>           // absolute
+
+#include "Options.h"
+
+// How much of a tarball is asked for at once. Small enough that a package which starts, or finishes, is noticed soon
+#define PREFETCH_CHUNK_SIZE (8 << 20)
+
+/**
+ * Keeps the tarballs of the next few packages in the page cache while the current one installs
+ *
+ * Every package in the list is known before the first one starts, so up to depth of the packages after the current one are read ahead, in order, by a thread of its own. At most maxBytes of them are held at once; A package which doesn't fit is read ahead once earlier ones are finished with.
+ * A tarball whose package is finished is dropped from the page cache, unless a later package uses it too, so installing doesn't push out what the rest of the system is working with.
+ *
+ * Reading ahead is only a hint to the kernel. Nothing here can make an install fail, so errors are only reported at the highest verbosity.
+ */
+class Prefetcher {
+    private:
+        std::vector<std::string> paths;
+        unsigned int depth;
+        unsigned long long maxBytes;
+        unsigned int verbosity;
+
+        // How much of each tarball was asked for, and which packages are done with
+        std::vector<unsigned long long> held;
+        std::vector<bool> finished;
+        unsigned long long heldBytes = 0;
+        size_t nextIndex = 0;
+        size_t lastStarted = 0;
+
+        std::thread thread;
+        std::deque<size_t> queue;
+        std::mutex lock;
+        std::condition_variable workReady;
+        bool stopping = false;
+
+        void work();
+        void fill(size_t current);
+        void readAhead(size_t index, unsigned long long bytes);
+
+    public:
+        Prefetcher(const std::vector<std::string>& paths, unsigned int depth = DEFAULT_PREFETCH_DEPTH, unsigned long long maxBytes = DEFAULT_PREFETCH_SIZE * 1024ULL * 1024ULL, unsigned int verbosity = DEFAULT_VERBOSITY);
+        ~Prefetcher();
+        Prefetcher(const Prefetcher&) = delete;
+        Prefetcher& operator=(const Prefetcher&) = delete;
+
+        void start(size_t index);
+        void finish(size_t index);
+
+        unsigned long long getHeldBytes();
+        unsigned long long getHeldBytes(size_t index);
+};
+
+#endif /* _THE2B_PREFETCH_H */
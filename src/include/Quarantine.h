@@ -0,0 +1,53 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Quarantine.h
+ * @error -2000
+ */
+
+#ifndef _THE2B_QUARANTINE_H
+#define _THE2B_QUARANTINE_H
+
+#include <stdio.h>          // printf, fprintf
+#include <stdlib.h>         // strtol
+#include <errno.h>          // errno
+#include <string.h>         // strerror
+#include <unistd.h>         // fork, getpid, write
+#include <signal.h>         // kill
+#include <fcntl.h>          // openat, renameat
+#include <dirent.h>         // fdopendir, readdir
+#include <sys/stat.h>       // fstatat, mkdirat
+#include <sys/wait.h>       // waitpid
+#include <string>           // std::string
+#include <vector>           // vectors
+#include <set>              // sets
+#include <map>              // The package's paths, in order
+#include <unordered_map>    // Directories by their path
+#include <unordered_set>    // Names within a directory
+#include <algorithm>        // std::count, std::stable_sort
+#include <atomic>           // std::atomic
+
+#include "Options.h"
+#include "DirCache.h"
+#include "Exclusions.h"
+#include "Remove.h"
+
+// The directory under the system root that packages are moved into while being uninstalled. A rename can't cross filesystems, so it has to live in the root
+#define TRASH_DIR_NAME ".pkg-mgr-trash"
+#define TRASH_JOURNAL_NAME "journal"
+#define TRASH_COMMITTED_NAME "committed"
+
+// Whether the trash is emptied by a detached process, so an uninstall returns as soon as the package is out of place. Otherwise it's emptied before returning
+#ifndef QUARANTINE_BACKGROUND_RECLAIM
+#define QUARANTINE_BACKGROUND_RECLAIM 1
+#endif /* QUARANTINE_BACKGROUND_RECLAIM */
+
+#define QUARANTINE_ROOT_ERROR -2001
+#define QUARANTINE_TRASH_ERROR -2002
+#define QUARANTINE_MOVE_ERROR -2003
+
+int quarantinePkgPaths(const std::set<std::string>& pkgContents, std::string root, std::string pkgName, const ExclusionMatcher& exclusions, unsigned int verbosity = DEFAULT_VERBOSITY, bool background = QUARANTINE_BACKGROUND_RECLAIM);
+int recoverTrash(std::string root, unsigned int verbosity = DEFAULT_VERBOSITY);
+
+#endif /* _THE2B_QUARANTINE_H */
@@ -0,0 +1,47 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Remove.h
+ * @error -1900
+ */
+
+#ifndef _THE2B_REMOVE_H
+#define _THE2B_REMOVE_H
+
+#include <stdio.h>          // fprintf
+#include <errno.h>          // errno
+#include <string.h>         // strerror
+#include <unistd.h>         // unlinkat, sysconf
+#include <fcntl.h>          // AT_REMOVEDIR
+#include <dirent.h>         // fdopendir, readdir
+#include <sys/stat.h>       // fchmod
+#include <string>           // std::string
+#include <vector>           // vectors
+#include <set>              // sets
+#include <unordered_map>    // Paths grouped by their directory
+#include <thread>           // std::thread
+#include <atomic>           // The next directory to claim
+#include <algorithm>        // std::count
+
+#include "Options.h"
+#include "DirCache.h"
+#include "Exclusions.h"
+
+// How many threads remove the files of a package. 0 uses one per online CPU
+#ifndef UNINSTALL_THREADS
+#define UNINSTALL_THREADS 0
+#endif /* UNINSTALL_THREADS */
+
+#define UNINSTALL_MAX_THREADS 16
+
+// Packages with fewer paths than this are removed by a single thread, since starting the others would cost more than it saves
+#define UNINSTALL_PARALLEL_MIN 512
+
+#define REMOVE_ROOT_ERROR -1901
+
+unsigned int uninstallThreads();
+void removeTree(int dirFd, const char* name, bool isDir);
+int removePkgPaths(const std::set<std::string>& pkgContents, std::string root, const ExclusionMatcher& exclusions, unsigned int verbosity = DEFAULT_VERBOSITY, unsigned int threads = uninstallThreads());
+
+#endif /* _THE2B_REMOVE_H */
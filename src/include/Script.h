@@ -0,0 +1,43 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Script.h
+ * @error -1300
+ */
+
+#ifndef _THE2B_SCRIPT_H
+#define _THE2B_SCRIPT_H
+
+#include <stdio.h>          // printf, fprintf, fflush
+#include <errno.h>          // errno
+#include <string.h>         // strerror
+#include <unistd.h>         // write, close
+#include <fcntl.h>          // F_ADD_SEALS
+#include <spawn.h>          // posix_spawn, posix_spawn_file_actions_adddup2
+#include <time.h>           // clock_gettime
+#include <sys/mman.h>       // memfd_create
+#include <sys/stat.h>       // fchmod
+#include <sys/wait.h>       // waitpid
+#include <string>           // std::string
+
+#include "Options.h"
+
+#define SCRIPT_MEMFD_ERROR -1301
+#define SCRIPT_SPAWN_ERROR -1302
+#define SCRIPT_WAIT_ERROR -1303
+
+// Runs the scripts which have no #! line
+#define SCRIPT_SHELL "/bin/sh"
+
+/**
+ * A script captured from a package, kept in memory until it is run
+ */
+struct pkgScript_s {
+    std::string body;
+    mode_t mode = 0755;
+};
+
+int runScript(std::string scriptName, const pkgScript_s& script, std::string pkgName, unsigned int verbosity = DEFAULT_VERBOSITY, double* seconds = NULL);
+
+#endif /* _THE2B_SCRIPT_H */
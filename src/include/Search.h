@@ -0,0 +1,117 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Search.h
+ * @error -1200
+ */
+
+#ifndef _THE2B_SEARCH_H
+#define _THE2B_SEARCH_H
+
+#include <stdio.h>          // printf, fprintf, rename
+#include <stdint.h>         // Fixed-width integers
+#include <errno.h>          // errno
+#include <string.h>         // strerror, memcmp
+#include <unistd.h>         // write, fsync, close
+#include <fcntl.h>          // open
+#include <sys/stat.h>       // stat, fstat
+#include <sys/mman.h>       // mmap, munmap
+#include <sys/file.h>       // flock
+#include <string>           // std::string
+#include <vector>           // vectors
+#include <map>              // maps
+#include <algorithm>        // sort, unique, merge, set_intersection
+#include <iterator>         // back_inserter
+#include <filesystem>       // recursive_directory_iterator
+
+#include "Options.h"
+#include "Manifest.h"
+#include "Pkg.h"
+
+// The index describes the tarball library, but lives with the installed package database, since the library may well be a read-only mirror
+#define SEARCH_FILENAME ".pkg-mgr.search"
+#define SEARCH_LOCK_FILENAME ".pkg-mgr.search.lock"
+#define SEARCH_TMP_FILENAME ".pkg-mgr.search.tmp"
+
+#define SEARCH_MAGIC "PKGSERCH"
+#define SEARCH_MAGIC_SIZE 8
+#define SEARCH_VERSION 1
+
+// Magic, version, package count, path count, trigram count, path table offset, trigram table offset, string area offset, library path length, padding
+#define SEARCH_HEADER_SIZE 64
+
+// Tarball path offset and length, path count, first path, tarball size, tarball mtime
+#define SEARCH_PKG_RECORD_SIZE 40
+
+// String offset and length
+#define SEARCH_PATH_RECORD_SIZE 12
+
+// Trigram, posting count, posting offset
+#define SEARCH_TRIGRAM_RECORD_SIZE 16
+
+#define SEARCH_IO_ERROR -1201
+#define SEARCH_NO_MATCH -1202
+
+/**
+ * A tarball in the library, along with everything the index knows about it
+ */
+struct searchPkg_s {
+    // Relative to the library
+    std::string tarPath;
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    std::vector<std::string> paths;
+};
+
+/**
+ * The search index over the tarball library
+ *
+ * On disk, this is a header, a table of packages sorted by tarball path, a table of the paths each package contains, a table of trigrams, the posting lists of those trigrams, and a string area.
+ * Each trigram's posting list holds the ids of the packages whose name or paths contain it, delta and varint encoded.
+ * A substring query intersects the posting lists of the query's trigrams, and only reads the paths of the packages which survive, so it never touches the tarballs themselves.
+ *
+ * Trigrams are built from lowercased text, so searches ignore ASCII case.
+ * Every package records the size and mtime of its tarball. Refreshing the index only reads tarballs for which those changed.
+ */
+class SearchIndex {
+    private:
+        unsigned int verbosity;
+
+        // Either a mapped index file, or an index which was built but could not be saved
+        const char* data = NULL;
+        size_t dataSize = 0;
+        bool mapped = false;
+        std::string owned;
+
+        bool valid = false;
+        uint32_t pkgCount = 0;
+        uint64_t pathCount = 0;
+        uint64_t trigramCount = 0;
+        uint64_t pathTableOffset = 0;
+        uint64_t trigramTableOffset = 0;
+        uint64_t stringsOffset = 0;
+        std::string libraryPath;
+
+        bool validate();
+        std::string stringAt(uint64_t offset, uint64_t len);
+
+    public:
+        SearchIndex(std::string installedPkgsPath, unsigned int verbosity = DEFAULT_VERBOSITY, std::string buf = "");
+        ~SearchIndex();
+        SearchIndex(const SearchIndex&) = delete;
+        SearchIndex& operator=(const SearchIndex&) = delete;
+
+        bool isValid();
+        std::string getLibraryPath();
+        uint32_t getPkgCount();
+        bool getPkg(uint32_t id, searchPkg_s& pkg, bool withPaths);
+        std::vector<uint32_t> getTrigrams();
+        std::vector<uint32_t> getPostings(uint32_t trigram);
+        std::vector<uint32_t> findCandidates(const std::vector<std::string>& terms);
+};
+
+int refreshSearchIndex(std::string libraryPath, std::string installedPkgsPath, std::string& unsaved, unsigned int verbosity = DEFAULT_VERBOSITY);
+int searchLibrary(std::vector<std::string> terms, std::string libraryPath, std::string installedPkgsPath, unsigned int verbosity = DEFAULT_VERBOSITY);
+
+#endif /* _THE2B_SEARCH_H */
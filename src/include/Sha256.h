@@ -0,0 +1,50 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Sha256.h
+ * @error -2300
+ */
+
+#ifndef _THE2B_SHA256_H
+#define _THE2B_SHA256_H
+
+#include <stdint.h>         // Fixed-width integers
+#include <stdlib.h>         // malloc, free
+#include <errno.h>          // errno
+#include <string.h>         // memcpy
+#include <unistd.h>         // pread
+#include <string>           // std::string
+
+// The size of a digest, in bytes
+#define SHA256_DIGEST_SIZE 32
+#define SHA256_BLOCK_SIZE 64
+
+// How much of a file is read at once when hashing it
+#define SHA256_READ_SIZE (1 << 20)
+
+/**
+ * An incremental SHA-256 (FIPS 180-4)
+ * Feed it with update() as often as needed, then call digest() once
+ */
+class Sha256 {
+    private:
+        uint32_t state[8];
+        unsigned char block[SHA256_BLOCK_SIZE];
+        size_t blockUsed = 0;
+        uint64_t totalBytes = 0;
+
+        void compress(const unsigned char* data);
+
+    public:
+        Sha256();
+
+        void update(const void* data, size_t len);
+        std::string digest();
+};
+
+std::string sha256(const void* data, size_t len);
+bool sha256File(int fd, off_t len, std::string& digest, off_t offset = 0);
+std::string hexDigest(const std::string& digest);
+
+#endif /* _THE2B_SHA256_H */
@@ -0,0 +1,49 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Stage.h
+ * @error -2100
+ */
+
+#ifndef _THE2B_STAGE_H
+#define _THE2B_STAGE_H
+
+#include <stdio.h>          // printf, fprintf
+#include <stdlib.h>         // strtol
+#include <errno.h>          // errno
+#include <string.h>         // strerror
+#include <unistd.h>         // syncfs, getpid, syscall
+#include <signal.h>         // kill
+#include <fcntl.h>          // openat, renameat
+#include <dirent.h>         // fdopendir, readdir
+#include <sys/stat.h>       // fstatat, mkdirat, fchmodat
+#include <sys/syscall.h>    // SYS_renameat2
+#include <string>           // std::string
+#include <vector>           // vectors
+#include <atomic>           // std::atomic
+
+#include "Options.h"
+#include "DirCache.h"
+#include "Remove.h"
+
+// The directory under the system root packages are extracted into before being moved into place. A rename can't cross filesystems, so it has to live in the root
+#define STAGE_DIR_NAME ".pkg-mgr-stage"
+
+// The renameat2 flags, for C libraries too old to have them
+#ifndef RENAME_NOREPLACE
+#define RENAME_NOREPLACE (1 << 0)
+#endif /* RENAME_NOREPLACE */
+
+#ifndef RENAME_EXCHANGE
+#define RENAME_EXCHANGE (1 << 1)
+#endif /* RENAME_EXCHANGE */
+
+#define STAGE_DIR_ERROR -2101
+#define STAGE_COMMIT_ERROR -2102
+
+int makeStagingDir(std::string root, std::string pkgName, std::string& stagePath, unsigned int verbosity = DEFAULT_VERBOSITY);
+int commitStaged(std::string stagePath, std::string root, unsigned int verbosity = DEFAULT_VERBOSITY);
+void discardStaged(std::string root, std::string stagePath);
+
+#endif /* _THE2B_STAGE_H */
@@ -0,0 +1,123 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file Store.h
+ * @error -2400
+ */
+
+#ifndef _THE2B_STORE_H
+#define _THE2B_STORE_H
+
+#include <stdio.h>          // printf, fprintf
+#include <stdint.h>         // Fixed-width integers
+#include <errno.h>          // errno
+#include <string.h>         // strerror
+#include <unistd.h>         // read, write, close, linkat, getpid
+#include <fcntl.h>          // openat, renameat
+#include <dirent.h>         // fdopendir, readdir
+#include <sys/stat.h>       // fstatat, mkdirat, fchmod, utimensat
+#include <sys/file.h>       // flock
+#include <sys/ioctl.h>      // ioctl
+#include <string>           // std::string
+#include <vector>           // vectors
+#include <unordered_map>    // Objects and their reference counts
+#include <atomic>           // Temporary file names
+#include <algorithm>        // std::sort
+
+#include "Options.h"
+#include "TarReader.h"
+#include "DirCache.h"
+#include "Exclusions.h"
+#include "Extract.h"
+#include "WriterPool.h"
+#include "Durability.h"
+#include "Manifest.h"
+#include "Sha256.h"
+
+#ifdef HAVE_LINUX_FS_H
+#include <linux/fs.h>       // FICLONE
+#endif /* HAVE_LINUX_FS_H */
+
+// The layout of a store: One file per distinct content and mode under objects, fanned out by the first byte of the hash, and one index per package under pkgs
+#define STORE_OBJECTS_DIR "objects"
+#define STORE_PKGS_DIR "pkgs"
+#define STORE_TMP_DIR "tmp"
+#define STORE_LOCK_NAME "lock"
+
+// The first bytes of every package index, followed by the format version
+#define STORE_INDEX_MAGIC "PKGSTOR"
+#define STORE_INDEX_MAGIC_SIZE 8
+#define STORE_INDEX_VERSION 1
+
+// Set on an index entry which was excluded when the package was stored, so there is nothing to put in its place
+#define STORE_ENTRY_ABSENT 1
+
+// Not an error; materialize() couldn't install the package, and the tarball has to be extracted
+#define STORE_MISS -2401
+#define STORE_OPEN_ERROR -2402
+#define STORE_INDEX_ERROR -2403
+#define STORE_OBJECT_ERROR -2404
+#define STORE_ENTRY_ERROR -2405
+#define STORE_ROOT_ERROR -2406
+#define STORE_DIRECTORY_ERROR -2407
+#define STORE_SYMLINK_ERROR -2408
+
+/**
+ * A single entry of a stored package, in archive order
+ * Regular files carry the hash of their contents, which together with the mode names their object
+ */
+struct storeEntry_s {
+    std::string path;
+    std::string linkTarget;
+    char type = TAR_TYPE_REGULAR;
+    unsigned char flags = 0;
+    mode_t mode = 0;
+    off_t size = 0;
+    std::string hash;
+};
+
+/**
+ * A content addressed store of unpacked packages, shared by every root installed into
+ *
+ * The first time a package is installed, each of its files is hashed and added to the store, unless the store already has that content. An index records the package's entries, in archive order, and which object each file is.
+ * Installing the same tarball again replays the index instead of reading the tarball. A file is cloned from its object with FICLONE where the filesystem shares extents, hard linked to it if asked to, and copied otherwise.
+ * Hard links are only used when asked for, since the installed file and the object are then the same inode; Changing one changes the other, and every root installed from it.
+ *
+ * The store is capped in size. Once over the cap, the packages used longest ago are dropped, along with any objects no other package uses.
+ * Installs hold a shared lock on the store, and the garbage collector an exclusive one, so nothing is collected while a package is being installed from it.
+ */
+class ContentStore {
+    private:
+        std::string path;
+        bool hardlinks;
+        unsigned long long maxBytes;
+        unsigned int verbosity;
+
+        int storeFd = -1;
+        int objectsFd = -1;
+        int pkgsFd = -1;
+        int tmpFd = -1;
+        std::atomic<unsigned long> tmpSeq;
+
+        int lockStore(int operation);
+        bool readIndex(std::string name, std::vector<storeEntry_s>& entries, off_t* tarSize, struct timespec* tarMtime);
+        bool writeIndex(std::string name, const std::vector<storeEntry_s>& entries, const struct stat& tarStat);
+        int addObject(int srcFd, const std::string& hash, mode_t mode, off_t size);
+        int placeFile(int dirFd, const std::string& leaf, const storeEntry_s& e, const std::string& dest, WritebackTracker* durability, const std::string& rel, unsigned long* counts);
+
+    public:
+        ContentStore(std::string path, bool hardlinks = DEFAULT_STORE_HARDLINKS, unsigned long long maxBytes = DEFAULT_STORE_SIZE * 1024ULL * 1024ULL, unsigned int verbosity = DEFAULT_VERBOSITY);
+        ~ContentStore();
+        ContentStore(const ContentStore&) = delete;
+        ContentStore& operator=(const ContentStore&) = delete;
+
+        bool isOpen();
+        int materialize(std::string tarPath, std::string pkgName, std::string root, const ExclusionMatcher& exclusions, WritebackTracker* durability = NULL);
+        int populate(std::string tarPath, std::string pkgName, const std::vector<tarMember_s>& members, std::string root, const ExclusionMatcher& exclusions);
+        int collectGarbage();
+};
+
+std::string storeObjectName(const std::string& hash, mode_t mode);
+
+#endif /* _THE2B_STORE_H */
@@ -0,0 +1,81 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file TarReader.h
+ * @error -600
+ */
+
+#ifndef _THE2B_TAR_READER_H
+#define _THE2B_TAR_READER_H
+
+#include <stdio.h>      // printf, fprintf
+#include <stdlib.h>     // atoll
+#include <stdint.h>     // Fixed-width integers
+#include <limits.h>     // LLONG_MAX
+#include <errno.h>      // errno
+#include <string.h>     // strerror, memcmp
+#include <unistd.h>     // pread
+#include <sys/types.h>  // off_t, mode_t
+#include <sys/stat.h>   // fstat
+#include <string>       // std::string
+#include <vector>       // vectors
+
+#include "Options.h"
+
+// A tar file has a blocksize of 512
+#ifndef TAR_BLOCKSIZE
+#define TAR_BLOCKSIZE 512
+#endif /* TAR_BLOCKSIZE */
+
+// Typeflags we understand. Anything else is left to libarchive
+#define TAR_TYPE_REGULAR '0'
+#define TAR_TYPE_REGULAR_OLD '\0'
+#define TAR_TYPE_HARDLINK '1'
+#define TAR_TYPE_SYMLINK '2'
+#define TAR_TYPE_CHAR '3'
+#define TAR_TYPE_BLOCK '4'
+#define TAR_TYPE_DIRECTORY '5'
+#define TAR_TYPE_FIFO '6'
+#define TAR_TYPE_CONTIGUOUS '7'
+#define TAR_TYPE_PAX_LOCAL 'x'
+#define TAR_TYPE_PAX_GLOBAL 'g'
+#define TAR_TYPE_GNU_LONGNAME 'L'
+#define TAR_TYPE_GNU_LONGLINK 'K'
+
+// The return value of readTarMembers when the archive uses something we can't seek through on our own
+#define TAR_UNSUPPORTED -601
+
+/**
+ * A single member of a tar archive, as seen by our own header walker
+ * Offsets are relative to the start of the archive, so the data of a regular file lives at [dataOffset, dataOffset + size)
+ */
+struct tarMember_s {
+    std::string path;
+    std::string linkTarget;
+    char type = TAR_TYPE_REGULAR;
+    mode_t mode = 0;
+    uid_t uid = 0;
+    gid_t gid = 0;
+    off_t size = 0;
+    time_t mtime = 0;
+    off_t headerOffset = 0;
+    off_t dataOffset = 0;
+
+    // Set when the member carries something (xattrs, ACLs, sparse maps, device numbers) only libarchive knows how to restore
+    bool needsFallback = false;
+
+    // The raw SHA-256 of a regular file's data. Only known when the members were read from a package index
+    std::string hash;
+};
+
+long long parseTarNumber(const char* field, size_t len);
+std::string tarString(const char* field, size_t len);
+bool isValidTarHeader(const char* block);
+bool isPlainTar(int fd);
+int readTarMembers(int fd, std::vector<tarMember_s>& members, unsigned int verbosity = DEFAULT_VERBOSITY);
+bool isRegularTarType(char type);
+bool readTarRange(int fd, off_t offset, off_t size, std::string& data);
+std::string normalizeMemberPath(std::string path);
+
+#endif /* _THE2B_TAR_READER_H */
@@ -0,0 +1,122 @@
+/**
+ * @author Thomas Lenz <thomas.lenz96@gmail.com> AS The2b
+ * @date 16 October 2026
+ * @project Package Manager
+ * @file WriterPool.h
+ * @error -1500
+ */
+
+#ifndef _THE2B_WRITER_POOL_H
+#define _THE2B_WRITER_POOL_H
+
+#include <stdio.h>              // printf, fprintf
+#include <stdlib.h>             // malloc, free
+#include <errno.h>              // errno
+#include <string.h>             // strerror
+#include <unistd.h>             // close
+#include <sys/stat.h>           // fchmod
+#include <sys/xattr.h>          // fsetxattr
+#include <string>               // std::string
+#include <vector>               // vectors
+#include <deque>                // The job queue
+#include <unordered_map>        // Paths being written
+#include <thread>               // std::thread
+#include <mutex>                // std::mutex
+#include <condition_variable>   // std::condition_variable
+
+#include "Options.h"
+#include "Durability.h"
+
+// The size of each pooled data buffer
+#define WRITER_BUFFER_SIZE (1 << 20)
+
+// How many buffers, and how many queued files, each writer thread gets. Together they bound the memory an extraction can use
+#define WRITER_BUFFERS_PER_THREAD 8
+#define WRITER_JOBS_PER_THREAD 64
+
+#define WRITER_CREATE_ERROR -1501
+#define WRITER_WRITE_ERROR -1502
+#define WRITER_XATTR_ERROR -1503
+
+/**
+ * A regular file, ready to be written out by one of the writers
+ * Its data either still sits in the archive, at srcOffset in srcFd, or was already decoded into buffers from the pool
+ */
+struct writeJob_s {
+    // The directory the file goes in, and its name there. The job owns dirFd
+    int dirFd = -1;
+    std::string leaf;
+
+    // The canonical path, relative to the root, and the full path for messages
+    std::string rel;
+    std::string dest;
+
+    mode_t mode = 0644;
+    off_t size = 0;
+
+    int srcFd = -1;
+    off_t srcOffset = 0;
+
+    std::vector<std::pair<char*, size_t>> chunks;
+    std::vector<std::pair<std::string, std::string>> xattrs;
+};
+
+/**
+ * A pool of threads writing out the regular files of one extraction
+ *
+ * The archive is read by a single thread, which keeps everything whose order matters for itself: Directories, links, and the members libarchive has to restore. Only regular files are handed to the pool.
+ * Both the queue and the buffers are bounded, so a decoder running ahead of the disk blocks instead of reading the whole package into memory.
+ * A path stays marked as in flight until its file has been written, so the decoder can wait on it before touching the same path again.
+ */
+class WriterPool {
+    private:
+        unsigned int verbosity;
+        WritebackTracker* durability;
+        size_t maxJobs;
+        size_t maxBuffers;
+
+        std::vector<std::thread> threads;
+        std::deque<writeJob_s> queue;
+        std::unordered_map<std::string, unsigned int> inFlight;
+        std::vector<char*> buffers;
+        std::vector<char*> freeBuffers;
+
+        std::mutex lock;
+        std::condition_variable workReady;
+        std::condition_variable queueSpace;
+        std::condition_variable bufferFree;
+        std::condition_variable jobDone;
+
+        unsigned int active = 0;
+        bool stopping = false;
+        int error = 0;
+        unsigned long filesWritten = 0;
+        unsigned long long bytesWritten = 0;
+
+        void work();
+        int writeFile(writeJob_s& job);
+
+    public:
+        WriterPool(unsigned int writers, unsigned int verbosity = DEFAULT_VERBOSITY, WritebackTracker* durability = NULL);
+        ~WriterPool();
+        WriterPool(const WriterPool&) = delete;
+        WriterPool& operator=(const WriterPool&) = delete;
+
+        char* acquireBuffer();
+        void releaseBuffer(char* buf);
+        size_t getMaxBuffers();
+        WritebackTracker* getDurability();
+
+        void submit(writeJob_s& job);
+        void waitForPath(const std::string& rel);
+        int drain();
+
+        int getError();
+        unsigned long getFilesWritten();
+        unsigned long long getBytesWritten();
+};
+
+bool writeBuffer(int fd, const char* buf, size_t len);
+int restoreXattrs(int fd, const std::vector<std::pair<std::string, std::string>>& xattrs);
+
+#endif /* _THE2B_WRITER_POOL_H */
@@ -16,6 +16,7 @@
 import os
 import sys
 import shutil
+import subprocess
 
 __TEST_ENV_ROOT_DIR = str(os.getcwd() + "/" + os.path.dirname(sys.argv[0]) + "/follow-test-env/")
 __TEST_ENV_INSTALLED_PKG_DIR = str(__TEST_ENV_ROOT_DIR + "/installed/")
@@ -25,12 +26,16 @@ NUM_TEST_TARS = 5
 
 PKG_MGR_PATH = os.environ['PKG_MGR_PATH']
 
-# @TODO
+# The installed packages live in a single database file, so ask pkg-mgr which ones it knows about
+def listInstalledPkgs(installedPkgDir):
+    cmdStr = str(PKG_MGR_PATH + " -mli -i " + installedPkgDir + " -v 1")
+    return subprocess.run(cmdStr, shell=True, stdout=subprocess.PIPE, universal_newlines=True).stdout.splitlines()
+
 def isIndexFileInstalledCorrectly(pkgName, installedPkgDir):
-    if(os.path.isfile(str(installedPkgDir + "/" + pkgName))):
+    if(pkgName in listInstalledPkgs(installedPkgDir)):
         return True
     else:
-        print("File %s could not be found during follow test. Exiting." % (installedPkgDir + "/" + pkgName))
+        print("Package %s could not be found in the database in %s during follow test. Exiting." % (pkgName, installedPkgDir))
         return False
 
 def followPkg(pkgName, installedPkgPath, tarLibrary, verbosity):
@@ -61,6 +61,17 @@ def extractTarFile(pkgName, tarLibPath, installedPkgPath, systemRoot, verbosity)
     retVal = os.system(cmdStr)
     return retVal
 
+# Installs a batch of packages on several jobs, one of which can't be read, and returns pkg-mgr's exit status
+# The good package is a copy of one of the test packages, so the failure can only come from the broken one
+def installBrokenBatch(tarLibPath, installedPkgPath, systemRoot):
+    os.mkdir(tarLibPath)
+    shutil.copyfile(__TEST_PKGS_DIR + "test2.tar", tarLibPath + "good.tar")
+    with open(tarLibPath + "broken.tar", "wb") as f:
+        f.write(b"This is not a tarball\n" * 64)
+
+    cmdStr = str(PKG_MGR_PATH + " -mi -j 2 -s " + systemRoot + " -l " + tarLibPath + " -i " + installedPkgPath + " -v 0 -g " + __TEST_CONFIG_PATH + " -u " + __TEST_CONFIG_PATH + " good broken")
+    return os.system(cmdStr)
+
 def checkScript(scriptName, tarPath):
     # The path build here is equal to "/tmp/" + pkgName + (scriptName sans extention)
     scriptType = os.path.splitext(scriptName)[0]
@@ -158,4 +169,10 @@ if __name__ == '__main__':
             print("Error: pkg-mgr failed to install the package %s correctly. The script %s failed to extract and execute correctly. The file %s was missing. Exiting..." % (pkgName,res[1],res[2]))
             sys.exit(3)
 
+    print("Installing a batch with a broken package on several jobs...")
+    if(installBrokenBatch(__TEST_ENV_ROOT_DIR + "broken-library/", __TEST_ENV_INSTALLED_PKG_DIR, __TEST_ENV_ROOT_DIR) == 0):
+        print("Error: pkg-mgr exited successfully after failing to install a package in a batch. Exiting...")
+        sys.exit(4)
+    print("The failed batch install exited with an error!")
+
     removeDirTree(__TEST_ENV_ROOT_DIR)
@@ -16,6 +16,7 @@
 import os
 import sys
 import shutil
+import subprocess
 
 __TEST_ENV_ROOT_DIR = str(os.getcwd() + "/" + os.path.dirname(sys.argv[0]) + "/unfollow-test-env/")
 __TEST_ENV_INSTALLED_PKG_DIR = str(__TEST_ENV_ROOT_DIR + "installed/")
@@ -25,12 +26,17 @@ NUM_TEST_TARS = 5
 
 PKG_MGR_PATH = os.environ['PKG_MGR_PATH']
 
-# @TODO
+# The installed packages live in a single database file, so ask pkg-mgr which ones it knows about
+# The index files created by this test use the legacy one-file-per-package layout, which pkg-mgr imports on the first unfollow
+def listInstalledPkgs(installedPkgDir):
+    cmdStr = str(PKG_MGR_PATH + " -mli -i " + installedPkgDir + " -v 1")
+    return subprocess.run(cmdStr, shell=True, stdout=subprocess.PIPE, universal_newlines=True).stdout.splitlines()
+
 def isIndexFileUninstalledCorrectly(pkgName, installedPkgDir):
-    if(not os.path.isfile(str(installedPkgDir + "/" + pkgName))):
+    if(not os.path.isfile(str(installedPkgDir + "/" + pkgName)) and pkgName not in listInstalledPkgs(installedPkgDir)):
         return True
     else:
-        print("File %s was found after unfollow test. Exiting." % (installedPkgDir + "/" + pkgName))
+        print("Package %s was still followed in %s after unfollow test. Exiting." % (pkgName, installedPkgDir))
         return False
 
 def unfollowPkg(pkgName, installedPkgPath, tarLibrary, verbosity):
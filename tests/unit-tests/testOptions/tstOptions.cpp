@@ -194,7 +194,30 @@ void OptionsTest::testApplyConfig() {
         CPPUNIT_ASSERT(opts->getInstalledPkgsPath() != mockMap[KEY_INSTALLED_PKG_PATH]);
     }
     
-    //CPPUNIT_ASSERT(opts->getExcludedFiles() == mockMap[KEY_EXCLUDED_FILES]);
+    CPPUNIT_ASSERT(opts->getExcludedFiles() == std::set<std::string>({ "/tmp/bin/test1", "usr/share/doc/**" }));
+
+    CPPUNIT_ASSERT(std::to_string(opts->getJobs()) == mockMap[KEY_JOBS]);
+
+    CPPUNIT_ASSERT(std::to_string(opts->getWriters()) == mockMap[KEY_WRITERS]);
+
+    CPPUNIT_ASSERT(opts->getQuarantine());
+
+    CPPUNIT_ASSERT(opts->getStaged());
+
+    CPPUNIT_ASSERT(opts->getDurability() == DURABILITY_PACKAGE);
+
+    CPPUNIT_ASSERT(opts->getStorePath() == mockMap[KEY_STORE_PATH]);
+
+    CPPUNIT_ASSERT(opts->getStoreHardlinks());
+
+    CPPUNIT_ASSERT(std::to_string(opts->getStoreSize()) == mockMap[KEY_STORE_SIZE]);
+
+    CPPUNIT_ASSERT(opts->getFanoutRoots() == std::vector<std::string>({ "/tmp/root1", "/tmp/root2:/tmp/root2-pkgs" }));
+
+    CPPUNIT_ASSERT(std::to_string(opts->getPrefetchDepth()) == mockMap[KEY_PREFETCH_DEPTH]);
+
+    CPPUNIT_ASSERT(std::to_string(opts->getPrefetchSize()) == mockMap[KEY_PREFETCH_SIZE]);
+    CPPUNIT_ASSERT(opts->getMemberCachePath() == mockMap[KEY_MEMBER_CACHE_PATH]);
 
     postTestApplyConfig();
 }
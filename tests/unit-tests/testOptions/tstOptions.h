@@ -63,7 +63,19 @@ class MockConfigMap : public IConfigMap {
             { KEY_SYSTEM_ROOT, "/tmp/" },
             { KEY_TAR_LIBRARY_PATH, "/tmp/" },
             { KEY_INSTALLED_PKG_PATH, "/tmp/" },
-            //{ KEY_EXCLUDED_FILES, "/tmp/bin/test1,/tmp/bin/test2" }
+            { KEY_JOBS, "4" },
+            { KEY_WRITERS, "8" },
+            { KEY_QUARANTINE, "true" },
+            { KEY_STAGED, "yes" },
+            { KEY_DURABILITY, "package" },
+            { KEY_STORE_PATH, "/tmp/pkg-store" },
+            { KEY_STORE_HARDLINKS, "on" },
+            { KEY_STORE_SIZE, "512" },
+            { KEY_FANOUT_ROOTS, "/tmp/root1, /tmp/root2:/tmp/root2-pkgs" },
+            { KEY_PREFETCH_DEPTH, "3" },
+            { KEY_PREFETCH_SIZE, "128" },
+            { KEY_MEMBER_CACHE_PATH, "/tmp/pkg-member-cache" },
+            { KEY_EXCLUDED_FILES, "/tmp/bin/test1, usr/share/doc/**" },
         };
 
         std::map<std::string, std::string>* getConfigMap();
@@ -0,0 +1,302 @@
+#include "tstArchiveInput.h"
+
+CppUnit::Test* ArchiveInputTest::suite() {
+    CppUnit::TestSuite* suite = new CppUnit::TestSuite( "ArchiveInputTest" );
+
+    suite->addTest( new CppUnit::TestCaller<ArchiveInputTest>( "testSmallPkgIsMapped", &ArchiveInputTest::testSmallPkgIsMapped ));
+    suite->addTest( new CppUnit::TestCaller<ArchiveInputTest>( "testLargePkgIsReadInBlocks", &ArchiveInputTest::testLargePkgIsReadInBlocks ));
+    suite->addTest( new CppUnit::TestCaller<ArchiveInputTest>( "testSkipMovesPastData", &ArchiveInputTest::testSkipMovesPastData ));
+    suite->addTest( new CppUnit::TestCaller<ArchiveInputTest>( "testSkippedMembersLeaveHeadersInPlace", &ArchiveInputTest::testSkippedMembersLeaveHeadersInPlace ));
+    suite->addTest( new CppUnit::TestCaller<ArchiveInputTest>( "testFifoIsReadThrough", &ArchiveInputTest::testFifoIsReadThrough ));
+    suite->addTest( new CppUnit::TestCaller<ArchiveInputTest>( "testInstallFallbackMembersAfterSkips", &ArchiveInputTest::testInstallFallbackMembersAfterSkips ));
+
+    return suite;
+}
+
+void ArchiveInputTest::setUp() {
+    CPPUNIT_ASSERT(makeTestDirs({ ARCHIVE_INPUT_BASE_DIR, ARCHIVE_INPUT_PKG_DIR, ARCHIVE_INPUT_INSTALLED_DIR, ARCHIVE_INPUT_ROOT }));
+}
+
+void ArchiveInputTest::tearDown() {
+    removeTestDir(ARCHIVE_INPUT_BASE_DIR);
+}
+
+// Data which differs from one file to the next, so reading from the wrong offset shows
+static std::string fileData(unsigned int seed, size_t size) {
+    std::string data(size, '\0');
+    uint32_t state = seed * 2654435761u + 1;
+    for(size_t index = 0; index < size; index++) {
+        state = state * 1103515245u + 12345u;
+        data[index] = (char)(state >> 24);
+    }
+
+    return data;
+}
+
+// Reads the data of the member libarchive is on
+static std::string readEntryData(struct archive* a) {
+    std::string data;
+    char buf[8192];
+    la_ssize_t r;
+    while((r = archive_read_data(a, buf, sizeof(buf))) > 0) {
+        data.append(buf, r);
+    }
+
+    CPPUNIT_ASSERT(r == 0);
+    return data;
+}
+
+// Forks a child which writes data into the FIFO at path, once something opens it for reading
+static pid_t feedFifo(const std::string& path, const std::string& data) {
+    pid_t pid = fork();
+    if(pid == 0) {
+        int fd = open(path.c_str(), O_WRONLY);
+        size_t done = 0;
+        while(fd >= 0 && done < data.size()) {
+            ssize_t w = write(fd, data.data() + done, data.size() - done);
+            if(w <= 0) {
+                _exit(1);
+            }
+
+            done += w;
+        }
+
+        _exit(fd >= 0 ? 0 : 1);
+    }
+
+    return pid;
+}
+
+// Members just under, at, just over, and several times the size of the smallest read buffer, with small ones between them, so headers land all over the blocks read
+std::vector<testMember_s> ArchiveInputTest::largePkgMembers() {
+    const std::vector<std::pair<std::string, size_t>> sizes = {
+        { "small-0", 100 },
+        { "below-window", ARCHIVE_READ_BUFFER_MIN - 1 },
+        { "window", ARCHIVE_READ_BUFFER_MIN },
+        { "above-window", ARCHIVE_READ_BUFFER_MIN + 1 },
+        { "small-1", 513 },
+        { "many-windows", 3 * ARCHIVE_READ_BUFFER_MIN + 511 },
+        { "two-windows", 2 * ARCHIVE_READ_BUFFER_MIN + 100 },
+        { "small-2", 1 },
+        { "tail", ARCHIVE_READ_BUFFER_MIN / 2 + 7 },
+    };
+
+    std::vector<testMember_s> members;
+    for(size_t index = 0; index < sizes.size(); index++) {
+        testMember_s m;
+        m.path = sizes[index].first;
+        m.data = fileData(index, sizes[index].second);
+        members.push_back(m);
+
+        if(m.path == "small-1") {
+            testMember_s link;
+            link.path = "link";
+            link.type = TAR_TYPE_SYMLINK;
+            link.linkTarget = "small-0";
+            members.push_back(link);
+        }
+    }
+
+    return members;
+}
+
+// Writes the large package, which is too big to be mapped in the tests
+std::string ArchiveInputTest::writeLargePkg(const std::string& name, int format) {
+    std::string path = ARCHIVE_INPUT_PKG_DIR + name + ".tar";
+    CPPUNIT_ASSERT(writeTestTar(path, largePkgMembers(), format));
+
+    struct stat st;
+    CPPUNIT_ASSERT(stat(path.c_str(), &st) == 0);
+    CPPUNIT_ASSERT(st.st_size > ARCHIVE_MMAP_MAX);
+
+    return path;
+}
+
+// A package no larger than ARCHIVE_MMAP_MAX is handed over whole, on the first read, and can't be skipped through with lseek
+void ArchiveInputTest::testSmallPkgIsMapped() {
+    testMember_s m;
+    m.path = "file";
+    m.data = fileData(1, 1000);
+
+    std::string path = ARCHIVE_INPUT_PKG_DIR "small.tar";
+    CPPUNIT_ASSERT(writeTestTar(path, { m }));
+    std::string expected = readTestFile(path);
+
+    ArchiveInput input(path, 0);
+    CPPUNIT_ASSERT(input.open() == 0);
+    CPPUNIT_ASSERT(!input.isSeekable());
+
+    const void* buf = NULL;
+    CPPUNIT_ASSERT(input.read(&buf) == (la_ssize_t)expected.size());
+    CPPUNIT_ASSERT(memcmp(buf, expected.data(), expected.size()) == 0);
+    CPPUNIT_ASSERT(input.read(&buf) == 0);
+}
+
+// A larger one is read in blocks of at least ARCHIVE_READ_BUFFER_MIN, which add up to the package
+void ArchiveInputTest::testLargePkgIsReadInBlocks() {
+    std::string path = writeLargePkg("large");
+    std::string expected = readTestFile(path);
+
+    ArchiveInput input(path, 0);
+    CPPUNIT_ASSERT(input.open() == 0);
+    CPPUNIT_ASSERT(input.isSeekable());
+
+    std::string data;
+    const void* buf = NULL;
+    la_ssize_t r;
+    while((r = input.read(&buf)) > 0) {
+        CPPUNIT_ASSERT(r <= ARCHIVE_READ_BUFFER_MAX);
+        CPPUNIT_ASSERT(r >= ARCHIVE_READ_BUFFER_MIN || data.size() + r == expected.size());
+        data.append((const char*)buf, r);
+    }
+
+    CPPUNIT_ASSERT(r == 0);
+    CPPUNIT_ASSERT(data == expected);
+}
+
+// Skipping moves past exactly what was asked for, from wherever the last read left off, even past the end of the package
+void ArchiveInputTest::testSkipMovesPastData() {
+    std::string path = writeLargePkg("skip");
+    std::string expected = readTestFile(path);
+
+    ArchiveInput input(path, 0);
+    CPPUNIT_ASSERT(input.open() == 0);
+
+    const void* buf = NULL;
+    la_ssize_t first = input.read(&buf);
+    CPPUNIT_ASSERT(first > 0);
+
+    const la_int64_t request = ARCHIVE_READ_BUFFER_MIN + 3;
+    CPPUNIT_ASSERT(input.skip(request) == request);
+
+    la_ssize_t second = input.read(&buf);
+    CPPUNIT_ASSERT(second > 0);
+    CPPUNIT_ASSERT(std::string((const char*)buf, second) == expected.substr(first + request, second));
+
+    CPPUNIT_ASSERT(input.skip(expected.size()) == (la_int64_t)expected.size());
+    CPPUNIT_ASSERT(input.read(&buf) == 0);
+}
+
+// libarchive skips the data of every other member. Each header still has to be found where the tar walker finds it, and the data read in between has to be intact
+void ArchiveInputTest::testSkippedMembersLeaveHeadersInPlace() {
+    std::string path = writeLargePkg("headers");
+    std::vector<testMember_s> members = largePkgMembers();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    CPPUNIT_ASSERT(fd >= 0);
+    std::vector<tarMember_s> walked;
+    CPPUNIT_ASSERT(readTarMembers(fd, walked, 0) == 0);
+    close(fd);
+    CPPUNIT_ASSERT(walked.size() == members.size());
+
+    struct archive* a = archive_read_new();
+    archive_read_support_format_tar(a);
+    CPPUNIT_ASSERT(openArchiveInput(a, path, 0) == ARCHIVE_OK);
+
+    struct archive_entry* ae;
+    size_t index = 0;
+    int res;
+    while((res = archive_read_next_header(a, &ae)) == ARCHIVE_OK) {
+        CPPUNIT_ASSERT(index < members.size());
+        CPPUNIT_ASSERT(members[index].path == archive_entry_pathname(ae));
+        CPPUNIT_ASSERT(archive_read_header_position(a) == walked[index].headerOffset);
+
+        if(index % 2 == 1 && members[index].type == TAR_TYPE_REGULAR) {
+            CPPUNIT_ASSERT(readEntryData(a) == members[index].data);
+        }
+
+        index++;
+    }
+
+    CPPUNIT_ASSERT(res == ARCHIVE_EOF);
+    CPPUNIT_ASSERT(index == members.size());
+    archive_read_free(a);
+}
+
+// A package piped in can't be skipped through, so it's read in blocks, and libarchive reads past the data it doesn't need
+void ArchiveInputTest::testFifoIsReadThrough() {
+    std::string path = writeLargePkg("fifo-src");
+    std::string expected = readTestFile(path);
+    std::vector<testMember_s> members = largePkgMembers();
+
+    std::string fifo = ARCHIVE_INPUT_PKG_DIR "fifo.tar";
+    CPPUNIT_ASSERT(mkfifo(fifo.c_str(), 0644) == 0);
+
+    pid_t pid = feedFifo(fifo, expected);
+    CPPUNIT_ASSERT(pid > 0);
+    {
+        ArchiveInput input(fifo, 0);
+        CPPUNIT_ASSERT(input.open() == 0);
+        CPPUNIT_ASSERT(!input.isSeekable());
+
+        std::string data;
+        const void* buf = NULL;
+        la_ssize_t r;
+        while((r = input.read(&buf)) > 0) {
+            data.append((const char*)buf, r);
+        }
+
+        CPPUNIT_ASSERT(r == 0);
+        CPPUNIT_ASSERT(data == expected);
+    }
+
+    int status;
+    CPPUNIT_ASSERT(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    pid = feedFifo(fifo, expected);
+    CPPUNIT_ASSERT(pid > 0);
+
+    struct archive* a = archive_read_new();
+    archive_read_support_format_tar(a);
+    CPPUNIT_ASSERT(openArchiveInput(a, fifo, 0) == ARCHIVE_OK);
+
+    struct archive_entry* ae;
+    size_t index = 0;
+    int res;
+    while((res = archive_read_next_header(a, &ae)) == ARCHIVE_OK) {
+        CPPUNIT_ASSERT(index < members.size());
+        CPPUNIT_ASSERT(members[index].path == archive_entry_pathname(ae));
+
+        if(index % 2 == 1 && members[index].type == TAR_TYPE_REGULAR) {
+            CPPUNIT_ASSERT(readEntryData(a) == members[index].data);
+        }
+
+        index++;
+    }
+
+    CPPUNIT_ASSERT(res == ARCHIVE_EOF);
+    CPPUNIT_ASSERT(index == members.size());
+    archive_read_free(a);
+
+    CPPUNIT_ASSERT(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+// Members carrying xattrs are left to libarchive, which skips over everything the zero-copy engine already wrote to reach them
+void ArchiveInputTest::testInstallFallbackMembersAfterSkips() {
+    std::vector<testMember_s> members = largePkgMembers();
+    for(auto& m : members) {
+        if(m.path == "above-window" || m.path == "tail") {
+            m.xattrs["user.test"] = m.path;
+        }
+    }
+
+    std::string path = ARCHIVE_INPUT_PKG_DIR "fallback.tar";
+    CPPUNIT_ASSERT(writeTestTar(path, members));
+
+    struct stat st;
+    CPPUNIT_ASSERT(stat(path.c_str(), &st) == 0);
+    CPPUNIT_ASSERT(st.st_size > ARCHIVE_MMAP_MAX);
+
+    Pkg pkg(path, 0);
+    CPPUNIT_ASSERT(pkg.installPkg(ARCHIVE_INPUT_ROOT, ARCHIVE_INPUT_INSTALLED_DIR, 0, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES)), DEFAULT_SMART_OP, 1) == ARCHIVE_EOF);
+
+    for(auto& m : members) {
+        std::string installed = ARCHIVE_INPUT_ROOT + m.path;
+        if(m.type == TAR_TYPE_SYMLINK) {
+            CPPUNIT_ASSERT(std::filesystem::read_symlink(installed) == m.linkTarget);
+        }
+        else {
+            CPPUNIT_ASSERT(readTestFile(installed) == m.data);
+        }
+    }
+}
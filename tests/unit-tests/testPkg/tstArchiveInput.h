@@ -0,0 +1,45 @@
+#ifndef _THE2B_TST_ARCHIVE_INPUT_H
+#define _THE2B_TST_ARCHIVE_INPUT_H
+
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestResultCollector.h>
+
+#include "Pkg.h"
+#include "ArchiveInput.h"
+#include "tstUtils.h"
+
+#define ARCHIVE_INPUT_BASE_DIR "test-env-archive-input/"
+#define ARCHIVE_INPUT_PKG_DIR "test-env-archive-input/pkgs/"
+#define ARCHIVE_INPUT_INSTALLED_DIR "test-env-archive-input/installed/"
+#define ARCHIVE_INPUT_ROOT "test-env-archive-input/sysroot/"
+
+// Reads packages on either side of ARCHIVE_MMAP_MAX, whose members are larger than the read buffer, and checks libarchive lands on every header after skipping data
+class ArchiveInputTest : public CppUnit::TestFixture {
+    public:
+        void setUp();
+        void tearDown();
+
+        void testSmallPkgIsMapped();
+        void testLargePkgIsReadInBlocks();
+        void testSkipMovesPastData();
+        void testSkippedMembersLeaveHeadersInPlace();
+        void testFifoIsReadThrough();
+        void testInstallFallbackMembersAfterSkips();
+
+        static CppUnit::Test* suite();
+
+        std::vector<testMember_s> largePkgMembers();
+        std::string writeLargePkg(const std::string& name, int format = ARCHIVE_FORMAT_TAR_USTAR);
+};
+
+#endif /* _THE2B_TST_ARCHIVE_INPUT_H */
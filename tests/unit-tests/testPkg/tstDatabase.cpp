@@ -0,0 +1,75 @@
+#include "tstDatabase.h"
+
+CppUnit::Test* DatabaseTest::suite() {
+    CppUnit::TestSuite* suite = new CppUnit::TestSuite( "DatabaseTest" );
+
+    suite->addTest( new CppUnit::TestCaller<DatabaseTest>( "testLegacyImportSkipsOtherFiles", &DatabaseTest::testLegacyImportSkipsOtherFiles ));
+    suite->addTest( new CppUnit::TestCaller<DatabaseTest>( "testCorruptDatabaseIsNotOverwritten", &DatabaseTest::testCorruptDatabaseIsNotOverwritten ));
+
+    return suite;
+}
+
+void DatabaseTest::setUp() {
+    CPPUNIT_ASSERT(makeTestDirs({ DATABASE_BASE_DIR, DATABASE_INSTALLED_DIR }));
+}
+
+void DatabaseTest::tearDown() {
+    removeTestDir(DATABASE_BASE_DIR);
+}
+
+// Only empty files and manifests are imported from the old layout. Anything else next to the database, such as a tarball, is neither listed nor removed
+void DatabaseTest::testLegacyImportSkipsOtherFiles() {
+    std::vector<manifestEntry_s> entries(1);
+    entries[0].path = "usr/bin/old";
+
+    CPPUNIT_ASSERT(writeTestFile(DATABASE_INSTALLED_DIR "followed", ""));
+    CPPUNIT_ASSERT(writeTestFile(DATABASE_INSTALLED_DIR "manifested", serializeManifest(entries)));
+    CPPUNIT_ASSERT(writeTestFile(DATABASE_INSTALLED_DIR "notes", "not a manifest\n"));
+    copyTestPkg(DATABASE_INSTALLED_DIR);
+
+    PkgDatabase db(DATABASE_INSTALLED_DIR, 0);
+    CPPUNIT_ASSERT(db.contains("followed"));
+    CPPUNIT_ASSERT(db.contains("manifested"));
+    CPPUNIT_ASSERT(!db.contains("notes"));
+    CPPUNIT_ASSERT(!db.contains(TEST_PKG_NAME ".tar"));
+
+    dbRecord_s rec;
+    rec.name = "new";
+    CPPUNIT_ASSERT(db.put(rec) == 0);
+
+    CPPUNIT_ASSERT(db.contains("new") && db.contains("followed") && db.contains("manifested"));
+    CPPUNIT_ASSERT(!db.contains("notes") && !db.contains(TEST_PKG_NAME ".tar"));
+    CPPUNIT_ASSERT(!std::filesystem::exists(DATABASE_INSTALLED_DIR "followed"));
+    CPPUNIT_ASSERT(!std::filesystem::exists(DATABASE_INSTALLED_DIR "manifested"));
+    CPPUNIT_ASSERT(readTestFile(DATABASE_INSTALLED_DIR "notes") == "not a manifest\n");
+    CPPUNIT_ASSERT(readTestFile(DATABASE_INSTALLED_DIR TEST_PKG_NAME ".tar") == readTestFile(testPkgPath()));
+
+    OwnerIndex index(DATABASE_INSTALLED_DIR, 0);
+    CPPUNIT_ASSERT(index.findOwners("usr/bin/old") == std::vector<std::string>({ "manifested" }));
+}
+
+// A database which is truncated or has a bad header reads as empty, but neither put nor remove write over it until it's moved aside
+void DatabaseTest::testCorruptDatabaseIsNotOverwritten() {
+    std::string path = DATABASE_INSTALLED_DIR DB_FILENAME;
+    std::string damaged[] = { "PKGMGR", std::string(DB_MAGIC) + std::string(DB_HEADER_SIZE, '\xff') };
+
+    dbRecord_s rec;
+    rec.name = "new";
+
+    for(auto& contents : damaged) {
+        CPPUNIT_ASSERT(writeTestFile(path, contents));
+
+        PkgDatabase db(DATABASE_INSTALLED_DIR, 0);
+        CPPUNIT_ASSERT(db.listNames().empty());
+        CPPUNIT_ASSERT(db.put(rec) == DB_CORRUPT);
+        CPPUNIT_ASSERT(db.remove("new") == DB_CORRUPT);
+        CPPUNIT_ASSERT(!db.contains("new"));
+        CPPUNIT_ASSERT(readTestFile(path) == contents);
+    }
+
+    CPPUNIT_ASSERT(rename(path.c_str(), (path + ".corrupt").c_str()) == 0);
+
+    PkgDatabase db(DATABASE_INSTALLED_DIR, 0);
+    CPPUNIT_ASSERT(db.put(rec) == 0);
+    CPPUNIT_ASSERT(db.contains("new"));
+}
@@ -0,0 +1,36 @@
+#ifndef _THE2B_TST_DATABASE_H
+#define _THE2B_TST_DATABASE_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <filesystem>
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestResultCollector.h>
+
+#include "Pkg.h"
+#include "Manifest.h"
+#include "Database.h"
+#include "Owners.h"
+#include "tstUtils.h"
+
+#define DATABASE_BASE_DIR "test-env-database/"
+#define DATABASE_INSTALLED_DIR "test-env-database/installed/"
+
+// Opens installed package databases, including the layout from before there was one
+class DatabaseTest : public CppUnit::TestFixture {
+    public:
+        void setUp();
+        void tearDown();
+
+        void testLegacyImportSkipsOtherFiles();
+        void testCorruptDatabaseIsNotOverwritten();
+
+        static CppUnit::Test* suite();
+};
+
+#endif /* _THE2B_TST_DATABASE_H */
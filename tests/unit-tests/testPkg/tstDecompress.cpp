@@ -0,0 +1,354 @@
+#include "tstDecompress.h"
+
+CppUnit::Test* DecompressTest::suite() {
+    CppUnit::TestSuite* suite = new CppUnit::TestSuite( "DecompressTest" );
+
+    suite->addTest( new CppUnit::TestCaller<DecompressTest>( "testDetectCompression", &DecompressTest::testDetectCompression ));
+    suite->addTest( new CppUnit::TestCaller<DecompressTest>( "testDecoderOutput", &DecompressTest::testDecoderOutput ));
+    suite->addTest( new CppUnit::TestCaller<DecompressTest>( "testZstdFramesInstallLikePlain", &DecompressTest::testZstdFramesInstallLikePlain ));
+    suite->addTest( new CppUnit::TestCaller<DecompressTest>( "testXzBlocksInstallLikePlain", &DecompressTest::testXzBlocksInstallLikePlain ));
+    suite->addTest( new CppUnit::TestCaller<DecompressTest>( "testSingleFrameIsLeftToLibarchive", &DecompressTest::testSingleFrameIsLeftToLibarchive ));
+    suite->addTest( new CppUnit::TestCaller<DecompressTest>( "testDamagedFrameFails", &DecompressTest::testDamagedFrameFails ));
+    suite->addTest( new CppUnit::TestCaller<DecompressTest>( "testScriptsAreReadWhileExtracting", &DecompressTest::testScriptsAreReadWhileExtracting ));
+    suite->addTest( new CppUnit::TestCaller<DecompressTest>( "testLatePreInstallIsScannedFirst", &DecompressTest::testLatePreInstallIsScannedFirst ));
+
+    return suite;
+}
+
+void DecompressTest::setUp() {
+    CPPUNIT_ASSERT(makeTestDirs({ DECOMPRESS_BASE_DIR, DECOMPRESS_PKG_DIR, DECOMPRESS_INSTALLED_DIR, DECOMPRESS_PLAIN_ROOT, DECOMPRESS_ROOT }));
+}
+
+void DecompressTest::tearDown() {
+    removeTestDir(DECOMPRESS_BASE_DIR);
+}
+
+// Data which doesn't compress to nothing, and differs from one file to the next
+static std::string fileData(unsigned int seed, size_t size) {
+    std::string data(size, '\0');
+    uint32_t state = seed * 2654435761u + 1;
+    for(size_t index = 0; index < size; index++) {
+        state = state * 1103515245u + 12345u;
+        data[index] = (index % 3 == 0) ? (char)(state >> 24) : (char)('a' + index % 26);
+    }
+
+    return data;
+}
+
+#ifdef WITH_ZSTD
+// Compresses each DECOMPRESS_CHUNK_SIZE of data as a frame of its own, each recording its size. A skippable frame goes after the first
+static bool writeZstdFrames(const std::string& path, const std::string& data, bool checksum = false) {
+    ZSTD_CCtx* cctx = ZSTD_createCCtx();
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, checksum ? 1 : 0);
+
+    std::string out;
+    for(size_t offset = 0; offset < data.size(); offset += DECOMPRESS_CHUNK_SIZE) {
+        size_t len = std::min(data.size() - offset, (size_t)DECOMPRESS_CHUNK_SIZE);
+        std::string frame(ZSTD_compressBound(len), '\0');
+        size_t r = ZSTD_compress2(cctx, &frame[0], frame.size(), data.data() + offset, len);
+        if(ZSTD_isError(r)) {
+            ZSTD_freeCCtx(cctx);
+            return false;
+        }
+
+        out.append(frame.data(), r);
+
+        if(offset == 0) {
+            // The skippable frame magic, and the size of what it skips, little endian
+            out.append("\x50\x2a\x4d\x18\x04\x00\x00\x00skip", 12);
+        }
+    }
+
+    ZSTD_freeCCtx(cctx);
+    return writeTestFile(path, out);
+}
+#endif /* WITH_ZSTD */
+
+#ifdef WITH_LZMA_MT
+// Compresses data with the threaded xz encoder, which starts a new, independent block every DECOMPRESS_CHUNK_SIZE
+static bool writeXzBlocks(const std::string& path, const std::string& data) {
+    lzma_stream strm = LZMA_STREAM_INIT;
+    lzma_mt mt;
+    memset(&mt, 0, sizeof(mt));
+    mt.threads = 2;
+    mt.block_size = DECOMPRESS_CHUNK_SIZE;
+    mt.preset = 1;
+    mt.check = LZMA_CHECK_CRC64;
+
+    if(lzma_stream_encoder_mt(&strm, &mt) != LZMA_OK) {
+        return false;
+    }
+
+    std::string out;
+    std::vector<uint8_t> buf(1 << 16);
+    strm.next_in = (const uint8_t*)data.data();
+    strm.avail_in = data.size();
+
+    lzma_ret ret = LZMA_OK;
+    while(ret == LZMA_OK) {
+        strm.next_out = buf.data();
+        strm.avail_out = buf.size();
+        ret = lzma_code(&strm, LZMA_FINISH);
+        out.append((const char*)buf.data(), buf.size() - strm.avail_out);
+    }
+
+    lzma_end(&strm);
+    return ret == LZMA_STREAM_END && writeTestFile(path, out);
+}
+#endif /* WITH_LZMA_MT */
+
+// Writes the uncompressed tarball every test package is made from: Directories, links, and files from empty to several chunks long, so members start and end all over the frames
+std::string DecompressTest::writePlainPkg() {
+    std::vector<testMember_s> members = {
+        { "usr/", TAR_TYPE_DIRECTORY, "", "", 0755 },
+        { "usr/lib/", TAR_TYPE_DIRECTORY, "", "", 0755 },
+        { "usr/share/", TAR_TYPE_DIRECTORY, "", "", 0700 },
+        { "usr/lib/libdemo.so", TAR_TYPE_SYMLINK, "", "libdemo.so.1" }
+    };
+
+    for(unsigned int index = 0; index < 48; index++) {
+        size_t size = (index * 37 % 11) * (DECOMPRESS_CHUNK_SIZE / 5) + index;
+        members.push_back({ "usr/share/file" + std::to_string(index), TAR_TYPE_REGULAR, fileData(index, size), "", (mode_t)((index % 2 == 0) ? 0644 : 0600) });
+    }
+
+    members.push_back({ "usr/lib/libdemo.so.1", TAR_TYPE_REGULAR, fileData(100, 3 * DECOMPRESS_CHUNK_SIZE + 7), "", 0755 });
+    members.push_back({ "usr/lib/libdemo.so.1.0", TAR_TYPE_HARDLINK, "", "usr/lib/libdemo.so.1" });
+
+    std::string tarPath = DECOMPRESS_PKG_DIR "chunks.tar";
+    CPPUNIT_ASSERT(writeTestTar(tarPath, members));
+    return tarPath;
+}
+
+// Whether openParallelDecompression takes the package, in which case every member is read through it
+bool DecompressTest::opensInParallel(const std::string& tarPath) {
+    struct archive* a = archive_read_new();
+    archive_read_support_format_tar(a);
+    archive_read_support_filter_zstd(a);
+    archive_read_support_filter_xz(a);
+    archive_read_support_filter_gzip(a);
+
+    int res = ARCHIVE_OK;
+    bool opened = openParallelDecompression(a, tarPath, res, 0);
+
+    if(opened) {
+        CPPUNIT_ASSERT(res == ARCHIVE_OK);
+
+        struct archive_entry* ae;
+        unsigned int entries = 0;
+        while((res = archive_read_next_header(a, &ae)) == ARCHIVE_OK) {
+            CPPUNIT_ASSERT(archive_read_data_skip(a) == ARCHIVE_OK);
+            entries++;
+        }
+
+        CPPUNIT_ASSERT(res == ARCHIVE_EOF);
+        CPPUNIT_ASSERT(entries == 54);
+    }
+
+    archive_read_free(a);
+    return opened;
+}
+
+// Installs the uncompressed tarball and the package made from it into their own roots, and checks they hold the same thing
+void DecompressTest::checkInstallsLikePlain(const std::string& tarPath) {
+    Pkg plain(DECOMPRESS_PKG_DIR "chunks.tar", 0);
+    CPPUNIT_ASSERT(plain.installPkg(DECOMPRESS_PLAIN_ROOT, DECOMPRESS_INSTALLED_DIR, 0) == ARCHIVE_EOF);
+
+    Pkg pkg(tarPath, 0);
+    CPPUNIT_ASSERT(pkg.installPkg(DECOMPRESS_ROOT, DECOMPRESS_INSTALLED_DIR, 0) == ARCHIVE_EOF);
+
+    std::vector<std::string> paths = listTestTree(DECOMPRESS_ROOT);
+    CPPUNIT_ASSERT(paths == listTestTree(DECOMPRESS_PLAIN_ROOT));
+    CPPUNIT_ASSERT(paths.size() == 54);
+
+    for(const std::string& path : paths) {
+        struct stat st;
+        struct stat plainSt;
+        CPPUNIT_ASSERT(lstat((DECOMPRESS_ROOT + path).c_str(), &st) == 0);
+        CPPUNIT_ASSERT(lstat((DECOMPRESS_PLAIN_ROOT + path).c_str(), &plainSt) == 0);
+        CPPUNIT_ASSERT(st.st_mode == plainSt.st_mode);
+
+        if(S_ISREG(st.st_mode)) {
+            CPPUNIT_ASSERT(st.st_size == plainSt.st_size && st.st_nlink == plainSt.st_nlink);
+            CPPUNIT_ASSERT(readTestFile(DECOMPRESS_ROOT + path) == readTestFile(DECOMPRESS_PLAIN_ROOT + path));
+        }
+    }
+}
+
+// Installs the package with its scripts at verbosity 3, and returns what it printed
+std::string DecompressTest::installWithScripts(const std::string& tarPath, unsigned int writers, int& res) {
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int fd = open(DECOMPRESS_STDOUT, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    CPPUNIT_ASSERT(saved >= 0 && fd >= 0);
+    CPPUNIT_ASSERT(dup2(fd, STDOUT_FILENO) == STDOUT_FILENO);
+    close(fd);
+
+    Pkg pkg(tarPath, 0);
+    res = pkg.installPkgWithScripts(DECOMPRESS_ROOT, DECOMPRESS_INSTALLED_DIR, 3, ExclusionMatcher(defaultPkgExclusions()), DEFAULT_SMART_OP, writers);
+
+    fflush(stdout);
+    CPPUNIT_ASSERT(dup2(saved, STDOUT_FILENO) == STDOUT_FILENO);
+    close(saved);
+    return readTestFile(DECOMPRESS_STDOUT);
+}
+
+// Packages are told apart by their first bytes, not their extensions
+void DecompressTest::testDetectCompression() {
+    std::string tarPath = writePlainPkg();
+    std::vector<std::pair<std::string, int>> pkgs = { { tarPath, COMPRESSION_NONE } };
+
+    for(const auto& filter : std::vector<std::pair<const char*, int>>({ { "gzip", COMPRESSION_GZIP }, { "xz", COMPRESSION_XZ }, { "zstd", COMPRESSION_ZSTD } })) {
+        std::string path = DECOMPRESS_PKG_DIR "detect-" + std::string(filter.first);
+        CPPUNIT_ASSERT(writeTestTar(path, { { "file", TAR_TYPE_REGULAR, "data\n" } }, ARCHIVE_FORMAT_TAR_PAX_RESTRICTED, filter.first));
+        pkgs.push_back({ path, filter.second });
+    }
+
+    CPPUNIT_ASSERT(writeTestFile(DECOMPRESS_PKG_DIR "short", "\x28\xb5"));
+    pkgs.push_back({ DECOMPRESS_PKG_DIR "short", COMPRESSION_NONE });
+
+    for(const auto& pkg : pkgs) {
+        int fd = open(pkg.first.c_str(), O_RDONLY | O_CLOEXEC);
+        CPPUNIT_ASSERT(fd >= 0);
+        CPPUNIT_ASSERT(detectCompression(fd) == pkg.second);
+        close(fd);
+    }
+}
+
+// Reads everything a ParallelDecoder hands over
+static std::string decodeAll(ParallelDecoder& decoder) {
+    std::string out;
+    const void* buf;
+    la_ssize_t r;
+    while((r = decoder.read(&buf)) > 0) {
+        out.append((const char*)buf, r);
+    }
+
+    CPPUNIT_ASSERT(r == 0);
+    return out;
+}
+
+// The decoder hands over exactly the tarball the frames or blocks were made from, in order, with more frames than threads, and as few threads as one
+void DecompressTest::testDecoderOutput() {
+    std::string data = readTestFile(writePlainPkg());
+    CPPUNIT_ASSERT(decompressThreads() == 4);
+
+#ifdef WITH_ZSTD
+    CPPUNIT_ASSERT(writeZstdFrames(DECOMPRESS_PKG_DIR "frames.tar.zst", data));
+
+    for(unsigned int threads : { 1, 3, 4 }) {
+        ParallelDecoder decoder(DECOMPRESS_PKG_DIR "frames.tar.zst", COMPRESSION_ZSTD, threads, 0);
+        CPPUNIT_ASSERT(decoder.open());
+        CPPUNIT_ASSERT(decodeAll(decoder) == data);
+    }
+#endif /* WITH_ZSTD */
+
+#ifdef WITH_LZMA_MT
+    CPPUNIT_ASSERT(writeXzBlocks(DECOMPRESS_PKG_DIR "blocks.tar.xz", data));
+
+    ParallelDecoder decoder(DECOMPRESS_PKG_DIR "blocks.tar.xz", COMPRESSION_XZ, 4, 0);
+    CPPUNIT_ASSERT(decoder.open());
+    CPPUNIT_ASSERT(decodeAll(decoder) == data);
+#endif /* WITH_LZMA_MT */
+}
+
+// A zstd package split into frames, with a skippable frame among them, is decoded a frame per thread, and installs the same files as the tarball it was made from
+void DecompressTest::testZstdFramesInstallLikePlain() {
+#ifdef WITH_ZSTD
+    std::string data = readTestFile(writePlainPkg());
+    CPPUNIT_ASSERT(data.size() > 16 * DECOMPRESS_CHUNK_SIZE);
+
+    std::string tarPath = DECOMPRESS_PKG_DIR "frames.tar.zst";
+    CPPUNIT_ASSERT(writeZstdFrames(tarPath, data));
+
+    CPPUNIT_ASSERT(opensInParallel(tarPath));
+    checkInstallsLikePlain(tarPath);
+#endif /* WITH_ZSTD */
+}
+
+// An xz package split into independent blocks is decoded by liblzma's threaded decoder, and installs the same files as the tarball it was made from
+void DecompressTest::testXzBlocksInstallLikePlain() {
+#ifdef WITH_LZMA_MT
+    std::string data = readTestFile(writePlainPkg());
+
+    std::string tarPath = DECOMPRESS_PKG_DIR "blocks.tar.xz";
+    CPPUNIT_ASSERT(writeXzBlocks(tarPath, data));
+
+    CPPUNIT_ASSERT(opensInParallel(tarPath));
+    checkInstallsLikePlain(tarPath);
+#endif /* WITH_LZMA_MT */
+}
+
+// A single zstd frame, or gzip, can't be split up, so libarchive decompresses them by itself
+void DecompressTest::testSingleFrameIsLeftToLibarchive() {
+    std::string data = readTestFile(writePlainPkg());
+
+    std::string gzPath = DECOMPRESS_PKG_DIR "single.tar.gz";
+    struct archive* a = archive_read_new();
+    archive_read_support_format_tar(a);
+    int res = ARCHIVE_OK;
+    CPPUNIT_ASSERT(writeTestTar(gzPath, { { "usr/share/file", TAR_TYPE_REGULAR, "data\n" } }, ARCHIVE_FORMAT_TAR_PAX_RESTRICTED, "gzip"));
+    CPPUNIT_ASSERT(!openParallelDecompression(a, gzPath, res, 0));
+    archive_read_free(a);
+
+#ifdef WITH_ZSTD
+    std::string tarPath = DECOMPRESS_PKG_DIR "single.tar.zst";
+    std::string frame(ZSTD_compressBound(data.size()), '\0');
+    size_t r = ZSTD_compress(&frame[0], frame.size(), data.data(), data.size(), 3);
+    CPPUNIT_ASSERT(!ZSTD_isError(r));
+    CPPUNIT_ASSERT(writeTestFile(tarPath, frame.substr(0, r)));
+
+    CPPUNIT_ASSERT(!opensInParallel(tarPath));
+    checkInstallsLikePlain(tarPath);
+#endif /* WITH_ZSTD */
+}
+
+// A damaged frame, past the ones already handed to libarchive, fails the install instead of hanging it or installing garbage
+void DecompressTest::testDamagedFrameFails() {
+#ifdef WITH_ZSTD
+    std::string data = readTestFile(writePlainPkg());
+
+    std::string tarPath = DECOMPRESS_PKG_DIR "damaged.tar.zst";
+    CPPUNIT_ASSERT(writeZstdFrames(tarPath, data, true));
+
+    // Flip a byte in the middle of the package, well past the first frame
+    std::string compressed = readTestFile(tarPath);
+    compressed[compressed.size() / 2] ^= 0x5a;
+    CPPUNIT_ASSERT(writeTestFile(tarPath, compressed));
+
+    Pkg pkg(tarPath, 0);
+    CPPUNIT_ASSERT(pkg.installPkg(DECOMPRESS_ROOT, DECOMPRESS_INSTALLED_DIR, 0) != ARCHIVE_EOF);
+#endif /* WITH_ZSTD */
+}
+
+// A compressed package whose scripts come first is extracted in the same pass its scripts are read in, with the pre-install script run before any of its files are written, by one writer or several
+void DecompressTest::testScriptsAreReadWhileExtracting() {
+    std::string tarPath = DECOMPRESS_PKG_DIR "early.tar.gz";
+    CPPUNIT_ASSERT(writeTestTar(tarPath, { { PRE_INSTALL_NAME, TAR_TYPE_REGULAR, DECOMPRESS_PRE_INSTALL_BODY, "", 0755 }, { POST_INSTALL_NAME, TAR_TYPE_REGULAR, "#!/bin/sh\necho done > post\n", "", 0755 }, { "usr/bin/", TAR_TYPE_DIRECTORY, "", "", 0755 }, { "usr/bin/tool", TAR_TYPE_REGULAR, "tool\n" } }, ARCHIVE_FORMAT_TAR_PAX_RESTRICTED, "gzip"));
+
+    for(unsigned int writers : { 1, 4 }) {
+        removeTestDir(DECOMPRESS_ROOT);
+        removeTestDir(DECOMPRESS_INSTALLED_DIR);
+        CPPUNIT_ASSERT(makeTestDirs({ DECOMPRESS_ROOT, DECOMPRESS_INSTALLED_DIR }));
+
+        int res;
+        std::string out = installWithScripts(tarPath, writers, res);
+        CPPUNIT_ASSERT(res == ARCHIVE_EOF);
+        CPPUNIT_ASSERT(out.find("Scanning it first") == std::string::npos);
+        CPPUNIT_ASSERT(readTestFile(DECOMPRESS_ROOT "pre") == "early\n");
+        CPPUNIT_ASSERT(readTestFile(DECOMPRESS_ROOT "post") == "done\n");
+        CPPUNIT_ASSERT(readTestFile(DECOMPRESS_ROOT "usr/bin/tool") == "tool\n");
+    }
+}
+
+// A pre-install script after the files still runs before any of them are written, at the cost of scanning the package first
+void DecompressTest::testLatePreInstallIsScannedFirst() {
+    std::string tarPath = DECOMPRESS_PKG_DIR "late.tar.gz";
+    CPPUNIT_ASSERT(writeTestTar(tarPath, { { "usr/bin/tool", TAR_TYPE_REGULAR, "tool\n" }, { PRE_INSTALL_NAME, TAR_TYPE_REGULAR, DECOMPRESS_PRE_INSTALL_BODY, "", 0755 } }, ARCHIVE_FORMAT_TAR_PAX_RESTRICTED, "gzip"));
+
+    int res;
+    std::string out = installWithScripts(tarPath, 1, res);
+    CPPUNIT_ASSERT(res == ARCHIVE_EOF);
+    CPPUNIT_ASSERT(out.find("Scanning it first") != std::string::npos);
+    CPPUNIT_ASSERT(readTestFile(DECOMPRESS_ROOT "pre") == "early\n");
+    CPPUNIT_ASSERT(readTestFile(DECOMPRESS_ROOT "usr/bin/tool") == "tool\n");
+}
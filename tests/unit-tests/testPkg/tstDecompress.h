@@ -0,0 +1,56 @@
+#ifndef _THE2B_TST_DECOMPRESS_H
+#define _THE2B_TST_DECOMPRESS_H
+
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestResultCollector.h>
+
+#include "Pkg.h"
+#include "Decompress.h"
+#include "tstUtils.h"
+
+#define DECOMPRESS_BASE_DIR "test-env-decompress/"
+#define DECOMPRESS_PKG_DIR "test-env-decompress/pkgs/"
+#define DECOMPRESS_INSTALLED_DIR "test-env-decompress/installed/"
+#define DECOMPRESS_PLAIN_ROOT "test-env-decompress/plain/"
+#define DECOMPRESS_ROOT "test-env-decompress/sysroot/"
+#define DECOMPRESS_STDOUT "test-env-decompress/stdout"
+
+// Records whether the package's files were already there when it ran
+#define DECOMPRESS_PRE_INSTALL_BODY "#!/bin/sh\nif [ -e usr/bin/tool ]; then echo late > pre; else echo early > pre; fi\n"
+
+// The uncompressed size of each zstd frame or xz block the test packages are split into
+#define DECOMPRESS_CHUNK_SIZE (64 << 10)
+
+// Writes packages made of independent zstd frames and xz blocks, and checks they install just as the same tarball does uncompressed
+class DecompressTest : public CppUnit::TestFixture {
+    public:
+        void setUp();
+        void tearDown();
+
+        void testDetectCompression();
+        void testDecoderOutput();
+        void testZstdFramesInstallLikePlain();
+        void testXzBlocksInstallLikePlain();
+        void testSingleFrameIsLeftToLibarchive();
+        void testDamagedFrameFails();
+        void testScriptsAreReadWhileExtracting();
+        void testLatePreInstallIsScannedFirst();
+
+        static CppUnit::Test* suite();
+
+        std::string writePlainPkg();
+        bool opensInParallel(const std::string& tarPath);
+        void checkInstallsLikePlain(const std::string& tarPath);
+        std::string installWithScripts(const std::string& tarPath, unsigned int writers, int& res);
+};
+
+#endif /* _THE2B_TST_DECOMPRESS_H */
@@ -0,0 +1,197 @@
+#include "tstDirCache.h"
+
+CppUnit::Test* DirCacheTest::suite() {
+    CppUnit::TestSuite* suite = new CppUnit::TestSuite( "DirCacheTest" );
+
+    suite->addTest( new CppUnit::TestCaller<DirCacheTest>( "testCanonicalMemberPath", &DirCacheTest::testCanonicalMemberPath ));
+    suite->addTest( new CppUnit::TestCaller<DirCacheTest>( "testDotDotStaysInRoot", &DirCacheTest::testDotDotStaysInRoot ));
+    suite->addTest( new CppUnit::TestCaller<DirCacheTest>( "testSymlinksStayInRoot", &DirCacheTest::testSymlinksStayInRoot ));
+    suite->addTest( new CppUnit::TestCaller<DirCacheTest>( "testSymlinkedParentDir", &DirCacheTest::testSymlinkedParentDir ));
+    suite->addTest( new CppUnit::TestCaller<DirCacheTest>( "testEviction", &DirCacheTest::testEviction ));
+    suite->addTest( new CppUnit::TestCaller<DirCacheTest>( "testInstallRefusesEscapes", &DirCacheTest::testInstallRefusesEscapes ));
+
+    return suite;
+}
+
+void DirCacheTest::setUp() {
+    CPPUNIT_ASSERT(makeTestDirs({ DIR_CACHE_BASE_DIR, DIR_CACHE_PKG_DIR, DIR_CACHE_INSTALLED_DIR, DIR_CACHE_ROOT }));
+}
+
+void DirCacheTest::tearDown() {
+    removeTestDir(DIR_CACHE_BASE_DIR);
+}
+
+// Whether fd is the directory at path
+static bool isDir(int fd, const std::string& path) {
+    struct stat fdSt;
+    struct stat pathSt;
+    return fd >= 0 && fstat(fd, &fdSt) == 0 && stat(path.c_str(), &pathSt) == 0 && S_ISDIR(fdSt.st_mode) && fdSt.st_dev == pathSt.st_dev && fdSt.st_ino == pathSt.st_ino;
+}
+
+// The number of fds this process has open
+static size_t openFdCount() {
+    size_t count = 0;
+    for(const auto& entry : std::filesystem::directory_iterator("/proc/self/fd")) {
+        (void)entry;
+        count++;
+    }
+
+    return count;
+}
+
+// Empty and "." components, and a leading slash, are dropped, so an absolute member path is taken relative to the root
+void DirCacheTest::testCanonicalMemberPath() {
+    CPPUNIT_ASSERT(canonicalMemberPath("./usr//bin/") == "usr/bin");
+    CPPUNIT_ASSERT(canonicalMemberPath("usr/./bin/tool") == "usr/bin/tool");
+    CPPUNIT_ASSERT(canonicalMemberPath("/etc/passwd") == "etc/passwd");
+    CPPUNIT_ASSERT(canonicalMemberPath("//etc") == "etc");
+    CPPUNIT_ASSERT(canonicalMemberPath("./").empty());
+    CPPUNIT_ASSERT(canonicalMemberPath("/").empty());
+
+    // ".." is left for isSafeMemberPath to reject
+    CPPUNIT_ASSERT(canonicalMemberPath("usr/../..") == "usr/../..");
+    CPPUNIT_ASSERT(!isSafeMemberPath("usr/../.."));
+    CPPUNIT_ASSERT(!isSafeMemberPath("../etc"));
+    CPPUNIT_ASSERT(!isSafeMemberPath(".."));
+    CPPUNIT_ASSERT(isSafeMemberPath("usr/..bin/tool.."));
+}
+
+// With openat2, ".." at the root is the root itself, so neither looking a directory up nor creating one can climb out of it
+void DirCacheTest::testDotDotStaysInRoot() {
+#ifdef HAVE_LINUX_OPENAT2_H
+    CPPUNIT_ASSERT(makeTestDir(DIR_CACHE_ROOT "usr"));
+
+    DirFdCache dirs(DIR_CACHE_ROOT, 0);
+    CPPUNIT_ASSERT(dirs.isOpen());
+    CPPUNIT_ASSERT(isDir(dirs.dirFd("..", false), DIR_CACHE_ROOT));
+    CPPUNIT_ASSERT(isDir(dirs.dirFd("usr/../../..", false), DIR_CACHE_ROOT));
+    CPPUNIT_ASSERT(isDir(dirs.dirFd("../usr", false), DIR_CACHE_ROOT "usr"));
+
+    CPPUNIT_ASSERT(isDir(dirs.dirFd("../../escaped", true), DIR_CACHE_ROOT "escaped"));
+    CPPUNIT_ASSERT(!std::filesystem::exists(DIR_CACHE_BASE_DIR "escaped"));
+    CPPUNIT_ASSERT(!std::filesystem::exists("escaped"));
+#endif /* HAVE_LINUX_OPENAT2_H */
+}
+
+// With openat2, symbolic links in the tree resolve as if the root were /, whether they're absolute or climb up with ".."
+void DirCacheTest::testSymlinksStayInRoot() {
+#ifdef HAVE_LINUX_OPENAT2_H
+    CPPUNIT_ASSERT(makeTestDir(DIR_CACHE_BASE_DIR "outside"));
+    CPPUNIT_ASSERT(symlink("/", DIR_CACHE_ROOT "slash") == 0);
+    CPPUNIT_ASSERT(symlink("../..", DIR_CACHE_ROOT "up") == 0);
+    CPPUNIT_ASSERT(symlink(std::filesystem::absolute(DIR_CACHE_BASE_DIR "outside").c_str(), DIR_CACHE_ROOT "outside") == 0);
+
+    DirFdCache dirs(DIR_CACHE_ROOT, 0);
+    CPPUNIT_ASSERT(isDir(dirs.dirFd("slash", false), DIR_CACHE_ROOT));
+    CPPUNIT_ASSERT(isDir(dirs.dirFd("up", false), DIR_CACHE_ROOT));
+
+    // Missing directories are created below the root, not below whatever the link would point at outside of it
+    std::string leaf;
+    CPPUNIT_ASSERT(isDir(dirs.parentFd("slash/made-by-slash/file", leaf, true), DIR_CACHE_ROOT "made-by-slash"));
+    CPPUNIT_ASSERT(leaf == "file");
+    CPPUNIT_ASSERT(!std::filesystem::exists("/made-by-slash"));
+
+    CPPUNIT_ASSERT(isDir(dirs.dirFd("up/made-by-up", true), DIR_CACHE_ROOT "made-by-up"));
+    CPPUNIT_ASSERT(!std::filesystem::exists(DIR_CACHE_BASE_DIR "made-by-up"));
+    CPPUNIT_ASSERT(!std::filesystem::exists("made-by-up"));
+
+    // A link to a real directory outside of the root points at a path within the root which doesn't exist
+    CPPUNIT_ASSERT(dirs.dirFd("outside", false) < 0);
+    CPPUNIT_ASSERT(dirs.dirFd("outside/sub", true) < 0);
+    CPPUNIT_ASSERT(!std::filesystem::exists(DIR_CACHE_BASE_DIR "outside/sub"));
+#endif /* HAVE_LINUX_OPENAT2_H */
+}
+
+// A parent directory reached through a symbolic link within the root is the directory the link points at, and a file installed through it lands there
+void DirCacheTest::testSymlinkedParentDir() {
+    CPPUNIT_ASSERT(makeTestDir(DIR_CACHE_ROOT "usr/lib"));
+    CPPUNIT_ASSERT(symlink("lib", DIR_CACHE_ROOT "usr/lib64") == 0);
+
+    {
+        DirFdCache dirs(DIR_CACHE_ROOT, 0);
+        std::string leaf;
+        CPPUNIT_ASSERT(isDir(dirs.parentFd("usr/lib64/libfoo.so", leaf, false), DIR_CACHE_ROOT "usr/lib"));
+        CPPUNIT_ASSERT(leaf == "libfoo.so");
+        CPPUNIT_ASSERT(isDir(dirs.dirFd("usr/lib64/sub", true), DIR_CACHE_ROOT "usr/lib/sub"));
+
+#ifdef HAVE_LINUX_OPENAT2_H
+        // An absolute link is taken relative to the root
+        CPPUNIT_ASSERT(symlink("/usr/lib", DIR_CACHE_ROOT "usr/lib32") == 0);
+        CPPUNIT_ASSERT(isDir(dirs.dirFd("usr/lib32", false), DIR_CACHE_ROOT "usr/lib"));
+#endif /* HAVE_LINUX_OPENAT2_H */
+    }
+
+    std::string tarPath = DIR_CACHE_PKG_DIR "symlinked.tar";
+    CPPUNIT_ASSERT(writeTestTar(tarPath, { { "usr/lib64/libfoo.so", TAR_TYPE_REGULAR, "foo\n" }, { "usr/lib64/deeper/libbar.so", TAR_TYPE_REGULAR, "bar\n" } }));
+
+    Pkg pkg(tarPath, 0);
+    CPPUNIT_ASSERT(pkg.installPkg(DIR_CACHE_ROOT, DIR_CACHE_INSTALLED_DIR, 0) == ARCHIVE_EOF);
+    CPPUNIT_ASSERT(std::filesystem::is_symlink(DIR_CACHE_ROOT "usr/lib64"));
+    CPPUNIT_ASSERT(readTestFile(DIR_CACHE_ROOT "usr/lib/libfoo.so") == "foo\n");
+    CPPUNIT_ASSERT(readTestFile(DIR_CACHE_ROOT "usr/lib/deeper/libbar.so") == "bar\n");
+}
+
+// Once the cache is full, looking up another directory closes the one used longest ago, and only that one has to be opened again
+void DirCacheTest::testEviction() {
+    for(unsigned int index = 0; index < 8; index++) {
+        CPPUNIT_ASSERT(makeTestDir(DIR_CACHE_ROOT "d" + std::to_string(index)));
+    }
+
+    size_t before = openFdCount();
+
+    DirFdCache dirs(DIR_CACHE_ROOT, 0, 3);
+    CPPUNIT_ASSERT(isDir(dirs.dirFd("d0", false), DIR_CACHE_ROOT "d0"));
+    CPPUNIT_ASSERT(isDir(dirs.dirFd("d1", false), DIR_CACHE_ROOT "d1"));
+    CPPUNIT_ASSERT(isDir(dirs.dirFd("d2", false), DIR_CACHE_ROOT "d2"));
+    CPPUNIT_ASSERT(dirs.getMisses() == 3 && dirs.getHits() == 0);
+
+    // d0 is used again, so d1 is the one used longest ago
+    CPPUNIT_ASSERT(isDir(dirs.dirFd("d0", false), DIR_CACHE_ROOT "d0"));
+    CPPUNIT_ASSERT(dirs.getHits() == 1);
+
+    CPPUNIT_ASSERT(isDir(dirs.dirFd("d3", false), DIR_CACHE_ROOT "d3"));
+    CPPUNIT_ASSERT(dirs.getMisses() == 4);
+
+    CPPUNIT_ASSERT(isDir(dirs.dirFd("d0", false), DIR_CACHE_ROOT "d0"));
+    CPPUNIT_ASSERT(isDir(dirs.dirFd("d2", false), DIR_CACHE_ROOT "d2"));
+    CPPUNIT_ASSERT(isDir(dirs.dirFd("d3", false), DIR_CACHE_ROOT "d3"));
+    CPPUNIT_ASSERT(dirs.getHits() == 4 && dirs.getMisses() == 4);
+
+    CPPUNIT_ASSERT(isDir(dirs.dirFd("d1", false), DIR_CACHE_ROOT "d1"));
+    CPPUNIT_ASSERT(dirs.getMisses() == 5);
+
+    // The directories evicted are closed, so only the root and the cached ones stay open
+    for(unsigned int index = 0; index < 8; index++) {
+        CPPUNIT_ASSERT(isDir(dirs.dirFd("d" + std::to_string(index), false), DIR_CACHE_ROOT "d" + std::to_string(index)));
+    }
+
+    CPPUNIT_ASSERT(openFdCount() == before + 1 + 3);
+
+    // A cache smaller than a directory and its parent would evict one while creating the other, so it's never made smaller than 2
+    DirFdCache tiny(DIR_CACHE_ROOT, 0, 0);
+    CPPUNIT_ASSERT(isDir(tiny.dirFd("a/b/c/d", true), DIR_CACHE_ROOT "a/b/c/d"));
+    CPPUNIT_ASSERT(isDir(tiny.dirFd("a/b/c/d", false), DIR_CACHE_ROOT "a/b/c/d"));
+    CPPUNIT_ASSERT(tiny.getHits() == 1);
+}
+
+// A member climbing out with ".." stops the install before anything is written outside of the root, and an absolute member is installed below the root
+void DirCacheTest::testInstallRefusesEscapes() {
+    for(const char* filter : { (const char*)NULL, "gzip" }) {
+        std::string tarPath = std::string(DIR_CACHE_PKG_DIR "dotdot.tar") + ((filter == NULL) ? "" : ".gz");
+        CPPUNIT_ASSERT(writeTestTar(tarPath, { { "usr/", TAR_TYPE_DIRECTORY, "", "", 0755 }, { "usr/../../escaped", TAR_TYPE_REGULAR, "escaped\n" } }, ARCHIVE_FORMAT_TAR_PAX_RESTRICTED, filter));
+
+        Pkg pkg(tarPath, 0);
+        CPPUNIT_ASSERT(pkg.installPkg(DIR_CACHE_ROOT, DIR_CACHE_INSTALLED_DIR, 0) != ARCHIVE_EOF);
+        CPPUNIT_ASSERT(!std::filesystem::exists(DIR_CACHE_BASE_DIR "escaped"));
+
+        CPPUNIT_ASSERT(makeTestDir(DIR_CACHE_ROOT));
+    }
+
+    std::string tarPath = DIR_CACHE_PKG_DIR "absolute.tar";
+    CPPUNIT_ASSERT(writeTestTar(tarPath, { { "/pkg-mgr-dir-cache-test/file", TAR_TYPE_REGULAR, "absolute\n" } }));
+
+    Pkg pkg(tarPath, 0);
+    CPPUNIT_ASSERT(pkg.installPkg(DIR_CACHE_ROOT, DIR_CACHE_INSTALLED_DIR, 0) == ARCHIVE_EOF);
+    CPPUNIT_ASSERT(readTestFile(DIR_CACHE_ROOT "pkg-mgr-dir-cache-test/file") == "absolute\n");
+    CPPUNIT_ASSERT(!std::filesystem::exists("/pkg-mgr-dir-cache-test"));
+}
@@ -0,0 +1,41 @@
+#ifndef _THE2B_TST_DIR_CACHE_H
+#define _THE2B_TST_DIR_CACHE_H
+
+#include <string>
+#include <filesystem>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestResultCollector.h>
+
+#include "Pkg.h"
+#include "DirCache.h"
+#include "tstUtils.h"
+
+#define DIR_CACHE_BASE_DIR "test-env-dir-cache/"
+#define DIR_CACHE_PKG_DIR "test-env-dir-cache/pkgs/"
+#define DIR_CACHE_INSTALLED_DIR "test-env-dir-cache/installed/"
+#define DIR_CACHE_ROOT "test-env-dir-cache/sysroot/"
+
+// Looks up directories below a root through the cache, and installs packages through paths which try to leave the root
+class DirCacheTest : public CppUnit::TestFixture {
+    public:
+        void setUp();
+        void tearDown();
+
+        void testCanonicalMemberPath();
+        void testDotDotStaysInRoot();
+        void testSymlinksStayInRoot();
+        void testSymlinkedParentDir();
+        void testEviction();
+        void testInstallRefusesEscapes();
+
+        static CppUnit::Test* suite();
+};
+
+#endif /* _THE2B_TST_DIR_CACHE_H */
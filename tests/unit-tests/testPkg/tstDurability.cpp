@@ -0,0 +1,235 @@
+#include "tstDurability.h"
+
+CppUnit::Test* DurabilityTest::suite() {
+    CppUnit::TestSuite* suite = new CppUnit::TestSuite( "DurabilityTest" );
+
+    suite->addTest( new CppUnit::TestCaller<DurabilityTest>( "testDurabilityNames", &DurabilityTest::testDurabilityNames ));
+    suite->addTest( new CppUnit::TestCaller<DurabilityTest>( "testNoneDoesNotWait", &DurabilityTest::testNoneDoesNotWait ));
+    suite->addTest( new CppUnit::TestCaller<DurabilityTest>( "testTransactionIsLeftToTheCaller", &DurabilityTest::testTransactionIsLeftToTheCaller ));
+    suite->addTest( new CppUnit::TestCaller<DurabilityTest>( "testPackageSyncsTheRootOnce", &DurabilityTest::testPackageSyncsTheRootOnce ));
+    suite->addTest( new CppUnit::TestCaller<DurabilityTest>( "testFileSyncsEveryFile", &DurabilityTest::testFileSyncsEveryFile ));
+    suite->addTest( new CppUnit::TestCaller<DurabilityTest>( "testStagedWaitsAfterCommit", &DurabilityTest::testStagedWaitsAfterCommit ));
+    suite->addTest( new CppUnit::TestCaller<DurabilityTest>( "testUnopenableRoot", &DurabilityTest::testUnopenableRoot ));
+
+    return suite;
+}
+
+void DurabilityTest::setUp() {
+    CPPUNIT_ASSERT(makeTestDirs({ DURABILITY_BASE_DIR, DURABILITY_PKG_DIR }));
+}
+
+void DurabilityTest::tearDown() {
+    removeTestDir(DURABILITY_BASE_DIR);
+}
+
+// Finds the line installPkg prints at verbosity 3 once it's done waiting, with or without the number of files synced
+static waited_s parseWaited(const std::string& output) {
+    waited_s waited;
+    std::istringstream lines(output);
+    std::string line;
+    while(std::getline(lines, line)) {
+        if(line.compare(0, 7, "Waited ") != 0) {
+            continue;
+        }
+
+        char mode[32];
+        unsigned long files = 0;
+        int fields = sscanf(line.c_str(), "Waited %lf seconds for %*s to reach the disk (durability: %31[a-z], %lu files synced)", &waited.seconds, mode, &files);
+        if(fields < 2) {
+            continue;
+        }
+
+        waited.found = true;
+        waited.mode = mode;
+        waited.hasFilesSynced = (fields == 3);
+        waited.filesSynced = files;
+    }
+
+    return waited;
+}
+
+// Regular files spread over a few directories, a symlink, and a file with an xattr, which is left to libarchive
+std::vector<testMember_s> DurabilityTest::pkgMembers() {
+    std::vector<testMember_s> members;
+    for(unsigned int dir = 0; dir < 4; dir++) {
+        testMember_s d;
+        d.path = "dir" + std::to_string(dir);
+        d.type = TAR_TYPE_DIRECTORY;
+        d.mode = 0755;
+        members.push_back(d);
+    }
+
+    for(unsigned int index = 0; index + 1 < DURABILITY_TEST_FILES; index++) {
+        testMember_s m;
+        m.path = "dir" + std::to_string(index % 4) + "/file" + std::to_string(index);
+        m.data = "file " + std::to_string(index) + "\n";
+        members.push_back(m);
+    }
+
+    testMember_s xattr;
+    xattr.path = "dir0/xattr";
+    xattr.data = "xattr\n";
+    xattr.xattrs["user.test"] = "v";
+    members.push_back(xattr);
+
+    testMember_s link;
+    link.path = "dir1/link";
+    link.type = TAR_TYPE_SYMLINK;
+    link.linkTarget = "file1";
+    members.push_back(link);
+
+    return members;
+}
+
+std::string DurabilityTest::writePkg(const std::string& name, const char* filter) {
+    std::string path = DURABILITY_PKG_DIR + name + ((filter == NULL) ? ".tar" : ".tar.gz");
+    CPPUNIT_ASSERT(writeTestTar(path, pkgMembers(), ARCHIVE_FORMAT_TAR_PAX_RESTRICTED, filter));
+    return path;
+}
+
+// Installs the package into an empty root at verbosity 3, and returns what it printed
+std::string DurabilityTest::installWithDurability(const std::string& tarPath, unsigned int durability, unsigned int writers, bool staged, int& res) {
+    removeTestDir(DURABILITY_TEST_ROOT);
+    removeTestDir(DURABILITY_INSTALLED_DIR);
+    CPPUNIT_ASSERT(makeTestDirs({ DURABILITY_TEST_ROOT, DURABILITY_INSTALLED_DIR }));
+
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int fd = open(DURABILITY_STDOUT, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    CPPUNIT_ASSERT(saved >= 0 && fd >= 0);
+    CPPUNIT_ASSERT(dup2(fd, STDOUT_FILENO) == STDOUT_FILENO);
+    close(fd);
+
+    Pkg pkg(tarPath, 0);
+    res = pkg.installPkg(DURABILITY_TEST_ROOT, DURABILITY_INSTALLED_DIR, 3, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES)), DEFAULT_SMART_OP, writers, staged, durability);
+
+    fflush(stdout);
+    CPPUNIT_ASSERT(dup2(saved, STDOUT_FILENO) == STDOUT_FILENO);
+    close(saved);
+    return readTestFile(DURABILITY_STDOUT);
+}
+
+// Every member made it into the root, whichever way it was waited on
+void DurabilityTest::checkInstalled() {
+    for(auto& m : pkgMembers()) {
+        std::string installed = DURABILITY_TEST_ROOT + m.path;
+        if(m.type == TAR_TYPE_DIRECTORY) {
+            CPPUNIT_ASSERT(std::filesystem::is_directory(installed));
+        }
+        else if(m.type == TAR_TYPE_SYMLINK) {
+            CPPUNIT_ASSERT(std::filesystem::read_symlink(installed) == m.linkTarget);
+        }
+        else {
+            CPPUNIT_ASSERT(readTestFile(installed) == m.data);
+        }
+    }
+}
+
+// Each mode prints as the name the durability option takes for it
+void DurabilityTest::testDurabilityNames() {
+    CPPUNIT_ASSERT(durabilityName(DURABILITY_NONE) == "none");
+    CPPUNIT_ASSERT(durabilityName(DURABILITY_TRANSACTION) == "transaction");
+    CPPUNIT_ASSERT(durabilityName(DURABILITY_PACKAGE) == "package");
+    CPPUNIT_ASSERT(durabilityName(DURABILITY_FILE) == "file");
+    CPPUNIT_ASSERT(durabilityName(DURABILITY_FILE + 1) == "unknown");
+}
+
+// Without durability, the package is installed and nothing is waited on
+void DurabilityTest::testNoneDoesNotWait() {
+    std::string path = writePkg("none");
+
+    int res;
+    std::string output = installWithDurability(path, DURABILITY_NONE, 1, false, res);
+    CPPUNIT_ASSERT(res == ARCHIVE_EOF);
+    CPPUNIT_ASSERT(!parseWaited(output).found);
+    checkInstalled();
+}
+
+// The transaction mode doesn't wait on any one package. The caller syncs the root once every package is in
+void DurabilityTest::testTransactionIsLeftToTheCaller() {
+    std::string path = writePkg("transaction");
+
+    int res;
+    std::string output = installWithDurability(path, DURABILITY_TRANSACTION, 1, false, res);
+    CPPUNIT_ASSERT(res == ARCHIVE_EOF);
+    CPPUNIT_ASSERT(!parseWaited(output).found);
+    checkInstalled();
+
+    double seconds = -1;
+    CPPUNIT_ASSERT(syncRoot(DURABILITY_TEST_ROOT, 0, &seconds) == 0);
+    CPPUNIT_ASSERT(seconds >= 0);
+    CPPUNIT_ASSERT(syncRoot(DURABILITY_BASE_DIR "missing", 0, &seconds) == DURABILITY_ROOT_ERROR);
+}
+
+// The package mode waits once, on the whole filesystem, so no file is synced by itself. Both engines, with one writer and several
+void DurabilityTest::testPackageSyncsTheRootOnce() {
+    std::vector<std::string> paths = { writePkg("package"), writePkg("package", "gzip") };
+    for(auto& path : paths) {
+        for(unsigned int writers : { 1, 4 }) {
+            int res;
+            std::string output = installWithDurability(path, DURABILITY_PACKAGE, writers, false, res);
+            CPPUNIT_ASSERT(res == ARCHIVE_EOF);
+            checkInstalled();
+
+            waited_s waited = parseWaited(output);
+            CPPUNIT_ASSERT(waited.found);
+            CPPUNIT_ASSERT(waited.mode == "package");
+            CPPUNIT_ASSERT(waited.seconds >= 0);
+            CPPUNIT_ASSERT(waited.hasFilesSynced);
+            CPPUNIT_ASSERT(waited.filesSynced == 0);
+        }
+    }
+}
+
+// The file mode syncs every regular file, including those libarchive restored, whichever engine and however many writers wrote them
+void DurabilityTest::testFileSyncsEveryFile() {
+    std::vector<std::string> paths = { writePkg("file"), writePkg("file", "gzip") };
+    for(auto& path : paths) {
+        for(unsigned int writers : { 1, 4 }) {
+            int res;
+            std::string output = installWithDurability(path, DURABILITY_FILE, writers, false, res);
+            CPPUNIT_ASSERT(res == ARCHIVE_EOF);
+            checkInstalled();
+
+            waited_s waited = parseWaited(output);
+            CPPUNIT_ASSERT(waited.found);
+            CPPUNIT_ASSERT(waited.mode == "file");
+            CPPUNIT_ASSERT(waited.seconds >= 0);
+            CPPUNIT_ASSERT(waited.hasFilesSynced);
+            CPPUNIT_ASSERT(waited.filesSynced == DURABILITY_TEST_FILES);
+        }
+    }
+}
+
+// A staged package is synced before it's moved into place, so only the root is waited on afterwards, and no file by itself
+void DurabilityTest::testStagedWaitsAfterCommit() {
+    std::string path = writePkg("staged");
+    for(unsigned int durability : { DURABILITY_PACKAGE, DURABILITY_FILE }) {
+        int res;
+        std::string output = installWithDurability(path, durability, 1, true, res);
+        CPPUNIT_ASSERT(res == ARCHIVE_EOF);
+        checkInstalled();
+
+        waited_s waited = parseWaited(output);
+        CPPUNIT_ASSERT(waited.found);
+        CPPUNIT_ASSERT(waited.mode == durabilityName(durability));
+        CPPUNIT_ASSERT(waited.seconds >= 0);
+        CPPUNIT_ASSERT(!waited.hasFilesSynced);
+    }
+
+    int res;
+    std::string output = installWithDurability(path, DURABILITY_TRANSACTION, 1, true, res);
+    CPPUNIT_ASSERT(res == ARCHIVE_EOF);
+    CPPUNIT_ASSERT(!parseWaited(output).found);
+    checkInstalled();
+}
+
+// A tracker whose root couldn't be opened can't promise anything, so finishing it fails
+void DurabilityTest::testUnopenableRoot() {
+    for(unsigned int durability : { DURABILITY_PACKAGE, DURABILITY_FILE }) {
+        WritebackTracker tracker(DURABILITY_BASE_DIR "missing", durability, 0);
+        CPPUNIT_ASSERT(!tracker.isOpen());
+        CPPUNIT_ASSERT(tracker.finish() == DURABILITY_ROOT_ERROR);
+        CPPUNIT_ASSERT(tracker.getFilesSynced() == 0);
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef _THE2B_TST_DURABILITY_H
+#define _THE2B_TST_DURABILITY_H
+
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestResultCollector.h>
+
+#include "Pkg.h"
+#include "Durability.h"
+#include "tstUtils.h"
+
+#define DURABILITY_BASE_DIR "test-env-durability/"
+#define DURABILITY_PKG_DIR "test-env-durability/pkgs/"
+#define DURABILITY_INSTALLED_DIR "test-env-durability/installed/"
+#define DURABILITY_TEST_ROOT "test-env-durability/sysroot/"
+#define DURABILITY_STDOUT "test-env-durability/stdout"
+
+// More files than DURABILITY_FILE_WINDOW, so file mode has to sync some before the package is done
+#define DURABILITY_TEST_FILES (DURABILITY_FILE_WINDOW + 16)
+
+// What installPkg reported waiting on. See parseWaited
+struct waited_s {
+    bool found = false;
+    double seconds = -1;
+    std::string mode;
+    bool hasFilesSynced = false;
+    unsigned long filesSynced = 0;
+};
+
+// Installs a package under each durability mode, and checks what was installed and how long it says it waited for the disk
+class DurabilityTest : public CppUnit::TestFixture {
+    public:
+        void setUp();
+        void tearDown();
+
+        void testDurabilityNames();
+        void testNoneDoesNotWait();
+        void testTransactionIsLeftToTheCaller();
+        void testPackageSyncsTheRootOnce();
+        void testFileSyncsEveryFile();
+        void testStagedWaitsAfterCommit();
+        void testUnopenableRoot();
+
+        static CppUnit::Test* suite();
+
+        std::vector<testMember_s> pkgMembers();
+        std::string writePkg(const std::string& name, const char* filter = NULL);
+        std::string installWithDurability(const std::string& tarPath, unsigned int durability, unsigned int writers, bool staged, int& res);
+        void checkInstalled();
+};
+
+#endif /* _THE2B_TST_DURABILITY_H */
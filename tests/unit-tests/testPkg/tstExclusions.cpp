@@ -0,0 +1,162 @@
+#include "tstExclusions.h"
+
+CppUnit::Test* ExclusionsTest::suite() {
+    CppUnit::TestSuite* suite = new CppUnit::TestSuite( "ExclusionsTest" );
+
+    suite->addTest( new CppUnit::TestCaller<ExclusionsTest>( "testLiteralPrefix", &ExclusionsTest::testLiteralPrefix ));
+    suite->addTest( new CppUnit::TestCaller<ExclusionsTest>( "testPatternSpelling", &ExclusionsTest::testPatternSpelling ));
+    suite->addTest( new CppUnit::TestCaller<ExclusionsTest>( "testTrailingDoubleStar", &ExclusionsTest::testTrailingDoubleStar ));
+    suite->addTest( new CppUnit::TestCaller<ExclusionsTest>( "testDoubleStarComponent", &ExclusionsTest::testDoubleStarComponent ));
+    suite->addTest( new CppUnit::TestCaller<ExclusionsTest>( "testStar", &ExclusionsTest::testStar ));
+    suite->addTest( new CppUnit::TestCaller<ExclusionsTest>( "testQuestionMark", &ExclusionsTest::testQuestionMark ));
+    suite->addTest( new CppUnit::TestCaller<ExclusionsTest>( "testBrackets", &ExclusionsTest::testBrackets ));
+    suite->addTest( new CppUnit::TestCaller<ExclusionsTest>( "testLiteralsAndGlobsTogether", &ExclusionsTest::testLiteralsAndGlobsTogether ));
+    suite->addTest( new CppUnit::TestCaller<ExclusionsTest>( "testTooComplex", &ExclusionsTest::testTooComplex ));
+    suite->addTest( new CppUnit::TestCaller<ExclusionsTest>( "testInstallWithExclusions", &ExclusionsTest::testInstallWithExclusions ));
+
+    return suite;
+}
+
+void ExclusionsTest::setUp() {
+    CPPUNIT_ASSERT(makeTestDirs({ EXCLUSIONS_BASE_DIR, EXCLUSIONS_INSTALLED_DIR, EXCLUSIONS_ROOT }));
+}
+
+void ExclusionsTest::tearDown() {
+    removeTestDir(EXCLUSIONS_BASE_DIR);
+}
+
+// A pattern without wildcards matches the path itself and everything below it, but only whole components
+void ExclusionsTest::testLiteralPrefix() {
+    ExclusionMatcher matcher({ "usr/share/doc" }, 0);
+    CPPUNIT_ASSERT(matcher.isValid());
+
+    CPPUNIT_ASSERT(matcher.matches("usr/share/doc"));
+    CPPUNIT_ASSERT(matcher.matches("usr/share/doc/"));
+    CPPUNIT_ASSERT(matcher.matches("usr/share/doc/zlib/README"));
+    CPPUNIT_ASSERT(!matcher.matches("usr/share/docs"));
+    CPPUNIT_ASSERT(!matcher.matches("usr/share"));
+    CPPUNIT_ASSERT(!matcher.matches("usr/share/do"));
+    CPPUNIT_ASSERT(!matcher.matches(""));
+}
+
+// A leading / or ./ means the same thing in a pattern and in a path
+void ExclusionsTest::testPatternSpelling() {
+    ExclusionMatcher matcher({ "/etc/passwd", "./etc/group" }, 0);
+
+    CPPUNIT_ASSERT(matcher.matches("etc/passwd"));
+    CPPUNIT_ASSERT(matcher.matches("./etc/passwd"));
+    CPPUNIT_ASSERT(matcher.matches("/etc/group"));
+    CPPUNIT_ASSERT(!matcher.matches("etc/shadow"));
+}
+
+// A trailing ** component matches everything below the directory, but not the directory itself
+void ExclusionsTest::testTrailingDoubleStar() {
+    ExclusionMatcher matcher({ "usr/share/doc/**" }, 0);
+
+    CPPUNIT_ASSERT(!matcher.matches("usr/share/doc"));
+    CPPUNIT_ASSERT(matcher.matches("usr/share/doc/README"));
+    CPPUNIT_ASSERT(matcher.matches("usr/share/doc/zlib/html/index.html"));
+    CPPUNIT_ASSERT(!matcher.matches("usr/share/docs/README"));
+}
+
+// A ** component in the middle stands for any number of whole components, including none
+void ExclusionsTest::testDoubleStarComponent() {
+    ExclusionMatcher matcher({ "usr/**/*.a" }, 0);
+
+    CPPUNIT_ASSERT(matcher.matches("usr/libz.a"));
+    CPPUNIT_ASSERT(matcher.matches("usr/lib/libz.a"));
+    CPPUNIT_ASSERT(matcher.matches("usr/lib/x86_64/static/libz.a"));
+    CPPUNIT_ASSERT(!matcher.matches("usr/lib/libz.so"));
+    CPPUNIT_ASSERT(!matcher.matches("opt/lib/libz.a"));
+}
+
+// * never crosses a /, but a directory it matches takes everything below it along
+void ExclusionsTest::testStar() {
+    ExclusionMatcher matcher({ "usr/lib/*.la" }, 0);
+
+    CPPUNIT_ASSERT(matcher.matches("usr/lib/libz.la"));
+    CPPUNIT_ASSERT(matcher.matches("usr/lib/.la"));
+    CPPUNIT_ASSERT(matcher.matches("usr/lib/odd.la/file"));
+    CPPUNIT_ASSERT(!matcher.matches("usr/lib/x/libz.la"));
+    CPPUNIT_ASSERT(!matcher.matches("usr/lib/libz.las"));
+}
+
+// ? matches exactly one character, and never a /
+void ExclusionsTest::testQuestionMark() {
+    ExclusionMatcher matcher({ "usr/share/man/man?" }, 0);
+
+    CPPUNIT_ASSERT(matcher.matches("usr/share/man/man1"));
+    CPPUNIT_ASSERT(matcher.matches("usr/share/man/man8/ls.8"));
+    CPPUNIT_ASSERT(!matcher.matches("usr/share/man/man"));
+    CPPUNIT_ASSERT(!matcher.matches("usr/share/man/man10"));
+
+    ExclusionMatcher slash({ "usr?lib" }, 0);
+    CPPUNIT_ASSERT(slash.matches("usr_lib"));
+    CPPUNIT_ASSERT(!slash.matches("usr/lib"));
+}
+
+// [...] matches one character out of a set or a range
+void ExclusionsTest::testBrackets() {
+    ExclusionMatcher matcher({ "etc/rc[0-6].d", "etc/[ab]x" }, 0);
+
+    CPPUNIT_ASSERT(matcher.matches("etc/rc0.d"));
+    CPPUNIT_ASSERT(matcher.matches("etc/rc6.d/S01network"));
+    CPPUNIT_ASSERT(!matcher.matches("etc/rc7.d"));
+    CPPUNIT_ASSERT(matcher.matches("etc/ax"));
+    CPPUNIT_ASSERT(matcher.matches("etc/bx"));
+    CPPUNIT_ASSERT(!matcher.matches("etc/cx"));
+}
+
+// The trie and the DFA are both consulted, so either kind of pattern excludes a path
+void ExclusionsTest::testLiteralsAndGlobsTogether() {
+    ExclusionMatcher matcher({ "usr/share/doc", "usr/share/locale/**", "usr/lib/*.la", "**/.gitignore" }, 0);
+
+    CPPUNIT_ASSERT(matcher.matches("usr/share/doc/README"));
+    CPPUNIT_ASSERT(matcher.matches("usr/share/locale/de/LC_MESSAGES/x.mo"));
+    CPPUNIT_ASSERT(matcher.matches("usr/lib/libz.la"));
+    CPPUNIT_ASSERT(matcher.matches(".gitignore"));
+    CPPUNIT_ASSERT(matcher.matches("src/app/.gitignore"));
+    CPPUNIT_ASSERT(!matcher.matches("usr/share/locale"));
+    CPPUNIT_ASSERT(!matcher.matches("usr/lib/libz.so"));
+}
+
+// A pattern whose DFA would need more states than we allow is refused, rather than built
+void ExclusionsTest::testTooComplex() {
+    // Telling where the last 'a' was among the final 13 characters takes 2^13 states
+    ExclusionMatcher matcher({ "**/*a?????????????" }, 0);
+    CPPUNIT_ASSERT(!matcher.isValid());
+
+    ExclusionMatcher fine({ "**/*a??" }, 0);
+    CPPUNIT_ASSERT(fine.isValid());
+    CPPUNIT_ASSERT(fine.matches("x/yaxy"));
+    CPPUNIT_ASSERT(!fine.matches("x/yaxyz"));
+}
+
+// Excluded members are left out of the root, whichever kind of pattern excluded them
+void ExclusionsTest::testInstallWithExclusions() {
+    std::set<std::string> patterns(PKG_SCRIPT_NAMES);
+    patterns.insert("mpc-1.1.0/tests/**");
+    patterns.insert("mpc-1.1.0/doc");
+    patterns.insert("mpc-1.1.0/src/*.c");
+
+    Pkg pkg(testPkgPath(), 0);
+    CPPUNIT_ASSERT(pkg.installPkg(EXCLUSIONS_ROOT, EXCLUSIONS_INSTALLED_DIR, 0, ExclusionMatcher(patterns, 0), DEFAULT_SMART_OP, 1) == ARCHIVE_EOF);
+
+    ExclusionMatcher matcher(patterns, 0);
+    std::vector<std::string> expected;
+    for(const std::string& path : listTarPaths(testPkgPath())) {
+        if(!matcher.matches(path)) {
+            expected.push_back(path);
+        }
+    }
+
+    std::sort(expected.begin(), expected.end());
+    CPPUNIT_ASSERT(listTestTree(EXCLUSIONS_ROOT) == expected);
+
+    struct stat st;
+    CPPUNIT_ASSERT(stat(EXCLUSIONS_ROOT TEST_PKG_DIR_MEMBER, &st) == 0 && S_ISDIR(st.st_mode));
+    CPPUNIT_ASSERT(stat(EXCLUSIONS_ROOT "mpc-1.1.0/doc", &st) != 0);
+    CPPUNIT_ASSERT(stat(EXCLUSIONS_ROOT TEST_PKG_FILE, &st) == 0);
+    CPPUNIT_ASSERT(std::find(expected.begin(), expected.end(), "mpc-1.1.0/src/mpc.h") != expected.end());
+    CPPUNIT_ASSERT(std::find(expected.begin(), expected.end(), "mpc-1.1.0/src/abs.c") == expected.end());
+}
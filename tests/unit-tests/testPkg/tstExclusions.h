@@ -0,0 +1,43 @@
+#ifndef _THE2B_TST_EXCLUSIONS_H
+#define _THE2B_TST_EXCLUSIONS_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <filesystem>
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestResultCollector.h>
+
+#include "Pkg.h"
+#include "Exclusions.h"
+#include "tstUtils.h"
+
+#define EXCLUSIONS_BASE_DIR "test-env-exclusions/"
+#define EXCLUSIONS_INSTALLED_DIR "test-env-exclusions/installed/"
+#define EXCLUSIONS_ROOT "test-env-exclusions/sysroot/"
+
+// Compiles exclusion patterns, and checks which paths they match, both on their own and when installing
+class ExclusionsTest : public CppUnit::TestFixture {
+    public:
+        void setUp();
+        void tearDown();
+
+        void testLiteralPrefix();
+        void testPatternSpelling();
+        void testTrailingDoubleStar();
+        void testDoubleStarComponent();
+        void testStar();
+        void testQuestionMark();
+        void testBrackets();
+        void testLiteralsAndGlobsTogether();
+        void testTooComplex();
+        void testInstallWithExclusions();
+
+        static CppUnit::Test* suite();
+};
+
+#endif /* _THE2B_TST_EXCLUSIONS_H */
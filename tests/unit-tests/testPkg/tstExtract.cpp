@@ -0,0 +1,261 @@
+#include "tstExtract.h"
+
+CppUnit::Test* ExtractTest::suite() {
+    CppUnit::TestSuite* suite = new CppUnit::TestSuite( "ExtractTest" );
+
+    suite->addTest( new CppUnit::TestCaller<ExtractTest>( "testHardLinkToFallbackMember", &ExtractTest::testHardLinkToFallbackMember ));
+    suite->addTest( new CppUnit::TestCaller<ExtractTest>( "testHardLinkToFallbackMemberOverOldFile", &ExtractTest::testHardLinkToFallbackMemberOverOldFile ));
+    suite->addTest( new CppUnit::TestCaller<ExtractTest>( "testBase256Numbers", &ExtractTest::testBase256Numbers ));
+    suite->addTest( new CppUnit::TestCaller<ExtractTest>( "testOldGnuSparseIsUnsupported", &ExtractTest::testOldGnuSparseIsUnsupported ));
+    suite->addTest( new CppUnit::TestCaller<ExtractTest>( "testOldGnuSparseInstalls", &ExtractTest::testOldGnuSparseInstalls ));
+    suite->addTest( new CppUnit::TestCaller<ExtractTest>( "testReadTestPkgMembers", &ExtractTest::testReadTestPkgMembers ));
+    suite->addTest( new CppUnit::TestCaller<ExtractTest>( "testInstallTestPkg", &ExtractTest::testInstallTestPkg ));
+    suite->addTest( new CppUnit::TestCaller<ExtractTest>( "testPaxLongPath", &ExtractTest::testPaxLongPath ));
+    suite->addTest( new CppUnit::TestCaller<ExtractTest>( "testPaxSparseFile", &ExtractTest::testPaxSparseFile ));
+    suite->addTest( new CppUnit::TestCaller<ExtractTest>( "testHardLink", &ExtractTest::testHardLink ));
+
+    return suite;
+}
+
+void ExtractTest::setUp() {
+    CPPUNIT_ASSERT(makeTestDirs({ EXTRACT_BASE_DIR, EXTRACT_PKG_DIR, EXTRACT_INSTALLED_DIR, EXTRACT_ROOT }));
+}
+
+void ExtractTest::tearDown() {
+    removeTestDir(EXTRACT_BASE_DIR);
+}
+
+// Writes the archive to the package directory, and installs it into the root with a single writer
+int ExtractTest::installTestTar(const std::string& name, const std::vector<testMember_s>& members, int format) {
+    std::string path = EXTRACT_PKG_DIR + name + ".tar";
+    CPPUNIT_ASSERT(writeTestTar(path, members, format));
+
+    Pkg pkg(path, 0);
+    return pkg.installPkg(EXTRACT_ROOT, EXTRACT_INSTALLED_DIR, 0, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES)), DEFAULT_SMART_OP, 1);
+}
+
+// libarchive can't write the old GNU sparse format, so GNU tar has to. A sparse file, followed by a plain one
+std::string ExtractTest::writeOldGnuSparseTar() {
+    std::string src = EXTRACT_BASE_DIR "sparse-src";
+    std::string path = EXTRACT_PKG_DIR "gnu-sparse.tar";
+    CPPUNIT_ASSERT(makeTestDir(src));
+    CPPUNIT_ASSERT(writeTestFile(src + "/sparse", ""));
+    CPPUNIT_ASSERT(truncate((src + "/sparse").c_str(), 1 << 22) == 0);
+
+    int fd = open((src + "/sparse").c_str(), O_WRONLY);
+    CPPUNIT_ASSERT(fd >= 0);
+    CPPUNIT_ASSERT(pwrite(fd, "data\n", 5, 1 << 21) == 5);
+    close(fd);
+
+    CPPUNIT_ASSERT(writeTestFile(src + "/plain", "plain\n"));
+
+    std::string command = "tar --sparse --format=gnu -C " + src + " -cf " + path + " sparse plain";
+    CPPUNIT_ASSERT(system(command.c_str()) == 0);
+
+    return path;
+}
+
+// A member carrying an xattr is left to libarchive. A hard link to it has to wait for it, rather than be linked to nothing
+void ExtractTest::testHardLinkToFallbackMember() {
+    testMember_s target;
+    target.path = "a";
+    target.data = "hello\n";
+    target.xattrs["user.test"] = "v";
+
+    testMember_s link;
+    link.path = "b";
+    link.type = TAR_TYPE_HARDLINK;
+    link.linkTarget = "a";
+
+    CPPUNIT_ASSERT(installTestTar("xattr-link", { target, link }) == ARCHIVE_EOF);
+
+    struct stat a, b;
+    CPPUNIT_ASSERT(stat(EXTRACT_ROOT "a", &a) == 0);
+    CPPUNIT_ASSERT(stat(EXTRACT_ROOT "b", &b) == 0);
+    CPPUNIT_ASSERT(a.st_ino == b.st_ino);
+    CPPUNIT_ASSERT(readTestFile(EXTRACT_ROOT "b") == "hello\n");
+}
+
+// A file left behind at the target's path by an earlier install must not be what the link ends up pointing at
+void ExtractTest::testHardLinkToFallbackMemberOverOldFile() {
+    CPPUNIT_ASSERT(writeTestFile(EXTRACT_ROOT "a", "old\n"));
+
+    testMember_s target;
+    target.path = "a";
+    target.data = "hello\n";
+    target.xattrs["user.test"] = "v";
+
+    testMember_s link;
+    link.path = "b";
+    link.type = TAR_TYPE_HARDLINK;
+    link.linkTarget = "a";
+
+    CPPUNIT_ASSERT(installTestTar("xattr-link", { target, link }) == ARCHIVE_EOF);
+
+    struct stat a, b;
+    CPPUNIT_ASSERT(stat(EXTRACT_ROOT "a", &a) == 0);
+    CPPUNIT_ASSERT(stat(EXTRACT_ROOT "b", &b) == 0);
+    CPPUNIT_ASSERT(a.st_ino == b.st_ino);
+    CPPUNIT_ASSERT(readTestFile(EXTRACT_ROOT "b") == "hello\n");
+}
+
+// Base-256 fields are read with their sign, up to the largest long long. Anything larger is -1, which every caller rejects
+void ExtractTest::testBase256Numbers() {
+    const unsigned char large[12] = { 0x80, 0, 0, 0, 0, 0, 0, 0x02, 0, 0, 0, 0 };
+    const unsigned char negative[8] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfe };
+    const unsigned char largest[12] = { 0x80, 0, 0, 0, 0x7f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+    const unsigned char smallest[12] = { 0xff, 0xff, 0xff, 0xff, 0x80, 0, 0, 0, 0, 0, 0, 0 };
+    const unsigned char tooLarge[12] = { 0x80, 0, 0, 0x01, 0, 0, 0, 0, 0, 0, 0, 0 };
+    const unsigned char tooSmall[12] = { 0xff, 0xff, 0xff, 0xfe, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+
+    CPPUNIT_ASSERT(parseTarNumber((const char*)large, 12) == (1LL << 33));
+    CPPUNIT_ASSERT(parseTarNumber((const char*)negative, 8) == -2);
+    CPPUNIT_ASSERT(parseTarNumber((const char*)largest, 12) == LLONG_MAX);
+    CPPUNIT_ASSERT(parseTarNumber((const char*)smallest, 12) == LLONG_MIN);
+    CPPUNIT_ASSERT(parseTarNumber((const char*)tooLarge, 12) == -1);
+    CPPUNIT_ASSERT(parseTarNumber((const char*)tooSmall, 12) == -1);
+    CPPUNIT_ASSERT(parseTarNumber("0000644\0", 8) == 0644);
+}
+
+// Old GNU sparse members keep their map in extension headers of their own. The walker has to give up on the archive, quietly, rather than read the data as headers
+void ExtractTest::testOldGnuSparseIsUnsupported() {
+    std::string path = writeOldGnuSparseTar();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    CPPUNIT_ASSERT(fd >= 0);
+
+    std::vector<tarMember_s> members;
+    int res = readTarMembers(fd, members, 0);
+    close(fd);
+
+    CPPUNIT_ASSERT(res == TAR_UNSUPPORTED);
+}
+
+// libarchive gets the whole archive instead, so every member still makes it into the root
+void ExtractTest::testOldGnuSparseInstalls() {
+    std::string path = writeOldGnuSparseTar();
+
+    Pkg pkg(path, 0);
+    CPPUNIT_ASSERT(pkg.installPkg(EXTRACT_ROOT, EXTRACT_INSTALLED_DIR, 0, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES)), DEFAULT_SMART_OP, 1) == ARCHIVE_EOF);
+
+    CPPUNIT_ASSERT(readTestFile(EXTRACT_ROOT "plain") == "plain\n");
+    CPPUNIT_ASSERT(readTestFile(EXTRACT_ROOT "sparse") == readTestFile(EXTRACT_BASE_DIR "sparse-src/sparse"));
+}
+
+// The walker sees every member of the test package, and the offsets it hands out lead to the right data
+void ExtractTest::testReadTestPkgMembers() {
+    int fd = open(testPkgPath().c_str(), O_RDONLY);
+    CPPUNIT_ASSERT(fd >= 0);
+
+    std::vector<tarMember_s> members;
+    CPPUNIT_ASSERT(readTarMembers(fd, members, 0) == 0);
+    CPPUNIT_ASSERT(members.size() == TEST_PKG_MEMBER_COUNT);
+
+    std::vector<std::string> paths = listTarPaths(testPkgPath());
+    for(size_t index = 0; index < members.size(); index++) {
+        CPPUNIT_ASSERT(normalizeMemberPath(members[index].path) == paths[index]);
+        CPPUNIT_ASSERT(!members[index].needsFallback);
+    }
+
+    auto found = std::find_if(members.begin(), members.end(), [](const tarMember_s& m) { return normalizeMemberPath(m.path) == TEST_PKG_FILE; });
+    CPPUNIT_ASSERT(found != members.end());
+
+    std::string data;
+    CPPUNIT_ASSERT(readTarRange(fd, found->dataOffset, found->size, data));
+    close(fd);
+
+    CPPUNIT_ASSERT(!data.empty());
+    CPPUNIT_ASSERT(data.find("Andreas Enge") != std::string::npos);
+}
+
+// Everything but the scripts ends up in the root
+void ExtractTest::testInstallTestPkg() {
+    Pkg pkg(testPkgPath(), 0);
+    CPPUNIT_ASSERT(pkg.installPkg(EXTRACT_ROOT, EXTRACT_INSTALLED_DIR, 0, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES)), DEFAULT_SMART_OP, 1) == ARCHIVE_EOF);
+
+    std::vector<std::string> expected;
+    std::set<std::string> scripts(PKG_SCRIPT_NAMES);
+    for(const std::string& path : listTarPaths(testPkgPath())) {
+        if(scripts.count(path) == 0) {
+            expected.push_back(path);
+        }
+    }
+
+    std::sort(expected.begin(), expected.end());
+    CPPUNIT_ASSERT(listTestTree(EXTRACT_ROOT) == expected);
+
+    struct stat st;
+    CPPUNIT_ASSERT(stat(EXTRACT_ROOT TEST_PKG_DIR_MEMBER, &st) == 0 && S_ISDIR(st.st_mode));
+}
+
+// A path too long for the header is carried by a pax header in front of it
+void ExtractTest::testPaxLongPath() {
+    std::string dir = std::string(120, 'd');
+    testMember_s file;
+    file.path = dir + "/" + std::string(110, 'f');
+    file.data = "long\n";
+
+    CPPUNIT_ASSERT(installTestTar("long-path", { file }) == ARCHIVE_EOF);
+    CPPUNIT_ASSERT(readTestFile(EXTRACT_ROOT + file.path) == "long\n");
+
+    int fd = open(EXTRACT_PKG_DIR "long-path.tar", O_RDONLY);
+    CPPUNIT_ASSERT(fd >= 0);
+
+    std::vector<tarMember_s> members;
+    CPPUNIT_ASSERT(readTarMembers(fd, members, 0) == 0);
+    close(fd);
+
+    CPPUNIT_ASSERT(members.size() == 1);
+    CPPUNIT_ASSERT(members[0].path == file.path);
+    CPPUNIT_ASSERT(!members[0].needsFallback);
+}
+
+// A sparse member only stores the stretches holding data, so it's left to libarchive, and comes out whole
+void ExtractTest::testPaxSparseFile() {
+    testMember_s file;
+    file.path = "sparse";
+    file.data = std::string(1 << 20, '\0');
+    file.data.replace(1 << 19, 5, "data\n");
+    file.sparse.push_back(std::make_pair((off_t)(1 << 19), (off_t)4096));
+
+    testMember_s plain;
+    plain.path = "plain";
+    plain.data = "plain\n";
+
+    CPPUNIT_ASSERT(installTestTar("pax-sparse", { file, plain }) == ARCHIVE_EOF);
+
+    int fd = open(EXTRACT_PKG_DIR "pax-sparse.tar", O_RDONLY);
+    CPPUNIT_ASSERT(fd >= 0);
+
+    std::vector<tarMember_s> members;
+    CPPUNIT_ASSERT(readTarMembers(fd, members, 0) == 0);
+    close(fd);
+
+    CPPUNIT_ASSERT(members.size() == 2);
+    CPPUNIT_ASSERT(normalizeMemberPath(members[0].path) == "sparse");
+    CPPUNIT_ASSERT(members[0].needsFallback);
+    CPPUNIT_ASSERT(!members[1].needsFallback);
+
+    CPPUNIT_ASSERT(readTestFile(EXTRACT_ROOT "sparse") == file.data);
+    CPPUNIT_ASSERT(readTestFile(EXTRACT_ROOT "plain") == "plain\n");
+}
+
+// A hard link to a member the engine writes itself is made by the engine too
+void ExtractTest::testHardLink() {
+    testMember_s target;
+    target.path = "dir/a";
+    target.data = "hello\n";
+
+    testMember_s link;
+    link.path = "dir/b";
+    link.type = TAR_TYPE_HARDLINK;
+    link.linkTarget = "dir/a";
+
+    CPPUNIT_ASSERT(installTestTar("link", { target, link }) == ARCHIVE_EOF);
+
+    struct stat a, b;
+    CPPUNIT_ASSERT(stat(EXTRACT_ROOT "dir/a", &a) == 0);
+    CPPUNIT_ASSERT(stat(EXTRACT_ROOT "dir/b", &b) == 0);
+    CPPUNIT_ASSERT(a.st_ino == b.st_ino);
+    CPPUNIT_ASSERT(a.st_nlink == 2);
+}
@@ -0,0 +1,48 @@
+#ifndef _THE2B_TST_EXTRACT_H
+#define _THE2B_TST_EXTRACT_H
+
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestResultCollector.h>
+
+#include "Pkg.h"
+#include "tstUtils.h"
+
+#define EXTRACT_BASE_DIR "test-env-extract/"
+#define EXTRACT_PKG_DIR "test-env-extract/pkgs/"
+#define EXTRACT_INSTALLED_DIR "test-env-extract/installed/"
+#define EXTRACT_ROOT "test-env-extract/sysroot/"
+
+// Installs archives written for each test, and checks what the zero-copy engine and libarchive leave in the root between them
+class ExtractTest : public CppUnit::TestFixture {
+    public:
+        void setUp();
+        void tearDown();
+
+        void testHardLinkToFallbackMember();
+        void testHardLinkToFallbackMemberOverOldFile();
+        void testBase256Numbers();
+        void testOldGnuSparseIsUnsupported();
+        void testOldGnuSparseInstalls();
+        void testReadTestPkgMembers();
+        void testInstallTestPkg();
+        void testPaxLongPath();
+        void testPaxSparseFile();
+        void testHardLink();
+
+        static CppUnit::Test* suite();
+
+        std::string writeOldGnuSparseTar();
+        int installTestTar(const std::string& name, const std::vector<testMember_s>& members, int format = ARCHIVE_FORMAT_TAR_PAX_RESTRICTED);
+};
+
+#endif /* _THE2B_TST_EXTRACT_H */
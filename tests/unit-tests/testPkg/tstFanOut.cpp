@@ -0,0 +1,196 @@
+#include "tstFanOut.h"
+
+CppUnit::Test* FanOutTest::suite() {
+    CppUnit::TestSuite* suite = new CppUnit::TestSuite( "FanOutTest" );
+
+    suite->addTest( new CppUnit::TestCaller<FanOutTest>( "testPlainTarIntoEveryRoot", &FanOutTest::testPlainTarIntoEveryRoot ));
+    suite->addTest( new CppUnit::TestCaller<FanOutTest>( "testCompressedIntoEveryRoot", &FanOutTest::testCompressedIntoEveryRoot ));
+    suite->addTest( new CppUnit::TestCaller<FanOutTest>( "testExclusionsInEveryRoot", &FanOutTest::testExclusionsInEveryRoot ));
+    suite->addTest( new CppUnit::TestCaller<FanOutTest>( "testMissingRootDoesNotStopOthers", &FanOutTest::testMissingRootDoesNotStopOthers ));
+    suite->addTest( new CppUnit::TestCaller<FanOutTest>( "testPlainTarWriteFailureInOneRoot", &FanOutTest::testPlainTarWriteFailureInOneRoot ));
+    suite->addTest( new CppUnit::TestCaller<FanOutTest>( "testCompressedWriteFailureInOneRoot", &FanOutTest::testCompressedWriteFailureInOneRoot ));
+    suite->addTest( new CppUnit::TestCaller<FanOutTest>( "testSyncedDurabilities", &FanOutTest::testSyncedDurabilities ));
+
+    return suite;
+}
+
+void FanOutTest::setUp() {
+    CPPUNIT_ASSERT(makeTestDirs({ FANOUT_BASE_DIR, FANOUT_PKG_DIR, FANOUT_PLAIN_ROOT, FANOUT_PLAIN_INSTALLED_DIR }));
+}
+
+void FanOutTest::tearDown() {
+    removeTestDir(FANOUT_BASE_DIR);
+}
+
+// Empty roots, each with a database of its own
+std::vector<fanoutRoot_s> FanOutTest::makeRoots() {
+    std::vector<fanoutRoot_s> roots(FANOUT_ROOT_COUNT);
+    for(unsigned int index = 0; index < FANOUT_ROOT_COUNT; index++) {
+        roots[index].root = FANOUT_BASE_DIR "root" + std::to_string(index) + "/";
+        roots[index].installedPkgsPath = FANOUT_BASE_DIR "installed" + std::to_string(index) + "/";
+        CPPUNIT_ASSERT(makeTestDir(roots[index].root));
+        CPPUNIT_ASSERT(makeTestDir(roots[index].installedPkgsPath));
+    }
+
+    return roots;
+}
+
+// A gzipped package with a member of each kind, which only the decoding engine can install
+std::string FanOutTest::writeCompressedPkg() {
+    std::string tarPath = FANOUT_PKG_DIR "small.tar.gz";
+
+    testMember_s dir = { "small/", TAR_TYPE_DIRECTORY };
+    dir.mode = 0750;
+
+    CPPUNIT_ASSERT(writeTestTar(tarPath, {
+        dir,
+        { "small/hello", TAR_TYPE_REGULAR, "hello\n" },
+        { "small/big", TAR_TYPE_REGULAR, std::string(1 << 20, 'x') },
+        { "small/link", TAR_TYPE_SYMLINK, "", "hello" },
+        { "small/hard", TAR_TYPE_HARDLINK, "", "small/hello" },
+    }, ARCHIVE_FORMAT_TAR_PAX_RESTRICTED, "gzip"));
+
+    return tarPath;
+}
+
+// An uncompressed package is installed into every root, and recorded in each root's database
+void FanOutTest::testPlainTarIntoEveryRoot() {
+    Pkg plain(testPkgPath(), 0);
+    CPPUNIT_ASSERT(plain.installPkg(FANOUT_PLAIN_ROOT, FANOUT_PLAIN_INSTALLED_DIR, 0, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES)), DEFAULT_SMART_OP, 1) == ARCHIVE_EOF);
+
+    std::vector<fanoutRoot_s> roots = makeRoots();
+    Pkg pkg(testPkgPath(), 0);
+    CPPUNIT_ASSERT(pkg.installPkgFanout(roots, 0, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES)), DURABILITY_NONE) == 0);
+
+    for(const fanoutRoot_s& r : roots) {
+        CPPUNIT_ASSERT(r.result == ARCHIVE_EOF);
+        CPPUNIT_ASSERT(r.installed == 1);
+        CPPUNIT_ASSERT(listTestTree(r.root) == listTestTree(FANOUT_PLAIN_ROOT));
+        CPPUNIT_ASSERT(readTestFile(r.root + TEST_PKG_FILE) == readTestFile(FANOUT_PLAIN_ROOT TEST_PKG_FILE));
+        CPPUNIT_ASSERT(PkgDatabase(r.installedPkgsPath, 0).contains(TEST_PKG_NAME));
+    }
+}
+
+// A compressed package is decoded once, and every root gets the same files, links and permissions
+void FanOutTest::testCompressedIntoEveryRoot() {
+    std::string tarPath = writeCompressedPkg();
+
+    std::vector<fanoutRoot_s> roots = makeRoots();
+    Pkg pkg(tarPath, 0);
+    CPPUNIT_ASSERT(pkg.installPkgFanout(roots, 0, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES)), DURABILITY_NONE) == 0);
+
+    for(const fanoutRoot_s& r : roots) {
+        CPPUNIT_ASSERT(r.result == ARCHIVE_EOF);
+        CPPUNIT_ASSERT(readTestFile(r.root + "small/hello") == "hello\n");
+        CPPUNIT_ASSERT(readTestFile(r.root + "small/big") == std::string(1 << 20, 'x'));
+        CPPUNIT_ASSERT(std::filesystem::read_symlink(r.root + "small/link") == "hello");
+
+        struct stat file;
+        struct stat hard;
+        struct stat dir;
+        CPPUNIT_ASSERT(stat((r.root + "small/hello").c_str(), &file) == 0);
+        CPPUNIT_ASSERT(stat((r.root + "small/hard").c_str(), &hard) == 0);
+        CPPUNIT_ASSERT(stat((r.root + "small").c_str(), &dir) == 0);
+        CPPUNIT_ASSERT(file.st_ino == hard.st_ino);
+        CPPUNIT_ASSERT((dir.st_mode & 07777) == 0750);
+
+        CPPUNIT_ASSERT(PkgDatabase(r.installedPkgsPath, 0).contains("small"));
+    }
+}
+
+// Excluded paths are left out of every root
+void FanOutTest::testExclusionsInEveryRoot() {
+    std::set<std::string> excluded(PKG_SCRIPT_NAMES);
+    excluded.insert("mpc-1.1.0/doc");
+
+    std::vector<fanoutRoot_s> roots = makeRoots();
+    Pkg pkg(testPkgPath(), 0);
+    CPPUNIT_ASSERT(pkg.installPkgFanout(roots, 0, ExclusionMatcher(excluded), DURABILITY_NONE) == 0);
+
+    for(const fanoutRoot_s& r : roots) {
+        CPPUNIT_ASSERT(!std::filesystem::exists(r.root + "mpc-1.1.0/doc"));
+        CPPUNIT_ASSERT(std::filesystem::is_regular_file(r.root + TEST_PKG_FILE));
+    }
+}
+
+// A root which isn't there fails on its own, and the package still goes into the others
+void FanOutTest::testMissingRootDoesNotStopOthers() {
+    std::vector<fanoutRoot_s> roots = makeRoots();
+    std::filesystem::remove_all(roots[1].root);
+
+    Pkg pkg(testPkgPath(), 0);
+    CPPUNIT_ASSERT(pkg.installPkgFanout(roots, 0, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES)), DURABILITY_NONE) == 1);
+
+    CPPUNIT_ASSERT(roots[1].result == FANOUT_ROOT_ERROR);
+    CPPUNIT_ASSERT(roots[1].failed == std::vector<std::string>{ TEST_PKG_NAME });
+    CPPUNIT_ASSERT(!PkgDatabase(roots[1].installedPkgsPath, 0).contains(TEST_PKG_NAME));
+
+    for(size_t index : { 0, 2 }) {
+        CPPUNIT_ASSERT(roots[index].result == ARCHIVE_EOF);
+        CPPUNIT_ASSERT(std::filesystem::is_regular_file(roots[index].root + TEST_PKG_FILE));
+        CPPUNIT_ASSERT(PkgDatabase(roots[index].installedPkgsPath, 0).contains(TEST_PKG_NAME));
+    }
+}
+
+// A root which can't be written to partway through fails, and the copy engine carries on with the others
+void FanOutTest::testPlainTarWriteFailureInOneRoot() {
+    std::vector<fanoutRoot_s> roots = makeRoots();
+    CPPUNIT_ASSERT(writeTestFile(roots[0].root + TEST_PKG_DIR_MEMBER, "in the way\n"));
+
+    Pkg pkg(testPkgPath(), 0);
+    CPPUNIT_ASSERT(pkg.installPkgFanout(roots, 0, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES)), DURABILITY_NONE) == 1);
+
+    CPPUNIT_ASSERT(roots[0].result < 0);
+    CPPUNIT_ASSERT(!PkgDatabase(roots[0].installedPkgsPath, 0).contains(TEST_PKG_NAME));
+
+    for(size_t index : { 1, 2 }) {
+        CPPUNIT_ASSERT(roots[index].result == ARCHIVE_EOF);
+        CPPUNIT_ASSERT(std::filesystem::is_regular_file(roots[index].root + TEST_PKG_DIR_MEMBER "/add.dat"));
+    }
+}
+
+// A root which can't be written to partway through is dropped, and the decoder carries on with the others
+void FanOutTest::testCompressedWriteFailureInOneRoot() {
+    std::string tarPath = writeCompressedPkg();
+
+    std::vector<fanoutRoot_s> roots = makeRoots();
+    CPPUNIT_ASSERT(writeTestFile(roots[2].root + "small/hello/keep", "in the way\n"));
+
+    Pkg pkg(tarPath, 0);
+    CPPUNIT_ASSERT(pkg.installPkgFanout(roots, 0, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES)), DURABILITY_NONE) == 1);
+
+    CPPUNIT_ASSERT(roots[2].result < 0);
+    CPPUNIT_ASSERT(roots[2].failed == std::vector<std::string>{ "small" });
+
+    for(size_t index : { 0, 1 }) {
+        CPPUNIT_ASSERT(roots[index].result == ARCHIVE_EOF);
+        CPPUNIT_ASSERT(readTestFile(roots[index].root + "small/big") == std::string(1 << 20, 'x'));
+    }
+}
+
+// The package and file durability modes hand each root's files to a tracker of its own, from both engines, and install into every root all the same
+void FanOutTest::testSyncedDurabilities() {
+    std::string compressedPath = writeCompressedPkg();
+
+    for(unsigned int durability : { DURABILITY_PACKAGE, DURABILITY_FILE }) {
+        std::vector<fanoutRoot_s> roots = makeRoots();
+        Pkg compressed(compressedPath, 0);
+        Pkg plain(testPkgPath(), 0);
+        CPPUNIT_ASSERT(compressed.installPkgFanout(roots, 0, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES)), durability) == 0);
+        CPPUNIT_ASSERT(plain.installPkgFanout(roots, 0, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES)), durability) == 0);
+
+        for(const fanoutRoot_s& r : roots) {
+            CPPUNIT_ASSERT(r.result == ARCHIVE_EOF);
+            CPPUNIT_ASSERT(r.installed == 2);
+            CPPUNIT_ASSERT(readTestFile(r.root + "small/hello") == "hello\n");
+            CPPUNIT_ASSERT(std::filesystem::is_regular_file(r.root + TEST_PKG_FILE));
+            CPPUNIT_ASSERT(PkgDatabase(r.installedPkgsPath, 0).contains("small"));
+            CPPUNIT_ASSERT(PkgDatabase(r.installedPkgsPath, 0).contains(TEST_PKG_NAME));
+        }
+
+        for(const fanoutRoot_s& r : roots) {
+            removeTestDir(r.root);
+            removeTestDir(r.installedPkgsPath);
+        }
+    }
+}
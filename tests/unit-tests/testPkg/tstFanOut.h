@@ -0,0 +1,49 @@
+#ifndef _THE2B_TST_FAN_OUT_H
+#define _THE2B_TST_FAN_OUT_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <filesystem>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestResultCollector.h>
+
+#include "Pkg.h"
+#include "FanOut.h"
+#include "tstUtils.h"
+
+#define FANOUT_BASE_DIR "test-env-fanout/"
+#define FANOUT_PKG_DIR "test-env-fanout/pkgs/"
+#define FANOUT_PLAIN_ROOT "test-env-fanout/plainroot/"
+#define FANOUT_PLAIN_INSTALLED_DIR "test-env-fanout/plaininstalled/"
+
+// The number of roots each test installs into
+#define FANOUT_ROOT_COUNT 3
+
+// Installs packages into several roots at once, and checks each root ends up as a plain install would leave it
+class FanOutTest : public CppUnit::TestFixture {
+    public:
+        void setUp();
+        void tearDown();
+
+        void testPlainTarIntoEveryRoot();
+        void testCompressedIntoEveryRoot();
+        void testExclusionsInEveryRoot();
+        void testMissingRootDoesNotStopOthers();
+        void testPlainTarWriteFailureInOneRoot();
+        void testCompressedWriteFailureInOneRoot();
+        void testSyncedDurabilities();
+
+        static CppUnit::Test* suite();
+
+        std::vector<fanoutRoot_s> makeRoots();
+        std::string writeCompressedPkg();
+};
+
+#endif /* _THE2B_TST_FAN_OUT_H */
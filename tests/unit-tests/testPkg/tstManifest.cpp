@@ -0,0 +1,84 @@
+#include "tstManifest.h"
+
+CppUnit::Test* ManifestTest::suite() {
+    CppUnit::TestSuite* suite = new CppUnit::TestSuite( "ManifestTest" );
+
+    suite->addTest( new CppUnit::TestCaller<ManifestTest>( "testReinstallReplacesManifest", &ManifestTest::testReinstallReplacesManifest ));
+
+    return suite;
+}
+
+void ManifestTest::setUp() {
+    CPPUNIT_ASSERT(makeTestDirs({ MANIFEST_BASE_DIR, MANIFEST_INSTALLED_DIR, MANIFEST_ROOT }));
+}
+
+void ManifestTest::tearDown() {
+    removeTestDir(MANIFEST_BASE_DIR);
+}
+
+// Installing a newer tarball of a followed package records what the new tarball installed, so the paths only the old one had are no longer owned or uninstalled, and the new ones are
+void ManifestTest::testReinstallReplacesManifest() {
+    std::vector<testMember_s> oldMembers(3);
+    oldMembers[0].path = "usr/bin/";
+    oldMembers[0].type = TAR_TYPE_DIRECTORY;
+    oldMembers[0].mode = 0755;
+    oldMembers[1].path = "usr/bin/common";
+    oldMembers[1].data = "old common\n";
+    oldMembers[2].path = "usr/bin/old";
+    oldMembers[2].data = "old\n";
+
+    std::vector<testMember_s> newMembers(3);
+    newMembers[0] = oldMembers[0];
+    newMembers[1].path = "usr/bin/common";
+    newMembers[1].data = "new common\n";
+    newMembers[2].path = "usr/bin/new";
+    newMembers[2].data = "new\n";
+
+    std::string tarPath = MANIFEST_BASE_DIR "re.tar";
+    CPPUNIT_ASSERT(writeTestTar(tarPath, oldMembers));
+    CPPUNIT_ASSERT(makeTestDir(MANIFEST_ROOT "usr/"));
+
+    dbRecord_s before;
+    {
+        Pkg pkg(tarPath, 0, MANIFEST_INSTALLED_DIR);
+        CPPUNIT_ASSERT(pkg.installPkgWithScripts(MANIFEST_ROOT, MANIFEST_INSTALLED_DIR, 0) >= 0);
+
+        // Backdate it, so keeping the time it was first followed can be told apart from following it again
+        PkgDatabase db(MANIFEST_INSTALLED_DIR, 0);
+        CPPUNIT_ASSERT(db.lookup("re", before));
+        before.installTime = 1000;
+        CPPUNIT_ASSERT(db.put(before) == 0);
+    }
+
+    CPPUNIT_ASSERT(writeTestTar(tarPath, newMembers));
+
+    Pkg pkg(tarPath, 0, MANIFEST_INSTALLED_DIR);
+    CPPUNIT_ASSERT(pkg.installPkgWithScripts(MANIFEST_ROOT, MANIFEST_INSTALLED_DIR, 0) >= 0);
+
+    {
+        PkgDatabase db(MANIFEST_INSTALLED_DIR, 0);
+        dbRecord_s after;
+        CPPUNIT_ASSERT(db.lookup("re", after));
+        CPPUNIT_ASSERT(after.installTime == 1000);
+
+        std::vector<manifestEntry_s> entries;
+        CPPUNIT_ASSERT(db.getManifest("re", entries) == 0);
+
+        std::set<std::string> paths;
+        for(const manifestEntry_s& e : entries) {
+            paths.insert(normalizeMemberPath(e.path));
+        }
+
+        CPPUNIT_ASSERT(paths == std::set<std::string>({ "usr/bin", "usr/bin/common", "usr/bin/new" }));
+    }
+
+    {
+        OwnerIndex index(MANIFEST_INSTALLED_DIR, 0);
+        CPPUNIT_ASSERT(index.findOwners("usr/bin/new") == std::vector<std::string>({ "re" }));
+        CPPUNIT_ASSERT(index.findOwners("usr/bin/old").empty());
+    }
+
+    // The file only the old tarball had isn't the package's anymore, so it's left where it is
+    CPPUNIT_ASSERT(pkg.uninstallPkgWithScripts(MANIFEST_ROOT, MANIFEST_INSTALLED_DIR, 0) >= 0);
+    CPPUNIT_ASSERT(listTestTree(MANIFEST_ROOT) == std::vector<std::string>({ "usr", "usr/bin", "usr/bin/old" }));
+}
@@ -0,0 +1,36 @@
+#ifndef _THE2B_TST_MANIFEST_H
+#define _THE2B_TST_MANIFEST_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <filesystem>
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestResultCollector.h>
+
+#include "Pkg.h"
+#include "Manifest.h"
+#include "Database.h"
+#include "Owners.h"
+#include "tstUtils.h"
+
+#define MANIFEST_BASE_DIR "test-env-manifest/"
+#define MANIFEST_INSTALLED_DIR "test-env-manifest/installed/"
+#define MANIFEST_ROOT "test-env-manifest/sysroot/"
+
+// Installs packages over one another, and checks the manifests they leave in the database
+class ManifestTest : public CppUnit::TestFixture {
+    public:
+        void setUp();
+        void tearDown();
+
+        void testReinstallReplacesManifest();
+
+        static CppUnit::Test* suite();
+};
+
+#endif /* _THE2B_TST_MANIFEST_H */
@@ -0,0 +1,208 @@
+#include "tstMemberCache.h"
+
+CppUnit::Test* MemberCacheTest::suite() {
+    CppUnit::TestSuite* suite = new CppUnit::TestSuite( "MemberCacheTest" );
+
+    suite->addTest( new CppUnit::TestCaller<MemberCacheTest>( "testWalkIsCached", &MemberCacheTest::testWalkIsCached ));
+    suite->addTest( new CppUnit::TestCaller<MemberCacheTest>( "testFreshEntryIsUsed", &MemberCacheTest::testFreshEntryIsUsed ));
+    suite->addTest( new CppUnit::TestCaller<MemberCacheTest>( "testChangedMtimeInvalidates", &MemberCacheTest::testChangedMtimeInvalidates ));
+    suite->addTest( new CppUnit::TestCaller<MemberCacheTest>( "testChangedSizeInvalidates", &MemberCacheTest::testChangedSizeInvalidates ));
+    suite->addTest( new CppUnit::TestCaller<MemberCacheTest>( "testReplacedTarballInvalidates", &MemberCacheTest::testReplacedTarballInvalidates ));
+    suite->addTest( new CppUnit::TestCaller<MemberCacheTest>( "testDamagedEntryIsRebuilt", &MemberCacheTest::testDamagedEntryIsRebuilt ));
+    suite->addTest( new CppUnit::TestCaller<MemberCacheTest>( "testIndexedPkgIsNotCached", &MemberCacheTest::testIndexedPkgIsNotCached ));
+    suite->addTest( new CppUnit::TestCaller<MemberCacheTest>( "testUnusableCacheDoesNotFail", &MemberCacheTest::testUnusableCacheDoesNotFail ));
+    suite->addTest( new CppUnit::TestCaller<MemberCacheTest>( "testListingPrunesRemovedTarballs", &MemberCacheTest::testListingPrunesRemovedTarballs ));
+
+    return suite;
+}
+
+void MemberCacheTest::setUp() {
+    CPPUNIT_ASSERT(makeTestDirs({ MEMBER_CACHE_BASE_DIR, MEMBER_CACHE_PKG_DIR }));
+}
+
+void MemberCacheTest::tearDown() {
+    removeTestDir(MEMBER_CACHE_BASE_DIR);
+}
+
+// The members of a tarball, through the cache
+std::vector<tarMember_s> MemberCacheTest::readMembers(const std::string& tarPath, MemberCache& cache) {
+    std::vector<tarMember_s> members;
+    int fd = open(tarPath.c_str(), O_RDONLY | O_CLOEXEC);
+    CPPUNIT_ASSERT(fd >= 0);
+    CPPUNIT_ASSERT(readPkgMembers(fd, members, 0, &cache) == 0);
+    close(fd);
+    return members;
+}
+
+// Members no tarball holds, so they can only have come from the cache
+std::vector<tarMember_s> MemberCacheTest::fakeMembers() {
+    std::vector<tarMember_s> members(1);
+    members[0].path = "cached-only";
+    members[0].size = 0;
+    members[0].dataOffset = 512;
+    return members;
+}
+
+void MemberCacheTest::storeFakeMembers(const std::string& tarPath, MemberCache& cache) {
+    int fd = open(tarPath.c_str(), O_RDONLY | O_CLOEXEC);
+    CPPUNIT_ASSERT(fd >= 0);
+    CPPUNIT_ASSERT(cache.store(fd, fakeMembers()));
+    close(fd);
+}
+
+// Walking a tarball's headers leaves an entry for it, which lists the same members
+void MemberCacheTest::testWalkIsCached() {
+    std::string tarPath = copyTestPkg(MEMBER_CACHE_PKG_DIR);
+    MemberCache cache(MEMBER_CACHE_DIR, 0);
+
+    std::vector<tarMember_s> walked = readMembers(tarPath, cache);
+    CPPUNIT_ASSERT(walked.size() == TEST_PKG_MEMBER_COUNT);
+    CPPUNIT_ASSERT(listTestTree(MEMBER_CACHE_DIR).size() == 1);
+
+    std::vector<tarMember_s> cached;
+    int fd = open(tarPath.c_str(), O_RDONLY | O_CLOEXEC);
+    CPPUNIT_ASSERT(cache.load(fd, cached));
+    close(fd);
+
+    CPPUNIT_ASSERT(cached.size() == walked.size());
+    for(size_t index = 0; index < walked.size(); index++) {
+        CPPUNIT_ASSERT(cached[index].path == walked[index].path);
+        CPPUNIT_ASSERT(cached[index].dataOffset == walked[index].dataOffset);
+        CPPUNIT_ASSERT(cached[index].size == walked[index].size);
+    }
+}
+
+// While the tarball is unchanged, its members come from the cache, and its headers aren't walked
+void MemberCacheTest::testFreshEntryIsUsed() {
+    std::string tarPath = copyTestPkg(MEMBER_CACHE_PKG_DIR);
+    MemberCache cache(MEMBER_CACHE_DIR, 0);
+    storeFakeMembers(tarPath, cache);
+
+    std::vector<tarMember_s> members = readMembers(tarPath, cache);
+    CPPUNIT_ASSERT(members.size() == 1);
+    CPPUNIT_ASSERT(members[0].path == "cached-only");
+
+    Pkg pkg(tarPath, 0, "", &cache);
+    CPPUNIT_ASSERT(pkg.getPkgMembers(0).size() == 1);
+}
+
+// Touching the tarball drops its entry, and the walk replaces it
+void MemberCacheTest::testChangedMtimeInvalidates() {
+    std::string tarPath = copyTestPkg(MEMBER_CACHE_PKG_DIR);
+    MemberCache cache(MEMBER_CACHE_DIR, 0);
+    storeFakeMembers(tarPath, cache);
+
+    struct timespec times[2] = { { 0, UTIME_OMIT }, { 1500000000, 0 } };
+    CPPUNIT_ASSERT(utimensat(AT_FDCWD, tarPath.c_str(), times, 0) == 0);
+
+    CPPUNIT_ASSERT(readMembers(tarPath, cache).size() == TEST_PKG_MEMBER_COUNT);
+
+    std::vector<tarMember_s> cached;
+    int fd = open(tarPath.c_str(), O_RDONLY | O_CLOEXEC);
+    CPPUNIT_ASSERT(cache.load(fd, cached));
+    close(fd);
+    CPPUNIT_ASSERT(cached.size() == TEST_PKG_MEMBER_COUNT);
+}
+
+// A tarball which grew is walked again, even with its old mtime put back
+void MemberCacheTest::testChangedSizeInvalidates() {
+    std::string tarPath = copyTestPkg(MEMBER_CACHE_PKG_DIR);
+    MemberCache cache(MEMBER_CACHE_DIR, 0);
+    storeFakeMembers(tarPath, cache);
+
+    struct stat st;
+    CPPUNIT_ASSERT(stat(tarPath.c_str(), &st) == 0);
+    std::filesystem::resize_file(tarPath, st.st_size + 20 * TAR_BLOCKSIZE);
+
+    struct timespec times[2] = { { 0, UTIME_OMIT }, st.st_mtim };
+    CPPUNIT_ASSERT(utimensat(AT_FDCWD, tarPath.c_str(), times, 0) == 0);
+
+    CPPUNIT_ASSERT(readMembers(tarPath, cache).size() == TEST_PKG_MEMBER_COUNT);
+}
+
+// A tarball replaced by another file, as rebuilding a package does, is a new inode, and never finds the old entry
+void MemberCacheTest::testReplacedTarballInvalidates() {
+    std::string tarPath = copyTestPkg(MEMBER_CACHE_PKG_DIR);
+    MemberCache cache(MEMBER_CACHE_DIR, 0);
+    storeFakeMembers(tarPath, cache);
+
+    struct stat st;
+    CPPUNIT_ASSERT(stat(tarPath.c_str(), &st) == 0);
+
+    std::string newPath = tarPath + ".new";
+    CPPUNIT_ASSERT(std::filesystem::copy_file(testPkgPath(), newPath));
+    struct timespec times[2] = { { 0, UTIME_OMIT }, st.st_mtim };
+    CPPUNIT_ASSERT(utimensat(AT_FDCWD, newPath.c_str(), times, 0) == 0);
+    std::filesystem::rename(newPath, tarPath);
+
+    CPPUNIT_ASSERT(readMembers(tarPath, cache).size() == TEST_PKG_MEMBER_COUNT);
+}
+
+// A damaged entry isn't trusted, and the walk writes a good one in its place
+void MemberCacheTest::testDamagedEntryIsRebuilt() {
+    std::string tarPath = copyTestPkg(MEMBER_CACHE_PKG_DIR);
+    MemberCache cache(MEMBER_CACHE_DIR, 0);
+    readMembers(tarPath, cache);
+
+    std::vector<std::string> entries = listTestTree(MEMBER_CACHE_DIR);
+    CPPUNIT_ASSERT(entries.size() == 1);
+    std::string entryPath = MEMBER_CACHE_DIR + entries[0];
+
+    int entryFd = open(entryPath.c_str(), O_WRONLY | O_CLOEXEC);
+    CPPUNIT_ASSERT(entryFd >= 0);
+    CPPUNIT_ASSERT(pwrite(entryFd, "X", 1, MEMBER_CACHE_HEADER_SIZE + 100) == 1);
+    close(entryFd);
+
+    std::vector<tarMember_s> cached;
+    int fd = open(tarPath.c_str(), O_RDONLY | O_CLOEXEC);
+    CPPUNIT_ASSERT(!cache.load(fd, cached));
+    CPPUNIT_ASSERT(cached.empty());
+    close(fd);
+
+    CPPUNIT_ASSERT(readMembers(tarPath, cache).size() == TEST_PKG_MEMBER_COUNT);
+
+    fd = open(tarPath.c_str(), O_RDONLY | O_CLOEXEC);
+    CPPUNIT_ASSERT(cache.load(fd, cached));
+    close(fd);
+}
+
+// A seekable package carries its own index, and never adds to the cache
+void MemberCacheTest::testIndexedPkgIsNotCached() {
+    std::string tarPath = copyTestPkg(MEMBER_CACHE_PKG_DIR);
+    CPPUNIT_ASSERT(writePkgIndex(tarPath, 0) == 0);
+
+    MemberCache cache(MEMBER_CACHE_DIR, 0);
+    CPPUNIT_ASSERT(readMembers(tarPath, cache).size() == TEST_PKG_MEMBER_COUNT);
+    CPPUNIT_ASSERT(listTestTree(MEMBER_CACHE_DIR).empty());
+}
+
+// A cache which can't be created only means walking the headers every time
+void MemberCacheTest::testUnusableCacheDoesNotFail() {
+    std::string tarPath = copyTestPkg(MEMBER_CACHE_PKG_DIR);
+    CPPUNIT_ASSERT(writeTestFile(MEMBER_CACHE_BASE_DIR "not-a-dir", ""));
+
+    MemberCache cache(MEMBER_CACHE_BASE_DIR "not-a-dir/cache", 0);
+    CPPUNIT_ASSERT(readMembers(tarPath, cache).size() == TEST_PKG_MEMBER_COUNT);
+    CPPUNIT_ASSERT(readMembers(tarPath, cache).size() == TEST_PKG_MEMBER_COUNT);
+}
+
+// Listing the library removes the entries of tarballs which left it, and keeps the rest, along with anything which isn't an entry
+void MemberCacheTest::testListingPrunesRemovedTarballs() {
+    std::string kept = copyTestPkg(MEMBER_CACHE_PKG_DIR);
+    std::string removed = MEMBER_CACHE_PKG_DIR "removed.tar";
+    CPPUNIT_ASSERT(writeTestTar(removed, { { "removed/hello", TAR_TYPE_REGULAR, "hello\n" } }));
+
+    MemberCache cache(MEMBER_CACHE_DIR, 0);
+    storeFakeMembers(kept, cache);
+    storeFakeMembers(removed, cache);
+    CPPUNIT_ASSERT(writeTestFile(MEMBER_CACHE_DIR "0-0.XXXXXX", "in progress"));
+    CPPUNIT_ASSERT(listTestTree(MEMBER_CACHE_DIR).size() == 3);
+
+    CPPUNIT_ASSERT(unlink(removed.c_str()) == 0);
+    CPPUNIT_ASSERT(listAllPkgs(MEMBER_CACHE_PKG_DIR, 0, &cache));
+    CPPUNIT_ASSERT(listTestTree(MEMBER_CACHE_DIR).size() == 2);
+    CPPUNIT_ASSERT(std::filesystem::exists(MEMBER_CACHE_DIR "0-0.XXXXXX"));
+
+    std::vector<tarMember_s> members = readMembers(kept, cache);
+    CPPUNIT_ASSERT(members.size() == 1 && members[0].path == "cached-only");
+}
@@ -0,0 +1,49 @@
+#ifndef _THE2B_TST_MEMBER_CACHE_H
+#define _THE2B_TST_MEMBER_CACHE_H
+
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestResultCollector.h>
+
+#include "Pkg.h"
+#include "MemberCache.h"
+#include "PkgIndex.h"
+#include "tstUtils.h"
+
+#define MEMBER_CACHE_BASE_DIR "test-env-member-cache/"
+#define MEMBER_CACHE_PKG_DIR "test-env-member-cache/pkgs/"
+#define MEMBER_CACHE_DIR "test-env-member-cache/cache/"
+
+// Caches the members of tarballs without an index, and checks an entry is dropped as soon as its tarball changes or leaves the library
+class MemberCacheTest : public CppUnit::TestFixture {
+    public:
+        void setUp();
+        void tearDown();
+
+        void testWalkIsCached();
+        void testFreshEntryIsUsed();
+        void testChangedMtimeInvalidates();
+        void testChangedSizeInvalidates();
+        void testReplacedTarballInvalidates();
+        void testDamagedEntryIsRebuilt();
+        void testIndexedPkgIsNotCached();
+        void testUnusableCacheDoesNotFail();
+        void testListingPrunesRemovedTarballs();
+
+        static CppUnit::Test* suite();
+
+        std::vector<tarMember_s> readMembers(const std::string& tarPath, MemberCache& cache);
+        std::vector<tarMember_s> fakeMembers();
+        void storeFakeMembers(const std::string& tarPath, MemberCache& cache);
+};
+
+#endif /* _THE2B_TST_MEMBER_CACHE_H */
@@ -0,0 +1,191 @@
+#include "tstOwners.h"
+
+CppUnit::Test* OwnersTest::suite() {
+    CppUnit::TestSuite* suite = new CppUnit::TestSuite( "OwnersTest" );
+
+    suite->addTest( new CppUnit::TestCaller<OwnersTest>( "testFindOwners", &OwnersTest::testFindOwners ));
+    suite->addTest( new CppUnit::TestCaller<OwnersTest>( "testSharedDirectory", &OwnersTest::testSharedDirectory ));
+    suite->addTest( new CppUnit::TestCaller<OwnersTest>( "testLookupAcrossBlocks", &OwnersTest::testLookupAcrossBlocks ));
+    suite->addTest( new CppUnit::TestCaller<OwnersTest>( "testUpdateOwnerIndex", &OwnersTest::testUpdateOwnerIndex ));
+    suite->addTest( new CppUnit::TestCaller<OwnersTest>( "testInstallAndUninstall", &OwnersTest::testInstallAndUninstall ));
+    suite->addTest( new CppUnit::TestCaller<OwnersTest>( "testScriptsAreNotOwned", &OwnersTest::testScriptsAreNotOwned ));
+    suite->addTest( new CppUnit::TestCaller<OwnersTest>( "testStaleIndexAfterReplace", &OwnersTest::testStaleIndexAfterReplace ));
+
+    return suite;
+}
+
+void OwnersTest::setUp() {
+    CPPUNIT_ASSERT(makeTestDirs({ OWNERS_BASE_DIR, OWNERS_INSTALLED_DIR, OWNERS_ROOT }));
+}
+
+void OwnersTest::tearDown() {
+    removeTestDir(OWNERS_BASE_DIR);
+}
+
+// Paths are found however they're spelled, and paths nobody owns aren't
+void OwnersTest::testFindOwners() {
+    std::map<std::string, std::vector<std::string>> pkgPaths;
+    pkgPaths["a"] = { "usr/bin/a", "usr/lib/liba.so" };
+    pkgPaths["b"] = { "usr/bin/b" };
+    CPPUNIT_ASSERT(writeOwnerIndex(OWNERS_INSTALLED_DIR, pkgPaths, 1, 0) == 0);
+
+    OwnerIndex index(OWNERS_INSTALLED_DIR, 0);
+    CPPUNIT_ASSERT(index.isValid());
+    CPPUNIT_ASSERT(index.getPkgCount() == 2);
+    CPPUNIT_ASSERT(index.findOwners("usr/bin/a") == std::vector<std::string>({ "a" }));
+    CPPUNIT_ASSERT(index.findOwners("/usr/lib/liba.so") == std::vector<std::string>({ "a" }));
+    CPPUNIT_ASSERT(index.findOwners("./usr/bin/b") == std::vector<std::string>({ "b" }));
+    CPPUNIT_ASSERT(index.findOwners("usr/bin/c").empty());
+    CPPUNIT_ASSERT(index.findOwners("usr/bin").empty());
+}
+
+// A directory installed by several packages is owned by each of them
+void OwnersTest::testSharedDirectory() {
+    std::map<std::string, std::vector<std::string>> pkgPaths;
+    pkgPaths["a"] = { "usr", "usr/bin", "usr/bin/a" };
+    pkgPaths["b"] = { "usr", "usr/bin", "usr/bin/b" };
+    pkgPaths["c"] = { "usr", "usr/share", "usr/share/c" };
+    CPPUNIT_ASSERT(writeOwnerIndex(OWNERS_INSTALLED_DIR, pkgPaths, 1, 0) == 0);
+
+    OwnerIndex index(OWNERS_INSTALLED_DIR, 0);
+    CPPUNIT_ASSERT(index.findOwners("usr") == std::vector<std::string>({ "a", "b", "c" }));
+    CPPUNIT_ASSERT(index.findOwners("usr/bin") == std::vector<std::string>({ "a", "b" }));
+    CPPUNIT_ASSERT(index.getEntries().size() == 9);
+}
+
+// Each block starts with a full path, and a lookup has to land in the right one, including for a path owned by enough packages to span blocks
+void OwnersTest::testLookupAcrossBlocks() {
+    std::map<std::string, std::vector<std::string>> pkgPaths;
+    for(unsigned int pkg = 0; pkg < 40; pkg++) {
+        std::string name = "pkg" + std::to_string(pkg);
+        pkgPaths[name].push_back("usr/share");
+
+        for(unsigned int file = 0; file < 10; file++) {
+            pkgPaths[name].push_back("usr/share/" + name + "/file" + std::to_string(file));
+        }
+    }
+
+    CPPUNIT_ASSERT(writeOwnerIndex(OWNERS_INSTALLED_DIR, pkgPaths, 1, 0) == 0);
+
+    OwnerIndex index(OWNERS_INSTALLED_DIR, 0);
+    CPPUNIT_ASSERT(index.isValid());
+    CPPUNIT_ASSERT(index.findOwners("usr/share").size() == 40);
+
+    for(auto& it : pkgPaths) {
+        for(size_t file = 1; file < it.second.size(); file++) {
+            CPPUNIT_ASSERT(index.findOwners(it.second[file]) == std::vector<std::string>({ it.first }));
+        }
+    }
+
+    CPPUNIT_ASSERT(index.findOwners("usr/share/pkg9/file99").empty());
+    CPPUNIT_ASSERT(index.findOwners("usr/share/zzz").empty());
+}
+
+// Removing one package and adding another leaves the index as if it was written from scratch
+void OwnersTest::testUpdateOwnerIndex() {
+    std::map<std::string, std::vector<std::string>> pkgPaths;
+    pkgPaths["a"] = { "usr", "usr/bin/a" };
+    pkgPaths["b"] = { "usr", "usr/bin/b" };
+    CPPUNIT_ASSERT(writeOwnerIndex(OWNERS_INSTALLED_DIR, pkgPaths, 1, 0) == 0);
+
+    std::map<std::string, std::vector<std::string>> added;
+    added["c"] = { "usr", "usr/bin/c" };
+    added["b"] = { "usr", "usr/bin/b2" };
+    CPPUNIT_ASSERT(updateOwnerIndex(OWNERS_INSTALLED_DIR, { "a" }, added, 2, 0) == 0);
+
+    OwnerIndex index(OWNERS_INSTALLED_DIR, 0);
+    CPPUNIT_ASSERT(index.isValid());
+    CPPUNIT_ASSERT(index.getGeneration() == 2);
+    CPPUNIT_ASSERT(index.findOwners("usr/bin/a").empty());
+    CPPUNIT_ASSERT(index.findOwners("usr/bin/b").empty());
+    CPPUNIT_ASSERT(index.findOwners("usr/bin/b2") == std::vector<std::string>({ "b" }));
+    CPPUNIT_ASSERT(index.findOwners("usr/bin/c") == std::vector<std::string>({ "c" }));
+    CPPUNIT_ASSERT(index.findOwners("usr") == std::vector<std::string>({ "b", "c" }));
+
+    std::vector<std::string> names = index.getPkgNames();
+    CPPUNIT_ASSERT(std::set<std::string>(names.begin(), names.end()) == std::set<std::string>({ "b", "c" }));
+}
+
+// Following a package adds its paths, and unfollowing it takes them back out
+void OwnersTest::testInstallAndUninstall() {
+    Pkg pkg(testPkgPath(), 0, OWNERS_INSTALLED_DIR);
+    CPPUNIT_ASSERT(pkg.installPkgWithScripts(OWNERS_ROOT, OWNERS_INSTALLED_DIR, 0) >= 0);
+
+    {
+        OwnerIndex index(OWNERS_INSTALLED_DIR, 0);
+        CPPUNIT_ASSERT(index.isValid());
+        CPPUNIT_ASSERT(index.findOwners(TEST_PKG_FILE) == std::vector<std::string>({ TEST_PKG_NAME }));
+        CPPUNIT_ASSERT(index.findOwners(TEST_PKG_DIR_MEMBER) == std::vector<std::string>({ TEST_PKG_NAME }));
+        CPPUNIT_ASSERT(index.findOwners(PRE_INSTALL_NAME).empty());
+    }
+
+    CPPUNIT_ASSERT(pkg.unfollowPkg(OWNERS_INSTALLED_DIR, 0));
+
+    OwnerIndex index(OWNERS_INSTALLED_DIR, 0);
+    CPPUNIT_ASSERT(index.findOwners(TEST_PKG_FILE).empty());
+}
+
+// The scripts, metadata and index never make it into the root, so no package owns them, even when they're stored as ./pre-install.sh
+void OwnersTest::testScriptsAreNotOwned() {
+    std::vector<testMember_s> members(4);
+    members[0].path = "./" PRE_INSTALL_NAME;
+    members[0].data = "#!/bin/sh\n";
+    members[0].mode = 0755;
+    members[1].path = "./" POST_UNINSTALL_NAME;
+    members[1].data = "#!/bin/sh\n";
+    members[1].mode = 0755;
+    members[2].path = "./" PKG_META_NAME;
+    members[2].data = "version=1\n";
+    members[3].path = "./usr/bin/dot";
+    members[3].data = "dot\n";
+
+    std::string tarPath = OWNERS_BASE_DIR "dot.tar";
+    CPPUNIT_ASSERT(writeTestTar(tarPath, members));
+
+    Pkg pkg(tarPath, 0);
+    CPPUNIT_ASSERT(pkg.followPkg(OWNERS_INSTALLED_DIR, 0));
+
+    std::vector<manifestEntry_s> entries;
+    PkgDatabase db(OWNERS_INSTALLED_DIR, 0);
+    CPPUNIT_ASSERT(db.getManifest("dot", entries) == 0);
+    CPPUNIT_ASSERT(entries.size() == 1);
+    CPPUNIT_ASSERT(normalizeMemberPath(entries[0].path) == "usr/bin/dot");
+
+    OwnerIndex index(OWNERS_INSTALLED_DIR, 0);
+    CPPUNIT_ASSERT(index.findOwners("usr/bin/dot") == std::vector<std::string>({ "dot" }));
+    CPPUNIT_ASSERT(index.findOwners(PRE_INSTALL_NAME).empty());
+    CPPUNIT_ASSERT(index.findOwners(POST_UNINSTALL_NAME).empty());
+    CPPUNIT_ASSERT(index.findOwners(PKG_META_NAME).empty());
+}
+
+// An index which missed a package being replaced has the same package count as the database, but not its generation, so it's rebuilt
+void OwnersTest::testStaleIndexAfterReplace() {
+    std::vector<manifestEntry_s> entries(1);
+    dbRecord_s rec;
+    rec.name = "a";
+
+    entries[0].path = "usr/bin/old";
+    rec.manifest = serializeManifest(entries);
+    CPPUNIT_ASSERT(PkgDatabase(OWNERS_INSTALLED_DIR, 0).put(rec) == 0);
+    std::string oldIndex = readTestFile(OWNERS_INSTALLED_DIR OWNERS_FILENAME);
+
+    entries[0].path = "usr/bin/new";
+    rec.manifest = serializeManifest(entries);
+    CPPUNIT_ASSERT(PkgDatabase(OWNERS_INSTALLED_DIR, 0).put(rec) == 0);
+
+    // As if we crashed between renaming the database and the owner index into place
+    CPPUNIT_ASSERT(writeTestFile(OWNERS_INSTALLED_DIR OWNERS_FILENAME, oldIndex));
+
+    {
+        PkgDatabase db(OWNERS_INSTALLED_DIR, 0);
+        CPPUNIT_ASSERT(db.getGeneration() == 2);
+        CPPUNIT_ASSERT(!db.ownersAreCurrent());
+        CPPUNIT_ASSERT(db.refreshOwners() == 0);
+        CPPUNIT_ASSERT(db.ownersAreCurrent());
+    }
+
+    OwnerIndex index(OWNERS_INSTALLED_DIR, 0);
+    CPPUNIT_ASSERT(index.getGeneration() == 2);
+    CPPUNIT_ASSERT(index.findOwners("usr/bin/new") == std::vector<std::string>({ "a" }));
+    CPPUNIT_ASSERT(index.findOwners("usr/bin/old").empty());
+}
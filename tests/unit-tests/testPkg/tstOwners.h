@@ -0,0 +1,42 @@
+#ifndef _THE2B_TST_OWNERS_H
+#define _THE2B_TST_OWNERS_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <filesystem>
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestResultCollector.h>
+
+#include "Pkg.h"
+#include "Owners.h"
+#include "Database.h"
+#include "tstUtils.h"
+
+#define OWNERS_BASE_DIR "test-env-owners/"
+#define OWNERS_INSTALLED_DIR "test-env-owners/installed/"
+#define OWNERS_ROOT "test-env-owners/sysroot/"
+
+// Writes owner indexes directly, and through installs, and looks paths up in them
+class OwnersTest : public CppUnit::TestFixture {
+    public:
+        void setUp();
+        void tearDown();
+
+        void testFindOwners();
+        void testSharedDirectory();
+        void testLookupAcrossBlocks();
+        void testUpdateOwnerIndex();
+        void testInstallAndUninstall();
+        void testScriptsAreNotOwned();
+        void testStaleIndexAfterReplace();
+
+        static CppUnit::Test* suite();
+};
+
+#endif /* _THE2B_TST_OWNERS_H */
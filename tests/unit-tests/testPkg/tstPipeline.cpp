@@ -0,0 +1,257 @@
+#include "tstPipeline.h"
+
+CppUnit::Test* PipelineTest::suite() {
+    CppUnit::TestSuite* suite = new CppUnit::TestSuite( "PipelineTest" );
+
+    suite->addTest( new CppUnit::TestCaller<PipelineTest>( "testSharedDirectories", &PipelineTest::testSharedDirectories ));
+    suite->addTest( new CppUnit::TestCaller<PipelineTest>( "testSharedFileLaterPackageWins", &PipelineTest::testSharedFileLaterPackageWins ));
+    suite->addTest( new CppUnit::TestCaller<PipelineTest>( "testScriptOrderWithoutConflicts", &PipelineTest::testScriptOrderWithoutConflicts ));
+    suite->addTest( new CppUnit::TestCaller<PipelineTest>( "testOnlyPreInstallsWait", &PipelineTest::testOnlyPreInstallsWait ));
+    suite->addTest( new CppUnit::TestCaller<PipelineTest>( "testPostInstallSeesEarlierPackagesOnly", &PipelineTest::testPostInstallSeesEarlierPackagesOnly ));
+    suite->addTest( new CppUnit::TestCaller<PipelineTest>( "testConflictWaitsForEarlierPackage", &PipelineTest::testConflictWaitsForEarlierPackage ));
+    suite->addTest( new CppUnit::TestCaller<PipelineTest>( "testFileConflictsWithImpliedDirectory", &PipelineTest::testFileConflictsWithImpliedDirectory ));
+    suite->addTest( new CppUnit::TestCaller<PipelineTest>( "testFailedPreInstallIsNotFollowed", &PipelineTest::testFailedPreInstallIsNotFollowed ));
+    suite->addTest( new CppUnit::TestCaller<PipelineTest>( "testDotSlashScriptsRun", &PipelineTest::testDotSlashScriptsRun ));
+
+    return suite;
+}
+
+void PipelineTest::setUp() {
+    CPPUNIT_ASSERT(makeTestDirs({ PIPELINE_BASE_DIR, PIPELINE_PKG_DIR, PIPELINE_INSTALLED_DIR, PIPELINE_ROOT }));
+}
+
+void PipelineTest::tearDown() {
+    removeTestDir(PIPELINE_BASE_DIR);
+}
+
+// Writes a package whose scripts log their name and the package's to PIPELINE_LOG. The scripts run from the root, so the log's path is absolute
+// Without a shell, the package has no pre-install script, and without post, no post-install script. The scripts' paths start with prefix, as ./ does for a package made with tar -C dir .
+void PipelineTest::writeTestPkg(const std::string& name, std::vector<testMember_s> members, const std::string& shell, const std::string& prefix, bool post) {
+    std::string log = std::filesystem::absolute(PIPELINE_LOG);
+
+    testMember_s pre;
+    pre.path = prefix + PRE_INSTALL_NAME;
+    pre.data = "#!" + shell + "\necho pre-" + name + " >> " + log + "\n";
+    pre.mode = 0755;
+
+    testMember_s postInstall;
+    postInstall.path = prefix + POST_INSTALL_NAME;
+    postInstall.data = "#!/bin/sh\necho post-" + name + " >> " + log + "\n";
+    postInstall.mode = 0755;
+
+    if(!shell.empty()) {
+        members.push_back(pre);
+    }
+
+    if(post) {
+        members.push_back(postInstall);
+    }
+
+    CPPUNIT_ASSERT(writeTestTar(PIPELINE_PKG_DIR + name + ".tar", members));
+}
+
+int PipelineTest::installTestPkgs(const std::vector<std::string>& names, unsigned int jobs) {
+    std::vector<Pkg> pkgs;
+    for(const std::string& name : names) {
+        pkgs.push_back(Pkg(PIPELINE_PKG_DIR + name + ".tar", 0, PIPELINE_INSTALLED_DIR));
+    }
+
+    return installPkgsPipelined(pkgs, PIPELINE_ROOT, PIPELINE_INSTALLED_DIR, 0, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES)), DEFAULT_SMART_OP, jobs, 1);
+}
+
+// Packages which only share directories, and have no scripts, are all extracted at once, and all make it into the root
+void PipelineTest::testSharedDirectories() {
+    for(const std::string name : { "a", "b", "c" }) {
+        testMember_s dir;
+        dir.path = "usr/share";
+        dir.type = TAR_TYPE_DIRECTORY;
+        dir.mode = 0755;
+
+        testMember_s file;
+        file.path = "usr/share/" + name;
+        file.data = name + "\n";
+
+        writeTestPkg(name, { dir, file }, "", "", false);
+    }
+
+    CPPUNIT_ASSERT(installTestPkgs({ "a", "b", "c" }, 3) == 0);
+    CPPUNIT_ASSERT(listTestTree(PIPELINE_ROOT) == std::vector<std::string>({ "usr", "usr/share", "usr/share/a", "usr/share/b", "usr/share/c" }));
+
+    PkgDatabase db(PIPELINE_INSTALLED_DIR, 0);
+    CPPUNIT_ASSERT(db.listNames() == std::vector<std::string>({ "a", "b", "c" }));
+}
+
+// A file written by several packages ends up as the last of them has it, as if they were installed one at a time
+void PipelineTest::testSharedFileLaterPackageWins() {
+    for(const std::string name : { "a", "b", "c", "d" }) {
+        testMember_s file;
+        file.path = "etc/shared";
+        file.data = std::string(1 << 16, name[0]);
+
+        writeTestPkg(name, { file });
+    }
+
+    CPPUNIT_ASSERT(installTestPkgs({ "a", "b", "c", "d" }, 4) == 0);
+    CPPUNIT_ASSERT(readTestFile(PIPELINE_ROOT "etc/shared") == std::string(1 << 16, 'd'));
+
+    PkgDatabase db(PIPELINE_INSTALLED_DIR, 0);
+    CPPUNIT_ASSERT(db.listNames() == std::vector<std::string>({ "a", "b", "c", "d" }));
+}
+
+// Even without shared files, a pre-install script only runs once every package before it was installed and its post-install script ran
+void PipelineTest::testScriptOrderWithoutConflicts() {
+    for(const std::string name : { "a", "b", "c", "d" }) {
+        testMember_s file;
+        file.path = name;
+        file.data = name + "\n";
+
+        writeTestPkg(name, { file });
+    }
+
+    CPPUNIT_ASSERT(installTestPkgs({ "a", "b", "c", "d" }, 4) == 0);
+    CPPUNIT_ASSERT(readTestFile(PIPELINE_LOG) == "pre-a\npost-a\npre-b\npost-b\npre-c\npost-c\npre-d\npost-d\n");
+}
+
+// A package without scripts is dispatched alongside a package before it which only has a pre-install script, while the next pre-install script waits for both
+void PipelineTest::testOnlyPreInstallsWait() {
+    for(const std::string name : { "a", "b" }) {
+        testMember_s file;
+        file.path = name;
+        file.data = name + "\n";
+
+        writeTestPkg(name, { file }, (name == "b") ? "" : "/bin/sh", "", false);
+    }
+
+    // c's pre-install script logs the files it finds in the root
+    std::string log = std::filesystem::absolute(PIPELINE_LOG);
+    testMember_s pre;
+    pre.path = PRE_INSTALL_NAME;
+    pre.data = "#!/bin/sh\necho pre-c $(ls | tr '\\n' ' ') >> " + log + "\n";
+    pre.mode = 0755;
+
+    testMember_s file;
+    file.path = "c";
+    file.data = "c\n";
+    CPPUNIT_ASSERT(writeTestTar(PIPELINE_PKG_DIR "c.tar", { pre, file }));
+
+    CPPUNIT_ASSERT(installTestPkgs({ "a", "b", "c" }, 3) == 0);
+    CPPUNIT_ASSERT(readTestFile(PIPELINE_LOG) == "pre-a\npre-c a b\n");
+}
+
+// A post-install script sees the packages up to its own in the root, and none of those after it, even with nothing else holding them back
+void PipelineTest::testPostInstallSeesEarlierPackagesOnly() {
+    std::string log = std::filesystem::absolute(PIPELINE_LOG);
+    for(const std::string name : { "a", "b", "c", "d" }) {
+        testMember_s file;
+        file.path = name;
+        file.data = std::string(1 << 16, name[0]);
+
+        // a and c log the files they find in the root once they're installed. b and d have no scripts
+        std::vector<testMember_s> members = { file };
+        if(name == "a" || name == "c") {
+            testMember_s post;
+            post.path = POST_INSTALL_NAME;
+            post.data = "#!/bin/sh\necho post-" + name + " $(ls | tr '\\n' ' ') >> " + log + "\n";
+            post.mode = 0755;
+            members.insert(members.begin(), post);
+        }
+
+        CPPUNIT_ASSERT(writeTestTar(PIPELINE_PKG_DIR + name + ".tar", members));
+    }
+
+    CPPUNIT_ASSERT(installTestPkgs({ "a", "b", "c", "d" }, 4) == 0);
+    CPPUNIT_ASSERT(readTestFile(PIPELINE_LOG) == "post-a a\npost-c a b c\n");
+    CPPUNIT_ASSERT(listTestTree(PIPELINE_ROOT) == std::vector<std::string>({ "a", "b", "c", "d" }));
+}
+
+// A package writing a file one in flight also writes isn't dispatched until that one is finished. Neither is anything after it
+void PipelineTest::testConflictWaitsForEarlierPackage() {
+    testMember_s shared;
+    shared.path = "etc/shared";
+    shared.data = "a\n";
+    writeTestPkg("a", { shared });
+
+    shared.data = "b\n";
+    writeTestPkg("b", { shared });
+
+    testMember_s other;
+    other.path = "etc/other";
+    other.data = "c\n";
+    writeTestPkg("c", { other });
+
+    CPPUNIT_ASSERT(installTestPkgs({ "a", "b", "c" }, 3) == 0);
+    CPPUNIT_ASSERT(readTestFile(PIPELINE_LOG) == "pre-a\npost-a\npre-b\npost-b\npre-c\npost-c\n");
+    CPPUNIT_ASSERT(readTestFile(PIPELINE_ROOT "etc/shared") == "b\n");
+}
+
+// A package writing below a path another package ships as a file waits for it, even without a member for the directory
+// a writes plenty before its file, so b would get to the directory first if the two were extracted at once
+void PipelineTest::testFileConflictsWithImpliedDirectory() {
+    std::vector<testMember_s> members;
+    for(unsigned int index = 0; index < 64; index++) {
+        testMember_s fill;
+        fill.path = "fill/" + std::to_string(index);
+        fill.data = std::string(1 << 16, 'a');
+        members.push_back(fill);
+    }
+
+    testMember_s file;
+    file.path = "a";
+    file.data = "a\n";
+    members.push_back(file);
+    writeTestPkg("a", members, "", "", false);
+
+    testMember_s below;
+    below.path = "a/b";
+    below.data = "b\n";
+    writeTestPkg("b", { below }, "", "", false);
+
+    int serial = installTestPkgs({ "a", "b" }, 1);
+    std::vector<std::string> serialTree = listTestTree(PIPELINE_ROOT);
+    CPPUNIT_ASSERT(readTestFile(PIPELINE_ROOT "a") == "a\n");
+
+    removeTestDir(PIPELINE_ROOT);
+    removeTestDir(PIPELINE_INSTALLED_DIR);
+    CPPUNIT_ASSERT(makeTestDirs({ PIPELINE_INSTALLED_DIR, PIPELINE_ROOT }));
+
+    CPPUNIT_ASSERT(installTestPkgs({ "a", "b" }, 2) == serial);
+    CPPUNIT_ASSERT(listTestTree(PIPELINE_ROOT) == serialTree);
+    CPPUNIT_ASSERT(readTestFile(PIPELINE_ROOT "a") == "a\n");
+}
+
+// A package whose pre-install script can't be run is never extracted, and the rest go on without it
+void PipelineTest::testFailedPreInstallIsNotFollowed() {
+    for(const std::string name : { "a", "b", "c" }) {
+        testMember_s file;
+        file.path = name;
+        file.data = name + "\n";
+
+        writeTestPkg(name, { file }, (name == "b") ? "/nonexistent/sh" : "/bin/sh");
+    }
+
+    CPPUNIT_ASSERT(installTestPkgs({ "a", "b", "c" }, 3) == -1);
+    CPPUNIT_ASSERT(readTestFile(PIPELINE_LOG) == "pre-a\npost-a\npre-c\npost-c\n");
+    CPPUNIT_ASSERT(listTestTree(PIPELINE_ROOT) == std::vector<std::string>({ "a", "c" }));
+
+    PkgDatabase db(PIPELINE_INSTALLED_DIR, 0);
+    CPPUNIT_ASSERT(db.listNames() == std::vector<std::string>({ "a", "c" }));
+}
+
+// Scripts stored as ./pre-install.sh are the package's scripts, whether installed alone, in the pipeline or one job at a time, and are never written to the root
+void PipelineTest::testDotSlashScriptsRun() {
+    for(const std::string name : { "a", "b", "c" }) {
+        testMember_s file;
+        file.path = "./" + name;
+        file.data = name + "\n";
+
+        writeTestPkg(name, { file }, "/bin/sh", "./");
+    }
+
+    Pkg pkg(PIPELINE_PKG_DIR "a.tar", 0, PIPELINE_INSTALLED_DIR);
+    CPPUNIT_ASSERT(pkg.installPkgWithScripts(PIPELINE_ROOT, PIPELINE_INSTALLED_DIR, 0, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES)), DEFAULT_SMART_OP, 1) == ARCHIVE_EOF);
+    CPPUNIT_ASSERT(installTestPkgs({ "b" }, 1) == 0);
+    CPPUNIT_ASSERT(installTestPkgs({ "c" }, 4) == 0);
+
+    CPPUNIT_ASSERT(readTestFile(PIPELINE_LOG) == "pre-a\npost-a\npre-b\npost-b\npre-c\npost-c\n");
+    CPPUNIT_ASSERT(listTestTree(PIPELINE_ROOT) == std::vector<std::string>({ "a", "b", "c" }));
+}
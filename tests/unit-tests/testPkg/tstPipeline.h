@@ -0,0 +1,47 @@
+#ifndef _THE2B_TST_PIPELINE_H
+#define _THE2B_TST_PIPELINE_H
+
+#include <string>
+#include <vector>
+#include <filesystem>
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestResultCollector.h>
+
+#include "Pkg.h"
+#include "Pipeline.h"
+#include "Database.h"
+#include "tstUtils.h"
+
+#define PIPELINE_BASE_DIR "test-env-pipeline/"
+#define PIPELINE_PKG_DIR "test-env-pipeline/pkgs/"
+#define PIPELINE_INSTALLED_DIR "test-env-pipeline/installed/"
+#define PIPELINE_ROOT "test-env-pipeline/sysroot/"
+#define PIPELINE_LOG "test-env-pipeline/scripts.log"
+
+// Installs several packages at once, and checks the order their scripts ran in, and what they left in the root
+class PipelineTest : public CppUnit::TestFixture {
+    public:
+        void setUp();
+        void tearDown();
+
+        void testSharedDirectories();
+        void testSharedFileLaterPackageWins();
+        void testScriptOrderWithoutConflicts();
+        void testOnlyPreInstallsWait();
+        void testPostInstallSeesEarlierPackagesOnly();
+        void testConflictWaitsForEarlierPackage();
+        void testFileConflictsWithImpliedDirectory();
+        void testFailedPreInstallIsNotFollowed();
+        void testDotSlashScriptsRun();
+
+        static CppUnit::Test* suite();
+
+        void writeTestPkg(const std::string& name, std::vector<testMember_s> members, const std::string& shell = "/bin/sh", const std::string& prefix = "", bool post = true);
+        int installTestPkgs(const std::vector<std::string>& names, unsigned int jobs);
+};
+
+#endif /* _THE2B_TST_PIPELINE_H */
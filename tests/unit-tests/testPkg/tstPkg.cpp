@@ -5,15 +5,88 @@ std::string execDir;
 int main( int argc, char **argv) {
     execDir = std::string(dirname(argv[0]));
 
+    CppUnit::TextTestRunner extractRunner;
+    CppUnit::TextTestRunner pipelineRunner;
+    CppUnit::TextTestRunner manifestRunner;
+    CppUnit::TextTestRunner databaseRunner;
+    CppUnit::TextTestRunner ownersRunner;
+    CppUnit::TextTestRunner searchRunner;
+    CppUnit::TextTestRunner exclusionsRunner;
+    CppUnit::TextTestRunner quarantineRunner;
+    CppUnit::TextTestRunner stageRunner;
+    CppUnit::TextTestRunner storeRunner;
+    CppUnit::TextTestRunner fanOutRunner;
+    CppUnit::TextTestRunner pkgIndexRunner;
+    CppUnit::TextTestRunner pkgExtractRunner;
+    CppUnit::TextTestRunner memberCacheRunner;
+    CppUnit::TextTestRunner pkgBuildRunner;
+    CppUnit::TextTestRunner pkgMetaRunner;
+    CppUnit::TextTestRunner prefetchRunner;
+    CppUnit::TextTestRunner removeRunner;
+    CppUnit::TextTestRunner scriptRunner;
+    CppUnit::TextTestRunner writerPoolRunner;
+    CppUnit::TextTestRunner dirCacheRunner;
+    CppUnit::TextTestRunner decompressRunner;
+    CppUnit::TextTestRunner archiveInputRunner;
+    CppUnit::TextTestRunner durabilityRunner;
     CppUnit::TextTestRunner mvsRunner;
     CppUnit::TextTestRunner funcRunner;
+    extractRunner.addTest( ExtractTest::suite() );
+    pipelineRunner.addTest( PipelineTest::suite() );
+    manifestRunner.addTest( ManifestTest::suite() );
+    databaseRunner.addTest( DatabaseTest::suite() );
+    ownersRunner.addTest( OwnersTest::suite() );
+    searchRunner.addTest( SearchTest::suite() );
+    exclusionsRunner.addTest( ExclusionsTest::suite() );
+    quarantineRunner.addTest( QuarantineTest::suite() );
+    stageRunner.addTest( StageTest::suite() );
+    storeRunner.addTest( StoreTest::suite() );
+    fanOutRunner.addTest( FanOutTest::suite() );
+    pkgIndexRunner.addTest( PkgIndexTest::suite() );
+    pkgExtractRunner.addTest( PkgExtractTest::suite() );
+    memberCacheRunner.addTest( MemberCacheTest::suite() );
+    pkgBuildRunner.addTest( PkgBuildTest::suite() );
+    pkgMetaRunner.addTest( PkgMetaTest::suite() );
+    prefetchRunner.addTest( PrefetchTest::suite() );
+    removeRunner.addTest( RemoveTest::suite() );
+    scriptRunner.addTest( ScriptTest::suite() );
+    writerPoolRunner.addTest( WriterPoolTest::suite() );
+    dirCacheRunner.addTest( DirCacheTest::suite() );
+    decompressRunner.addTest( DecompressTest::suite() );
+    archiveInputRunner.addTest( ArchiveInputTest::suite() );
+    durabilityRunner.addTest( DurabilityTest::suite() );
     mvsRunner.addTest( PkgTest::memberVarSuite() );
     funcRunner.addTest( PkgTest::functionalitySuite() );
 
+    // The fixtures other than PkgTest build their own environments, so they run first
+    extractRunner.run("", false, true, false);
+    pipelineRunner.run("", false, true, false);
+    manifestRunner.run("", false, true, false);
+    databaseRunner.run("", false, true, false);
+    ownersRunner.run("", false, true, false);
+    searchRunner.run("", false, true, false);
+    exclusionsRunner.run("", false, true, false);
+    quarantineRunner.run("", false, true, false);
+    stageRunner.run("", false, true, false);
+    storeRunner.run("", false, true, false);
+    fanOutRunner.run("", false, true, false);
+    pkgIndexRunner.run("", false, true, false);
+    pkgExtractRunner.run("", false, true, false);
+    memberCacheRunner.run("", false, true, false);
+    pkgBuildRunner.run("", false, true, false);
+    pkgMetaRunner.run("", false, true, false);
+    prefetchRunner.run("", false, true, false);
+    removeRunner.run("", false, true, false);
+    scriptRunner.run("", false, true, false);
+    writerPoolRunner.run("", false, true, false);
+    dirCacheRunner.run("", false, true, false);
+    decompressRunner.run("", false, true, false);
+    archiveInputRunner.run("", false, true, false);
+    durabilityRunner.run("", false, true, false);
     mvsRunner.run("", false, true, false);
     funcRunner.run("", false, true, false);
 
-    return (-1 * (mvsRunner.result().testFailuresTotal() + funcRunner.result().testFailuresTotal()));
+    return (-1 * (extractRunner.result().testFailuresTotal() + pipelineRunner.result().testFailuresTotal() + manifestRunner.result().testFailuresTotal() + databaseRunner.result().testFailuresTotal() + ownersRunner.result().testFailuresTotal() + searchRunner.result().testFailuresTotal() + exclusionsRunner.result().testFailuresTotal() + quarantineRunner.result().testFailuresTotal() + stageRunner.result().testFailuresTotal() + storeRunner.result().testFailuresTotal() + fanOutRunner.result().testFailuresTotal() + pkgIndexRunner.result().testFailuresTotal() + pkgExtractRunner.result().testFailuresTotal() + memberCacheRunner.result().testFailuresTotal() + pkgBuildRunner.result().testFailuresTotal() + pkgMetaRunner.result().testFailuresTotal() + prefetchRunner.result().testFailuresTotal() + removeRunner.result().testFailuresTotal() + scriptRunner.result().testFailuresTotal() + writerPoolRunner.result().testFailuresTotal() + dirCacheRunner.result().testFailuresTotal() + decompressRunner.result().testFailuresTotal() + archiveInputRunner.result().testFailuresTotal() + durabilityRunner.result().testFailuresTotal() + mvsRunner.result().testFailuresTotal() + funcRunner.result().testFailuresTotal()));
 }
 
 CppUnit::Test* PkgTest::memberVarSuite() {
@@ -120,7 +193,7 @@ void PkgTest::testInstall() {
         Pkg pkg = *pkgVector[index];
         
         // Install the package
-        int res = pkg.installPkg(FAKEROOT, INSTALLED_DIR, VERBOSITY, std::set<std::string>(), false);
+        int res = pkg.installPkg(FAKEROOT, INSTALLED_DIR, VERBOSITY, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES)), false);
         printf("res = %d\n", res);
 
         CPPUNIT_ASSERT((res == ARCHIVE_OK || res == ARCHIVE_EOF));
@@ -169,11 +242,28 @@ void PkgTest::testFollow() {
 
         pkgVector[index]->followPkg(INSTALLED_DIR, VERBOSITY);
         
-        std::string filePath = INSTALLED_DIR;
-        filePath += pkgVector[index]->getPkgName();
+        PkgDatabase db(INSTALLED_DIR, VERBOSITY);
 
         // Verify it exists
-        CPPUNIT_ASSERT(std::filesystem::exists(filePath));
+        CPPUNIT_ASSERT(db.contains(pkgVector[index]->getPkgName()));
+
+        // Verify it holds a manifest listing everything the package puts in the root, which leaves out its scripts, metadata and index
+        std::vector<manifestEntry_s> entries;
+        CPPUNIT_ASSERT(db.getManifest(pkgVector[index]->getPkgName(), entries) == 0);
+
+        std::set<std::string> manifestPaths;
+        for(const manifestEntry_s& e : entries) {
+            manifestPaths.insert(e.path);
+        }
+
+        std::set<std::string> tarPaths;
+        for(const tarMember_s& m : pkgVector[index]->getPkgMembers(VERBOSITY)) {
+            if(!isPkgScript(m.path) && !isPkgMeta(m.path) && !isPkgIndex(m.path)) {
+                tarPaths.insert(m.path);
+            }
+        }
+
+        CPPUNIT_ASSERT(manifestPaths == tarPaths);
 
         printf("End follow test for package %d\n",index);
     }
@@ -192,7 +282,9 @@ void PkgTest::testUnfollow() {
         std::string filePath = INSTALLED_DIR;
         filePath += pkgVector[index]->getPkgName();
 
-        // Verify it does not exist
+        // Verify it does not exist, and that the legacy index file was imported and removed
+        PkgDatabase db(INSTALLED_DIR, VERBOSITY);
+        CPPUNIT_ASSERT(!db.contains(pkgVector[index]->getPkgName()));
         CPPUNIT_ASSERT(!std::filesystem::exists(filePath));
 
         printf("End unfollow test for package %d\n",index);
@@ -201,19 +293,20 @@ void PkgTest::testUnfollow() {
     postTestUnfollow();
 }
 
-// @TODO
-// Just have an archive with the script. Have the script touch a file. Check for that file's existence.
+// The scripts of the script test package each write their phase into SCRIPT_MARKER_DIR<phase>. Check for that marker.
 void PkgTest::testPreInstallScript() {
     preTestPreInstallScript();
 
-    for(int index = 0; index < pkgVector.size(); index++) {
-        printf("Begin pre-install script test for package %d\n",index);
+    printf("Begin pre-install script test\n");
 
-        pkgVector[index]->execPreInstallScript(VERBOSITY);
-        CPPUNIT_ASSERT(std::filesystem::exists("/tmp/" + pkgVector[index]->getPkgName() + "-pre-install"));
+    Pkg pkg(PKG_DIR TEST_SCRIPT_PKG_NAME ".tar", 0);
+    CPPUNIT_ASSERT(pkg.execPreInstallScript(VERBOSITY) == 0);
+    CPPUNIT_ASSERT(readTestFile(SCRIPT_MARKER_DIR "pre-install") == "pre-install\n");
 
-        printf("End pre-install script test for package %d\n",index);
-    }
+    // Scripts are run from memory, so nothing should be left behind in /tmp
+    CPPUNIT_ASSERT(!std::filesystem::exists("/tmp/" TEST_SCRIPT_PKG_NAME "-pre-install"));
+
+    printf("End pre-install script test\n");
 
     postTestPreInstallScript();
 }
@@ -221,14 +314,16 @@ void PkgTest::testPreInstallScript() {
 void PkgTest::testPostInstallScript() {
     preTestPostInstallScript();
 
-    for(int index = 0; index < pkgVector.size(); index++) {
-        printf("Begin post-install script test for package %d\n",index);
+    printf("Begin post-install script test\n");
 
-        pkgVector[index]->execPostInstallScript(VERBOSITY);
-        CPPUNIT_ASSERT(std::filesystem::exists("/tmp/" + pkgVector[index]->getPkgName() + "-post-install"));
+    Pkg pkg(PKG_DIR TEST_SCRIPT_PKG_NAME ".tar", 0);
+    CPPUNIT_ASSERT(pkg.execPostInstallScript(VERBOSITY) == 0);
+    CPPUNIT_ASSERT(readTestFile(SCRIPT_MARKER_DIR "post-install") == "post-install\n");
 
-        printf("End post-install script test for package %d\n",index);
-    }
+    // Scripts are run from memory, so nothing should be left behind in /tmp
+    CPPUNIT_ASSERT(!std::filesystem::exists("/tmp/" TEST_SCRIPT_PKG_NAME "-post-install"));
+
+    printf("End post-install script test\n");
 
     postTestPostInstallScript();
 }
@@ -236,14 +331,16 @@ void PkgTest::testPostInstallScript() {
 void PkgTest::testPreUninstallScript() {
     preTestPreUninstallScript();
 
-    for(int index = 0; index < pkgVector.size(); index++) {
-        printf("Begin pre-uninstall script test for package %d\n",index);
+    printf("Begin pre-uninstall script test\n");
 
-        pkgVector[index]->execPreUninstallScript(VERBOSITY);
-        CPPUNIT_ASSERT(std::filesystem::exists("/tmp/" + pkgVector[index]->getPkgName() + "-pre-uninstall"));
+    Pkg pkg(PKG_DIR TEST_SCRIPT_PKG_NAME ".tar", 0);
+    CPPUNIT_ASSERT(pkg.execPreUninstallScript(VERBOSITY) == 0);
+    CPPUNIT_ASSERT(readTestFile(SCRIPT_MARKER_DIR "pre-uninstall") == "pre-uninstall\n");
 
-        printf("End pre-uninstall script test for package %d\n",index);
-    }
+    // Scripts are run from memory, so nothing should be left behind in /tmp
+    CPPUNIT_ASSERT(!std::filesystem::exists("/tmp/" TEST_SCRIPT_PKG_NAME "-pre-uninstall"));
+
+    printf("End pre-uninstall script test\n");
 
     postTestPreUninstallScript();
 }
@@ -251,14 +348,16 @@ void PkgTest::testPreUninstallScript() {
 void PkgTest::testPostUninstallScript() {
     preTestPostUninstallScript();
 
-    for(int index = 0; index < pkgVector.size(); index++) {
-        printf("Begin post-uninstall script test for package %d\n",index);
+    printf("Begin post-uninstall script test\n");
 
-        pkgVector[index]->execPostUninstallScript(VERBOSITY);
-        CPPUNIT_ASSERT(std::filesystem::exists("/tmp/" + pkgVector[index]->getPkgName() + "-post-uninstall"));
+    Pkg pkg(PKG_DIR TEST_SCRIPT_PKG_NAME ".tar", 0);
+    CPPUNIT_ASSERT(pkg.execPostUninstallScript(VERBOSITY) == 0);
+    CPPUNIT_ASSERT(readTestFile(SCRIPT_MARKER_DIR "post-uninstall") == "post-uninstall\n");
 
-        printf("End post-install script test for package %d\n",index);
-    }
+    // Scripts are run from memory, so nothing should be left behind in /tmp
+    CPPUNIT_ASSERT(!std::filesystem::exists("/tmp/" TEST_SCRIPT_PKG_NAME "-post-uninstall"));
+
+    printf("End post-uninstall script test\n");
 
     postTestPostUninstallScript();
 }
@@ -348,51 +447,19 @@ int PkgTest::preTestUnfollow() {
 }
 
 int PkgTest::preTestPreInstallScript() {
-    for(int index = 0; index < pkgVector.size(); index++) {
-        std::string path = "/tmp/" + pkgVector[index]->getPkgName();
-        removeFullPath(path.c_str());
-        
-        std::string file = "/tmp/" + pkgVector[index]->getPkgName() + "-pre-install";
-        removeFullPath(file.c_str());
-    }
-
-    return 0;
+    return removeFullPath(SCRIPT_MARKER_DIR);
 }
 
 int PkgTest::preTestPostInstallScript() {
-    for(int index = 0; index < pkgVector.size(); index++) {
-        std::string path = "/tmp/" + pkgVector[index]->getPkgName();
-        removeFullPath(path.c_str());
-        
-        std::string file = "/tmp/" + pkgVector[index]->getPkgName() + "-post-install";
-        removeFullPath(file.c_str());
-    }
-
-    return 0;
+    return removeFullPath(SCRIPT_MARKER_DIR);
 }
 
 int PkgTest::preTestPreUninstallScript() {
-    for(int index = 0; index < pkgVector.size(); index++) {
-        std::string path = "/tmp/" + pkgVector[index]->getPkgName();
-        removeFullPath(path.c_str());
-        
-        std::string file = "/tmp/" + pkgVector[index]->getPkgName() + "-pre-uninstall";
-        removeFullPath(file.c_str());
-    }
-
-    return 0;
+    return removeFullPath(SCRIPT_MARKER_DIR);
 }
 
 int PkgTest::preTestPostUninstallScript() {
-    for(int index = 0; index < pkgVector.size(); index++) {
-        std::string path = "/tmp/" + pkgVector[index]->getPkgName();
-        removeFullPath(path.c_str());
-        
-        std::string file = "/tmp/" + pkgVector[index]->getPkgName() + "-post-uninstall";
-        removeFullPath(file.c_str());
-    }
-
-    return 0;
+    return removeFullPath(SCRIPT_MARKER_DIR);
 }
 
 int PkgTest::postTestMemberVars() {
@@ -433,51 +500,19 @@ int PkgTest::postTestUnfollow() {
 }
 
 int PkgTest::postTestPreInstallScript() {
-    for(int index = 0; index < pkgVector.size(); index++) {
-        std::string path = "/tmp/" + pkgVector[index]->getPkgName();
-        removeFullPath(path.c_str());
-        
-        std::string file = "/tmp/" + pkgVector[index]->getPkgName() + "-pre-install";
-        removeFullPath(file.c_str());
-    }
-
-    return 0;
+    return removeFullPath(SCRIPT_MARKER_DIR);
 }
 
 int PkgTest::postTestPostInstallScript() {
-    for(int index = 0; index < pkgVector.size(); index++) {
-        std::string path = "/tmp/" + pkgVector[index]->getPkgName();
-        removeFullPath(path.c_str());
-        
-        std::string file = "/tmp/" + pkgVector[index]->getPkgName() + "-post-install";
-        removeFullPath(file.c_str());
-    }
-
-    return 0;
+    return removeFullPath(SCRIPT_MARKER_DIR);
 }
 
 int PkgTest::postTestPreUninstallScript() {
-    for(int index = 0; index < pkgVector.size(); index++) {
-        std::string path = "/tmp/" + pkgVector[index]->getPkgName();
-        removeFullPath(path.c_str());
-        
-        std::string file = "/tmp/" + pkgVector[index]->getPkgName() + "-pre-uninstall";
-        removeFullPath(file.c_str());
-    }
-
-    return 0;
+    return removeFullPath(SCRIPT_MARKER_DIR);
 }
 
 int PkgTest::postTestPostUninstallScript() {
-    for(int index = 0; index < pkgVector.size(); index++) {
-        std::string path = "/tmp/" + pkgVector[index]->getPkgName();
-        removeFullPath(path.c_str());
-        
-        std::string file = "/tmp/" + pkgVector[index]->getPkgName() + "-post-uninstall";
-        removeFullPath(file.c_str());
-    }
-
-    return 0;
+    return removeFullPath(SCRIPT_MARKER_DIR);
 }
 
 /* Utility functions */
@@ -560,6 +595,16 @@ int PkgTest::copyPkgs() {
         }
     }   
 
+    // The script tests run the scripts of a package of their own
+    std::string srcScriptPkgPath = execDir + "/" + TEST_PKG_DIR + TEST_SCRIPT_PKG_NAME + ".tar";
+    std::string dstScriptPkgPath = PKG_DIR TEST_SCRIPT_PKG_NAME ".tar";
+    std::filesystem::remove(dstScriptPkgPath);
+
+    if(!std::filesystem::copy_file(srcScriptPkgPath,dstScriptPkgPath)) {
+        fprintf(stderr,"Error: Could not copy the test package %s to %s while preparing for tstPkg...\n",srcScriptPkgPath.c_str(),dstScriptPkgPath.c_str());
+        return -1;
+    }
+
     return 0;
 }
 
@@ -21,6 +21,31 @@
 #include <cppunit/TestResultCollector.h>
 
 #include "Pkg.h"
+#include "tstExtract.h"
+#include "tstPipeline.h"
+#include "tstManifest.h"
+#include "tstDatabase.h"
+#include "tstOwners.h"
+#include "tstSearch.h"
+#include "tstExclusions.h"
+#include "tstQuarantine.h"
+#include "tstStage.h"
+#include "tstStore.h"
+#include "tstFanOut.h"
+#include "tstPkgIndex.h"
+#include "tstPkgExtract.h"
+#include "tstMemberCache.h"
+#include "tstPkgBuild.h"
+#include "tstPkgMeta.h"
+#include "tstPrefetch.h"
+#include "tstRemove.h"
+#include "tstUtils.h"
+#include "tstScript.h"
+#include "tstWriterPool.h"
+#include "tstDirCache.h"
+#include "tstDecompress.h"
+#include "tstArchiveInput.h"
+#include "tstDurability.h"
 
 #define TEST_TAR_COUNT 5
 #define VERBOSITY 4
@@ -32,6 +57,10 @@
 #define FAKEROOT "test-env/sysroot/"
 #define TEST_PKG_DIR "testPkgs/"
 
+// The package whose scripts the script tests run. Each of its scripts writes the name of its phase into a file of that name in SCRIPT_MARKER_DIR
+#define TEST_SCRIPT_PKG_NAME "testScripts"
+#define SCRIPT_MARKER_DIR "/tmp/" TEST_SCRIPT_PKG_NAME "/"
+
 class PkgTest : public CppUnit::TestFixture {
     private:
         std::vector<Pkg*> pkgVector;
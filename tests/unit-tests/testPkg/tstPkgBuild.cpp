@@ -0,0 +1,220 @@
+#include "tstPkgBuild.h"
+
+CppUnit::Test* PkgBuildTest::suite() {
+    CppUnit::TestSuite* suite = new CppUnit::TestSuite( "PkgBuildTest" );
+
+    suite->addTest( new CppUnit::TestCaller<PkgBuildTest>( "testMemberOrder", &PkgBuildTest::testMemberOrder ));
+    suite->addTest( new CppUnit::TestCaller<PkgBuildTest>( "testRebuildIsIdentical", &PkgBuildTest::testRebuildIsIdentical ));
+    suite->addTest( new CppUnit::TestCaller<PkgBuildTest>( "testHardLinksStoredOnce", &PkgBuildTest::testHardLinksStoredOnce ));
+    suite->addTest( new CppUnit::TestCaller<PkgBuildTest>( "testSparseFileStoredWithoutHoles", &PkgBuildTest::testSparseFileStoredWithoutHoles ));
+    suite->addTest( new CppUnit::TestCaller<PkgBuildTest>( "testBuiltPkgIsIndexed", &PkgBuildTest::testBuiltPkgIsIndexed ));
+    suite->addTest( new CppUnit::TestCaller<PkgBuildTest>( "testBuiltPkgInstalls", &PkgBuildTest::testBuiltPkgInstalls ));
+    suite->addTest( new CppUnit::TestCaller<PkgBuildTest>( "testZstdPkg", &PkgBuildTest::testZstdPkg ));
+    suite->addTest( new CppUnit::TestCaller<PkgBuildTest>( "testBadDirectoriesAreRefused", &PkgBuildTest::testBadDirectoriesAreRefused ));
+    suite->addTest( new CppUnit::TestCaller<PkgBuildTest>( "testFailedBuildKeepsOldPkg", &PkgBuildTest::testFailedBuildKeepsOldPkg ));
+
+    return suite;
+}
+
+void PkgBuildTest::setUp() {
+    CPPUNIT_ASSERT(makeTestDirs({ PKG_BUILD_BASE_DIR, PKG_BUILD_SRC_DIR, PKG_BUILD_PKG_DIR, PKG_BUILD_INSTALLED_DIR, PKG_BUILD_ROOT }));
+    makeSrcTree();
+}
+
+void PkgBuildTest::tearDown() {
+    removeTestDir(PKG_BUILD_BASE_DIR);
+}
+
+// A script, nested directories, files in each of them, a symlink, a file with two paths, and a file which is mostly a hole
+void PkgBuildTest::makeSrcTree() {
+    CPPUNIT_ASSERT(writeTestFile(PKG_BUILD_SRC_DIR POST_INSTALL_NAME, "#!/bin/sh\nexit 0\n"));
+    CPPUNIT_ASSERT(chmod(PKG_BUILD_SRC_DIR POST_INSTALL_NAME, 0755) == 0);
+
+    CPPUNIT_ASSERT(writeTestFile(PKG_BUILD_SRC_DIR "top", "top\n"));
+    CPPUNIT_ASSERT(writeTestFile(PKG_BUILD_SRC_DIR "b/one", "one\n"));
+    CPPUNIT_ASSERT(writeTestFile(PKG_BUILD_SRC_DIR "a/two", "two\n"));
+    CPPUNIT_ASSERT(writeTestFile(PKG_BUILD_SRC_DIR "a/z/three", "three\n"));
+    CPPUNIT_ASSERT(link(PKG_BUILD_SRC_DIR "b/one", PKG_BUILD_SRC_DIR "a/hard") == 0);
+    CPPUNIT_ASSERT(symlink("two", PKG_BUILD_SRC_DIR "a/sym") == 0);
+
+    int fd = open(PKG_BUILD_SRC_DIR "sparse", O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    CPPUNIT_ASSERT(fd >= 0);
+    CPPUNIT_ASSERT(ftruncate(fd, PKG_BUILD_SPARSE_SIZE) == 0);
+    CPPUNIT_ASSERT(pwrite(fd, "data", 4, PKG_BUILD_SPARSE_SIZE / 2) == 4);
+    close(fd);
+}
+
+std::vector<tarMember_s> PkgBuildTest::readBuiltMembers(const std::string& tarPath) {
+    std::vector<tarMember_s> members;
+    int fd = open(tarPath.c_str(), O_RDONLY | O_CLOEXEC);
+    CPPUNIT_ASSERT(fd >= 0);
+    CPPUNIT_ASSERT(readTarMembers(fd, members, 0) == 0);
+    close(fd);
+    return members;
+}
+
+// Installs a built package the way the frontend does, leaving its scripts, metadata and index out of the root
+int PkgBuildTest::installBuiltPkg(const std::string& pkgPath) {
+    std::set<std::string> exclusions;
+    addScriptsToExclusions(exclusions);
+
+    Pkg pkg(pkgPath, 0);
+    return pkg.installPkg(PKG_BUILD_ROOT, PKG_BUILD_INSTALLED_DIR, 0, ExclusionMatcher(exclusions), DEFAULT_SMART_OP, 1);
+}
+
+// The metadata, then the scripts, then every directory, then the files by the directory they're in, then the hard links, then the index
+void PkgBuildTest::testMemberOrder() {
+    CPPUNIT_ASSERT(buildPkg(PKG_BUILD_SRC_DIR, PKG_BUILD_PKG_DIR, false, 0) == 0);
+
+    std::vector<std::string> expected = { PKG_META_NAME, POST_INSTALL_NAME, "a", "a/z", "b", "sparse", "top", "a/hard", "a/sym", "a/two", "a/z/three", "b/one", PKG_INDEX_NAME };
+    CPPUNIT_ASSERT(listTarPaths(PKG_BUILD_PKG_DIR PKG_BUILD_NAME ".tar") == expected);
+}
+
+// Owners, access times and subsecond mtimes don't make it into the package, so building again gives the same bytes
+void PkgBuildTest::testRebuildIsIdentical() {
+    std::string pkgPath = PKG_BUILD_PKG_DIR PKG_BUILD_NAME ".tar";
+    CPPUNIT_ASSERT(buildPkg(PKG_BUILD_SRC_DIR, PKG_BUILD_PKG_DIR, false, 0) == 0);
+    std::string first = readTestFile(pkgPath);
+
+    struct stat st;
+    CPPUNIT_ASSERT(stat(PKG_BUILD_SRC_DIR "top", &st) == 0);
+    struct timespec times[2] = { { st.st_mtim.tv_sec + 100, 0 }, { st.st_mtim.tv_sec, 123456789 } };
+    CPPUNIT_ASSERT(utimensat(AT_FDCWD, PKG_BUILD_SRC_DIR "top", times, 0) == 0);
+    CPPUNIT_ASSERT(chown(PKG_BUILD_SRC_DIR "a/two", 1000, 1000) == 0);
+
+    CPPUNIT_ASSERT(buildPkg(PKG_BUILD_SRC_DIR, PKG_BUILD_PKG_DIR, false, 0) == 0);
+    CPPUNIT_ASSERT(readTestFile(pkgPath) == first);
+}
+
+// A file with two paths has its data stored under the first of them, and the other is a hard link to it
+void PkgBuildTest::testHardLinksStoredOnce() {
+    CPPUNIT_ASSERT(buildPkg(PKG_BUILD_SRC_DIR, PKG_BUILD_PKG_DIR, false, 0) == 0);
+
+    int found = 0;
+    for(const tarMember_s& m : readBuiltMembers(PKG_BUILD_PKG_DIR PKG_BUILD_NAME ".tar")) {
+        if(m.path == "a/hard") {
+            CPPUNIT_ASSERT(m.type == TAR_TYPE_REGULAR);
+            CPPUNIT_ASSERT(m.size == 4);
+            found++;
+        }
+
+        else if(m.path == "b/one") {
+            CPPUNIT_ASSERT(m.type == TAR_TYPE_HARDLINK);
+            CPPUNIT_ASSERT(m.linkTarget == "a/hard");
+            CPPUNIT_ASSERT(m.size == 0);
+            found++;
+        }
+    }
+
+    CPPUNIT_ASSERT(found == 2);
+}
+
+// A sparse file is stored with a map of where its data is, so its hole takes no room in the package
+void PkgBuildTest::testSparseFileStoredWithoutHoles() {
+    CPPUNIT_ASSERT(buildPkg(PKG_BUILD_SRC_DIR, PKG_BUILD_PKG_DIR, false, 0) == 0);
+
+    bool found = false;
+    for(const tarMember_s& m : readBuiltMembers(PKG_BUILD_PKG_DIR PKG_BUILD_NAME ".tar")) {
+        if(m.path == "sparse") {
+            CPPUNIT_ASSERT(m.needsFallback);
+            CPPUNIT_ASSERT(m.size < PKG_BUILD_SPARSE_SIZE);
+            found = true;
+        }
+    }
+
+    CPPUNIT_ASSERT(found);
+    CPPUNIT_ASSERT(std::filesystem::file_size(PKG_BUILD_PKG_DIR PKG_BUILD_NAME ".tar") < PKG_BUILD_SPARSE_SIZE);
+}
+
+// Every built package ends in an index, which lists the same members as walking its headers
+void PkgBuildTest::testBuiltPkgIsIndexed() {
+    CPPUNIT_ASSERT(buildPkg(PKG_BUILD_SRC_DIR, PKG_BUILD_PKG_DIR, false, 0) == 0);
+
+    std::string pkgPath = PKG_BUILD_PKG_DIR PKG_BUILD_NAME ".tar";
+    std::vector<tarMember_s> indexed;
+    int fd = open(pkgPath.c_str(), O_RDONLY | O_CLOEXEC);
+    CPPUNIT_ASSERT(fd >= 0);
+    CPPUNIT_ASSERT(readPkgIndex(fd, indexed, 0) == 0);
+    close(fd);
+
+    std::vector<tarMember_s> walked = readBuiltMembers(pkgPath);
+    CPPUNIT_ASSERT(!walked.empty() && walked.back().path == PKG_INDEX_NAME);
+    walked.pop_back();
+
+    CPPUNIT_ASSERT(indexed.size() == walked.size());
+    for(size_t index = 0; index < walked.size(); index++) {
+        CPPUNIT_ASSERT(indexed[index].path == walked[index].path);
+        CPPUNIT_ASSERT(indexed[index].dataOffset == walked[index].dataOffset);
+    }
+}
+
+// Installing a built package gives back the directory it was built from, less its scripts
+void PkgBuildTest::testBuiltPkgInstalls() {
+    CPPUNIT_ASSERT(buildPkg(PKG_BUILD_SRC_DIR, PKG_BUILD_PKG_DIR, false, 0) == 0);
+    CPPUNIT_ASSERT(installBuiltPkg(PKG_BUILD_PKG_DIR PKG_BUILD_NAME ".tar") == ARCHIVE_EOF);
+
+    std::vector<std::string> expected = listTestTree(PKG_BUILD_SRC_DIR);
+    expected.erase(std::find(expected.begin(), expected.end(), POST_INSTALL_NAME));
+    CPPUNIT_ASSERT(listTestTree(PKG_BUILD_ROOT) == expected);
+
+    for(const char* path : { "top", "a/two", "a/z/three", "b/one", "a/hard", "sparse" }) {
+        CPPUNIT_ASSERT(readTestFile(std::string(PKG_BUILD_ROOT) + path) == readTestFile(std::string(PKG_BUILD_SRC_DIR) + path));
+    }
+
+    struct stat hard, one;
+    CPPUNIT_ASSERT(stat(PKG_BUILD_ROOT "a/hard", &hard) == 0 && stat(PKG_BUILD_ROOT "b/one", &one) == 0);
+    CPPUNIT_ASSERT(hard.st_ino == one.st_ino);
+    CPPUNIT_ASSERT(std::filesystem::read_symlink(PKG_BUILD_ROOT "a/sym") == "two");
+}
+
+// A zstd package holds the same tarball, ends in the seek table, and installs the same. Without libzstd it's refused, and nothing is written
+void PkgBuildTest::testZstdPkg() {
+    std::string zstPath = PKG_BUILD_PKG_DIR PKG_BUILD_NAME ".tar.zst";
+
+#ifdef WITH_ZSTD
+    CPPUNIT_ASSERT(buildPkg(PKG_BUILD_SRC_DIR, PKG_BUILD_PKG_DIR, false, 0) == 0);
+    std::vector<std::string> plainPaths = listTarPaths(PKG_BUILD_PKG_DIR PKG_BUILD_NAME ".tar");
+    std::filesystem::remove(PKG_BUILD_PKG_DIR PKG_BUILD_NAME ".tar");
+
+    CPPUNIT_ASSERT(buildPkg(PKG_BUILD_SRC_DIR, PKG_BUILD_PKG_DIR, true, 0) == 0);
+    CPPUNIT_ASSERT(listTestTree(PKG_BUILD_PKG_DIR) == std::vector<std::string>{ PKG_BUILD_NAME ".tar.zst" });
+    CPPUNIT_ASSERT(listTarPaths(zstPath) == plainPaths);
+
+    std::string data = readTestFile(zstPath);
+    CPPUNIT_ASSERT(data.size() > 4);
+    uint32_t magic = (unsigned char)data[data.size() - 4] | ((unsigned char)data[data.size() - 3] << 8) | ((unsigned char)data[data.size() - 2] << 16) | ((uint32_t)(unsigned char)data[data.size() - 1] << 24);
+    CPPUNIT_ASSERT(magic == PKG_BUILD_SEEKABLE_MAGIC);
+
+    CPPUNIT_ASSERT(installBuiltPkg(zstPath) == ARCHIVE_EOF);
+    CPPUNIT_ASSERT(readTestFile(PKG_BUILD_ROOT "sparse") == readTestFile(PKG_BUILD_SRC_DIR "sparse"));
+    CPPUNIT_ASSERT(readTestFile(PKG_BUILD_ROOT "a/z/three") == "three\n");
+#else
+    CPPUNIT_ASSERT(buildPkg(PKG_BUILD_SRC_DIR, PKG_BUILD_PKG_DIR, true, 0) == PKG_BUILD_NO_ZSTD);
+    CPPUNIT_ASSERT(listTestTree(PKG_BUILD_PKG_DIR).empty());
+#endif /* WITH_ZSTD */
+}
+
+// A package is only built from a directory, and never into it
+void PkgBuildTest::testBadDirectoriesAreRefused() {
+    CPPUNIT_ASSERT(buildPkg(PKG_BUILD_SRC_DIR "top", PKG_BUILD_PKG_DIR, false, 0) == PKG_BUILD_NOT_A_DIRECTORY);
+    CPPUNIT_ASSERT(buildPkg(PKG_BUILD_BASE_DIR "missing", PKG_BUILD_PKG_DIR, false, 0) == PKG_BUILD_NOT_A_DIRECTORY);
+    CPPUNIT_ASSERT(buildPkg(PKG_BUILD_SRC_DIR, PKG_BUILD_SRC_DIR "out", false, 0) == PKG_BUILD_NOT_A_DIRECTORY);
+    CPPUNIT_ASSERT(buildPkg(PKG_BUILD_SRC_DIR, PKG_BUILD_SRC_DIR, false, 0) == PKG_BUILD_NOT_A_DIRECTORY);
+
+    CPPUNIT_ASSERT(listTestTree(PKG_BUILD_PKG_DIR).empty());
+    CPPUNIT_ASSERT(!std::filesystem::exists(PKG_BUILD_SRC_DIR "out"));
+}
+
+// A build which fails leaves the package already there as it was, and no half-written one next to it
+void PkgBuildTest::testFailedBuildKeepsOldPkg() {
+    std::string pkgPath = PKG_BUILD_PKG_DIR PKG_BUILD_NAME ".tar";
+    CPPUNIT_ASSERT(buildPkg(PKG_BUILD_SRC_DIR, PKG_BUILD_PKG_DIR, false, 0) == 0);
+    std::string old = readTestFile(pkgPath);
+
+    CPPUNIT_ASSERT(writeTestFile(PKG_BUILD_SRC_DIR "new", "new\n"));
+    CPPUNIT_ASSERT(writeTestFile(PKG_BUILD_SRC_DIR PKG_META_NAME, "installedSize=lots\n"));
+
+    CPPUNIT_ASSERT(buildPkg(PKG_BUILD_SRC_DIR, PKG_BUILD_PKG_DIR, false, 0) == PKG_BUILD_READ_ERROR);
+    CPPUNIT_ASSERT(readTestFile(pkgPath) == old);
+    CPPUNIT_ASSERT(listTestTree(PKG_BUILD_PKG_DIR) == std::vector<std::string>{ PKG_BUILD_NAME ".tar" });
+}
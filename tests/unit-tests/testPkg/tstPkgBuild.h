@@ -0,0 +1,56 @@
+#ifndef _THE2B_TST_PKG_BUILD_H
+#define _THE2B_TST_PKG_BUILD_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <filesystem>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestResultCollector.h>
+
+#include "Pkg.h"
+#include "PkgBuild.h"
+#include "PkgIndex.h"
+#include "tstUtils.h"
+
+#define PKG_BUILD_BASE_DIR "test-env-pkg-build/"
+#define PKG_BUILD_SRC_DIR "test-env-pkg-build/src/demo/"
+#define PKG_BUILD_PKG_DIR "test-env-pkg-build/pkgs/"
+#define PKG_BUILD_INSTALLED_DIR "test-env-pkg-build/installed/"
+#define PKG_BUILD_ROOT "test-env-pkg-build/sysroot/"
+
+// The package built out of PKG_BUILD_SRC_DIR
+#define PKG_BUILD_NAME "demo"
+#define PKG_BUILD_SPARSE_SIZE (1 << 20)
+
+// Builds packages out of a directory, and checks the order of their members, and that they install back to that directory
+class PkgBuildTest : public CppUnit::TestFixture {
+    public:
+        void setUp();
+        void tearDown();
+
+        void testMemberOrder();
+        void testRebuildIsIdentical();
+        void testHardLinksStoredOnce();
+        void testSparseFileStoredWithoutHoles();
+        void testBuiltPkgIsIndexed();
+        void testBuiltPkgInstalls();
+        void testZstdPkg();
+        void testBadDirectoriesAreRefused();
+        void testFailedBuildKeepsOldPkg();
+
+        static CppUnit::Test* suite();
+
+        void makeSrcTree();
+        std::vector<tarMember_s> readBuiltMembers(const std::string& tarPath);
+        int installBuiltPkg(const std::string& pkgPath);
+};
+
+#endif /* _THE2B_TST_PKG_BUILD_H */
@@ -0,0 +1,161 @@
+#include "tstPkgExtract.h"
+
+CppUnit::Test* PkgExtractTest::suite() {
+    CppUnit::TestSuite* suite = new CppUnit::TestSuite( "PkgExtractTest" );
+
+    suite->addTest( new CppUnit::TestCaller<PkgExtractTest>( "testCatInRequestedOrder", &PkgExtractTest::testCatInRequestedOrder ));
+    suite->addTest( new CppUnit::TestCaller<PkgExtractTest>( "testCatLaterMemberWins", &PkgExtractTest::testCatLaterMemberWins ));
+    suite->addTest( new CppUnit::TestCaller<PkgExtractTest>( "testCatHardLink", &PkgExtractTest::testCatHardLink ));
+    suite->addTest( new CppUnit::TestCaller<PkgExtractTest>( "testCatNotRegular", &PkgExtractTest::testCatNotRegular ));
+    suite->addTest( new CppUnit::TestCaller<PkgExtractTest>( "testMissingMember", &PkgExtractTest::testMissingMember ));
+    suite->addTest( new CppUnit::TestCaller<PkgExtractTest>( "testExtractDirectory", &PkgExtractTest::testExtractDirectory ));
+    suite->addTest( new CppUnit::TestCaller<PkgExtractTest>( "testExtractHardLinkWithoutTarget", &PkgExtractTest::testExtractHardLinkWithoutTarget ));
+    suite->addTest( new CppUnit::TestCaller<PkgExtractTest>( "testExtractWholePkg", &PkgExtractTest::testExtractWholePkg ));
+    suite->addTest( new CppUnit::TestCaller<PkgExtractTest>( "testIndexIsNeverExtracted", &PkgExtractTest::testIndexIsNeverExtracted ));
+
+    return suite;
+}
+
+void PkgExtractTest::setUp() {
+    CPPUNIT_ASSERT(makeTestDirs({ PKG_EXTRACT_BASE_DIR, PKG_EXTRACT_PKG_DIR, PKG_EXTRACT_INSTALLED_DIR, PKG_EXTRACT_ROOT }));
+}
+
+void PkgExtractTest::tearDown() {
+    removeTestDir(PKG_EXTRACT_BASE_DIR);
+}
+
+// The same package, as an uncompressed tarball which is read at random, and a gzipped one which is decoded
+std::vector<std::string> PkgExtractTest::writeTestPkgs() {
+    std::vector<testMember_s> members = {
+        { "pkg/", TAR_TYPE_DIRECTORY },
+        { "pkg/a", TAR_TYPE_REGULAR, "alpha\n" },
+        { "pkg/b", TAR_TYPE_REGULAR, "beta\n" },
+        { "pkg/dup", TAR_TYPE_REGULAR, "first\n" },
+        { "pkg/sub/", TAR_TYPE_DIRECTORY },
+        { "pkg/sub/c", TAR_TYPE_REGULAR, "gamma\n" },
+        { "pkg/link", TAR_TYPE_SYMLINK, "", "a" },
+        { "pkg/hard", TAR_TYPE_HARDLINK, "", "pkg/a" },
+        { "pkg/dup", TAR_TYPE_REGULAR, "second\n" },
+    };
+
+    std::vector<std::string> tarPaths = { PKG_EXTRACT_PKG_DIR "pkg.tar", PKG_EXTRACT_PKG_DIR "pkg.tar.gz" };
+    CPPUNIT_ASSERT(writeTestTar(tarPaths[0], members));
+    CPPUNIT_ASSERT(writeTestTar(tarPaths[1], members, ARCHIVE_FORMAT_TAR_PAX_RESTRICTED, "gzip"));
+    return tarPaths;
+}
+
+// What writing members to standard output prints
+std::string PkgExtractTest::catMembers(const std::string& tarPath, const std::vector<std::string>& paths, int& res) {
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int fd = open(PKG_EXTRACT_STDOUT, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    CPPUNIT_ASSERT(saved >= 0 && fd >= 0);
+    CPPUNIT_ASSERT(dup2(fd, STDOUT_FILENO) == STDOUT_FILENO);
+    close(fd);
+
+    res = extractPkgMembers(tarPath, paths, "", 0);
+
+    fflush(stdout);
+    CPPUNIT_ASSERT(dup2(saved, STDOUT_FILENO) == STDOUT_FILENO);
+    close(saved);
+    return readTestFile(PKG_EXTRACT_STDOUT);
+}
+
+// Files come out one after the other, in the order they were asked for
+void PkgExtractTest::testCatInRequestedOrder() {
+    for(const std::string& tarPath : writeTestPkgs()) {
+        int res;
+        CPPUNIT_ASSERT(catMembers(tarPath, { "pkg/b", "./pkg/a", "pkg/sub/c" }, res) == "beta\nalpha\ngamma\n");
+        CPPUNIT_ASSERT(res == 0);
+    }
+}
+
+// A path the package holds twice gives the later member, as installing it would
+void PkgExtractTest::testCatLaterMemberWins() {
+    for(const std::string& tarPath : writeTestPkgs()) {
+        int res;
+        CPPUNIT_ASSERT(catMembers(tarPath, { "pkg/dup" }, res) == "second\n");
+        CPPUNIT_ASSERT(res == 0);
+    }
+}
+
+// A hard link gives the data of its target
+void PkgExtractTest::testCatHardLink() {
+    for(const std::string& tarPath : writeTestPkgs()) {
+        int res;
+        CPPUNIT_ASSERT(catMembers(tarPath, { "pkg/hard" }, res) == "alpha\n");
+        CPPUNIT_ASSERT(res == 0);
+    }
+}
+
+// Directories and symbolic links have no data to print, and the files around them still come out
+void PkgExtractTest::testCatNotRegular() {
+    for(const std::string& tarPath : writeTestPkgs()) {
+        int res;
+        CPPUNIT_ASSERT(catMembers(tarPath, { "pkg/a", "pkg/link" }, res) == "alpha\n");
+        CPPUNIT_ASSERT(res == PKG_EXTRACT_NOT_REGULAR);
+
+        CPPUNIT_ASSERT(catMembers(tarPath, { "pkg/sub", "pkg/b" }, res) == "beta\n");
+        CPPUNIT_ASSERT(res == PKG_EXTRACT_NOT_REGULAR);
+    }
+}
+
+// A path the package doesn't hold fails, whether printing or extracting, and everything else is still written out
+void PkgExtractTest::testMissingMember() {
+    for(const std::string& tarPath : writeTestPkgs()) {
+        int res;
+        CPPUNIT_ASSERT(catMembers(tarPath, { "pkg/nope", "pkg/a" }, res) == "alpha\n");
+        CPPUNIT_ASSERT(res == PKG_EXTRACT_NOT_FOUND);
+
+        CPPUNIT_ASSERT(makeTestDir(PKG_EXTRACT_OUTPUT_DIR));
+        CPPUNIT_ASSERT(extractPkgMembers(tarPath, { "pkg/nope", "pkg/b" }, PKG_EXTRACT_OUTPUT_DIR, 0) == PKG_EXTRACT_NOT_FOUND);
+        CPPUNIT_ASSERT(readTestFile(PKG_EXTRACT_OUTPUT_DIR "pkg/b") == "beta\n");
+    }
+}
+
+// Asking for a directory extracts everything below it, and nothing else
+void PkgExtractTest::testExtractDirectory() {
+    for(const std::string& tarPath : writeTestPkgs()) {
+        CPPUNIT_ASSERT(makeTestDir(PKG_EXTRACT_OUTPUT_DIR));
+        CPPUNIT_ASSERT(extractPkgMembers(tarPath, { "pkg/sub" }, PKG_EXTRACT_OUTPUT_DIR, 0) == 0);
+
+        std::vector<std::string> expected = { "pkg", "pkg/sub", "pkg/sub/c" };
+        CPPUNIT_ASSERT(listTestTree(PKG_EXTRACT_OUTPUT_DIR) == expected);
+        CPPUNIT_ASSERT(readTestFile(PKG_EXTRACT_OUTPUT_DIR "pkg/sub/c") == "gamma\n");
+    }
+}
+
+// A hard link whose target wasn't asked for is extracted as a copy of it
+void PkgExtractTest::testExtractHardLinkWithoutTarget() {
+    for(const std::string& tarPath : writeTestPkgs()) {
+        CPPUNIT_ASSERT(makeTestDir(PKG_EXTRACT_OUTPUT_DIR));
+        CPPUNIT_ASSERT(extractPkgMembers(tarPath, { "pkg/hard" }, PKG_EXTRACT_OUTPUT_DIR, 0) == 0);
+
+        CPPUNIT_ASSERT(readTestFile(PKG_EXTRACT_OUTPUT_DIR "pkg/hard") == "alpha\n");
+        CPPUNIT_ASSERT(!std::filesystem::exists(PKG_EXTRACT_OUTPUT_DIR "pkg/a"));
+    }
+}
+
+// Asking for the package's root extracts the same tree installing it would
+void PkgExtractTest::testExtractWholePkg() {
+    Pkg pkg(testPkgPath(), 0);
+    CPPUNIT_ASSERT(pkg.installPkg(PKG_EXTRACT_ROOT, PKG_EXTRACT_INSTALLED_DIR, 0, ExclusionMatcher(), DEFAULT_SMART_OP, 1) == ARCHIVE_EOF);
+
+    CPPUNIT_ASSERT(extractPkgMembers(testPkgPath(), { "." }, PKG_EXTRACT_OUTPUT_DIR, 0) == 0);
+    CPPUNIT_ASSERT(listTestTree(PKG_EXTRACT_OUTPUT_DIR) == listTestTree(PKG_EXTRACT_ROOT));
+    CPPUNIT_ASSERT(readTestFile(PKG_EXTRACT_OUTPUT_DIR TEST_PKG_FILE) == readTestFile(PKG_EXTRACT_ROOT TEST_PKG_FILE));
+}
+
+// The index of a seekable package is only there to find the other members, and is never written out
+void PkgExtractTest::testIndexIsNeverExtracted() {
+    std::string tarPath = writeTestPkgs()[0];
+    CPPUNIT_ASSERT(writePkgIndex(tarPath, 0) == 0);
+
+    int res;
+    CPPUNIT_ASSERT(catMembers(tarPath, { PKG_INDEX_NAME }, res).empty());
+    CPPUNIT_ASSERT(res == PKG_EXTRACT_NOT_FOUND);
+
+    CPPUNIT_ASSERT(extractPkgMembers(tarPath, { "." }, PKG_EXTRACT_OUTPUT_DIR, 0) == 0);
+    CPPUNIT_ASSERT(!std::filesystem::exists(PKG_EXTRACT_OUTPUT_DIR PKG_INDEX_NAME));
+    CPPUNIT_ASSERT(readTestFile(PKG_EXTRACT_OUTPUT_DIR "pkg/dup") == "second\n");
+}
@@ -0,0 +1,52 @@
+#ifndef _THE2B_TST_PKG_EXTRACT_H
+#define _THE2B_TST_PKG_EXTRACT_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <filesystem>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestResultCollector.h>
+
+#include "Pkg.h"
+#include "PkgExtract.h"
+#include "tstUtils.h"
+
+#define PKG_EXTRACT_BASE_DIR "test-env-pkg-extract/"
+#define PKG_EXTRACT_PKG_DIR "test-env-pkg-extract/pkgs/"
+#define PKG_EXTRACT_INSTALLED_DIR "test-env-pkg-extract/installed/"
+#define PKG_EXTRACT_ROOT "test-env-pkg-extract/sysroot/"
+#define PKG_EXTRACT_OUTPUT_DIR "test-env-pkg-extract/output/"
+#define PKG_EXTRACT_STDOUT "test-env-pkg-extract/stdout"
+
+// Pulls members out of packages without installing them, and checks seekable and compressed packages give the same results
+class PkgExtractTest : public CppUnit::TestFixture {
+    public:
+        void setUp();
+        void tearDown();
+
+        void testCatInRequestedOrder();
+        void testCatLaterMemberWins();
+        void testCatHardLink();
+        void testCatNotRegular();
+        void testMissingMember();
+        void testExtractDirectory();
+        void testExtractHardLinkWithoutTarget();
+        void testExtractWholePkg();
+        void testIndexIsNeverExtracted();
+
+        static CppUnit::Test* suite();
+
+        std::vector<std::string> writeTestPkgs();
+        std::string catMembers(const std::string& tarPath, const std::vector<std::string>& paths, int& res);
+};
+
+#endif /* _THE2B_TST_PKG_EXTRACT_H */
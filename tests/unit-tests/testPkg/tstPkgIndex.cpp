@@ -0,0 +1,243 @@
+#include "tstPkgIndex.h"
+
+CppUnit::Test* PkgIndexTest::suite() {
+    CppUnit::TestSuite* suite = new CppUnit::TestSuite( "PkgIndexTest" );
+
+    suite->addTest( new CppUnit::TestCaller<PkgIndexTest>( "testSerializeRoundTrip", &PkgIndexTest::testSerializeRoundTrip ));
+    suite->addTest( new CppUnit::TestCaller<PkgIndexTest>( "testParseRejectsDamage", &PkgIndexTest::testParseRejectsDamage ));
+    suite->addTest( new CppUnit::TestCaller<PkgIndexTest>( "testWriteAndReadIndex", &PkgIndexTest::testWriteAndReadIndex ));
+    suite->addTest( new CppUnit::TestCaller<PkgIndexTest>( "testIndexedPkgStillReadable", &PkgIndexTest::testIndexedPkgStillReadable ));
+    suite->addTest( new CppUnit::TestCaller<PkgIndexTest>( "testIndexedPkgInstalls", &PkgIndexTest::testIndexedPkgInstalls ));
+    suite->addTest( new CppUnit::TestCaller<PkgIndexTest>( "testReindexReplacesIndex", &PkgIndexTest::testReindexReplacesIndex ));
+    suite->addTest( new CppUnit::TestCaller<PkgIndexTest>( "testAppendedMemberIgnoresIndex", &PkgIndexTest::testAppendedMemberIgnoresIndex ));
+    suite->addTest( new CppUnit::TestCaller<PkgIndexTest>( "testDamagedIndexIsNotUsed", &PkgIndexTest::testDamagedIndexIsNotUsed ));
+    suite->addTest( new CppUnit::TestCaller<PkgIndexTest>( "testCompressedPkgIsUnsupported", &PkgIndexTest::testCompressedPkgIsUnsupported ));
+
+    return suite;
+}
+
+void PkgIndexTest::setUp() {
+    CPPUNIT_ASSERT(makeTestDirs({ PKG_INDEX_BASE_DIR, PKG_INDEX_PKG_DIR, PKG_INDEX_INSTALLED_DIR, PKG_INDEX_ROOT, PKG_INDEX_PLAIN_ROOT }));
+}
+
+void PkgIndexTest::tearDown() {
+    removeTestDir(PKG_INDEX_BASE_DIR);
+}
+
+// The members of a tarball, as found by walking its headers
+std::vector<tarMember_s> PkgIndexTest::walkMembers(const std::string& tarPath) {
+    std::vector<tarMember_s> members;
+    int fd = open(tarPath.c_str(), O_RDONLY | O_CLOEXEC);
+    CPPUNIT_ASSERT(fd >= 0);
+    CPPUNIT_ASSERT(readTarMembers(fd, members, 0) == 0);
+    close(fd);
+    return members;
+}
+
+int PkgIndexTest::readIndex(const std::string& tarPath, std::vector<tarMember_s>& members) {
+    int fd = open(tarPath.c_str(), O_RDONLY | O_CLOEXEC);
+    CPPUNIT_ASSERT(fd >= 0);
+    int res = readPkgIndex(fd, members, 0);
+    close(fd);
+    return res;
+}
+
+// Every field of every member survives serializing and parsing
+void PkgIndexTest::testSerializeRoundTrip() {
+    std::vector<tarMember_s> members(3);
+    members[0].path = "usr/lib/";
+    members[0].type = TAR_TYPE_DIRECTORY;
+    members[0].mode = 0755;
+    members[0].headerOffset = 0;
+    members[0].dataOffset = 512;
+
+    members[1].path = "usr/lib/libz.so.1.2.13";
+    members[1].mode = 0644;
+    members[1].uid = 1000;
+    members[1].gid = 100;
+    members[1].size = 100000;
+    members[1].mtime = 1500000000;
+    members[1].headerOffset = 512;
+    members[1].dataOffset = 1024;
+    members[1].hash = sha256("contents", 8);
+
+    members[2].path = "usr/lib/libz.so";
+    members[2].linkTarget = "libz.so.1.2.13";
+    members[2].type = TAR_TYPE_SYMLINK;
+    members[2].mode = 0777;
+    members[2].needsFallback = true;
+    members[2].headerOffset = 101376;
+    members[2].dataOffset = 101888;
+
+    std::vector<tarMember_s> parsed;
+    CPPUNIT_ASSERT(parsePkgIndex(serializePkgIndex(members), 200000, parsed));
+    CPPUNIT_ASSERT(parsed.size() == members.size());
+
+    for(size_t index = 0; index < members.size(); index++) {
+        CPPUNIT_ASSERT(parsed[index].path == members[index].path);
+        CPPUNIT_ASSERT(parsed[index].linkTarget == members[index].linkTarget);
+        CPPUNIT_ASSERT(parsed[index].type == members[index].type);
+        CPPUNIT_ASSERT(parsed[index].mode == members[index].mode);
+        CPPUNIT_ASSERT(parsed[index].uid == members[index].uid);
+        CPPUNIT_ASSERT(parsed[index].gid == members[index].gid);
+        CPPUNIT_ASSERT(parsed[index].size == members[index].size);
+        CPPUNIT_ASSERT(parsed[index].mtime == members[index].mtime);
+        CPPUNIT_ASSERT(parsed[index].headerOffset == members[index].headerOffset);
+        CPPUNIT_ASSERT(parsed[index].dataOffset == members[index].dataOffset);
+        CPPUNIT_ASSERT(parsed[index].needsFallback == members[index].needsFallback);
+        CPPUNIT_ASSERT(parsed[index].hash == members[index].hash);
+    }
+}
+
+// Bad magic, a truncated record, trailing bytes, and data past the index member are all rejected
+void PkgIndexTest::testParseRejectsDamage() {
+    std::vector<tarMember_s> members(1);
+    members[0].path = "hello";
+    members[0].size = 6;
+    members[0].dataOffset = 512;
+
+    std::string buf = serializePkgIndex(members);
+    std::vector<tarMember_s> parsed;
+    CPPUNIT_ASSERT(parsePkgIndex(buf, 1024, parsed));
+
+    std::string badMagic = buf;
+    badMagic[0] = 'X';
+    CPPUNIT_ASSERT(!parsePkgIndex(badMagic, 1024, parsed));
+    CPPUNIT_ASSERT(!parsePkgIndex(buf.substr(0, buf.size() - 1), 1024, parsed));
+    CPPUNIT_ASSERT(!parsePkgIndex(buf + "x", 1024, parsed));
+    CPPUNIT_ASSERT(!parsePkgIndex(buf, 512, parsed));
+}
+
+// An indexed package lists the same members as walking it does, along with the hash of every file
+void PkgIndexTest::testWriteAndReadIndex() {
+    std::string tarPath = copyTestPkg(PKG_INDEX_PKG_DIR);
+    std::vector<tarMember_s> walked = walkMembers(tarPath);
+    CPPUNIT_ASSERT(writePkgIndex(tarPath, 0) == 0);
+
+    std::vector<tarMember_s> indexed;
+    CPPUNIT_ASSERT(readIndex(tarPath, indexed) == 0);
+    CPPUNIT_ASSERT(indexed.size() == walked.size());
+    CPPUNIT_ASSERT(indexed.size() == TEST_PKG_MEMBER_COUNT);
+
+    int fd = open(tarPath.c_str(), O_RDONLY | O_CLOEXEC);
+    CPPUNIT_ASSERT(fd >= 0);
+
+    for(size_t index = 0; index < walked.size(); index++) {
+        CPPUNIT_ASSERT(indexed[index].path == walked[index].path);
+        CPPUNIT_ASSERT(indexed[index].type == walked[index].type);
+        CPPUNIT_ASSERT(indexed[index].mode == walked[index].mode);
+        CPPUNIT_ASSERT(indexed[index].size == walked[index].size);
+        CPPUNIT_ASSERT(indexed[index].headerOffset == walked[index].headerOffset);
+        CPPUNIT_ASSERT(indexed[index].dataOffset == walked[index].dataOffset);
+
+        if(isRegularTarType(walked[index].type)) {
+            std::string data;
+            CPPUNIT_ASSERT(readTarRange(fd, walked[index].dataOffset, walked[index].size, data));
+            CPPUNIT_ASSERT(indexed[index].hash == sha256(data.data(), data.size()));
+        }
+    }
+
+    close(fd);
+}
+
+// Other tar readers still see every member, and the index as one more file at the end
+void PkgIndexTest::testIndexedPkgStillReadable() {
+    std::string tarPath = copyTestPkg(PKG_INDEX_PKG_DIR);
+    std::vector<std::string> before = listTarPaths(tarPath);
+    CPPUNIT_ASSERT(writePkgIndex(tarPath, 0) == 0);
+
+    std::vector<std::string> after = listTarPaths(tarPath);
+    CPPUNIT_ASSERT(after.size() == before.size() + 1);
+    CPPUNIT_ASSERT(after.back() == PKG_INDEX_NAME);
+    after.pop_back();
+    CPPUNIT_ASSERT(after == before);
+}
+
+// An indexed package installs the same tree as the original, without the index
+void PkgIndexTest::testIndexedPkgInstalls() {
+    std::string tarPath = copyTestPkg(PKG_INDEX_PKG_DIR);
+    CPPUNIT_ASSERT(writePkgIndex(tarPath, 0) == 0);
+
+    Pkg plain(testPkgPath(), 0);
+    CPPUNIT_ASSERT(plain.installPkg(PKG_INDEX_PLAIN_ROOT, PKG_INDEX_INSTALLED_DIR, 0, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES)), DEFAULT_SMART_OP, 1) == ARCHIVE_EOF);
+
+    Pkg pkg(tarPath, 0);
+    CPPUNIT_ASSERT(pkg.getPkgMembers(0).size() == TEST_PKG_MEMBER_COUNT);
+    CPPUNIT_ASSERT(pkg.installPkg(PKG_INDEX_ROOT, PKG_INDEX_INSTALLED_DIR, 0, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES)), DEFAULT_SMART_OP, 1) == ARCHIVE_EOF);
+
+    CPPUNIT_ASSERT(!std::filesystem::exists(PKG_INDEX_ROOT PKG_INDEX_NAME));
+    CPPUNIT_ASSERT(listTestTree(PKG_INDEX_ROOT) == listTestTree(PKG_INDEX_PLAIN_ROOT));
+}
+
+// Indexing a package again replaces its index rather than adding a second one
+void PkgIndexTest::testReindexReplacesIndex() {
+    std::string tarPath = copyTestPkg(PKG_INDEX_PKG_DIR);
+    CPPUNIT_ASSERT(writePkgIndex(tarPath, 0) == 0);
+    uintmax_t size = std::filesystem::file_size(tarPath);
+    std::string first = readTestFile(tarPath);
+
+    CPPUNIT_ASSERT(writePkgIndex(tarPath, 0) == 0);
+    CPPUNIT_ASSERT(std::filesystem::file_size(tarPath) == size);
+    CPPUNIT_ASSERT(readTestFile(tarPath) == first);
+
+    std::vector<std::string> paths = listTarPaths(tarPath);
+    CPPUNIT_ASSERT(std::count(paths.begin(), paths.end(), PKG_INDEX_NAME) == 1);
+}
+
+// A member appended after indexing hides the index, and walking the headers finds the new member
+void PkgIndexTest::testAppendedMemberIgnoresIndex() {
+    std::string tarPath = copyTestPkg(PKG_INDEX_PKG_DIR);
+    CPPUNIT_ASSERT(writePkgIndex(tarPath, 0) == 0);
+
+    CPPUNIT_ASSERT(writeTestFile(PKG_INDEX_BASE_DIR "extra", "extra\n"));
+    std::string command = "tar -rf " + tarPath + " -C " PKG_INDEX_BASE_DIR " extra";
+    CPPUNIT_ASSERT(system(command.c_str()) == 0);
+
+    std::vector<tarMember_s> members;
+    CPPUNIT_ASSERT(readIndex(tarPath, members) == PKG_INDEX_ABSENT);
+
+    int fd = open(tarPath.c_str(), O_RDONLY | O_CLOEXEC);
+    CPPUNIT_ASSERT(fd >= 0);
+    CPPUNIT_ASSERT(readPkgMembers(fd, members, 0) == 0);
+    close(fd);
+
+    CPPUNIT_ASSERT(members.size() == TEST_PKG_MEMBER_COUNT + 1);
+    CPPUNIT_ASSERT(members.back().path == "extra");
+    for(const tarMember_s& m : members) {
+        CPPUNIT_ASSERT(!isPkgIndex(m.path));
+    }
+}
+
+// An index whose data no longer matches its hash is rejected, and the headers are walked instead
+void PkgIndexTest::testDamagedIndexIsNotUsed() {
+    std::string tarPath = copyTestPkg(PKG_INDEX_PKG_DIR);
+    CPPUNIT_ASSERT(writePkgIndex(tarPath, 0) == 0);
+
+    std::vector<tarMember_s> walked = walkMembers(tarPath);
+    off_t dataOffset = walked.back().dataOffset;
+    CPPUNIT_ASSERT(isPkgIndex(walked.back().path));
+
+    // The record count, right after the magic and version
+    int fd = open(tarPath.c_str(), O_RDWR | O_CLOEXEC);
+    CPPUNIT_ASSERT(fd >= 0);
+    CPPUNIT_ASSERT(pwrite(fd, "\x01", 1, dataOffset + PKG_INDEX_MAGIC_SIZE + 4) == 1);
+
+    std::vector<tarMember_s> members;
+    CPPUNIT_ASSERT(readPkgIndex(fd, members, 0) == PKG_INDEX_CORRUPT);
+    CPPUNIT_ASSERT(members.empty());
+
+    CPPUNIT_ASSERT(readPkgMembers(fd, members, 0) == 0);
+    CPPUNIT_ASSERT(members.size() == TEST_PKG_MEMBER_COUNT);
+    CPPUNIT_ASSERT(members.front().hash.empty());
+    close(fd);
+}
+
+// Only uncompressed tarballs can be seeked through, so nothing else is indexed
+void PkgIndexTest::testCompressedPkgIsUnsupported() {
+    std::string tarPath = PKG_INDEX_PKG_DIR "small.tar.gz";
+    CPPUNIT_ASSERT(writeTestTar(tarPath, { { "hello", TAR_TYPE_REGULAR, "hello\n" } }, ARCHIVE_FORMAT_TAR_PAX_RESTRICTED, "gzip"));
+    std::string before = readTestFile(tarPath);
+
+    CPPUNIT_ASSERT(writePkgIndex(tarPath, 0) == PKG_INDEX_UNSUPPORTED);
+    CPPUNIT_ASSERT(readTestFile(tarPath) == before);
+}
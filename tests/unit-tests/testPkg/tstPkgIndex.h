@@ -0,0 +1,52 @@
+#ifndef _THE2B_TST_PKG_INDEX_H
+#define _THE2B_TST_PKG_INDEX_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <filesystem>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestResultCollector.h>
+
+#include "Pkg.h"
+#include "PkgIndex.h"
+#include "Sha256.h"
+#include "tstUtils.h"
+
+#define PKG_INDEX_BASE_DIR "test-env-pkg-index/"
+#define PKG_INDEX_PKG_DIR "test-env-pkg-index/pkgs/"
+#define PKG_INDEX_INSTALLED_DIR "test-env-pkg-index/installed/"
+#define PKG_INDEX_ROOT "test-env-pkg-index/sysroot/"
+#define PKG_INDEX_PLAIN_ROOT "test-env-pkg-index/plainroot/"
+
+// Writes and reads the index of seekable packages, and checks a damaged or outdated index is never trusted
+class PkgIndexTest : public CppUnit::TestFixture {
+    public:
+        void setUp();
+        void tearDown();
+
+        void testSerializeRoundTrip();
+        void testParseRejectsDamage();
+        void testWriteAndReadIndex();
+        void testIndexedPkgStillReadable();
+        void testIndexedPkgInstalls();
+        void testReindexReplacesIndex();
+        void testAppendedMemberIgnoresIndex();
+        void testDamagedIndexIsNotUsed();
+        void testCompressedPkgIsUnsupported();
+
+        static CppUnit::Test* suite();
+
+        std::vector<tarMember_s> walkMembers(const std::string& tarPath);
+        int readIndex(const std::string& tarPath, std::vector<tarMember_s>& members);
+};
+
+#endif /* _THE2B_TST_PKG_INDEX_H */
@@ -0,0 +1,316 @@
+#include "tstPkgMeta.h"
+
+CppUnit::Test* PkgMetaTest::suite() {
+    CppUnit::TestSuite* suite = new CppUnit::TestSuite( "PkgMetaTest" );
+
+    suite->addTest( new CppUnit::TestCaller<PkgMetaTest>( "testSerializeRoundTrip", &PkgMetaTest::testSerializeRoundTrip ));
+    suite->addTest( new CppUnit::TestCaller<PkgMetaTest>( "testParseSkipsCommentsAndUnknownKeys", &PkgMetaTest::testParseSkipsCommentsAndUnknownKeys ));
+    suite->addTest( new CppUnit::TestCaller<PkgMetaTest>( "testParseKeepsLeftOutKeys", &PkgMetaTest::testParseKeepsLeftOutKeys ));
+    suite->addTest( new CppUnit::TestCaller<PkgMetaTest>( "testParseRejectsDamage", &PkgMetaTest::testParseRejectsDamage ));
+    suite->addTest( new CppUnit::TestCaller<PkgMetaTest>( "testReadBuiltPkgMeta", &PkgMetaTest::testReadBuiltPkgMeta ));
+    suite->addTest( new CppUnit::TestCaller<PkgMetaTest>( "testReadAfterPaxHeader", &PkgMetaTest::testReadAfterPaxHeader ));
+    suite->addTest( new CppUnit::TestCaller<PkgMetaTest>( "testReadLargeMeta", &PkgMetaTest::testReadLargeMeta ));
+    suite->addTest( new CppUnit::TestCaller<PkgMetaTest>( "testMetaOnlyAsFirstMember", &PkgMetaTest::testMetaOnlyAsFirstMember ));
+    suite->addTest( new CppUnit::TestCaller<PkgMetaTest>( "testReadCompressedPkgMeta", &PkgMetaTest::testReadCompressedPkgMeta ));
+    suite->addTest( new CppUnit::TestCaller<PkgMetaTest>( "testDamagedMetaIsCorrupt", &PkgMetaTest::testDamagedMetaIsCorrupt ));
+    suite->addTest( new CppUnit::TestCaller<PkgMetaTest>( "testMetaIsNotInstalledByDefault", &PkgMetaTest::testMetaIsNotInstalledByDefault ));
+    suite->addTest( new CppUnit::TestCaller<PkgMetaTest>( "testFollowRecordsVersion", &PkgMetaTest::testFollowRecordsVersion ));
+    suite->addTest( new CppUnit::TestCaller<PkgMetaTest>( "testCompressedInstallRunsPreInstallFirst", &PkgMetaTest::testCompressedInstallRunsPreInstallFirst ));
+    suite->addTest( new CppUnit::TestCaller<PkgMetaTest>( "testCompressedInstallWithoutPreInstall", &PkgMetaTest::testCompressedInstallWithoutPreInstall ));
+
+    return suite;
+}
+
+void PkgMetaTest::setUp() {
+    CPPUNIT_ASSERT(makeTestDirs({ PKG_META_BASE_DIR, PKG_META_PKG_DIR, PKG_META_SRC_DIR, PKG_META_INSTALLED_DIR, PKG_META_ROOT }));
+}
+
+void PkgMetaTest::tearDown() {
+    removeTestDir(PKG_META_BASE_DIR);
+}
+
+pkgMeta_s PkgMetaTest::sampleMeta() {
+    pkgMeta_s meta;
+    meta.name = "demo";
+    meta.version = "1.2.3-r1";
+    meta.installedSize = 123456789012ULL;
+    meta.files = 42;
+    meta.depends = { "libc", "zlib>=1.2" };
+    meta.scripts = PKG_META_PRE_INSTALL | PKG_META_POST_UNINSTALL;
+    return meta;
+}
+
+testMember_s PkgMetaTest::metaMember(const std::string& data) {
+    testMember_s m;
+    m.path = PKG_META_NAME;
+    m.data = data;
+    return m;
+}
+
+// Installs the package with its scripts at verbosity 3, and returns what it printed
+std::string PkgMetaTest::installWithScripts(const std::string& tarPath, unsigned int writers, int& res) {
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int fd = open(PKG_META_STDOUT, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    CPPUNIT_ASSERT(saved >= 0 && fd >= 0);
+    CPPUNIT_ASSERT(dup2(fd, STDOUT_FILENO) == STDOUT_FILENO);
+    close(fd);
+
+    Pkg pkg(tarPath, 0);
+    res = pkg.installPkgWithScripts(PKG_META_ROOT, PKG_META_INSTALLED_DIR, 3, ExclusionMatcher(defaultPkgExclusions()), DEFAULT_SMART_OP, writers);
+
+    fflush(stdout);
+    CPPUNIT_ASSERT(dup2(saved, STDOUT_FILENO) == STDOUT_FILENO);
+    close(saved);
+    return readTestFile(PKG_META_STDOUT);
+}
+
+// Whatever is serialized parses back the same, and serializing it again gives the same bytes
+void PkgMetaTest::testSerializeRoundTrip() {
+    pkgMeta_s meta = sampleMeta();
+    std::string buf = serializePkgMeta(meta);
+
+    pkgMeta_s parsed;
+    CPPUNIT_ASSERT(parsePkgMeta(buf, parsed, 0));
+    CPPUNIT_ASSERT(parsed.name == meta.name);
+    CPPUNIT_ASSERT(parsed.version == meta.version);
+    CPPUNIT_ASSERT(parsed.installedSize == meta.installedSize);
+    CPPUNIT_ASSERT(parsed.files == meta.files);
+    CPPUNIT_ASSERT(parsed.depends == meta.depends);
+    CPPUNIT_ASSERT(parsed.scripts == meta.scripts);
+    CPPUNIT_ASSERT(serializePkgMeta(parsed) == buf);
+
+    // Nothing at all still parses back to nothing
+    pkgMeta_s empty;
+    CPPUNIT_ASSERT(parsePkgMeta(serializePkgMeta(pkgMeta_s()), empty, 0));
+    CPPUNIT_ASSERT(empty.name.empty() && empty.depends.empty() && empty.scripts == 0 && empty.files == 0);
+}
+
+// Blank lines, comments, keys from newer versions and Windows line endings are all passed over
+void PkgMetaTest::testParseSkipsCommentsAndUnknownKeys() {
+    pkgMeta_s meta;
+    CPPUNIT_ASSERT(parsePkgMeta("# Written by hand\r\n\r\nname=demo\r\nlicense=MIT\r\nversion=2.0\r\ndepends=a  b\r\nscripts=post-install bogus\r\n", meta, 0));
+
+    CPPUNIT_ASSERT(meta.name == "demo");
+    CPPUNIT_ASSERT(meta.version == "2.0");
+    CPPUNIT_ASSERT(meta.depends == std::vector<std::string>({ "a", "b" }));
+    CPPUNIT_ASSERT(meta.scripts == PKG_META_POST_INSTALL);
+}
+
+// Keys which aren't given keep the value they had, and those which are replace it outright
+void PkgMetaTest::testParseKeepsLeftOutKeys() {
+    pkgMeta_s meta = sampleMeta();
+    CPPUNIT_ASSERT(parsePkgMeta("version=9\ndepends=\n", meta, 0));
+
+    CPPUNIT_ASSERT(meta.name == "demo");
+    CPPUNIT_ASSERT(meta.version == "9");
+    CPPUNIT_ASSERT(meta.depends.empty());
+    CPPUNIT_ASSERT(meta.files == 42);
+    CPPUNIT_ASSERT(meta.scripts == (PKG_META_PRE_INSTALL | PKG_META_POST_UNINSTALL));
+}
+
+// A line without a key and value, or a number which isn't one, makes the whole of it invalid
+void PkgMetaTest::testParseRejectsDamage() {
+    pkgMeta_s meta;
+    CPPUNIT_ASSERT(!parsePkgMeta("name=demo\njust some text\n", meta, 0));
+    CPPUNIT_ASSERT(!parsePkgMeta("files=12a\n", meta, 0));
+    CPPUNIT_ASSERT(!parsePkgMeta("files=-1\n", meta, 0));
+    CPPUNIT_ASSERT(!parsePkgMeta("installedSize=\n", meta, 0));
+    CPPUNIT_ASSERT(!parsePkgMeta("installedSize=99999999999999999999999\n", meta, 0));
+}
+
+// A built package starts with its metadata. The packager's version and dependencies are kept, and the rest comes from the tree
+void PkgMetaTest::testReadBuiltPkgMeta() {
+    CPPUNIT_ASSERT(writeTestFile(PKG_META_SRC_DIR PKG_META_NAME, "name=other\nversion=3.1\ndepends=libc\nfiles=999\n"));
+    CPPUNIT_ASSERT(writeTestFile(PKG_META_SRC_DIR PRE_INSTALL_NAME, "#!/bin/sh\n"));
+    CPPUNIT_ASSERT(writeTestFile(PKG_META_SRC_DIR "usr/bin/tool", "12345"));
+    CPPUNIT_ASSERT(writeTestFile(PKG_META_SRC_DIR "usr/share/doc", "123"));
+    CPPUNIT_ASSERT(buildPkg(PKG_META_SRC_DIR, PKG_META_PKG_DIR, false, 0) == 0);
+
+    pkgMeta_s meta;
+    CPPUNIT_ASSERT(readPkgMeta(PKG_META_PKG_DIR "meta-demo.tar", meta, 0) == 0);
+    CPPUNIT_ASSERT(meta.name == "meta-demo");
+    CPPUNIT_ASSERT(meta.version == "3.1");
+    CPPUNIT_ASSERT(meta.depends == std::vector<std::string>({ "libc" }));
+    CPPUNIT_ASSERT(meta.installedSize == 8);
+    CPPUNIT_ASSERT(meta.files == 5);
+    CPPUNIT_ASSERT(meta.scripts == PKG_META_PRE_INSTALL);
+}
+
+// Other tar writers may put a pax header in front of the metadata, which is passed over
+void PkgMetaTest::testReadAfterPaxHeader() {
+    testMember_s m = metaMember("version=1.0\n");
+    m.xattrs["user.origin"] = "elsewhere";
+
+    std::string tarPath = PKG_META_PKG_DIR "pax.tar";
+    CPPUNIT_ASSERT(writeTestTar(tarPath, { m, { "a", TAR_TYPE_REGULAR, "a" } }));
+
+    pkgMeta_s meta;
+    CPPUNIT_ASSERT(readPkgMeta(tarPath, meta, 0) == 0);
+    CPPUNIT_ASSERT(meta.version == "1.0");
+}
+
+// Metadata which doesn't fit in the first read is read the rest of the way, and metadata past PKG_META_MAX_SIZE isn't ours
+void PkgMetaTest::testReadLargeMeta() {
+    std::string depends;
+    for(int index = 0; index < 1000; index++) {
+        depends += " dependency" + std::to_string(index);
+    }
+
+    std::string tarPath = PKG_META_PKG_DIR "large.tar";
+    CPPUNIT_ASSERT(writeTestTar(tarPath, { metaMember("version=1\ndepends=" + depends + "\n") }));
+
+    pkgMeta_s meta;
+    CPPUNIT_ASSERT(readPkgMeta(tarPath, meta, 0) == 0);
+    CPPUNIT_ASSERT(meta.depends.size() == 1000);
+    CPPUNIT_ASSERT(meta.depends.back() == "dependency999");
+
+    std::string hugePath = PKG_META_PKG_DIR "huge.tar";
+    CPPUNIT_ASSERT(writeTestTar(hugePath, { metaMember("version=1\n# " + std::string(PKG_META_MAX_SIZE, 'x') + "\n") }));
+    CPPUNIT_ASSERT(readPkgMeta(hugePath, meta, 0) == PKG_META_CORRUPT);
+}
+
+// The metadata is only looked for as the first member. Anywhere else, or missing, the package has none
+void PkgMetaTest::testMetaOnlyAsFirstMember() {
+    std::string tarPath = PKG_META_PKG_DIR "late.tar";
+    CPPUNIT_ASSERT(writeTestTar(tarPath, { { "a", TAR_TYPE_REGULAR, "a" }, metaMember("version=1.0\n") }));
+
+    pkgMeta_s meta;
+    meta.version = "stale";
+    CPPUNIT_ASSERT(readPkgMeta(tarPath, meta, 0) == PKG_META_ABSENT);
+    CPPUNIT_ASSERT(meta.version.empty());
+
+    CPPUNIT_ASSERT(readPkgMeta(testPkgPath(), meta, 0) == PKG_META_ABSENT);
+
+    std::string dirPath = PKG_META_PKG_DIR "dir.tar";
+    testMember_s dir = metaMember("");
+    dir.type = TAR_TYPE_DIRECTORY;
+    CPPUNIT_ASSERT(writeTestTar(dirPath, { dir }));
+    CPPUNIT_ASSERT(readPkgMeta(dirPath, meta, 0) == PKG_META_ABSENT);
+
+    CPPUNIT_ASSERT(readPkgMeta(PKG_META_PKG_DIR "missing.tar", meta, 0) == PKG_META_IO_ERROR);
+}
+
+// Compressed packages are read the same way, without decoding past the first member
+void PkgMetaTest::testReadCompressedPkgMeta() {
+    for(const char* filter : { "gzip", "xz", "zstd" }) {
+        std::string tarPath = std::string(PKG_META_PKG_DIR "pkg.tar.") + filter;
+        CPPUNIT_ASSERT(writeTestTar(tarPath, { metaMember("version=4.5\n"), { "big", TAR_TYPE_REGULAR, std::string(1 << 20, 'b') } }, ARCHIVE_FORMAT_TAR_PAX_RESTRICTED, filter));
+
+        pkgMeta_s meta;
+        CPPUNIT_ASSERT(readPkgMeta(tarPath, meta, 0) == 0);
+        CPPUNIT_ASSERT(meta.version == "4.5");
+
+        std::string latePath = std::string(PKG_META_PKG_DIR "late.tar.") + filter;
+        CPPUNIT_ASSERT(writeTestTar(latePath, { { "a", TAR_TYPE_REGULAR, "a" }, metaMember("version=4.5\n") }, ARCHIVE_FORMAT_TAR_PAX_RESTRICTED, filter));
+        CPPUNIT_ASSERT(readPkgMeta(latePath, meta, 0) == PKG_META_ABSENT);
+    }
+}
+
+// Metadata which doesn't parse is reported as damaged, and none of it is kept
+void PkgMetaTest::testDamagedMetaIsCorrupt() {
+    std::string tarPath = PKG_META_PKG_DIR "damaged.tar";
+    CPPUNIT_ASSERT(writeTestTar(tarPath, { metaMember("name=damaged\nfiles=many\n") }));
+
+    pkgMeta_s meta;
+    CPPUNIT_ASSERT(readPkgMeta(tarPath, meta, 0) == PKG_META_CORRUPT);
+    CPPUNIT_ASSERT(meta.name.empty());
+}
+
+// Callers which leave the exclusions to their defaults keep the metadata and the index out of the root, along with the scripts
+void PkgMetaTest::testMetaIsNotInstalledByDefault() {
+    CPPUNIT_ASSERT(writeTestFile(PKG_META_SRC_DIR PKG_META_NAME, "version=1\n"));
+    CPPUNIT_ASSERT(writeTestFile(PKG_META_SRC_DIR POST_INSTALL_NAME, "#!/bin/sh\n"));
+    CPPUNIT_ASSERT(writeTestFile(PKG_META_SRC_DIR "usr/bin/tool", "tool\n"));
+    CPPUNIT_ASSERT(buildPkg(PKG_META_SRC_DIR, PKG_META_PKG_DIR, false, 0) == 0);
+
+    std::string compressedPath = PKG_META_PKG_DIR "compressed.tar.gz";
+    CPPUNIT_ASSERT(writeTestTar(compressedPath, { metaMember("version=1\n"), { "usr/bin/other", TAR_TYPE_REGULAR, "other\n" } }, ARCHIVE_FORMAT_TAR_PAX_RESTRICTED, "gzip"));
+
+    std::vector<std::string> expected = { "usr", "usr/bin", "usr/bin/other", "usr/bin/tool" };
+
+    Pkg built(PKG_META_PKG_DIR "meta-demo.tar", 0);
+    CPPUNIT_ASSERT(built.installPkg(PKG_META_ROOT, PKG_META_INSTALLED_DIR, 0) == ARCHIVE_EOF);
+    Pkg compressed(compressedPath, 0);
+    CPPUNIT_ASSERT(compressed.installPkg(PKG_META_ROOT, PKG_META_INSTALLED_DIR, 0) == ARCHIVE_EOF);
+    CPPUNIT_ASSERT(listTestTree(PKG_META_ROOT) == expected);
+
+    CPPUNIT_ASSERT(makeTestDir(PKG_META_ROOT));
+    std::vector<Pkg> pkgs = { Pkg(PKG_META_PKG_DIR "meta-demo.tar", 0), Pkg(compressedPath, 0) };
+    CPPUNIT_ASSERT(installPkgsPipelined(pkgs, PKG_META_ROOT, PKG_META_INSTALLED_DIR, 0) == 0);
+    CPPUNIT_ASSERT(listTestTree(PKG_META_ROOT) == expected);
+}
+
+// Installing a package records the version from its metadata in the database, installing a newer one records its version instead, and a package without metadata has none
+void PkgMetaTest::testFollowRecordsVersion() {
+    std::string tarPath = PKG_META_PKG_DIR "versioned.tar.gz";
+    CPPUNIT_ASSERT(writeTestTar(tarPath, { metaMember("version=1.0\n"), { "usr/bin/versioned", TAR_TYPE_REGULAR, "1.0\n" } }, ARCHIVE_FORMAT_TAR_PAX_RESTRICTED, "gzip"));
+
+    {
+        Pkg pkg(tarPath, 0);
+        CPPUNIT_ASSERT(pkg.installPkgWithScripts(PKG_META_ROOT, PKG_META_INSTALLED_DIR, 0) == ARCHIVE_EOF);
+
+        PkgDatabase db(PKG_META_INSTALLED_DIR, 0);
+        dbRecord_s rec;
+        CPPUNIT_ASSERT(db.lookup("versioned", rec));
+        CPPUNIT_ASSERT(rec.version == "1.0");
+    }
+
+    CPPUNIT_ASSERT(writeTestTar(tarPath, { metaMember("version=2.0\n"), { "usr/bin/versioned", TAR_TYPE_REGULAR, "2.0\n" } }, ARCHIVE_FORMAT_TAR_PAX_RESTRICTED, "gzip"));
+
+    {
+        Pkg pkg(tarPath, 0);
+        CPPUNIT_ASSERT(pkg.installPkgWithScripts(PKG_META_ROOT, PKG_META_INSTALLED_DIR, 0) == ARCHIVE_EOF);
+    }
+
+    std::string plainPath = PKG_META_PKG_DIR "plain.tar";
+    CPPUNIT_ASSERT(writeTestTar(plainPath, { { "usr/bin/plain", TAR_TYPE_REGULAR, "plain\n" } }));
+    Pkg plain(plainPath, 0);
+    CPPUNIT_ASSERT(plain.followPkg(PKG_META_INSTALLED_DIR, 0));
+
+    PkgDatabase db(PKG_META_INSTALLED_DIR, 0);
+    CPPUNIT_ASSERT(db.getVersion("versioned") == "2.0");
+    CPPUNIT_ASSERT(db.contains("plain"));
+    CPPUNIT_ASSERT(db.getVersion("plain").empty());
+    CPPUNIT_ASSERT(db.getVersion("missing").empty());
+}
+
+// A compressed package whose metadata and scripts come first is extracted in the same pass its scripts are read in, with the pre-install script run before any of its files are written, by one writer or several
+void PkgMetaTest::testCompressedInstallRunsPreInstallFirst() {
+    std::string tarPath = PKG_META_PKG_DIR "early.tar.zst";
+    CPPUNIT_ASSERT(writeTestTar(tarPath, { metaMember("scripts=pre-install post-install\n"), { PRE_INSTALL_NAME, TAR_TYPE_REGULAR, PKG_META_PRE_INSTALL_BODY, "", 0755 }, { POST_INSTALL_NAME, TAR_TYPE_REGULAR, "#!/bin/sh\necho done > post\n", "", 0755 }, { "usr/bin/", TAR_TYPE_DIRECTORY, "", "", 0755 }, { "usr/bin/tool", TAR_TYPE_REGULAR, "tool\n" } }, ARCHIVE_FORMAT_TAR_PAX_RESTRICTED, "zstd"));
+
+    for(unsigned int writers : { 1, 4 }) {
+        CPPUNIT_ASSERT(makeTestDirs({ PKG_META_ROOT, PKG_META_INSTALLED_DIR }));
+
+        int res;
+        std::string out = installWithScripts(tarPath, writers, res);
+        CPPUNIT_ASSERT(res == ARCHIVE_EOF);
+        CPPUNIT_ASSERT(out.find("Scanning it first") == std::string::npos);
+        CPPUNIT_ASSERT(readTestFile(PKG_META_ROOT "pre") == "early\n");
+        CPPUNIT_ASSERT(readTestFile(PKG_META_ROOT "post") == "done\n");
+        CPPUNIT_ASSERT(readTestFile(PKG_META_ROOT "usr/bin/tool") == "tool\n");
+
+        // The members captured on the way are what the package is followed with
+        PkgDatabase db(PKG_META_INSTALLED_DIR, 0);
+        dbRecord_s rec;
+        CPPUNIT_ASSERT(db.lookup("early", rec));
+        CPPUNIT_ASSERT(rec.manifest.find("usr/bin/tool") != std::string::npos);
+
+        removeTestDir(PKG_META_ROOT);
+        removeTestDir(PKG_META_INSTALLED_DIR);
+    }
+}
+
+// Metadata listing no pre-install script is enough to extract a package in one pass, even with its post-install script at the end
+void PkgMetaTest::testCompressedInstallWithoutPreInstall() {
+    std::string tarPath = PKG_META_PKG_DIR "nopre.tar.xz";
+    CPPUNIT_ASSERT(writeTestTar(tarPath, { metaMember("scripts=post-install\n"), { "usr/bin/tool", TAR_TYPE_REGULAR, "tool\n" }, { POST_INSTALL_NAME, TAR_TYPE_REGULAR, "#!/bin/sh\necho done > post\n", "", 0755 } }, ARCHIVE_FORMAT_TAR_PAX_RESTRICTED, "xz"));
+
+    int res;
+    std::string out = installWithScripts(tarPath, 1, res);
+    CPPUNIT_ASSERT(res == ARCHIVE_EOF);
+    CPPUNIT_ASSERT(out.find("Scanning it first") == std::string::npos);
+    CPPUNIT_ASSERT(readTestFile(PKG_META_ROOT "post") == "done\n");
+    CPPUNIT_ASSERT(listTestTree(PKG_META_ROOT) == std::vector<std::string>({ "post", "usr", "usr/bin", "usr/bin/tool" }));
+}
@@ -0,0 +1,61 @@
+#ifndef _THE2B_TST_PKG_META_H
+#define _THE2B_TST_PKG_META_H
+
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestResultCollector.h>
+
+#include "Pkg.h"
+#include "PkgMeta.h"
+#include "PkgBuild.h"
+#include "Pipeline.h"
+#include "tstUtils.h"
+
+#define PKG_META_BASE_DIR "test-env-pkg-meta/"
+#define PKG_META_PKG_DIR "test-env-pkg-meta/pkgs/"
+#define PKG_META_SRC_DIR "test-env-pkg-meta/src/meta-demo/"
+#define PKG_META_INSTALLED_DIR "test-env-pkg-meta/installed/"
+#define PKG_META_ROOT "test-env-pkg-meta/sysroot/"
+#define PKG_META_STDOUT "test-env-pkg-meta/stdout"
+
+// Records whether the package's files were already there when it ran
+#define PKG_META_PRE_INSTALL_BODY "#!/bin/sh\nif [ -e usr/bin/tool ]; then echo late > pre; else echo early > pre; fi\n"
+
+// Parses and serializes package metadata, and reads it from the start of packages written for each test
+class PkgMetaTest : public CppUnit::TestFixture {
+    public:
+        void setUp();
+        void tearDown();
+
+        void testSerializeRoundTrip();
+        void testParseSkipsCommentsAndUnknownKeys();
+        void testParseKeepsLeftOutKeys();
+        void testParseRejectsDamage();
+        void testReadBuiltPkgMeta();
+        void testReadAfterPaxHeader();
+        void testReadLargeMeta();
+        void testMetaOnlyAsFirstMember();
+        void testReadCompressedPkgMeta();
+        void testDamagedMetaIsCorrupt();
+        void testMetaIsNotInstalledByDefault();
+        void testFollowRecordsVersion();
+        void testCompressedInstallRunsPreInstallFirst();
+        void testCompressedInstallWithoutPreInstall();
+
+        static CppUnit::Test* suite();
+
+        pkgMeta_s sampleMeta();
+        testMember_s metaMember(const std::string& data);
+        std::string installWithScripts(const std::string& tarPath, unsigned int writers, int& res);
+};
+
+#endif /* _THE2B_TST_PKG_META_H */
@@ -0,0 +1,186 @@
+#include "tstPrefetch.h"
+
+CppUnit::Test* PrefetchTest::suite() {
+    CppUnit::TestSuite* suite = new CppUnit::TestSuite( "PrefetchTest" );
+
+    suite->addTest( new CppUnit::TestCaller<PrefetchTest>( "testDepthLimit", &PrefetchTest::testDepthLimit ));
+    suite->addTest( new CppUnit::TestCaller<PrefetchTest>( "testByteBudget", &PrefetchTest::testByteBudget ));
+    suite->addTest( new CppUnit::TestCaller<PrefetchTest>( "testFinishReleasesBytes", &PrefetchTest::testFinishReleasesBytes ));
+    suite->addTest( new CppUnit::TestCaller<PrefetchTest>( "testFinishedPkgIsSkipped", &PrefetchTest::testFinishedPkgIsSkipped ));
+    suite->addTest( new CppUnit::TestCaller<PrefetchTest>( "testDisabled", &PrefetchTest::testDisabled ));
+    suite->addTest( new CppUnit::TestCaller<PrefetchTest>( "testFinishedTarballIsDropped", &PrefetchTest::testFinishedTarballIsDropped ));
+    suite->addTest( new CppUnit::TestCaller<PrefetchTest>( "testSharedTarballIsKept", &PrefetchTest::testSharedTarballIsKept ));
+
+    return suite;
+}
+
+void PrefetchTest::setUp() {
+    CPPUNIT_ASSERT(makeTestDirs({ PREFETCH_BASE_DIR, PREFETCH_PKG_DIR }));
+}
+
+void PrefetchTest::tearDown() {
+    removeTestDir(PREFETCH_BASE_DIR);
+}
+
+// count tarballs of size bytes each. Their contents don't matter, only their sizes
+std::vector<std::string> PrefetchTest::writeTarballs(size_t count, size_t size) {
+    std::vector<std::string> paths;
+    for(size_t index = 0; index < count; index++) {
+        paths.push_back(writeTarball("pkg" + std::to_string(index) + ".tar", size));
+    }
+
+    return paths;
+}
+
+// Written through to the disk, so the kernel is free to drop its pages
+std::string PrefetchTest::writeTarball(const std::string& name, size_t size) {
+    std::string path = PREFETCH_PKG_DIR + name;
+    CPPUNIT_ASSERT(writeTestFile(path, std::string(size, 'x')));
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    CPPUNIT_ASSERT(fd >= 0);
+    CPPUNIT_ASSERT(fsync(fd) == 0);
+    close(fd);
+
+    return path;
+}
+
+// How many pages of a file are in the page cache
+size_t PrefetchTest::cachedPages(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    CPPUNIT_ASSERT(fd >= 0);
+
+    size_t pages = totalPages(path);
+    size_t length = pages * sysconf(_SC_PAGESIZE);
+    void* map = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    CPPUNIT_ASSERT(map != MAP_FAILED);
+
+    std::vector<unsigned char> resident(pages);
+    CPPUNIT_ASSERT(mincore(map, length, resident.data()) == 0);
+    munmap(map, length);
+
+    size_t cached = 0;
+    for(unsigned char page : resident) {
+        cached += page & 1;
+    }
+
+    return cached;
+}
+
+size_t PrefetchTest::totalPages(const std::string& path) {
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    return (std::filesystem::file_size(path) + pageSize - 1) / pageSize;
+}
+
+// Pulls the whole file into the page cache, as installing it would
+void PrefetchTest::readWhole(const std::string& path) {
+    CPPUNIT_ASSERT(readTestFile(path).size() == std::filesystem::file_size(path));
+}
+
+// Only the packages within depth of the one just started are read ahead, never the started one itself
+void PrefetchTest::testDepthLimit() {
+    std::vector<std::string> paths = writeTarballs(5, 4096);
+    Prefetcher prefetcher(paths, 2, 1 << 20, 0);
+
+    prefetcher.start(0);
+    CPPUNIT_ASSERT(prefetcher.getHeldBytes(0) == 0);
+    CPPUNIT_ASSERT(prefetcher.getHeldBytes(1) == 4096);
+    CPPUNIT_ASSERT(prefetcher.getHeldBytes(2) == 4096);
+    CPPUNIT_ASSERT(prefetcher.getHeldBytes(3) == 0);
+    CPPUNIT_ASSERT(prefetcher.getHeldBytes() == 8192);
+
+    prefetcher.start(1);
+    CPPUNIT_ASSERT(prefetcher.getHeldBytes(3) == 4096);
+    CPPUNIT_ASSERT(prefetcher.getHeldBytes(4) == 0);
+    CPPUNIT_ASSERT(prefetcher.getHeldBytes() == 12288);
+}
+
+// Nothing more is read ahead than the budget allows, and the tarball which crosses it only has its start held
+void PrefetchTest::testByteBudget() {
+    std::vector<std::string> paths = writeTarballs(5, 10000);
+    Prefetcher prefetcher(paths, 4, 15000, 0);
+
+    prefetcher.start(0);
+    CPPUNIT_ASSERT(prefetcher.getHeldBytes(1) == 10000);
+    CPPUNIT_ASSERT(prefetcher.getHeldBytes(2) == 5000);
+    CPPUNIT_ASSERT(prefetcher.getHeldBytes(3) == 0);
+    CPPUNIT_ASSERT(prefetcher.getHeldBytes() == 15000);
+}
+
+// Finishing a package gives its share of the budget back, and the next package which didn't fit takes it
+void PrefetchTest::testFinishReleasesBytes() {
+    std::vector<std::string> paths = writeTarballs(5, 10000);
+    Prefetcher prefetcher(paths, 4, 15000, 0);
+
+    prefetcher.start(0);
+    prefetcher.start(1);
+    prefetcher.finish(1);
+    CPPUNIT_ASSERT(prefetcher.getHeldBytes(1) == 0);
+    CPPUNIT_ASSERT(prefetcher.getHeldBytes(2) == 5000);
+    CPPUNIT_ASSERT(prefetcher.getHeldBytes(3) == 10000);
+    CPPUNIT_ASSERT(prefetcher.getHeldBytes() == 15000);
+
+    prefetcher.finish(2);
+    CPPUNIT_ASSERT(prefetcher.getHeldBytes(4) == 5000);
+    CPPUNIT_ASSERT(prefetcher.getHeldBytes() == 15000);
+}
+
+// A package finished before it was reached, like one skipped after a failure, is never read ahead
+void PrefetchTest::testFinishedPkgIsSkipped() {
+    std::vector<std::string> paths = writeTarballs(5, 4096);
+    Prefetcher prefetcher(paths, 2, 1 << 20, 0);
+
+    prefetcher.start(0);
+    prefetcher.finish(3);
+    prefetcher.start(2);
+    CPPUNIT_ASSERT(prefetcher.getHeldBytes(3) == 0);
+    CPPUNIT_ASSERT(prefetcher.getHeldBytes(4) == 4096);
+    CPPUNIT_ASSERT(prefetcher.getHeldBytes() == 12288);
+}
+
+// A depth or a budget of 0 reads nothing ahead
+void PrefetchTest::testDisabled() {
+    std::vector<std::string> paths = writeTarballs(3, 4096);
+
+    Prefetcher noDepth(paths, 0, 1 << 20, 0);
+    noDepth.start(0);
+    CPPUNIT_ASSERT(noDepth.getHeldBytes() == 0);
+
+    Prefetcher noBudget(paths, 2, 0, 0);
+    noBudget.start(0);
+    CPPUNIT_ASSERT(noBudget.getHeldBytes() == 0);
+}
+
+// The tarball of a finished package is dropped from the page cache
+void PrefetchTest::testFinishedTarballIsDropped() {
+    std::vector<std::string> paths = writeTarballs(2, 1 << 20);
+    Prefetcher prefetcher(paths, 0, 0, 0);
+
+    prefetcher.start(0);
+    readWhole(paths[0]);
+    CPPUNIT_ASSERT(cachedPages(paths[0]) == totalPages(paths[0]));
+
+    prefetcher.finish(0);
+    CPPUNIT_ASSERT(cachedPages(paths[0]) == 0);
+}
+
+// A tarball which a later, unfinished package uses too stays in the page cache until that package is done with it
+void PrefetchTest::testSharedTarballIsKept() {
+    std::string shared = writeTarball("shared.tar", 1 << 20);
+    std::string other = writeTarball("other.tar", 1 << 20);
+    Prefetcher prefetcher({shared, other, shared}, 0, 0, 0);
+
+    prefetcher.start(0);
+    readWhole(shared);
+    prefetcher.finish(0);
+    CPPUNIT_ASSERT(cachedPages(shared) == totalPages(shared));
+
+    prefetcher.start(1);
+    prefetcher.finish(1);
+    CPPUNIT_ASSERT(cachedPages(shared) == totalPages(shared));
+
+    prefetcher.start(2);
+    prefetcher.finish(2);
+    CPPUNIT_ASSERT(cachedPages(shared) == 0);
+}
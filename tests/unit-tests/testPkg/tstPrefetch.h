@@ -0,0 +1,47 @@
+#ifndef _THE2B_TST_PREFETCH_H
+#define _THE2B_TST_PREFETCH_H
+
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestResultCollector.h>
+
+#include "Prefetch.h"
+#include "tstUtils.h"
+
+#define PREFETCH_BASE_DIR "test-env-prefetch/"
+#define PREFETCH_PKG_DIR "test-env-prefetch/pkgs/"
+
+// Reads ahead the tarballs of upcoming packages, and checks how far ahead, how much, and what is dropped once a package is done
+class PrefetchTest : public CppUnit::TestFixture {
+    public:
+        void setUp();
+        void tearDown();
+
+        void testDepthLimit();
+        void testByteBudget();
+        void testFinishReleasesBytes();
+        void testFinishedPkgIsSkipped();
+        void testDisabled();
+        void testFinishedTarballIsDropped();
+        void testSharedTarballIsKept();
+
+        static CppUnit::Test* suite();
+
+        std::vector<std::string> writeTarballs(size_t count, size_t size);
+        std::string writeTarball(const std::string& name, size_t size);
+        size_t cachedPages(const std::string& path);
+        size_t totalPages(const std::string& path);
+        void readWhole(const std::string& path);
+};
+
+#endif /* _THE2B_TST_PREFETCH_H */
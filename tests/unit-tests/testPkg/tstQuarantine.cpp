@@ -0,0 +1,131 @@
+#include "tstQuarantine.h"
+
+CppUnit::Test* QuarantineTest::suite() {
+    CppUnit::TestSuite* suite = new CppUnit::TestSuite( "QuarantineTest" );
+
+    suite->addTest( new CppUnit::TestCaller<QuarantineTest>( "testUninstall", &QuarantineTest::testUninstall ));
+    suite->addTest( new CppUnit::TestCaller<QuarantineTest>( "testSharedDirectoryIsKept", &QuarantineTest::testSharedDirectoryIsKept ));
+    suite->addTest( new CppUnit::TestCaller<QuarantineTest>( "testExcludedPathsAreKept", &QuarantineTest::testExcludedPathsAreKept ));
+    suite->addTest( new CppUnit::TestCaller<QuarantineTest>( "testInterruptedUninstallIsPutBack", &QuarantineTest::testInterruptedUninstallIsPutBack ));
+    suite->addTest( new CppUnit::TestCaller<QuarantineTest>( "testOccupiedPathIsNotPutBack", &QuarantineTest::testOccupiedPathIsNotPutBack ));
+    suite->addTest( new CppUnit::TestCaller<QuarantineTest>( "testCommittedUninstallIsNotPutBack", &QuarantineTest::testCommittedUninstallIsNotPutBack ));
+    suite->addTest( new CppUnit::TestCaller<QuarantineTest>( "testRunningUninstallIsLeftAlone", &QuarantineTest::testRunningUninstallIsLeftAlone ));
+
+    return suite;
+}
+
+void QuarantineTest::setUp() {
+    CPPUNIT_ASSERT(makeTestDirs({ QUARANTINE_BASE_DIR, QUARANTINE_INSTALLED_DIR, QUARANTINE_ROOT }));
+}
+
+void QuarantineTest::tearDown() {
+    removeTestDir(QUARANTINE_BASE_DIR);
+}
+
+// Installs the test package, and returns its contents as an uninstall would find them
+std::set<std::string> QuarantineTest::installTestPkg() {
+    Pkg pkg(testPkgPath(), 0);
+    CPPUNIT_ASSERT(pkg.installPkg(QUARANTINE_ROOT, QUARANTINE_INSTALLED_DIR, 0, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES)), DEFAULT_SMART_OP, 1) == ARCHIVE_EOF);
+
+    std::set<std::string> contents = pkg.loadPkgContents(QUARANTINE_INSTALLED_DIR, 0);
+    CPPUNIT_ASSERT(contents.size() == TEST_PKG_MEMBER_COUNT);
+    return contents;
+}
+
+// The trash directory of an uninstall, as it's left when the run stops after moving every path in, and before marking it as committed
+void QuarantineTest::writeInterruptedUninstall(const std::string& name, const std::vector<std::string>& paths, bool committed) {
+    std::string sub = QUARANTINE_TRASH + name + "/";
+    CPPUNIT_ASSERT(makeTestDir(sub));
+
+    std::string journal;
+    for(size_t index = 0; index < paths.size(); index++) {
+        journal.append(paths[index]).push_back('\0');
+        std::filesystem::rename(QUARANTINE_ROOT + paths[index], sub + std::to_string(index));
+    }
+
+    CPPUNIT_ASSERT(writeTestFile(sub + TRASH_JOURNAL_NAME, journal));
+
+    if(committed) {
+        CPPUNIT_ASSERT(writeTestFile(sub + TRASH_COMMITTED_NAME, ""));
+    }
+}
+
+// Everything the package installed is moved out, and the trash is emptied and removed
+void QuarantineTest::testUninstall() {
+    std::set<std::string> contents = installTestPkg();
+
+    int res = quarantinePkgPaths(contents, QUARANTINE_ROOT, TEST_PKG_NAME, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES)), 0, false);
+    CPPUNIT_ASSERT(res > 0);
+    CPPUNIT_ASSERT(listTestTree(QUARANTINE_ROOT).empty());
+}
+
+// A directory holding something the package didn't install stays, along with that something
+void QuarantineTest::testSharedDirectoryIsKept() {
+    std::set<std::string> contents = installTestPkg();
+    CPPUNIT_ASSERT(writeTestFile(QUARANTINE_ROOT TEST_PKG_DIR_MEMBER "/local.c", "local\n"));
+
+    CPPUNIT_ASSERT(quarantinePkgPaths(contents, QUARANTINE_ROOT, TEST_PKG_NAME, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES)), 0, false) > 0);
+    CPPUNIT_ASSERT(listTestTree(QUARANTINE_ROOT) == std::vector<std::string>({ "mpc-1.1.0", TEST_PKG_DIR_MEMBER, TEST_PKG_DIR_MEMBER "/local.c" }));
+}
+
+// Excluded paths are never moved, so neither are the directories holding them
+void QuarantineTest::testExcludedPathsAreKept() {
+    std::set<std::string> contents = installTestPkg();
+
+    std::set<std::string> patterns(PKG_SCRIPT_NAMES);
+    patterns.insert(TEST_PKG_FILE);
+
+    CPPUNIT_ASSERT(quarantinePkgPaths(contents, QUARANTINE_ROOT, TEST_PKG_NAME, ExclusionMatcher(patterns, 0), 0, false) > 0);
+    CPPUNIT_ASSERT(listTestTree(QUARANTINE_ROOT) == std::vector<std::string>({ "mpc-1.1.0", TEST_PKG_FILE }));
+}
+
+// What an uninstall whose process is gone moved into the trash is put back from its journal, and the trash goes away
+void QuarantineTest::testInterruptedUninstallIsPutBack() {
+    installTestPkg();
+    std::vector<std::string> before = listTestTree(QUARANTINE_ROOT);
+
+    writeInterruptedUninstall(std::to_string(deadPid()) + ".0." TEST_PKG_NAME, { TEST_PKG_FILE, TEST_PKG_DIR_MEMBER });
+
+    struct stat st;
+    CPPUNIT_ASSERT(stat(QUARANTINE_ROOT TEST_PKG_FILE, &st) != 0);
+
+    CPPUNIT_ASSERT(recoverTrash(QUARANTINE_ROOT, 0) == 2);
+    CPPUNIT_ASSERT(listTestTree(QUARANTINE_ROOT) == before);
+}
+
+// A path something else took the place of in the meantime is left in the trash, and tried again next time
+void QuarantineTest::testOccupiedPathIsNotPutBack() {
+    CPPUNIT_ASSERT(writeTestFile(QUARANTINE_ROOT "a", "a\n"));
+    CPPUNIT_ASSERT(writeTestFile(QUARANTINE_ROOT "b", "b\n"));
+
+    std::string name = std::to_string(deadPid()) + ".0.pkg";
+    writeInterruptedUninstall(name, { "a", "b" });
+    CPPUNIT_ASSERT(writeTestFile(QUARANTINE_ROOT "a", "new\n"));
+
+    CPPUNIT_ASSERT(recoverTrash(QUARANTINE_ROOT, 0) == 1);
+    CPPUNIT_ASSERT(readTestFile(QUARANTINE_ROOT "a") == "new\n");
+    CPPUNIT_ASSERT(readTestFile(QUARANTINE_ROOT "b") == "b\n");
+}
+
+// An uninstall which finished moving its package in only has deleting left to do. Its paths are never put back
+void QuarantineTest::testCommittedUninstallIsNotPutBack() {
+    CPPUNIT_ASSERT(writeTestFile(QUARANTINE_ROOT "a", "a\n"));
+    writeInterruptedUninstall(std::to_string(deadPid()) + ".0.pkg", { "a" }, true);
+
+    CPPUNIT_ASSERT(recoverTrash(QUARANTINE_ROOT, 0) == 0);
+
+    struct stat st;
+    CPPUNIT_ASSERT(stat(QUARANTINE_ROOT "a", &st) != 0);
+}
+
+// An uninstall whose process is still running is still moving its package in, and mustn't have it taken back out
+void QuarantineTest::testRunningUninstallIsLeftAlone() {
+    CPPUNIT_ASSERT(writeTestFile(QUARANTINE_ROOT "a", "a\n"));
+    writeInterruptedUninstall(std::to_string(getppid()) + ".0.pkg", { "a" });
+
+    CPPUNIT_ASSERT(recoverTrash(QUARANTINE_ROOT, 0) == 0);
+
+    struct stat st;
+    CPPUNIT_ASSERT(stat(QUARANTINE_ROOT "a", &st) != 0);
+    CPPUNIT_ASSERT(stat(QUARANTINE_TRASH, &st) == 0);
+}
@@ -0,0 +1,46 @@
+#ifndef _THE2B_TST_QUARANTINE_H
+#define _THE2B_TST_QUARANTINE_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <filesystem>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestResultCollector.h>
+
+#include "Pkg.h"
+#include "Quarantine.h"
+#include "tstUtils.h"
+
+#define QUARANTINE_BASE_DIR "test-env-quarantine/"
+#define QUARANTINE_INSTALLED_DIR "test-env-quarantine/installed/"
+#define QUARANTINE_ROOT "test-env-quarantine/sysroot/"
+#define QUARANTINE_TRASH QUARANTINE_ROOT TRASH_DIR_NAME "/"
+
+// Uninstalls packages through the trash, and puts back what interrupted uninstalls left in it
+class QuarantineTest : public CppUnit::TestFixture {
+    public:
+        void setUp();
+        void tearDown();
+
+        void testUninstall();
+        void testSharedDirectoryIsKept();
+        void testExcludedPathsAreKept();
+        void testInterruptedUninstallIsPutBack();
+        void testOccupiedPathIsNotPutBack();
+        void testCommittedUninstallIsNotPutBack();
+        void testRunningUninstallIsLeftAlone();
+
+        static CppUnit::Test* suite();
+
+        std::set<std::string> installTestPkg();
+        void writeInterruptedUninstall(const std::string& name, const std::vector<std::string>& paths, bool committed = false);
+};
+
+#endif /* _THE2B_TST_QUARANTINE_H */
@@ -0,0 +1,57 @@
+#include "tstRemove.h"
+
+CppUnit::Test* RemoveTest::suite() {
+    CppUnit::TestSuite* suite = new CppUnit::TestSuite( "RemoveTest" );
+
+    suite->addTest( new CppUnit::TestCaller<RemoveTest>( "testRemovePaths", &RemoveTest::testRemovePaths ));
+    suite->addTest( new CppUnit::TestCaller<RemoveTest>( "testSymlinkToDeeperDirectory", &RemoveTest::testSymlinkToDeeperDirectory ));
+    suite->addTest( new CppUnit::TestCaller<RemoveTest>( "testSymlinkToDirectoryAtSameDepth", &RemoveTest::testSymlinkToDirectoryAtSameDepth ));
+
+    return suite;
+}
+
+void RemoveTest::setUp() {
+    CPPUNIT_ASSERT(makeTestDirs({ REMOVE_BASE_DIR, REMOVE_ROOT }));
+}
+
+void RemoveTest::tearDown() {
+    removeTestDir(REMOVE_BASE_DIR);
+}
+
+// Every path of the package goes, and a directory holding anything else stays, along with that something
+void RemoveTest::testRemovePaths() {
+    CPPUNIT_ASSERT(makeTestDirs({ REMOVE_ROOT "usr/", REMOVE_ROOT "usr/bin/", REMOVE_ROOT "usr/share/", REMOVE_ROOT "usr/share/pkg/" }));
+    CPPUNIT_ASSERT(writeTestFile(REMOVE_ROOT "usr/bin/pkg", "pkg\n"));
+    CPPUNIT_ASSERT(writeTestFile(REMOVE_ROOT "usr/bin/other", "other\n"));
+    CPPUNIT_ASSERT(writeTestFile(REMOVE_ROOT "usr/share/pkg/data", "data\n"));
+
+    std::set<std::string> contents = { "usr/", "usr/bin/", "usr/bin/pkg", "usr/share/", "usr/share/pkg/", "usr/share/pkg/data" };
+    CPPUNIT_ASSERT(removePkgPaths(contents, REMOVE_ROOT, ExclusionMatcher(), 0, 1) == 4);
+    CPPUNIT_ASSERT(listTestTree(REMOVE_ROOT) == std::vector<std::string>({ "usr", "usr/bin", "usr/bin/other" }));
+}
+
+// A path recorded through a link to a directory further down is removed through the link. The link, and anything the package didn't install, are left alone
+void RemoveTest::testSymlinkToDeeperDirectory() {
+    CPPUNIT_ASSERT(makeTestDirs({ REMOVE_ROOT "a/", REMOVE_ROOT "a/b/", REMOVE_ROOT "a/b/target/" }));
+    CPPUNIT_ASSERT(writeTestFile(REMOVE_ROOT "a/b/target/file", "file\n"));
+    CPPUNIT_ASSERT(writeTestFile(REMOVE_ROOT "a/b/target/local", "local\n"));
+    CPPUNIT_ASSERT(symlink("a/b/target", REMOVE_ROOT "link") == 0);
+
+    std::set<std::string> contents = { "a/", "a/b/", "a/b/target/", "link/file" };
+    CPPUNIT_ASSERT(removePkgPaths(contents, REMOVE_ROOT, ExclusionMatcher(), 0, 1) == 1);
+    CPPUNIT_ASSERT(listTestTree(REMOVE_ROOT) == std::vector<std::string>({ "a", "a/b", "a/b/target", "a/b/target/local", "link" }));
+    CPPUNIT_ASSERT(std::filesystem::is_symlink(REMOVE_ROOT "link"));
+    CPPUNIT_ASSERT(readTestFile(REMOVE_ROOT "a/b/target/local") == "local\n");
+}
+
+// The target of a link at the same depth may be tried before the entries under the link are gone. It's then left in place, just like a directory which isn't empty, and the link's entries still go
+void RemoveTest::testSymlinkToDirectoryAtSameDepth() {
+    CPPUNIT_ASSERT(makeTestDirs({ REMOVE_ROOT "usr/", REMOVE_ROOT "usr/lib/" }));
+    CPPUNIT_ASSERT(writeTestFile(REMOVE_ROOT "usr/lib/libpkg.so", "lib\n"));
+    CPPUNIT_ASSERT(symlink("usr/lib", REMOVE_ROOT "lib") == 0);
+
+    std::set<std::string> contents = { "lib/libpkg.so", "usr/", "usr/lib/" };
+    CPPUNIT_ASSERT(removePkgPaths(contents, REMOVE_ROOT, ExclusionMatcher(), 0, 1) >= 1);
+    CPPUNIT_ASSERT(!std::filesystem::exists(REMOVE_ROOT "usr/lib/libpkg.so"));
+    CPPUNIT_ASSERT(std::filesystem::is_symlink(REMOVE_ROOT "lib"));
+}
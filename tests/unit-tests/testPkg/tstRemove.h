@@ -0,0 +1,36 @@
+#ifndef _THE2B_TST_REMOVE_H
+#define _THE2B_TST_REMOVE_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <filesystem>
+#include <unistd.h>
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestResultCollector.h>
+
+#include "Pkg.h"
+#include "Remove.h"
+#include "tstUtils.h"
+
+#define REMOVE_BASE_DIR "test-env-remove/"
+#define REMOVE_ROOT "test-env-remove/sysroot/"
+
+// Removes the paths of packages from a root a directory at a time, including through symbolic links to directories
+class RemoveTest : public CppUnit::TestFixture {
+    public:
+        void setUp();
+        void tearDown();
+
+        void testRemovePaths();
+        void testSymlinkToDeeperDirectory();
+        void testSymlinkToDirectoryAtSameDepth();
+
+        static CppUnit::Test* suite();
+};
+
+#endif /* _THE2B_TST_REMOVE_H */
@@ -0,0 +1,76 @@
+#include "tstScript.h"
+
+CppUnit::Test* ScriptTest::suite() {
+    CppUnit::TestSuite* suite = new CppUnit::TestSuite( "ScriptTest" );
+
+    suite->addTest( new CppUnit::TestCaller<ScriptTest>( "testExitStatus", &ScriptTest::testExitStatus ));
+    suite->addTest( new CppUnit::TestCaller<ScriptTest>( "testWithoutShebang", &ScriptTest::testWithoutShebang ));
+    suite->addTest( new CppUnit::TestCaller<ScriptTest>( "testKilledBySignal", &ScriptTest::testKilledBySignal ));
+    suite->addTest( new CppUnit::TestCaller<ScriptTest>( "testNotExecutable", &ScriptTest::testNotExecutable ));
+    suite->addTest( new CppUnit::TestCaller<ScriptTest>( "testNoFdLeftOpen", &ScriptTest::testNoFdLeftOpen ));
+
+    return suite;
+}
+
+void ScriptTest::setUp() {
+    CPPUNIT_ASSERT(makeTestDir(SCRIPT_BASE_DIR));
+}
+
+void ScriptTest::tearDown() {
+    removeTestDir(SCRIPT_BASE_DIR);
+}
+
+static pkgScript_s makeScript(const std::string& body, mode_t mode = 0755) {
+    pkgScript_s script;
+    script.body = body;
+    script.mode = mode;
+    return script;
+}
+
+// The fds this process has open
+static std::set<std::string> openFds() {
+    std::set<std::string> fds;
+    for(const auto& entry : std::filesystem::directory_iterator("/proc/self/fd")) {
+        fds.insert(entry.path().filename().string());
+    }
+
+    return fds;
+}
+
+// The exit status of the script is handed back as is, and the script runs from our working directory
+void ScriptTest::testExitStatus() {
+    CPPUNIT_ASSERT(runScript("pre-install.sh", makeScript("#!/bin/sh\necho ran > " SCRIPT_BASE_DIR "marker\nexit 3\n"), "test", 0) == 3);
+    CPPUNIT_ASSERT(readTestFile(SCRIPT_BASE_DIR "marker") == "ran\n");
+
+    double seconds = -1;
+    CPPUNIT_ASSERT(runScript("post-install.sh", makeScript("#!/bin/sh\nexit 0\n"), "test", 0, &seconds) == 0);
+    CPPUNIT_ASSERT(seconds >= 0);
+}
+
+// A script without a #! line can't be executed by the kernel, so it's run by /bin/sh, as it was through system()
+void ScriptTest::testWithoutShebang() {
+    CPPUNIT_ASSERT(runScript("pre-install.sh", makeScript("echo ran > " SCRIPT_BASE_DIR "marker\nexit 4\n"), "test", 0) == 4);
+    CPPUNIT_ASSERT(readTestFile(SCRIPT_BASE_DIR "marker") == "ran\n");
+}
+
+void ScriptTest::testKilledBySignal() {
+    CPPUNIT_ASSERT(runScript("pre-install.sh", makeScript("#!/bin/sh\nkill -9 $$\n"), "test", 0) == 128 + 9);
+}
+
+// The permissions from the tarball are kept, so a script which isn't executable fails to run, with or without a #! line
+void ScriptTest::testNotExecutable() {
+    CPPUNIT_ASSERT(runScript("pre-install.sh", makeScript("#!/bin/sh\necho ran > " SCRIPT_BASE_DIR "marker\n", 0644), "test", 0) == SCRIPT_SPAWN_ERROR);
+    CPPUNIT_ASSERT(runScript("pre-install.sh", makeScript("echo ran > " SCRIPT_BASE_DIR "marker\n", 0644), "test", 0) == SCRIPT_SPAWN_ERROR);
+    CPPUNIT_ASSERT(!std::filesystem::exists(SCRIPT_BASE_DIR "marker"));
+}
+
+// The memory file of a script is closed once it has run, whether it ran, went through the shell, or couldn't be run at all
+void ScriptTest::testNoFdLeftOpen() {
+    std::set<std::string> before = openFds();
+
+    CPPUNIT_ASSERT(runScript("pre-install.sh", makeScript("#!/bin/sh\nexit 0\n"), "test", 0) == 0);
+    CPPUNIT_ASSERT(runScript("pre-install.sh", makeScript("exit 0\n"), "test", 0) == 0);
+    CPPUNIT_ASSERT(runScript("pre-install.sh", makeScript("exit 0\n", 0644), "test", 0) == SCRIPT_SPAWN_ERROR);
+
+    CPPUNIT_ASSERT(openFds() == before);
+}
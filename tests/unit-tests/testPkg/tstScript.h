@@ -0,0 +1,35 @@
+#ifndef _THE2B_TST_SCRIPT_H
+#define _THE2B_TST_SCRIPT_H
+
+#include <string>
+#include <set>
+#include <filesystem>
+#include <unistd.h>
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestResultCollector.h>
+
+#include "Script.h"
+#include "tstUtils.h"
+
+#define SCRIPT_BASE_DIR "test-env-script/"
+
+// Runs scripts held in memory, with and without a #! line
+class ScriptTest : public CppUnit::TestFixture {
+    public:
+        void setUp();
+        void tearDown();
+
+        void testExitStatus();
+        void testWithoutShebang();
+        void testKilledBySignal();
+        void testNotExecutable();
+        void testNoFdLeftOpen();
+
+        static CppUnit::Test* suite();
+};
+
+#endif /* _THE2B_TST_SCRIPT_H */
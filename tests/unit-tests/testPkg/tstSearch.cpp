@@ -0,0 +1,125 @@
+#include "tstSearch.h"
+
+CppUnit::Test* SearchTest::suite() {
+    CppUnit::TestSuite* suite = new CppUnit::TestSuite( "SearchTest" );
+
+    suite->addTest( new CppUnit::TestCaller<SearchTest>( "testFindCandidates", &SearchTest::testFindCandidates ));
+    suite->addTest( new CppUnit::TestCaller<SearchTest>( "testSearchLibrary", &SearchTest::testSearchLibrary ));
+    suite->addTest( new CppUnit::TestCaller<SearchTest>( "testShortTermsDoNotNarrow", &SearchTest::testShortTermsDoNotNarrow ));
+    suite->addTest( new CppUnit::TestCaller<SearchTest>( "testUpToDateIndexIsKept", &SearchTest::testUpToDateIndexIsKept ));
+    suite->addTest( new CppUnit::TestCaller<SearchTest>( "testAddedAndRemovedPackages", &SearchTest::testAddedAndRemovedPackages ));
+    suite->addTest( new CppUnit::TestCaller<SearchTest>( "testChangedPackageIsReread", &SearchTest::testChangedPackageIsReread ));
+
+    return suite;
+}
+
+void SearchTest::setUp() {
+    CPPUNIT_ASSERT(makeTestDirs({ SEARCH_BASE_DIR, SEARCH_LIB_DIR, SEARCH_INSTALLED_DIR }));
+
+    copyTestPkg(SEARCH_LIB_DIR);
+    writeTestPkg("zlib", { "usr/lib/libz.so", "usr/include/zlib.h" });
+    writeTestPkg("openssl", { "usr/lib/libssl.so", "usr/include/openssl/ssl.h" });
+}
+
+void SearchTest::tearDown() {
+    removeTestDir(SEARCH_BASE_DIR);
+}
+
+// The index only looks at a tarball's size and mtime to tell whether it changed, so tests which rewrite one set the mtime themselves
+void SearchTest::writeTestPkg(const std::string& name, const std::vector<std::string>& paths, time_t mtime) {
+    std::vector<testMember_s> members;
+    for(const std::string& path : paths) {
+        testMember_s m;
+        m.path = path;
+        m.data = path + "\n";
+        members.push_back(m);
+    }
+
+    std::string tarPath = SEARCH_LIB_DIR + name + ".tar";
+    CPPUNIT_ASSERT(writeTestTar(tarPath, members));
+
+    struct utimbuf times = { mtime, mtime };
+    CPPUNIT_ASSERT(utime(tarPath.c_str(), &times) == 0);
+}
+
+// Refreshes the index, and names the packages which may contain every term
+std::vector<std::string> SearchTest::findPkgs(const std::vector<std::string>& terms) {
+    std::string unsaved;
+    CPPUNIT_ASSERT(refreshSearchIndex(SEARCH_LIB_DIR, SEARCH_INSTALLED_DIR, unsaved, 0) == 0);
+    CPPUNIT_ASSERT(unsaved.empty());
+
+    SearchIndex index(SEARCH_INSTALLED_DIR, 0);
+    CPPUNIT_ASSERT(index.isValid());
+
+    std::vector<std::string> names;
+    for(uint32_t id : index.findCandidates(terms)) {
+        searchPkg_s pkg;
+        CPPUNIT_ASSERT(index.getPkg(id, pkg, false));
+        names.push_back(pkgNameFromPath(pkg.tarPath));
+    }
+
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+// Package names and the paths in them are both indexed, and every term has to match
+void SearchTest::testFindCandidates() {
+    CPPUNIT_ASSERT(findPkgs({ "zlib" }) == std::vector<std::string>({ "zlib" }));
+    CPPUNIT_ASSERT(findPkgs({ "usr/lib" }) == std::vector<std::string>({ "openssl", "zlib" }));
+    CPPUNIT_ASSERT(findPkgs({ "usr/lib", "ssl" }) == std::vector<std::string>({ "openssl" }));
+    CPPUNIT_ASSERT(findPkgs({ "authors" }) == std::vector<std::string>({ TEST_PKG_NAME }));
+    CPPUNIT_ASSERT(findPkgs({ "nowhere" }).empty());
+
+    SearchIndex index(SEARCH_INSTALLED_DIR, 0);
+    CPPUNIT_ASSERT(index.getPkgCount() == 3);
+}
+
+// Searches ignore case, and only succeed when something matched
+void SearchTest::testSearchLibrary() {
+    CPPUNIT_ASSERT(searchLibrary({ "ZLIB.H" }, SEARCH_LIB_DIR, SEARCH_INSTALLED_DIR, 0) == 0);
+    CPPUNIT_ASSERT(searchLibrary({ "Authors" }, SEARCH_LIB_DIR, SEARCH_INSTALLED_DIR, 0) == 0);
+    CPPUNIT_ASSERT(searchLibrary({ "nowhere" }, SEARCH_LIB_DIR, SEARCH_INSTALLED_DIR, 0) == SEARCH_NO_MATCH);
+}
+
+// A term shorter than a trigram can't be looked up, so every package remains a candidate
+void SearchTest::testShortTermsDoNotNarrow() {
+    CPPUNIT_ASSERT(findPkgs({ "h" }).size() == 3);
+    CPPUNIT_ASSERT(findPkgs({ "h", "zlib" }) == std::vector<std::string>({ "zlib" }));
+}
+
+// Refreshing an index nothing in the library changed under leaves the file alone
+void SearchTest::testUpToDateIndexIsKept() {
+    findPkgs({ "zlib" });
+
+    struct stat before, after;
+    CPPUNIT_ASSERT(stat(SEARCH_INSTALLED_DIR SEARCH_FILENAME, &before) == 0);
+
+    findPkgs({ "zlib" });
+    CPPUNIT_ASSERT(stat(SEARCH_INSTALLED_DIR SEARCH_FILENAME, &after) == 0);
+    CPPUNIT_ASSERT(before.st_ino == after.st_ino);
+}
+
+// New tarballs are read into the index, and the ones which left the library leave it too
+void SearchTest::testAddedAndRemovedPackages() {
+    CPPUNIT_ASSERT(findPkgs({ "zlib" }) == std::vector<std::string>({ "zlib" }));
+
+    writeTestPkg("zstd", { "usr/lib/libzstd.so", "usr/include/zstd.h" });
+    std::filesystem::remove(SEARCH_LIB_DIR "openssl.tar");
+
+    CPPUNIT_ASSERT(findPkgs({ "usr/lib" }) == std::vector<std::string>({ "zlib", "zstd" }));
+    CPPUNIT_ASSERT(findPkgs({ "ssl" }).empty());
+    CPPUNIT_ASSERT(findPkgs({ "zstd.h" }) == std::vector<std::string>({ "zstd" }));
+
+    SearchIndex index(SEARCH_INSTALLED_DIR, 0);
+    CPPUNIT_ASSERT(index.getPkgCount() == 3);
+}
+
+// A tarball whose size or mtime changed is read again, and what it no longer holds stops matching
+void SearchTest::testChangedPackageIsReread() {
+    CPPUNIT_ASSERT(findPkgs({ "zlib.h" }) == std::vector<std::string>({ "zlib" }));
+
+    writeTestPkg("zlib", { "usr/lib/libz.so", "usr/include/zconf.h" }, 1600000000);
+
+    CPPUNIT_ASSERT(findPkgs({ "zlib.h" }).empty());
+    CPPUNIT_ASSERT(findPkgs({ "zconf" }) == std::vector<std::string>({ "zlib" }));
+}
@@ -0,0 +1,43 @@
+#ifndef _THE2B_TST_SEARCH_H
+#define _THE2B_TST_SEARCH_H
+
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <sys/stat.h>
+#include <utime.h>
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestResultCollector.h>
+
+#include "Pkg.h"
+#include "Search.h"
+#include "tstUtils.h"
+
+#define SEARCH_BASE_DIR "test-env-search/"
+#define SEARCH_LIB_DIR "test-env-search/lib/"
+#define SEARCH_INSTALLED_DIR "test-env-search/installed/"
+
+// Builds the search index over a small library, changes the library under it, and checks what the index finds
+class SearchTest : public CppUnit::TestFixture {
+    public:
+        void setUp();
+        void tearDown();
+
+        void testFindCandidates();
+        void testSearchLibrary();
+        void testShortTermsDoNotNarrow();
+        void testUpToDateIndexIsKept();
+        void testAddedAndRemovedPackages();
+        void testChangedPackageIsReread();
+
+        static CppUnit::Test* suite();
+
+        void writeTestPkg(const std::string& name, const std::vector<std::string>& paths, time_t mtime = 1500000000);
+        std::vector<std::string> findPkgs(const std::vector<std::string>& terms);
+};
+
+#endif /* _THE2B_TST_SEARCH_H */
@@ -0,0 +1,106 @@
+#include "tstStage.h"
+
+CppUnit::Test* StageTest::suite() {
+    CppUnit::TestSuite* suite = new CppUnit::TestSuite( "StageTest" );
+
+    suite->addTest( new CppUnit::TestCaller<StageTest>( "testStagedInstall", &StageTest::testStagedInstall ));
+    suite->addTest( new CppUnit::TestCaller<StageTest>( "testCommitMergesIntoDirectories", &StageTest::testCommitMergesIntoDirectories ));
+    suite->addTest( new CppUnit::TestCaller<StageTest>( "testCommitReplacesFiles", &StageTest::testCommitReplacesFiles ));
+    suite->addTest( new CppUnit::TestCaller<StageTest>( "testFailedCommitIsUndone", &StageTest::testFailedCommitIsUndone ));
+    suite->addTest( new CppUnit::TestCaller<StageTest>( "testStaleStagesAreRemoved", &StageTest::testStaleStagesAreRemoved ));
+    suite->addTest( new CppUnit::TestCaller<StageTest>( "testStagingDirIsRemovedWhenUnused", &StageTest::testStagingDirIsRemovedWhenUnused ));
+
+    return suite;
+}
+
+void StageTest::setUp() {
+    CPPUNIT_ASSERT(makeTestDirs({ STAGE_BASE_DIR, STAGE_INSTALLED_DIR, STAGE_ROOT, STAGE_PLAIN_ROOT }));
+}
+
+void StageTest::tearDown() {
+    removeTestDir(STAGE_BASE_DIR);
+}
+
+int StageTest::installTestPkg(const std::string& root, bool staged) {
+    Pkg pkg(testPkgPath(), 0);
+    return pkg.installPkg(root, STAGE_INSTALLED_DIR, 0, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES)), DEFAULT_SMART_OP, 1, staged, DURABILITY_NONE);
+}
+
+// A staged install leaves the same tree as one written straight into the root, and nothing of the staging directory
+void StageTest::testStagedInstall() {
+    CPPUNIT_ASSERT(installTestPkg(STAGE_PLAIN_ROOT, false) == ARCHIVE_EOF);
+    CPPUNIT_ASSERT(installTestPkg(STAGE_ROOT, true) == ARCHIVE_EOF);
+
+    CPPUNIT_ASSERT(!std::filesystem::exists(STAGE_STAGE_DIR));
+    CPPUNIT_ASSERT(listTestTree(STAGE_ROOT) == listTestTree(STAGE_PLAIN_ROOT));
+    CPPUNIT_ASSERT(readTestFile(STAGE_ROOT TEST_PKG_FILE) == readTestFile(STAGE_PLAIN_ROOT TEST_PKG_FILE));
+}
+
+// Directories already in the root have the package merged into them, and keep what else they held
+void StageTest::testCommitMergesIntoDirectories() {
+    CPPUNIT_ASSERT(writeTestFile(STAGE_ROOT TEST_PKG_DIR_MEMBER "/local.c", "local\n"));
+    CPPUNIT_ASSERT(installTestPkg(STAGE_ROOT, true) == ARCHIVE_EOF);
+
+    CPPUNIT_ASSERT(readTestFile(STAGE_ROOT TEST_PKG_DIR_MEMBER "/local.c") == "local\n");
+    CPPUNIT_ASSERT(std::filesystem::is_regular_file(STAGE_ROOT TEST_PKG_DIR_MEMBER "/add.dat"));
+    CPPUNIT_ASSERT(std::filesystem::is_regular_file(STAGE_ROOT TEST_PKG_FILE));
+}
+
+// A file already in the root is replaced by the package's version
+void StageTest::testCommitReplacesFiles() {
+    CPPUNIT_ASSERT(installTestPkg(STAGE_PLAIN_ROOT, false) == ARCHIVE_EOF);
+    CPPUNIT_ASSERT(writeTestFile(STAGE_ROOT TEST_PKG_FILE, "old\n"));
+    CPPUNIT_ASSERT(installTestPkg(STAGE_ROOT, true) == ARCHIVE_EOF);
+
+    CPPUNIT_ASSERT(readTestFile(STAGE_ROOT TEST_PKG_FILE) == readTestFile(STAGE_PLAIN_ROOT TEST_PKG_FILE));
+    CPPUNIT_ASSERT(!std::filesystem::exists(STAGE_STAGE_DIR));
+}
+
+// A path which can't be moved into place fails the commit, and everything already moved or replaced is put back
+void StageTest::testFailedCommitIsUndone() {
+    CPPUNIT_ASSERT(writeTestFile(STAGE_ROOT "mpc-1.1.0/Makefile.am", "old\n"));
+    CPPUNIT_ASSERT(writeTestFile(STAGE_ROOT TEST_PKG_DIR_MEMBER "/local.c", "local\n"));
+    CPPUNIT_ASSERT(std::filesystem::create_directories(STAGE_ROOT TEST_PKG_FILE));
+    std::vector<std::string> before = listTestTree(STAGE_ROOT);
+
+    CPPUNIT_ASSERT(installTestPkg(STAGE_ROOT, true) == STAGE_COMMIT_ERROR);
+
+    CPPUNIT_ASSERT(listTestTree(STAGE_ROOT) == before);
+    CPPUNIT_ASSERT(readTestFile(STAGE_ROOT "mpc-1.1.0/Makefile.am") == "old\n");
+    CPPUNIT_ASSERT(std::filesystem::is_directory(STAGE_ROOT TEST_PKG_FILE));
+}
+
+// The directories of interrupted installs are deleted when the next one starts, and those of running installs are left alone
+void StageTest::testStaleStagesAreRemoved() {
+    std::string stale = std::to_string(deadPid()) + ".0." TEST_PKG_NAME;
+    std::string running = std::to_string(getppid()) + ".0." TEST_PKG_NAME;
+    CPPUNIT_ASSERT(writeTestFile(STAGE_STAGE_DIR + stale + "/" TEST_PKG_FILE, "stale\n"));
+    CPPUNIT_ASSERT(writeTestFile(STAGE_STAGE_DIR + running + "/" TEST_PKG_FILE, "running\n"));
+
+    std::string stagePath;
+    CPPUNIT_ASSERT(makeStagingDir(STAGE_ROOT, TEST_PKG_NAME, stagePath, 0) == 0);
+    CPPUNIT_ASSERT(std::filesystem::is_directory(stagePath));
+    CPPUNIT_ASSERT(std::filesystem::path(stagePath).filename().string().rfind(std::to_string(getpid()) + ".", 0) == 0);
+
+    CPPUNIT_ASSERT(!std::filesystem::exists(STAGE_STAGE_DIR + stale));
+    CPPUNIT_ASSERT(readTestFile(STAGE_STAGE_DIR + running + "/" TEST_PKG_FILE) == "running\n");
+
+    discardStaged(STAGE_ROOT, stagePath);
+    CPPUNIT_ASSERT(!std::filesystem::exists(stagePath));
+    CPPUNIT_ASSERT(std::filesystem::is_directory(STAGE_STAGE_DIR + running));
+}
+
+// Each install gets a directory of its own, and the staging directory goes away with the last of them
+void StageTest::testStagingDirIsRemovedWhenUnused() {
+    std::string first;
+    std::string second;
+    CPPUNIT_ASSERT(makeStagingDir(STAGE_ROOT, TEST_PKG_NAME, first, 0) == 0);
+    CPPUNIT_ASSERT(makeStagingDir(STAGE_ROOT, TEST_PKG_NAME, second, 0) == 0);
+    CPPUNIT_ASSERT(first != second);
+
+    discardStaged(STAGE_ROOT, first);
+    CPPUNIT_ASSERT(std::filesystem::is_directory(second));
+
+    discardStaged(STAGE_ROOT, second);
+    CPPUNIT_ASSERT(!std::filesystem::exists(STAGE_STAGE_DIR));
+}
@@ -0,0 +1,45 @@
+#ifndef _THE2B_TST_STAGE_H
+#define _THE2B_TST_STAGE_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <filesystem>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestResultCollector.h>
+
+#include "Pkg.h"
+#include "Stage.h"
+#include "tstUtils.h"
+
+#define STAGE_BASE_DIR "test-env-stage/"
+#define STAGE_INSTALLED_DIR "test-env-stage/installed/"
+#define STAGE_ROOT "test-env-stage/sysroot/"
+#define STAGE_PLAIN_ROOT "test-env-stage/plainroot/"
+#define STAGE_STAGE_DIR STAGE_ROOT STAGE_DIR_NAME "/"
+
+// Installs packages through the staging directory, and checks the root is only ever changed by a whole commit
+class StageTest : public CppUnit::TestFixture {
+    public:
+        void setUp();
+        void tearDown();
+
+        void testStagedInstall();
+        void testCommitMergesIntoDirectories();
+        void testCommitReplacesFiles();
+        void testFailedCommitIsUndone();
+        void testStaleStagesAreRemoved();
+        void testStagingDirIsRemovedWhenUnused();
+
+        static CppUnit::Test* suite();
+
+        int installTestPkg(const std::string& root, bool staged);
+};
+
+#endif /* _THE2B_TST_STAGE_H */
@@ -0,0 +1,164 @@
+#include "tstStore.h"
+
+CppUnit::Test* StoreTest::suite() {
+    CppUnit::TestSuite* suite = new CppUnit::TestSuite( "StoreTest" );
+
+    suite->addTest( new CppUnit::TestCaller<StoreTest>( "testPopulate", &StoreTest::testPopulate ));
+    suite->addTest( new CppUnit::TestCaller<StoreTest>( "testMaterialize", &StoreTest::testMaterialize ));
+    suite->addTest( new CppUnit::TestCaller<StoreTest>( "testHardLinkedObjects", &StoreTest::testHardLinkedObjects ));
+    suite->addTest( new CppUnit::TestCaller<StoreTest>( "testRebuiltPkgIsMissed", &StoreTest::testRebuiltPkgIsMissed ));
+    suite->addTest( new CppUnit::TestCaller<StoreTest>( "testLostObjectIsMissed", &StoreTest::testLostObjectIsMissed ));
+    suite->addTest( new CppUnit::TestCaller<StoreTest>( "testExcludedPathsAreMissed", &StoreTest::testExcludedPathsAreMissed ));
+    suite->addTest( new CppUnit::TestCaller<StoreTest>( "testGarbageCollection", &StoreTest::testGarbageCollection ));
+    suite->addTest( new CppUnit::TestCaller<StoreTest>( "testGarbageCollectionClearsTmp", &StoreTest::testGarbageCollectionClearsTmp ));
+
+    return suite;
+}
+
+void StoreTest::setUp() {
+    CPPUNIT_ASSERT(makeTestDirs({ STORE_BASE_DIR, STORE_PKG_DIR, STORE_INSTALLED_DIR, STORE_ROOT, STORE_PLAIN_ROOT }));
+}
+
+void StoreTest::tearDown() {
+    removeTestDir(STORE_BASE_DIR);
+}
+
+int StoreTest::installPkg(const std::string& tarPath, const std::string& root, ContentStore& store, const ExclusionMatcher& exclusions) {
+    Pkg pkg(tarPath, 0);
+    return pkg.installPkg(root, STORE_INSTALLED_DIR, 0, exclusions, DEFAULT_SMART_OP, 1, false, DURABILITY_NONE, &store);
+}
+
+// A package of a single small file, so a cap can be set between its size and the test package's
+std::string StoreTest::writeSmallPkg() {
+    std::string tarPath = STORE_PKG_DIR "small.tar";
+    CPPUNIT_ASSERT(writeTestTar(tarPath, { { "small/hello", TAR_TYPE_REGULAR, "hello\n" } }));
+    return tarPath;
+}
+
+// The names of every object in the store
+std::vector<std::string> StoreTest::listObjects() {
+    std::vector<std::string> objects;
+    for(const std::string& path : listTestTree(STORE_PATH STORE_OBJECTS_DIR)) {
+        if(std::filesystem::is_regular_file(STORE_PATH STORE_OBJECTS_DIR "/" + path)) {
+            objects.push_back(path);
+        }
+    }
+
+    return objects;
+}
+
+// The first install of a package extracts it as usual, and adds an index and its files to the store
+void StoreTest::testPopulate() {
+    ContentStore store(STORE_PATH, false, 0, 0);
+    CPPUNIT_ASSERT(store.isOpen());
+    CPPUNIT_ASSERT(installPkg(testPkgPath(), STORE_ROOT, store) == ARCHIVE_EOF);
+
+    CPPUNIT_ASSERT(std::filesystem::is_regular_file(STORE_PATH STORE_PKGS_DIR "/" TEST_PKG_NAME));
+    CPPUNIT_ASSERT(!listObjects().empty());
+    CPPUNIT_ASSERT(std::filesystem::is_regular_file(STORE_ROOT TEST_PKG_FILE));
+}
+
+// Installing the same tarball again replays the store, and leaves the same tree as extracting it
+void StoreTest::testMaterialize() {
+    ContentStore store(STORE_PATH, false, 0, 0);
+    CPPUNIT_ASSERT(installPkg(testPkgPath(), STORE_PLAIN_ROOT, store) == ARCHIVE_EOF);
+
+    CPPUNIT_ASSERT(store.materialize(testPkgPath(), TEST_PKG_NAME, STORE_ROOT, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES))) == ARCHIVE_EOF);
+    CPPUNIT_ASSERT(listTestTree(STORE_ROOT) == listTestTree(STORE_PLAIN_ROOT));
+    CPPUNIT_ASSERT(readTestFile(STORE_ROOT TEST_PKG_FILE) == readTestFile(STORE_PLAIN_ROOT TEST_PKG_FILE));
+
+    struct stat installed;
+    struct stat extracted;
+    CPPUNIT_ASSERT(stat(STORE_ROOT TEST_PKG_FILE, &installed) == 0);
+    CPPUNIT_ASSERT(stat(STORE_PLAIN_ROOT TEST_PKG_FILE, &extracted) == 0);
+    CPPUNIT_ASSERT(installed.st_mode == extracted.st_mode);
+    CPPUNIT_ASSERT(installed.st_nlink == 1);
+
+    // A root which isn't there is an error of the store's own, not a miss to extract over
+    CPPUNIT_ASSERT(store.materialize(testPkgPath(), TEST_PKG_NAME, STORE_BASE_DIR "missing", ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES))) == STORE_ROOT_ERROR);
+}
+
+// Asked to, the store hard links files to its objects instead of copying them
+void StoreTest::testHardLinkedObjects() {
+    ContentStore store(STORE_PATH, true, 0, 0);
+    CPPUNIT_ASSERT(installPkg(testPkgPath(), STORE_PLAIN_ROOT, store) == ARCHIVE_EOF);
+    CPPUNIT_ASSERT(store.materialize(testPkgPath(), TEST_PKG_NAME, STORE_ROOT, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES))) == ARCHIVE_EOF);
+
+    struct stat installed;
+    CPPUNIT_ASSERT(stat(STORE_ROOT TEST_PKG_FILE, &installed) == 0);
+    CPPUNIT_ASSERT(installed.st_nlink == 2);
+    CPPUNIT_ASSERT(readTestFile(STORE_ROOT TEST_PKG_FILE) == readTestFile(STORE_PLAIN_ROOT TEST_PKG_FILE));
+}
+
+// A tarball whose size or modification time changed since it was stored is extracted again
+void StoreTest::testRebuiltPkgIsMissed() {
+    std::string tarPath = copyTestPkg(STORE_PKG_DIR);
+
+    ContentStore store(STORE_PATH, false, 0, 0);
+    CPPUNIT_ASSERT(installPkg(tarPath, STORE_PLAIN_ROOT, store) == ARCHIVE_EOF);
+
+    struct timespec times[2] = { { 0, UTIME_OMIT }, { 1500000000, 0 } };
+    CPPUNIT_ASSERT(utimensat(AT_FDCWD, tarPath.c_str(), times, 0) == 0);
+    CPPUNIT_ASSERT(store.materialize(tarPath, TEST_PKG_NAME, STORE_ROOT, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES))) == STORE_MISS);
+}
+
+// An object lost from the store misses, and the install extracts the tarball instead
+void StoreTest::testLostObjectIsMissed() {
+    ContentStore store(STORE_PATH, false, 0, 0);
+    CPPUNIT_ASSERT(installPkg(testPkgPath(), STORE_PLAIN_ROOT, store) == ARCHIVE_EOF);
+
+    std::vector<std::string> objects = listObjects();
+    CPPUNIT_ASSERT(std::filesystem::remove(STORE_PATH STORE_OBJECTS_DIR "/" + objects.back()));
+    CPPUNIT_ASSERT(store.materialize(testPkgPath(), TEST_PKG_NAME, STORE_ROOT, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES))) == STORE_MISS);
+
+    CPPUNIT_ASSERT(makeTestDir(STORE_ROOT));
+    CPPUNIT_ASSERT(installPkg(testPkgPath(), STORE_ROOT, store) == ARCHIVE_EOF);
+    CPPUNIT_ASSERT(listTestTree(STORE_ROOT) == listTestTree(STORE_PLAIN_ROOT));
+}
+
+// Paths excluded when a package was stored can only be installed from the store with the same exclusions
+void StoreTest::testExcludedPathsAreMissed() {
+    std::set<std::string> excluded(PKG_SCRIPT_NAMES);
+    excluded.insert("mpc-1.1.0/doc");
+
+    ContentStore store(STORE_PATH, false, 0, 0);
+    CPPUNIT_ASSERT(installPkg(testPkgPath(), STORE_PLAIN_ROOT, store, ExclusionMatcher(excluded)) == ARCHIVE_EOF);
+
+    CPPUNIT_ASSERT(store.materialize(testPkgPath(), TEST_PKG_NAME, STORE_ROOT, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES))) == STORE_MISS);
+    CPPUNIT_ASSERT(store.materialize(testPkgPath(), TEST_PKG_NAME, STORE_ROOT, ExclusionMatcher(excluded)) == ARCHIVE_EOF);
+    CPPUNIT_ASSERT(!std::filesystem::exists(STORE_ROOT "mpc-1.1.0/doc"));
+    CPPUNIT_ASSERT(listTestTree(STORE_ROOT) == listTestTree(STORE_PLAIN_ROOT));
+}
+
+// Over the cap, the package used longest ago is dropped along with its objects, and the rest stay installable
+void StoreTest::testGarbageCollection() {
+    std::string smallPath = writeSmallPkg();
+    {
+        ContentStore store(STORE_PATH, false, 0, 0);
+        CPPUNIT_ASSERT(installPkg(testPkgPath(), STORE_PLAIN_ROOT, store) == ARCHIVE_EOF);
+        CPPUNIT_ASSERT(installPkg(smallPath, STORE_PLAIN_ROOT, store) == ARCHIVE_EOF);
+    }
+
+    struct timespec times[2] = { { 0, UTIME_OMIT }, { 1, 0 } };
+    CPPUNIT_ASSERT(utimensat(AT_FDCWD, STORE_PATH STORE_PKGS_DIR "/" TEST_PKG_NAME, times, 0) == 0);
+
+    ContentStore store(STORE_PATH, false, 1024, 0);
+    CPPUNIT_ASSERT(store.collectGarbage() == 0);
+
+    CPPUNIT_ASSERT(!std::filesystem::exists(STORE_PATH STORE_PKGS_DIR "/" TEST_PKG_NAME));
+    CPPUNIT_ASSERT(std::filesystem::exists(STORE_PATH STORE_PKGS_DIR "/small"));
+    CPPUNIT_ASSERT(listObjects().size() == 1);
+
+    CPPUNIT_ASSERT(store.materialize(smallPath, "small", STORE_ROOT, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES))) == ARCHIVE_EOF);
+    CPPUNIT_ASSERT(readTestFile(STORE_ROOT "small/hello") == "hello\n");
+    CPPUNIT_ASSERT(store.materialize(testPkgPath(), TEST_PKG_NAME, STORE_ROOT, ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES))) == STORE_MISS);
+}
+
+// Whatever an install which died left under tmp is removed, even with no cap
+void StoreTest::testGarbageCollectionClearsTmp() {
+    ContentStore store(STORE_PATH, false, 0, 0);
+    CPPUNIT_ASSERT(writeTestFile(STORE_PATH STORE_TMP_DIR "/1234.0", "partial"));
+
+    CPPUNIT_ASSERT(store.collectGarbage() == 0);
+    CPPUNIT_ASSERT(listTestTree(STORE_PATH STORE_TMP_DIR).empty());
+}
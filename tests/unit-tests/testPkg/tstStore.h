@@ -0,0 +1,51 @@
+#ifndef _THE2B_TST_STORE_H
+#define _THE2B_TST_STORE_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <filesystem>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestResultCollector.h>
+
+#include "Pkg.h"
+#include "Store.h"
+#include "tstUtils.h"
+
+#define STORE_BASE_DIR "test-env-store/"
+#define STORE_PKG_DIR "test-env-store/pkgs/"
+#define STORE_INSTALLED_DIR "test-env-store/installed/"
+#define STORE_ROOT "test-env-store/sysroot/"
+#define STORE_PLAIN_ROOT "test-env-store/plainroot/"
+#define STORE_PATH "test-env-store/store/"
+
+// Installs packages through the content store, and checks what it keeps, what it installs from, and what it drops
+class StoreTest : public CppUnit::TestFixture {
+    public:
+        void setUp();
+        void tearDown();
+
+        void testPopulate();
+        void testMaterialize();
+        void testHardLinkedObjects();
+        void testRebuiltPkgIsMissed();
+        void testLostObjectIsMissed();
+        void testExcludedPathsAreMissed();
+        void testGarbageCollection();
+        void testGarbageCollectionClearsTmp();
+
+        static CppUnit::Test* suite();
+
+        int installPkg(const std::string& tarPath, const std::string& root, ContentStore& store, const ExclusionMatcher& exclusions = ExclusionMatcher(std::set<std::string>(PKG_SCRIPT_NAMES)));
+        std::string writeSmallPkg();
+        std::vector<std::string> listObjects();
+};
+
+#endif /* _THE2B_TST_STORE_H */
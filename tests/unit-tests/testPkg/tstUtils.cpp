@@ -0,0 +1,164 @@
+#include "tstUtils.h"
+
+#include <cppunit/TestAssert.h>
+
+// Helpers shared by the test fixtures of the tstPkg binary
+
+std::string testPkgPath(const std::string& name) {
+    return execDir + "/" + TEST_PKG_DIR + name + ".tar";
+}
+
+// Empties out a directory the tests work in, creating it if need be
+bool makeTestDir(const std::string& path) {
+    std::error_code ec;
+    std::filesystem::remove_all(path, ec);
+    return std::filesystem::create_directories(path, ec) && !ec;
+}
+
+// Empties out every directory a fixture works in, in order, so a base directory can be given before the ones within it
+bool makeTestDirs(const std::vector<std::string>& paths) {
+    for(const std::string& path : paths) {
+        if(!makeTestDir(path)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Removes whatever a fixture left behind. Nothing there is fine
+void removeTestDir(const std::string& path) {
+    std::error_code ec;
+    std::filesystem::remove_all(path, ec);
+}
+
+// A copy of the test package in dir, which the tests are free to touch, grow, index and damage
+std::string copyTestPkg(const std::string& dir) {
+    std::string tarPath = dir + TEST_PKG_NAME ".tar";
+    CPPUNIT_ASSERT(std::filesystem::copy_file(testPkgPath(), tarPath));
+    return tarPath;
+}
+
+// Writes an archive with libarchive, in whichever tar format and compression a test needs
+bool writeTestTar(const std::string& path, const std::vector<testMember_s>& members, int format, const char* filter) {
+    archive* a = archive_write_new();
+    archive_write_set_format(a, format);
+
+    if(filter != NULL && archive_write_add_filter_by_name(a, filter) != ARCHIVE_OK) {
+        archive_write_free(a);
+        return false;
+    }
+
+    if(archive_write_open_filename(a, path.c_str()) != ARCHIVE_OK) {
+        archive_write_free(a);
+        return false;
+    }
+
+    bool ok = true;
+    for(const testMember_s& m : members) {
+        archive_entry* ae = archive_entry_new();
+        archive_entry_set_pathname(ae, m.path.c_str());
+        archive_entry_set_perm(ae, m.mode);
+        archive_entry_set_mtime(ae, 1500000000, 0);
+
+        switch(m.type) {
+            case TAR_TYPE_DIRECTORY:
+                archive_entry_set_filetype(ae, AE_IFDIR);
+                break;
+            case TAR_TYPE_SYMLINK:
+                archive_entry_set_filetype(ae, AE_IFLNK);
+                archive_entry_set_symlink(ae, m.linkTarget.c_str());
+                break;
+            case TAR_TYPE_HARDLINK:
+                archive_entry_set_filetype(ae, AE_IFREG);
+                archive_entry_set_hardlink(ae, m.linkTarget.c_str());
+                break;
+            case TAR_TYPE_FIFO:
+                archive_entry_set_filetype(ae, AE_IFIFO);
+                break;
+            default:
+                archive_entry_set_filetype(ae, AE_IFREG);
+                archive_entry_set_size(ae, m.data.size());
+                break;
+        }
+
+        for(auto& xattr : m.xattrs) {
+            archive_entry_xattr_add_entry(ae, xattr.first.c_str(), xattr.second.data(), xattr.second.size());
+        }
+
+        for(auto& region : m.sparse) {
+            archive_entry_sparse_add_entry(ae, region.first, region.second);
+        }
+
+        ok = ok && archive_write_header(a, ae) >= ARCHIVE_WARN;
+        if(ok && !m.data.empty() && m.type != TAR_TYPE_HARDLINK) {
+            ok = archive_write_data(a, m.data.data(), m.data.size()) >= 0;
+        }
+
+        archive_entry_free(ae);
+    }
+
+    ok = (archive_write_close(a) == ARCHIVE_OK) && ok;
+    archive_write_free(a);
+    return ok;
+}
+
+std::string readTestFile(const std::string& path) {
+    std::ifstream ifs(path, std::ios::binary);
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    return ss.str();
+}
+
+bool writeTestFile(const std::string& path, const std::string& data) {
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    ofs << data;
+    ofs.close();
+    return ofs.good();
+}
+
+// Every path under root, relative to it, sorted
+std::vector<std::string> listTestTree(const std::string& root) {
+    std::vector<std::string> paths;
+    std::error_code ec;
+
+    for(std::filesystem::recursive_directory_iterator di(root, ec); !ec && di != std::filesystem::recursive_directory_iterator(); di.increment(ec)) {
+        paths.push_back(di->path().lexically_relative(root).string());
+    }
+
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+// The paths of every member of an archive, as libarchive reads them, in archive order
+std::vector<std::string> listTarPaths(const std::string& tarPath) {
+    std::vector<std::string> paths;
+    archive* a = archive_read_new();
+    archive_read_support_format_all(a);
+    archive_read_support_filter_all(a);
+
+    if(archive_read_open_filename(a, tarPath.c_str(), 10240) == ARCHIVE_OK) {
+        archive_entry* ae;
+        while(archive_read_next_header(a, &ae) == ARCHIVE_OK) {
+            paths.push_back(normalizeMemberPath(archive_entry_pathname(ae)));
+        }
+    }
+
+    archive_read_free(a);
+    return paths;
+}
+
+// The pid of a process which already exited, as the one behind an interrupted install or uninstall would have
+pid_t deadPid() {
+    pid_t pid = fork();
+    if(pid == 0) {
+        _exit(0);
+    }
+
+    CPPUNIT_ASSERT(pid > 0);
+    CPPUNIT_ASSERT(waitpid(pid, NULL, 0) == pid);
+    return pid;
+}
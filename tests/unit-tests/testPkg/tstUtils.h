@@ -0,0 +1,62 @@
+#ifndef _THE2B_TST_UTILS_H
+#define _THE2B_TST_UTILS_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <archive.h>
+#include <archive_entry.h>
+
+#include "Pkg.h"
+
+// The directory the packages shipped with the tests live in, next to the test binary
+#ifndef TEST_PKG_DIR
+#define TEST_PKG_DIR "testPkgs/"
+#endif /* TEST_PKG_DIR */
+
+// The package shipped with the tests, and what it holds
+#define TEST_PKG_NAME "test2"
+#define TEST_PKG_MEMBER_COUNT 338
+#define TEST_PKG_FILE "mpc-1.1.0/AUTHORS"
+#define TEST_PKG_DIR_MEMBER "mpc-1.1.0/tests"
+
+// Set by main, from argv[0]
+extern std::string execDir;
+
+// A member of an archive written for a test. See writeTestTar
+struct testMember_s {
+    std::string path;
+    char type = TAR_TYPE_REGULAR;
+    std::string data;
+    std::string linkTarget;
+    mode_t mode = 0644;
+    std::map<std::string, std::string> xattrs;
+
+    // The stretches of data holding anything but zeroes. Only set for sparse files, whose data still holds the holes
+    std::vector<std::pair<off_t, off_t>> sparse;
+};
+
+std::string testPkgPath(const std::string& name = TEST_PKG_NAME);
+bool makeTestDir(const std::string& path);
+bool makeTestDirs(const std::vector<std::string>& paths);
+void removeTestDir(const std::string& path);
+std::string copyTestPkg(const std::string& dir);
+bool writeTestTar(const std::string& path, const std::vector<testMember_s>& members, int format = ARCHIVE_FORMAT_TAR_PAX_RESTRICTED, const char* filter = NULL);
+std::string readTestFile(const std::string& path);
+bool writeTestFile(const std::string& path, const std::string& data);
+std::vector<std::string> listTestTree(const std::string& root);
+std::vector<std::string> listTarPaths(const std::string& tarPath);
+pid_t deadPid();
+
+#endif /* _THE2B_TST_UTILS_H */
@@ -0,0 +1,237 @@
+#include "tstWriterPool.h"
+
+CppUnit::Test* WriterPoolTest::suite() {
+    CppUnit::TestSuite* suite = new CppUnit::TestSuite( "WriterPoolTest" );
+
+    suite->addTest( new CppUnit::TestCaller<WriterPoolTest>( "testBufferAccounting", &WriterPoolTest::testBufferAccounting ));
+    suite->addTest( new CppUnit::TestCaller<WriterPoolTest>( "testJobBuffersAreReturned", &WriterPoolTest::testJobBuffersAreReturned ));
+    suite->addTest( new CppUnit::TestCaller<WriterPoolTest>( "testWaitForPath", &WriterPoolTest::testWaitForPath ));
+    suite->addTest( new CppUnit::TestCaller<WriterPoolTest>( "testInstallPlainWithWriters", &WriterPoolTest::testInstallPlainWithWriters ));
+    suite->addTest( new CppUnit::TestCaller<WriterPoolTest>( "testInstallCompressedWithWriters", &WriterPoolTest::testInstallCompressedWithWriters ));
+
+    return suite;
+}
+
+void WriterPoolTest::setUp() {
+    CPPUNIT_ASSERT(makeTestDirs({ WRITER_POOL_BASE_DIR, WRITER_POOL_PKG_DIR, WRITER_POOL_INSTALLED_DIR, WRITER_POOL_ROOT, WRITER_POOL_SERIAL_ROOT }));
+}
+
+void WriterPoolTest::tearDown() {
+    // The read-only directory the packages install would keep anyone but root from clearing it out
+    chmod(WRITER_POOL_ROOT "usr/ro", 0755);
+    chmod(WRITER_POOL_SERIAL_ROOT "usr/ro", 0755);
+    removeTestDir(WRITER_POOL_BASE_DIR);
+}
+
+// Data which differs from one buffer to the next, so a chunk written out of place shows
+static std::string patternData(size_t size) {
+    std::string data(size, '\0');
+    for(size_t index = 0; index < size; index++) {
+        data[index] = (char)((index * 131 + index / WRITER_BUFFER_SIZE) & 0xff);
+    }
+
+    return data;
+}
+
+// A job writing data into the test directory, with its data already in buffers from the pool
+static writeJob_s makeJob(WriterPool& pool, const std::string& leaf, const std::string& data, mode_t mode) {
+    writeJob_s job;
+    job.dirFd = open(WRITER_POOL_BASE_DIR, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    job.leaf = leaf;
+    job.rel = leaf;
+    job.dest = WRITER_POOL_BASE_DIR + leaf;
+    job.mode = mode;
+    job.size = data.size();
+
+    for(size_t offset = 0; offset < data.size(); offset += WRITER_BUFFER_SIZE) {
+        size_t len = std::min(data.size() - offset, (size_t)WRITER_BUFFER_SIZE);
+        char* buf = pool.acquireBuffer();
+        CPPUNIT_ASSERT(buf != NULL);
+        memcpy(buf, data.data() + offset, len);
+        job.chunks.push_back(std::pair<char*, size_t>(buf, len));
+    }
+
+    return job;
+}
+
+// The pool hands out at most WRITER_BUFFERS_PER_THREAD buffers per writer, and once they are all out, waits for one to be given back and hands that one out
+void WriterPoolTest::testBufferAccounting() {
+    WriterPool pool(2, 0);
+    CPPUNIT_ASSERT(pool.getMaxBuffers() == 2 * WRITER_BUFFERS_PER_THREAD);
+
+    std::set<char*> held;
+    for(size_t index = 0; index < pool.getMaxBuffers(); index++) {
+        char* buf = pool.acquireBuffer();
+        CPPUNIT_ASSERT(buf != NULL);
+        held.insert(buf);
+    }
+
+    CPPUNIT_ASSERT(held.size() == pool.getMaxBuffers());
+
+    std::atomic<char*> waited(NULL);
+    std::thread waiter([&pool, &waited] { waited = pool.acquireBuffer(); });
+
+    usleep(100000);
+    CPPUNIT_ASSERT(waited == NULL);
+
+    char* given = *held.begin();
+    pool.releaseBuffer(given);
+    waiter.join();
+    CPPUNIT_ASSERT(waited == given);
+
+    for(char* buf : held) {
+        pool.releaseBuffer(buf);
+    }
+}
+
+// The buffers holding a file's data go back to the pool once the file is written, so every one of them can be had again
+void WriterPoolTest::testJobBuffersAreReturned() {
+    WriterPool pool(2, 0);
+    std::string data = patternData(3 * WRITER_BUFFER_SIZE + 17);
+
+    writeJob_s job = makeJob(pool, "file", data, 0644);
+    std::set<char*> jobBuffers;
+    for(const auto& chunk : job.chunks) {
+        jobBuffers.insert(chunk.first);
+    }
+
+    pool.submit(job);
+    CPPUNIT_ASSERT(pool.drain() == 0);
+    CPPUNIT_ASSERT(readTestFile(WRITER_POOL_BASE_DIR "file") == data);
+    CPPUNIT_ASSERT(pool.getFilesWritten() == 1);
+    CPPUNIT_ASSERT(pool.getBytesWritten() == data.size());
+
+    std::set<char*> held;
+    for(size_t index = 0; index < pool.getMaxBuffers(); index++) {
+        held.insert(pool.acquireBuffer());
+    }
+
+    for(char* buf : jobBuffers) {
+        CPPUNIT_ASSERT(held.count(buf) == 1);
+    }
+
+    for(char* buf : held) {
+        pool.releaseBuffer(buf);
+    }
+}
+
+// Once waitForPath returns, the last file queued at that path has been written in full, with its mode, so the next one queued there replaces it rather than racing it
+void WriterPoolTest::testWaitForPath() {
+    WriterPool pool(WRITER_POOL_WRITERS, 0);
+    unsigned long long bytes = 0;
+
+    for(unsigned int round = 0; round < 16; round++) {
+        std::string data = "round " + std::to_string(round) + "\n" + patternData(round * 65537);
+        bytes += data.size();
+
+        pool.waitForPath("file");
+        writeJob_s job = makeJob(pool, "file", data, (round % 2 == 0) ? 0640 : 0600);
+        pool.submit(job);
+
+        pool.waitForPath("file");
+        CPPUNIT_ASSERT(readTestFile(WRITER_POOL_BASE_DIR "file") == data);
+
+        struct stat st;
+        CPPUNIT_ASSERT(stat(WRITER_POOL_BASE_DIR "file", &st) == 0);
+        CPPUNIT_ASSERT((st.st_mode & 07777) == ((round % 2 == 0) ? 0640 : 0600));
+    }
+
+    CPPUNIT_ASSERT(pool.drain() == 0);
+    CPPUNIT_ASSERT(pool.getFilesWritten() == 16);
+    CPPUNIT_ASSERT(pool.getBytesWritten() == bytes);
+}
+
+// Directories with a mode which would keep their files from being written, hard links to files still being written, a path given twice, a file too big to be buffered and plenty of small ones
+std::vector<testMember_s> WriterPoolTest::writerMembers() {
+    // The most a pool of WRITER_POOL_WRITERS buffers for a single file is half of its buffers
+    size_t bufferLimit = (size_t)WRITER_BUFFER_SIZE * (WRITER_POOL_WRITERS * WRITER_BUFFERS_PER_THREAD / 2);
+
+    std::vector<testMember_s> members = {
+        { "usr/", TAR_TYPE_DIRECTORY, "", "", 0755 },
+        { "usr/lib/", TAR_TYPE_DIRECTORY, "", "", 0755 },
+        { "usr/lib/libfoo.so.1", TAR_TYPE_REGULAR, "foo\n", "", 0755 },
+        { "usr/lib/libfoo.so", TAR_TYPE_HARDLINK, "", "usr/lib/libfoo.so.1" },
+        { "usr/share/", TAR_TYPE_DIRECTORY, "", "", 0755 },
+        { "usr/share/big", TAR_TYPE_REGULAR, patternData(bufferLimit + 4097), "", 0600 },
+        { "usr/share/big-link", TAR_TYPE_HARDLINK, "", "usr/share/big" },
+        { "usr/share/buffered", TAR_TYPE_REGULAR, patternData(3 * WRITER_BUFFER_SIZE + 1), "", 0644 },
+        { "usr/share/buffered-link", TAR_TYPE_HARDLINK, "", "usr/share/buffered" },
+        { "usr/dup", TAR_TYPE_REGULAR, patternData(2 * WRITER_BUFFER_SIZE), "", 0644 },
+        { "usr/ro/", TAR_TYPE_DIRECTORY, "", "", 0555 },
+        { "usr/ro/file", TAR_TYPE_REGULAR, "read only\n", "", 0444 }
+    };
+
+    for(unsigned int index = 0; index < 200; index++) {
+        members.push_back({ "usr/many/" + std::to_string(index), TAR_TYPE_REGULAR, std::to_string(index) + "\n", "", 0644 });
+    }
+
+    members.push_back({ "usr/dup", TAR_TYPE_REGULAR, "second\n", "", 0600 });
+    members.push_back({ "usr/ro/link", TAR_TYPE_HARDLINK, "", "usr/many/199" });
+
+    return members;
+}
+
+// Installs the package with a single writer and with WRITER_POOL_WRITERS, and checks both roots hold the same thing
+void WriterPoolTest::checkInstallWithWriters(const std::string& tarPath) {
+    Pkg pkg(tarPath, 0);
+    CPPUNIT_ASSERT(pkg.installPkg(WRITER_POOL_SERIAL_ROOT, WRITER_POOL_INSTALLED_DIR, 0, ExclusionMatcher(defaultPkgExclusions()), DEFAULT_SMART_OP, 1) == ARCHIVE_EOF);
+    CPPUNIT_ASSERT(pkg.installPkg(WRITER_POOL_ROOT, WRITER_POOL_INSTALLED_DIR, 0, ExclusionMatcher(defaultPkgExclusions()), DEFAULT_SMART_OP, WRITER_POOL_WRITERS) == ARCHIVE_EOF);
+
+    std::vector<std::string> paths = listTestTree(WRITER_POOL_ROOT);
+    CPPUNIT_ASSERT(paths == listTestTree(WRITER_POOL_SERIAL_ROOT));
+    CPPUNIT_ASSERT(paths.size() == 214);
+
+    for(const std::string& path : paths) {
+        struct stat st;
+        struct stat serial;
+        CPPUNIT_ASSERT(lstat((WRITER_POOL_ROOT + path).c_str(), &st) == 0);
+        CPPUNIT_ASSERT(lstat((WRITER_POOL_SERIAL_ROOT + path).c_str(), &serial) == 0);
+        CPPUNIT_ASSERT(st.st_mode == serial.st_mode);
+        CPPUNIT_ASSERT(st.st_size == serial.st_size || S_ISDIR(st.st_mode));
+        CPPUNIT_ASSERT(st.st_nlink == serial.st_nlink || S_ISDIR(st.st_mode));
+
+        if(S_ISREG(st.st_mode)) {
+            CPPUNIT_ASSERT(readTestFile(WRITER_POOL_ROOT + path) == readTestFile(WRITER_POOL_SERIAL_ROOT + path));
+        }
+    }
+
+    // Each hard link shares the inode of the file it was made to, which was written by a writer thread, or by the decoder when too big to buffer
+    for(const auto& link : std::vector<std::pair<std::string, std::string>>({ { "usr/lib/libfoo.so", "usr/lib/libfoo.so.1" }, { "usr/share/big-link", "usr/share/big" }, { "usr/share/buffered-link", "usr/share/buffered" }, { "usr/ro/link", "usr/many/199" } })) {
+        struct stat linkSt;
+        struct stat targetSt;
+        CPPUNIT_ASSERT(stat((WRITER_POOL_ROOT + link.first).c_str(), &linkSt) == 0);
+        CPPUNIT_ASSERT(stat((WRITER_POOL_ROOT + link.second).c_str(), &targetSt) == 0);
+        CPPUNIT_ASSERT(linkSt.st_ino == targetSt.st_ino);
+    }
+
+    struct stat st;
+    CPPUNIT_ASSERT(stat(WRITER_POOL_ROOT "usr/share/big", &st) == 0);
+    CPPUNIT_ASSERT(st.st_size > (off_t)WRITER_BUFFER_SIZE * (WRITER_POOL_WRITERS * WRITER_BUFFERS_PER_THREAD / 2));
+    CPPUNIT_ASSERT((st.st_mode & 07777) == 0600);
+
+    // The later member at a path replaces the earlier one, mode and all
+    CPPUNIT_ASSERT(readTestFile(WRITER_POOL_ROOT "usr/dup") == "second\n");
+    CPPUNIT_ASSERT(stat(WRITER_POOL_ROOT "usr/dup", &st) == 0);
+    CPPUNIT_ASSERT((st.st_mode & 07777) == 0600);
+
+    // A directory only gets its mode once everything inside of it was written
+    CPPUNIT_ASSERT(stat(WRITER_POOL_ROOT "usr/ro", &st) == 0);
+    CPPUNIT_ASSERT((st.st_mode & 07777) == 0555);
+    CPPUNIT_ASSERT(readTestFile(WRITER_POOL_ROOT "usr/ro/file") == "read only\n");
+}
+
+// An uncompressed package, whose files the writers copy straight out of the tarball
+void WriterPoolTest::testInstallPlainWithWriters() {
+    std::string tarPath = WRITER_POOL_PKG_DIR "writers.tar";
+    CPPUNIT_ASSERT(writeTestTar(tarPath, writerMembers()));
+
+    checkInstallWithWriters(tarPath);
+}
+
+// A compressed package, whose files are decoded into the pool's buffers, and handed to the writers from there
+void WriterPoolTest::testInstallCompressedWithWriters() {
+    std::string tarPath = WRITER_POOL_PKG_DIR "writers.tar.zst";
+    CPPUNIT_ASSERT(writeTestTar(tarPath, writerMembers(), ARCHIVE_FORMAT_TAR_PAX_RESTRICTED, "zstd"));
+
+    checkInstallWithWriters(tarPath);
+}
@@ -0,0 +1,52 @@
+#ifndef _THE2B_TST_WRITER_POOL_H
+#define _THE2B_TST_WRITER_POOL_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <string.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestResultCollector.h>
+
+#include "Pkg.h"
+#include "WriterPool.h"
+#include "tstUtils.h"
+
+#define WRITER_POOL_BASE_DIR "test-env-writer-pool/"
+#define WRITER_POOL_PKG_DIR "test-env-writer-pool/pkgs/"
+#define WRITER_POOL_INSTALLED_DIR "test-env-writer-pool/installed/"
+#define WRITER_POOL_ROOT "test-env-writer-pool/sysroot/"
+#define WRITER_POOL_SERIAL_ROOT "test-env-writer-pool/serial/"
+
+// The writers used to install the test packages
+#define WRITER_POOL_WRITERS 4
+
+// Hands files to a pool of writers directly, and installs packages with several writers, checking they come out as they do with one
+class WriterPoolTest : public CppUnit::TestFixture {
+    public:
+        void setUp();
+        void tearDown();
+
+        void testBufferAccounting();
+        void testJobBuffersAreReturned();
+        void testWaitForPath();
+        void testInstallPlainWithWriters();
+        void testInstallCompressedWithWriters();
+
+        static CppUnit::Test* suite();
+
+        std::vector<testMember_s> writerMembers();
+        void checkInstallWithWriters(const std::string& tarPath);
+};
+
+#endif /* _THE2B_TST_WRITER_POOL_H */